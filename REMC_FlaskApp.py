@@ -4,8 +4,11 @@ import time
 import sys
 import threading
 import copy
+import json
 import io  # for CSV
 import csv  # for CSV
+import os
+import subprocess
 from datetime import datetime
 from flask import Flask, redirect, url_for, jsonify, Response, request
 from collections import deque
@@ -36,6 +39,19 @@ MAX_CSV_BYTES = 1 * 1024 * 1024 * 1024  # 1 GiB hard cap
 BYTES_PER_RECORD_EST = 320  # ≈ dict with 6 floats + overhead
 MAX_RECORDS_IN_RAM = (1 * 1024 * 1024 * 1024) // BYTES_PER_RECORD_EST
 
+# Columnar history written by REMC_HostReceiver/remc_receiver (--store DIR).
+# One node of it, <dir>/nodes/<node_name>_<ip>. When set, /download_csv reads
+# <node>/live and no per-sample dicts are kept in RAM.
+CAPTURE_STORE_DIR = None
+# Built REMC_HostReceiver/capture_export; when present, /download_csv streams the
+# store through it (same bytes, far faster) and /download_bin is available.
+CAPTURE_EXPORT_TOOL = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'REMC_HostReceiver', 'capture_export')
+# remc_receiver's pushed live frames (Server-Sent Events), e.g.
+# 'http://192.168.1.10:8081/live' with --http-bind 192.168.1.10. When set, the
+# dashboard's controls and telemetry follow every frame and /data is polled
+# every 2 s for the header and counters only.
+LIVE_STREAM_URL = None
+
 
 # --- Packet Structure Definitions ---
 # Neutrino framing
@@ -64,6 +80,85 @@ DATA_PAYLOAD_FIELDS = [
 ]
 
 
+# Header flags (1 = collected samples, 2 = batch end)
+FLAGS_SPECTRAL = 4  # Spectral summary packet (payload is not samples)
+FLAGS_FAULT = 8     # Acquisition fault event packet (payload is not samples)
+FLAGS_TRACE = 16    # Trace capture packet (host_bench/trace_capture records these)
+
+SPECTRAL_CHANNEL_NAMES = {0: 'switch_voltage', 2: 'output_voltage_a', 3: 'output_voltage_b'}  # ChannelTable.h index
+
+
+def parse_spectral_payload(payload: bytes):
+    """
+    Decode a FLAGS_SPECTRAL payload (see UdpManager::sendSpectralSummary).
+    Powers are in raw ADC counts^2; frequencies in Hz.
+    """
+    channel, num_peaks, num_bands, _ = struct.unpack_from('<4B', payload, 0)
+    fft_size, _ = struct.unpack_from('<HH', payload, 4)
+    bin_hz, mean_counts, rms_counts = struct.unpack_from('<fff', payload, 8)
+    (block_end_us,) = struct.unpack_from('<Q', payload, 20)
+    offset = 28
+    peaks = []
+    for i in range(4):
+        bin_idx, _, power = struct.unpack_from('<HHf', payload, offset)
+        offset += 8
+        if i < num_peaks:
+            peaks.append({'freq_hz': bin_idx * bin_hz, 'power': power})
+    band_power = list(struct.unpack_from(f'<{num_bands}f', payload, offset))
+    offset += 4 * num_bands
+    band_edges = list(struct.unpack_from(f'<{num_bands + 1}f', payload, offset))
+    return {
+        'channel': SPECTRAL_CHANNEL_NAMES.get(channel, str(channel)),
+        'fft_size': fft_size,
+        'bin_hz': bin_hz,
+        'mean_counts': mean_counts,
+        'rms_counts': rms_counts,
+        'block_end_us': block_end_us,
+        'peaks': peaks,
+        'bands': [{'lo_hz': band_edges[i], 'hi_hz': band_edges[i + 1], 'power': band_power[i]}
+                  for i in range(num_bands)],
+    }
+
+
+MAX_FAULT_EVENTS = 100
+FAULT_EVENT_NAMES = {1: 'fault', 2: 'action', 3: 'recovered', 4: 'failed', 5: 'gap'}
+FAULT_TYPE_NAMES = {0: 'none', 1: 'adc_stall', 2: 'core1_stall'}
+WATCHDOG_STATE_NAMES = {0: 'healthy', 1: 'stalled', 2: 'recovering', 3: 'failed'}
+WATCHDOG_ACTION_NAMES = {0: 'none', 1: 'report_fault', 2: 'adc_reset', 3: 'core1_restart',
+                         4: 'report_failed', 5: 'report_recovered'}
+
+
+def parse_fault_payload(payload: bytes):
+    """
+    Decode a FLAGS_FAULT payload (see UdpManager::sendFaultEvent).
+    Gap events give the first missing sample index and the number of
+    samples marked missing in the collected stream (sent as gap markers,
+    every channel NaN; see parse_neutrino_packet).
+    """
+    event, fault, state, action, adc_attempts, restart_attempts = struct.unpack_from('<6B', payload, 0)
+    (stall_ms, head, heartbeat, overruns,
+     adc_timeouts, adc_resets, sampler_restarts) = struct.unpack_from('<7I', payload, 8)
+    gap_start_index, gap_samples = struct.unpack_from('<QI', payload, 36)
+    (event_us,) = struct.unpack_from('<Q', payload, 52)
+    return {
+        'event': FAULT_EVENT_NAMES.get(event, str(event)),
+        'fault': FAULT_TYPE_NAMES.get(fault, str(fault)),
+        'state': WATCHDOG_STATE_NAMES.get(state, str(state)),
+        'action': WATCHDOG_ACTION_NAMES.get(action, str(action)),
+        'adc_attempts': adc_attempts,
+        'restart_attempts': restart_attempts,
+        'stall_ms': stall_ms,
+        'ring_head': head,
+        'heartbeat': heartbeat,
+        'overruns': overruns,
+        'adc_timeouts': adc_timeouts,
+        'adc_resets': adc_resets,
+        'sampler_restarts': sampler_restarts,
+        'gap_start_index': gap_start_index,
+        'gap_samples': gap_samples,
+        'event_us': event_us,
+    }
+
 
 # --- Batched Neutrino Parser (supports 1..N samples per datagram) ---
 def parse_neutrino_packet(datagram: bytes):
@@ -92,6 +187,16 @@ def parse_neutrino_packet(datagram: bytes):
     if isinstance(header.get('schema_hash'), bytes):
         header['schema_hash'] = header['schema_hash'].hex()
 
+    # Spectral summaries carry their own payload layout
+    if header.get('flags') == FLAGS_SPECTRAL:
+        header['spectral'] = parse_spectral_payload(payload)
+        return header, []
+    if header.get('flags') == FLAGS_FAULT:
+        header['fault'] = parse_fault_payload(payload)
+        return header, []
+    if header.get('flags') == FLAGS_TRACE:
+        return header, []
+
     # Decide sample size: try 42 (with us_end), 34 (64-bit NTP), then 30 (32-bit micros), then 26 (legacy)
     SAMPLE_SIZE_WITH_END = (5 * 4) + 8 + 6 + 8  # 42 bytes (5 floats + uint64 us + 6 flags + uint64 us_end)
     SAMPLE_SIZE_CURRENT = (5 * 4) + 8 + 6       # 34 bytes (5 floats + uint64 + 6 flags)
@@ -126,6 +231,10 @@ def parse_neutrino_packet(datagram: bytes):
         # 5 floats, little-endian
         sv, sc, ova, ovb, t1 = struct.unpack_from('<fffff', payload, offset)
         offset += 20
+        # Gap marker (a sample the device lost, NaN in every channel):
+        # keep its time, report no values
+        if sv != sv and sc != sc and ova != ova and ovb != ovb and t1 != t1:
+            sv = sc = ova = ovb = t1 = None
 
         # Parse timestamp based on format
         sample_micros = None
@@ -199,13 +308,49 @@ latest_data = {
     'last_bundle_size': 0,  # Track last bundle size
     'status': 'Initializing...',
     'sender_ip': None,
-    'fsm_state_name': 'UNKNOWN'
+    'fsm_state_name': 'UNKNOWN',
+    'spectral': {},  # channel name -> latest spectral summary
+    'faults': []  # recent acquisition fault events, oldest first (MAX_FAULT_EVENTS)
 }
 data_lock = threading.Lock()
 
 historical_data_log = deque(maxlen=MAX_RECORDS_IN_RAM)
 historical_data_lock = threading.Lock()
 
+
+class CaptureStoreHistory:
+    """Sample history read from the receiver's capture store, as LOGGING_DATA_FIELDS dicts."""
+
+    def __init__(self, store_dir):
+        sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'REMC_HostReceiver'))
+        from capture_store import CaptureStoreReader
+        self.store = CaptureStoreReader(os.path.join(store_dir, 'live'))
+
+    def snapshot(self):
+        """Indexable view of the rows committed so far."""
+        self.store.refresh()
+        return CaptureStoreRows(self.store, len(self.store))
+
+
+class CaptureStoreRows:
+    def __init__(self, store, count):
+        self.store = store
+        self.count = count
+
+    def __len__(self):
+        return self.count
+
+    def __getitem__(self, i):
+        r = self.store.row(i)
+        ts_float = r['sample_timestamp_us'] / 1e6
+        r['timestamp'] = ts_float
+        r['sample_timestamp_iso'] = time.strftime('%Y-%m-%d %H:%M:%S', time.gmtime(ts_float)) \
+                                    + f'.{int(r["sample_timestamp_us"] % 1_000_000):06d}Z'
+        return r
+
+
+capture_history = CaptureStoreHistory(CAPTURE_STORE_DIR) if CAPTURE_STORE_DIR else None
+
 # --- Batch Collection Storage ---
 collection_batches = {}  # Dictionary: batch_id -> batch_data
 batches_lock = threading.Lock()
@@ -264,6 +409,27 @@ def udp_listener_thread():
             except Exception:
                 continue
 
+            # Spectral summaries only update the spectral view
+            if header.get('flags') == FLAGS_SPECTRAL:
+                spectral = header['spectral']
+                with data_lock:
+                    latest_data['spectral'][spectral['channel']] = spectral
+                continue
+
+            # Trace capture is for host_bench/trace_capture, not the dashboard
+            if header.get('flags') == FLAGS_TRACE:
+                continue
+
+            # Acquisition fault events only update the fault log
+            if header.get('flags') == FLAGS_FAULT:
+                fault = header['fault']
+                print(f"[Watchdog] {fault['event']}: fault={fault['fault']} action={fault['action']} "
+                      f"stall_ms={fault['stall_ms']} gap_samples={fault['gap_samples']}")
+                with data_lock:
+                    latest_data['faults'].append(fault)
+                    del latest_data['faults'][:-MAX_FAULT_EVENTS]
+                continue
+
             # Debug: Print bundle statistics occasionally
             if packet_count % 100 == 0:  # Every 100 packets
                 sample_size_str = ""
@@ -280,8 +446,9 @@ def udp_listener_thread():
                 print(f"[UDP] Packet {packet_count}: Bundle of {len(samples)} samples ({len(data)} bytes){sample_size_str}")
 
             # Process samples for both historical logging and batch capture
+            # (the receiver's capture store holds the history when configured)
             with historical_data_lock:
-                for s in samples:
+                for s in (samples if capture_history is None else ()):
                     if s.get('sample_timestamp_us') is not None:
                         ts_float = s['sample_timestamp_us'] / 1e6   # precise per-sample time
                         ts_iso = time.strftime('%Y-%m-%d %H:%M:%S', time.gmtime(ts_float)) \
@@ -467,8 +634,49 @@ def get_telemetry_data():
     return jsonify(data_to_send)
 
 
+def capture_export_available():
+    return capture_history is not None and os.access(CAPTURE_EXPORT_TOOL, os.X_OK)
+
+
+def stream_capture_export(fmt, args=()):
+    """Stream capture_export output for <CAPTURE_STORE_DIR>/live in 1 MiB chunks."""
+    proc = subprocess.Popen([CAPTURE_EXPORT_TOOL, fmt, os.path.join(CAPTURE_STORE_DIR, 'live'), *args],
+                            stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+
+    def generate():
+        try:
+            while True:
+                chunk = proc.stdout.read(1 << 20)
+                if not chunk:
+                    break
+                yield chunk
+        finally:
+            proc.stdout.close()
+            if proc.poll() is None:
+                proc.kill()
+            proc.wait()
+
+    return generate()
+
+
+@app.route('/download_bin')
+def download_bin_route():
+    if not capture_export_available():
+        return jsonify(error="Binary export needs CAPTURE_STORE_DIR and a built capture_export"), 404
+    ts = datetime.now().strftime('%Y%m%d_%H%M%S')
+    return Response(stream_capture_export('bin'),
+                    mimetype="application/octet-stream",
+                    headers={"Content-Disposition": f"attachment; filename=remc_telemetry_log_{ts}.bin"})
+
+
 @app.route('/download_csv')
 def download_csv_route():
+    if capture_export_available():
+        ts = datetime.now().strftime('%Y%m%d_%H%M%S')
+        return Response(stream_capture_export('csv', ['--max-bytes', str(MAX_CSV_BYTES)]),
+                        mimetype="text/csv",
+                        headers={"Content-Disposition": f"attachment; filename=remc_telemetry_log_{ts}.csv"})
+
     csv_fieldnames = LOGGING_DATA_FIELDS
     float_fields_to_format = [
         'switch_voltage_kv', 'switch_current_a', 'output_voltage_a_kv',
@@ -501,8 +709,11 @@ def download_csv_route():
         buf.seek(0); buf.truncate(0)
 
         # Snapshot rows (don’t hold the lock while formatting)
-        with historical_data_lock:
-            rows = tuple(historical_data_log)
+        if capture_history is not None:
+            rows = capture_history.snapshot()
+        else:
+            with historical_data_lock:
+                rows = tuple(historical_data_log)
 
         # 2) Find the start index of the newest slice that fits under MAX_CSV_BYTES
         budget = max(0, MAX_CSV_BYTES - header_bytes)
@@ -600,6 +811,9 @@ def get_javascript_html():
     return """
     <script>
       const POLLING_INTERVAL_MS = 500;
+      const STREAM_POLLING_INTERVAL_MS = 2000;  // header and counters only
+      const LIVE_STREAM_URL = __LIVE_STREAM_URL__;
+      let liveStreamActive = false;
       let manualMode = false;
 
       async function sendCommand(endpoint) {
@@ -684,10 +898,10 @@ def get_javascript_html():
           });
         }
 
-        // start polling
-        fetchDataAndUpdate();
+        // start polling (and the live stream, if configured)
+        startLiveStream();
+        pollData();
         fetchBatchesAndUpdate();
-        setInterval(fetchDataAndUpdate, POLLING_INTERVAL_MS);
         setInterval(fetchBatchesAndUpdate, 2000); // Update batches every 2 seconds
       });
 
@@ -783,6 +997,99 @@ def get_javascript_html():
         }
       }
 
+      // Controls, status and telemetry table from one payload: the /data
+      // sample, or the newest sample of a pushed frame
+      function updatePayload(p) {
+        const manual   = p.manual_mode_status === 1;
+        manualMode = manual;
+        const armed    = p.armed_status === 1;
+        const emOn     = p.em_status === 1;
+        const mswB_low = p.msw_b_status === 0; 
+
+        const holdMode = p.hold_mode_status === 1;
+        updateElementText('hold-mode-status-text', holdMode ? 'ON' : 'OFF');
+        updateElementClass('hold-mode-status-text', '', holdMode ? 'on' : 'off');
+
+
+        // show/hide manual block
+        document.querySelectorAll('.manual-only')
+                .forEach(el => el.style.display = manual ? 'block' : 'none');
+
+        // mode & state
+        const modeBtn = document.getElementById('manual-mode-button');
+        if (modeBtn) modeBtn.innerText = manual ? 'Switch to Auto Mode' : 'Switch to Manual Mode';
+        updateElementText('system-mode-text', manual ? 'MANUAL MODE' : 'AUTO MODE');
+        updateElementClass('system-mode-text','', manual ? 'manual-active' : 'auto-active');
+        updateElementText('fsm-state-display', manual ? 'MANUAL' : 'AUTO');
+
+        // main controls
+        const armBtnElem = document.getElementById('arm-button');
+        const setBtn     = document.getElementById('set-switch-button');
+        if (armBtnElem) {
+          armBtnElem.disabled = manual;
+          armBtnElem.innerText = armed ? 'DISARM System' : 'ARM System';
+          armBtnElem.className = armed ? 'disarm' : 'arm';
+        }
+        if (setBtn) setBtn.disabled = manual;
+
+        // EM status
+        updateElementText('em-status-text', emOn ? 'ON' : 'OFF');
+        updateElementClass('em-status-text', '', emOn ? 'on' : 'off');
+
+        // manual buttons enable/disable
+        const engElem = document.getElementById('manual-engage-button'),
+              disElem = document.getElementById('manual-disengage-button');
+        if (engElem) engElem.disabled = !manual;
+        if (disElem) disElem.disabled = !manual || mswB_low;
+
+        // armed & MSW
+        let armedText, armedClass;
+        if (armed) {
+          armedText  = 'ARMED';
+          armedClass = 'on';
+        } else if ((!armed && p.msw_a_status === 1 && p.msw_b_status === 1 && p.em_status === 1)) {
+          armedText  = 'ARMING';
+          armedClass = 'arming';
+        } else {
+          armedText  = 'NOT ARMED';
+          armedClass = 'off';
+        }
+        updateElementText('armed-status-text', armedText);
+        updateElementClass('armed-status-text','', armedClass);
+        updateElementText('msw-a-status-text', p.msw_a_status === 0 ? 'LOW' : 'HIGH');
+        updateElementText('msw-b-status-text', p.msw_b_status === 0 ? 'LOW' : 'HIGH');
+
+        // ─── Telemetry table (2‐dec + unit) ──────────────────────────────────
+        updateElementText('payload-switch_voltage_kv',
+                          formatFloat(p.switch_voltage_kv) + ' kV');
+        updateElementText('payload-switch_current_a',
+                          formatFloat(p.switch_current_a) + ' kA');
+        updateElementText('payload-output_voltage_a_kv',
+                          formatFloat(p.output_voltage_a_kv) + ' kV');
+        updateElementText('payload-output_voltage_b_kv',
+                          formatFloat(p.output_voltage_b_kv) + ' kV');
+        updateElementText('payload-temperature_1_degc',
+                          formatFloat(p.temperature_1_degc) + ' °C');
+        // ─────────────────────────────────────────────────────────────────────
+      }
+
+      // Frames pushed by remc_receiver (LiveStream.h); EventSource reconnects
+      // by itself, and /data takes over again while it is down
+      function startLiveStream() {
+        if (!LIVE_STREAM_URL || !window.EventSource) return;
+        const es = new EventSource(LIVE_STREAM_URL);
+        es.onmessage = e => {
+          liveStreamActive = true;
+          updatePayload(JSON.parse(e.data).payload);
+        };
+        es.onerror = () => { liveStreamActive = false; };
+      }
+
+      async function pollData() {
+        await fetchDataAndUpdate();
+        setTimeout(pollData, liveStreamActive ? STREAM_POLLING_INTERVAL_MS : POLLING_INTERVAL_MS);
+      }
+
       async function fetchDataAndUpdate() {
         try {
           const res = await fetch('/data');
@@ -805,77 +1112,7 @@ def get_javascript_html():
           updateElementText('bundle-size',    d.last_bundle_size);
 
           const p = d.payload || {}, h = d.header || {};
-          const manual   = p.manual_mode_status === 1;
-          manualMode = manual;
-          const armed    = p.armed_status === 1;
-          const emOn     = p.em_status === 1;
-          const mswB_low = p.msw_b_status === 0; 
-
-          const holdMode = p.hold_mode_status === 1;
-          updateElementText('hold-mode-status-text', holdMode ? 'ON' : 'OFF');
-          updateElementClass('hold-mode-status-text', '', holdMode ? 'on' : 'off');
-
-
-          // show/hide manual block
-          document.querySelectorAll('.manual-only')
-                  .forEach(el => el.style.display = manual ? 'block' : 'none');
-
-          // mode & state
-          const modeBtn = document.getElementById('manual-mode-button');
-          if (modeBtn) modeBtn.innerText = manual ? 'Switch to Auto Mode' : 'Switch to Manual Mode';
-          updateElementText('system-mode-text', manual ? 'MANUAL MODE' : 'AUTO MODE');
-          updateElementClass('system-mode-text','', manual ? 'manual-active' : 'auto-active');
-          updateElementText('fsm-state-display', manual ? 'MANUAL' : 'AUTO');
-
-          // main controls
-          const armBtnElem = document.getElementById('arm-button');
-          const setBtn     = document.getElementById('set-switch-button');
-          if (armBtnElem) {
-            armBtnElem.disabled = manual;
-            armBtnElem.innerText = armed ? 'DISARM System' : 'ARM System';
-            armBtnElem.className = armed ? 'disarm' : 'arm';
-          }
-          if (setBtn) setBtn.disabled = manual;
-
-          // EM status
-          updateElementText('em-status-text', emOn ? 'ON' : 'OFF');
-          updateElementClass('em-status-text', '', emOn ? 'on' : 'off');
-
-          // manual buttons enable/disable
-          const engElem = document.getElementById('manual-engage-button'),
-                disElem = document.getElementById('manual-disengage-button');
-          if (engElem) engElem.disabled = !manual;
-          if (disElem) disElem.disabled = !manual || mswB_low;
-
-          // armed & MSW
-          let armedText, armedClass;
-          if (armed) {
-            armedText  = 'ARMED';
-            armedClass = 'on';
-          } else if ((!armed && p.msw_a_status === 1 && p.msw_b_status === 1 && p.em_status === 1)) {
-            armedText  = 'ARMING';
-            armedClass = 'arming';
-          } else {
-            armedText  = 'NOT ARMED';
-            armedClass = 'off';
-          }
-          updateElementText('armed-status-text', armedText);
-          updateElementClass('armed-status-text','', armedClass);
-          updateElementText('msw-a-status-text', p.msw_a_status === 0 ? 'LOW' : 'HIGH');
-          updateElementText('msw-b-status-text', p.msw_b_status === 0 ? 'LOW' : 'HIGH');
-
-          // ─── Telemetry table (2‐dec + unit) ──────────────────────────────────
-          updateElementText('payload-switch_voltage_kv',
-                            formatFloat(p.switch_voltage_kv) + ' kV');
-          updateElementText('payload-switch_current_a',
-                            formatFloat(p.switch_current_a) + ' kA');
-          updateElementText('payload-output_voltage_a_kv',
-                            formatFloat(p.output_voltage_a_kv) + ' kV');
-          updateElementText('payload-output_voltage_b_kv',
-                            formatFloat(p.output_voltage_b_kv) + ' kV');
-          updateElementText('payload-temperature_1_degc',
-                            formatFloat(p.temperature_1_degc) + ' °C');
-          // ─────────────────────────────────────────────────────────────────────
+          if (!liveStreamActive) updatePayload(p);
 
           // ─── Header table ────────────────────────────────────────────────────
           updateElementText('header-msg_id',    h.msg_id);
@@ -925,7 +1162,7 @@ def get_javascript_html():
         }
       }
     </script>
-    """
+    """.replace('__LIVE_STREAM_URL__', json.dumps(LIVE_STREAM_URL))
 
 
 @app.route('/')
@@ -1457,6 +1694,42 @@ def handle_manual_em_disable():
     return redirect(url_for('index_page'))
 
 
+@app.route('/spectral_enable', methods=['POST'])
+def handle_spectral_enable():
+    send_udp_command(b'\x30')
+    return jsonify(status="spectral_enable_sent", message="Spectral monitor enable command sent.")
+
+
+@app.route('/spectral_disable', methods=['POST'])
+def handle_spectral_disable():
+    send_udp_command(b'\x31')
+    return jsonify(status="spectral_disable_sent", message="Spectral monitor disable command sent.")
+
+
+@app.route('/trace_enable', methods=['POST'])
+def handle_trace_enable():
+    send_udp_command(b'\x32')
+    return jsonify(status="trace_enable_sent", message="Trace capture enable command sent.")
+
+
+@app.route('/trace_disable', methods=['POST'])
+def handle_trace_disable():
+    send_udp_command(b'\x33')
+    return jsonify(status="trace_disable_sent", message="Trace capture disable command sent.")
+
+
+@app.route('/spectral')
+def get_spectral_data():
+    with data_lock:
+        return jsonify(copy.deepcopy(latest_data['spectral']))
+
+
+@app.route('/faults')
+def get_fault_events():
+    with data_lock:
+        return jsonify(copy.deepcopy(latest_data['faults']))
+
+
 # --- Main Execution ---
 if __name__ == "__main__":
     print("Starting UDP listener thread for telemetry...")
@@ -0,0 +1,148 @@
+#include "AcquisitionWatchdog.h"
+
+namespace {
+
+AcquisitionWatchdog::Config s_cfg;
+AcquisitionWatchdog::Status s_status;
+
+uint32_t s_lastHead = 0;
+uint32_t s_lastBeat = 0;
+uint32_t s_lastHeadMs = 0;   // time head last moved
+uint32_t s_lastBeatMs = 0;   // time heartbeat last moved
+uint32_t s_actionMs = 0;     // time of the last recovery action
+bool s_seenProgress = false; // head has moved at least once
+
+}
+
+namespace AcquisitionWatchdog {
+
+void init(const Config& cfg, uint32_t nowMs, uint32_t head, uint32_t heartbeat) {
+  s_cfg = cfg;
+  s_status.state = HEALTHY;
+  s_status.fault = FAULT_NONE;
+  s_status.adcResets = 0;
+  s_status.restarts = 0;
+  s_status.faultStartMs = nowMs;
+  s_status.lastStallMs = 0;
+  s_status.incidents = 0;
+  s_lastHead = head;
+  s_lastBeat = heartbeat;
+  s_lastHeadMs = nowMs;
+  s_lastBeatMs = nowMs;
+  s_actionMs = nowMs;
+  s_seenProgress = false;
+}
+
+void init(uint32_t nowMs, uint32_t head, uint32_t heartbeat) {
+  const Config cfg = {
+    ACQ_WATCHDOG_BOOT_MS, ACQ_WATCHDOG_STALL_MS, ACQ_WATCHDOG_RETRY_MS,
+    ACQ_WATCHDOG_MAX_ADC_RESETS, ACQ_WATCHDOG_MAX_RESTARTS
+  };
+  init(cfg, nowMs, head, heartbeat);
+}
+
+Action update(uint32_t nowMs, uint32_t head, uint32_t heartbeat) {
+  const bool headMoved = head != s_lastHead;
+  if (headMoved) {
+    s_lastHead = head;
+    s_lastHeadMs = nowMs;
+    s_seenProgress = true;
+  }
+  if (heartbeat != s_lastBeat) {
+    s_lastBeat = heartbeat;
+    s_lastBeatMs = nowMs;
+  }
+
+  // Data flowing again ends any incident
+  if (headMoved) {
+    if (s_status.state == HEALTHY) return ACTION_NONE;
+    s_status.lastStallMs = nowMs - s_status.faultStartMs;
+    s_status.state = HEALTHY;
+    s_status.fault = FAULT_NONE;
+    s_status.adcResets = 0;
+    s_status.restarts = 0;
+    return ACTION_REPORT_RECOVERED;
+  }
+
+  const bool beatAlive = (nowMs - s_lastBeatMs) < s_cfg.stallMs;
+
+  switch (s_status.state) {
+    case HEALTHY:
+      if (nowMs - s_lastHeadMs < (s_seenProgress ? s_cfg.stallMs : s_cfg.bootMs)) return ACTION_NONE;
+      s_status.state = STALLED;
+      s_status.fault = beatAlive ? FAULT_ADC_STALL : FAULT_CORE1_STALL;
+      s_status.faultStartMs = s_lastHeadMs;
+      s_status.incidents++;
+      return ACTION_REPORT_FAULT;
+
+    case STALLED:
+      // Re-classify: a dead heartbeat skips straight to a restart
+      s_status.fault = beatAlive ? FAULT_ADC_STALL : FAULT_CORE1_STALL;
+      s_actionMs = nowMs;
+      if (s_status.fault == FAULT_ADC_STALL && s_status.adcResets < s_cfg.maxAdcResets) {
+        s_status.adcResets++;
+        s_status.state = RECOVERING;
+        return ACTION_ADC_RESET;
+      }
+      if (s_status.restarts < s_cfg.maxRestarts) {
+        s_status.restarts++;
+        s_status.state = RECOVERING;
+        return ACTION_CORE1_RESTART;
+      }
+      s_status.state = FAILED;
+      return ACTION_REPORT_FAILED;
+
+    case RECOVERING:
+      if (nowMs - s_actionMs >= s_cfg.retryMs) s_status.state = STALLED;
+      return ACTION_NONE;
+
+    case FAILED:
+    default:
+      return ACTION_NONE;
+  }
+}
+
+const Status& getStatus() {
+  return s_status;
+}
+
+const char* stateName(State s) {
+  switch (s) {
+    case HEALTHY:    return "HEALTHY";
+    case STALLED:    return "STALLED";
+    case RECOVERING: return "RECOVERING";
+    case FAILED:     return "FAILED";
+    default:         return "UNKNOWN";
+  }
+}
+
+const char* faultName(Fault f) {
+  switch (f) {
+    case FAULT_NONE:        return "NONE";
+    case FAULT_ADC_STALL:   return "ADC_STALL";
+    case FAULT_CORE1_STALL: return "CORE1_STALL";
+    default:                return "UNKNOWN";
+  }
+}
+
+const char* actionName(Action a) {
+  switch (a) {
+    case ACTION_NONE:             return "NONE";
+    case ACTION_REPORT_FAULT:     return "REPORT_FAULT";
+    case ACTION_ADC_RESET:        return "ADC_RESET";
+    case ACTION_CORE1_RESTART:    return "CORE1_RESTART";
+    case ACTION_REPORT_FAILED:    return "REPORT_FAILED";
+    case ACTION_REPORT_RECOVERED: return "REPORT_RECOVERED";
+    default:                      return "UNKNOWN";
+  }
+}
+
+uint32_t missingSamples(uint64_t prevUs, uint64_t nextUs, uint32_t periodUs) {
+  if (periodUs == 0 || nextUs <= prevUs) return 0;
+  const uint64_t delta = nextUs - prevUs;
+  if (delta * 2 < (uint64_t)periodUs * 3) return 0;
+  const uint64_t missing = (delta + periodUs / 2) / periodUs - 1;
+  return missing > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)missing;
+}
+
+}  // namespace AcquisitionWatchdog
@@ -0,0 +1,149 @@
+/*
+  ---------------------------------------------------------------------------
+  AcquisitionWatchdog – Core1 Stall Detection and Recovery (CM7)
+  ---------------------------------------------------------------------------
+
+  Core1 publishes two progress signals in the SharedRing header:
+
+    head       advances when a frame is published (ADC data arrived)
+    heartbeat  advances on every sampler ISR tick, even if the ADC failed
+
+  The watchdog is fed both once per loop and classifies a stall:
+
+    head stuck, heartbeat moving  -> FAULT_ADC_STALL    (ADC lockup)
+    head stuck, heartbeat stuck   -> FAULT_CORE1_STALL  (ticker / core)
+
+  Recovery escalates, one action per update() call:
+
+    HEALTHY --(no head progress for stallMs)--> STALLED      [REPORT_FAULT]
+    STALLED --> RECOVERING                                   [ADC_RESET, up to
+                                                              maxAdcResets, for
+                                                              an ADC stall]
+                                                             [CORE1_RESTART
+                                                              otherwise, up to
+                                                              maxRestarts]
+    RECOVERING --(no progress for retryMs)--> STALLED
+    STALLED --(attempts exhausted)--> FAILED                 [REPORT_FAILED]
+    any --(head moves)--> HEALTHY                            [REPORT_RECOVERED]
+
+  Before the first head progress (Core1 still booting after RPC.begin())
+  the stall limit is bootMs instead of stallMs.
+
+  Executing the actions (RPC to Core1, fault packets) is the caller's job;
+  this file is pure logic with no Arduino dependencies so the state
+  machine can be driven by a fake producer on the host.
+  ---------------------------------------------------------------------------
+*/
+
+#pragma once
+#include <stdint.h>
+
+// ================== WATCHDOG CONFIGURATION ==================
+#ifndef ACQ_WATCHDOG_BOOT_MS
+  #define ACQ_WATCHDOG_BOOT_MS        3000 // Core1 start-up allowance
+#endif
+#ifndef ACQ_WATCHDOG_STALL_MS
+  #define ACQ_WATCHDOG_STALL_MS       20   // 200 samples @ 10 kHz without progress
+#endif
+#ifndef ACQ_WATCHDOG_RETRY_MS
+  #define ACQ_WATCHDOG_RETRY_MS       50   // time allowed for each recovery action
+#endif
+#ifndef ACQ_WATCHDOG_MAX_ADC_RESETS
+  #define ACQ_WATCHDOG_MAX_ADC_RESETS 3
+#endif
+#ifndef ACQ_WATCHDOG_MAX_RESTARTS
+  #define ACQ_WATCHDOG_MAX_RESTARTS   2
+#endif
+// 1: reset the whole MCU (both cores) once recovery has FAILED
+#ifndef ACQ_WATCHDOG_SYSTEM_RESET
+  #define ACQ_WATCHDOG_SYSTEM_RESET   0
+#endif
+// =============================================================
+
+namespace AcquisitionWatchdog {
+
+  enum State : uint8_t {
+    HEALTHY = 0,
+    STALLED,
+    RECOVERING,
+    FAILED
+  };
+
+  enum Fault : uint8_t {
+    FAULT_NONE = 0,
+    FAULT_ADC_STALL,      // ISR alive, no frames
+    FAULT_CORE1_STALL     // ISR not running
+  };
+
+  enum Action : uint8_t {
+    ACTION_NONE = 0,
+    ACTION_REPORT_FAULT,
+    ACTION_ADC_RESET,
+    ACTION_CORE1_RESTART,
+    ACTION_REPORT_FAILED,
+    ACTION_REPORT_RECOVERED
+  };
+
+  // Fault event packet kinds (UdpManager::sendFaultEvent)
+  enum EventType : uint8_t {
+    EVENT_FAULT = 1,      // stall detected
+    EVENT_ACTION,         // recovery action sent to Core1
+    EVENT_RECOVERED,      // samples flowing again
+    EVENT_FAILED,         // recovery attempts exhausted
+    EVENT_GAP             // missing samples marked in the index space
+  };
+
+  struct Config {
+    uint32_t bootMs;
+    uint32_t stallMs;
+    uint32_t retryMs;
+    uint8_t maxAdcResets;
+    uint8_t maxRestarts;
+  };
+
+  struct Status {
+    State state;
+    Fault fault;
+    uint8_t adcResets;        // attempts in the current incident
+    uint8_t restarts;
+    uint32_t faultStartMs;    // last head progress before the stall
+    uint32_t lastStallMs;     // duration of the last resolved incident
+    uint32_t incidents;       // total stalls detected
+  };
+
+  // Everything a fault event packet reports
+  struct Event {
+    EventType type;
+    Fault fault;
+    State state;
+    Action action;
+    uint8_t adcResets;        // attempts in the current incident
+    uint8_t restarts;
+    uint32_t stallMs;         // time without head progress
+    uint32_t head;            // SharedRing health snapshot
+    uint32_t heartbeat;
+    uint32_t overruns;
+    uint32_t adcTimeouts;
+    uint32_t adcResetsTotal;
+    uint32_t samplerRestartsTotal;
+    uint64_t gapStartIndex;   // EVENT_GAP: first missing sample index
+    uint32_t gapSamples;      // EVENT_GAP: samples marked missing
+    uint32_t t_us;            // sample timebase of the event / gap start
+    uint32_t rollover_count;
+  };
+
+  void init(const Config& cfg, uint32_t nowMs, uint32_t head, uint32_t heartbeat);
+  void init(uint32_t nowMs, uint32_t head, uint32_t heartbeat);  // default config
+
+  // Feed the current progress counters; returns the action to take now
+  Action update(uint32_t nowMs, uint32_t head, uint32_t heartbeat);
+
+  const Status& getStatus();
+  const char* stateName(State s);
+  const char* faultName(Fault f);
+  const char* actionName(Action a);
+
+  // Samples missing between two consecutive sample timestamps (µs, 64-bit)
+  // at the nominal period; 0 for normal jitter (< 1.5 periods)
+  uint32_t missingSamples(uint64_t prevUs, uint64_t nextUs, uint32_t periodUs);
+}
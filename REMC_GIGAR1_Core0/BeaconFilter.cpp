@@ -0,0 +1,120 @@
+#include "BeaconFilter.h"
+
+BeaconFilter::BeaconFilter(const Config& cfg) : _cfg(cfg) {
+  if (_cfg.historyWindows < 2) _cfg.historyWindows = 2;
+  if (_cfg.historyWindows > MAX_HISTORY) _cfg.historyWindows = MAX_HISTORY;
+  if (_cfg.windowBeacons < 1) _cfg.windowBeacons = 1;
+  _stats.beacons = 0;
+  _stats.windows = 0;
+  _stats.outliers = 0;
+  _stats.resets = 0;
+  reset();
+}
+
+void BeaconFilter::reset() {
+  _windowCount = 0;
+  _bestHw = 0;
+  _bestOffset = 0;
+  _outlierRun = 0;
+  _outlierResidual = 0;
+  _head = 0;
+  _points = 0;
+  _refHw = 0;
+  _refOffset = 0.0;
+  _skew = 0.0;
+}
+
+int64_t BeaconFilter::offsetAt(uint64_t hwUs) const {
+  const double dx = (double)(int64_t)(hwUs - _refHw);
+  const double off = _refOffset + _skew * dx;
+  return (int64_t)(off < 0 ? off - 0.5 : off + 0.5);
+}
+
+uint64_t BeaconFilter::toHost(uint64_t hwUs) const {
+  return hwUs + (uint64_t)offsetAt(hwUs);
+}
+
+uint64_t BeaconFilter::toHardware(uint64_t hostUs) const {
+  // One fixed-point step is exact to well under a µs for any real skew
+  const uint64_t guess = hostUs - (uint64_t)offsetAt(_refHw);
+  return hostUs - (uint64_t)offsetAt(guess);
+}
+
+BeaconFilter::Result BeaconFilter::add(uint64_t hwUs, uint64_t hostUs) {
+  ++_stats.beacons;
+  const int64_t offset = (int64_t)(hostUs - hwUs);
+
+  bool stepped = false;
+  if (_points > 0) {
+    const int64_t r = offset - offsetAt(hwUs);
+    if (r > (int64_t)_cfg.stepUs || r < -(int64_t)_cfg.stepUs) {
+      ++_stats.outliers;
+      // Late beacons scatter; after a host clock step they agree on the new offset
+      const int64_t d = r - _outlierResidual;
+      if (_outlierRun > 0 && (d > (int64_t)_cfg.stepUs / 2 || d < -(int64_t)_cfg.stepUs / 2)) _outlierRun = 0;
+      if (_outlierRun == 0) _outlierResidual = r;
+      if (++_outlierRun < _cfg.stepBeacons) return BEACON_OUTLIER;
+      ++_stats.resets;
+      reset();
+      stepped = true;
+    } else {
+      _outlierRun = 0;
+    }
+  }
+
+  if (_windowCount == 0 || offset > _bestOffset) {
+    _bestHw = hwUs;
+    _bestOffset = offset;
+  }
+  if (++_windowCount < _cfg.windowBeacons) return stepped ? FILTER_RESET : BEACON_ADDED;
+  closeWindow();
+  return stepped ? FILTER_RESET : WINDOW_CLOSED;
+}
+
+void BeaconFilter::closeWindow() {
+  _hw[_head] = _bestHw;
+  _offset[_head] = _bestOffset;
+  _head = (uint8_t)((_head + 1) % MAX_HISTORY);
+  if (_points < _cfg.historyWindows) ++_points;
+  _windowCount = 0;
+  ++_stats.windows;
+  fit();
+}
+
+void BeaconFilter::fit() {
+  const uint8_t newest = (uint8_t)((_head + MAX_HISTORY - 1) % MAX_HISTORY);
+  const uint64_t refHw = _hw[newest];
+  const int64_t refY = _offset[newest];
+
+  // Least squares in coordinates relative to the newest point
+  double sx = 0, sy = 0;
+  for (uint8_t k = 0; k < _points; ++k) {
+    const uint8_t i = (uint8_t)((_head + MAX_HISTORY - 1 - k) % MAX_HISTORY);
+    sx += (double)(int64_t)(_hw[i] - refHw);
+    sy += (double)(_offset[i] - refY);
+  }
+  const double mx = sx / _points, my = sy / _points;
+  double sxx = 0, sxy = 0;
+  for (uint8_t k = 0; k < _points; ++k) {
+    const uint8_t i = (uint8_t)((_head + MAX_HISTORY - 1 - k) % MAX_HISTORY);
+    const double dx = (double)(int64_t)(_hw[i] - refHw) - mx;
+    const double dy = (double)(_offset[i] - refY) - my;
+    sxx += dx * dx;
+    sxy += dx * dy;
+  }
+  const double skew = (_points > 1 && sxx > 0) ? sxy / sxx : 0.0;
+  double a = my - skew * mx;   // at the newest point
+
+  // Upper envelope: rest the line on the least delayed point
+  double lift = 0.0;
+  for (uint8_t k = 0; k < _points; ++k) {
+    const uint8_t i = (uint8_t)((_head + MAX_HISTORY - 1 - k) % MAX_HISTORY);
+    const double r = (double)(_offset[i] - refY) - (a + skew * (double)(int64_t)(_hw[i] - refHw));
+    if (r > lift) lift = r;
+  }
+  a += lift;
+
+  _refHw = refHw;
+  _refOffset = (double)refY + a;
+  _skew = skew;
+}
@@ -0,0 +1,125 @@
+/*
+  ---------------------------------------------------------------------------
+  BeaconFilter – Clock Discipline from Multicast Time Beacons (CM7)
+  ---------------------------------------------------------------------------
+
+  The host multicasts NTP broadcast-mode packets (ntp_server --beacon) to
+  Config::NTP_IP. Each beacon gives one pair
+
+    hw    HardwareTimer micros64 when the loop saw the beacon
+    host  the beacon's transmit time plus the one-way path delay (Unix µs)
+
+  and host - hw = offset - lag, where lag >= 0 is everything between the
+  host's timestamp and the loop reading the socket: the wire, the stack and,
+  mostly, the wait for the next loop iteration (up to CM7_WAKE_TICK_US, more
+  while a collect dump is being sent). Lag only ever makes a beacon look
+  late, so the filter follows the upper envelope:
+
+    1. Per window of windowBeacons beacons, keep the one with the largest
+       host - hw: the least delayed.
+    2. Fit a line through the last historyWindows window points (least
+       squares): offset at a reference point plus skew, the crystal's
+       frequency error.
+    3. Lift the line to the highest of those points' residuals, so the
+       mapping rests on the least delayed beacon of the whole history
+       rather than on the average window minimum.
+
+  A beacon more than stepUs off the current line is set aside; after
+  stepBeacons of them in a row the host clock is taken to have stepped and
+  the filter starts over from them.
+
+  Pure logic with no Arduino dependencies; TimeMapper feeds it and
+  host_bench/beacon_filter_sim drives it with simulated network jitter.
+  ---------------------------------------------------------------------------
+*/
+
+#pragma once
+#include <stdint.h>
+
+// ================== BEACON FILTER CONFIGURATION ==================
+#ifndef BEACON_WINDOW_BEACONS
+  #define BEACON_WINDOW_BEACONS   16   // 4 s at the default 4 Hz beacon
+#endif
+#ifndef BEACON_HISTORY_WINDOWS
+  #define BEACON_HISTORY_WINDOWS  8    // skew fitted over ~32 s
+#endif
+#ifndef BEACON_STEP_US
+  #define BEACON_STEP_US          5000 // further off than this: outlier or step
+#endif
+#ifndef BEACON_STEP_BEACONS
+  #define BEACON_STEP_BEACONS     8    // outliers in a row that mean a step
+#endif
+// ==================================================================
+
+class BeaconFilter {
+public:
+  static const uint8_t MAX_HISTORY = 16;
+
+  struct Config {
+    uint16_t windowBeacons;
+    uint8_t historyWindows;    // 2..MAX_HISTORY
+    uint32_t stepUs;
+    uint16_t stepBeacons;
+  };
+  static Config defaultConfig() {
+    return Config{ BEACON_WINDOW_BEACONS, BEACON_HISTORY_WINDOWS, BEACON_STEP_US, BEACON_STEP_BEACONS };
+  }
+
+  enum Result : uint8_t {
+    BEACON_ADDED = 0,          // part of the open window
+    WINDOW_CLOSED,             // ... and it completed the window; mapping updated
+    BEACON_OUTLIER,            // set aside
+    FILTER_RESET               // step detected; started over
+  };
+
+  struct Stats {
+    uint32_t beacons;
+    uint32_t windows;
+    uint32_t outliers;
+    uint32_t resets;
+  };
+
+  explicit BeaconFilter(const Config& cfg = defaultConfig());
+
+  void reset();
+  Result add(uint64_t hwUs, uint64_t hostUs);
+
+  // A mapping exists once the first window has closed; the skew after two
+  bool locked() const { return _points > 0; }
+  bool hasSkew() const { return _points > 1; }
+
+  uint64_t toHost(uint64_t hwUs) const;
+  uint64_t toHardware(uint64_t hostUs) const;
+  // host - hw at hwUs
+  int64_t offsetAt(uint64_t hwUs) const;
+  double skewPpm() const { return _skew * 1e6; }
+  // hw time of the newest window point
+  uint64_t lastUpdateHw() const { return _points ? _hw[(_head + MAX_HISTORY - 1) % MAX_HISTORY] : 0; }
+
+  const Stats& stats() const { return _stats; }
+
+private:
+  void closeWindow();
+  void fit();
+
+  Config _cfg;
+  Stats _stats;
+
+  // Open window: the least delayed beacon so far
+  uint16_t _windowCount;
+  uint64_t _bestHw;
+  int64_t _bestOffset;
+  uint16_t _outlierRun;        // outliers in a row ...
+  int64_t _outlierResidual;    // ... about this far off the line
+
+  // Window points, ring of _points (newest at _head - 1)
+  uint64_t _hw[MAX_HISTORY];
+  int64_t _offset[MAX_HISTORY];
+  uint8_t _head;
+  uint8_t _points;
+
+  // Fitted mapping: offset = _refOffset + _skew * (hw - _refHw)
+  uint64_t _refHw;
+  double _refOffset;
+  double _skew;
+};
@@ -13,19 +13,51 @@ static const IPAddress LOCAL_IP     (192, 168, 1, 50);
 static const IPAddress GATEWAY_IP   (192, 168, 1, 1);
 static const IPAddress SUBNET_MASK  (255, 255, 255, 0);
 
+// Schema node_name; give each unit on a shared LAN its own (letters, digits,
+// '_', '-', '.') so the host receiver keeps their stores apart by name as
+// well as by address
+#ifndef REMC_NODE_NAME
+  #define REMC_NODE_NAME "REMC"
+#endif
+
 static const IPAddress TELEMETRY_IP (239, 9, 9, 33);
 static const uint16_t  TELEMETRY_PORT = 13013;
 
 static const IPAddress COMMAND_MCAST_IP (239, 9, 9, 32);
 static const uint16_t  COMMAND_PORT = 13012;
 
-static const IPAddress NTP_IP (239, 9, 9, 34);
+static const IPAddress NTP_IP (239, 9, 9, 34);    // time beacons from ntp_server --beacon
 static const uint16_t  NTP_PORT = 13014;
 
 // ----- NTP Client configuration -----
 static const char* NTP_SERVER = "192.168.1.10";  // NTP server IP/hostname
 static const uint16_t NTP_CLIENT_PORT = 123;     // NTP server port
 
+// ----- ADC pairing (must match REMC_ADC_DUAL_MODE in the Core1 sketch;
+//       SampleCollector logs an error if Core1 reports a different scan) -----
+#ifndef ADC_DUAL_SIMULTANEOUS
+  #define ADC_DUAL_SIMULTANEOUS 1
+#endif
+// Sampling skew inside each pair (switch V/I, output A/B), reported in the
+// schema. Dual mode converts both members on ADC1/ADC2 at the same instant;
+// the sequential scan puts them one rank (47.5 + 8.5 ADC cycles) apart,
+// ~1750 ns at a 32 MHz ADC kernel clock.
+#if ADC_DUAL_SIMULTANEOUS
+  #define ADC_PAIR_SKEW_NS 0
+#else
+  #define ADC_PAIR_SKEW_NS 1750
+#endif
+
+// ----- CM7 idle -----
+// 1: loop() sleeps in WFE when the SharedRing is drained; woken by the
+//    Core1 doorbell (Doorbell.h), the wake ticker or any other interrupt.
+// 0: loop() polls continuously (previous behaviour).
+#ifndef CM7_IDLE_WFE
+  #define CM7_IDLE_WFE 1
+#endif
+// Upper bound on sleep; StateManager/UDP/NTP polling runs at least this often
+static const uint32_t CM7_WAKE_TICK_US = 1000;
+
 // ----- Timing configuration -----
 static const unsigned int  ANALOG_SAMPLE_FREQUENCY_HZ  = 10000; // ADC sample & PWM update rate
 static const unsigned int  ANALOG_OUTPUT_FREQUENCY_HZ  = 10000; // PWM frequency
@@ -0,0 +1,224 @@
+#include "Decimator.h"
+#include "SharedRing.h"  // For Sample struct definition only
+#include <math.h>
+#include <string.h>
+
+#if defined(REMC_USE_CMSIS_DSP)
+#include "arm_math.h"
+#endif
+
+// ---------------- CIC ----------------
+void CicDecimator::configure(uint16_t factor, uint8_t order, uint8_t inputBits) {
+  _factor = factor ? factor : 1;
+  _order = order > MAX_ORDER ? MAX_ORDER : order;
+
+  // Gain is R^N. A full-scale input times the gain must fit in 32 bits for
+  // the modular arithmetic to unwrap correctly; drop order until it does.
+  const float fullScale = ldexpf(1.0f, inputBits > 32 ? 32 : inputBits);
+  float gain = 1.0f;
+  while (_order > 0) {
+    gain = powf((float)_factor, (float)_order);
+    if (gain * fullScale <= 4294967296.0f) break;
+    _order--;
+  }
+  _gainInv = (_order > 0) ? 1.0f / gain : 1.0f;
+  reset();
+}
+
+void CicDecimator::reset() {
+  memset(_integ, 0, sizeof(_integ));
+  memset(_comb, 0, sizeof(_comb));
+  _phase = 0;
+}
+
+bool CicDecimator::push(uint32_t x, float& out) {
+  if (_order == 0) {
+    // Degenerate boxcar-free case: plain downsample
+    if (++_phase < _factor) return false;
+    _phase = 0;
+    out = (float)x;
+    return true;
+  }
+
+  // Integrators run at the input rate (wrap-around is intentional)
+  uint32_t acc = x;
+  for (uint8_t i = 0; i < _order; ++i) {
+    _integ[i] += acc;
+    acc = _integ[i];
+  }
+
+  if (++_phase < _factor) return false;
+  _phase = 0;
+
+  // Combs run at the output rate
+  for (uint8_t i = 0; i < _order; ++i) {
+    uint32_t prev = _comb[i];
+    _comb[i] = acc;
+    acc -= prev;
+  }
+
+  out = (float)acc * _gainInv;
+  return true;
+}
+
+// ---------------- FIR ----------------
+void FirDecimator::configure(uint16_t factor, uint16_t taps) {
+  _factor = factor ? factor : 1;
+  _taps = taps > MAX_TAPS ? MAX_TAPS : (taps ? taps : 1);
+
+  // Windowed-sinc low-pass (Blackman), cutoff at 90% of the new Nyquist
+  const float fc = 0.45f / (float)_factor;  // cycles/sample at input rate
+  const float mid = 0.5f * (float)(_taps - 1);
+  float sum = 0.0f;
+  for (uint16_t k = 0; k < _taps; ++k) {
+    float n = (float)k - mid;
+    float sinc = (n == 0.0f) ? 2.0f * fc
+                             : sinf(2.0f * (float)M_PI * fc * n) / ((float)M_PI * n);
+    float w = (_taps > 1)
+                ? 0.42f - 0.5f * cosf(2.0f * (float)M_PI * k / (_taps - 1))
+                        + 0.08f * cosf(4.0f * (float)M_PI * k / (_taps - 1))
+                : 1.0f;
+    _coeffs[k] = sinc * w;
+    sum += _coeffs[k];
+  }
+  // Unity DC gain so outputs stay in raw counts
+  for (uint16_t k = 0; k < _taps; ++k) {
+    _coeffs[k] /= sum;
+  }
+  reset();
+}
+
+void FirDecimator::reset() {
+  memset(_delay, 0, sizeof(_delay));
+  _phase = 0;
+  _pos = 0;
+}
+
+bool FirDecimator::push(float x, float& out) {
+  // Newest input at _pos, older ones follow; mirror so the window never wraps
+  _pos = (_pos == 0 ? _taps : _pos) - 1;
+  _delay[_pos] = x;
+  _delay[_pos + _taps] = x;
+
+  if (++_phase < _factor) return false;
+  _phase = 0;
+
+  const float* window = &_delay[_pos];
+#if defined(REMC_USE_CMSIS_DSP)
+  arm_dot_prod_f32(window, _coeffs, _taps, &out);
+#else
+  float acc = 0.0f;
+  for (uint16_t k = 0; k < _taps; ++k) {
+    acc += window[k] * _coeffs[k];
+  }
+  out = acc;
+#endif
+  return true;
+}
+
+// ---------------- Per-channel pipeline ----------------
+namespace {
+
+struct ChannelState {
+  bool enabled;
+  bool useCic;
+  bool useFir;
+  uint32_t outputs;
+  float latest;
+  CicDecimator cic;
+  FirDecimator fir;
+};
+
+ChannelState s_channels[ANALOG_CHANNEL_COUNT];
+
+inline uint16_t toCounts(float v) {
+  if (v <= 0.0f) return 0;
+  if (v >= 65535.0f) return 65535;
+  return (uint16_t)(v + 0.5f);
+}
+
+}
+
+namespace Decimator {
+
+void init() {
+  const ChannelConfig fullRate = { 1, 0, 1, 0 };
+  for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+    configure((AnalogChannel)ch, fullRate);
+  }
+
+  const ChannelConfig temp1 = {
+    DECIM_TEMP_1_CIC_FACTOR, DECIM_TEMP_1_CIC_ORDER,
+    DECIM_TEMP_1_FIR_FACTOR, DECIM_TEMP_1_FIR_TAPS
+  };
+  configure(CH_TEMP_1, temp1);
+}
+
+void configure(AnalogChannel ch, const ChannelConfig& cfg) {
+  if (ch >= ANALOG_CHANNEL_COUNT) return;
+  ChannelState& c = s_channels[ch];
+
+  c.useCic = cfg.cicFactor > 1;
+  c.useFir = cfg.firFactor > 1;
+  c.enabled = c.useCic || c.useFir;
+  c.outputs = 0;
+  c.latest = NAN;
+
+  c.cic.configure(cfg.cicFactor, cfg.cicOrder, kAnalogChannels[ch].bits);
+  c.fir.configure(cfg.firFactor, cfg.firTaps);
+}
+
+void processBlock(Sample* samples, size_t count) {
+  if (!samples) return;
+
+  for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+    ChannelState& c = s_channels[ch];
+    if (!c.enabled) continue;
+    const uint8_t bit = (uint8_t)(1u << ch);
+
+    for (size_t i = 0; i < count; ++i) {
+      uint16_t raw = samples[i].raw[ch];
+      float y;
+      bool ready;
+
+      if (c.useCic) {
+        ready = c.cic.push(raw, y);
+        if (ready && c.useFir) ready = c.fir.push(y, y);
+      } else {
+        ready = c.fir.push((float)raw, y);
+      }
+
+      // Only the sample an output lands on carries the channel; the
+      // rest (warm-up included) are marked as no data rather than held
+      if (ready) {
+        c.latest = y;
+        c.outputs++;
+        samples[i].raw[ch] = toCounts(y);
+        samples[i].held &= (uint8_t)~bit;
+      } else {
+        samples[i].held |= bit;
+      }
+    }
+  }
+}
+
+bool isEnabled(AnalogChannel ch) {
+  return ch < ANALOG_CHANNEL_COUNT && s_channels[ch].enabled;
+}
+
+uint32_t getTotalFactor(AnalogChannel ch) {
+  if (ch >= ANALOG_CHANNEL_COUNT || !s_channels[ch].enabled) return 1;
+  const ChannelState& c = s_channels[ch];
+  return (uint32_t)(c.useCic ? c.cic.getFactor() : 1) *
+         (uint32_t)(c.useFir ? c.fir.getFactor() : 1);
+}
+
+float getLatest(AnalogChannel ch) {
+  return ch < ANALOG_CHANNEL_COUNT ? s_channels[ch].latest : NAN;
+}
+
+uint32_t getOutputCount(AnalogChannel ch) {
+  return ch < ANALOG_CHANNEL_COUNT ? s_channels[ch].outputs : 0;
+}
+
+}  // namespace Decimator
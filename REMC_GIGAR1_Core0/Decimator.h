@@ -0,0 +1,138 @@
+/*
+  ---------------------------------------------------------------------------
+  Decimator – Per-Channel Anti-Aliasing Decimation (CM7)
+  ---------------------------------------------------------------------------
+
+  Core1 converts every channel at the full 10 kHz frame rate, but some of
+  them (temperature) only move on a seconds scale. Simply keeping every Nth
+  sample of such a channel aliases all of the 10 kHz noise down into the
+  slow band. This module runs a per-channel decimation pipeline on CM7 over
+  the raw ADC counts as they come out of the SharedRing:
+
+    - CIC stage:  N-order integrate/comb decimator by R1. Pure integer
+                  arithmetic (modular uint32), used for coarse, cheap
+                  rate reduction.
+    - FIR stage:  polyphase windowed-sinc low-pass decimating by R2. Only
+                  the outputs we keep are computed, each as one contiguous
+                  dot product, so the kernel auto-vectorizes on the host
+                  and maps onto CMSIS-DSP arm_dot_prod_f32 on target
+                  (define REMC_USE_CMSIS_DSP).
+
+  Either stage can be bypassed with a factor of 1. Channels whose pipeline
+  is disabled pass through untouched.
+
+  Channels are the ChannelTable.h entries (AnalogChannel). Each output is
+  written (rounded to counts) into the raw slot of the Sample it lands
+  on; every other Sample gets the channel's bit in Sample::held, so
+  UdpManager packs it as no data (NaN / U16_MISSING) and the host sees
+  the channel at its natural rate instead of a zero-order-hold staircase
+  posing as 10 kHz data. The slow channel still occupies its slot in
+  every Sample of the SDRAM ring and every datagram: this saves no
+  storage or bandwidth, it only keeps held values from passing as real
+  samples. getLatest()/getOutputCount() expose the decimated stream
+  directly.
+
+  This file has no Arduino dependencies so it can be built on the host as
+  the portable reference implementation.
+  ---------------------------------------------------------------------------
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "ChannelTable.h"
+
+struct Sample;
+
+// ================== DEFAULT DECIMATION ==================
+// Per-channel pipeline: total factor = CIC factor * FIR factor.
+// A factor of 1 bypasses that stage; both 1 = full rate.
+// Temperature defaults to 10 kHz / (10 * 10) = 100 Hz.
+#ifndef DECIM_TEMP_1_CIC_FACTOR
+  #define DECIM_TEMP_1_CIC_FACTOR   10
+#endif
+#ifndef DECIM_TEMP_1_CIC_ORDER
+  #define DECIM_TEMP_1_CIC_ORDER    3
+#endif
+#ifndef DECIM_TEMP_1_FIR_FACTOR
+  #define DECIM_TEMP_1_FIR_FACTOR   10
+#endif
+#ifndef DECIM_TEMP_1_FIR_TAPS
+  #define DECIM_TEMP_1_FIR_TAPS     48
+#endif
+// =========================================================
+
+// Coarse integer decimator: order N integrators at the input rate,
+// N combs at the output rate.
+class CicDecimator {
+public:
+    static const uint8_t MAX_ORDER = 4;
+
+    // The order is lowered until R^N * 2^inputBits fits in 32 bits
+    // (ChannelDef::bits), so the modular arithmetic still unwraps.
+    void configure(uint16_t factor, uint8_t order, uint8_t inputBits);
+    void reset();
+
+    // Push one input; returns true and writes `out` (gain-normalized)
+    // every `factor` inputs.
+    bool push(uint32_t x, float& out);
+
+    uint16_t getFactor() const { return _factor; }
+    uint8_t getOrder() const { return _order; }
+
+private:
+    uint32_t _integ[MAX_ORDER] = {};
+    uint32_t _comb[MAX_ORDER] = {};
+    float _gainInv = 1.0f;
+    uint16_t _factor = 1;
+    uint16_t _phase = 0;
+    uint8_t _order = 0;
+};
+
+// Polyphase low-pass FIR decimator. The delay line is mirrored so the
+// newest `taps` inputs are always contiguous in memory.
+class FirDecimator {
+public:
+    static const uint16_t MAX_TAPS = 64;
+
+    void configure(uint16_t factor, uint16_t taps);
+    void reset();
+
+    bool push(float x, float& out);
+
+    uint16_t getFactor() const { return _factor; }
+
+private:
+    float _coeffs[MAX_TAPS] = {};
+    float _delay[2 * MAX_TAPS] = {};
+    uint16_t _taps = 0;
+    uint16_t _factor = 1;
+    uint16_t _phase = 0;
+    uint16_t _pos = 0;
+};
+
+namespace Decimator {
+
+  struct ChannelConfig {
+    uint16_t cicFactor;  // 1 = no CIC stage
+    uint8_t  cicOrder;
+    uint16_t firFactor;  // 1 = no FIR stage
+    uint16_t firTaps;
+  };
+
+  // Apply the DECIM_* defaults above (call once in setup)
+  void init();
+
+  // Reconfigure one channel; resets that channel's filter state.
+  // A config with both factors == 1 disables the channel's pipeline.
+  void configure(AnalogChannel ch, const ChannelConfig& cfg);
+
+  // Filter `count` samples in place (call on every SharedRing block).
+  void processBlock(Sample* samples, size_t count);
+
+  // Decimated stream access
+  bool isEnabled(AnalogChannel ch);
+  uint32_t getTotalFactor(AnalogChannel ch);
+  float getLatest(AnalogChannel ch);          // raw counts, NAN before first output
+  uint32_t getOutputCount(AnalogChannel ch);  // outputs produced since configure()
+}
@@ -0,0 +1,81 @@
+/*
+  ---------------------------------------------------------------------------
+  Doorbell – Ring-Fill Wake Logic for the CM7 Consumer
+  ---------------------------------------------------------------------------
+
+  Lets CM7 sleep in WFE instead of polling an empty SharedRing:
+
+    - Consumer: after each loop pass, next() decides whether to keep
+      running or sleep. Hysteresis: once the fill reaches highFrames the
+      consumer keeps running until it has drained to lowFrames, then it
+      arms the doorbell at highFrames and sleeps.
+    - Producer: after each publish, shouldRing() fires (SEV, see
+      RingFrame.h) when the consumer is armed and the fill has reached the
+      armed threshold. One ring per arm; the producer clears the arm.
+
+  Other wake sources (the CM7 wake ticker, USB/Serial interrupts) still end
+  the sleep, so the doorbell only has to cover bursts of samples.
+
+  Pure logic, no hardware access, shared verbatim by both sketches; the
+  host benchmark (host_bench/) drives it with std::condition_variable.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef DOORBELL_H
+#define DOORBELL_H
+
+#include <stdint.h>
+
+// ================== DOORBELL CONFIGURATION ==================
+#ifndef DOORBELL_HIGH_FRAMES
+  #define DOORBELL_HIGH_FRAMES 32u   // wake CM7 at 3.2 ms of backlog @ 10 kHz
+#endif
+#ifndef DOORBELL_LOW_FRAMES
+  #define DOORBELL_LOW_FRAMES  0u    // sleep again once fully drained
+#endif
+// =============================================================
+
+namespace Doorbell {
+
+  struct Config {
+    uint32_t highFrames;  // ring / stay awake at or above this fill
+    uint32_t lowFrames;   // drained once at or below this fill
+  };
+
+  enum Decision : uint8_t {
+    KEEP_RUNNING = 0,
+    SLEEP
+  };
+
+  struct Consumer {
+    Config cfg;
+    bool draining;        // crossed highFrames, not yet back to lowFrames
+  };
+
+  static inline void init(Consumer& c, uint32_t highFrames, uint32_t lowFrames) {
+    c.cfg.highFrames = highFrames ? highFrames : 1u;
+    c.cfg.lowFrames = lowFrames < c.cfg.highFrames ? lowFrames : c.cfg.highFrames - 1u;
+    c.draining = false;
+  }
+
+  // Producer side: armed threshold (0 = not armed) vs current fill
+  static inline bool shouldRing(uint32_t armedThreshold, uint32_t fill) {
+    return armedThreshold != 0 && fill >= armedThreshold;
+  }
+
+  // Consumer side: call with the ring fill after a consume pass
+  static inline Decision next(Consumer& c, uint32_t fill) {
+    if (c.draining) {
+      if (fill > c.cfg.lowFrames) return KEEP_RUNNING;
+      c.draining = false;
+      return SLEEP;
+    }
+    if (fill >= c.cfg.highFrames) {
+      c.draining = true;
+      return KEEP_RUNNING;
+    }
+    return SLEEP;
+  }
+}
+
+#endif // DOORBELL_H
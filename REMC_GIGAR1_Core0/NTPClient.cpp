@@ -47,6 +47,10 @@ uint64_t NTPClient::baseOffsetUs() {
   return getInstance().baseOffsetUsInstance();
 }
 
+uint32_t NTPClient::lastRttUs() {
+  return getInstance().lastRttUsInstance();
+}
+
 bool NTPClient::sync(uint16_t timeout_ms) {
   return getInstance().syncInstance(timeout_ms);
 }
@@ -139,7 +143,25 @@ bool NTPClient::sendRequest() {
   // LI = 0 (no warning), VN = 4, Mode = 3 (client)
   packet[0] = 0x23; // 0b0010_0011
 
-  // Transmit Timestamp can be left 0; server will fill its own transmit time.
+  // Root delay: the last measured round trip (NTP short format, 16.16 s), so
+  // the server can log it per client
+  uint32_t rootDelay = (uint32_t)(((uint64_t)_lastRttUs << 16) / 1000000ULL);
+  packet[4] = (uint8_t)(rootDelay >> 24);
+  packet[5] = (uint8_t)(rootDelay >> 16);
+  packet[6] = (uint8_t)(rootDelay >> 8);
+  packet[7] = (uint8_t)rootDelay;
+
+  // Transmit Timestamp: our current time (micros() since boot before the first
+  // sync). The server echoes it as the reply's originate, which ties the
+  // reply to this request, and compares it with its own clock.
+  _requestMicros = micros();
+  uint64_t nowUs = _synced ? nowMicrosInstance() : (uint64_t)_requestMicros;
+  uint64_t secs = nowUs / 1000000ULL + (_synced ? NTP_UNIX_EPOCH_DIFF : 0);
+  uint64_t frac = ((nowUs % 1000000ULL) << 32) / 1000000ULL;
+  _requestTransmit = (secs << 32) | frac;
+  for (int i = 0; i < 8; i++) {
+    packet[40 + i] = (uint8_t)(_requestTransmit >> (56 - 8 * i));
+  }
 
   if (_udp->beginPacket(_serverIP, _serverPort) != 1) {
     Serial.println("[NTP] ERROR: Failed to begin UDP packet");
@@ -164,9 +186,15 @@ bool NTPClient::sendRequest() {
   return true;
 }
 
-bool NTPClient::readResponse(uint32_t& secs, uint32_t& frac) {
+uint64_t NTPClient::ntpToUnixMicros(uint64_t ntp) {
+  uint64_t unixSecs = (uint64_t)((uint32_t)(ntp >> 32) - NTP_UNIX_EPOCH_DIFF);
+  return unixSecs * 1000000ULL + ntpFracToMicros((uint32_t)ntp);
+}
+
+bool NTPClient::readResponse(uint64_t& originate, uint64_t& receive, uint64_t& transmit, uint32_t& arrivalMicros) {
   int size = _udp->parsePacket();
   if (size == 0) return false;  // No packet available
+  arrivalMicros = micros();
   
   if (size < NTP_PACKET_SIZE) {
     Serial.print("[NTP] WARNING: Received packet too small: ");
@@ -192,24 +220,36 @@ bool NTPClient::readResponse(uint32_t& secs, uint32_t& frac) {
     return false;
   }
 
-  // Check if it's a valid NTP response
+  // Check if it's a valid NTP response; time beacons (broadcast mode) share
+  // the socket and are TimeMapper's
   uint8_t mode = buf[0] & 0x07;
+  if (mode == 5) {
+    return false;
+  }
   if (mode != 4) {  // Server mode
     Serial.print("[NTP] ERROR: Invalid mode in response: ");
     Serial.println(mode);
     return false;
   }
 
-  // Transmit Timestamp starts at byte 40 (big-endian): seconds (4), fraction (4)
-  secs = ((uint32_t)buf[40] << 24) |
-         ((uint32_t)buf[41] << 16) |
-         ((uint32_t)buf[42] << 8)  |
-         ((uint32_t)buf[43]);
+  // Originate (24), Receive (32) and Transmit (40) Timestamps, big-endian
+  // seconds (4) and fraction (4)
+  originate = 0;
+  receive = 0;
+  transmit = 0;
+  for (int i = 0; i < 8; i++) {
+    originate = (originate << 8) | buf[24 + i];
+    receive = (receive << 8) | buf[32 + i];
+    transmit = (transmit << 8) | buf[40 + i];
+  }
 
-  frac = ((uint32_t)buf[44] << 24) |
-         ((uint32_t)buf[45] << 16) |
-         ((uint32_t)buf[46] << 8)  |
-         ((uint32_t)buf[47]);
+  // A server that echoes the originate must echo ours; anything else is the
+  // late reply to an earlier request
+  if (originate != 0 && originate != _requestTransmit) {
+    Serial.println("[NTP] WARNING: Reply to an earlier request ignored");
+    return false;
+  }
+  uint32_t secs = (uint32_t)(transmit >> 32);
 
   //Serial.print("[NTP] Transmit timestamp: ");
   //Serial.print(secs);
@@ -261,16 +301,26 @@ bool NTPClient::syncInstance(uint16_t timeout_ms) {
   uint32_t lastCheck = start;
   
   while ((uint16_t)(millis() - start) < timeout_ms) {
-    uint32_t secs = 0, frac = 0;
-    if (readResponse(secs, frac)) {
-      // Capture local clock as close as possible to packet read
-      uint32_t localMicros = micros();
-
-      uint64_t unixSecs = (uint64_t)(secs - NTP_UNIX_EPOCH_DIFF);
-      uint64_t unixFracUs = ntpFracToMicros(frac);
-      uint64_t unixUs = unixSecs * 1000000ULL + unixFracUs;
-
-      _epochUsAtSync = unixUs;    // this corresponds roughly to localMicros moment
+    uint64_t originate = 0, receive = 0, transmit = 0;
+    uint32_t localMicros = 0;
+    if (readResponse(originate, receive, transmit, localMicros)) {
+      uint64_t unixUs = ntpToUnixMicros(transmit);
+
+      // With the receive timestamp the round trip is known: the time the
+      // request was out, less the time the server held it. The transmit
+      // time is then half of it old when the reply arrives. A server that
+      // only fills the transmit time (basic_ntp_server.py) is taken as is.
+      _lastRttUs = 0;
+      if (originate != 0 && receive != 0) {
+        uint64_t turnaroundUs = ntpToUnixMicros(transmit) - ntpToUnixMicros(receive);
+        uint32_t outUs = localMicros - _requestMicros;   // wraps safely
+        if (turnaroundUs <= outUs) {
+          _lastRttUs = outUs - (uint32_t)turnaroundUs;
+          unixUs += _lastRttUs / 2;
+        }
+      }
+
+      _epochUsAtSync = unixUs;    // Unix time at the localMicros moment
       _microsAtSync = localMicros;
       _synced = true;
       
@@ -303,8 +353,9 @@ bool NTPClient::syncInstance(uint16_t timeout_ms) {
       lastCheck = millis();
     }
     
-    // brief yield; small delay helps some MCUs
-    delay(10);  // Slightly longer delay for better responsiveness
+    // Short poll: the reply's arrival is taken when parsePacket() first sees
+    // it, so the poll period would add to the round trip
+    delayMicroseconds(50);
   }
   
   Serial.print("[NTP] Sync timeout after ");
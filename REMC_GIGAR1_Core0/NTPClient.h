@@ -17,6 +17,7 @@ public:
   static bool hasSynced();
   static uint64_t lastSyncUnixUs();
   static uint64_t baseOffsetUs();
+  static uint32_t lastRttUs();
   static bool sync(uint16_t timeout_ms = 1000);
   static bool begin(const char* server, uint16_t ntpPort = 123);
 
@@ -46,6 +47,13 @@ public:
   // Was there at least one successful sync?
   bool hasSyncedInstance() const { return _synced; }
 
+  // Round trip of the last sync minus the server's turnaround (us); 0 when the
+  // server does not fill the receive timestamp (basic_ntp_server.py)
+  uint32_t lastRttUsInstance() const { return _lastRttUs; }
+
+  // 64-bit NTP timestamp to Unix microseconds (era 0)
+  static uint64_t ntpToUnixMicros(uint64_t ntp);
+
   // Optionally change remote port (e.g., switch between 123 and 12300)
   void setServerPort(uint16_t port) { _serverPort = port; }
 
@@ -58,7 +66,9 @@ private:
   
   bool resolveServerIP(const char* server);
   bool sendRequest();
-  bool readResponse(uint32_t& secs, uint32_t& frac);
+  // originate/receive/transmit as 64-bit NTP timestamps; arrivalMicros is
+  // micros() as soon as the reply is seen
+  bool readResponse(uint64_t& originate, uint64_t& receive, uint64_t& transmit, uint32_t& arrivalMicros);
 
   static uint64_t ntpFracToMicros(uint32_t frac) {
     // Convert 32-bit NTP fractional seconds to microseconds: frac * 1e6 / 2^32
@@ -81,4 +91,10 @@ private:
   bool _synced = false;
   uint64_t _epochUsAtSync = 0;  // Unix epoch microseconds at the moment we captured micros()
   uint32_t _microsAtSync = 0;   // micros() snapshot at sync
+
+  // Outstanding request: the transmit timestamp sent (echoed back as the
+  // reply's originate) and micros() when it went out
+  uint64_t _requestTransmit = 0;
+  uint32_t _requestMicros = 0;
+  uint32_t _lastRttUs = 0;
 };
@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include <RPC.h>
+#include <mbed.h>
 #include "SharedRing.h"
 #include "UdpManager.h"
 #include "SampleCollector.h"
@@ -10,6 +11,17 @@
 #include "NTPClient.h"
 #include "TimeMapper.h"
 #include "Config.h"
+#include "Doorbell.h"
+#include "AcquisitionWatchdog.h"
+#include "TraceRecorder.h"
+
+#if CM7_IDLE_WFE
+// Periodic interrupt that ends WFE; the handler itself has nothing to do
+static mbed::Ticker s_wakeTicker;
+static void onWakeTick() {}
+#endif
+static Doorbell::Consumer s_doorbell;
+static uint32_t s_loopIteration = 0;
 
 void setup() { 
   Serial.begin(115200);
@@ -61,17 +73,37 @@ void setup() {
   Serial.println("[Serial Core] TimeMapper beginning.");
   if (TimeMapper::getInstance().begin()) {
     Serial.println("[Serial Core] TimeMapper initialized successfully");
+    // Time beacons on the NTP group take over from polling when the host sends them
+    TimeMapper::getInstance().beginBeacons(UdpManager::getNTPUdpObject());
   } else {
     Serial.println("[Serial Core] TimeMapper initialization failed");
   }
   
+  // Trace capture, off until UDP command 0x32
+  TraceRecorder::init();
+
+  // Drained-ring sleep (see idleUntilWork)
+  Doorbell::init(s_doorbell, DOORBELL_HIGH_FRAMES, DOORBELL_LOW_FRAMES);
+#if CM7_IDLE_WFE
+  s_wakeTicker.attach(&onWakeTick, std::chrono::microseconds(Config::CM7_WAKE_TICK_US));
+#endif
+
   // Starts Sampling Core (1)
   RPC.begin();
+
+  // Core1 stall detection starts counting from its boot
+  SharedRingHealth health;
+  SharedRing_GetHealth(health);
+  AcquisitionWatchdog::init(millis(), health.head, health.heartbeat);
+
   Serial.println(F("[Serial Core] Ready - call startGathering() to begin"));
 
 }
 
 void loop() {
+  // Iteration boundary for trace capture (no-op unless enabled)
+  TraceRecorder::loopBegin(++s_loopIteration);
+
   // Print RPC messages from M4 Core
   DEBUG_printRPCMessages();
   
@@ -80,6 +112,9 @@ void loop() {
   
   // Process samples (main sample collection logic)
   SampleCollector::update();
+
+  // Check Core1 is still producing; recover it if not
+  serviceWatchdog();
   
   // Handle incoming UDP commands
   UdpManager::update();
@@ -87,6 +122,80 @@ void loop() {
   // Update TimeMapper (handles automatic NTP re-sync every 10 seconds)
   TimeMapper::update();
 
+  // Send this iteration's trace records before sleeping
+  TraceRecorder::flush();
+
+  // Sleep until Core1 rings, the wake ticker fires or another IRQ arrives
+  idleUntilWork();
+}
+
+void idleUntilWork() {
+#if CM7_IDLE_WFE
+  if (Doorbell::next(s_doorbell, SharedRing_Available()) != Doorbell::SLEEP) return;
+  // Arm first, then re-check: a publish between the two still rings
+  if (!SharedRing_ArmNotify(s_doorbell.cfg.highFrames)) return;
+  __WFE();
+  SharedRing_DisarmNotify();
+#endif
+}
+
+void serviceWatchdog() {
+  SharedRingHealth health;
+  SharedRing_GetHealth(health);
+  const AcquisitionWatchdog::Action action =
+      AcquisitionWatchdog::update(millis(), health.head, health.heartbeat);
+  if (action == AcquisitionWatchdog::ACTION_NONE) return;
+
+  const AcquisitionWatchdog::Status& st = AcquisitionWatchdog::getStatus();
+  AcquisitionWatchdog::Event event = {};
+  switch (action) {
+    case AcquisitionWatchdog::ACTION_REPORT_FAULT:     event.type = AcquisitionWatchdog::EVENT_FAULT; break;
+    case AcquisitionWatchdog::ACTION_REPORT_RECOVERED: event.type = AcquisitionWatchdog::EVENT_RECOVERED; break;
+    case AcquisitionWatchdog::ACTION_REPORT_FAILED:    event.type = AcquisitionWatchdog::EVENT_FAILED; break;
+    default:                                           event.type = AcquisitionWatchdog::EVENT_ACTION; break;
+  }
+  event.fault = st.fault;
+  event.state = st.state;
+  event.action = action;
+  event.adcResets = st.adcResets;
+  event.restarts = st.restarts;
+  event.stallMs = action == AcquisitionWatchdog::ACTION_REPORT_RECOVERED
+                    ? st.lastStallMs : millis() - st.faultStartMs;
+  event.head = health.head;
+  event.heartbeat = health.heartbeat;
+  event.overruns = health.overruns;
+  event.adcTimeouts = health.adc_timeouts;
+  event.adcResetsTotal = health.adc_resets;
+  event.samplerRestartsTotal = health.sampler_restarts;
+  const uint64_t now_us = HardwareTimer::getMicros64();
+  event.t_us = (uint32_t)now_us;
+  event.rollover_count = (uint32_t)(now_us >> 32);
+
+  Serial.print("[Watchdog] ");
+  Serial.print(AcquisitionWatchdog::actionName(action));
+  Serial.print(" fault=");
+  Serial.print(AcquisitionWatchdog::faultName(st.fault));
+  Serial.print(" stall_ms=");
+  Serial.print(event.stallMs);
+  Serial.print(" adc_timeouts=");
+  Serial.println(health.adc_timeouts);
+
+  // Recovery runs in Core1's loop(); the RPC only raises the request
+  if (action == AcquisitionWatchdog::ACTION_ADC_RESET) {
+    RPC.send("adcReset");
+  } else if (action == AcquisitionWatchdog::ACTION_CORE1_RESTART) {
+    RPC.send("samplerRestart");
+  }
+
+  UdpManager::sendFaultEvent(event);
+
+#if ACQ_WATCHDOG_SYSTEM_RESET
+  if (action == AcquisitionWatchdog::ACTION_REPORT_FAILED) {
+    Serial.println("[Watchdog] Recovery failed - resetting MCU");
+    Serial.flush();
+    NVIC_SystemReset();
+  }
+#endif
 }
 
 // ===== DEBUG FUNCTIONS FROM M4 CORE =====
@@ -0,0 +1,358 @@
+/*
+  ---------------------------------------------------------------------------
+  RingFrame – Packed Inter-Core Frame and SharedRing Layout
+  ---------------------------------------------------------------------------
+
+  The CM4 → CM7 ring in SRAM4 carries packed 16-byte frames instead of
+  full Samples:
+
+      offset | field
+      -------+-------------------------------------------------------------
+        0    | u32 tick     low 32 bits of the 64-bit µs start timestamp
+        4    | u16 dur_us   end - start in µs (saturates at 65535)
+        6    | u16 raw[]    one slot per ChannelTable.h entry
+
+  The upper 32 bits of the timestamp (the rollover count, which changes
+  once every ~71.6 min) are not stored per frame. The producer keeps the
+  current value in SharedRing::epoch, written before the head that
+  publishes the first frame of a new epoch. The consumer seeds its own
+  copy from the header once and then extends it locally, counting a
+  rollover whenever `tick` goes backwards. Consumed frames are unpacked
+  back into the full Sample layout, so nothing past SharedRing_Consume()
+  changes.
+
+  The ring fills SRAM4 above the OpenAMP reserve (SHARED_RING_OPENAMP_RESERVE,
+  bottom of SRAM4) rather than a fixed power of two, so the capacity is
+  generally not a power of two. head/tail are therefore "mirror" indices
+  in [0, 2*capacity): slot = i < cap ? i : i - cap, and head == tail is
+  empty while a distance of cap is full. There are no divisions and no
+  wrap issues at 2^32.
+
+  The producer keeps its write position in a private RingProducer. Frames
+  are staged with ring_stage() and become visible to the consumer only on
+  ring_publish(): the barriers, head store, epoch update and doorbell
+  check happen once per batch instead of per frame. ring_push() is stage+publish for the simple
+  case, ring_push_block() stages a whole block. The shared tail is only
+  re-read when the producer's cached free space runs out.
+
+  Doorbell: a consumer about to sleep arms notify_armed with a fill
+  threshold and re-checks the ring. The first publish that brings the fill
+  to that threshold clears it and executes RING_SEV() (Doorbell.h). On the
+  H747 the CM4 TXEV line is wired to the CM7 RXEV, so this wakes a CM7
+  sitting in WFE.
+
+  Health counters: the producer bumps `heartbeat` on every sampler tick
+  (whether or not the ADC delivered a frame) and counts ADC poll timeouts
+  and recoveries next to it. CM7's AcquisitionWatchdog compares heartbeat
+  against head progress to tell an ADC lockup from a stalled Core1.
+
+  This file is shared verbatim by the Core0 and Core1 sketches (like
+  ChannelTable.h) and has no Arduino dependencies, so the host benchmark
+  (host_bench/) runs the exact same producer/consumer code.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef RING_FRAME_H
+#define RING_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "ChannelTable.h"
+#include "Doorbell.h"
+
+// ================== RING CONFIGURATION ==================
+// SRAM4 is 64 KB at 0x3800_0000. OpenAMP (RPC) vrings and control blocks
+// sit at the bottom; check __OPENAMP_region_end__ in your core's linker
+// map before shrinking the reserve.
+#ifndef SHARED_RING_SRAM4_BYTES
+  #define SHARED_RING_SRAM4_BYTES     0x10000u
+#endif
+#ifndef SHARED_RING_OPENAMP_RESERVE
+  #define SHARED_RING_OPENAMP_RESERVE 0x4000u   // 16 KB left to OpenAMP
+#endif
+// SharedRing_Add() publishes every N staged frames: two DMBs and the
+// doorbell check per batch instead of per frame. 8 frames is 0.8 ms at
+// 10 kHz, under the doorbell threshold (DOORBELL_HIGH_FRAMES) and the
+// watchdog stall window; 1 publishes every frame.
+#ifndef SHARED_RING_PUBLISH_EVERY
+  #define SHARED_RING_PUBLISH_EVERY   8u
+#endif
+// =========================================================
+
+struct __attribute__((aligned(4))) RingFrame {
+  uint32_t tick;                      // µs, low 32 bits
+  uint16_t dur_us;                    // t_end - t_start (saturating)
+  uint16_t raw[ANALOG_CHANNEL_COUNT]; // ChannelTable order
+};
+
+static_assert(sizeof(RingFrame) == ((6 + 2 * ANALOG_CHANNEL_COUNT + 3) & ~3u), "RingFrame must stay packed");
+
+static constexpr uint32_t SHARED_RING_HEADER_BYTES = 64;
+
+// Capacity defaults to everything above the OpenAMP reserve
+// (3068 frames ≈ 307 ms at 10 kHz with five channels)
+#ifndef SHARED_RING_CAPACITY
+  #define SHARED_RING_CAPACITY \
+    ((SHARED_RING_SRAM4_BYTES - SHARED_RING_OPENAMP_RESERVE - SHARED_RING_HEADER_BYTES) / sizeof(RingFrame))
+#endif
+
+struct __attribute__((aligned(32))) SharedRing {
+  uint32_t capacity;    // frames
+  uint32_t head;        // mirror index, producer-owned
+  uint32_t tail;        // mirror index, consumer-owned (producer bumps it on overrun)
+  uint32_t overruns;    // producer increments when overwriting
+  uint32_t epoch;       // rollover count of the newest published frame
+  uint16_t frame_bytes; // sizeof(RingFrame), lets the consumer check the layout
+  uint16_t channels;    // ANALOG_CHANNEL_COUNT
+  uint32_t notify_armed; // consumer: doorbell threshold in frames, 0 = not armed
+  uint32_t notifies;     // producer: wake hints sent
+  // Core1 health (producer-owned, read by the CM7 watchdog)
+  uint32_t heartbeat;        // sampler ticks, incremented even when no frame is produced
+  uint32_t adc_timeouts;     // ADC polls abandoned after ADC_POLL_SPIN_LIMIT
+  uint32_t adc_resets;       // ADC re-initializations completed
+  uint32_t sampler_restarts; // full sampler restarts completed
+  uint32_t adc_mode;         // RING_ADC_MODE_* the sampler runs, 0 = not reported yet
+  uint32_t reserved[3];
+  RingFrame frames[SHARED_RING_CAPACITY];
+};
+
+static_assert(offsetof(SharedRing, frames) == SHARED_RING_HEADER_BYTES, "SharedRing header size changed");
+static_assert(((sizeof(SharedRing) + 31u) & ~31u) + SHARED_RING_OPENAMP_RESERVE <= SHARED_RING_SRAM4_BYTES,
+              "SharedRing does not fit in SRAM4 above the OpenAMP reserve");
+
+// ADC scan reported by Core1 in SharedRing::adc_mode. It follows
+// REMC_ADC_DUAL_MODE in the Core1 sketch; Core0 checks it against
+// ADC_DUAL_SIMULTANEOUS (Config.h), which sets the schema's pair skew.
+static const uint32_t RING_ADC_MODE_SEQUENTIAL = 1;
+static const uint32_t RING_ADC_MODE_DUAL       = 2;
+
+// Producer-side write state (private to the producing core)
+struct RingProducer {
+  uint32_t head;      // next write position (mirror index), includes staged frames
+  uint32_t pending;   // staged, not yet published
+  uint32_t freeCached;
+  uint32_t epoch;     // rollover count of the newest staged frame
+};
+
+// Consumer-side rollover reconstruction state
+struct RingEpoch {
+  bool seeded;
+  uint32_t lastTick;
+  uint32_t epoch;
+};
+
+#if defined(__arm__) || defined(__aarch64__)
+  #define RING_DMB() __asm__ volatile("dmb 0xF" ::: "memory")
+#else
+  #define RING_DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+#ifndef RING_SEV
+  #if defined(__arm__) || defined(__aarch64__)
+    #define RING_SEV() __asm__ volatile("sev" ::: "memory")
+  #else
+    #define RING_SEV() do {} while (0)
+  #endif
+#endif
+
+// ---------------- Mirror index helpers ----------------
+static inline uint32_t ring_slot(uint32_t i, uint32_t cap) {
+  return i < cap ? i : i - cap;
+}
+
+static inline uint32_t ring_advance(uint32_t i, uint32_t n, uint32_t cap) {
+  i += n;
+  return i >= 2u * cap ? i - 2u * cap : i;
+}
+
+static inline uint32_t ring_count(uint32_t head, uint32_t tail, uint32_t cap) {
+  return head >= tail ? head - tail : head + 2u * cap - tail;
+}
+
+static inline void ring_init(SharedRing& r) {
+  r.capacity    = SHARED_RING_CAPACITY;
+  r.head        = 0;
+  r.tail        = 0;
+  r.overruns    = 0;
+  r.epoch       = 0;
+  r.frame_bytes = sizeof(RingFrame);
+  r.channels    = ANALOG_CHANNEL_COUNT;
+  r.notify_armed = 0;
+  r.notifies    = 0;
+  r.heartbeat   = 0;
+  r.adc_timeouts = 0;
+  r.adc_resets  = 0;
+  r.sampler_restarts = 0;
+  r.adc_mode    = 0;
+  memset(r.reserved, 0, sizeof(r.reserved));
+}
+
+// ---------------- Producer ----------------
+// S is the producer's unpacked sample (t_us, rollover_count, t_us_end,
+// rollover_count_end, raw[]).
+template <typename S>
+static inline void ring_stage(SharedRing& r, RingProducer& p, const S& s) {
+  const uint32_t cap = r.capacity;
+
+  if (p.pending == 0) {
+    // Start of a batch: follow the shared head (the ring may have been
+    // re-initialized by the other core)
+    p.head = r.head;
+    p.freeCached = 0;
+  }
+
+  if (p.freeCached == 0) {
+    const uint32_t tail = r.tail;
+    const uint32_t used = ring_count(p.head, tail, cap);
+    if (used >= cap) {
+      // Ring full: drop oldest by advancing tail, count overrun
+      r.tail = ring_advance(tail, 1, cap);
+      r.overruns++;
+      p.freeCached = 1;
+    } else {
+      p.freeCached = cap - used;
+    }
+  }
+
+  RingFrame& f = r.frames[ring_slot(p.head, cap)];
+  f.tick = s.t_us;
+  const uint32_t dur = s.t_us_end - s.t_us;  // modular, valid across a rollover
+  f.dur_us = dur > 0xFFFFu ? 0xFFFFu : (uint16_t)dur;
+  memcpy(f.raw, s.raw, sizeof(f.raw));
+
+  p.epoch = s.rollover_count;
+  p.head = ring_advance(p.head, 1, cap);
+  p.pending++;
+  p.freeCached--;
+}
+
+static inline void ring_publish(SharedRing& r, RingProducer& p) {
+  if (p.pending == 0) return;
+
+  if (r.epoch != p.epoch) r.epoch = p.epoch;
+
+  // Frames (and epoch) must be visible before the new head
+  RING_DMB();
+  r.head = p.head;
+  p.pending = 0;
+
+  // Head store must be ordered before reading the consumer's wake request
+  RING_DMB();
+  const uint32_t armed = r.notify_armed;
+  if (armed && Doorbell::shouldRing(armed, ring_count(p.head, r.tail, r.capacity))) {
+    r.notify_armed = 0;
+    r.notifies++;
+    RING_SEV();
+  }
+}
+
+template <typename S>
+static inline void ring_push(SharedRing& r, RingProducer& p, const S& s) {
+  ring_stage(r, p, s);
+  ring_publish(r, p);
+}
+
+template <typename S>
+static inline void ring_push_block(SharedRing& r, RingProducer& p, const S* s, size_t n) {
+  for (size_t i = 0; i < n; ++i) ring_stage(r, p, s[i]);
+  ring_publish(r, p);
+}
+
+// ---------------- Consumer ----------------
+template <typename S>
+static inline void ring_unpack(const RingFrame& f, RingEpoch& e, S& out) {
+  if (f.tick < e.lastTick) e.epoch++;
+  e.lastTick = f.tick;
+
+  out.t_us = f.tick;
+  out.rollover_count = e.epoch;
+  out.t_us_end = f.tick + f.dur_us;
+  out.rollover_count_end = e.epoch + (out.t_us_end < f.tick ? 1u : 0u);
+  memcpy(out.raw, f.raw, sizeof(f.raw));
+  out.flags = 0;
+  out.held = 0;
+}
+
+// Copies up to max_samples into out (if max_samples < 0, copy all available).
+// Returns the number of samples copied.
+template <typename S>
+static inline size_t ring_consume(SharedRing& r, RingEpoch& e, S* out, int32_t max_samples) {
+  const uint32_t cap = r.capacity;
+
+  // Snapshot producer head once; epoch is read after it so it is at least
+  // as new as the newest frame we take
+  const uint32_t head = r.head;
+  RING_DMB();
+  const uint32_t epoch = r.epoch;
+
+  const uint32_t tail = r.tail;
+  const uint32_t available = ring_count(head, tail, cap);
+  if (available == 0) return 0;
+
+  const uint32_t take = (max_samples < 0 || (uint32_t)max_samples > available)
+                          ? available : (uint32_t)max_samples;
+
+  // Copy out in two linear chunks if wrap splits the region
+  const uint32_t start = ring_slot(tail, cap);
+  const uint32_t first_chunk = take < cap - start ? take : cap - start;
+
+  if (!e.seeded) {
+    // Seed from the header: walk back from the header epoch by the number
+    // of rollovers inside the frames still in the ring
+    uint32_t wraps = 0;
+    uint32_t prev = r.frames[start].tick;
+    for (uint32_t i = 1; i < available; ++i) {
+      const uint32_t t = r.frames[ring_slot(ring_advance(tail, i, cap), cap)].tick;
+      if (t < prev) wraps++;
+      prev = t;
+    }
+    e.epoch = epoch - wraps;
+    e.lastTick = r.frames[start].tick;
+    e.seeded = true;
+  }
+
+  for (uint32_t i = 0; i < first_chunk; ++i) {
+    ring_unpack(r.frames[start + i], e, out[i]);
+  }
+  for (uint32_t i = first_chunk; i < take; ++i) {
+    ring_unpack(r.frames[i - first_chunk], e, out[i]);
+  }
+
+  // Publish new tail
+  RING_DMB();  // ensure reads complete before moving tail
+  r.tail = ring_advance(tail, take, cap);
+  return take;
+}
+
+// Frames published and not yet consumed
+static inline uint32_t ring_available(const SharedRing& r) {
+  return ring_count(r.head, r.tail, r.capacity);
+}
+
+// Request a RING_SEV() once the fill reaches `threshold` frames. Returns
+// false if it already has, in which case the caller must not sleep.
+static inline bool ring_arm_notify(SharedRing& r, uint32_t threshold) {
+  if (threshold == 0) threshold = 1;
+  r.notify_armed = threshold;
+  RING_DMB();  // arm store ordered before re-reading head
+  if (Doorbell::shouldRing(threshold, ring_available(r))) {
+    r.notify_armed = 0;
+    return false;
+  }
+  return true;
+}
+
+// Withdraw an arm after waking for another reason
+static inline void ring_disarm_notify(SharedRing& r) {
+  r.notify_armed = 0;
+}
+
+// ---------------- Health ----------------
+// Single writer (the producer), so plain increments are enough; the
+// consumer only samples the values for progress.
+static inline void ring_heartbeat(SharedRing& r) {
+  r.heartbeat++;
+}
+
+#endif // RING_FRAME_H
@@ -1,5 +1,10 @@
 #include "SampleCollector.h"
 #include "UdpManager.h"
+#include "Decimator.h"
+#include "SpectrumMonitor.h"
+#include "AcquisitionWatchdog.h"
+#include "TraceRecorder.h"
+#include "Config.h"
 #include "SDRAM.h"
 
 // Static member definitions
@@ -7,6 +12,12 @@ Sample* SampleCollector::ringBuffer = nullptr;
 volatile size_t SampleCollector::ringCapacity = 0;
 volatile size_t SampleCollector::ringHead = 0;
 volatile size_t SampleCollector::totalSamplesReceived = 0;
+uint64_t SampleCollector::lastSampleUs = 0;
+bool SampleCollector::haveLastSample = false;
+uint32_t SampleCollector::gapSamplesTotal = 0;
+
+// Nominal sample spacing, used to size gaps
+static const uint32_t SAMPLE_PERIOD_US = 1000000UL / Config::ANALOG_SAMPLE_FREQUENCY_HZ;
 
 volatile bool SampleCollector::gatheringActive = false;
 volatile int SampleCollector::gatheringStart = 0;
@@ -46,10 +57,20 @@ bool SampleCollector::init(size_t capacity) {
     }
     
     Serial.println("[SampleCollector] Ring buffer storage allocated successfully");
+
+    // Anti-aliasing pipelines for reduced-rate channels
+    Decimator::init();
+    Serial.print("[SampleCollector] Temperature decimated by ");
+    Serial.println(Decimator::getTotalFactor(CH_TEMP_1));
+
+    // Optional ripple/noise monitor (enabled by UDP command 0x30)
+    SpectrumMonitor::init();
     
     // Reset state
     ringHead = 0;
     totalSamplesReceived = 0;
+    haveLastSample = false;
+    gapSamplesTotal = 0;
     gatheringActive = false;
     gatheringStart = 0;
     gatheringStop = 0;
@@ -62,12 +83,48 @@ bool SampleCollector::init(size_t capacity) {
     return true;
 }
 
+// The pair skew in the schema comes from ADC_DUAL_SIMULTANEOUS; compare it
+// with the scan Core1 reports once it has started (REMC_ADC_DUAL_MODE)
+static bool s_adcModeChecked = false;
+
+static void checkAdcMode() {
+    SharedRingHealth health;
+    SharedRing_GetHealth(health);
+    if (health.adc_mode == 0) return;
+    s_adcModeChecked = true;
+
+    const uint32_t expected = ADC_DUAL_SIMULTANEOUS ? RING_ADC_MODE_DUAL : RING_ADC_MODE_SEQUENTIAL;
+    if (health.adc_mode != expected) {
+        Serial.print("[SampleCollector] ERROR: Core1 runs the ");
+        Serial.print(health.adc_mode == RING_ADC_MODE_DUAL ? "dual simultaneous" : "sequential");
+        Serial.print(" ADC scan but ADC_DUAL_SIMULTANEOUS is ");
+        Serial.print(ADC_DUAL_SIMULTANEOUS);
+        Serial.println("; the schema skew is wrong (match REMC_ADC_DUAL_MODE in the Core1 sketch)");
+    }
+}
+
 void SampleCollector::update() {
+    if (!s_adcModeChecked) {
+        checkAdcMode();
+    }
     
     // Always consume samples from SharedRing (Core1 never stops sampling)
     size_t count = SharedRing_Consume(sampleBuffer, MAX_FETCH);
     if (count > 0) {
 
+        // Trace the frames exactly as consumed (Decimator works in place)
+        TraceRecorder::recordSamples(sampleBuffer, count);
+
+        // Filter slow channels in place before they are stored or sent
+        Decimator::processBlock(sampleBuffer, count);
+
+        // Spectral summaries go out as their own low-rate packets
+        SpectrumMonitor::processBlock(sampleBuffer, count);
+        SpectrumMonitor::Summary summary;
+        while (SpectrumMonitor::popSummary(summary)) {
+            UdpManager::sendSpectralSummary(summary);
+        }
+
         for (size_t i = 0; i < count; i++) {
             storeSampleInRing(sampleBuffer[i]);
         }
@@ -80,6 +137,16 @@ void SampleCollector::update() {
 }
 
 void SampleCollector::storeSampleInRing(const Sample& sample) {
+    // Samples lost upstream (Core1 stall, ADC timeouts, ring overruns) show
+    // up as a timestamp jump; reserve their indices before this sample
+    const uint64_t us = ((uint64_t)sample.rollover_count << 32) | sample.t_us;
+    if (haveLastSample) {
+        const uint32_t missing = AcquisitionWatchdog::missingSamples(lastSampleUs, us, SAMPLE_PERIOD_US);
+        if (missing > 0) markGap(lastSampleUs, missing);
+    }
+    lastSampleUs = us;
+    haveLastSample = true;
+
     // Store sample in ring buffer at current head position
     ringBuffer[ringHead] = sample;
     
@@ -90,6 +157,55 @@ void SampleCollector::storeSampleInRing(const Sample& sample) {
     totalSamplesReceived++;
 }
 
+void SampleCollector::markGap(uint64_t prevUs, uint32_t missing) {
+    const size_t gapStartIndex = totalSamplesReceived;
+
+    // Only the newest ringCapacity markers can survive; skip the rest
+    const uint32_t written = missing > ringCapacity ? (uint32_t)ringCapacity : missing;
+    const uint32_t skipped = missing - written;
+    ringHead = (ringHead + skipped) % ringCapacity;
+    totalSamplesReceived += skipped;
+
+    Sample marker = {};
+    marker.flags = SAMPLE_FLAG_GAP;
+    for (uint32_t i = 0; i < written; i++) {
+        const uint64_t t = prevUs + (uint64_t)(skipped + i + 1) * SAMPLE_PERIOD_US;
+        marker.t_us = (uint32_t)t;
+        marker.rollover_count = (uint32_t)(t >> 32);
+        marker.t_us_end = marker.t_us;
+        marker.rollover_count_end = marker.rollover_count;
+        ringBuffer[ringHead] = marker;
+        ringHead = (ringHead + 1) % ringCapacity;
+        totalSamplesReceived++;
+    }
+    gapSamplesTotal += missing;
+
+    Serial.print("[SampleCollector] GAP: ");
+    Serial.print(missing);
+    Serial.print(" samples missing, marked from index ");
+    Serial.println((unsigned long)gapStartIndex);
+
+    // Report where the gap sits in the index space
+    SharedRingHealth health;
+    SharedRing_GetHealth(health);
+    const uint64_t gapStartUs = prevUs + SAMPLE_PERIOD_US;
+    AcquisitionWatchdog::Event event = {};
+    event.type = AcquisitionWatchdog::EVENT_GAP;
+    event.state = AcquisitionWatchdog::getStatus().state;
+    event.fault = AcquisitionWatchdog::getStatus().fault;
+    event.head = health.head;
+    event.heartbeat = health.heartbeat;
+    event.overruns = health.overruns;
+    event.adcTimeouts = health.adc_timeouts;
+    event.adcResetsTotal = health.adc_resets;
+    event.samplerRestartsTotal = health.sampler_restarts;
+    event.gapStartIndex = gapStartIndex;
+    event.gapSamples = missing;
+    event.t_us = (uint32_t)gapStartUs;
+    event.rollover_count = (uint32_t)(gapStartUs >> 32);
+    UdpManager::sendFaultEvent(event);
+}
+
 void SampleCollector::startGathering(int start, int stop) {
     Serial.print("[SampleCollector] Starting sample gathering - start: ");
     Serial.print(start);
@@ -286,6 +402,10 @@ size_t SampleCollector::getStorageCapacity() {
     return ringCapacity;
 }
 
+uint32_t SampleCollector::getGapSamples() {
+    return gapSamplesTotal;
+}
+
 bool SampleCollector::canSendNow() {
     // If stop is <= 0, all samples are historical, we can send immediately
     if (gatheringStop <= 0) {
@@ -26,6 +26,7 @@ public:
     static size_t getSamplesStored();
     static bool isGathering();
     static size_t getStorageCapacity();
+    static uint32_t getGapSamples();  // samples marked missing since init
     
     // Debug functions
     static void printSampleDiagnostics(size_t count);
@@ -37,6 +38,12 @@ private:
     static volatile size_t ringHead;
     static volatile size_t totalSamplesReceived;
     
+    // Gap tracking: missing samples still take their slot in the index
+    // space, stored with SAMPLE_FLAG_GAP so relative indices stay on time
+    static uint64_t lastSampleUs;
+    static bool haveLastSample;
+    static uint32_t gapSamplesTotal;
+    
     // Gathering state
     static volatile bool gatheringActive;
     static volatile int gatheringStart;
@@ -61,6 +68,7 @@ private:
     
     // Helper functions
     static void storeSampleInRing(const Sample& sample);
+    static void markGap(uint64_t prevUs, uint32_t missing);
     static void extractRequestedSamples();
     static size_t getRingIndex(int relativeIndex, size_t referenceSampleCount);
     static bool canSendNow();
@@ -1,39 +1,68 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include "RingFrame.h"
 
-// Force a consistent layout: 4-byte aligned, no packing shenanigans
+// Unpacked sample as seen by the firmware on either side of the ring
+// (the ring itself carries packed RingFrames, see RingFrame.h).
+// Force a consistent layout: 4-byte aligned, no packing shenanigans.
+// One raw slot per ChannelTable.h entry, indexed by AnalogChannel.
 struct __attribute__((aligned(4))) Sample {
   uint32_t t_us;
   uint32_t rollover_count;
   uint32_t t_us_end;      
   uint32_t rollover_count_end;
-  uint16_t swI, swV, outA, outB, t1; // 5 * 2 = 10 bytes
-  uint16_t _pad;      
+  uint16_t raw[ANALOG_CHANNEL_COUNT]; // 5 * 2 = 10 bytes
+  uint8_t  flags;                     // SAMPLE_FLAG_*, 0 off the ring
+  uint8_t  held;                      // bit ch: raw[ch] is not data (decimated channel between outputs), 0 off the ring
 };
 
-static_assert(sizeof(Sample) == 28, "Sample must be 28 bytes");
-static_assert(alignof(Sample) == 4, "Sample align must be 4");
+// Sample::flags
+static constexpr uint8_t SAMPLE_FLAG_GAP = 0x01;  // stands in for a lost sample; raw[] is not data
 
-// Choose a power-of-two capacity for fast masking
-#ifndef SHARED_RING_CAPACITY
-#define SHARED_RING_CAPACITY 1024u
-#endif
-
-struct __attribute__((aligned(32))) SharedRing {
-  uint32_t capacity;         // frames capacity (power of two)
-  uint32_t head;    // producer writes frames, then increments head
-  uint32_t tail;    // consumer reads frames, then increments tail
-  uint32_t overruns;// producer increments when overwriting
-  Sample samples[SHARED_RING_CAPACITY];
-};
+// Sample::held: one bit per AnalogChannel
+static_assert(ANALOG_CHANNEL_COUNT <= 8, "Sample::held has one bit per channel");
 
+static_assert(sizeof(Sample) == 16 + ((2 * ANALOG_CHANNEL_COUNT + 2 + 3) & ~3u), "Sample layout must follow ChannelTable");
+static_assert(alignof(Sample) == 4, "Sample align must be 4");
 
 extern SharedRing& g_ring;
 void SharedRing_Init();
 
-// Add a sample to the ring buffer
+// ---- Producer (Core1) ----
+// Stage a sample; published every SHARED_RING_PUBLISH_EVERY samples (RingFrame.h)
 void  SharedRing_Add(const Sample& sample);
+// Stage a block of samples and publish once
+void  SharedRing_AddBlock(const Sample* samples, size_t count);
+// Publish anything staged but not yet visible to the consumer
+void  SharedRing_Flush();
+// Health counters read by the CM7 watchdog (see RingFrame.h)
+void  SharedRing_Heartbeat();
+void  SharedRing_NoteAdcTimeout();
+void  SharedRing_NoteAdcReset();
+void  SharedRing_NoteSamplerRestart();
+// ADC scan the sampler runs (RING_ADC_MODE_*), set once after init
+void  SharedRing_SetAdcMode(uint32_t mode);
+
+// ---- Consumer (Core0) ----
+// Samples published and not yet consumed
+size_t SharedRing_Available();
+// Ask the producer for a SEV once `threshold` frames are waiting, before
+// sleeping in WFE. Returns false if they already are (do not sleep).
+bool  SharedRing_ArmNotify(uint32_t threshold);
+void  SharedRing_DisarmNotify();
+
+// Snapshot of the producer's progress and health counters
+struct SharedRingHealth {
+  uint32_t head;
+  uint32_t heartbeat;
+  uint32_t overruns;
+  uint32_t adc_timeouts;
+  uint32_t adc_resets;
+  uint32_t sampler_restarts;
+  uint32_t adc_mode;        // RING_ADC_MODE_*, 0 until Core1 reports it
+};
+void  SharedRing_GetHealth(SharedRingHealth& out);
 
 // Copies up to max_samples into out (if max_samples < 0, copy all available).
 // Returns the number of samples copied.
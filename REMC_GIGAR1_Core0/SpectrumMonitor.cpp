@@ -0,0 +1,268 @@
+#include "SpectrumMonitor.h"
+#include "SharedRing.h"  // For Sample struct definition only
+#include <math.h>
+#include <string.h>
+
+#if defined(REMC_USE_CMSIS_DSP)
+#include "arm_math.h"
+#endif
+
+// No fused multiply-adds, whatever the build flags: the M7 has VFMA and GCC
+// contracts by default, the host usually has none, and fusing changes the
+// rounding. With it off the portable path gives the same bits on both.
+#pragma GCC optimize("fp-contract=off")
+
+static_assert((SPECTRUM_FFT_SIZE & (SPECTRUM_FFT_SIZE - 1)) == 0 && SPECTRUM_FFT_SIZE >= 16,
+              "SPECTRUM_FFT_SIZE must be a power of two >= 16");
+
+namespace {
+
+const size_t N = SPECTRUM_FFT_SIZE;
+const size_t M = SPECTRUM_FFT_SIZE / 2;     // complex FFT length
+const uint8_t QUEUE_LEN = 2 * SpectrumMonitor::NUM_CHANNELS;
+
+// Monitored channels (voltage rails)
+const AnalogChannel kChannels[SpectrumMonitor::NUM_CHANNELS] = {
+  CH_SWITCH_VOLTAGE, CH_OUTPUT_VOLTAGE_A, CH_OUTPUT_VOLTAGE_B
+};
+
+bool s_enabled = false;
+bool s_tablesReady = false;
+
+float s_window[N];
+float s_windowPowerNorm = 1.0f;   // 2 / (N * sum(w^2))
+float s_cos[M];                   // cos(2*pi*k/N), k < N/2
+float s_sin[M];                   // sin(2*pi*k/N)
+
+float s_input[SpectrumMonitor::NUM_CHANNELS][N];
+float s_power[M + 1];
+size_t s_fill = 0;
+uint32_t s_blockCounter = 0;
+
+SpectrumMonitor::Summary s_queue[QUEUE_LEN];
+uint8_t s_queueHead = 0;
+uint8_t s_queueCount = 0;
+
+#if defined(REMC_USE_CMSIS_DSP)
+arm_rfft_fast_instance_f32 s_rfft;
+float s_scratch[N];
+#endif
+
+// The tables are computed in double and rounded to float once. newlib's and
+// glibc's cos/sin differ by an ulp of double at most, and no entry lies that
+// close to a float rounding boundary (spectrum_monitor_bench checks the
+// margin), so both round to the same floats where cosf/sinf would not.
+void buildTables() {
+  double sumSq = 0.0;
+  for (size_t n = 0; n < N; ++n) {
+    // Periodic Hann
+    s_window[n] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * (double)n / (double)N));
+    sumSq += (double)s_window[n] * (double)s_window[n];
+  }
+  s_windowPowerNorm = (float)(2.0 / ((double)N * sumSq));
+
+  for (size_t k = 0; k < M; ++k) {
+    s_cos[k] = (float)cos(2.0 * M_PI * (double)k / (double)N);
+    s_sin[k] = (float)sin(2.0 * M_PI * (double)k / (double)N);
+  }
+
+#if defined(REMC_USE_CMSIS_DSP)
+  arm_rfft_fast_init_f32(&s_rfft, N);
+#endif
+  s_tablesReady = true;
+}
+
+#if !defined(REMC_USE_CMSIS_DSP)
+// In-place iterative radix-2 complex FFT of length M on interleaved re/im.
+// Twiddles for length M are every other entry of the length-N tables.
+void fftComplexM(float* z) {
+  // Bit-reversal permutation
+  for (size_t i = 1, j = 0; i < M; ++i) {
+    size_t bit = M >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float tr = z[2 * i], ti = z[2 * i + 1];
+      z[2 * i] = z[2 * j];         z[2 * i + 1] = z[2 * j + 1];
+      z[2 * j] = tr;               z[2 * j + 1] = ti;
+    }
+  }
+
+  for (size_t len = 2; len <= M; len <<= 1) {
+    const size_t half = len >> 1;
+    const size_t step = (N / len);  // index into the length-N tables
+    for (size_t base = 0; base < M; base += len) {
+      for (size_t k = 0; k < half; ++k) {
+        const float wr = s_cos[k * step];
+        const float wi = -s_sin[k * step];
+        float* a = &z[2 * (base + k)];
+        float* b = &z[2 * (base + k + half)];
+        const float tr = b[0] * wr - b[1] * wi;
+        const float ti = b[0] * wi + b[1] * wr;
+        b[0] = a[0] - tr;  b[1] = a[1] - ti;
+        a[0] = a[0] + tr;  a[1] = a[1] + ti;
+      }
+    }
+  }
+}
+
+// Real FFT of N points in `x` via one M-point complex FFT; writes
+// |X[k]|^2 for k = 0..M into `power`.
+void realFftPower(float* x, float* power) {
+  fftComplexM(x);  // x[2k] + i*x[2k+1] already interleaved
+
+  // DC and Nyquist come from Z[0]
+  power[0] = (x[0] + x[1]) * (x[0] + x[1]);
+  power[M] = (x[0] - x[1]) * (x[0] - x[1]);
+
+  for (size_t k = 1; k < M; ++k) {
+    const float zr = x[2 * k],       zi = x[2 * k + 1];
+    const float cr = x[2 * (M - k)], ci = -x[2 * (M - k) + 1];  // conj(Z[M-k])
+
+    const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);   // even part
+    const float dr = 0.5f * (zr - cr), di = 0.5f * (zi - ci);   // odd part (times i)
+
+    // X[k] = E - i * W^k * D, W^k = cos - i sin
+    const float wr = s_cos[k], wi = -s_sin[k];
+    const float tr = wr * dr - wi * di;
+    const float ti = wr * di + wi * dr;
+    const float xr = er + ti;
+    const float xi = ei - tr;
+    power[k] = xr * xr + xi * xi;
+  }
+}
+#endif
+
+}
+
+namespace SpectrumMonitor {
+
+void init() {
+  if (!s_tablesReady) buildTables();
+  s_fill = 0;
+  s_blockCounter = 0;
+  s_queueHead = 0;
+  s_queueCount = 0;
+}
+
+void enable() {
+  if (!s_tablesReady) buildTables();
+  s_fill = 0;
+  s_blockCounter = 0;
+  s_enabled = true;
+}
+
+void disable() {
+  s_enabled = false;
+}
+
+bool isEnabled() {
+  return s_enabled;
+}
+
+void analyze(float* block, Summary& out) {
+  if (!s_tablesReady) buildTables();
+
+  // Remove DC, then window
+  float mean = 0.0f;
+  for (size_t n = 0; n < N; ++n) mean += block[n];
+  mean /= (float)N;
+  for (size_t n = 0; n < N; ++n) block[n] = (block[n] - mean) * s_window[n];
+
+#if defined(REMC_USE_CMSIS_DSP)
+  arm_rfft_fast_f32(&s_rfft, block, s_scratch, 0);
+  // Packed output: [X0.re, X(N/2).re, X1.re, X1.im, ...]
+  s_power[0] = s_scratch[0] * s_scratch[0];
+  s_power[M] = s_scratch[1] * s_scratch[1];
+  for (size_t k = 1; k < M; ++k) {
+    s_power[k] = s_scratch[2 * k] * s_scratch[2 * k] + s_scratch[2 * k + 1] * s_scratch[2 * k + 1];
+  }
+#else
+  realFftPower(block, s_power);
+#endif
+
+  // One-sided, window-compensated: sum over bins == mean-square of the block
+  float total = 0.0f;
+  s_power[0] *= 0.5f * s_windowPowerNorm;
+  s_power[M] *= 0.5f * s_windowPowerNorm;
+  for (size_t k = 1; k < M; ++k) s_power[k] *= s_windowPowerNorm;
+  for (size_t k = 1; k <= M; ++k) total += s_power[k];
+
+  out.fftSize = (uint16_t)N;
+  out.binHz = SPECTRUM_SAMPLE_RATE_HZ / (float)N;
+  out.meanCounts = mean;
+  out.rmsCounts = sqrtf(total);
+
+  // Band powers
+  for (uint8_t b = 0; b < NUM_BANDS; ++b) {
+    size_t lo = (size_t)ceilf(BAND_EDGES_HZ[b] / out.binHz);
+    size_t hi = (size_t)ceilf(BAND_EDGES_HZ[b + 1] / out.binHz);
+    if (lo < 1) lo = 1;          // DC was removed
+    if (hi > M + 1) hi = M + 1;
+    float p = 0.0f;
+    for (size_t k = lo; k < hi; ++k) p += s_power[k];
+    out.bandPower[b] = p;
+  }
+
+  // Strongest local maxima (insertion into a tiny sorted list)
+  out.numPeaks = 0;
+  for (size_t k = 1; k < M; ++k) {
+    const float p = s_power[k];
+    if (p <= s_power[k - 1] || p < s_power[k + 1]) continue;
+    if (out.numPeaks == MAX_PEAKS && p <= out.peaks[MAX_PEAKS - 1].power) continue;
+
+    uint8_t pos = out.numPeaks < MAX_PEAKS ? out.numPeaks++ : MAX_PEAKS - 1;
+    while (pos > 0 && out.peaks[pos - 1].power < p) {
+      out.peaks[pos] = out.peaks[pos - 1];
+      --pos;
+    }
+    out.peaks[pos].bin = (uint16_t)k;
+    out.peaks[pos].power = p;
+  }
+}
+
+void processBlock(const Sample* samples, size_t count) {
+  if (!s_enabled || !samples) return;
+
+  for (size_t i = 0; i < count; ++i) {
+    // Only every SPECTRUM_INTERVAL_BLOCKS-th block is captured
+    if (s_blockCounter % SPECTRUM_INTERVAL_BLOCKS == 0) {
+      for (uint8_t c = 0; c < NUM_CHANNELS; ++c) {
+        s_input[c][s_fill] = (float)samples[i].raw[kChannels[c]];
+      }
+    }
+
+    if (++s_fill < N) continue;
+    s_fill = 0;
+
+    if (s_blockCounter++ % SPECTRUM_INTERVAL_BLOCKS != 0) continue;
+
+    for (uint8_t c = 0; c < NUM_CHANNELS; ++c) {
+      uint8_t slot;
+      if (s_queueCount < QUEUE_LEN) {
+        slot = (uint8_t)((s_queueHead + s_queueCount++) % QUEUE_LEN);
+      } else {
+        // Queue full: overwrite the oldest summary
+        slot = s_queueHead;
+        s_queueHead = (uint8_t)((s_queueHead + 1) % QUEUE_LEN);
+      }
+
+      Summary& sum = s_queue[slot];
+      memset(&sum, 0, sizeof(sum));
+      sum.channel = kChannels[c];
+      sum.t_us = samples[i].t_us;
+      sum.rollover_count = samples[i].rollover_count;
+      analyze(s_input[c], sum);
+    }
+  }
+}
+
+bool popSummary(Summary& out) {
+  if (s_queueCount == 0) return false;
+  out = s_queue[s_queueHead];
+  s_queueHead = (uint8_t)((s_queueHead + 1) % QUEUE_LEN);
+  s_queueCount--;
+  return true;
+}
+
+}  // namespace SpectrumMonitor
@@ -0,0 +1,92 @@
+/*
+  ---------------------------------------------------------------------------
+  SpectrumMonitor – On-Device Ripple / Noise Spectral Summary (CM7)
+  ---------------------------------------------------------------------------
+
+  Optional monitor that turns blocks of the voltage channels (swV, outA,
+  outB) into a compact spectral summary so supply ripple and EMI pickup
+  are visible continuously without exporting raw data.
+
+  For each monitored channel, every SPECTRUM_FFT_SIZE samples:
+    1. Remove the block mean and apply a periodic Hann window.
+    2. Real FFT (N/2-point complex FFT + split). CMSIS-DSP arm_rfft_fast_f32
+       is used on target when REMC_USE_CMSIS_DSP is defined; otherwise the
+       portable radix-2 implementation in this file runs.
+    3. One-sided power per bin, normalized so the bin powers sum to the
+       block's mean-square (raw counts^2).
+    4. Report the strongest local-maximum bins and the power in each of
+       the configured frequency bands.
+
+  Summaries are queued and drained by SampleCollector, which sends them as
+  low-rate spectral packets (FLAGS_SPECTRAL) through UdpManager.
+
+  This file has no Arduino dependencies. Built without REMC_USE_CMSIS_DSP,
+  the host runs the firmware's portable path bit for bit: the window and
+  twiddle tables are rounded once from double, and the file turns off FMA
+  contraction itself. host_bench/spectrum_monitor_bench checks golden
+  summary bytes and a double-precision DFT. The CMSIS-DSP path rounds
+  differently and only agrees to rounding.
+  ---------------------------------------------------------------------------
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+struct Sample;
+
+// ================== SPECTRUM CONFIGURATION ==================
+#ifndef SPECTRUM_FFT_SIZE
+  #define SPECTRUM_FFT_SIZE        1024  // power of two, 102.4 ms @ 10 kHz
+#endif
+#ifndef SPECTRUM_INTERVAL_BLOCKS
+  #define SPECTRUM_INTERVAL_BLOCKS 10    // analyze 1 of every N blocks (~1 Hz)
+#endif
+#ifndef SPECTRUM_SAMPLE_RATE_HZ
+  #define SPECTRUM_SAMPLE_RATE_HZ  10000.0f
+#endif
+// =============================================================
+
+namespace SpectrumMonitor {
+
+  static const uint8_t MAX_PEAKS = 4;
+  static const uint8_t NUM_BANDS = 4;
+  static const uint8_t NUM_CHANNELS = 3;
+
+  // Band edges in Hz: [edge[i], edge[i+1])
+  static const float BAND_EDGES_HZ[NUM_BANDS + 1] = { 0.0f, 50.0f, 500.0f, 2000.0f, 5000.0f };
+
+  struct Peak {
+    uint16_t bin;
+    float power;        // counts^2
+  };
+
+  struct Summary {
+    uint8_t channel;    // AnalogChannel (ChannelTable.h index)
+    uint8_t numPeaks;
+    uint16_t fftSize;
+    float binHz;
+    float meanCounts;   // removed DC component
+    float rmsCounts;    // AC RMS over the block
+    uint32_t t_us;      // timestamp of the block's last sample
+    uint32_t rollover_count;
+    Peak peaks[MAX_PEAKS];
+    float bandPower[NUM_BANDS];
+  };
+
+  void init();
+
+  void enable();
+  void disable();
+  bool isEnabled();
+
+  // Accumulate samples (call on every SharedRing block); no-op when disabled
+  void processBlock(const Sample* samples, size_t count);
+
+  // Pop the oldest pending summary; returns false when none are queued
+  bool popSummary(Summary& out);
+
+  // Portable analysis kernel: `block` holds SPECTRUM_FFT_SIZE raw values and
+  // is overwritten. Exposed so the host build can run the same math.
+  void analyze(float* block, Summary& out);
+}
@@ -78,6 +78,12 @@ bool TimeMapper::begin() {
     return true;
 }
 
+void TimeMapper::beginBeacons(EthernetUDP* udp) {
+    _beaconUdp = udp;
+    _beacons.reset();
+    Serial.println("[TimeMapper] Listening for time beacons");
+}
+
 bool TimeMapper::syncNTPInstance(uint16_t timeout_ms) {
     if (!_initialized) {
         Serial.println("[TimeMapper] ERROR: Not initialized");
@@ -93,6 +99,11 @@ bool TimeMapper::syncNTPInstance(uint16_t timeout_ms) {
         updateMapping();
         _syncCount++;
         _lastAutoSyncMillis = millis();
+        // Beacons are one-way; half the best round trip stands in for the path delay
+        uint32_t rtt = NTPClient::lastRttUs();
+        if (rtt != 0 && (_beaconRttUs == 0 || rtt < _beaconRttUs)) {
+            _beaconRttUs = rtt;
+        }
         Serial.println("[TimeMapper] NTP sync successful, mapping updated");
     } else {
         Serial.println("[TimeMapper] NTP sync failed");
@@ -128,6 +139,9 @@ void TimeMapper::updateMapping() {
 }
 
 uint64_t TimeMapper::hardwareToNTPInstance(uint64_t hardwareMicros) const {
+    if (beaconLocked()) {
+        return _beacons.toHost(hardwareMicros);
+    }
     if (!_hasMappingData) {
         Serial.println("[TimeMapper] WARNING: No mapping data available");
         return 0;
@@ -144,6 +158,9 @@ uint64_t TimeMapper::hardwareToNTPInstance(uint64_t hardwareMicros) const {
 }
 
 uint64_t TimeMapper::ntpToHardwareInstance(uint64_t ntpMicros) const {
+    if (beaconLocked()) {
+        return _beacons.toHardware(ntpMicros);
+    }
     if (!_hasMappingData) {
         Serial.println("[TimeMapper] WARNING: No mapping data available");
         return 0;
@@ -159,7 +176,7 @@ uint64_t TimeMapper::ntpToHardwareInstance(uint64_t ntpMicros) const {
 }
 
 bool TimeMapper::isReadyInstance() const {
-    return _initialized && _hasMappingData;
+    return _initialized && (_hasMappingData || beaconLocked());
 }
 
 void TimeMapper::updateInstance() {
@@ -167,14 +184,71 @@ void TimeMapper::updateInstance() {
         return;
     }
     
-    // Check if we need to auto-sync
     uint32_t currentMillis = millis();
+    if (_beaconUdp) {
+        pollBeacons();
+        if (_beacons.locked() && currentMillis - _lastBeaconMillis >= BEACON_STALE_MS) {
+            Serial.println("[TimeMapper] Beacons lost, back to NTP polling");
+            _beacons.reset();
+            _lastAutoSyncMillis = currentMillis - AUTO_SYNC_INTERVAL_MS;   // sync now
+        }
+        if (_beacons.locked()) {
+            return;
+        }
+    }
+
+    // Check if we need to auto-sync
     if (currentMillis - _lastAutoSyncMillis >= AUTO_SYNC_INTERVAL_MS) {
         Serial.println("[TimeMapper] Auto-sync triggered");
         syncNTPInstance();
     }
 }
 
+void TimeMapper::pollBeacons() {
+    // Beacons queue on the NTP socket between loop iterations; the first is
+    // stamped closest to its arrival, the filter sorts out the rest
+    for (uint8_t n = 0; n < BEACON_DRAIN_MAX; n++) {
+        int size = _beaconUdp->parsePacket();
+        if (size <= 0) {
+            return;
+        }
+        uint64_t hw = HardwareTimer::getMicros64();
+
+        uint8_t buf[48];
+        if (size < (int)sizeof(buf) || _beaconUdp->read(buf, sizeof(buf)) != (int)sizeof(buf)) {
+            continue;
+        }
+        if ((buf[0] & 0x07) != 5) {   // broadcast mode only; a stray unicast reply is stale anyway
+            continue;
+        }
+        uint64_t transmit = 0;
+        for (int i = 0; i < 8; i++) {
+            transmit = (transmit << 8) | buf[40 + i];
+        }
+        if ((uint32_t)(transmit >> 32) < 2208988800UL + 946684800UL) {   // before 2000: no clock
+            continue;
+        }
+
+        uint64_t host = NTPClient::ntpToUnixMicros(transmit) + _beaconRttUs / 2;
+        bool wasLocked = _beacons.locked();
+        BeaconFilter::Result r = _beacons.add(hw, host);
+        if (r == BeaconFilter::BEACON_OUTLIER) {
+            continue;
+        }
+        _lastBeaconMillis = millis();
+        if (r == BeaconFilter::FILTER_RESET) {
+            Serial.println("[TimeMapper] Host clock stepped, beacon filter restarted");
+            _lastAutoSyncMillis = _lastBeaconMillis - AUTO_SYNC_INTERVAL_MS;   // cover the gap by unicast
+        } else if (r == BeaconFilter::WINDOW_CLOSED) {
+            _lastSyncMillis = _lastBeaconMillis;
+            _lastSyncNTPTime = _beacons.toHost(hw);
+            if (!wasLocked) {
+                Serial.println("[TimeMapper] Locked to time beacons, NTP polling paused");
+            }
+        }
+    }
+}
+
 uint64_t TimeMapper::getTimeSinceLastSync() const {
     if (!_hasMappingData) {
         return 0;
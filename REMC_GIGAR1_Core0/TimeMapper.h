@@ -13,6 +13,9 @@
     - Automatic NTP re-synchronization management
     - Thread-safe singleton pattern for global access
     - Handles time drift compensation between sync periods
+    - Optional passive discipline from the host's multicast time beacons
+      (BeaconFilter): while beacons arrive the mapping follows them, skew
+      included, and the unicast NTP polling stops
 
   Usage:
     TimeMapper::getInstance().begin();
@@ -26,6 +29,9 @@
     // Force NTP sync
     TimeMapper::getInstance().syncNTP();
 
+    // Listen for beacons on the NTP group socket (after begin())
+    TimeMapper::getInstance().beginBeacons(UdpManager::getNTPUdpObject());
+
   The class automatically handles the offset calculation between the two
   time systems and maintains accuracy across NTP re-synchronization events.
   ---------------------------------------------------------------------------
@@ -35,6 +41,7 @@
 #include <Arduino.h>
 #include "HardwareTimer.h"
 #include "NTPClient.h"
+#include "BeaconFilter.h"
 
 class TimeMapper {
 public:
@@ -54,6 +61,7 @@ public:
     
     // Instance methods
     bool begin();
+    void beginBeacons(EthernetUDP* udp);
     bool syncNTPInstance(uint16_t timeout_ms = 1000);
     uint64_t hardwareToNTPInstance(uint64_t hardwareMicros) const;
     uint64_t ntpToHardwareInstance(uint64_t ntpMicros) const;
@@ -64,6 +72,8 @@ public:
     uint32_t getSyncCount() const { return _syncCount; }
     uint64_t getLastSyncTime() const { return _lastSyncNTPTime; }
     uint64_t getTimeSinceLastSync() const;
+    bool beaconLocked() const { return _beaconUdp != nullptr && _beacons.locked(); }
+    const BeaconFilter& getBeaconFilter() const { return _beacons; }
     
 private:
     TimeMapper() = default;
@@ -72,6 +82,7 @@ private:
     TimeMapper& operator=(const TimeMapper&) = delete;
     
     void updateMapping();
+    void pollBeacons();
     
     // Singleton instance
     static TimeMapper* _instance;
@@ -92,4 +103,12 @@ private:
     // Auto-sync configuration
     static const uint32_t AUTO_SYNC_INTERVAL_MS = 10000; // 10 seconds
     uint32_t _lastAutoSyncMillis = 0;
+
+    // Beacon discipline
+    static const uint32_t BEACON_STALE_MS = 5000;       // no beacon this long: back to polling
+    static const uint8_t BEACON_DRAIN_MAX = 8;          // packets read per update
+    BeaconFilter _beacons;
+    EthernetUDP* _beaconUdp = nullptr;
+    uint32_t _lastBeaconMillis = 0;
+    uint32_t _beaconRttUs = 0;                          // shortest unicast round trip seen
 };
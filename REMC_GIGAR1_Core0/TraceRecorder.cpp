@@ -0,0 +1,170 @@
+#include "TraceRecorder.h"
+#include <Arduino.h>
+#include "SharedRing.h"
+#include "UdpManager.h"
+#include "HardwareTimer.h"
+#include "Config.h"
+#include <string.h>
+
+namespace {
+
+uint8_t s_buf[TRACE_PAYLOAD_BYTES];
+size_t s_len = 0;
+uint16_t s_records = 0;
+
+bool s_enabled = false;
+uint32_t s_seq = 0;
+uint32_t s_packetsSent = 0;
+uint32_t s_recordsWritten = 0;
+
+uint32_t s_iteration = 0;
+bool s_loopPending = false;   // LOOP record not yet written for this iteration
+uint64_t s_loopUs = 0;
+SharedRingHealth s_loopHealth;
+uint32_t s_loopAvailable = 0;
+
+static const size_t LOOP_BODY_BYTES = 4 + 8 + 4 + 4 + 4;
+static const size_t START_BODY_BYTES = 2 + 1 + 1 + 4 + 4;
+static const size_t STOP_BODY_BYTES = 4 + 4;
+static const size_t SAMPLES_BODY_HEADER = 4;
+
+inline uint8_t* put16(uint8_t* d, uint16_t v) { memcpy(d, &v, 2); return d + 2; }
+inline uint8_t* put32(uint8_t* d, uint32_t v) { memcpy(d, &v, 4); return d + 4; }
+inline uint8_t* put64(uint8_t* d, uint64_t v) { memcpy(d, &v, 8); return d + 8; }
+
+void resetPacket() {
+  s_len = TraceRecorder::PACKET_HEADER_BYTES;
+  s_records = 0;
+}
+
+void sendPacket() {
+  if (s_records == 0) return;
+  uint8_t* d = s_buf;
+  d = put32(d, s_seq++);
+  d = put16(d, s_records);
+  put16(d, TraceRecorder::TRACE_VERSION);
+  UdpManager::sendTracePacket(s_buf, s_len);
+  s_packetsSent++;
+  resetPacket();
+}
+
+// Reserve a record of `bodyLen` bytes, sending the current packet first if
+// it does not fit; returns a pointer to the body
+uint8_t* beginRecord(TraceRecorder::RecordType type, size_t bodyLen) {
+  if (s_len + TraceRecorder::RECORD_HEADER_BYTES + bodyLen > sizeof(s_buf)) sendPacket();
+  uint8_t* d = s_buf + s_len;
+  *d++ = type;
+  *d++ = 0;
+  d = put16(d, (uint16_t)bodyLen);
+  s_len += TraceRecorder::RECORD_HEADER_BYTES + bodyLen;
+  s_records++;
+  s_recordsWritten++;
+  return d;
+}
+
+void writeLoopRecord() {
+  if (!s_loopPending) return;
+  s_loopPending = false;
+  uint8_t* d = beginRecord(TraceRecorder::TRACE_LOOP, LOOP_BODY_BYTES);
+  d = put32(d, s_iteration);
+  d = put64(d, s_loopUs);
+  d = put32(d, s_loopAvailable);
+  d = put32(d, s_loopHealth.overruns);
+  put32(d, s_loopHealth.heartbeat);
+}
+
+}
+
+namespace TraceRecorder {
+
+void init() {
+  s_enabled = false;
+  s_loopPending = false;
+  resetPacket();
+}
+
+void enable() {
+  if (s_enabled) return;
+  resetPacket();
+  s_seq = 0;
+  s_packetsSent = 0;
+  s_recordsWritten = 0;
+  s_enabled = true;
+
+  uint8_t* d = beginRecord(TRACE_START, START_BODY_BYTES);
+  d = put16(d, sizeof(Sample));
+  *d++ = ANALOG_CHANNEL_COUNT;
+  *d++ = 0;
+  d = put32(d, 1000000UL / Config::ANALOG_SAMPLE_FREQUENCY_HZ);
+  put32(d, SHARED_RING_CAPACITY);
+  sendPacket();
+  Serial.println("[Trace] Capture enabled");
+}
+
+void disable() {
+  if (!s_enabled) return;
+  uint8_t* d = beginRecord(TRACE_STOP, STOP_BODY_BYTES);
+  d = put32(d, s_packetsSent + 1);
+  put32(d, s_recordsWritten);
+  sendPacket();
+  s_enabled = false;
+  s_loopPending = false;
+  Serial.print("[Trace] Capture disabled after ");
+  Serial.print(s_packetsSent);
+  Serial.println(" packets");
+}
+
+bool isEnabled() {
+  return s_enabled;
+}
+
+void loopBegin(uint32_t iteration) {
+  if (!s_enabled) return;
+  s_iteration = iteration;
+  s_loopUs = HardwareTimer::getMicros64();
+  SharedRing_GetHealth(s_loopHealth);
+  s_loopAvailable = SharedRing_Available();
+  s_loopPending = true;
+}
+
+void recordSamples(const Sample* samples, size_t count) {
+  if (!s_enabled || count == 0) return;
+  writeLoopRecord();
+
+  // Split across packets; each chunk is a self-contained SAMPLES record
+  const size_t perRecordMax =
+      (sizeof(s_buf) - PACKET_HEADER_BYTES - RECORD_HEADER_BYTES - SAMPLES_BODY_HEADER) / sizeof(Sample);
+  while (count > 0) {
+    size_t room = sizeof(s_buf) - s_len;
+    size_t fit = room > RECORD_HEADER_BYTES + SAMPLES_BODY_HEADER
+                   ? (room - RECORD_HEADER_BYTES - SAMPLES_BODY_HEADER) / sizeof(Sample) : 0;
+    if (fit == 0) {
+      sendPacket();
+      fit = perRecordMax;
+    }
+    const size_t n = count < fit ? count : fit;
+    uint8_t* d = beginRecord(TRACE_SAMPLES, SAMPLES_BODY_HEADER + n * sizeof(Sample));
+    d = put16(d, (uint16_t)n);
+    d = put16(d, 0);
+    memcpy(d, samples, n * sizeof(Sample));
+    samples += n;
+    count -= n;
+  }
+}
+
+void recordCommand(const uint8_t* data, size_t len) {
+  if (!s_enabled) return;
+  writeLoopRecord();
+  if (len > sizeof(s_buf) - PACKET_HEADER_BYTES - RECORD_HEADER_BYTES) {
+    len = sizeof(s_buf) - PACKET_HEADER_BYTES - RECORD_HEADER_BYTES;
+  }
+  uint8_t* d = beginRecord(TRACE_COMMAND, len);
+  memcpy(d, data, len);
+}
+
+void flush() {
+  if (!s_enabled) return;
+  sendPacket();
+}
+
+}  // namespace TraceRecorder
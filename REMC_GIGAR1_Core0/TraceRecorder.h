@@ -0,0 +1,87 @@
+/*
+  ---------------------------------------------------------------------------
+  TraceRecorder – SharedRing Traffic Capture for Offline Replay (CM7)
+  ---------------------------------------------------------------------------
+
+  When enabled (UDP command 0x32, 0x33 disables), every input that drives
+  SampleCollector is streamed to the telemetry group as FLAGS_TRACE
+  packets:
+
+    - loop iteration boundaries (iteration number, HardwareTimer µs, ring
+      fill / overruns / heartbeat at the start of the iteration)
+    - the Sample frames returned by SharedRing_Consume(), byte for byte,
+      before the Decimator touches them
+    - command datagrams received by UdpManager, in the iteration they
+      were executed
+
+  Iterations with neither samples nor commands do not change SampleCollector
+  state and are not recorded; the iteration number keeps the count. The
+  host tools (host_bench/trace_capture, host_bench/trace_replay) write the
+  stream to a file and feed it back into a host build of SampleCollector /
+  UdpManager.
+
+  Trace payload (after the 64-byte Neutrino header, little-endian):
+
+      u32 seq            trace packet sequence (gaps = lost packets)
+      u16 record_count
+      u16 version        TRACE_VERSION
+      records: u8 type, u8 reserved, u16 body_len, body[body_len]
+
+  Records:
+
+      TRACE_START    u16 sample_bytes, u8 channels, u8 reserved,
+                     u32 sample_period_us, u32 ring_capacity
+      TRACE_LOOP     u32 iteration, u64 cm7_us, u32 ring_available,
+                     u32 overruns, u32 heartbeat
+      TRACE_SAMPLES  u16 count, u16 reserved, count x Sample (SharedRing.h)
+      TRACE_COMMAND  command datagram bytes after its Neutrino header
+      TRACE_STOP     u32 packets_sent, u32 records_written
+
+  At 10 kHz the sample records are ~290 KB/s (~200 packets/s).
+  ---------------------------------------------------------------------------
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+struct Sample;
+
+// ================== TRACE CONFIGURATION ==================
+#ifndef TRACE_PAYLOAD_BYTES
+  #define TRACE_PAYLOAD_BYTES 1408   // 1472 UDP MTU payload - 64-byte header
+#endif
+// ==========================================================
+
+namespace TraceRecorder {
+
+  static const uint16_t TRACE_VERSION = 1;
+  static const size_t PACKET_HEADER_BYTES = 8;
+  static const size_t RECORD_HEADER_BYTES = 4;
+
+  enum RecordType : uint8_t {
+    TRACE_START = 1,
+    TRACE_LOOP,
+    TRACE_SAMPLES,
+    TRACE_COMMAND,
+    TRACE_STOP
+  };
+
+  void init();
+
+  void enable();
+  void disable();
+  bool isEnabled();
+
+  // Start of a loop() iteration; the LOOP record is written lazily
+  void loopBegin(uint32_t iteration);
+
+  // Frames returned by SharedRing_Consume(), before any in-place processing
+  void recordSamples(const Sample* samples, size_t count);
+
+  // Command datagram payload (bytes after the Neutrino header)
+  void recordCommand(const uint8_t* data, size_t len);
+
+  // Send whatever is buffered (end of each loop iteration)
+  void flush();
+}
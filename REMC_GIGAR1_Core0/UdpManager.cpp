@@ -10,6 +10,7 @@
 #include "MD5.h"      // For schema hashing
 #include <TimeLib.h>  // For timekeeping (needs external time source)
 #include "TimeMapper.h"
+#include "TraceRecorder.h"
 
 // --- Network Configuration ---
 static EthernetUDP cmdUdp;  // Multicast listener for commands
@@ -22,6 +23,7 @@ static const uint16_t UDP_PORT = Config::TELEMETRY_PORT;
 static const IPAddress CMD_MCAST = Config::COMMAND_MCAST_IP;
 static const uint16_t CMD_PORT = Config::COMMAND_PORT;
 
+static const IPAddress NTP_MCAST = Config::NTP_IP;       // time beacons (ntp_server --beacon)
 static const uint16_t NTP_PORT = Config::NTP_PORT;
 
 // Neutrino header constants
@@ -29,67 +31,59 @@ static const uint32_t MSG_ID = 1;  // Atomic
 static const uint32_t FLAGS_NORMAL = 0;
 static const uint32_t FLAGS_COLLECTED_SAMPLES = 1;  // Tag for collected samples
 static const uint32_t FLAGS_BATCH_END = 2;  // Tag for end of batch
+static const uint32_t FLAGS_SPECTRAL = 4;  // Spectral summary packet (not samples)
+static const uint32_t FLAGS_FAULT = 8;  // Acquisition fault event packet (not samples)
+static const uint32_t FLAGS_TRACE = 16;  // Trace capture packet (not samples)
 static const size_t FRAG_LEN = 16;
 static const size_t HEADER_SIZE = 64;
 
-// Telemetry schema - samples are bundled per loop iteration
-static const char* schema =
-  "node_name REMC \n"
+#define SCHEMA_STR_(x) #x
+#define SCHEMA_STR(x) SCHEMA_STR_(x)
+
+// Telemetry schema - samples are bundled per loop iteration. buildSchema()
+// emits at init: this header (node_name from REMC_NODE_NAME, the sample
+// period and the per-pair ADC skew), one "v" line per kAnalogChannels entry
+// (ChannelTable.h) with its wire type, unit and, for u16 channels,
+// cal:<scale>:<offset>; then "v t_us u64 u:us", one u8 line per status byte
+// and "v t_us_end u64 u:us", so every field of the sample is listed.
+static const char* const SCHEMA_HEADER =
+  "node_name " REMC_NODE_NAME " \n"
   "c telem_period 100000\n"  // 100µs (in nanoseconds)
-  "v switch_voltage f32 u:kV\n"
-  "v switch_current f32 u:kA\n"
-  "v output_voltage_a f32 u:kV\n"
-  "v output_voltage_b f32 u:kV\n"
-  "v temperature_1 f32 u:degC\n"
-  "v armed_status u8\n"
-  "v em_status u8\n"
-  "v msw_a_status u8\n"
-  "v msw_b_status u8\n"
-  "v manual_mode_status u8\n"
-  "v hold_mode_status u8\n"
-
-  "\n\n\n\n\n\n\n\n\n\n";  // Pad to multiple of 16 bytes
+  "c skew_ns_switch_voltage_current " SCHEMA_STR(ADC_PAIR_SKEW_NS) "\n"
+  "c skew_ns_output_voltage_a_b " SCHEMA_STR(ADC_PAIR_SKEW_NS) "\n";
+
+static const char* const STATUS_NAMES[] = {
+  "armed_status", "em_status", "msw_a_status",
+  "msw_b_status", "manual_mode_status", "hold_mode_status"
+};
+static const size_t NUM_STATUS = sizeof(STATUS_NAMES) / sizeof(STATUS_NAMES[0]);
+
+static const char* const SCHEMA_PADDING = "\n\n\n\n\n\n\n\n\n\n";  // Pad to multiple of 16 bytes
+
+static char schema[512];
 
 // Dynamic bundling configuration - optimized for MTU
 // Ethernet MTU=1500, IP=20, UDP=8 → max payload=1472
 // Header=64, remaining=1408, sample=42 → max samples=33 (safe)
+// Sample size follows the channel table; the static_assert below catches
+// a table change that no longer fits 33 samples into one datagram.
 constexpr size_t MAX_SAMPLES_PER_BUNDLE = 33;  // Maximum samples per UDP packet (MTU optimized for 42-byte samples)
 
 // Data sizes - variable samples per packet  
-static const size_t DATA_SIZE_PER_SAMPLE = (5 * sizeof(float)) + sizeof(uint64_t) + 6 * sizeof(uint8_t) + sizeof(uint64_t);  // 42 bytes per sample (includes us_end)
-static const size_t MAX_PACKET_SIZE = HEADER_SIZE + (DATA_SIZE_PER_SAMPLE * MAX_SAMPLES_PER_BUNDLE);
+static constexpr size_t DATA_SIZE_PER_SAMPLE = ChannelTable::analogWireBytes() + sizeof(uint64_t) + NUM_STATUS * sizeof(uint8_t) + sizeof(uint64_t);  // 42 bytes per sample (includes us_end)
+static constexpr size_t MAX_PACKET_SIZE = HEADER_SIZE + (DATA_SIZE_PER_SAMPLE * MAX_SAMPLES_PER_BUNDLE);
 // Packet size check: 64 + (42 * 33) = 1450 bytes < 1472 MTU limit ✓
+static_assert(MAX_PACKET_SIZE <= 1472, "Telemetry packet exceeds MTU; reduce MAX_SAMPLES_PER_BUNDLE");
 
 struct TelemetrySample {
-  float sv, sc, ova, ovb, tm1;
+  uint16_t raw[ANALOG_CHANNEL_COUNT];  // converted while packing (ChannelTable)
+  uint8_t flags;  // Sample::flags (SAMPLE_FLAG_GAP: packed as no-data)
+  uint8_t held;   // Sample::held (those channels packed as no-data)
   uint64_t us;  // NTP timestamp in microseconds (from TimeMapper)
-  uint8_t ready, em, a, b, manual, hold;
+  uint8_t status[NUM_STATUS];  // STATUS_NAMES order
   uint64_t us_end;  // NTP timestamp in microseconds (from TimeMapper)
 };
 
-// ADC conversion constants (copied from old TimerManager)
-const float ADC_MAX_VALUE = 4095.0f;
-
-// Switch current calibration:
-const float SCALE_SWITCH_CURRENT_A = 1000.0f / ADC_MAX_VALUE;  // 1 count ≈ 0.244 A
-const float OFFSET_SWITCH_CURRENT_A = -471.551f;               // raw = 0 → –500 A
-
-// Switch voltage calibration:
-const float SCALE_VOLTAGE_KV = 0.004449458233f;  // kV = 1 count
-const float OFFSET_VOLTAGE_KV = -8.939881545f;   // raw = 0 → –8.94 kV
-
-// Output A voltage calibration (kV):
-const float SCALE_OUTPUT_A_KV = 0.004447667531f;  // kV = 1 count
-const float OFFSET_OUTPUT_A_KV = -8.941615805f;   // raw = 0 → –8.94 kV
-
-// Output B voltage calibration (kV):
-const float SCALE_OUTPUT_B_KV = 0.004445948727f;  // kV = 1 count
-const float OFFSET_OUTPUT_B_KV = -8.936364074f;   // raw = 0 → –8.94 kV
-
-// Temperature calibration:
-const float SCALE_TEMP_DEGC = 100.0f / ADC_MAX_VALUE;  // 1 count ≈ 0.0244 °C
-const float OFFSET_TEMP_DEGC = -5.5f;                  // raw = 0 → 0 °C
-
 namespace {
 uint8_t schemaHash[16];
 uint32_t schemaNumFrags = 0;
@@ -100,6 +94,47 @@ static TelemetrySample s_sample_bundle[MAX_SAMPLES_PER_BUNDLE];
 static size_t s_bundle_count = 0;
 static bool s_sending_collected_samples = false;
 
+// IEEE-754 bits of a float, for cal: (no float formatting in printf here)
+uint32_t floatBits(float f) {
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+// Assemble the schema text from the channel table (see SCHEMA_HEADER).
+// The v lines list every sample field in wire order, the two timestamps
+// included, so the host decodes the layout from the schema alone. A
+// channel sent as raw counts carries its calibration as
+// cal:<scale bits>:<offset bits>, so the host applies it while decoding.
+void buildSchema() {
+  size_t n = snprintf(schema, sizeof(schema), "%s", SCHEMA_HEADER);
+  for (size_t i = 0; i < ANALOG_CHANNEL_COUNT && n < sizeof(schema); i++) {
+    const ChannelDef& c = kAnalogChannels[i];
+    n += snprintf(schema + n, sizeof(schema) - n, "v %s %s u:%s",
+                  c.name, ChannelTable::wireTypeName(c.wire), c.unit);
+    if (c.wire == WireType::U16 && n < sizeof(schema)) {
+      n += snprintf(schema + n, sizeof(schema) - n, " cal:%08lx:%08lx",
+                    (unsigned long)floatBits(c.scale), (unsigned long)floatBits(c.offset));
+    }
+    if (n < sizeof(schema)) n += snprintf(schema + n, sizeof(schema) - n, "\n");
+  }
+  if (n < sizeof(schema)) {
+    n += snprintf(schema + n, sizeof(schema) - n, "v t_us u64 u:us\n");
+  }
+  for (size_t i = 0; i < NUM_STATUS && n < sizeof(schema); i++) {
+    n += snprintf(schema + n, sizeof(schema) - n, "v %s u8\n", STATUS_NAMES[i]);
+  }
+  if (n < sizeof(schema)) {
+    n += snprintf(schema + n, sizeof(schema) - n, "v t_us_end u64 u:us\n");
+  }
+  if (n < sizeof(schema)) {
+    n += snprintf(schema + n, sizeof(schema) - n, "%s", SCHEMA_PADDING);
+  }
+  if (n >= sizeof(schema)) {
+    Serial.println(F("[UDP][ERR] Schema truncated"));
+  }
+}
+
 void calcSchemaHash() {
   char* buf = (char*)malloc(strlen(schema) + 1);
   if (buf != NULL) {
@@ -147,6 +182,30 @@ uint64_t getUnixTimeNanos() {
   return (uint64_t)epochSecs * 1000000000ULL + (uint64_t)us * 1000ULL;
 }
 
+// Fill the 64-byte Neutrino header; the schema fragment cycles each packet
+void writeHeader(uint8_t* packet, uint32_t flags) {
+  uint32_t* h = reinterpret_cast<uint32_t*>(packet);
+  h[0] = htonl_custom(MSG_ID);
+  h[1] = htonl_custom(flags);
+  h[2] = htonl_custom(schemaNumFrags);
+  h[3] = htonl_custom(1);  // NUM_ATOMIC_FRAGS
+  memcpy(packet + 16, schemaHash, 16);
+
+  memset(packet + 32, 0, FRAG_LEN);
+  size_t schemaLen = strlen(schema);
+  size_t offset = currentSchemaFrag * FRAG_LEN;
+  if (offset < schemaLen) {
+    size_t copyLen = min(FRAG_LEN, schemaLen - offset);
+    memcpy(packet + 32, schema + offset, copyLen);
+  }
+  h[12] = htonl_custom(currentSchemaFrag);
+  h[13] = htonl_custom(0);  // ATOMIC_IDX
+  currentSchemaFrag = (currentSchemaFrag + 1) % schemaNumFrags;
+
+  uint64_t t = htobe64_custom(getUnixTimeNanos());
+  memcpy(packet + 56, &t, sizeof(uint64_t));
+}
+
 }
 
 namespace UdpManager {
@@ -190,12 +249,17 @@ void init() {
     Serial.println(CMD_PORT);
   }
 
-  Serial.print(F("UdpManager: Binding NTP on port "));
+  // The NTP socket also joins the NTP group for the host's time beacons;
+  // unicast replies still arrive on the port
+  Serial.print(F("UdpManager: Binding NTP on "));
+  Serial.print(NTP_MCAST);
+  Serial.print(F(":"));
   Serial.println(NTP_PORT);
-  if (ntpUdp.begin(NTP_PORT) != 1) {
+  if (ntpUdp.beginMulticast(NTP_MCAST, NTP_PORT) != 1) {
     Serial.println(F("UdpManager: NTP bind failed"));
   }
 
+  buildSchema();
   calcSchemaHash();
 
   // Initialize time (replace with actual time sync)
@@ -204,27 +268,6 @@ void init() {
   Serial.println(F("[UDP] init complete."));
 }
 
-// Convert raw ADC values to physical units
-float convertSwitchCurrentA(uint16_t raw) {
-  return raw * SCALE_SWITCH_CURRENT_A + OFFSET_SWITCH_CURRENT_A;
-}
-
-float convertSwitchVoltageKV(uint16_t raw) {
-  return raw * SCALE_VOLTAGE_KV + OFFSET_VOLTAGE_KV;
-}
-
-float convertOutputVoltageAKV(uint16_t raw) {
-  return raw * SCALE_OUTPUT_A_KV + OFFSET_OUTPUT_A_KV;
-}
-
-float convertOutputVoltageBKV(uint16_t raw) {
-  return raw * SCALE_OUTPUT_B_KV + OFFSET_OUTPUT_B_KV;
-}
-
-float convertTemp1DegC(uint16_t raw) {
-  return raw * SCALE_TEMP_DEGC + OFFSET_TEMP_DEGC;
-}
-
 bool addSample(const Sample& sample) {
   // Check if bundle is full
   if (s_bundle_count >= MAX_SAMPLES_PER_BUNDLE) {
@@ -232,23 +275,21 @@ bool addSample(const Sample& sample) {
     flushSamples();
   }
   
-  // Convert raw ADC values to physical units and add to bundle
+  // Keep raw ADC values; they are converted to physical units while packing
   TelemetrySample& ts = s_sample_bundle[s_bundle_count];
   
-  ts.sv = convertSwitchVoltageKV(sample.swV);
-  ts.sc = convertSwitchCurrentA(sample.swI);
-  ts.ova = convertOutputVoltageAKV(sample.outA);
-  ts.ovb = convertOutputVoltageBKV(sample.outB);
-  ts.tm1 = convertTemp1DegC(sample.t1);
+  memcpy(ts.raw, sample.raw, sizeof(ts.raw));
+  ts.flags = sample.flags;
+  ts.held = sample.held;
   ts.us = TimeMapper::sampleToNTP(sample.t_us, sample.rollover_count);
   ts.us_end = TimeMapper::sampleToNTP(sample.t_us_end, sample.rollover_count_end);
   // Get these from state manager 
-  ts.ready = StateManager::isReady() ? 1 : 0;
-  ts.em = StateManager::isEmActActive() ? 1 : 0;
-  ts.a = (digitalRead(PIN_MSW_POS_A) == LOW) ? 0 : 1;
-  ts.b = (digitalRead(PIN_MSW_POS_B) == LOW) ? 0 : 1;
-  ts.manual = StateManager::isManualModeActive() ? 1 : 0;
-  ts.hold = StateManager::isHoldAfterFireModeActive() ? 1 : 0;
+  ts.status[0] = StateManager::isReady() ? 1 : 0;
+  ts.status[1] = StateManager::isEmActActive() ? 1 : 0;
+  ts.status[2] = (digitalRead(PIN_MSW_POS_A) == LOW) ? 0 : 1;
+  ts.status[3] = (digitalRead(PIN_MSW_POS_B) == LOW) ? 0 : 1;
+  ts.status[4] = StateManager::isManualModeActive() ? 1 : 0;
+  ts.status[5] = StateManager::isHoldAfterFireModeActive() ? 1 : 0;
   
   s_bundle_count++;
   return true;
@@ -313,6 +354,108 @@ void sendBatchEndMarker() {
   Serial.println("[UDP] Sent batch end marker");
 }
 
+void sendSpectralSummary(const SpectrumMonitor::Summary& summary) {
+  // Spectral packet payload (little-endian, 96 bytes):
+  //   u8 channel, u8 num_peaks, u8 num_bands, u8 reserved
+  //   u16 fft_size, u16 reserved
+  //   f32 bin_hz, f32 mean_counts, f32 rms_counts
+  //   u64 block_end_us (NTP)
+  //   MAX_PEAKS x { u16 bin, u16 reserved, f32 power_counts2 }
+  //   NUM_BANDS x f32 band_power_counts2
+  //   (NUM_BANDS + 1) x f32 band_edges_hz
+  static const size_t SPECTRAL_PAYLOAD_SIZE =
+      4 + 4 + 12 + 8 +
+      SpectrumMonitor::MAX_PEAKS * 8 +
+      SpectrumMonitor::NUM_BANDS * 4 +
+      (SpectrumMonitor::NUM_BANDS + 1) * 4;
+
+  uint8_t packet[HEADER_SIZE + SPECTRAL_PAYLOAD_SIZE];
+  memset(packet, 0, sizeof(packet));
+  writeHeader(packet, FLAGS_SPECTRAL);
+
+  uint8_t* d = packet + HEADER_SIZE;
+  *d++ = summary.channel;
+  *d++ = summary.numPeaks;
+  *d++ = SpectrumMonitor::NUM_BANDS;
+  *d++ = 0;
+  memcpy(d, &summary.fftSize, 2); d += 4;
+  memcpy(d, &summary.binHz, 4); d += 4;
+  memcpy(d, &summary.meanCounts, 4); d += 4;
+  memcpy(d, &summary.rmsCounts, 4); d += 4;
+  uint64_t us = TimeMapper::sampleToNTP(summary.t_us, summary.rollover_count);
+  memcpy(d, &us, 8); d += 8;
+  for (uint8_t i = 0; i < SpectrumMonitor::MAX_PEAKS; i++) {
+    uint16_t bin = i < summary.numPeaks ? summary.peaks[i].bin : 0;
+    float power = i < summary.numPeaks ? summary.peaks[i].power : 0.0f;
+    memcpy(d, &bin, 2); d += 4;
+    memcpy(d, &power, 4); d += 4;
+  }
+  memcpy(d, summary.bandPower, SpectrumMonitor::NUM_BANDS * 4);
+  d += SpectrumMonitor::NUM_BANDS * 4;
+  memcpy(d, SpectrumMonitor::BAND_EDGES_HZ, (SpectrumMonitor::NUM_BANDS + 1) * 4);
+
+  if (udp.beginPacket(PC_MCAST, UDP_PORT) == 1) {
+    if (udp.write(packet, sizeof(packet)) > 0) {
+      udp.endPacket();
+    }
+  }
+}
+
+void sendFaultEvent(const AcquisitionWatchdog::Event& event) {
+  // Fault event payload (little-endian, 60 bytes):
+  //   u8 event, u8 fault, u8 state, u8 action
+  //   u8 adc_attempts, u8 restart_attempts, u16 reserved
+  //   u32 stall_ms
+  //   u32 ring_head, u32 heartbeat, u32 overruns
+  //   u32 adc_timeouts, u32 adc_resets, u32 sampler_restarts
+  //   u64 gap_start_index, u32 gap_samples, u32 reserved
+  //   u64 event_us (NTP; gap start for gap events)
+  static const size_t FAULT_PAYLOAD_SIZE = 4 + 4 + 4 + 24 + 16 + 8;
+
+  uint8_t packet[HEADER_SIZE + FAULT_PAYLOAD_SIZE];
+  memset(packet, 0, sizeof(packet));
+  writeHeader(packet, FLAGS_FAULT);
+
+  uint8_t* d = packet + HEADER_SIZE;
+  *d++ = event.type;
+  *d++ = event.fault;
+  *d++ = event.state;
+  *d++ = event.action;
+  *d++ = event.adcResets;
+  *d++ = event.restarts;
+  d += 2;
+  memcpy(d, &event.stallMs, 4); d += 4;
+  memcpy(d, &event.head, 4); d += 4;
+  memcpy(d, &event.heartbeat, 4); d += 4;
+  memcpy(d, &event.overruns, 4); d += 4;
+  memcpy(d, &event.adcTimeouts, 4); d += 4;
+  memcpy(d, &event.adcResetsTotal, 4); d += 4;
+  memcpy(d, &event.samplerRestartsTotal, 4); d += 4;
+  memcpy(d, &event.gapStartIndex, 8); d += 8;
+  memcpy(d, &event.gapSamples, 4); d += 8;
+  uint64_t us = TimeMapper::sampleToNTP(event.t_us, event.rollover_count);
+  memcpy(d, &us, 8);
+
+  if (udp.beginPacket(PC_MCAST, UDP_PORT) == 1) {
+    if (udp.write(packet, sizeof(packet)) > 0) {
+      udp.endPacket();
+    }
+  }
+}
+
+void sendTracePacket(const uint8_t* payload, size_t len) {
+  uint8_t packet[HEADER_SIZE + TRACE_PAYLOAD_BYTES];
+  if (len > TRACE_PAYLOAD_BYTES) len = TRACE_PAYLOAD_BYTES;
+  writeHeader(packet, FLAGS_TRACE);
+  memcpy(packet + HEADER_SIZE, payload, len);
+
+  if (udp.beginPacket(PC_MCAST, UDP_PORT) == 1) {
+    if (udp.write(packet, HEADER_SIZE + len) > 0) {
+      udp.endPacket();
+    }
+  }
+}
+
 void onSampleTick(uint32_t irq_us) {
   // This function is now deprecated - use addSample() instead
   // Keeping for compatibility but it won't be called
@@ -327,6 +470,8 @@ void processIncoming() {
     if (len > 64) {
       Serial.print(F("UdpManager: Received command: "));
       Serial.println(buf[64], HEX);
+      // Captured before it runs so a replay executes it at the same point
+      TraceRecorder::recordCommand(buf + 64, len - 64);
       uint8_t cmd = buf[64];
       switch (cmd) {
         // State management commands 
@@ -360,6 +505,10 @@ void processIncoming() {
         case 0x1E: StateManager::disableManualMode(); break;
         case 0x20: StateManager::enableHoldAfterFireMode(); break;
         case 0x21: StateManager::disableHoldAfterFireMode(); break;
+        case 0x30: SpectrumMonitor::enable(); break;
+        case 0x31: SpectrumMonitor::disable(); break;
+        case 0x32: TraceRecorder::enable(); break;
+        case 0x33: TraceRecorder::disable(); break;
         default: break;
       }
     }
@@ -376,27 +525,7 @@ void sendNeutrinoPacket() {
   // Build one UDP datagram that contains the current bundle
   size_t packet_size = HEADER_SIZE + (DATA_SIZE_PER_SAMPLE * s_bundle_count);
   uint8_t packet[MAX_PACKET_SIZE];
-  uint32_t* h = reinterpret_cast<uint32_t*>(packet);
-  h[0] = htonl_custom(MSG_ID);
-  h[1] = htonl_custom(s_sending_collected_samples ? FLAGS_COLLECTED_SAMPLES : FLAGS_NORMAL);
-  h[2] = htonl_custom(schemaNumFrags);
-  h[3] = htonl_custom(1);  // NUM_ATOMIC_FRAGS
-  memcpy(packet + 16, schemaHash, 16);
-
-  // Schema fragment cycles each packet
-  memset(packet + 32, 0, FRAG_LEN);
-  size_t schemaLen = strlen(schema);
-  size_t offset = currentSchemaFrag * FRAG_LEN;
-  if (offset < schemaLen) {
-    size_t copyLen = min(FRAG_LEN, schemaLen - offset);
-    memcpy(packet + 32, schema + offset, copyLen);
-  }
-  h[12] = htonl_custom(currentSchemaFrag);
-  h[13] = htonl_custom(0);  // ATOMIC_IDX
-  currentSchemaFrag = (currentSchemaFrag + 1) % schemaNumFrags;
-
-  uint64_t t = htobe64_custom(getUnixTimeNanos());
-  memcpy(packet + 56, &t, sizeof(uint64_t));
+  writeHeader(packet, s_sending_collected_samples ? FLAGS_COLLECTED_SAMPLES : FLAGS_NORMAL);
 
   // OPTIMIZED: Bulk copy payload data (faster than individual memcpy calls)
   uint8_t* d = packet + HEADER_SIZE;
@@ -404,21 +533,20 @@ void sendNeutrinoPacket() {
   for (size_t i = 0; i < s_bundle_count; i++) {
     const TelemetrySample& sample = s_sample_bundle[i];
     
-    // Copy all floats at once (20 bytes: 5 * sizeof(float))
-    memcpy(d, &sample.sv, 20);
-    d += 20;
+    // Analog channels in table order, converted per channel (ChannelTable);
+    // gap markers and held decimated channels go out as NaN / U16_MISSING
+    // so they cannot read as data
+    d = (sample.flags & SAMPLE_FLAG_GAP) ? ChannelTable::packMissing(d)
+        : sample.held                    ? ChannelTable::packAnalog(d, sample.raw, sample.held)
+                                         : ChannelTable::packAnalog(d, sample.raw);
     
     // Copy uint64_t NTP timestamp (start time)
     memcpy(d, &sample.us, sizeof(sample.us));
     d += sizeof(sample.us);
 
     // Copy all status bytes at once (6 bytes)
-    *d++ = sample.ready;
-    *d++ = sample.em;
-    *d++ = sample.a;
-    *d++ = sample.b;
-    *d++ = sample.manual;
-    *d++ = sample.hold;
+    memcpy(d, sample.status, NUM_STATUS);
+    d += NUM_STATUS;
     
     // Copy uint64_t NTP timestamp (end time)
     memcpy(d, &sample.us_end, sizeof(sample.us_end));
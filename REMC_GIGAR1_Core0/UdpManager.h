@@ -4,6 +4,8 @@
 
 #include <Arduino.h> 
 #include <EthernetUdp.h>
+#include "SpectrumMonitor.h"
+#include "AcquisitionWatchdog.h"
 
 // Forward declare Sample struct from SharedRing
 struct Sample;
@@ -32,6 +34,15 @@ namespace UdpManager {
   void startSendingCollectedSamples();
   void stopSendingCollectedSamples();
   void sendBatchEndMarker();
+
+  // Low-rate spectral summary packet (FLAGS_SPECTRAL)
+  void sendSpectralSummary(const SpectrumMonitor::Summary& summary);
+
+  // Acquisition fault / recovery / gap event packet (FLAGS_FAULT)
+  void sendFaultEvent(const AcquisitionWatchdog::Event& event);
+
+  // Trace capture packet (FLAGS_TRACE), payload built by TraceRecorder
+  void sendTracePacket(const uint8_t* payload, size_t len);
   
   // Legacy functions (deprecated/unused)
   bool isPacketReady();
@@ -0,0 +1,67 @@
+/*
+  ---------------------------------------------------------------------------
+  AdcFrame – Dual-ADC Frame Assembly (ADC1 master / ADC2 slave)
+  ---------------------------------------------------------------------------
+
+  In regular simultaneous mode ADC1 and ADC2 convert one rank each at the
+  same instant, and the common data register packs both results:
+
+      ADC12_COMMON->CDR = (ADC2 result << 16) | ADC1 result
+
+  Ranks are laid out so the switch V/I pair is converted together:
+
+      rank | ADC1 (master)  | ADC2 (slave)
+      -----+----------------+----------------------
+        1  | swI            | swV        <- simultaneous V/I pair
+        2  | outA           | outB       <- simultaneous output pair
+        3  | t1             | swV (discarded filler; sequence lengths must
+                                         match and both ADCs may not convert
+                                         the same channel at once)
+
+  A five-channel frame therefore takes three conversion slots instead of
+  five. adc_assemble_dual_frame() scatters the three CDR words into
+  AnalogChannel (ChannelTable.h) order, i.e. straight into Sample::raw[].
+  It has no hardware dependencies so the frame assembly can be checked on
+  the host.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef ADC_FRAME_H
+#define ADC_FRAME_H
+
+#include <stdint.h>
+#include "ChannelTable.h"
+
+// Slaves' filler conversions land one past the real channels
+static const uint8_t ADC_SLOT_DISCARD = ANALOG_CHANNEL_COUNT;
+static const uint8_t ADC_DUAL_RANKS = 3;
+
+// Rank -> AnalogChannel for each ADC; the channel numbers to program come
+// from kAnalogChannels[slot].adcChannel
+static const uint8_t kAdcDualMasterSlot[ADC_DUAL_RANKS] = {
+  CH_SWITCH_CURRENT, CH_OUTPUT_VOLTAGE_A, CH_TEMP_1
+};
+static const uint8_t kAdcDualSlaveSlot[ADC_DUAL_RANKS] = {
+  CH_SWITCH_VOLTAGE, CH_OUTPUT_VOLTAGE_B, ADC_SLOT_DISCARD
+};
+// Channel the slave converts for its filler rank (must differ from the
+// master's channel in that rank)
+static const uint8_t ADC_DUAL_FILLER_CHANNEL = CH_SWITCH_VOLTAGE;
+
+static_assert(2 * ADC_DUAL_RANKS >= ANALOG_CHANNEL_COUNT,
+              "Dual ADC sequence does not cover every channel in ChannelTable.h");
+
+// Unpack the CDR words of one dual sequence into AnalogChannel order
+static inline void adc_assemble_dual_frame(const uint32_t cdr[ADC_DUAL_RANKS],
+                                           uint16_t out[ANALOG_CHANNEL_COUNT]) {
+  uint16_t slots[ANALOG_CHANNEL_COUNT + 1];
+  for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+    slots[kAdcDualMasterSlot[r]] = (uint16_t)(cdr[r] & 0xFFFFu);
+    slots[kAdcDualSlaveSlot[r]]  = (uint16_t)(cdr[r] >> 16);
+  }
+  for (uint8_t i = 0; i < ANALOG_CHANNEL_COUNT; ++i) {
+    out[i] = slots[i];
+  }
+}
+
+#endif // ADC_FRAME_H
@@ -0,0 +1,199 @@
+/*
+  ---------------------------------------------------------------------------
+  ChannelTable – Single Source of Truth for Analog Channels
+  ---------------------------------------------------------------------------
+
+  Every analog channel is described once, here: STM32 ADC channel, ADC bit
+  width, calibration (scale/offset), unit and the type it is sent as. The
+  rest of the firmware is generated from this table:
+
+    - Sample layout:  Sample::raw[] has one slot per entry, indexed by
+                      AnalogChannel (SharedRing.h).
+    - Schema text:    one "v <name> <type> u:<unit>" line per entry, in
+                      table order (UdpManager builds it at init and hashes
+                      it, as before).
+    - Conversion and wire packing: packAnalog<>() unrolls over the table at
+                      compile time and specializes on each entry's
+                      WireType, so each channel compiles to a single
+                      multiply-add and store. packMissing() writes the
+                      no-data value instead (NaN / U16_MISSING) for
+                      samples that stand in for lost ones, and the
+                      masked packAnalog() for single channels that carry
+                      no data in a sample (Sample::held).
+    - ADC sequencing (Core1): rank channels are read from adcChannel.
+
+  Table order IS the wire order. Adding a channel means one new row (plus
+  its ADC rank on Core1); nothing else has to be kept in sync by hand.
+
+  This file is shared verbatim by the Core0 and Core1 sketches (like
+  SharedRing.h) and has no Arduino dependencies.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef CHANNEL_TABLE_H
+#define CHANNEL_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ================== YOUR ADC CHANNEL IDs ==================
+// These are STM32 *ADC channel numbers* (SQx values), not Ax/Dx labels.
+#ifndef ADC_CHAN_SWITCH_CURRENT
+  #define ADC_CHAN_SWITCH_CURRENT    8   // A3 -> e.g. ADC1_IN8 (set to your map)
+#endif
+#ifndef ADC_CHAN_SWITCH_VOLTAGE
+  #define ADC_CHAN_SWITCH_VOLTAGE    3   // A6 -> e.g. ADC1_IN3
+#endif
+#ifndef ADC_CHAN_OUTPUT_VOLTAGE_A
+  #define ADC_CHAN_OUTPUT_VOLTAGE_A 11  // A4 -> e.g. ADC1_IN11
+#endif
+#ifndef ADC_CHAN_OUTPUT_VOLTAGE_B
+  #define ADC_CHAN_OUTPUT_VOLTAGE_B 12  // A5 -> e.g. ADC1_IN12
+#endif
+#ifndef ADC_CHAN_TEMP_1
+  #define ADC_CHAN_TEMP_1           10  // A2 -> e.g. ADC1_IN10
+#endif
+// ==========================================================
+
+enum class WireType : uint8_t {
+  F32,   // calibrated float (raw * scale + offset)
+  U16    // raw ADC counts; scale/offset go in the schema (cal:)
+};
+
+struct ChannelDef {
+  const char* name;      // schema variable name
+  uint8_t adcChannel;    // STM32 ADC INP number
+  uint8_t bits;          // ADC resolution
+  float scale;           // physical = raw * scale + offset
+  float offset;
+  const char* unit;      // schema unit (u:<unit>)
+  WireType wire;
+};
+
+// Index into kAnalogChannels / Sample::raw[]
+enum AnalogChannel : uint8_t {
+  CH_SWITCH_VOLTAGE = 0,
+  CH_SWITCH_CURRENT,
+  CH_OUTPUT_VOLTAGE_A,
+  CH_OUTPUT_VOLTAGE_B,
+  CH_TEMP_1,
+  ANALOG_CHANNEL_COUNT
+};
+
+static constexpr float ADC_MAX_VALUE = 4095.0f;
+
+static constexpr ChannelDef kAnalogChannels[ANALOG_CHANNEL_COUNT] = {
+  // name              ADC channel                bits  scale                     offset          unit    wire
+  { "switch_voltage",   ADC_CHAN_SWITCH_VOLTAGE,   12,  0.004449458233f,          -8.939881545f,  "kV",   WireType::F32 },  // raw = 0 → –8.94 kV
+  { "switch_current",   ADC_CHAN_SWITCH_CURRENT,   12,  1000.0f / ADC_MAX_VALUE,  -471.551f,      "kA",   WireType::F32 },  // 1 count ≈ 0.244 A
+  { "output_voltage_a", ADC_CHAN_OUTPUT_VOLTAGE_A, 12,  0.004447667531f,          -8.941615805f,  "kV",   WireType::F32 },  // raw = 0 → –8.94 kV
+  { "output_voltage_b", ADC_CHAN_OUTPUT_VOLTAGE_B, 12,  0.004445948727f,          -8.936364074f,  "kV",   WireType::F32 },  // raw = 0 → –8.94 kV
+  { "temperature_1",    ADC_CHAN_TEMP_1,           12,  100.0f / ADC_MAX_VALUE,   -5.5f,          "degC", WireType::F32 },  // 1 count ≈ 0.0244 °C
+};
+
+namespace ChannelTable {
+
+  // ---- Per-wire-type conversion and packing ----
+  template <WireType W> struct Wire;
+
+  // No-data value of a U16 channel: above any ADC count (bits <= 12), so
+  // the host maps it to NaN instead of applying the calibration
+  static constexpr uint16_t U16_MISSING = 0xFFFF;
+
+  template <> struct Wire<WireType::F32> {
+    static constexpr size_t SIZE = 4;
+    static constexpr const char* typeName() { return "f32"; }
+    static inline uint8_t* put(uint8_t* d, uint16_t raw, float scale, float offset) {
+      const float v = raw * scale + offset;
+      memcpy(d, &v, SIZE);
+      return d + SIZE;
+    }
+    static inline uint8_t* putMissing(uint8_t* d) {
+      const uint32_t nan = 0x7FC00000u;   // quiet NaN
+      memcpy(d, &nan, SIZE);
+      return d + SIZE;
+    }
+  };
+
+  template <> struct Wire<WireType::U16> {
+    static constexpr size_t SIZE = 2;
+    static constexpr const char* typeName() { return "u16"; }
+    static inline uint8_t* put(uint8_t* d, uint16_t raw, float, float) {
+      memcpy(d, &raw, SIZE);
+      return d + SIZE;
+    }
+    static inline uint8_t* putMissing(uint8_t* d) {
+      memcpy(d, &U16_MISSING, SIZE);
+      return d + SIZE;
+    }
+  };
+
+  // Physical value of one channel (constants folded per channel)
+  template <size_t I>
+  inline float convert(uint16_t raw) {
+    return raw * kAnalogChannels[I].scale + kAnalogChannels[I].offset;
+  }
+
+  inline float convert(size_t ch, uint16_t raw) {
+    return raw * kAnalogChannels[ch].scale + kAnalogChannels[ch].offset;
+  }
+
+  // Compile-time unroll over the table: one specialized put() per channel
+  template <size_t I, size_t N = ANALOG_CHANNEL_COUNT>
+  struct AnalogPacker {
+    static inline uint8_t* pack(uint8_t* d, const uint16_t* raw) {
+      d = Wire<kAnalogChannels[I].wire>::put(d, raw[I], kAnalogChannels[I].scale, kAnalogChannels[I].offset);
+      return AnalogPacker<I + 1, N>::pack(d, raw);
+    }
+    static inline uint8_t* packMissing(uint8_t* d) {
+      d = Wire<kAnalogChannels[I].wire>::putMissing(d);
+      return AnalogPacker<I + 1, N>::packMissing(d);
+    }
+    static inline uint8_t* pack(uint8_t* d, const uint16_t* raw, uint8_t missing) {
+      d = (missing & (1u << I)) ? Wire<kAnalogChannels[I].wire>::putMissing(d)
+                                : Wire<kAnalogChannels[I].wire>::put(d, raw[I], kAnalogChannels[I].scale, kAnalogChannels[I].offset);
+      return AnalogPacker<I + 1, N>::pack(d, raw, missing);
+    }
+  };
+
+  template <size_t N>
+  struct AnalogPacker<N, N> {
+    static inline uint8_t* pack(uint8_t* d, const uint16_t*) { return d; }
+    static inline uint8_t* packMissing(uint8_t* d) { return d; }
+    static inline uint8_t* pack(uint8_t* d, const uint16_t*, uint8_t) { return d; }
+  };
+
+  // Pack all analog channels in table order; returns the advanced pointer.
+  inline uint8_t* packAnalog(uint8_t* d, const uint16_t* raw) {
+    return AnalogPacker<0>::pack(d, raw);
+  }
+
+  // Same size and order, no data (gap samples, SAMPLE_FLAG_GAP)
+  inline uint8_t* packMissing(uint8_t* d) {
+    return AnalogPacker<0>::packMissing(d);
+  }
+
+  // Same, with no data in the channels whose bit is set in `missing`
+  // (Sample::held)
+  inline uint8_t* packAnalog(uint8_t* d, const uint16_t* raw, uint8_t missing) {
+    return AnalogPacker<0>::pack(d, raw, missing);
+  }
+
+  // Packed size of the analog block on the wire
+  constexpr size_t wireSize(WireType w) {
+    return w == WireType::F32 ? Wire<WireType::F32>::SIZE : Wire<WireType::U16>::SIZE;
+  }
+
+  constexpr size_t analogWireBytes() {
+    size_t n = 0;
+    for (size_t i = 0; i < ANALOG_CHANNEL_COUNT; ++i) n += wireSize(kAnalogChannels[i].wire);
+    return n;
+  }
+
+  constexpr const char* wireTypeName(WireType w) {
+    return w == WireType::F32 ? Wire<WireType::F32>::typeName() : Wire<WireType::U16>::typeName();
+  }
+}
+
+#endif // CHANNEL_TABLE_H
@@ -6,74 +6,95 @@
 #include "Logger.h"
 #include "PinConfig.h"
 #include "HardwareTimer.h"   // for getMicros64()
+#include "AdcFrame.h"
 
 using namespace std::chrono_literals;
 
-// ================== YOUR ADC CHANNEL IDs ==================
-// These are STM32 *ADC channel numbers* (SQx values), not Ax/Dx labels.
-#ifndef ADC_CHAN_SWITCH_CURRENT
-  #define ADC_CHAN_SWITCH_CURRENT    8   // A3 -> e.g. ADC1_IN8 (set to your map)
-#endif
-#ifndef ADC_CHAN_SWITCH_VOLTAGE
-  #define ADC_CHAN_SWITCH_VOLTAGE    3   // A6 -> e.g. ADC1_IN3
-#endif
-#ifndef ADC_CHAN_OUTPUT_VOLTAGE_A
-  #define ADC_CHAN_OUTPUT_VOLTAGE_A 11  // A4 -> e.g. ADC1_IN11
-#endif
-#ifndef ADC_CHAN_OUTPUT_VOLTAGE_B
-  #define ADC_CHAN_OUTPUT_VOLTAGE_B 12  // A5 -> e.g. ADC1_IN12
-#endif
-#ifndef ADC_CHAN_TEMP_1
-  #define ADC_CHAN_TEMP_1           10  // A2 -> e.g. ADC1_IN10
-#endif
-// ==========================================================
+// ADC channel numbers (ADC_CHAN_*) and the channel order live in
+// ChannelTable.h, shared with the CM7.
 
 // 10 kHz
 constexpr uint32_t SAMPLE_INTERVAL_US = 100;
 
-// ---------- Use ADC1 (adjust if you split across ADC3) ----------
+// ---------- ADC mode ----------
+// 1: ADC1 + ADC2 in regular simultaneous mode (see AdcFrame.h); the swI/swV
+//    and outA/outB pairs are sampled at the same instant, 3 slots per frame.
+// 0: legacy single-ADC scan, all five channels sequentially on ADC1.
+// Keep ADC_DUAL_SIMULTANEOUS (Core0 Config.h) in sync: it sets the schema
+// skew, and the CM7 logs an error if the mode reported in the ring differs.
+#ifndef REMC_ADC_DUAL_MODE
+  #define REMC_ADC_DUAL_MODE 1
+#endif
+
+// ---------- ADC poll bounds ----------
+// A five-rank scan takes ~10 µs, so a flag that has not appeared after
+// ADC_POLL_SPIN_LIMIT reads means the ADC is wedged: the frame is dropped
+// and counted in the SharedRing adc_timeouts (the CM7 watchdog decides on
+// recovery). Power-up/calibration waits get the larger setup bound.
+#ifndef ADC_POLL_SPIN_LIMIT
+  #define ADC_POLL_SPIN_LIMIT  2000u
+#endif
+#ifndef ADC_SETUP_SPIN_LIMIT
+  #define ADC_SETUP_SPIN_LIMIT 2000000u
+#endif
+
+// ---------- ADC1 is the master (adjust if you split across ADC3) ----------
 #define ADCx        ADC1
+#define ADCy        ADC2   // slave in dual mode
 #define ADCx_COMMON ADC12_COMMON
 
 // mbed ticker -> IRQ every 100 µs
 static mbed::Ticker g_samplerTicker;
 
+// Recovery requests from the CM7 watchdog (set by RPC, handled in loop())
+static volatile bool g_adcResetRequested = false;
+static volatile bool g_samplerRestartRequested = false;
+
 // ---------- helpers ----------
 static inline void decompose_us64(uint64_t t64, uint32_t &t_us, uint32_t &roll) {
   t_us  = (uint32_t)(t64 & 0xFFFFFFFFULL);
   roll  = (uint32_t)(t64 >> 32);
 }
 
-static void adc_config_once() {
-  __HAL_RCC_ADC12_CLK_ENABLE();
+// Spin until (reg & mask) == want; false after `limit` polls
+static inline bool adc_wait(volatile uint32_t& reg, uint32_t mask, bool want, uint32_t limit) {
+  for (uint32_t n = 0; n < limit; ++n) {
+    if (((reg & mask) != 0) == want) return true;
+  }
+  return false;
+}
 
+static bool adc_power_up(ADC_TypeDef* adc) {
   // --- H7: regulator + power-up lives in ADCx->CR, not CCR ---
   // Exit deep-power-down if present
 #ifdef ADC_CR_DEEPPWD
-  CLEAR_BIT(ADCx->CR, ADC_CR_DEEPPWD);
+  CLEAR_BIT(adc->CR, ADC_CR_DEEPPWD);
 #endif
   // Enable the ADC internal voltage regulator (ADVREGEN)
 #ifdef ADC_CR_ADVREGEN_0
   // Some headers expose _0/_1 fields
-  MODIFY_REG(ADCx->CR, ADC_CR_ADVREGEN, ADC_CR_ADVREGEN_0);
+  MODIFY_REG(adc->CR, ADC_CR_ADVREGEN, ADC_CR_ADVREGEN_0);
 #else
   // Others expose a single mask
-  SET_BIT(ADCx->CR, ADC_CR_ADVREGEN);
+  SET_BIT(adc->CR, ADC_CR_ADVREGEN);
 #endif
   delayMicroseconds(20); // regulator startup
 
   // make sure disabled before config
-  if (READ_BIT(ADCx->CR, ADC_CR_ADEN)) {
-    SET_BIT(ADCx->CR, ADC_CR_ADDIS);
-    while (READ_BIT(ADCx->CR, ADC_CR_ADEN)) {}
+  if (READ_BIT(adc->CR, ADC_CR_ADEN)) {
+    SET_BIT(adc->CR, ADC_CR_ADDIS);
+    if (!adc_wait(adc->CR, ADC_CR_ADEN, false, ADC_SETUP_SPIN_LIMIT)) return false;
   }
 
   // single conversion, SW trigger
-  ADCx->CFGR = 0;
+  adc->CFGR = 0;
+  return true;
+}
 
+static void adc_set_sample_times(ADC_TypeDef* adc) {
   // sampling times — fast but safe default
   const uint32_t SMP_47CYC = 0b101; // ~47.5 cycles
-  ADCx->SMPR1 =
+  adc->SMPR1 =
       (SMP_47CYC << ADC_SMPR1_SMP0_Pos) |
       (SMP_47CYC << ADC_SMPR1_SMP1_Pos) |
       (SMP_47CYC << ADC_SMPR1_SMP2_Pos) |
@@ -86,7 +107,7 @@ static void adc_config_once() {
       (SMP_47CYC << ADC_SMPR1_SMP9_Pos);
 
   // if you use channels >9, set SMPR2 bits too
-  ADCx->SMPR2 =
+  adc->SMPR2 =
       (SMP_47CYC << ADC_SMPR2_SMP10_Pos) |
       (SMP_47CYC << ADC_SMPR2_SMP11_Pos) |
       (SMP_47CYC << ADC_SMPR2_SMP12_Pos) |
@@ -97,58 +118,156 @@ static void adc_config_once() {
       (SMP_47CYC << ADC_SMPR2_SMP17_Pos) |
       (SMP_47CYC << ADC_SMPR2_SMP18_Pos) |
       (SMP_47CYC << ADC_SMPR2_SMP19_Pos);
+}
 
-  // sequence length = 5 (L=4), ranks 1..5
-  ADCx->SQR1 =
-      (4u << ADC_SQR1_L_Pos) |
-      (ADC_CHAN_SWITCH_CURRENT   << ADC_SQR1_SQ1_Pos) |  // rank1
-      (ADC_CHAN_SWITCH_VOLTAGE   << ADC_SQR1_SQ2_Pos) |  // rank2
-      (ADC_CHAN_OUTPUT_VOLTAGE_A << ADC_SQR1_SQ3_Pos) |  // rank3
-      (ADC_CHAN_OUTPUT_VOLTAGE_B << ADC_SQR1_SQ4_Pos);   // rank4
-  ADCx->SQR2 =
-      (ADC_CHAN_TEMP_1 << ADC_SQR2_SQ5_Pos);             // rank5
-
+static bool adc_calibrate_enable(ADC_TypeDef* adc) {
   // calibrate & enable
-  SET_BIT(ADCx->CR, ADC_CR_ADCAL);
-  while (READ_BIT(ADCx->CR, ADC_CR_ADCAL)) {}
-  SET_BIT(ADCx->ISR, ADC_ISR_ADRDY);
-  SET_BIT(ADCx->CR, ADC_CR_ADEN);
-  while (!READ_BIT(ADCx->ISR, ADC_ISR_ADRDY)) {}
+  SET_BIT(adc->CR, ADC_CR_ADCAL);
+  if (!adc_wait(adc->CR, ADC_CR_ADCAL, false, ADC_SETUP_SPIN_LIMIT)) return false;
+  SET_BIT(adc->ISR, ADC_ISR_ADRDY);
+  SET_BIT(adc->CR, ADC_CR_ADEN);
+  return adc_wait(adc->ISR, ADC_ISR_ADRDY, true, ADC_SETUP_SPIN_LIMIT);
+}
+
+// Program a regular sequence: rank r converts chans[r] (L = n - 1)
+static void adc_set_sequence(ADC_TypeDef* adc, const uint8_t* chans, uint8_t n) {
+  uint32_t sqr1 = (uint32_t)(n - 1) << ADC_SQR1_L_Pos;
+  uint32_t sqr2 = 0;
+  for (uint8_t r = 0; r < n; ++r) {
+    if (r < 4) sqr1 |= (uint32_t)chans[r] << (ADC_SQR1_SQ1_Pos + 6 * r);
+    else       sqr2 |= (uint32_t)chans[r] << (ADC_SQR2_SQ5_Pos + 6 * (r - 4));
+  }
+  adc->SQR1 = sqr1;
+  adc->SQR2 = sqr2;
+}
+
+static_assert(ANALOG_CHANNEL_COUNT <= 9, "Sequential scan uses SQR1/SQR2 only (9 ranks)");
+
+// Returns false if any power-up/calibration step timed out
+static bool adc_config_once() {
+  __HAL_RCC_ADC12_CLK_ENABLE();
+
+#if REMC_ADC_DUAL_MODE
+  if (!adc_power_up(ADCx) || !adc_power_up(ADCy)) return false;
+  adc_set_sample_times(ADCx);
+  adc_set_sample_times(ADCy);
+
+  // Both sequences must have the same length (3 ranks); channel numbers
+  // are the ADC12 INP numbers, identical on ADC1 and ADC2.
+  uint8_t master[ADC_DUAL_RANKS], slave[ADC_DUAL_RANKS];
+  for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+    const uint8_t ss = kAdcDualSlaveSlot[r];
+    master[r] = kAnalogChannels[kAdcDualMasterSlot[r]].adcChannel;
+    slave[r]  = kAnalogChannels[ss == ADC_SLOT_DISCARD ? ADC_DUAL_FILLER_CHANNEL : ss].adcChannel;
+  }
+  adc_set_sequence(ADCx, master, ADC_DUAL_RANKS);
+  adc_set_sequence(ADCy, slave, ADC_DUAL_RANKS);
+
+  // Regular simultaneous mode, CDR packs {slave, master} as 2x16 bits.
+  // Must be set while both ADCs are disabled.
+  MODIFY_REG(ADCx_COMMON->CCR,
+             ADC_CCR_DUAL | ADC_CCR_DAMDF,
+             (0b00110u << ADC_CCR_DUAL_Pos) | (0b10u << ADC_CCR_DAMDF_Pos));
+
+  return adc_calibrate_enable(ADCx) && adc_calibrate_enable(ADCy);
+#else
+  if (!adc_power_up(ADCx)) return false;
+  adc_set_sample_times(ADCx);
+
+  // one rank per table entry, in table order
+  uint8_t chans[ANALOG_CHANNEL_COUNT];
+  for (uint8_t i = 0; i < ANALOG_CHANNEL_COUNT; ++i) {
+    chans[i] = kAnalogChannels[i].adcChannel;
+  }
+  adc_set_sequence(ADCx, chans, ANALOG_CHANNEL_COUNT);
+
+  return adc_calibrate_enable(ADCx);
+#endif
+}
+
+// Full ADC re-initialization: force the ADC12 block through an RCC reset
+// so a wedged converter starts from its reset state, then configure again
+static bool adc_reset() {
+  __HAL_RCC_ADC12_FORCE_RESET();
+  __HAL_RCC_ADC12_RELEASE_RESET();
+  return adc_config_once();
 }
 
 static inline void adc_start_sequence() {
-  // clear flags and start one scan
+  // clear flags and start one scan (in dual mode the master start
+  // triggers the slave)
   SET_BIT(ADCx->ISR, ADC_ISR_EOC | ADC_ISR_EOS | ADC_ISR_OVR);
+#if REMC_ADC_DUAL_MODE
+  SET_BIT(ADCy->ISR, ADC_ISR_EOC | ADC_ISR_EOS | ADC_ISR_OVR);
+#endif
   SET_BIT(ADCx->CR,  ADC_CR_ADSTART);
 }
 
-static inline void adc_read_frame5(uint16_t out5[5]) {
+// Abandon a scan that timed out so the next tick starts clean
+static void adc_abort_sequence() {
+  if (READ_BIT(ADCx->CR, ADC_CR_ADSTART)) {
+    SET_BIT(ADCx->CR, ADC_CR_ADSTP);
+    adc_wait(ADCx->CR, ADC_CR_ADSTART, false, ADC_POLL_SPIN_LIMIT);
+  }
+  SET_BIT(ADCx->ISR, ADC_ISR_EOC | ADC_ISR_EOS | ADC_ISR_OVR);
+#if REMC_ADC_DUAL_MODE
+  SET_BIT(ADCy->ISR, ADC_ISR_EOC | ADC_ISR_EOS | ADC_ISR_OVR);
+#endif
+}
+
+// Returns false (frame incomplete) if any poll hit ADC_POLL_SPIN_LIMIT
+#if REMC_ADC_DUAL_MODE
+static inline bool adc_read_frame(uint16_t out[ANALOG_CHANNEL_COUNT]) {
+  // each rank completes on both ADCs at once; wait for both EOCs,
+  // take the packed result, then clear the flags (CDR reads do not)
+  uint32_t cdr[ADC_DUAL_RANKS];
+  for (int i = 0; i < ADC_DUAL_RANKS; ++i) {
+    if (!adc_wait(ADCx->ISR, ADC_ISR_EOC, true, ADC_POLL_SPIN_LIMIT) ||
+        !adc_wait(ADCy->ISR, ADC_ISR_EOC, true, ADC_POLL_SPIN_LIMIT)) return false;
+    cdr[i] = ADCx_COMMON->CDR;
+    SET_BIT(ADCx->ISR, ADC_ISR_EOC);
+    SET_BIT(ADCy->ISR, ADC_ISR_EOC);
+  }
+  if (!adc_wait(ADCx->ISR, ADC_ISR_EOS, true, ADC_POLL_SPIN_LIMIT)) return false;
+  SET_BIT(ADCx->ISR, ADC_ISR_EOS);
+  SET_BIT(ADCy->ISR, ADC_ISR_EOS);
+
+  adc_assemble_dual_frame(cdr, out);
+  return true;
+}
+#else
+static inline bool adc_read_frame(uint16_t out[ANALOG_CHANNEL_COUNT]) {
   // poll EOC for each rank; EOS at the end
-  for (int i = 0; i < 5; ++i) {
-    while (!READ_BIT(ADCx->ISR, ADC_ISR_EOC)) {}
-    out5[i] = (uint16_t)ADCx->DR; // DR read clears EOC
+  for (int i = 0; i < ANALOG_CHANNEL_COUNT; ++i) {
+    if (!adc_wait(ADCx->ISR, ADC_ISR_EOC, true, ADC_POLL_SPIN_LIMIT)) return false;
+    out[i] = (uint16_t)ADCx->DR; // DR read clears EOC
   }
-  while (!READ_BIT(ADCx->ISR, ADC_ISR_EOS)) {}
+  if (!adc_wait(ADCx->ISR, ADC_ISR_EOS, true, ADC_POLL_SPIN_LIMIT)) return false;
   SET_BIT(ADCx->ISR, ADC_ISR_EOS);
+  return true;
 }
+#endif
 
 // ---------- ISR: every 100 µs ----------
 static void on_sample_tick() {
+  // Heartbeat first: it keeps moving even when the ADC does not deliver
+  SharedRing_Heartbeat();
+
   const uint64_t t_start = HardwareTimer::getMicros64();
 
-  uint16_t v[5];
+  REMCSample s{};
   adc_start_sequence();
-  adc_read_frame5(v);
+  if (!adc_read_frame(s.raw)) {
+    // No frame this tick; the CM7 sees the gap in the timestamps
+    adc_abort_sequence();
+    SharedRing_NoteAdcTimeout();
+    // Publish what is staged rather than hold it behind a stalled ADC
+    SharedRing_Flush();
+    return;
+  }
 
   const uint64_t t_end = HardwareTimer::getMicros64();
 
-  REMCSample s{};
-  s.swI  = v[0];
-  s.swV  = v[1];
-  s.outA = v[2];
-  s.outB = v[3];
-  s.t1   = v[4];
-
   decompose_us64(t_start, s.t_us,     s.rollover_count);
   decompose_us64(t_end,   s.t_us_end, s.rollover_count_end);
 
@@ -170,12 +289,47 @@ void setup() {
   Logger::log(addrStr);
   SharedRing_Init();
 
-  adc_config_once();
+  if (!adc_config_once()) {
+    Logger::log("[Sampling Core] ERROR: ADC power-up/calibration timed out");
+  }
+#if REMC_ADC_DUAL_MODE
+  Logger::log("[Sampling Core] ADC1/ADC2 regular simultaneous mode (V/I pairs)");
+  SharedRing_SetAdcMode(RING_ADC_MODE_DUAL);
+#else
+  SharedRing_SetAdcMode(RING_ADC_MODE_SEQUENTIAL);
+#endif
+
+  // Watchdog recovery hooks (AcquisitionWatchdog on the CM7). Handlers run
+  // in the RPC thread, so they only raise flags for loop().
+  RPC.bind("adcReset", []() { g_adcResetRequested = true; });
+  RPC.bind("samplerRestart", []() { g_samplerRestartRequested = true; });
 
   g_samplerTicker.attach(mbed::callback(on_sample_tick), 100us);
   Logger::log("[Sampling Core] mbed::Ticker sampling @ 10 kHz");
 }
 
 void loop() {
-  // ISR produces; main can drain or do nothing.
+  // ISR produces; loop() only services watchdog recovery requests.
+  if (g_samplerRestartRequested) {
+    // Full restart: ticker, ADC and producer state from scratch
+    g_samplerRestartRequested = false;
+    g_adcResetRequested = false;
+    g_samplerTicker.detach();
+    SharedRing_Flush();
+    const bool ok = adc_reset();
+    SharedRing_NoteSamplerRestart();
+    g_samplerTicker.attach(mbed::callback(on_sample_tick), 100us);
+    Logger::log(ok ? "[Sampling Core] Sampler restarted"
+                   : "[Sampling Core] ERROR: sampler restart, ADC did not come up");
+  } else if (g_adcResetRequested) {
+    // ADC only: pause sampling while the converter is re-initialized
+    g_adcResetRequested = false;
+    g_samplerTicker.detach();
+    SharedRing_Flush();
+    const bool ok = adc_reset();
+    SharedRing_NoteAdcReset();
+    g_samplerTicker.attach(mbed::callback(on_sample_tick), 100us);
+    Logger::log(ok ? "[Sampling Core] ADC reset"
+                   : "[Sampling Core] ERROR: ADC reset timed out");
+  }
 }
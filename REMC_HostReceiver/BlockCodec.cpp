@@ -0,0 +1,332 @@
+#include "BlockCodec.h"
+
+#include <string.h>
+
+namespace BlockCodec {
+
+namespace {
+
+const size_t HEADER_BYTES = 4;
+
+inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+inline unsigned bitWidth(uint64_t v) { return v ? 64u - (unsigned)__builtin_clzll(v) : 0u; }
+
+inline uint32_t floatBits(float f) { uint32_t u; memcpy(&u, &f, 4); return u; }
+inline float bitsFloat(uint32_t u) { float f; memcpy(&f, &u, 4); return f; }
+
+struct BitWriter {
+  uint8_t* out;
+  size_t pos;
+  uint64_t acc;
+  unsigned bits;
+
+  explicit BitWriter(uint8_t* o) : out(o), pos(0), acc(0), bits(0) {}
+
+  void put(uint64_t v, unsigned n) {
+    if (n > 32) {
+      put(v & 0xFFFFFFFFull, 32);
+      v >>= 32;
+      n -= 32;
+    }
+    if (n == 0) return;
+    acc |= (v & ((1ull << n) - 1)) << bits;
+    bits += n;
+    while (bits >= 8) {
+      out[pos++] = (uint8_t)acc;
+      acc >>= 8;
+      bits -= 8;
+    }
+  }
+
+  void align() {
+    if (bits) out[pos++] = (uint8_t)acc;
+    acc = 0;
+    bits = 0;
+  }
+};
+
+// LSB-first reader with a branch-light 8-byte refill; bits above `bits`
+// in acc may hold a copy of the next byte, which is identical data
+struct BitReader {
+  const uint8_t* p;
+  const uint8_t* end;
+  uint64_t acc;
+  unsigned bits;
+  bool overrun;
+
+  BitReader(const uint8_t* b, size_t n) : p(b), end(b + n), acc(0), bits(0), overrun(false) {}
+
+  void refill() {
+    if (end - p >= 8) {
+      uint64_t w;
+      memcpy(&w, p, 8);
+      acc |= w << bits;
+      p += (63 - bits) >> 3;
+      bits |= 56;
+    } else {
+      while (bits <= 56 && p < end) {
+        acc |= (uint64_t)*p++ << bits;
+        bits += 8;
+      }
+    }
+  }
+
+  uint64_t get(unsigned n) {
+    if (n > 32) {
+      const uint64_t lo = get(32);
+      return lo | (get(n - 32) << 32);
+    }
+    if (n == 0) return 0;
+    if (bits < n) {
+      refill();
+      if (bits < n) {
+        overrun = true;
+        return 0;
+      }
+    }
+    const uint64_t v = acc & ((1ull << n) - 1);
+    acc >>= n;
+    bits -= n;
+    return v;
+  }
+
+  void align() {
+    const unsigned r = bits & 7;
+    acc >>= r;
+    bits -= r;
+  }
+};
+
+// Frame-pack n values produced by value(i)
+template <typename ValueFn>
+void putFrames(BitWriter& w, size_t n, ValueFn value) {
+  uint64_t frame[FRAME_VALUES];
+  for (size_t f = 0; f < n; f += FRAME_VALUES) {
+    const size_t m = n - f < FRAME_VALUES ? n - f : FRAME_VALUES;
+    uint64_t all = 0;
+    for (size_t i = 0; i < m; ++i) all |= frame[i] = value(f + i);
+    const unsigned width = bitWidth(all);
+    w.put(width, 8);
+    for (size_t i = 0; i < m; ++i) w.put(frame[i], width);
+    w.align();
+  }
+}
+
+size_t encodeTime(const uint64_t* t, size_t rows, uint8_t* out) {
+  BitWriter w(out);
+  w.put(t[0], 64);
+  if (rows >= 2) {
+    w.put(zigzag((int64_t)(t[1] - t[0])), 64);
+    putFrames(w, rows - 2, [t](size_t i) {
+      return zigzag((int64_t)((t[i + 2] - t[i + 1]) - (t[i + 1] - t[i])));
+    });
+  }
+  w.align();
+  return w.pos;
+}
+
+size_t encodeDur(const uint16_t* d, size_t rows, uint8_t* out) {
+  BitWriter w(out);
+  putFrames(w, rows, [d](size_t i) {
+    return zigzag((int64_t)d[i] - (i ? (int64_t)d[i - 1] : 0));
+  });
+  return w.pos;
+}
+
+size_t encodeFloat(const float* v, size_t rows, uint8_t* out) {
+  BitWriter w(out);
+  uint32_t prev = floatBits(v[0]);
+  w.put(prev, 32);
+  unsigned prevLead = 33, prevTrail = 0;  // 33: no window yet
+  for (size_t i = 1; i < rows; ++i) {
+    const uint32_t cur = floatBits(v[i]);
+    const uint32_t x = cur ^ prev;
+    prev = cur;
+    if (x == 0) {
+      w.put(0, 1);
+      continue;
+    }
+    const unsigned lead = (unsigned)__builtin_clz(x);
+    const unsigned trail = (unsigned)__builtin_ctz(x);
+    if (prevLead <= 32 && lead >= prevLead && trail >= prevTrail) {
+      w.put(1, 2);  // '1','0'
+      w.put(x >> prevTrail, 32 - prevLead - prevTrail);
+    } else {
+      const unsigned len = 32 - lead - trail;
+      w.put(3, 2);  // '1','1'
+      w.put(lead, 5);
+      w.put(len - 1, 5);
+      w.put(x >> trail, len);
+      prevLead = lead;
+      prevTrail = trail;
+    }
+  }
+  w.align();
+  return w.pos;
+}
+
+size_t encodeStatus(const uint8_t* s, size_t rows, uint8_t* out) {
+  size_t pos = 0;
+  for (size_t i = 0; i < rows;) {
+    size_t run = 1;
+    while (i + run < rows && s[i + run] == s[i] && run < 0xFFFF) run++;
+    out[pos++] = s[i];
+    out[pos++] = (uint8_t)run;
+    out[pos++] = (uint8_t)(run >> 8);
+    i += run;
+  }
+  return pos;
+}
+
+bool getFrames(BitReader& r, size_t n, uint64_t* v) {
+  for (size_t f = 0; f < n; f += FRAME_VALUES) {
+    const size_t m = n - f < FRAME_VALUES ? n - f : FRAME_VALUES;
+    const unsigned width = (unsigned)r.get(8);
+    if (width > 64) return false;
+    for (size_t i = 0; i < m; ++i) v[f + i] = r.get(width);
+    r.align();
+  }
+  return !r.overrun;
+}
+
+bool decodeTime(const uint8_t* in, size_t len, size_t rows, uint64_t* t) {
+  BitReader r(in, len);
+  uint64_t cur = r.get(64);
+  t[0] = cur;
+  if (rows < 2) return !r.overrun;
+  int64_t delta = unzigzag(r.get(64));
+  cur += (uint64_t)delta;
+  t[1] = cur;
+
+  // Frames decode straight into the output, then run the prefix sums in place
+  if (!getFrames(r, rows - 2, t + 2)) return false;
+  for (size_t i = 2; i < rows; ++i) {
+    delta += unzigzag(t[i]);
+    cur += (uint64_t)delta;
+    t[i] = cur;
+  }
+  return true;
+}
+
+bool decodeDur(const uint8_t* in, size_t len, size_t rows, uint16_t* d) {
+  BitReader r(in, len);
+  int32_t prev = 0;
+  for (size_t f = 0; f < rows; f += FRAME_VALUES) {
+    const size_t m = rows - f < FRAME_VALUES ? rows - f : FRAME_VALUES;
+    const unsigned width = (unsigned)r.get(8);
+    if (width > 64) return false;
+    for (size_t i = 0; i < m; ++i) {
+      prev += (int32_t)unzigzag(r.get(width));
+      d[f + i] = (uint16_t)prev;
+    }
+    r.align();
+  }
+  return !r.overrun;
+}
+
+bool decodeFloat(const uint8_t* in, size_t len, size_t rows, float* v) {
+  BitReader r(in, len);
+  uint32_t prev = (uint32_t)r.get(32);
+  v[0] = bitsFloat(prev);
+  unsigned lead = 0, trail = 0;
+  for (size_t i = 1; i < rows; ++i) {
+    if (r.get(1)) {
+      if (r.get(1)) {
+        lead = (unsigned)r.get(5);
+        const unsigned n = (unsigned)r.get(5) + 1;
+        if (lead + n > 32) return false;
+        trail = 32 - lead - n;
+      }
+      prev ^= (uint32_t)r.get(32 - lead - trail) << trail;
+    }
+    v[i] = bitsFloat(prev);
+  }
+  return !r.overrun;
+}
+
+bool decodeStatus(const uint8_t* in, size_t len, size_t rows, uint8_t* s) {
+  size_t i = 0;
+  for (size_t pos = 0; pos + 3 <= len && i < rows; pos += 3) {
+    size_t run = (size_t)in[pos + 1] | ((size_t)in[pos + 2] << 8);
+    if (run > rows - i) return false;
+    memset(s + i, in[pos], run);
+    i += run;
+  }
+  return i == rows;
+}
+
+}  // namespace
+
+size_t maxEncodedBytes(size_t rows, size_t channels) {
+  const size_t frames = (rows + FRAME_VALUES - 1) / FRAME_VALUES;
+  return HEADER_BYTES + 4 * (3 + channels) +
+         16 + frames * 2 + rows * 8 +          // t_us
+         frames * 2 + rows * 3 +               // dur_us
+         channels * (8 + rows * 6) +           // channels (44 bits worst case)
+         rows * 3 + 16;                        // status
+}
+
+size_t encode(const ColumnsIn& in, size_t rows, uint8_t* out) {
+  if (rows == 0 || rows > 0xFFFF || in.channels > 16) return 0;
+  const size_t columns = 3 + in.channels;
+  out[0] = CODEC_VERSION;
+  out[1] = (uint8_t)in.channels;
+  out[2] = (uint8_t)rows;
+  out[3] = (uint8_t)(rows >> 8);
+  uint8_t* lengths = out + HEADER_BYTES;
+  uint8_t* d = lengths + 4 * columns;
+
+  uint32_t n[MAX_COLUMNS];
+  n[0] = (uint32_t)encodeTime(in.t, rows, d);
+  d += n[0];
+  n[1] = (uint32_t)encodeDur(in.dur, rows, d);
+  d += n[1];
+  for (size_t c = 0; c < in.channels; ++c) {
+    n[2 + c] = (uint32_t)encodeFloat(in.ch[c], rows, d);
+    d += n[2 + c];
+  }
+  n[2 + in.channels] = (uint32_t)encodeStatus(in.status, rows, d);
+  d += n[2 + in.channels];
+  memcpy(lengths, n, 4 * columns);
+  return (size_t)(d - out);
+}
+
+bool peek(const uint8_t* in, size_t len, size_t& rows, size_t& channels) {
+  if (len < HEADER_BYTES || in[0] != CODEC_VERSION || in[1] > 16) return false;
+  channels = in[1];
+  rows = (size_t)in[2] | ((size_t)in[3] << 8);
+  return rows > 0 && len >= HEADER_BYTES + 4 * (3 + channels);
+}
+
+bool decode(const uint8_t* in, size_t len, uint32_t columns, ColumnsOut& out) {
+  size_t rows, channels;
+  if (!peek(in, len, rows, channels)) return false;
+  const size_t ncol = 3 + channels;
+  uint32_t n[MAX_COLUMNS];
+  memcpy(n, in + HEADER_BYTES, 4 * ncol);
+
+  const uint8_t* d = in + HEADER_BYTES + 4 * ncol;
+  const uint8_t* end = in + len;
+  const uint8_t* col[MAX_COLUMNS];
+  for (size_t i = 0; i < ncol; ++i) {
+    if (n[i] > (size_t)(end - d)) return false;
+    col[i] = d;
+    d += n[i];
+  }
+
+  if ((columns & COL_T) && out.t && !decodeTime(col[0], n[0], rows, out.t)) return false;
+  if ((columns & COL_DUR) && out.dur && !decodeDur(col[1], n[1], rows, out.dur)) return false;
+  for (size_t c = 0; c < channels; ++c) {
+    if ((columns & colChannel(c)) && out.ch[c] && !decodeFloat(col[2 + c], n[2 + c], rows, out.ch[c])) {
+      return false;
+    }
+  }
+  if ((columns & COL_STATUS) && out.status && !decodeStatus(col[2 + channels], n[2 + channels], rows, out.status)) {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace BlockCodec
@@ -0,0 +1,85 @@
+/*
+  ---------------------------------------------------------------------------
+  BlockCodec – Compression of Sealed CaptureStore Blocks
+  ---------------------------------------------------------------------------
+
+  Each sealed block (BLOCK_SAMPLES rows) is encoded on its own, so any
+  block decodes without its neighbours and a range read only touches the
+  blocks it needs. Columns are stored back to back with their byte
+  lengths up front, so a reader can decode a single channel.
+
+    u8  version      CODEC_VERSION
+    u8  channels
+    u16 rows
+    u32 columnBytes[2 + channels + 1]   t_us, dur_us, channels..., status
+    column payloads, in the same order
+
+  Column encodings (all little-endian, bit streams LSB first):
+
+    t_us     u64 t0, u64 zigzag(t1 - t0), then zigzag delta-of-delta of
+             the rest in frames. The device period is 100 µs with a few
+             µs of jitter, so most frames pack to 2–4 bits per row.
+    dur_us   zigzag delta from the previous row, in frames (mostly 0 bits)
+    channel  Gorilla XOR on the float32 bit pattern: '0' repeats the
+             previous value; '10' + bits reuses the previous leading/
+             trailing-zero window; '11' + 5-bit leading zeros + 5-bit
+             (length - 1) + the meaningful bits opens a new window.
+    status   (u8 value, u16 run) pairs
+
+  A frame is up to FRAME_VALUES values: u8 bit width, then the values
+  packed at that width, padded to a byte. One outlier (a gap or a time
+  step) only widens its own frame.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace BlockCodec {
+
+static const uint8_t CODEC_VERSION = 1;
+static const size_t FRAME_VALUES = 128;
+static const size_t MAX_COLUMNS = 2 + 16 + 1;
+
+// Column selection for decode(): bit 0 t_us, bit 1 dur_us, bit 2 status,
+// bit 3 + c channel c
+static const uint32_t COL_T = 1u << 0;
+static const uint32_t COL_DUR = 1u << 1;
+static const uint32_t COL_STATUS = 1u << 2;
+inline uint32_t colChannel(size_t c) { return 1u << (3 + c); }
+static const uint32_t COL_ALL = 0xFFFFFFFFu;
+
+struct ColumnsIn {
+  const uint64_t* t;
+  const uint16_t* dur;
+  const float* ch[16];
+  const uint8_t* status;
+  size_t channels;
+};
+
+// Unselected or null destinations are skipped without decoding
+struct ColumnsOut {
+  uint64_t* t;
+  uint16_t* dur;
+  float* ch[16];
+  uint8_t* status;
+};
+
+// Upper bound of encode() output for `rows` rows
+size_t maxEncodedBytes(size_t rows, size_t channels);
+
+// Encode `rows` rows (1..65535); returns the bytes written to `out`
+size_t encode(const ColumnsIn& in, size_t rows, uint8_t* out);
+
+// Row and channel count of an encoded block; false if it is not one
+bool peek(const uint8_t* in, size_t len, size_t& rows, size_t& channels);
+
+// Decode the selected columns; false on a malformed block
+bool decode(const uint8_t* in, size_t len, uint32_t columns, ColumnsOut& out);
+
+}  // namespace BlockCodec
+
+#endif // BLOCK_CODEC_H
@@ -0,0 +1,233 @@
+#include "CaptureExport.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace CaptureExport {
+
+namespace {
+
+using CaptureStore::BLOCK_SAMPLES;
+using CaptureStore::BlockView;
+
+inline char* putInt(char* p, uint64_t v) {
+  return std::to_chars(p, p + 20, v).ptr;
+}
+
+// Python f"{v:.4f}" of a float32 widened to double. A float32 (24-bit
+// mantissa) times 10^4 is exact in a double, so rounding that product half
+// to even is the correctly rounded 4-decimal result; larger values and
+// non-finite ones go through to_chars.
+inline char* putFixed4(char* p, float f) {
+  if (std::isnan(f)) {
+    memcpy(p, "nan", 3);
+    return p + 3;
+  }
+  const double x = (double)f * 10000.0;
+  if (!(std::fabs(x) < 1e18)) return std::to_chars(p, p + 48, (double)f, std::chars_format::fixed, 4).ptr;
+
+  if (std::signbit(f)) *p++ = '-';
+  const uint64_t q = (uint64_t)std::nearbyint(std::fabs(x));
+  p = std::to_chars(p, p + 20, q / 10000).ptr;
+  uint32_t frac = (uint32_t)(q % 10000);
+  for (int i = 4; i >= 1; --i, frac /= 10) p[i] = (char)('0' + frac % 10);
+  p[0] = '.';
+  return p + 5;
+}
+
+inline char* put6(char* p, uint32_t v) {
+  for (int i = 5; i >= 0; --i, v /= 10) p[i] = (char)('0' + v % 10);
+  return p + 6;
+}
+
+void formatTime(const struct tm& tm, char* out) {
+  char tmp[32];
+  strftime(tmp, sizeof(tmp), "%Y-%m-%d %H:%M:%S", &tm);
+  memcpy(out, tmp, 19);
+}
+
+}  // namespace
+
+Exporter::Exporter(const CaptureStore::Reader& store)
+  : _store(store), _buf(BUFFER_BYTES), _used(0), _fd(-1), _stats{0, 0}, _second(-1) {}
+
+size_t Exporter::csvHeader(char* out) const {
+  static const char* const TIME_FIELDS = "timestamp,sample_timestamp_us,sample_timestamp_us_end,sample_timestamp_iso";
+  char* p = out;
+  const size_t n = strlen(TIME_FIELDS);
+  memcpy(p, TIME_FIELDS, n);
+  p += n;
+  for (size_t c = 0; c < _store.channelCount(); ++c) {
+    const char* name = _store.channelName(c);
+    const size_t len = strnlen(name, CaptureStore::CHANNEL_NAME_LEN);
+    *p++ = ',';
+    memcpy(p, name, len);
+    p += len;
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  return (size_t)(p - out);
+}
+
+size_t Exporter::csvRow(const BlockView& v, size_t i, char* out) {
+  const uint64_t t = v.t[i];
+  const int64_t sec = (int64_t)(t / 1000000);
+  const uint32_t us = (uint32_t)(t % 1000000);
+  if (sec != _second) {
+    // Whole-second strings change once per 10k rows at 10 kHz
+    const time_t tt = (time_t)sec;
+    struct tm tm;
+    localtime_r(&tt, &tm);
+    formatTime(tm, _local);
+    gmtime_r(&tt, &tm);
+    formatTime(tm, _utc);
+    _second = sec;
+  }
+
+  char* p = out;
+  memcpy(p, _local, 19);
+  p += 19;
+  *p++ = '.';
+  p = put6(p, us);
+  *p++ = ',';
+  p = putInt(p, t);
+  *p++ = ',';
+  if (v.dur[i] != CaptureStore::DUR_NONE) p = putInt(p, t + v.dur[i]);
+  *p++ = ',';
+  memcpy(p, _utc, 19);
+  p += 19;
+  *p++ = '.';
+  p = put6(p, us);
+  *p++ = 'Z';
+  if (v.status[i] & CaptureStore::STATUS_GAP) {
+    // Gap marker: the row keeps its time, the channels stay empty
+    for (size_t c = 0; c < _store.channelCount(); ++c) *p++ = ',';
+  } else {
+    // A NaN channel has no data in this row (decimated between outputs)
+    for (size_t c = 0; c < _store.channelCount(); ++c) {
+      *p++ = ',';
+      if (!std::isnan(v.ch[c][i])) p = putFixed4(p, v.ch[c][i]);
+    }
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  return (size_t)(p - out);
+}
+
+bool Exporter::put(const char* p, size_t n) {
+  if (_used + n > _buf.size() && !flush()) return false;
+  memcpy(_buf.data() + _used, p, n);
+  _used += n;
+  return true;
+}
+
+bool Exporter::flush() {
+  size_t done = 0;
+  while (done < _used) {
+    const ssize_t n = ::write(_fd, _buf.data() + done, _used - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      _error = std::string("write: ") + strerror(errno);
+      return false;
+    }
+    done += (size_t)n;
+  }
+  _stats.bytes += _used;
+  _used = 0;
+  return true;
+}
+
+bool Exporter::write(int fd, Format format, uint64_t first, uint64_t last, uint64_t maxBytes) {
+  _fd = fd;
+  _used = 0;
+  _stats = Stats{0, 0};
+  if (last > _store.size()) last = _store.size();
+  if (first > last) first = last;
+  const bool ok = format == Format::CSV ? writeCsv(first, last, maxBytes) : writeBinary(first, last);
+  return ok && flush();
+}
+
+// First row of the newest slice of [first, last) that fits in budget bytes
+uint64_t Exporter::csvStart(uint64_t first, uint64_t last, uint64_t budget) {
+  char line[MAX_CSV_ROW];
+  uint64_t row = last;
+  while (row > first) {
+    BlockView v;
+    const uint64_t b = (row - 1) / BLOCK_SAMPLES;
+    if (!_store.block(b, v)) break;
+    const uint64_t lo = std::max<uint64_t>(first, v.first);
+    for (; row > lo; --row) {
+      const size_t n = csvRow(v, (size_t)(row - 1 - v.first), line);
+      if (n > budget) return row;
+      budget -= n;
+    }
+  }
+  return row;
+}
+
+bool Exporter::writeCsv(uint64_t first, uint64_t last, uint64_t maxBytes) {
+  char line[MAX_CSV_ROW];
+  const size_t headerBytes = csvHeader(line);
+  if (!put(line, headerBytes)) return false;
+  if (maxBytes) first = csvStart(first, last, maxBytes > headerBytes ? maxBytes - headerBytes : 0);
+
+  for (uint64_t row = first; row < last;) {
+    BlockView v;
+    if (!_store.block(row / BLOCK_SAMPLES, v)) {
+      _error = _store.error();
+      return false;
+    }
+    const uint64_t end = std::min<uint64_t>(last, v.first + v.rows);
+    for (; row < end; ++row) {
+      if (_used + MAX_CSV_ROW > _buf.size() && !flush()) return false;
+      _used += csvRow(v, (size_t)(row - v.first), _buf.data() + _used);
+    }
+  }
+  _stats.rows = last - first;
+  return true;
+}
+
+bool Exporter::writeBinary(uint64_t first, uint64_t last) {
+  const size_t channels = _store.channelCount();
+  BinaryHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, BINARY_MAGIC, sizeof(hdr.magic));
+  hdr.version = BINARY_VERSION;
+  hdr.channelCount = (uint32_t)channels;
+  hdr.rowBytes = (uint32_t)(17 + 4 * channels);
+  hdr.rows = last - first;
+  for (size_t c = 0; c < channels; ++c) {
+    strncpy(hdr.channelNames[c], _store.channelName(c), CaptureStore::CHANNEL_NAME_LEN - 1);
+  }
+  if (!put(reinterpret_cast<const char*>(&hdr), sizeof(hdr))) return false;
+
+  for (uint64_t row = first; row < last;) {
+    BlockView v;
+    if (!_store.block(row / BLOCK_SAMPLES, v)) {
+      _error = _store.error();
+      return false;
+    }
+    const uint64_t end = std::min<uint64_t>(last, v.first + v.rows);
+    for (; row < end; ++row) {
+      if (_used + hdr.rowBytes > _buf.size() && !flush()) return false;
+      char* p = _buf.data() + _used;
+      const size_t i = (size_t)(row - v.first);
+      const uint64_t tEnd = v.dur[i] == CaptureStore::DUR_NONE ? 0 : v.t[i] + v.dur[i];
+      memcpy(p, &v.t[i], 8);
+      memcpy(p + 8, &tEnd, 8);
+      for (size_t c = 0; c < channels; ++c) memcpy(p + 16 + 4 * c, &v.ch[c][i], 4);
+      p[16 + 4 * channels] = (char)v.status[i];
+      _used += hdr.rowBytes;
+    }
+  }
+  _stats.rows = last - first;
+  return true;
+}
+
+}  // namespace CaptureExport
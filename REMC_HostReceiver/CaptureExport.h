@@ -0,0 +1,103 @@
+/*
+  ---------------------------------------------------------------------------
+  CaptureExport – CSV and Binary Export of CaptureStore Rows (host)
+  ---------------------------------------------------------------------------
+
+  Streams a row range of a store to a file descriptor through one
+  preallocated buffer, formatting numbers with std::to_chars (C++17).
+
+  CSV is byte-compatible with REMC_FlaskApp.py /download_csv and
+  /download_batch (csv.DictWriter over LOGGING_DATA_FIELDS, "\r\n" line
+  ends):
+
+    timestamp                 local time, %Y-%m-%d %H:%M:%S.%f
+    sample_timestamp_us       integer
+    sample_timestamp_us_end   integer, empty when the store has none
+    sample_timestamp_iso      UTC, %Y-%m-%d %H:%M:%S.ffffffZ
+    <channel>...              f"{v:.4f}" of the float32 value, empty on
+                              gap rows (CaptureStore::STATUS_GAP) and
+                              where the channel is NaN (a decimated
+                              channel between outputs)
+
+  Binary is a BinaryHeader followed by packed little-endian rows:
+
+    u64 t_us, u64 t_us_end (0: none), f32 channel[channelCount], u8 status
+                              (bit 7: gap, channels NaN)
+
+  i.e. numpy dtype [('t_us','<u8'),('t_us_end','<u8'),(<name>,'<f4')...,
+  ('status','u1')] at offset sizeof(BinaryHeader).
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef CAPTURE_EXPORT_H
+#define CAPTURE_EXPORT_H
+
+#include "CaptureStore.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace CaptureExport {
+
+enum class Format { CSV, BINARY };
+
+static const char BINARY_MAGIC[8] = { 'R', 'E', 'M', 'C', 'R', 'O', 'W', '1' };
+static const uint32_t BINARY_VERSION = 1;
+static const size_t BUFFER_BYTES = 1u << 20;
+static const size_t MAX_CSV_ROW = 64 + 3 * 20 + CaptureStore::MAX_CHANNELS * 48;
+
+struct BinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t channelCount;
+  uint32_t rowBytes;         // 17 + 4 * channelCount
+  uint32_t reserved0;
+  uint64_t rows;
+  char channelNames[CaptureStore::MAX_CHANNELS][CaptureStore::CHANNEL_NAME_LEN];
+};
+
+struct Stats {
+  uint64_t rows;
+  uint64_t bytes;
+};
+
+class Exporter {
+public:
+  explicit Exporter(const CaptureStore::Reader& store);
+
+  // Rows [first, last) to fd. maxBytes > 0 caps the output like the Flask
+  // download: the newest rows whose CSV fits under the cap, header included.
+  bool write(int fd, Format format, uint64_t first, uint64_t last, uint64_t maxBytes = 0);
+
+  const Stats& stats() const { return _stats; }
+  const std::string& error() const { return _error; }
+
+  // One CSV line (header or row) into out (MAX_CSV_ROW bytes); returns its length
+  size_t csvHeader(char* out) const;
+  size_t csvRow(const CaptureStore::BlockView& v, size_t i, char* out);
+
+private:
+  bool put(const char* p, size_t n);
+  bool flush();
+  bool writeCsv(uint64_t first, uint64_t last, uint64_t maxBytes);
+  bool writeBinary(uint64_t first, uint64_t last);
+  uint64_t csvStart(uint64_t first, uint64_t last, uint64_t budget);
+
+  const CaptureStore::Reader& _store;
+  std::vector<char> _buf;
+  size_t _used;
+  int _fd;
+  Stats _stats;
+  std::string _error;
+
+  // Formatted date and time of the last whole second seen
+  int64_t _second;
+  char _local[19];
+  char _utc[19];
+};
+
+}  // namespace CaptureExport
+
+#endif // CAPTURE_EXPORT_H
@@ -0,0 +1,936 @@
+#include "CaptureStore.h"
+#include "IoRing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/falloc.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define CAPTURE_STORE_SSE2 1
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+namespace CaptureStore {
+
+const char* const DEFAULT_CHANNELS[] = {
+  "switch_voltage_kv", "switch_current_a", "output_voltage_a_kv",
+  "output_voltage_b_kv", "temperature_1_degc"
+};
+
+std::vector<std::string> columnFiles(const StoreHeader& hdr) {
+  std::vector<std::string> files;
+  files.push_back("t_us.u64");
+  files.push_back("dur_us.u16");
+  for (uint32_t i = 0; i < hdr.channelCount && i < MAX_CHANNELS; ++i) {
+    std::string name(hdr.channelNames[i], strnlen(hdr.channelNames[i], CHANNEL_NAME_LEN));
+    files.push_back(name + ".f32");
+  }
+  files.push_back("status.u8");
+  return files;
+}
+
+namespace {
+
+// Min and max of x[0, rows) and the first row of each; NaN never compares,
+// so it is skipped. SSE2 keeps eight lanes, each with its own first row, and
+// ties between lanes go to the lower row: the same bytes as the scalar loop
+// in a third of the time.
+ChannelRange rangeOf(const float* x, uint32_t rows) {
+  float mn = INFINITY, mx = -INFINITY;
+  uint32_t mnRow = 0, mxRow = 0, i = 0;
+#ifdef CAPTURE_STORE_SSE2
+  if (rows >= 8) {
+    __m128 lo[2] = { _mm_set1_ps(INFINITY), _mm_set1_ps(INFINITY) };
+    __m128 hi[2] = { _mm_set1_ps(-INFINITY), _mm_set1_ps(-INFINITY) };
+    __m128i loRow[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+    __m128i hiRow[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+    __m128i row[2] = { _mm_setr_epi32(0, 1, 2, 3), _mm_setr_epi32(4, 5, 6, 7) };
+    const __m128i step = _mm_set1_epi32(8);
+    for (; i + 8 <= rows; i += 8) {
+      for (int k = 0; k < 2; ++k) {
+        const __m128 xi = _mm_loadu_ps(x + i + 4 * k);
+        // _mm_min_ps(a, b) is a < b ? a : b, the same select as the scalar loop
+        const __m128i l = _mm_castps_si128(_mm_cmplt_ps(xi, lo[k]));
+        const __m128i h = _mm_castps_si128(_mm_cmpgt_ps(xi, hi[k]));
+        lo[k] = _mm_min_ps(xi, lo[k]);
+        hi[k] = _mm_max_ps(xi, hi[k]);
+        loRow[k] = _mm_or_si128(_mm_and_si128(l, row[k]), _mm_andnot_si128(l, loRow[k]));
+        hiRow[k] = _mm_or_si128(_mm_and_si128(h, row[k]), _mm_andnot_si128(h, hiRow[k]));
+        row[k] = _mm_add_epi32(row[k], step);
+      }
+    }
+    float lanesLo[8], lanesHi[8];
+    uint32_t rowsLo[8], rowsHi[8];
+    for (int k = 0; k < 2; ++k) {
+      _mm_storeu_ps(lanesLo + 4 * k, lo[k]);
+      _mm_storeu_ps(lanesHi + 4 * k, hi[k]);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(rowsLo + 4 * k), loRow[k]);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(rowsHi + 4 * k), hiRow[k]);
+    }
+    mn = lanesLo[0];
+    mx = lanesHi[0];
+    mnRow = rowsLo[0];
+    mxRow = rowsHi[0];
+    for (int j = 1; j < 8; ++j) {
+      if (lanesLo[j] < mn || (lanesLo[j] == mn && rowsLo[j] < mnRow)) {
+        mn = lanesLo[j];
+        mnRow = rowsLo[j];
+      }
+      if (lanesHi[j] > mx || (lanesHi[j] == mx && rowsHi[j] < mxRow)) {
+        mx = lanesHi[j];
+        mxRow = rowsHi[j];
+      }
+    }
+  }
+#endif
+  for (; i < rows; ++i) {
+    const float xi = x[i];
+    const bool lo = xi < mn, hi = xi > mx;
+    mn = lo ? xi : mn;
+    mnRow = lo ? i : mnRow;
+    mx = hi ? xi : mx;
+    mxRow = hi ? i : mxRow;
+  }
+  const ChannelRange r = { mn, mx, (uint16_t)mnRow, (uint16_t)mxRow };
+  return r;
+}
+
+}  // namespace
+
+uint32_t summarize(const BlockView& v, size_t channels, uint8_t* out) {
+  const uint32_t chunks = (v.rows + CHUNK_ROWS - 1) / CHUNK_ROWS;
+  for (uint32_t k = 0; k < chunks; ++k) {
+    const uint32_t first = k * CHUNK_ROWS;
+    const uint32_t rows = std::min<uint32_t>(CHUNK_ROWS, v.rows - first);
+    ChunkHeader h = { v.t[first], v.t[first + rows - 1], rows, 0 };
+    memcpy(out, &h, sizeof(h));
+    ChannelRange* ranges = reinterpret_cast<ChannelRange*>(out + sizeof(h));
+    for (size_t c = 0; c < channels; ++c) {
+      const ChannelRange r = rangeOf(v.ch[c] + first, rows);
+      memcpy(&ranges[c], &r, sizeof(r));
+    }
+    out += chunkBytes(channels);
+  }
+  return chunks;
+}
+
+namespace {
+
+const char* META_FILE = "store.meta";
+const char* INDEX_FILE = "blocks.idx";
+const char* DATA_FILE = "blocks.dat";
+const char* SUMMARY_FILE = "blocks.sum";
+
+std::vector<size_t> columnWidths(size_t channels) {
+  std::vector<size_t> w;
+  w.push_back(sizeof(uint64_t));
+  w.push_back(sizeof(uint16_t));
+  for (size_t i = 0; i < channels; ++i) w.push_back(sizeof(float));
+  w.push_back(sizeof(uint8_t));
+  return w;
+}
+
+std::string sysError(const std::string& what, const std::string& path) {
+  return what + " " + path + ": " + strerror(errno);
+}
+
+uint64_t unixMicros() {
+  timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint64_t)tv.tv_sec * 1000000ull + (uint64_t)tv.tv_usec;
+}
+
+uint8_t* mapFile(int fd, size_t bytes, bool writable) {
+  if (bytes == 0) return nullptr;
+  void* p = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  return p == MAP_FAILED ? nullptr : static_cast<uint8_t*>(p);
+}
+
+// Fault the pages of [from, to) in with one call instead of one page fault
+// per page as the rows are written, which costs more than decoding them.
+// Best effort: kernels before 5.14 reject MADV_POPULATE_WRITE and the pages
+// fault in as before. Pages past the last row are dropped by close().
+void prefault(uint8_t* base, size_t from, size_t to) {
+#ifdef MADV_POPULATE_WRITE
+  static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  from &= ~(page - 1);
+  if (to > from) madvise(base + from, to - from, MADV_POPULATE_WRITE);
+#else
+  (void)base;
+  (void)from;
+  (void)to;
+#endif
+}
+
+bool validHeader(const StoreHeader* h) {
+  return h && memcmp(h->magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0 && h->version == STORE_VERSION &&
+         h->channelCount > 0 && h->channelCount <= MAX_CHANNELS && h->blockSamples == BLOCK_SAMPLES;
+}
+
+}  // namespace
+
+// ====================== Writer ======================
+
+Writer::Writer()
+  : _io(nullptr), _metaFd(-1), _indexFd(-1), _dataFd(-1), _summaryFd(-1), _hdr(nullptr), _channels(0),
+    _compressed(false), _count(0), _capacity(0), _dataBytes(0), _maxT(0), _outOfOrder(0), _blockFirstT(0) {}
+
+Writer::~Writer() {
+  close();
+}
+
+bool Writer::create(const std::string& dir, const std::vector<std::string>& channels, uint32_t flags) {
+  close();
+  if (channels.empty() || channels.size() > MAX_CHANNELS) {
+    _error = "channel count must be 1.." + std::to_string(MAX_CHANNELS);
+    return false;
+  }
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    _error = sysError("mkdir", dir);
+    return false;
+  }
+  _dir = dir;
+  const std::string metaPath = dir + "/" + META_FILE;
+  _metaFd = ::open(metaPath.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (_metaFd < 0) {
+    _error = sysError("create", metaPath);
+    return false;
+  }
+
+  StoreHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, STORE_MAGIC, sizeof(hdr.magic));
+  hdr.version = STORE_VERSION;
+  hdr.channelCount = (uint32_t)channels.size();
+  hdr.blockSamples = BLOCK_SAMPLES;
+  hdr.flags = flags;
+  hdr.createdUnixUs = unixMicros();
+  for (size_t i = 0; i < channels.size(); ++i) {
+    strncpy(hdr.channelNames[i], channels[i].c_str(), CHANNEL_NAME_LEN - 1);
+  }
+  if (pwrite(_metaFd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+    _error = sysError("write", metaPath);
+    close();
+    return false;
+  }
+  return mapAll(true);
+}
+
+bool Writer::open(const std::string& dir) {
+  close();
+  _dir = dir;
+  const std::string metaPath = dir + "/" + META_FILE;
+  _metaFd = ::open(metaPath.c_str(), O_RDWR);
+  if (_metaFd < 0) {
+    _error = sysError("open", metaPath);
+    return false;
+  }
+  return mapAll(false);
+}
+
+bool Writer::mapAll(bool create) {
+  const std::string metaPath = _dir + "/" + META_FILE;
+  _hdr = reinterpret_cast<StoreHeader*>(mapFile(_metaFd, sizeof(StoreHeader), true));
+  if (!validHeader(_hdr)) {
+    _error = metaPath + ": not a version " + std::to_string(STORE_VERSION) + " capture store";
+    if (_hdr) munmap(_hdr, sizeof(StoreHeader));
+    _hdr = nullptr;
+    close();
+    return false;
+  }
+
+  _channels = _hdr->channelCount;
+  _compressed = (_hdr->flags & STORE_COMPRESSED) != 0;
+  _count = _hdr->committed;
+  _outOfOrder = _hdr->outOfOrder;
+
+  const std::string indexPath = _dir + "/" + INDEX_FILE;
+  _indexFd = ::open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (_indexFd < 0) {
+    _error = sysError("open", indexPath);
+    close();
+    return false;
+  }
+  const std::string summaryPath = _dir + "/" + SUMMARY_FILE;
+  _summaryFd = ::open(summaryPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (_summaryFd < 0) {
+    _error = sysError("open", summaryPath);
+    close();
+    return false;
+  }
+  _summaryBuf.resize(summaryBytes(_channels));
+  if (_compressed) {
+    const std::string dataPath = _dir + "/" + DATA_FILE;
+    _dataFd = ::open(dataPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_dataFd < 0) {
+      _error = sysError("open", dataPath);
+      close();
+      return false;
+    }
+    _encodeBuf.resize(BlockCodec::maxEncodedBytes(BLOCK_SAMPLES, _channels));
+  }
+
+  // Capacity is what every column file actually holds (a crash can leave
+  // the header ahead of a file that was never grown)
+  const std::vector<std::string> files = columnFiles(*_hdr);
+  const std::vector<size_t> widths = columnWidths(_channels);
+  uint64_t capacity = create ? 0 : UINT64_MAX;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const std::string path = _dir + "/" + files[i];
+    Column c = { -1, nullptr, widths[i] };
+    c.fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (c.fd < 0) {
+      _error = sysError("open", path);
+      close();
+      return false;
+    }
+    struct stat st;
+    fstat(c.fd, &st);
+    capacity = std::min<uint64_t>(capacity, (uint64_t)st.st_size / c.width);
+    _cols.push_back(c);
+  }
+
+  // Sealed blocks that made it into the index; a crash between sealing and
+  // publishing can leave the count behind the index, never ahead of it
+  std::vector<BlockIndex> blocks;
+  struct stat ist;
+  fstat(_indexFd, &ist);
+  blocks.resize((size_t)ist.st_size / sizeof(BlockIndex));
+  if (!blocks.empty() &&
+      pread(_indexFd, blocks.data(), blocks.size() * sizeof(BlockIndex), 0) != (ssize_t)(blocks.size() * sizeof(BlockIndex))) {
+    blocks.clear();
+  }
+  if (_count > capacity) _count = capacity;
+  const uint64_t sealed = std::min<uint64_t>(_count / BLOCK_SAMPLES, blocks.size());
+  if (_count > (sealed + 1) * BLOCK_SAMPLES) _count = sealed * BLOCK_SAMPLES;
+
+  _capacity = 0;
+  if (!grow(std::max<uint64_t>(_count, 1))) return false;
+
+  // Running maximum, block start and encoded size for appends
+  const uint64_t* t = reinterpret_cast<const uint64_t*>(_cols[0].base);
+  _maxT = sealed > 0 ? blocks[sealed - 1].tMax : 0;
+  _dataBytes = 0;
+  for (uint64_t b = 0; b < sealed; ++b) {
+    if (blocks[b].bytes) _dataBytes = std::max<uint64_t>(_dataBytes, blocks[b].offset + blocks[b].bytes);
+  }
+  for (uint64_t i = sealed * BLOCK_SAMPLES; i < _count; ++i) _maxT = std::max(_maxT, t[i]);
+  _blockFirstT = sealed * BLOCK_SAMPLES < _count ? t[sealed * BLOCK_SAMPLES] : 0;
+
+  // Catch up on punching that a previous writer did not get to
+  if (_compressed) {
+    for (uint64_t b = 0; b + PUNCH_LAG_BLOCKS < sealed; ++b) {
+      if (blocks[b].bytes) punchBlock(b);
+    }
+  }
+  publish();
+  return true;
+}
+
+bool Writer::grow(uint64_t minCapacity) {
+  uint64_t capacity = _capacity;
+  while (capacity < minCapacity) capacity += GROW_SAMPLES;
+  if (capacity == _capacity) return true;
+
+  const std::vector<std::string> files = columnFiles(*_hdr);
+  for (size_t i = 0; i < _cols.size(); ++i) {
+    Column& c = _cols[i];
+    if (ftruncate(c.fd, (off_t)(capacity * c.width)) != 0) {
+      _error = sysError("grow", _dir + "/" + files[i]);
+      return false;
+    }
+    if (c.base) munmap(c.base, _capacity * c.width);
+    c.base = mapFile(c.fd, capacity * c.width, true);
+    if (!c.base) {
+      _error = sysError("mmap", _dir + "/" + files[i]);
+      close();
+      return false;
+    }
+    prefault(c.base, _capacity * c.width, capacity * c.width);
+  }
+  _capacity = capacity;
+  _hdr->capacity = capacity;
+  return true;
+}
+
+bool Writer::append(const Record& r) {
+  return append(&r, 1);
+}
+
+bool Writer::append(const Record* r, size_t n) {
+  BlockCodec::ColumnsOut out;
+  if (!reserve(n, out)) return false;
+  if (n == 0) return true;
+
+  // Column at a time: each column file is written sequentially
+  for (size_t i = 0; i < n; ++i) out.t[i] = r[i].tUs;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t d = r[i].tUsEnd - r[i].tUs;
+    out.dur[i] = (r[i].tUsEnd < r[i].tUs || d >= DUR_NONE) ? DUR_NONE : (uint16_t)d;
+  }
+  for (size_t c = 0; c < _channels; ++c) {
+    float* v = out.ch[c];
+    for (size_t i = 0; i < n; ++i) v[i] = r[i].ch[c];
+  }
+  for (size_t i = 0; i < n; ++i) out.status[i] = r[i].status;
+  commit(n);
+  return true;
+}
+
+bool Writer::reserve(size_t n, BlockCodec::ColumnsOut& out) {
+  memset(&out, 0, sizeof(out));
+  if (!_hdr) return false;
+  if (_count + n > _capacity && !grow(_count + n)) return false;
+  const uint64_t at = _count;
+  out.t = reinterpret_cast<uint64_t*>(_cols[0].base) + at;
+  out.dur = reinterpret_cast<uint16_t*>(_cols[1].base) + at;
+  for (size_t c = 0; c < _channels; ++c) out.ch[c] = reinterpret_cast<float*>(_cols[2 + c].base) + at;
+  out.status = _cols[2 + _channels].base + at;
+  return true;
+}
+
+void Writer::commit(size_t n) {
+  if (!_hdr || n == 0) return;
+  const uint64_t at = _count;
+  const uint64_t* t = reinterpret_cast<const uint64_t*>(_cols[0].base) + at;
+
+  // Time order and block index
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t row = at + i;
+    const uint64_t ts = t[i];
+    if (row % BLOCK_SAMPLES == 0) _blockFirstT = ts;
+    if (ts < _maxT) _outOfOrder++;
+    else _maxT = ts;
+    if ((row + 1) % BLOCK_SAMPLES == 0) {
+      _count = row + 1;
+      sealBlock();
+    }
+  }
+  _count = at + n;
+  publish();
+}
+
+void Writer::sealBlock() {
+  const uint64_t block = _count / BLOCK_SAMPLES - 1;
+  // `raw` is what the index says if the summary or the encoded block is lost
+  const BlockIndex raw = { _blockFirstT, _maxT, 0, 0, 0 };
+  BlockIndex e = raw;
+  e.flags = BLOCK_SUMMARIZED;
+  summarizeBlock(block);
+
+  size_t encoded = 0;
+  if (_compressed) {
+    const uint64_t first = block * BLOCK_SAMPLES;
+    BlockCodec::ColumnsIn in;
+    in.t = reinterpret_cast<const uint64_t*>(_cols[0].base) + first;
+    in.dur = reinterpret_cast<const uint16_t*>(_cols[1].base) + first;
+    for (size_t c = 0; c < _channels; ++c) in.ch[c] = reinterpret_cast<const float*>(_cols[2 + c].base) + first;
+    in.status = _cols[2 + _channels].base + first;
+    in.channels = _channels;
+    encoded = BlockCodec::encode(in, BLOCK_SAMPLES, _encodeBuf.data());
+    e.offset = (_dataBytes + DATA_ALIGN - 1) / DATA_ALIGN * DATA_ALIGN;
+    e.bytes = (uint32_t)encoded;
+  }
+
+  const size_t summaryN = _summaryBuf.size();
+  if (_io) {
+    // One chain: the index entry lands only after its summary and block
+    _io->write(_summaryFd, _summaryBuf.data(), summaryN, block * summaryN, IoRing::LINK);
+    if (encoded) _io->write(_dataFd, _encodeBuf.data(), encoded, e.offset, IoRing::LINK);
+    _io->write(_indexFd, &e, sizeof(e), block * sizeof(BlockIndex), 0, &raw);
+    if (encoded) _dataBytes = e.offset + encoded;
+  } else {
+    if (pwrite(_summaryFd, _summaryBuf.data(), summaryN, (off_t)(block * summaryN)) != (ssize_t)summaryN) {
+      e.flags = 0;
+    }
+    // A failed write leaves the block raw (bytes = 0) and unpunched
+    if (encoded && pwrite(_dataFd, _encodeBuf.data(), encoded, (off_t)e.offset) == (ssize_t)encoded) {
+      _dataBytes = e.offset + encoded;
+    } else {
+      e.offset = 0;
+      e.bytes = 0;
+    }
+    pwrite(_indexFd, &e, sizeof(e), (off_t)(block * sizeof(BlockIndex)));
+  }
+
+  if (_compressed && block >= PUNCH_LAG_BLOCKS) {
+    const uint64_t old = block - PUNCH_LAG_BLOCKS;
+    BlockIndex oe;
+    if (pread(_indexFd, &oe, sizeof(oe), (off_t)(old * sizeof(BlockIndex))) == (ssize_t)sizeof(oe) && oe.bytes) {
+      punchBlock(old);
+    }
+  }
+}
+
+void Writer::summarizeBlock(uint64_t block) {
+  const uint64_t first = block * BLOCK_SAMPLES;
+  BlockView v;
+  memset(&v, 0, sizeof(v));
+  v.first = first;
+  v.rows = BLOCK_SAMPLES;
+  v.t = reinterpret_cast<const uint64_t*>(_cols[0].base) + first;
+  for (size_t c = 0; c < _channels; ++c) v.ch[c] = reinterpret_cast<const float*>(_cols[2 + c].base) + first;
+  summarize(v, _channels, _summaryBuf.data());
+}
+
+// Give the raw rows of an encoded block back to the filesystem; the file
+// size and every other row's offset are unchanged. Filesystems without
+// hole punching just keep the raw copy.
+void Writer::punchBlock(uint64_t block) {
+  for (Column& c : _cols) {
+    const off_t off = (off_t)(block * BLOCK_SAMPLES * c.width);
+    fallocate(c.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off, (off_t)(BLOCK_SAMPLES * c.width));
+  }
+}
+
+void Writer::publish() {
+  _hdr->outOfOrder = _outOfOrder;
+  __atomic_store_n(&_hdr->committed, _count, __ATOMIC_RELEASE);
+}
+
+void Writer::flush() {
+  if (!_hdr) return;
+  for (Column& c : _cols) msync(c.base, _count * c.width, MS_ASYNC);
+  msync(_hdr, sizeof(StoreHeader), MS_ASYNC);
+}
+
+bool Writer::sync() {
+  if (!_hdr) return false;
+  std::vector<int> fds;
+  for (const Column& c : _cols) fds.push_back(c.fd);
+  fds.push_back(_summaryFd);
+  if (_dataFd >= 0) fds.push_back(_dataFd);
+  fds.push_back(_indexFd);
+  if (_io) {
+    // After everything queued so far, one file at a time, the header last
+    for (size_t i = 0; i < fds.size(); ++i) _io->sync(fds[i], IoRing::LINK | (i == 0 ? IoRing::DRAIN : 0));
+    return _io->sync(_metaFd);
+  }
+  bool ok = true;
+  for (int fd : fds) ok = fdatasync(fd) == 0 && ok;
+  ok = fdatasync(_metaFd) == 0 && ok;
+  if (!ok) _error = sysError("fdatasync", _dir);
+  return ok;
+}
+
+void Writer::close() {
+  if (_io) _io->drain();
+  if (_hdr) {
+    // Trim the column files to the committed rows
+    for (Column& c : _cols) {
+      if (c.base) {
+        msync(c.base, _count * c.width, MS_SYNC);
+        munmap(c.base, _capacity * c.width);
+      }
+      if (c.fd >= 0) ftruncate(c.fd, (off_t)(_count * c.width));
+    }
+    if (_dataFd >= 0) fdatasync(_dataFd);
+    _hdr->capacity = _count;
+    publish();
+    msync(_hdr, sizeof(StoreHeader), MS_SYNC);
+    munmap(_hdr, sizeof(StoreHeader));
+    _hdr = nullptr;
+  }
+  for (Column& c : _cols) {
+    if (c.fd >= 0) ::close(c.fd);
+  }
+  _cols.clear();
+  if (_summaryFd >= 0) ::close(_summaryFd);
+  if (_dataFd >= 0) ::close(_dataFd);
+  if (_indexFd >= 0) ::close(_indexFd);
+  if (_metaFd >= 0) ::close(_metaFd);
+  _summaryFd = _dataFd = _indexFd = _metaFd = -1;
+  _count = _capacity = _dataBytes = 0;
+}
+
+// ====================== Reader ======================
+
+Reader::Reader()
+  : _metaFd(-1), _indexFd(-1), _dataFd(-1), _summaryFd(-1), _hdr(nullptr), _channels(0), _count(0), _mapped(0),
+    _data(nullptr), _dataMapped(0), _summaries(nullptr), _summariesMapped(0), _useClock(0) {
+  for (CacheSlot& s : _cache) {
+    s.block = UINT64_MAX;
+    s.columns = 0;
+    s.rows = 0;
+    s.lastUse = 0;
+  }
+}
+
+Reader::~Reader() {
+  close();
+}
+
+bool Reader::open(const std::string& dir) {
+  close();
+  _dir = dir;
+  const std::string metaPath = dir + "/" + META_FILE;
+  _metaFd = ::open(metaPath.c_str(), O_RDONLY);
+  if (_metaFd < 0) {
+    _error = sysError("open", metaPath);
+    return false;
+  }
+  _hdr = reinterpret_cast<const StoreHeader*>(mapFile(_metaFd, sizeof(StoreHeader), false));
+  if (!validHeader(_hdr)) {
+    _error = metaPath + ": not a version " + std::to_string(STORE_VERSION) + " capture store";
+    close();
+    return false;
+  }
+  _channels = _hdr->channelCount;
+
+  const std::string indexPath = dir + "/" + INDEX_FILE;
+  _indexFd = ::open(indexPath.c_str(), O_RDONLY);
+  if (_indexFd < 0) {
+    _error = sysError("open", indexPath);
+    close();
+    return false;
+  }
+  // Optional: stores without it are summarized on the fly
+  _summaryFd = ::open((dir + "/" + SUMMARY_FILE).c_str(), O_RDONLY);
+  if (compressed()) {
+    const std::string dataPath = dir + "/" + DATA_FILE;
+    _dataFd = ::open(dataPath.c_str(), O_RDONLY);
+    if (_dataFd < 0) {
+      _error = sysError("open", dataPath);
+      close();
+      return false;
+    }
+  }
+
+  const std::vector<std::string> files = columnFiles(*_hdr);
+  const std::vector<size_t> widths = columnWidths(_channels);
+  for (size_t i = 0; i < files.size(); ++i) {
+    const std::string path = dir + "/" + files[i];
+    Column c = { ::open(path.c_str(), O_RDONLY), nullptr, widths[i] };
+    if (c.fd < 0) {
+      _error = sysError("open", path);
+      close();
+      return false;
+    }
+    _cols.push_back(c);
+  }
+  refresh();
+  return true;
+}
+
+bool Reader::mapColumns(uint64_t capacity) {
+  const std::vector<std::string> files = columnFiles(*_hdr);
+  for (size_t i = 0; i < _cols.size(); ++i) {
+    Column& c = _cols[i];
+    struct stat st;
+    fstat(c.fd, &st);
+    const uint64_t rows = std::min<uint64_t>(capacity, (uint64_t)st.st_size / c.width);
+    if (rows < capacity) capacity = rows;
+  }
+  for (size_t i = 0; i < _cols.size(); ++i) {
+    Column& c = _cols[i];
+    if (c.base) munmap(c.base, _mapped * c.width);
+    c.base = mapFile(c.fd, capacity * c.width, false);
+    if (capacity && !c.base) {
+      _error = sysError("mmap", _dir + "/" + files[i]);
+      _mapped = 0;
+      return false;
+    }
+  }
+  _mapped = capacity;
+  return true;
+}
+
+uint64_t Reader::refresh() {
+  if (!_hdr) return 0;
+  uint64_t committed = __atomic_load_n(&_hdr->committed, __ATOMIC_ACQUIRE);
+  if (committed > _mapped) {
+    const uint64_t capacity = std::max(committed, _hdr->capacity);
+    if (!mapColumns(capacity)) return _count = 0;
+    committed = std::min(committed, _mapped);
+  }
+  _count = committed;
+
+  const uint64_t sealed = _count / BLOCK_SAMPLES;
+  if (sealed > _blocks.size()) {
+    const size_t have = _blocks.size();
+    _blocks.resize(sealed);
+    const ssize_t want = (ssize_t)((sealed - have) * sizeof(BlockIndex));
+    const ssize_t got = pread(_indexFd, &_blocks[have], want, (off_t)(have * sizeof(BlockIndex)));
+    if (got != want) _blocks.resize(have + (got > 0 ? got / sizeof(BlockIndex) : 0));
+  }
+  return _count;
+}
+
+const char* Reader::channelName(size_t i) const {
+  return i < _channels ? _hdr->channelNames[i] : "";
+}
+
+int Reader::channelIndex(const char* name) const {
+  for (size_t i = 0; i < _channels; ++i) {
+    if (strncmp(_hdr->channelNames[i], name, CHANNEL_NAME_LEN) == 0) return (int)i;
+  }
+  return -1;
+}
+
+bool Reader::compressed() const {
+  return _hdr && (_hdr->flags & STORE_COMPRESSED) != 0;
+}
+
+uint64_t Reader::outOfOrder() const {
+  return _hdr ? _hdr->outOfOrder : 0;
+}
+
+// blocks.dat only grows; remap it when an indexed block lies past the mapping
+bool Reader::mapData(uint64_t minBytes) const {
+  struct stat st;
+  fstat(_dataFd, &st);
+  const uint64_t bytes = (uint64_t)st.st_size;
+  if (bytes < minBytes) {
+    _error = _dir + "/" + DATA_FILE + ": shorter than its index";
+    return false;
+  }
+  if (_data) munmap(const_cast<uint8_t*>(_data), _dataMapped);
+  _data = mapFile(_dataFd, bytes, false);
+  _dataMapped = _data ? bytes : 0;
+  if (!_data) {
+    _error = sysError("mmap", _dir + "/" + DATA_FILE);
+    return false;
+  }
+  return true;
+}
+
+bool Reader::mapSummaries(uint64_t minBytes) const {
+  struct stat st;
+  if (_summaryFd < 0 || fstat(_summaryFd, &st) != 0 || (uint64_t)st.st_size < minBytes) return false;
+  if (_summaries) munmap(const_cast<uint8_t*>(_summaries), _summariesMapped);
+  _summaries = mapFile(_summaryFd, (size_t)st.st_size, false);
+  _summariesMapped = _summaries ? (uint64_t)st.st_size : 0;
+  return _summaries != nullptr;
+}
+
+bool Reader::summary(uint64_t b, SummaryView& s) const {
+  s.channels = _channels;
+  const uint64_t bytes = summaryBytes(_channels);
+  if (b < _blocks.size() && (_blocks[b].flags & BLOCK_SUMMARIZED) &&
+      ((b + 1) * bytes <= _summariesMapped || mapSummaries((b + 1) * bytes))) {
+    s.base = _summaries + b * bytes;
+    s.chunks = BLOCK_CHUNKS;
+    return true;
+  }
+
+  BlockView v;
+  uint32_t columns = BlockCodec::COL_T;
+  for (size_t c = 0; c < _channels; ++c) columns |= BlockCodec::colChannel(c);
+  if (!block(b, v, columns)) return false;
+  _summaryBuf.resize(bytes);
+  s.chunks = summarize(v, _channels, _summaryBuf.data());
+  s.base = _summaryBuf.data();
+  return true;
+}
+
+void Reader::rawView(uint64_t b, BlockView& v) const {
+  const uint64_t first = b * BLOCK_SAMPLES;
+  v.t = reinterpret_cast<const uint64_t*>(_cols[0].base) + first;
+  v.dur = reinterpret_cast<const uint16_t*>(_cols[1].base) + first;
+  for (size_t c = 0; c < _channels; ++c) v.ch[c] = reinterpret_cast<const float*>(_cols[2 + c].base) + first;
+  v.status = _cols[2 + _channels].base + first;
+}
+
+bool Reader::block(uint64_t b, BlockView& v, uint32_t columns) const {
+  if (b >= blockCount()) return false;
+  v.first = b * BLOCK_SAMPLES;
+  v.rows = (uint32_t)std::min<uint64_t>(BLOCK_SAMPLES, _count - v.first);
+  memset(v.ch, 0, sizeof(v.ch));
+
+  // Uncompressed stores are never punched: the columns are the rows
+  if (!compressed()) {
+    rawView(b, v);
+    return true;
+  }
+
+  // Open at the last refresh(), or not yet indexed then: it may have been
+  // sealed and punched since, however long ago that refresh() was
+  BlockIndex e = b < _blocks.size() ? _blocks[b] : BlockIndex();
+  if (e.bytes == 0) indexEntry(b, e);
+
+  const uint32_t valid = BlockCodec::COL_T | BlockCodec::COL_DUR | BlockCodec::COL_STATUS |
+                         (((1u << _channels) - 1) << 3);
+  CacheSlot* slot = nullptr;
+  for (CacheSlot& s : _cache) {
+    if (s.block == b) slot = &s;
+  }
+  if (!slot) {
+    slot = &_cache[0];
+    for (CacheSlot& s : _cache) {
+      if (s.lastUse < slot->lastUse) slot = &s;
+    }
+    slot->block = b;
+    slot->columns = 0;
+    slot->rows = 0;
+  }
+  slot->lastUse = ++_useClock;
+
+  if (e.bytes == 0) {
+    // Still raw: copy the rows out, then look at the entry again in case
+    // the block was sealed and punched while they were being copied
+    if (slot->rows != v.rows) {
+      slot->columns = 0;
+      slot->rows = v.rows;
+    }
+    const uint32_t missing = columns & valid & ~slot->columns;
+    if (missing) {
+      BlockView raw;
+      rawView(b, raw);
+      const size_t n = slot->rows;
+      if (missing & BlockCodec::COL_T) slot->t.assign(raw.t, raw.t + n);
+      if (missing & BlockCodec::COL_DUR) slot->dur.assign(raw.dur, raw.dur + n);
+      if (missing & BlockCodec::COL_STATUS) slot->status.assign(raw.status, raw.status + n);
+      for (size_t c = 0; c < _channels; ++c) {
+        if (missing & BlockCodec::colChannel(c)) slot->ch[c].assign(raw.ch[c], raw.ch[c] + n);
+      }
+      if (indexEntry(b, e)) {
+        slot->columns = 0;         // possibly zeros; decoded below
+      } else {
+        slot->columns |= missing;
+      }
+    }
+  }
+
+  if (e.bytes != 0) {
+    if (e.offset + e.bytes > _dataMapped && !mapData(e.offset + e.bytes)) {
+      slot->block = UINT64_MAX;
+      return false;
+    }
+    // A copied tail is replaced by the whole decoded block
+    if (slot->rows != BLOCK_SAMPLES) {
+      slot->columns = 0;
+      slot->rows = BLOCK_SAMPLES;
+    }
+    const uint32_t missing = columns & valid & ~slot->columns;
+    if (missing) {
+      BlockCodec::ColumnsOut out;
+      memset(&out, 0, sizeof(out));
+      if (missing & BlockCodec::COL_T) { slot->t.resize(BLOCK_SAMPLES); out.t = slot->t.data(); }
+      if (missing & BlockCodec::COL_DUR) { slot->dur.resize(BLOCK_SAMPLES); out.dur = slot->dur.data(); }
+      if (missing & BlockCodec::COL_STATUS) { slot->status.resize(BLOCK_SAMPLES); out.status = slot->status.data(); }
+      for (size_t c = 0; c < _channels; ++c) {
+        if (missing & BlockCodec::colChannel(c)) {
+          slot->ch[c].resize(BLOCK_SAMPLES);
+          out.ch[c] = slot->ch[c].data();
+        }
+      }
+      if (!BlockCodec::decode(_data + e.offset, e.bytes, missing, out)) {
+        _error = _dir + ": block " + std::to_string(b) + " does not decode";
+        slot->block = UINT64_MAX;
+        return false;
+      }
+      slot->columns |= missing;
+    }
+  }
+
+  const uint32_t have = slot->columns & columns;
+  v.t = (have & BlockCodec::COL_T) ? slot->t.data() : nullptr;
+  v.dur = (have & BlockCodec::COL_DUR) ? slot->dur.data() : nullptr;
+  v.status = (have & BlockCodec::COL_STATUS) ? slot->status.data() : nullptr;
+  for (size_t c = 0; c < _channels; ++c) {
+    v.ch[c] = (have & BlockCodec::colChannel(c)) ? slot->ch[c].data() : nullptr;
+  }
+  return true;
+}
+
+// blocks.idx entry of block b as it is now; true if it points at an encoded
+// block. Entries are written after their block, so one that does is readable.
+bool Reader::indexEntry(uint64_t b, BlockIndex& e) const {
+  BlockIndex now;
+  if (pread(_indexFd, &now, sizeof(now), (off_t)(b * sizeof(BlockIndex))) != (ssize_t)sizeof(now) ||
+      now.bytes == 0) {
+    return false;
+  }
+  e = now;
+  return true;
+}
+
+uint64_t Reader::lowerBound(uint64_t t) const {
+  if (_count == 0) return 0;
+
+  // First sealed block whose running maximum reaches t, else the tail block
+  const BlockIndex* e = std::lower_bound(_blocks.data(), _blocks.data() + _blocks.size(), t,
+                                         [](const BlockIndex& x, uint64_t v) { return x.tMax < v; });
+  const uint64_t b = (uint64_t)(e - _blocks.data());
+  BlockView v;
+  if (!block(b, v, BlockCodec::COL_T)) return _count;
+  return v.first + (uint64_t)(std::lower_bound(v.t, v.t + v.rows, t) - v.t);
+}
+
+void Reader::timeRange(uint64_t t0, uint64_t t1, uint64_t& first, uint64_t& last) const {
+  first = lowerBound(t0);
+  last = t1 > t0 ? lowerBound(t1) : first;
+  if (last < first) last = first;
+}
+
+uint64_t Reader::timeAt(uint64_t row) const {
+  BlockView v;
+  if (row >= _count || !block(row / BLOCK_SAMPLES, v, BlockCodec::COL_T)) return 0;
+  return v.t[row - v.first];
+}
+
+size_t Reader::read(uint64_t first, size_t n, Record* out) const {
+  if (first >= _count) return 0;
+  if (n > _count - first) n = (size_t)(_count - first);
+
+  size_t done = 0;
+  while (done < n) {
+    const uint64_t row = first + done;
+    BlockView v;
+    if (!block(row / BLOCK_SAMPLES, v)) break;
+    const size_t at = (size_t)(row - v.first);
+    const size_t m = std::min<size_t>(n - done, v.rows - at);
+    Record* o = out + done;
+    for (size_t i = 0; i < m; ++i) {
+      const uint64_t ts = v.t[at + i];
+      const uint16_t d = v.dur[at + i];
+      o[i].tUs = ts;
+      o[i].tUsEnd = d == DUR_NONE ? 0 : ts + d;
+      o[i].status = v.status[at + i];
+    }
+    for (size_t c = 0; c < _channels; ++c) {
+      const float* src = v.ch[c] + at;
+      for (size_t i = 0; i < m; ++i) o[i].ch[c] = src[i];
+    }
+    done += m;
+  }
+  return done;
+}
+
+void Reader::close() {
+  for (Column& c : _cols) {
+    if (c.base) munmap(c.base, _mapped * c.width);
+    if (c.fd >= 0) ::close(c.fd);
+  }
+  _cols.clear();
+  if (_hdr) munmap(const_cast<StoreHeader*>(_hdr), sizeof(StoreHeader));
+  _hdr = nullptr;
+  if (_data) munmap(const_cast<uint8_t*>(_data), _dataMapped);
+  _data = nullptr;
+  _dataMapped = 0;
+  if (_summaries) munmap(const_cast<uint8_t*>(_summaries), _summariesMapped);
+  _summaries = nullptr;
+  _summariesMapped = 0;
+  if (_summaryFd >= 0) ::close(_summaryFd);
+  if (_dataFd >= 0) ::close(_dataFd);
+  if (_indexFd >= 0) ::close(_indexFd);
+  if (_metaFd >= 0) ::close(_metaFd);
+  _summaryFd = _dataFd = _indexFd = _metaFd = -1;
+  _blocks.clear();
+  for (CacheSlot& s : _cache) {
+    s.block = UINT64_MAX;
+    s.columns = 0;
+    s.rows = 0;
+  }
+  _count = _mapped = 0;
+}
+
+}  // namespace CaptureStore
@@ -0,0 +1,359 @@
+/*
+  ---------------------------------------------------------------------------
+  CaptureStore – Columnar, Memory-Mapped Sample Store (host)
+  ---------------------------------------------------------------------------
+
+  Replaces the Flask app's deque of per-sample dicts (~320 bytes/sample)
+  with one fixed-width file per column, appended through a shared mapping
+  by the receiver and read in place by any number of readers:
+
+    store.meta           StoreHeader (below), mapped by writer and readers
+    blocks.idx           BlockIndex per sealed block of BLOCK_SAMPLES
+    blocks.dat           encoded sealed blocks (STORE_COMPRESSED only)
+    blocks.sum           per-chunk min/max of every channel, per sealed block
+    t_us.u64             sample start time, µs since epoch (device NTP)
+    dur_us.u16           t_us_end - t_us, saturated at 0xFFFF
+    <channel>.f32        one per analog channel, in schema order
+    status.u8            the six status bytes packed, bit i = STATUS_NAMES[i];
+                         bit 7 (STATUS_GAP) marks a row with no data
+
+  31 bytes/sample for the five REMC channels. Column files grow in
+  GROW_SAMPLES steps and are trimmed to the committed count on close.
+
+  Compressed stores (STORE_COMPRESSED): every block is encoded with
+  BlockCodec when it is sealed and appended to blocks.dat, and its rows
+  are punched out of the column files PUNCH_LAG_BLOCKS later. Only the
+  open tail block stays raw, so readers go through block() rather than raw
+  column pointers. A reader's refresh() can be arbitrarily stale, so
+  block() never trusts it for a block that was open or unencoded then: it
+  re-reads the block's index entry and decodes the block if it has been
+  sealed since, and otherwise copies the rows out of the columns and
+  checks the entry again afterwards, in case the punch landed during the
+  copy. No view into a compressed store points at punchable columns.
+
+  Range reads: blocks.idx holds the first time and the running maximum
+  time of every sealed block, so a time lookup is a binary search over the
+  (small, hot) index and then within one block of t_us; the rows in range
+  are then sequential reads (or decodes) of whole blocks. Timestamps are expected
+  to be non-decreasing; backwards steps (device time corrections) are
+  counted in StoreHeader::outOfOrder and only make lookups inexact around
+  the step.
+
+  Summaries: when a block is sealed the writer also stores, for every
+  CHUNK_ROWS rows, the time span and each channel's min and max with their
+  rows. Plot queries (PlotQuery.h) answer wide time ranges from these
+  without touching the samples; blocks sealed without one (and the open
+  tail) are summarized on the fly by Reader::summary().
+
+  Writes: sealed blocks start on DATA_ALIGN boundaries in blocks.dat, so a
+  block never rewrites a page the previous one left under writeback (the
+  gap is a hole). With setIo() the writer's block, summary and index
+  writes and sync() go through an IoRing: summary, block and index entry
+  are one linked chain, and if any of it fails the index entry falls back
+  to a raw, unsummarized one, so readers never see an entry whose data
+  is missing.
+
+  Publication: the writer fills the column mappings first and then stores
+  StoreHeader::committed with release order; readers load it with acquire
+  order in refresh(). Rows below `committed` never change.
+
+  One writer per store directory. Not thread-safe per object.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef CAPTURE_STORE_H
+#define CAPTURE_STORE_H
+
+#include "BlockCodec.h"
+
+class IoRing;
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace CaptureStore {
+
+static const char STORE_MAGIC[8] = { 'R', 'E', 'M', 'C', 'C', 'A', 'P', '1' };
+static const uint32_t STORE_VERSION = 2;
+
+// StoreHeader::flags
+static const uint32_t STORE_COMPRESSED = 1u << 0;
+
+static const size_t MAX_CHANNELS = 16;
+static const size_t CHANNEL_NAME_LEN = 32;
+static const uint32_t BLOCK_SAMPLES = 4096;        // ~0.4 s at 10 kHz
+static const uint64_t GROW_SAMPLES = 1u << 20;     // ~105 s at 10 kHz
+static const size_t NUM_STATUS = 6;                // UdpManager STATUS_NAMES
+static const uint8_t STATUS_GAP = 1u << 7;         // device gap marker: every channel NaN
+static const uint16_t DUR_NONE = 0xFFFF;           // no end time / saturated
+static const uint32_t PUNCH_LAG_BLOCKS = 16;       // ~6.5 s at 10 kHz
+static const size_t CACHE_BLOCKS = 4;              // decoded blocks per Reader
+static const uint32_t CHUNK_ROWS = 256;            // summary granularity, ~26 ms at 10 kHz
+static const uint32_t BLOCK_CHUNKS = BLOCK_SAMPLES / CHUNK_ROWS;
+static const uint64_t DATA_ALIGN = 4096;           // blocks.dat offset of every block
+
+// BlockIndex::flags
+static const uint32_t BLOCK_SUMMARIZED = 1u << 0;  // blocks.sum entry written
+
+// LOGGING_DATA_FIELDS channel columns of REMC_FlaskApp.py
+extern const char* const DEFAULT_CHANNELS[];
+static const size_t DEFAULT_CHANNEL_COUNT = 5;
+
+struct StoreHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t channelCount;
+  uint32_t blockSamples;
+  uint32_t flags;            // STORE_COMPRESSED
+  uint64_t committed;        // rows visible to readers (release/acquire)
+  uint64_t capacity;         // rows reserved in every column file
+  uint64_t outOfOrder;       // samples earlier than the running maximum
+  uint64_t createdUnixUs;
+  char channelNames[MAX_CHANNELS][CHANNEL_NAME_LEN];
+  uint64_t reserved[8];
+};
+
+struct BlockIndex {
+  uint64_t tFirst;           // t_us of the block's first row
+  uint64_t tMax;             // running maximum t_us up to the block's last row
+  uint64_t offset;           // encoded block in blocks.dat (compressed stores)
+  uint32_t bytes;            // encoded size, 0 if the block is raw
+  uint32_t flags;            // BLOCK_SUMMARIZED
+};
+
+// blocks.sum holds BLOCK_CHUNKS of these per sealed block, each followed by
+// one ChannelRange per channel (summaryBytes() per block)
+struct ChunkHeader {
+  uint64_t tFirst;
+  uint64_t tLast;
+  uint32_t rows;
+  uint32_t reserved;
+};
+
+struct ChannelRange {
+  float min;                 // NaN samples are skipped; +inf/-inf if all are NaN
+  float max;
+  uint16_t minRow;           // row of min / max within the chunk
+  uint16_t maxRow;
+};
+
+inline size_t chunkBytes(size_t channels) { return sizeof(ChunkHeader) + channels * sizeof(ChannelRange); }
+inline size_t summaryBytes(size_t channels) { return BLOCK_CHUNKS * chunkBytes(channels); }
+
+// Summary of one block, in blocks.sum or computed by Reader::summary()
+struct SummaryView {
+  const uint8_t* base;
+  size_t channels;
+  uint32_t chunks;
+
+  const ChunkHeader& chunk(size_t k) const {
+    return *reinterpret_cast<const ChunkHeader*>(base + k * chunkBytes(channels));
+  }
+  const ChannelRange& range(size_t k, size_t c) const {
+    return reinterpret_cast<const ChannelRange*>(base + k * chunkBytes(channels) + sizeof(ChunkHeader))[c];
+  }
+};
+
+// Columns of one block: raw column memory or a decoded copy. Pointers of
+// unrequested columns are null.
+struct BlockView {
+  uint64_t first;            // row index of the block's first row
+  uint32_t rows;
+  const uint64_t* t;
+  const uint16_t* dur;
+  const float* ch[MAX_CHANNELS];
+  const uint8_t* status;
+};
+
+// One decoded sample, as appended and as returned by Reader::read()
+struct Record {
+  uint64_t tUs;
+  uint64_t tUsEnd;           // 0 when the packet format has no end time
+  float ch[MAX_CHANNELS];
+  uint8_t status;            // bit i = status byte i != 0, plus STATUS_GAP
+};
+
+// Gap markers (samples the device lost, sent to keep the index on time)
+// carry no data: NaN in every f32 channel, U16_MISSING counts. True if
+// every one of the n channels is NaN.
+inline bool isGap(const float* ch, size_t n) {
+  if (n == 0 || ch[0] == ch[0]) return false;
+  for (size_t c = 1; c < n; ++c) {
+    if (ch[c] == ch[c]) return false;
+  }
+  return true;
+}
+
+class Writer {
+public:
+  Writer();
+  ~Writer();
+
+  // Create a new store (the directory is created; an existing store there
+  // is an error) or append to an existing one
+  bool create(const std::string& dir, const std::vector<std::string>& channels, uint32_t flags = 0);
+  bool open(const std::string& dir);
+  void close();
+
+  // false (error() set) if a column file could not be grown
+  bool append(const Record& r);
+  bool append(const Record* r, size_t n);
+
+  // Append in two steps, for decoders that fill the columns themselves
+  // (SchemaDecoder::decodeColumns): reserve() points `out` at the next n
+  // rows of the mapped columns (channels past channelCount() null), and
+  // commit() makes the n rows part of the store once they are written
+  bool reserve(size_t n, BlockCodec::ColumnsOut& out);
+  void commit(size_t n);
+
+  // Schedule write-back of everything appended so far (msync MS_ASYNC)
+  void flush();
+  // fdatasync every file, the header last; through the IoRing if set
+  bool sync();
+
+  // Issue block, summary and index writes and sync() through io (owned by
+  // the caller, used from the writer's thread); close() drains it
+  void setIo(IoRing* io) { _io = io; }
+
+  bool isOpen() const { return _hdr != nullptr; }
+  bool compressed() const { return _compressed; }
+  uint64_t size() const { return _count; }
+  uint64_t encodedBytes() const { return _dataBytes; }
+  size_t channelCount() const { return _channels; }
+  uint64_t outOfOrder() const { return _outOfOrder; }
+  const std::string& error() const { return _error; }
+
+private:
+  bool mapAll(bool create);
+  bool grow(uint64_t minCapacity);
+  void sealBlock();
+  void punchBlock(uint64_t block);
+  void publish();
+  void summarizeBlock(uint64_t block);
+
+  std::string _dir;
+  std::string _error;
+  IoRing* _io;
+  int _metaFd;
+  int _indexFd;
+  int _dataFd;
+  int _summaryFd;
+  StoreHeader* _hdr;
+  size_t _channels;
+  bool _compressed;
+  uint64_t _count;
+  uint64_t _capacity;
+  uint64_t _dataBytes;
+  std::vector<uint8_t> _encodeBuf;
+  std::vector<uint8_t> _summaryBuf;
+  uint64_t _maxT;
+  uint64_t _outOfOrder;
+  uint64_t _blockFirstT;
+
+  struct Column {
+    int fd;
+    uint8_t* base;
+    size_t width;
+  };
+  std::vector<Column> _cols;     // t_us, dur_us, channels..., status
+};
+
+class Reader {
+public:
+  Reader();
+  ~Reader();
+
+  bool open(const std::string& dir);
+  void close();
+
+  // Pick up rows and sealed blocks appended since the last call; returns size()
+  uint64_t refresh();
+
+  uint64_t size() const { return _count; }
+  size_t channelCount() const { return _channels; }
+  const char* channelName(size_t i) const;
+  int channelIndex(const char* name) const;
+  bool compressed() const;
+  uint64_t sealedBlocks() const { return _blocks.size(); }
+  uint64_t outOfOrder() const;
+  const std::string& error() const { return _error; }
+
+  // Sealed blocks plus the open tail block, if it has rows
+  uint64_t blockCount() const { return (_count + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES; }
+  const BlockIndex& blockIndex(uint64_t b) const { return _blocks[b]; }
+
+  // Columns of block b (BlockCodec::COL_* selection). Decoded blocks live in
+  // a CACHE_BLOCKS-entry cache: a view stays valid for the next
+  // CACHE_BLOCKS - 1 block() calls and until refresh().
+  bool block(uint64_t b, BlockView& v, uint32_t columns = BlockCodec::COL_ALL) const;
+
+  // First row with t_us >= t (size() if none)
+  uint64_t lowerBound(uint64_t tUs) const;
+  // Rows [first, last) with t0 <= t_us < t1
+  void timeRange(uint64_t t0, uint64_t t1, uint64_t& first, uint64_t& last) const;
+  uint64_t timeAt(uint64_t row) const;
+
+  // Chunk summaries of block b: from blocks.sum for summarized sealed
+  // blocks, otherwise computed from the rows (valid until the next call)
+  bool summary(uint64_t b, SummaryView& s) const;
+
+  // Gather rows [first, first + n) into records; returns rows copied
+  size_t read(uint64_t first, size_t n, Record* out) const;
+
+private:
+  bool mapColumns(uint64_t capacity);
+  bool mapData(uint64_t minBytes) const;
+  bool mapSummaries(uint64_t minBytes) const;
+  void rawView(uint64_t b, BlockView& v) const;
+  bool indexEntry(uint64_t b, BlockIndex& e) const;
+
+  std::string _dir;
+  mutable std::string _error;   // block() is const but can fail
+  int _metaFd;
+  int _indexFd;
+  int _dataFd;
+  int _summaryFd;
+  const StoreHeader* _hdr;
+  size_t _channels;
+  uint64_t _count;
+  uint64_t _mapped;              // rows mapped per column
+  std::vector<BlockIndex> _blocks;
+  mutable const uint8_t* _data;  // blocks.dat, mapped on demand
+  mutable uint64_t _dataMapped;
+  mutable const uint8_t* _summaries;  // blocks.sum, mapped on demand
+  mutable uint64_t _summariesMapped;
+  mutable std::vector<uint8_t> _summaryBuf;
+
+  struct Column {
+    int fd;
+    uint8_t* base;
+    size_t width;
+  };
+  std::vector<Column> _cols;
+
+  struct CacheSlot {
+    uint64_t block;
+    uint32_t columns;            // decoded or copied so far
+    uint32_t rows;               // rows they hold: BLOCK_SAMPLES, or a copied tail's
+    uint64_t lastUse;
+    std::vector<uint64_t> t;
+    std::vector<uint16_t> dur;
+    std::vector<float> ch[MAX_CHANNELS];
+    std::vector<uint8_t> status;
+  };
+  mutable CacheSlot _cache[CACHE_BLOCKS];
+  mutable uint64_t _useClock;
+};
+
+// Column file names in Writer/Reader column order
+std::vector<std::string> columnFiles(const StoreHeader& hdr);
+
+// Chunk summaries of the rows of v (t and every channel present) into out
+// (summaryBytes(channels)); returns the number of chunks
+uint32_t summarize(const BlockView& v, size_t channels, uint8_t* out);
+
+}  // namespace CaptureStore
+
+#endif // CAPTURE_STORE_H
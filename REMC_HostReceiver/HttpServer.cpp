@@ -0,0 +1,164 @@
+#include "HttpServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+namespace {
+
+const size_t MAX_REQUEST = 8192;
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+std::string urlDecode(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (s[i] == '+') {
+      out += ' ';
+    } else if (s[i] == '%' && i + 2 < s.size() && hexValue(s[i + 1]) >= 0 && hexValue(s[i + 2]) >= 0) {
+      out += (char)(hexValue(s[i + 1]) * 16 + hexValue(s[i + 2]));
+      i += 2;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+HttpServer::Query parseQuery(const std::string& q) {
+  HttpServer::Query out;
+  size_t pos = 0;
+  while (pos < q.size()) {
+    size_t amp = q.find('&', pos);
+    if (amp == std::string::npos) amp = q.size();
+    const std::string pair = q.substr(pos, amp - pos);
+    const size_t eq = pair.find('=');
+    if (!pair.empty()) {
+      out[urlDecode(pair.substr(0, eq))] = eq == std::string::npos ? "" : urlDecode(pair.substr(eq + 1));
+    }
+    pos = amp + 1;
+  }
+  return out;
+}
+
+const char* reason(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    default: return "Internal Server Error";
+  }
+}
+
+bool sendAll(int fd, const char* p, size_t n) {
+  while (n > 0) {
+    const ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    p += w;
+    n -= (size_t)w;
+  }
+  return true;
+}
+
+}  // namespace
+
+HttpServer::HttpServer() : _fd(-1), _stop(false) {}
+
+HttpServer::~HttpServer() {
+  stop();
+}
+
+bool HttpServer::start(const char* bindIp, uint16_t port, Handler handler) {
+  stop();
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (_fd < 0) {
+    _error = std::string("socket: ") + strerror(errno);
+    return false;
+  }
+  int one = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = inet_addr(bindIp);
+  if (bind(_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(_fd, 16) < 0) {
+    _error = std::string("bind ") + bindIp + ":" + std::to_string(port) + ": " + strerror(errno);
+    ::close(_fd);
+    _fd = -1;
+    return false;
+  }
+  _handler = handler;
+  _stop = false;
+  _thread = std::thread(&HttpServer::run, this);
+  return true;
+}
+
+void HttpServer::stop() {
+  _stop = true;
+  if (_thread.joinable()) _thread.join();
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+}
+
+void HttpServer::run() {
+  while (!_stop) {
+    pollfd p = { _fd, POLLIN, 0 };
+    if (poll(&p, 1, 200) <= 0) continue;
+    const int client = accept(_fd, nullptr, nullptr);
+    if (client < 0) continue;
+    timeval tv = { 2, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (serve(client)) ::close(client);
+  }
+}
+
+bool HttpServer::serve(int client) {
+  std::string req;
+  char buf[2048];
+  while (req.find("\r\n\r\n") == std::string::npos && req.size() < MAX_REQUEST) {
+    const ssize_t n = recv(client, buf, sizeof(buf), 0);
+    if (n <= 0) return true;
+    req.append(buf, (size_t)n);
+  }
+
+  // "GET /path?query HTTP/1.1"
+  Response res = { 400, "text/plain", "bad request\n" };
+  const size_t sp1 = req.find(' ');
+  const size_t sp2 = sp1 == std::string::npos ? sp1 : req.find(' ', sp1 + 1);
+  if (sp2 != std::string::npos) {
+    const std::string method = req.substr(0, sp1);
+    const std::string target = req.substr(sp1 + 1, sp2 - sp1 - 1);
+    const size_t q = target.find('?');
+    if (method != "GET") {
+      res = Response{ 405, "text/plain", "GET only\n" };
+    } else {
+      const std::string path = urlDecode(target.substr(0, q));
+      const Query query = parseQuery(q == std::string::npos ? "" : target.substr(q + 1));
+      if (_takeover && _takeover(client, path, query)) return false;
+      res = _handler(path, query);
+    }
+  }
+
+  char head[256];
+  const int n = snprintf(head, sizeof(head),
+                         "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                         "Access-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                         res.status, reason(res.status), res.contentType.c_str(), res.body.size());
+  if (sendAll(client, head, (size_t)n)) sendAll(client, res.body.data(), res.body.size());
+  return true;
+}
@@ -0,0 +1,66 @@
+/*
+  ---------------------------------------------------------------------------
+  HttpServer – Minimal Local HTTP/1.1 GET Server (host)
+  ---------------------------------------------------------------------------
+
+  Enough HTTP for a local JSON API: one background thread accepts
+  connections, reads a GET request line, calls the handler with the path
+  and the decoded query parameters, writes the response and closes the
+  connection. Requests are served one at a time; every response carries
+  Access-Control-Allow-Origin: * so a dashboard on another port can call
+  it. Bind to 127.0.0.1 unless the API should be reachable from the LAN.
+
+  A takeover hook, if set, sees every GET first and may keep the
+  connection (LiveStream's event stream); the server then neither answers
+  nor closes it.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+class HttpServer {
+public:
+  typedef std::map<std::string, std::string> Query;
+
+  struct Response {
+    int status;
+    std::string contentType;
+    std::string body;
+  };
+
+  typedef std::function<Response(const std::string& path, const Query& query)> Handler;
+  typedef std::function<bool(int client, const std::string& path, const Query& query)> Takeover;
+
+  HttpServer();
+  ~HttpServer();
+
+  // Set before start()
+  void setTakeover(Takeover takeover) { _takeover = takeover; }
+
+  bool start(const char* bindIp, uint16_t port, Handler handler);
+  void stop();
+
+  const std::string& error() const { return _error; }
+
+private:
+  void run();
+  bool serve(int client);      // false: connection taken over
+
+  int _fd;
+  Handler _handler;
+  Takeover _takeover;
+  std::thread _thread;
+  std::atomic<bool> _stop;
+  std::string _error;
+};
+
+#endif // HTTP_SERVER_H
@@ -0,0 +1,355 @@
+#include "IoRing.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+uint64_t monotonicUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+int ioUringSetup(unsigned entries, io_uring_params* p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+void addLatency(uint64_t* buckets, uint64_t& maxUs, uint64_t us) {
+  size_t k = 0;
+  while (k + 1 < IoRing::LATENCY_BUCKETS && (us >> k) != 0) ++k;
+  buckets[k]++;
+  maxUs = std::max(maxUs, us);
+}
+
+// pwrite until done; bytes written or -errno
+ssize_t writeAll(int fd, const uint8_t* p, size_t n, uint64_t offset) {
+  size_t done = 0;
+  while (done < n) {
+    const ssize_t w = pwrite(fd, p + done, n - done, (off_t)(offset + done));
+    if (w < 0 && errno == EINTR) continue;
+    if (w < 0) return -errno;
+    if (w == 0) break;
+    done += (size_t)w;
+  }
+  return (ssize_t)done;
+}
+
+}  // namespace
+
+IoRing::IoRing()
+  : _ringFd(-1), _depth(0), _maxInflightBytes(DEFAULT_INFLIGHT_BYTES), _chainBroken(false), _sqMap(nullptr),
+    _sqMapBytes(0), _cqMap(nullptr), _cqMapBytes(0), _sqeMap(nullptr), _sqeMapBytes(0), _sqHead(nullptr),
+    _sqTail(nullptr), _sqMask(nullptr), _sqArray(nullptr), _cqHead(nullptr), _cqTail(nullptr), _cqMask(nullptr),
+    _cqes(nullptr), _pending(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+IoRing::~IoRing() {
+  close();
+}
+
+bool IoRing::init(bool useUring, unsigned depth, size_t maxInflightBytes) {
+  close();
+  if (depth == 0 || maxInflightBytes == 0) {
+    _error = "io depth and in-flight bytes must be > 0";
+    return false;
+  }
+  _depth = depth;
+  _maxInflightBytes = maxInflightBytes;
+  _ops.assign(depth, Op());
+  _free.clear();
+  for (unsigned i = depth; i-- > 0;) {
+    _ops[i].kind = FREE;
+    _free.push_back((int)i);
+  }
+  memset(&_stats, 0, sizeof(_stats));
+  _chainBroken = false;
+  if (useUring && !mapRing(depth)) {
+    // Synchronous fallback; the reason stays in error()
+  }
+  return true;
+}
+
+bool IoRing::mapRing(unsigned depth) {
+  io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  const int fd = ioUringSetup(depth, &p);
+  if (fd < 0) {
+    _error = std::string("io_uring_setup: ") + strerror(errno);
+    return false;
+  }
+  _sqMapBytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  _cqMapBytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+  const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single) _sqMapBytes = _cqMapBytes = std::max(_sqMapBytes, _cqMapBytes);
+
+  _sqMap = mmap(nullptr, _sqMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  _cqMap = single || _sqMap == MAP_FAILED
+               ? _sqMap
+               : mmap(nullptr, _cqMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  _sqeMapBytes = p.sq_entries * sizeof(io_uring_sqe);
+  _sqeMap = mmap(nullptr, _sqeMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (_sqMap == MAP_FAILED || _cqMap == MAP_FAILED || _sqeMap == MAP_FAILED) {
+    _error = std::string("io_uring mmap: ") + strerror(errno);
+    if (_sqeMap != MAP_FAILED) munmap(_sqeMap, _sqeMapBytes);
+    if (!single && _cqMap != MAP_FAILED && _cqMap != _sqMap) munmap(_cqMap, _cqMapBytes);
+    if (_sqMap != MAP_FAILED) munmap(_sqMap, _sqMapBytes);
+    _sqMap = _cqMap = _sqeMap = nullptr;
+    ::close(fd);
+    return false;
+  }
+
+  uint8_t* sq = static_cast<uint8_t*>(_sqMap);
+  uint8_t* cq = static_cast<uint8_t*>(_cqMap);
+  _sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+  _sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  _sqMask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  _sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+  _cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  _cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  _cqMask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  _cqes = cq + p.cq_off.cqes;
+  _ringFd = fd;
+  _pending = 0;
+  return true;
+}
+
+void IoRing::close() {
+  drain();
+  if (_ringFd >= 0) {
+    munmap(_sqeMap, _sqeMapBytes);
+    if (_cqMap != _sqMap) munmap(_cqMap, _cqMapBytes);
+    munmap(_sqMap, _sqMapBytes);
+    ::close(_ringFd);
+  }
+  _ringFd = -1;
+  _sqMap = _cqMap = _sqeMap = nullptr;
+  for (Op& op : _ops) free(op.buf);
+  _ops.clear();
+  _free.clear();
+}
+
+// A free op slot with a buffer of at least `bytes`; waits for completions
+// while the depth or the in-flight byte budget is used up
+int IoRing::acquire(size_t bytes) {
+  const size_t allocated = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+  while (_free.empty() || (_stats.inflight > 0 && _stats.inflightBytes + allocated > _maxInflightBytes)) {
+    _stats.waits++;
+    if (reap(true) == 0 && _stats.inflight == 0) break;
+  }
+  if (_free.empty()) return -1;
+  const int slot = _free.back();
+  _free.pop_back();
+  Op& op = _ops[slot];
+  if (op.allocated < allocated) {
+    free(op.buf);
+    op.buf = nullptr;
+    op.allocated = 0;
+    void* p = nullptr;
+    if (allocated && posix_memalign(&p, ALIGN, allocated) != 0) {
+      _free.push_back(slot);
+      return -1;
+    }
+    op.buf = static_cast<uint8_t*>(p);
+    op.allocated = allocated;
+  }
+  _stats.inflight++;
+  _stats.inflightBytes += allocated;
+  _stats.maxInflightBytes = std::max(_stats.maxInflightBytes, _stats.inflightBytes);
+  return slot;
+}
+
+bool IoRing::write(int fd, const void* buf, size_t n, uint64_t offset, uint32_t flags, const void* fallback) {
+  if (_ops.empty()) {
+    _error = "io ring not initialized";
+    return false;
+  }
+  const uint64_t startUs = monotonicUs();
+  if (_issueHook) _issueHook();
+  const int slot = acquire(n);
+  if (slot < 0) {
+    _error = "out of I/O buffers";
+    _stats.failed++;
+    if (fallback) writeAll(fd, static_cast<const uint8_t*>(fallback), n, offset);
+    return false;
+  }
+  Op& op = _ops[slot];
+  op.kind = WRITE;
+  op.fd = fd;
+  op.bytes = n;
+  op.offset = offset;
+  op.startUs = startUs;
+  op.linked = (flags & LINK) != 0;
+  memcpy(op.buf, buf, n);
+  if (fallback) op.fallback.assign(static_cast<const uint8_t*>(fallback), static_cast<const uint8_t*>(fallback) + n);
+  else op.fallback.clear();
+  if (_ringFd >= 0) queue(slot, flags);
+  else runSync(slot, flags);
+  return true;
+}
+
+bool IoRing::sync(int fd, uint32_t flags) {
+  if (_ops.empty()) {
+    _error = "io ring not initialized";
+    return false;
+  }
+  const uint64_t startUs = monotonicUs();
+  if (_issueHook) _issueHook();
+  const int slot = acquire(0);
+  if (slot < 0) return false;
+  Op& op = _ops[slot];
+  op.kind = SYNC;
+  op.fd = fd;
+  op.bytes = 0;
+  op.offset = 0;
+  op.startUs = startUs;
+  op.linked = (flags & LINK) != 0;
+  op.fallback.clear();
+  if (_ringFd >= 0) queue(slot, flags);
+  else runSync(slot, flags);
+  return true;
+}
+
+void IoRing::queue(int slot, uint32_t flags) {
+  const Op& op = _ops[slot];
+  const unsigned tail = *_sqTail;
+  const unsigned index = tail & *_sqMask;
+  io_uring_sqe* sqe = static_cast<io_uring_sqe*>(_sqeMap) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = op.fd;
+  sqe->user_data = (uint64_t)slot;
+  if (op.kind == WRITE) {
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->addr = (uint64_t)(uintptr_t)op.buf;
+    sqe->len = (uint32_t)op.bytes;
+    sqe->off = op.offset;
+  } else {
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+  }
+  if (flags & LINK) sqe->flags |= IOSQE_IO_LINK;
+  if (flags & DRAIN) sqe->flags |= IOSQE_IO_DRAIN;
+  _sqArray[index] = index;
+  __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+  _pending++;
+  // A chain goes to the kernel in one piece
+  if (!(flags & LINK)) submit();
+}
+
+void IoRing::submit() {
+  while (_pending > 0) {
+    const int r = ioUringEnter(_ringFd, _pending, 0, 0);
+    if (r > 0) {
+      _pending -= (unsigned)r;
+      continue;
+    }
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0 && (errno == EAGAIN || errno == EBUSY) && _stats.inflight > _pending) {
+      // Completion queue full: make room and retry
+      reap(true);
+      continue;
+    }
+    _error = std::string("io_uring_enter: ") + strerror(errno);
+    break;
+  }
+}
+
+void IoRing::runSync(int slot, uint32_t flags) {
+  const Op& op = _ops[slot];
+  int res = -ECANCELED;
+  if (!_chainBroken) {
+    if (op.kind == WRITE) {
+      const ssize_t w = writeAll(op.fd, op.buf, op.bytes, op.offset);
+      res = w < 0 ? (int)w : (int)std::min<ssize_t>(w, INT32_MAX);
+    } else {
+      res = fdatasync(op.fd) == 0 ? 0 : -errno;
+    }
+  }
+  const bool failed = op.kind == WRITE ? res != (int)op.bytes : res < 0;
+  _chainBroken = (flags & LINK) ? (_chainBroken || failed) : false;
+  complete(slot, res);
+}
+
+void IoRing::complete(int slot, int res) {
+  Op& op = _ops[slot];
+  const uint64_t us = monotonicUs() - op.startUs;
+  if (op.kind == WRITE) {
+    addLatency(_stats.writeLatencyUs, _stats.maxWriteUs, us);
+    if (res == (int)op.bytes) {
+      _stats.writes++;
+      _stats.writeBytes += op.bytes;
+    } else {
+      _stats.failed++;
+      if (res != -ECANCELED) {
+        _error = res < 0 ? std::string("write: ") + strerror(-res) : std::string("write: short write");
+      }
+      if (!op.fallback.empty() && writeAll(op.fd, op.fallback.data(), op.fallback.size(), op.offset) ==
+                                      (ssize_t)op.fallback.size()) {
+        _stats.fallbacks++;
+      }
+    }
+  } else {
+    addLatency(_stats.syncLatencyUs, _stats.maxSyncUs, us);
+    if (res == 0) {
+      _stats.syncs++;
+    } else {
+      _stats.failed++;
+      if (res != -ECANCELED) _error = std::string("fdatasync: ") + strerror(-res);
+    }
+  }
+  _stats.inflight--;
+  _stats.inflightBytes -= op.allocated;
+  op.kind = FREE;
+  op.fallback.clear();
+  _free.push_back(slot);
+}
+
+size_t IoRing::reap(bool wait) {
+  if (_ringFd < 0 || _stats.inflight == 0) return 0;
+  if (_pending) submit();
+  unsigned head = *_cqHead;
+  if (wait && head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)) {
+    while (ioUringEnter(_ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR) {
+    }
+  }
+  size_t n = 0;
+  const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head, ++n) {
+    const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(_cqes) + (head & *_cqMask);
+    complete((int)cqe->user_data, cqe->res);
+  }
+  __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+  return n;
+}
+
+void IoRing::drain() {
+  while (_stats.inflight > 0) {
+    if (reap(true) == 0 && _ringFd < 0) break;
+  }
+}
+
+uint64_t IoRing::percentileUs(const uint64_t* buckets, double q) {
+  uint64_t total = 0;
+  for (size_t k = 0; k < LATENCY_BUCKETS; ++k) total += buckets[k];
+  if (total == 0) return 0;
+  const uint64_t want = std::max<uint64_t>(1, (uint64_t)(q * (double)total + 0.5));
+  uint64_t seen = 0;
+  for (size_t k = 0; k < LATENCY_BUCKETS; ++k) {
+    seen += buckets[k];
+    if (seen >= want) return 1ull << k;
+  }
+  return 1ull << (LATENCY_BUCKETS - 1);
+}
@@ -0,0 +1,147 @@
+/*
+  ---------------------------------------------------------------------------
+  IoRing – Bounded Asynchronous File Writes through io_uring (host)
+  ---------------------------------------------------------------------------
+
+  The capture store's writer thread (StoreWriter.h) hands its block,
+  summary and index writes and its periodic fdatasync to the kernel
+  through an io_uring instead of waiting on each pwrite:
+
+    write()   copies the bytes into a page-aligned buffer it owns (the
+              caller's buffer is free on return) and queues an
+              IORING_OP_WRITE; LINK chains it to the next op, which then
+              only starts once this one completed in full
+    sync()    IORING_OP_FSYNC with IORING_FSYNC_DATASYNC; DRAIN makes it
+              wait for every op queued before it
+    reap()    collects completions; a failed (or cancelled) write that
+              carries `fallback` bytes has those written with pwrite
+              instead, so a broken chain can still leave a consistent
+              entry behind
+
+  Memory in flight is bounded: at most `depth` ops and `maxInflightBytes`
+  of buffers. A write that does not fit waits for completions, so a slow
+  disk holds up the writer thread – never the thread feeding it.
+
+  Where io_uring is unavailable (old kernel, seccomp, --no-io-uring) the
+  same calls run synchronously with pwrite/fdatasync, with the same LINK
+  and fallback semantics. Ops are counted and timed from queueing to
+  completion in both modes.
+
+  Single-threaded: every call from the thread that owns the ring.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef IO_RING_H
+#define IO_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class IoRing {
+public:
+  static const unsigned DEFAULT_DEPTH = 64;
+  static const size_t DEFAULT_INFLIGHT_BYTES = 4u << 20;
+  static const size_t ALIGN = 4096;
+  static const size_t LATENCY_BUCKETS = 32;      // log2 µs
+
+  // write()/sync() flags
+  static const uint32_t LINK = 1u << 0;          // next op runs only if this one succeeds
+  static const uint32_t DRAIN = 1u << 1;         // start after every earlier op completed
+
+  struct Stats {
+    uint64_t writes;
+    uint64_t writeBytes;
+    uint64_t syncs;
+    uint64_t failed;         // ops that failed or were cancelled
+    uint64_t fallbacks;      // fallback bytes written after a failure
+    uint64_t waits;          // write() waited for in-flight memory
+    uint64_t inflight;       // ops now
+    uint64_t inflightBytes;
+    uint64_t maxInflightBytes;
+    uint64_t writeLatencyUs[LATENCY_BUCKETS];   // bucket k: < 2^k µs
+    uint64_t syncLatencyUs[LATENCY_BUCKETS];
+    uint64_t maxWriteUs;
+    uint64_t maxSyncUs;
+  };
+
+  IoRing();
+  ~IoRing();
+
+  // Falls back to synchronous I/O if useUring is false or the kernel
+  // refuses a ring; only fails on bad arguments
+  bool init(bool useUring = true, unsigned depth = DEFAULT_DEPTH, size_t maxInflightBytes = DEFAULT_INFLIGHT_BYTES);
+  void close();              // waits for everything in flight
+  bool usingUring() const { return _ringFd >= 0; }
+
+  bool write(int fd, const void* buf, size_t n, uint64_t offset, uint32_t flags = 0,
+             const void* fallback = nullptr);
+  bool sync(int fd, uint32_t flags = 0);
+
+  // Process completions; wait for at least one if `wait` and any are in
+  // flight. Returns completions processed.
+  size_t reap(bool wait);
+  void drain();
+
+  // Runs before each op is issued (benches stall here to act as a slow disk)
+  void setIssueHook(std::function<void()> hook) { _issueHook = hook; }
+
+  const Stats& stats() const { return _stats; }
+  // Upper bound in µs of the bucket holding quantile q of a latency histogram
+  static uint64_t percentileUs(const uint64_t* buckets, double q);
+  const std::string& error() const { return _error; }
+
+private:
+  enum Kind { FREE, WRITE, SYNC };
+
+  struct Op {
+    Kind kind;
+    int fd;
+    uint8_t* buf;
+    size_t bytes;
+    size_t allocated;
+    uint64_t offset;
+    uint64_t startUs;
+    std::vector<uint8_t> fallback;
+    bool linked;
+  };
+
+  int acquire(size_t bytes);
+  void queue(int slot, uint32_t flags);
+  void submit();
+  void complete(int slot, int res);
+  void runSync(int slot, uint32_t flags);
+  bool mapRing(unsigned depth);
+
+  int _ringFd;
+  unsigned _depth;
+  size_t _maxInflightBytes;
+  std::vector<Op> _ops;
+  std::vector<int> _free;
+  bool _chainBroken;         // synchronous mode: the previous LINK op failed
+  std::function<void()> _issueHook;
+  Stats _stats;
+  std::string _error;
+
+  // Ring mappings
+  void* _sqMap;
+  size_t _sqMapBytes;
+  void* _cqMap;
+  size_t _cqMapBytes;
+  void* _sqeMap;
+  size_t _sqeMapBytes;
+  unsigned* _sqHead;
+  unsigned* _sqTail;
+  unsigned* _sqMask;
+  unsigned* _sqArray;
+  unsigned* _cqHead;
+  unsigned* _cqTail;
+  unsigned* _cqMask;
+  void* _cqes;
+  unsigned _pending;         // queued SQEs not yet submitted
+};
+
+#endif // IO_RING_H
@@ -0,0 +1,334 @@
+#include "LiveStream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+const double LiveStream::KEEPALIVE_S = 15.0;
+
+namespace {
+
+// Status bits of CaptureStore::Record, as named in the Flask /data payload
+const char* const STATUS_NAMES[CaptureStore::NUM_STATUS] = {
+  "armed_status", "em_status", "msw_a_status", "msw_b_status", "manual_mode_status", "hold_mode_status"
+};
+
+const char SSE_HEADERS[] =
+    "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\nretry: 1000\n\n";
+
+double monotonicSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+uint64_t wallUs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+double threadCpuSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void putFloat(std::string& out, float v) {
+  if (!std::isfinite(v)) {
+    out += "null";
+    return;
+  }
+  char tmp[32];
+  snprintf(tmp, sizeof(tmp), "%.9g", v);
+  out += tmp;
+}
+
+void putU64(std::string& out, uint64_t v) {
+  char tmp[24];
+  snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)v);
+  out += tmp;
+}
+
+}  // namespace
+
+LiveStream::LiveStream() : _periodS(0.05), _maxQueue(DEFAULT_QUEUE_BYTES), _stop(false), _total(0), _seq(0),
+                           _lastSendS(0) {
+  _wake[0] = _wake[1] = -1;
+  memset(&_open, 0, sizeof(_open));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+LiveStream::~LiveStream() {
+  stop();
+}
+
+bool LiveStream::start(const std::vector<std::string>& channels, double rateHz, size_t maxQueueBytes) {
+  stop();
+  if (rateHz <= 0 || channels.empty() || channels.size() > CaptureStore::MAX_CHANNELS) {
+    _error = "bad stream rate or channel list";
+    return false;
+  }
+  if (pipe2(_wake, O_NONBLOCK | O_CLOEXEC) < 0) {
+    _error = std::string("pipe: ") + strerror(errno);
+    return false;
+  }
+  _channels = channels;
+  _periodS = 1.0 / rateHz;
+  _maxQueue = std::max<size_t>(maxQueueBytes, 4096);
+  memset(&_open, 0, sizeof(_open));
+  for (size_t c = 0; c < CaptureStore::MAX_CHANNELS; ++c) {
+    _open.min[c] = INFINITY;
+    _open.max[c] = -INFINITY;
+  }
+  _stop = false;
+  _lastSendS = monotonicSeconds();
+  _thread = std::thread(&LiveStream::run, this);
+  return true;
+}
+
+void LiveStream::stop() {
+  _stop = true;
+  if (_wake[1] >= 0 && write(_wake[1], "x", 1) < 0) {
+    // the fan-out thread also wakes from its poll timeout
+  }
+  if (_thread.joinable()) _thread.join();
+  while (!_clients.empty()) closeClient(_clients.size() - 1);
+  {
+    std::lock_guard<std::mutex> lock(_attachMutex);
+    for (int fd : _pending) ::close(fd);
+    _pending.clear();
+  }
+  for (int& fd : _wake) {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+}
+
+void LiveStream::publish(const CaptureStore::Record* r, size_t n) {
+  if (n == 0) return;
+  const uint64_t now = wallUs();
+  const size_t channels = _channels.size();
+  std::lock_guard<std::mutex> lock(_frameMutex);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t c = 0; c < channels; ++c) {
+      const float v = r[i].ch[c];
+      if (v < _open.min[c]) _open.min[c] = v;
+      if (v > _open.max[c]) _open.max[c] = v;
+    }
+  }
+  memcpy(_open.last, r[n - 1].ch, channels * sizeof(float));
+  _open.status = r[n - 1].status;
+  _open.tUs = r[n - 1].tUs;
+  _open.ingestUs = now;
+  _open.samples += n;
+  _total += n;
+  _open.total = _total;
+}
+
+void LiveStream::attach(int fd) {
+  if (!_thread.joinable()) {
+    ::close(fd);
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  // Bound what the kernel holds for a slow client as well as our queue
+  // (Linux doubles the value asked for)
+  int sndbuf = (int)(_maxQueue / 2);
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+  {
+    std::lock_guard<std::mutex> lock(_attachMutex);
+    _pending.push_back(fd);
+  }
+  if (write(_wake[1], "x", 1) < 0) {
+    // pipe full: the fan-out thread is already due to wake
+  }
+}
+
+LiveStream::Stats LiveStream::stats() const {
+  std::lock_guard<std::mutex> lock(_statsMutex);
+  return _stats;
+}
+
+void LiveStream::run() {
+  double next = monotonicSeconds() + _periodS;
+  std::vector<pollfd> fds;
+  char scratch[1024];
+  while (!_stop) {
+    fds.clear();
+    fds.push_back(pollfd{ _wake[0], POLLIN, 0 });
+    for (const Client& c : _clients) {
+      fds.push_back(pollfd{ c.fd, (short)(POLLIN | (c.sent < c.queue.size() ? POLLOUT : 0)), 0 });
+    }
+    const double wait = next - monotonicSeconds();
+    const int timeoutMs = wait <= 0 ? 0 : std::min(200, (int)std::ceil(wait * 1000));
+    if (poll(fds.data(), fds.size(), timeoutMs) < 0 && errno != EINTR) break;
+
+    const size_t polled = fds.size() - 1;
+    for (size_t i = polled; i-- > 0;) {
+      const short rev = fds[i + 1].revents;
+      Client& c = _clients[i];
+      bool ok = !(rev & (POLLERR | POLLHUP | POLLNVAL));
+      if (ok && (rev & POLLIN)) {
+        // Nothing is expected after the request; EOF means the client left
+        const ssize_t n = recv(c.fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+        ok = n > 0 || (n < 0 && (errno == EAGAIN || errno == EINTR));
+      }
+      if (ok && (rev & POLLOUT)) ok = flush(c);
+      if (!ok) closeClient(i);
+    }
+
+    if (fds[0].revents & POLLIN) {
+      while (read(_wake[0], scratch, sizeof(scratch)) > 0) {
+      }
+      std::vector<int> fresh;
+      {
+        std::lock_guard<std::mutex> lock(_attachMutex);
+        fresh.swap(_pending);
+      }
+      for (int fd : fresh) {
+        if (_clients.size() >= MAX_CLIENTS) {
+          ::close(fd);
+          continue;
+        }
+        _clients.push_back(Client{ fd, SSE_HEADERS, 0 });
+        if (!flush(_clients.back())) closeClient(_clients.size() - 1);
+      }
+    }
+
+    const double now = monotonicSeconds();
+    if (now >= next) {
+      tick();
+      next += _periodS;
+      if (next < now) next = now + _periodS;  // fell behind: skip, don't burst
+    }
+  }
+}
+
+void LiveStream::tick() {
+  Frame f;
+  {
+    std::lock_guard<std::mutex> lock(_frameMutex);
+    f = _open;
+    _open.samples = 0;
+    for (size_t c = 0; c < _channels.size(); ++c) {
+      _open.min[c] = INFINITY;
+      _open.max[c] = -INFINITY;
+    }
+  }
+
+  const double now = monotonicSeconds();
+  uint64_t dropped = 0;
+  if (f.samples > 0) {
+    serialize(f, _frame);
+  } else if (now - _lastSendS >= KEEPALIVE_S) {
+    _frame = ": keepalive\n\n";
+  } else {
+    _frame.clear();
+  }
+
+  if (!_frame.empty()) {
+    _lastSendS = now;
+    for (Client& c : _clients) {
+      if (c.sent == c.queue.size()) {
+        c.queue.clear();
+        c.sent = 0;
+      } else if (c.sent > c.queue.size() / 2) {
+        c.queue.erase(0, c.sent);
+        c.sent = 0;
+      }
+      if (c.queue.size() - c.sent + _frame.size() > _maxQueue) {
+        dropped++;
+        continue;
+      }
+      c.queue += _frame;
+    }
+    for (size_t i = _clients.size(); i-- > 0;) {
+      if (!flush(_clients[i])) closeClient(i);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(_statsMutex);
+  if (f.samples > 0) _stats.frames++;
+  _stats.dropped += dropped;
+  _stats.clients = _clients.size();
+  _stats.cpuSeconds = threadCpuSeconds();
+}
+
+void LiveStream::serialize(const Frame& f, std::string& out) {
+  _seq++;
+  out.clear();
+  out += "id: ";
+  putU64(out, _seq);
+  out += "\ndata: {\"seq\": ";
+  putU64(out, _seq);
+  out += ", \"t_us\": ";
+  putU64(out, f.tUs);
+  out += ", \"ingest_us\": ";
+  putU64(out, f.ingestUs);
+  out += ", \"sent_us\": ";
+  putU64(out, wallUs());
+  out += ", \"samples\": ";
+  putU64(out, f.samples);
+  out += ", \"total\": ";
+  putU64(out, f.total);
+
+  const float* const parts[] = { f.last, f.min, f.max };
+  const char* const names[] = { ", \"payload\": {", "}, \"min\": {", "}, \"max\": {" };
+  for (size_t p = 0; p < 3; ++p) {
+    out += names[p];
+    for (size_t c = 0; c < _channels.size(); ++c) {
+      out += c ? ", \"" : "\"";
+      out += _channels[c];
+      out += "\": ";
+      putFloat(out, parts[p][c]);
+    }
+    if (p == 0) {
+      for (size_t b = 0; b < CaptureStore::NUM_STATUS; ++b) {
+        out += ", \"";
+        out += STATUS_NAMES[b];
+        out += (f.status >> b) & 1 ? "\": 1" : "\": 0";
+      }
+    }
+  }
+  out += "}}\n\n";
+}
+
+bool LiveStream::flush(Client& c) {
+  uint64_t sent = 0;
+  while (c.sent < c.queue.size()) {
+    const ssize_t n = send(c.fd, c.queue.data() + c.sent, c.queue.size() - c.sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n > 0) {
+      c.sent += (size_t)n;
+      sent += (uint64_t)n;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+      return false;
+    }
+  }
+  if (sent) {
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    _stats.sentBytes += sent;
+  }
+  return true;
+}
+
+void LiveStream::closeClient(size_t i) {
+  ::close(_clients[i].fd);
+  _clients[i] = std::move(_clients.back());
+  _clients.pop_back();
+  std::lock_guard<std::mutex> lock(_statsMutex);
+  _stats.disconnected++;
+  _stats.clients = _clients.size();
+}
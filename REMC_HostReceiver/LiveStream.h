@@ -0,0 +1,125 @@
+/*
+  ---------------------------------------------------------------------------
+  LiveStream – Server-Sent Events Push of Decimated Live Frames (host)
+  ---------------------------------------------------------------------------
+
+  Replaces the dashboard's 500 ms /data polling (one sample out of 5,000
+  per poll) with a push stream. The ingest loop folds every live sample
+  into the current frame with publish(); a fan-out thread closes the frame
+  `rateHz` times a second, serializes it once and queues the same bytes
+  to every client:
+
+    id: <seq>
+    data: {"seq", "t_us", "ingest_us", "sent_us", "samples", "total",
+           "payload": {<channel>: last, ..., <status name>: 0|1, ...},
+           "min": {<channel>: v, ...}, "max": {<channel>: v, ...}}
+
+  `payload` has the keys of the Flask /data payload (the newest sample),
+  min/max cover every sample folded into the frame. `ingest_us` is the
+  wall time the newest sample was published, `sent_us` when the frame was
+  built; a client's end-to-end latency is its receive time − ingest_us.
+
+  Back-pressure: each client has a queue of at most `maxQueueBytes` (and a
+  kernel send buffer of about the same size). A frame that does not fit is
+  dropped for that client only, whole, so its stream stays well formed and
+  it sees a gap in `seq`. publish() only takes a mutex shared with the
+  frame swap; nothing on the ingest side waits for a socket.
+
+  Connections arrive through attach() – HttpServer hands over a GET on
+  the stream path – and are non-blocking from then on. Comment lines keep
+  idle streams alive every KEEPALIVE_S.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include "CaptureStore.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class LiveStream {
+public:
+  static const size_t DEFAULT_QUEUE_BYTES = 16 * 1024;   // ~1 s of 20 Hz frames
+  static const size_t MAX_CLIENTS = 1000;
+  static const double KEEPALIVE_S;
+
+  struct Stats {
+    uint64_t frames;         // built
+    uint64_t clients;        // connected now
+    uint64_t sentBytes;
+    uint64_t dropped;        // frames not queued for a full client
+    uint64_t disconnected;
+    double cpuSeconds;       // fan-out thread CPU time
+  };
+
+  LiveStream();
+  ~LiveStream();
+
+  bool start(const std::vector<std::string>& channels, double rateHz, size_t maxQueueBytes = DEFAULT_QUEUE_BYTES);
+  void stop();
+
+  // Ingest side: fold samples into the open frame
+  void publish(const CaptureStore::Record* r, size_t n);
+
+  // Take ownership of an accepted connection and start streaming to it
+  void attach(int fd);
+
+  Stats stats() const;
+  const std::string& error() const { return _error; }
+
+private:
+  struct Frame {
+    uint64_t samples;
+    uint64_t total;          // published since start()
+    uint64_t tUs;            // newest sample
+    uint64_t ingestUs;       // wall time of the publish() that brought it
+    float last[CaptureStore::MAX_CHANNELS];
+    float min[CaptureStore::MAX_CHANNELS];
+    float max[CaptureStore::MAX_CHANNELS];
+    uint8_t status;
+  };
+
+  struct Client {
+    int fd;
+    std::string queue;
+    size_t sent;             // bytes of queue already written
+  };
+
+  void run();
+  void tick();
+  void serialize(const Frame& f, std::string& out);
+  bool flush(Client& c);
+  void closeClient(size_t i);
+
+  std::vector<std::string> _channels;
+  double _periodS;
+  size_t _maxQueue;
+  int _wake[2];
+  std::thread _thread;
+  std::atomic<bool> _stop;
+  std::string _error;
+
+  std::mutex _frameMutex;    // publish() vs tick()
+  Frame _open;
+  uint64_t _total;
+
+  std::mutex _attachMutex;
+  std::vector<int> _pending; // attached, not yet picked up by run()
+
+  std::vector<Client> _clients;  // fan-out thread only
+  uint64_t _seq;
+  double _lastSendS;
+  std::string _frame;
+
+  mutable std::mutex _statsMutex;
+  Stats _stats;
+};
+
+#endif // LIVE_STREAM_H
@@ -0,0 +1,574 @@
+#include "LookbackRing.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const double LookbackRing::DEFAULT_PRE_S = 10.0;
+const double LookbackRing::DEFAULT_POST_S = 5.0;
+const double LookbackRing::MAX_WINDOW_S = 300.0;
+const double LookbackRing::SETTLE_S = 2.0;
+
+namespace {
+
+const double POLL_S = 0.1;           // persist thread, while windows are pending
+const size_t MIN_CAPACITY = 1u << 16;
+
+// UdpManager STATUS_NAMES, bit i of Record::status
+const char* const STATUS_NAMES[CaptureStore::NUM_STATUS] = {
+  "armed_status", "em_status", "msw_a_status", "msw_b_status", "manual_mode_status", "hold_mode_status"
+};
+
+double monotonicSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+HttpServer::Response json(const std::string& body) {
+  return HttpServer::Response{ 200, "application/json", body };
+}
+
+HttpServer::Response fail(int status, const std::string& message) {
+  return HttpServer::Response{ status, "application/json", "{\"error\": \"" + message + "\"}\n" };
+}
+
+void putU64(std::string& out, uint64_t v) {
+  char tmp[24];
+  snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)v);
+  out += tmp;
+}
+
+const std::string* param(const HttpServer::Query& q, const char* name) {
+  const HttpServer::Query::const_iterator it = q.find(name);
+  return it == q.end() || it->second.empty() ? nullptr : &it->second;
+}
+
+// Reasons end up in JSON strings and capture.txt lines
+std::string printable(const std::string& s) {
+  std::string out = s.substr(0, 120);
+  for (char& c : out) {
+    if (c < 0x20 || c == 0x7f || c == '"' || c == '\\') c = '_';
+  }
+  return out;
+}
+
+// Next free capture number under `dir`
+unsigned nextCaptureNumber(const std::string& dir) {
+  unsigned next = 1;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return next;
+  while (dirent* e = readdir(d)) {
+    unsigned n;
+    if (sscanf(e->d_name, "capture_%u", &n) == 1 && n >= next) next = n + 1;
+  }
+  closedir(d);
+  return next;
+}
+
+// Store name for QueryApi, relative to the node directory
+std::string storeName(unsigned id) {
+  char name[40];
+  snprintf(name, sizeof(name), "captures/capture_%04u", id);
+  return name;
+}
+
+const char* stateName(LookbackRing::WindowState s) {
+  switch (s) {
+  case LookbackRing::WINDOW_PENDING: return "pending";
+  case LookbackRing::WINDOW_WRITTEN: return "written";
+  default: return "failed";
+  }
+}
+
+}  // namespace
+
+LookbackRing::LookbackRing()
+  : _storeFlags(0), _preS(DEFAULT_PRE_S), _postS(DEFAULT_POST_S), _map(nullptr), _mapBytes(0), _capacity(0),
+    _t(nullptr), _dur(nullptr), _status(nullptr), _claimed(0), _head(0), _newestUs(0), _lastStatus(0),
+    _haveLast(false), _nextId(1), _stop(false), _running(false) {
+  memset(_ch, 0, sizeof(_ch));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+LookbackRing::~LookbackRing() { stop(); }
+
+bool LookbackRing::parseRule(const std::string& text, const std::vector<std::string>& channels, Rule& rule,
+                             std::string& error) {
+  rule.text = text;
+  rule.level = 0.0f;
+  const size_t colon = text.find(':');
+  if (colon != std::string::npos) {
+    const std::string name = text.substr(0, colon), edge = text.substr(colon + 1);
+    size_t bit = 0;
+    while (bit < CaptureStore::NUM_STATUS && name != STATUS_NAMES[bit]) ++bit;
+    if (bit == CaptureStore::NUM_STATUS) {
+      error = "unknown status '" + name + "'";
+      return false;
+    }
+    if (edge == "rise") rule.kind = Rule::RISE;
+    else if (edge == "fall") rule.kind = Rule::FALL;
+    else if (edge == "change") rule.kind = Rule::CHANGE;
+    else {
+      error = "status edge must be rise, fall or change, not '" + edge + "'";
+      return false;
+    }
+    rule.index = (uint8_t)bit;
+    return true;
+  }
+
+  const size_t op = text.find_first_of("<>");
+  if (op == std::string::npos || op == 0 || op + 1 == text.size()) {
+    error = "expected <channel>><level>, <channel><<level> or <status>:rise|fall|change";
+    return false;
+  }
+  const std::string name = text.substr(0, op);
+  const std::vector<std::string>::const_iterator it = std::find(channels.begin(), channels.end(), name);
+  if (it == channels.end()) {
+    error = "unknown channel '" + name + "'";
+    return false;
+  }
+  char* end = nullptr;
+  rule.level = strtof(text.c_str() + op + 1, &end);
+  if (!end || *end) {
+    error = "bad level in '" + text + "'";
+    return false;
+  }
+  rule.kind = text[op] == '>' ? Rule::ABOVE : Rule::BELOW;
+  rule.index = (uint8_t)(it - channels.begin());
+  return true;
+}
+
+bool LookbackRing::start(uint64_t bytes, const std::vector<std::string>& channels, const std::string& dir,
+                         const std::vector<Rule>& rules, double preS, double postS, uint32_t storeFlags) {
+  if (running()) return true;
+  if (channels.empty() || channels.size() > CaptureStore::MAX_CHANNELS) {
+    _error = "1 to 16 channels";
+    return false;
+  }
+  for (const Rule& r : rules) {
+    const size_t limit = r.kind == Rule::ABOVE || r.kind == Rule::BELOW ? channels.size() : CaptureStore::NUM_STATUS;
+    if (r.index >= limit) {
+      _error = "rule '" + r.text + "' out of range";
+      return false;
+    }
+  }
+
+  // One mapping, column after column; capacity a multiple of 64 keeps every column aligned
+  const size_t perSample = sizeof(uint64_t) + sizeof(uint16_t) + channels.size() * sizeof(float) + 1;
+  _capacity = bytes / perSample / 64 * 64;
+  if (_capacity < MIN_CAPACITY) {
+    _error = "look-back ring too small";
+    return false;
+  }
+  _mapBytes = (size_t)(_capacity * perSample);
+  _map = mmap(nullptr, _mapBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (_map == MAP_FAILED) {
+    _map = nullptr;
+    _error = std::string("mmap: ") + strerror(errno);
+    return false;
+  }
+  uint8_t* p = static_cast<uint8_t*>(_map);
+  _t = reinterpret_cast<uint64_t*>(p);
+  p += _capacity * sizeof(uint64_t);
+  _dur = reinterpret_cast<uint16_t*>(p);
+  p += _capacity * sizeof(uint16_t);
+  memset(_ch, 0, sizeof(_ch));
+  for (size_t c = 0; c < channels.size(); ++c) {
+    _ch[c] = reinterpret_cast<float*>(p);
+    p += _capacity * sizeof(float);
+  }
+  _status = p;
+
+  if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+    _error = "mkdir " + dir + ": " + strerror(errno);
+    munmap(_map, _mapBytes);
+    _map = nullptr;
+    return false;
+  }
+  _dir = dir;
+  _channels = channels;
+  _rules = rules;
+  _lastValue.assign(rules.size(), 0.0f);
+  _haveLast = false;
+  _preS = preS;
+  _postS = postS;
+  _storeFlags = storeFlags;
+  _claimed.store(0, std::memory_order_relaxed);
+  _head.store(0, std::memory_order_relaxed);
+  _newestUs.store(0, std::memory_order_relaxed);
+  _nextId = nextCaptureNumber(dir);
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.capacity = _capacity;
+  _stats.bytes = _mapBytes;
+  _stop = false;
+  _thread = std::thread(&LookbackRing::run, this);
+  _running.store(true, std::memory_order_release);
+  return true;
+}
+
+void LookbackRing::stop() {
+  if (!running()) return;
+  _running.store(false, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _wake.notify_all();
+  _thread.join();
+  munmap(_map, _mapBytes);
+  _map = nullptr;
+  _t = nullptr;
+  _dur = nullptr;
+  memset(_ch, 0, sizeof(_ch));
+  _status = nullptr;
+}
+
+void LookbackRing::append(const CaptureStore::Record* r, size_t n) {
+  if (!_map) return;
+  const size_t channels = _channels.size();
+  while (n > 0) {
+    const size_t batch = (size_t)std::min<uint64_t>(n, _capacity);
+    const uint64_t h = _head.load(std::memory_order_relaxed);
+
+    // Announce the slots about to be overwritten before touching them (SampleRing.h)
+    _claimed.store(h + batch, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // At most two contiguous runs, column at a time
+    size_t done = 0;
+    while (done < batch) {
+      const uint64_t slot = (h + done) % _capacity;
+      const size_t run = (size_t)std::min<uint64_t>(batch - done, _capacity - slot);
+      const CaptureStore::Record* src = r + done;
+      uint64_t* t = _t + slot;
+      for (size_t i = 0; i < run; ++i) t[i] = src[i].tUs;
+      uint16_t* dur = _dur + slot;
+      for (size_t i = 0; i < run; ++i) {
+        const uint64_t d = src[i].tUsEnd - src[i].tUs;
+        dur[i] = (src[i].tUsEnd < src[i].tUs || d >= CaptureStore::DUR_NONE) ? CaptureStore::DUR_NONE : (uint16_t)d;
+      }
+      for (size_t c = 0; c < channels; ++c) {
+        float* v = _ch[c] + slot;
+        for (size_t i = 0; i < run; ++i) v[i] = src[i].ch[c];
+      }
+      uint8_t* status = _status + slot;
+      for (size_t i = 0; i < run; ++i) status[i] = src[i].status;
+      done += run;
+    }
+    _head.store(h + batch, std::memory_order_release);
+    _newestUs.store(r[batch - 1].tUs, std::memory_order_relaxed);
+
+    // Rules: one pass per rule, edges against the previous sample (also across packets)
+    for (size_t k = 0; k < _rules.size(); ++k) {
+      const Rule& rule = _rules[k];
+      switch (rule.kind) {
+      case Rule::ABOVE:
+      case Rule::BELOW: {
+        const bool above = rule.kind == Rule::ABOVE;
+        float prev = _lastValue[k];
+        size_t i = 0;
+        if (!_haveLast) prev = r[i++].ch[rule.index];
+        for (; i < batch; ++i) {
+          const float v = r[i].ch[rule.index];
+          if (above ? (v > rule.level && !(prev > rule.level)) : (v < rule.level && !(prev < rule.level))) {
+            trigger(rule, r[i].tUs);
+          }
+          prev = v;
+        }
+        _lastValue[k] = prev;
+        break;
+      }
+      default: {
+        const uint8_t bit = (uint8_t)(1u << rule.index);
+        uint8_t prev = _lastStatus;
+        size_t i = 0;
+        if (!_haveLast) prev = r[i++].status;
+        for (; i < batch; ++i) {
+          const uint8_t s = r[i].status;
+          const uint8_t edge = (uint8_t)((s ^ prev) & bit);
+          if (edge && (rule.kind == Rule::CHANGE || ((s & bit) != 0) == (rule.kind == Rule::RISE))) {
+            trigger(rule, r[i].tUs);
+          }
+          prev = s;
+        }
+        break;
+      }
+      }
+    }
+    _lastStatus = r[batch - 1].status;
+    _haveLast = true;
+
+    r += batch;
+    n -= batch;
+  }
+}
+
+void LookbackRing::trigger(const Rule& rule, uint64_t tUs) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.fired++;
+    // Extend the newest pending window rather than open one that overlaps it
+    if (!_pending.empty()) {
+      Window& w = _pending.back();
+      const uint64_t to = tUs + (uint64_t)(_postS * 1e6);
+      if (w.reason.compare(0, 7, "manual:") != 0 && tUs <= w.toUs && to - w.fromUs <= (uint64_t)(MAX_WINDOW_S * 1e6)) {
+        w.triggers++;
+        if (to > w.toUs) {
+          w.toUs = to;
+          _deadlines.back() = monotonicSeconds() + _postS + SETTLE_S;
+        }
+        return;
+      }
+    }
+    open(tUs, _preS, _postS, rule.text);
+  }
+  _wake.notify_one();
+}
+
+unsigned LookbackRing::mark(uint64_t tUs, double preS, double postS, const std::string& reason) {
+  if (!running()) return 0;
+  if (tUs == 0) tUs = _newestUs.load(std::memory_order_relaxed);
+  if (tUs == 0) return 0;
+  unsigned id;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    id = open(tUs, preS, postS, "manual: " + printable(reason));
+  }
+  _wake.notify_one();
+  return id;
+}
+
+unsigned LookbackRing::open(uint64_t tUs, double preS, double postS, const std::string& reason) {
+  preS = std::max(0.0, std::min(preS, MAX_WINDOW_S));
+  postS = std::max(0.0, std::min(postS, MAX_WINDOW_S - preS));
+  Window w;
+  w.id = _nextId++;
+  w.reason = reason;
+  w.triggers = 1;
+  w.triggerUs = tUs;
+  w.fromUs = tUs > (uint64_t)(preS * 1e6) ? tUs - (uint64_t)(preS * 1e6) : 0;
+  w.toUs = tUs + (uint64_t)(postS * 1e6);
+  w.state = WINDOW_PENDING;
+  w.rows = 0;
+  w.trimmed = false;
+  w.torn = false;
+  w.persistMs = 0.0;
+  _pending.push_back(w);
+
+  // Written by the wall clock if the stream stops before it covers the window
+  const uint64_t newest = _newestUs.load(std::memory_order_relaxed);
+  const double ahead = w.toUs > newest ? (w.toUs - newest) * 1e-6 : 0.0;
+  _deadlines.push_back(monotonicSeconds() + std::min(ahead, MAX_WINDOW_S) + SETTLE_S);
+  _stats.marked++;
+  return w.id;
+}
+
+void LookbackRing::run() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (;;) {
+    if (_pending.empty()) {
+      if (_stop) break;
+      _wake.wait(lock);
+      continue;
+    }
+
+    // The first window the ring covers (or that waited long enough)
+    const uint64_t newest = _newestUs.load(std::memory_order_relaxed);
+    const double now = monotonicSeconds();
+    size_t ready = _pending.size();
+    for (size_t i = 0; i < _pending.size(); ++i) {
+      if (_stop || newest >= _pending[i].toUs || now >= _deadlines[i]) {
+        ready = i;
+        break;
+      }
+    }
+    if (ready == _pending.size()) {
+      _wake.wait_for(lock, std::chrono::duration<double>(POLL_S));
+      continue;
+    }
+
+    Window w = _pending[ready];
+    _pending.erase(_pending.begin() + ready);
+    _deadlines.erase(_deadlines.begin() + ready);
+    _writing.assign(1, w);
+    lock.unlock();
+    persist(w);
+    lock.lock();
+    _writing.clear();
+
+    if (w.state == WINDOW_WRITTEN) _stats.written++;
+    else _stats.failed++;
+    if (w.trimmed) _stats.trimmed++;
+    if (w.torn) _stats.torn++;
+    _done.push_back(w);
+    if (_done.size() > HISTORY) _done.pop_front();
+  }
+}
+
+uint64_t LookbackRing::lowerBound(uint64_t first, uint64_t last, uint64_t tUs) const {
+  while (first < last) {
+    const uint64_t mid = first + (last - first) / 2;
+    if (timeAt(mid) < tUs) first = mid + 1;
+    else last = mid;
+  }
+  return first;
+}
+
+void LookbackRing::persist(Window& w) {
+  const double t0 = monotonicSeconds();
+  w.state = WINDOW_FAILED;
+  const uint64_t head = _head.load(std::memory_order_acquire);
+  const uint64_t oldest = head > _capacity ? head - _capacity : 0;
+  uint64_t row = lowerBound(oldest, head, w.fromUs);
+  const uint64_t end = lowerBound(row, head, w.toUs + 1);
+  w.trimmed = row == oldest && oldest > 0 && timeAt(oldest) > w.fromUs;
+
+  char name[32];
+  snprintf(name, sizeof(name), "/capture_%04u", w.id);
+  w.dir = _dir + name;
+  CaptureStore::Writer out;
+  if (row >= end) {
+    fprintf(stderr, "[Lookback] capture_%04u: no samples in the ring for the window\n", w.id);
+    return;
+  }
+  if (!out.create(w.dir, _channels, _storeFlags)) {
+    fprintf(stderr, "[Lookback] %s\n", out.error().c_str());
+    return;
+  }
+
+  const size_t channels = _channels.size();
+  uint64_t firstUs = 0, lastUs = 0;
+  while (row < end) {
+    const size_t n = (size_t)std::min<uint64_t>(end - row, COPY_ROWS);
+    BlockCodec::ColumnsOut cols;
+    if (!out.reserve(n, cols)) {
+      fprintf(stderr, "[Lookback] %s\n", out.error().c_str());
+      break;
+    }
+    size_t done = 0;
+    while (done < n) {
+      const uint64_t slot = (row + done) % _capacity;
+      const size_t run = (size_t)std::min<uint64_t>(n - done, _capacity - slot);
+      memcpy(cols.t + done, _t + slot, run * sizeof(uint64_t));
+      memcpy(cols.dur + done, _dur + slot, run * sizeof(uint16_t));
+      for (size_t c = 0; c < channels; ++c) memcpy(cols.ch[c] + done, _ch[c] + slot, run * sizeof(float));
+      memcpy(cols.status + done, _status + slot, run);
+      done += run;
+    }
+
+    // Rows the writer may have come round to during the copy are not committed
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t claimed = _claimed.load(std::memory_order_relaxed);
+    if (claimed > _capacity && row < claimed - _capacity) {
+      if (out.size() > 0) {
+        w.torn = true;
+        break;
+      }
+      // Nothing written yet: the window lost its start, begin again a chunk inside the ring
+      w.trimmed = true;
+      row = claimed - _capacity + COPY_ROWS;
+      continue;
+    }
+    if (out.size() == 0) firstUs = cols.t[0];
+    lastUs = cols.t[n - 1];
+    out.commit(n);
+    row += n;
+  }
+  w.rows = out.size();
+  out.close();
+
+  const std::string metaPath = w.dir + "/capture.txt";
+  if (FILE* f = fopen(metaPath.c_str(), "w")) {
+    fprintf(f, "reason: %s\ntriggers: %u\ntrigger_us: %llu\nfrom_us: %llu\nto_us: %llu\nrows: %llu\n",
+            w.reason.c_str(), w.triggers, (unsigned long long)w.triggerUs, (unsigned long long)w.fromUs,
+            (unsigned long long)w.toUs, (unsigned long long)w.rows);
+    if (w.rows) fprintf(f, "first_us: %llu\nlast_us: %llu\n", (unsigned long long)firstUs, (unsigned long long)lastUs);
+    fprintf(f, "trimmed: %d\ntorn: %d\n", w.trimmed ? 1 : 0, w.torn ? 1 : 0);
+    fclose(f);
+  }
+  w.state = w.rows ? WINDOW_WRITTEN : WINDOW_FAILED;
+  w.persistMs = (monotonicSeconds() - t0) * 1e3;
+  printf("[Lookback] capture_%04u: %llu rows over %.1f s (%s%s%s), %.1f ms\n", w.id, (unsigned long long)w.rows,
+         (w.toUs - w.fromUs) * 1e-6, w.reason.c_str(), w.trimmed ? ", trimmed" : "", w.torn ? ", torn" : "",
+         w.persistMs);
+  fflush(stdout);
+}
+
+std::vector<LookbackRing::Window> LookbackRing::windows() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::vector<Window> out(_done.begin(), _done.end());
+  out.insert(out.end(), _writing.begin(), _writing.end());
+  out.insert(out.end(), _pending.begin(), _pending.end());
+  return out;
+}
+
+LookbackRing::Stats LookbackRing::stats() const {
+  Stats s;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    s = _stats;
+  }
+  const uint64_t head = _head.load(std::memory_order_acquire);
+  s.appended = head;
+  s.held = std::min(head, _capacity);
+  s.newestUs = _newestUs.load(std::memory_order_relaxed);
+  s.oldestUs = s.held && _map ? timeAt(head - s.held) : 0;
+  return s;
+}
+
+HttpServer::Response LookbackRing::handle(const std::string& path, const HttpServer::Query& query) {
+  if (path == "/api/capture") {
+    if (!running()) return fail(503, "look-back ring not running");
+    const std::string* pre = param(query, "pre");
+    const std::string* post = param(query, "post");
+    const std::string* t = param(query, "t");
+    const std::string* reason = param(query, "reason");
+    const unsigned id = mark(t ? strtoull(t->c_str(), nullptr, 10) : 0, pre ? atof(pre->c_str()) : _preS,
+                             post ? atof(post->c_str()) : _postS, reason ? *reason : "http");
+    if (!id) return fail(409, "no samples yet");
+    for (const Window& w : windows()) {
+      if (w.id != id) continue;
+      std::string out = "{\"id\": ";
+      putU64(out, id);
+      out += ", \"store\": \"" + storeName(id) + "\", \"from_us\": ";
+      putU64(out, w.fromUs);
+      out += ", \"to_us\": ";
+      putU64(out, w.toUs);
+      return json(out + "}\n");
+    }
+    return fail(500, "window lost");
+  }
+  if (path == "/api/captures") {
+    std::string out = "{\"captures\": [";
+    bool first = true;
+    for (const Window& w : windows()) {
+      out += first ? "{\"id\": " : ", {\"id\": ";
+      first = false;
+      putU64(out, w.id);
+      out += ", \"store\": \"" + storeName(w.id) + "\"";
+      out += std::string(", \"state\": \"") + stateName(w.state) + "\", \"reason\": \"" + w.reason + "\", \"triggers\": ";
+      putU64(out, w.triggers);
+      out += ", \"trigger_us\": ";
+      putU64(out, w.triggerUs);
+      out += ", \"from_us\": ";
+      putU64(out, w.fromUs);
+      out += ", \"to_us\": ";
+      putU64(out, w.toUs);
+      out += ", \"rows\": ";
+      putU64(out, w.rows);
+      out += std::string(", \"trimmed\": ") + (w.trimmed ? "true" : "false") + ", \"torn\": " +
+             (w.torn ? "true" : "false") + "}";
+    }
+    return json(out + "]}\n");
+  }
+  return fail(404, "unknown endpoint");
+}
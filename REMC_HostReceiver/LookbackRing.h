@@ -0,0 +1,184 @@
+/*
+  ---------------------------------------------------------------------------
+  LookbackRing – Minutes of Full-Rate Look-Back, Captured After the Fact (host)
+  ---------------------------------------------------------------------------
+
+  The device's SDRAM ring (8 MB) holds seconds of samples, so full-rate
+  data reaches the PC only if a collect command arrives before it wraps.
+  Once the device streams live, the host can keep the look-back instead:
+  LookbackRing holds the newest `bytes` of one node's live samples in
+  memory, as columns (t_us u64, dur u16, one f32 per channel, status u8 –
+  31 bytes a sample for five channels, so 1 GB is ~58 min at 10 kHz).
+
+  Capture windows are marked after the fact and written from the ring:
+
+    mark()                        [t - pre, t + post] around a time (the
+                                  newest sample by default), e.g. from
+                                  GET /api/capture
+    rules, checked on every sample appended:
+      <channel>><level>           the sample where the channel rises above
+      <channel><<level>           ... falls below
+      <status>:rise|fall|change   a status bit edge (armed_status, ...)
+
+  A trigger before the end of a pending window extends it (up to
+  MAX_WINDOW_S) instead of opening another. The persist thread writes a
+  window once the ring holds samples past its end, or by the wall clock
+  (post + SETTLE_S after the last trigger) if the stream stopped, into a
+  CaptureStore <dir>/capture_NNNN with a capture.txt beside the columns
+  (reason, trigger count, window, rows). A window that starts before the
+  oldest sample in the ring is trimmed to it.
+
+  append() runs on the receive thread and takes no lock unless a rule
+  fires. The persist thread reads the ring while it is written: before
+  filling ring slots [h, h + n) the writer stores claimed = h + n, and
+  rows are committed to a capture only if `claimed` shows the writer has
+  not come round to them during the copy; a window the writer overtakes
+  is closed there and counted as torn. mark(), windows(), stats() and
+  handle() from any thread.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef LOOKBACK_RING_H
+#define LOOKBACK_RING_H
+
+#include "CaptureStore.h"
+#include "HttpServer.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class LookbackRing {
+public:
+  static const double DEFAULT_PRE_S;
+  static const double DEFAULT_POST_S;
+  static const double MAX_WINDOW_S;
+  static const double SETTLE_S;
+  static const size_t HISTORY = 64;          // windows kept for windows() after they are written
+  static const size_t COPY_ROWS = 65536;     // rows copied between tear checks
+
+  struct Rule {
+    enum Kind : uint8_t { ABOVE, BELOW, RISE, FALL, CHANGE };
+    Kind kind;
+    uint8_t index;           // channel, or status bit
+    float level;
+    std::string text;
+  };
+
+  enum WindowState : uint8_t { WINDOW_PENDING, WINDOW_WRITTEN, WINDOW_FAILED };
+
+  struct Window {
+    unsigned id;             // capture_NNNN
+    std::string reason;      // the first trigger's rule, or "manual: ..."
+    uint32_t triggers;
+    uint64_t triggerUs;      // first trigger
+    uint64_t fromUs;
+    uint64_t toUs;
+    WindowState state;
+    uint64_t rows;
+    bool trimmed;            // began before the oldest sample in the ring
+    bool torn;               // the writer overtook the copy; the capture ends early
+    double persistMs;
+    std::string dir;
+  };
+
+  struct Stats {
+    uint64_t capacity;       // samples
+    uint64_t bytes;
+    uint64_t appended;
+    uint64_t held;           // in the ring now
+    uint64_t oldestUs;
+    uint64_t newestUs;
+    uint64_t fired;          // rule triggers, merged or not
+    uint64_t marked;         // windows opened
+    uint64_t written;
+    uint64_t failed;
+    uint64_t trimmed;
+    uint64_t torn;
+  };
+
+  LookbackRing();
+  ~LookbackRing();
+
+  // "switch_current_a>500", "armed_status:rise"; channel and status names as in the store
+  static bool parseRule(const std::string& text, const std::vector<std::string>& channels, Rule& rule,
+                        std::string& error);
+
+  // Allocates the ring (MAP_NORESERVE: pages come in as they are written),
+  // creates `dir` and starts the persist thread; captures are created with storeFlags
+  bool start(uint64_t bytes, const std::vector<std::string>& channels, const std::string& dir,
+             const std::vector<Rule>& rules, double preS = DEFAULT_PRE_S, double postS = DEFAULT_POST_S,
+             uint32_t storeFlags = CaptureStore::STORE_COMPRESSED);
+  // Writes out the pending windows that the ring already covers, frees the ring
+  void stop();
+  bool running() const { return _running.load(std::memory_order_acquire); }
+
+  // Receive thread: live samples in time order
+  void append(const CaptureStore::Record* r, size_t n);
+
+  // [tUs - preS, tUs + postS]; tUs 0 is the newest sample. Returns the window id, 0 if not running
+  unsigned mark(uint64_t tUs, double preS, double postS, const std::string& reason);
+
+  std::vector<Window> windows() const;
+  Stats stats() const;
+  const std::string& error() const { return _error; }
+
+  // GET /api/capture?pre=&post=&t=&reason=    marks a window: {"id", "store", "from_us", "to_us"}
+  // GET /api/captures                         {"captures": [{"id", "store", "state", "reason", ...}, ...]}
+  HttpServer::Response handle(const std::string& path, const HttpServer::Query& query);
+
+private:
+  void trigger(const Rule& rule, uint64_t tUs);
+  unsigned open(uint64_t tUs, double preS, double postS, const std::string& reason);
+  void run();
+  void persist(Window& w);
+  uint64_t timeAt(uint64_t row) const { return _t[row % _capacity]; }
+  uint64_t lowerBound(uint64_t first, uint64_t last, uint64_t tUs) const;
+
+  std::string _dir;
+  std::string _error;
+  std::vector<std::string> _channels;
+  uint32_t _storeFlags;
+  double _preS;
+  double _postS;
+
+  // Ring columns in one mapping
+  void* _map;
+  size_t _mapBytes;
+  uint64_t _capacity;
+  uint64_t* _t;
+  uint16_t* _dur;
+  float* _ch[CaptureStore::MAX_CHANNELS];
+  uint8_t* _status;
+  alignas(64) std::atomic<uint64_t> _claimed;   // writer: slots up to here may be changing
+  alignas(64) std::atomic<uint64_t> _head;      // writer: rows [0, head) appended
+  std::atomic<uint64_t> _newestUs;
+
+  // Receive thread: rule state
+  std::vector<Rule> _rules;
+  std::vector<float> _lastValue;
+  uint8_t _lastStatus;
+  bool _haveLast;
+
+  // Windows, under _mutex
+  mutable std::mutex _mutex;
+  std::condition_variable _wake;
+  std::deque<Window> _pending;
+  std::deque<Window> _done;
+  std::vector<Window> _writing;             // the one the persist thread has taken, if any
+  std::vector<double> _deadlines;           // monotonic seconds, one per pending window
+  unsigned _nextId;
+  Stats _stats;
+  bool _stop;
+  std::atomic<bool> _running;
+  std::thread _thread;
+};
+
+#endif // LOOKBACK_RING_H
@@ -0,0 +1,111 @@
+/*
+  ---------------------------------------------------------------------------
+  NeutrinoPacket – Telemetry Datagram Decoding (host)
+  ---------------------------------------------------------------------------
+
+  The 64-byte Neutrino header (big-endian, UdpManager writeHeader()) and
+  the current 42-byte sample record:
+
+    5 × f32 channels | u64 t_us | 6 × u8 status | u64 t_us_end
+
+  all little-endian. Packets with flags FLAGS_SPECTRAL / FLAGS_FAULT /
+  FLAGS_TRACE carry other payloads and decode to zero samples.
+
+  The receiver decodes with the layout compiled from the device's schema
+  (SchemaDecoder.h); decodeSamples() is the fallback for a schema that
+  does not compile.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef NEUTRINO_PACKET_H
+#define NEUTRINO_PACKET_H
+
+#include "CaptureStore.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace Neutrino {
+
+static const size_t HEADER_BYTES = 64;
+static const size_t FRAG_LEN = 16;
+static const size_t CHANNELS = 5;
+static const size_t SAMPLE_BYTES = CHANNELS * 4 + 8 + CaptureStore::NUM_STATUS + 8;  // 42
+
+enum Flags : uint32_t {
+  FLAGS_NORMAL = 0,
+  FLAGS_COLLECTED = 1,
+  FLAGS_BATCH_END = 2,
+  FLAGS_SPECTRAL = 4,
+  FLAGS_FAULT = 8,
+  FLAGS_TRACE = 16,
+};
+
+struct Header {
+  uint32_t msgId;
+  uint32_t flags;
+  uint32_t numFrags;
+  uint32_t numAtomicFrags;
+  uint8_t schemaHash[16];
+  char schemaFrag[FRAG_LEN];
+  uint32_t fragIdx;
+  uint32_t atomicIdx;
+  uint64_t timestampNs;
+};
+
+inline uint32_t be32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline uint64_t be64(const uint8_t* p) {
+  return ((uint64_t)be32(p) << 32) | be32(p + 4);
+}
+
+inline bool parseHeader(const uint8_t* d, size_t len, Header& h) {
+  if (len < HEADER_BYTES) return false;
+  h.msgId = be32(d);
+  h.flags = be32(d + 4);
+  h.numFrags = be32(d + 8);
+  h.numAtomicFrags = be32(d + 12);
+  memcpy(h.schemaHash, d + 16, 16);
+  memcpy(h.schemaFrag, d + 32, FRAG_LEN);
+  h.fragIdx = be32(d + 48);
+  h.atomicIdx = be32(d + 52);
+  h.timestampNs = be64(d + 56);
+  return true;
+}
+
+inline bool carriesSamples(uint32_t flags) {
+  return flags == FLAGS_NORMAL || flags == FLAGS_COLLECTED;
+}
+
+// Decode the 42-byte samples of a sample packet; returns the number written
+// to `out` (at most `max`), 0 for a payload that is not a whole number of
+// samples
+inline size_t decodeSamples(const uint8_t* d, size_t len, CaptureStore::Record* out, size_t max) {
+  if (len < HEADER_BYTES) return 0;
+  const size_t payload = len - HEADER_BYTES;
+  if (payload % SAMPLE_BYTES != 0) return 0;
+  size_t n = payload / SAMPLE_BYTES;
+  if (n > max) n = max;
+
+  const uint8_t* p = d + HEADER_BYTES;
+  for (size_t i = 0; i < n; ++i, p += SAMPLE_BYTES) {
+    CaptureStore::Record& r = out[i];
+    memcpy(r.ch, p, CHANNELS * 4);
+    memcpy(&r.tUs, p + CHANNELS * 4, 8);
+    const uint8_t* st = p + CHANNELS * 4 + 8;
+    r.status = 0;
+    for (size_t b = 0; b < CaptureStore::NUM_STATUS; ++b) {
+      if (st[b]) r.status |= (uint8_t)(1u << b);
+    }
+    memcpy(&r.tUsEnd, st + CaptureStore::NUM_STATUS, 8);
+    if (CaptureStore::isGap(r.ch, CHANNELS)) r.status |= CaptureStore::STATUS_GAP;
+  }
+  return n;
+}
+
+}  // namespace Neutrino
+
+#endif // NEUTRINO_PACKET_H
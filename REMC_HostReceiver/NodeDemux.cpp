@@ -0,0 +1,259 @@
+#include "NodeDemux.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+const size_t SENDERS_PER_NODE = 4;           // source addresses remembered per node slot
+
+uint64_t senderKey(const sockaddr_in& a) {
+  return ((uint64_t)a.sin_addr.s_addr << 16) | ntohs(a.sin_port);
+}
+
+}  // namespace
+
+void NodeDemux::Sequence::add(const uint64_t* times, size_t n, uint64_t periodUs) {
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t t = times[i];
+    if (lastTUs != 0) {
+      if (t <= lastTUs) {
+        ++backwards;
+      } else if ((t - lastTUs) * 2 > periodUs * 3) {
+        ++gaps;
+        missing += (t - lastTUs + periodUs / 2) / periodUs - 1;
+      }
+    }
+    if (t > lastTUs || lastTUs == 0) lastTUs = t;
+  }
+  samples += n;
+}
+
+NodeDemux::Config NodeDemux::defaultConfig(const std::string& storeDir, const std::vector<std::string>& channels) {
+  return Config{ storeDir, channels, CaptureStore::STORE_COMPRESSED, StoreWriter::DEFAULT_QUEUE_BYTES, true,
+                 DEFAULT_MAX_NODES };
+}
+
+NodeDemux::NodeDemux() : _running(false) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+NodeDemux::~NodeDemux() {
+  stop();
+}
+
+bool NodeDemux::start(const Config& cfg) {
+  stop();
+  _cfg = cfg;
+  _nodesDir = cfg.storeDir + "/nodes";
+  mkdir(cfg.storeDir.c_str(), 0755);
+  if (mkdir(_nodesDir.c_str(), 0755) < 0 && errno != EEXIST) {
+    _error = "mkdir " + _nodesDir + ": " + strerror(errno);
+    return false;
+  }
+  _senders.clear();
+  _nodes.clear();
+  _byDir.clear();
+  _schemas = SchemaCache();
+  memset(&_stats, 0, sizeof(_stats));
+  _running = true;
+  return true;
+}
+
+void NodeDemux::stop() {
+  for (std::unique_ptr<Node>& n : _nodes) n->writer->stop();
+  _running = false;
+}
+
+std::string NodeDemux::dirName(const std::string& name, uint32_t ip) {
+  std::string out;
+  for (char c : name) {
+    const bool ok = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' ||
+                    c == '-' || c == '.';
+    out += ok ? c : '_';
+  }
+  if (out.empty() || out == "." || out == "..") out = "node";
+  char addr[INET_ADDRSTRLEN];
+  in_addr a;
+  a.s_addr = ip;
+  inet_ntop(AF_INET, &a, addr, sizeof(addr));
+  return out + "_" + addr;
+}
+
+void NodeDemux::learnSchema(Sender& s, const Neutrino::Header& h) {
+  // The batch-end marker is a bare header: no schema, no hash
+  if (h.numFrags == 0) return;
+  if (!s.haveHash || memcmp(s.hash, h.schemaHash, sizeof(s.hash)) != 0) {
+    // New schema (first packet, or the unit was reflashed): learn the name again
+    memcpy(s.hash, h.schemaHash, sizeof(s.hash));
+    s.haveHash = true;
+    s.decoder.reset();
+    s.periodUs = 0;
+    if (s.node) s.previous = s.node;
+    s.node = nullptr;
+    s.named = false;
+  }
+  if (s.named) return;
+
+  std::shared_ptr<const SchemaDecoder> dec;
+  switch (_schemas.add(h, dec)) {
+    case SchemaCache::SCHEMA_READY:
+      s.decoder = dec;
+      s.name = dec->nodeName().empty() ? "node" : dec->nodeName();
+      s.periodUs = dec->periodUs();
+      s.named = true;
+      break;
+    case SchemaCache::SCHEMA_INVALID:
+      s.name = "node";                          // decoded as the fixed layout
+      s.named = true;
+      break;
+    default:
+      break;
+  }
+}
+
+bool NodeDemux::route(Sender& s, uint32_t ip, uint16_t port) {
+  const std::string dir = dirName(s.name, ip);
+  std::map<std::string, Node*>::iterator it = _byDir.find(dir);
+  Node* node = it == _byDir.end() ? nullptr : it->second;
+  if (!node) {
+    if (_nodes.size() >= _cfg.maxNodes) return false;
+    std::unique_ptr<Node> n(new Node());
+    n->writer.reset(new StoreWriter());
+    if (!n->writer->start(_nodesDir + "/" + dir, _cfg.channels, _cfg.storeFlags, _cfg.queueBytes, _cfg.useIoUring)) {
+      _error = dir + ": " + n->writer->error();
+      return false;
+    }
+    n->st.name = s.name;
+    n->st.dir = dir;
+    n->st.ip = ip;
+    n->st.packets = n->st.rejected = n->st.batches = n->st.schemaChanges = 0;
+    n->st.periodUs = DEFAULT_PERIOD_US;
+    n->st.sampleBytes = 0;
+    memset(&n->st.live, 0, sizeof(n->st.live));
+    memset(&n->st.collected, 0, sizeof(n->st.collected));
+    n->index = _nodes.size();
+    node = n.get();
+    _byDir[dir] = node;
+    _nodes.push_back(std::move(n));
+  }
+  if (s.previous == node) ++node->st.schemaChanges;
+  s.previous = nullptr;
+  s.node = node;
+  node->st.port = port;
+  if (s.periodUs) node->st.periodUs = s.periodUs;
+  node->st.sampleBytes = s.decoder ? (uint32_t)s.decoder->sampleBytes() : 0;
+  return true;
+}
+
+bool NodeDemux::handle(const sockaddr_in& from, const uint8_t* d, size_t len) {
+  Neutrino::Header h;
+  if (!_running || !Neutrino::parseHeader(d, len, h)) return false;
+  ++_stats.packets;
+
+  const uint64_t key = senderKey(from);
+  std::unordered_map<uint64_t, Sender>::iterator it = _senders.find(key);
+  if (it == _senders.end()) {
+    if (_senders.size() >= _cfg.maxNodes * SENDERS_PER_NODE) {
+      ++_stats.unrouted;
+      return true;
+    }
+    Sender fresh;
+    memset(fresh.hash, 0, sizeof(fresh.hash));
+    fresh.haveHash = false;
+    fresh.periodUs = 0;
+    fresh.named = false;
+    fresh.node = nullptr;
+    fresh.previous = nullptr;
+    it = _senders.emplace(key, fresh).first;
+  }
+  Sender& s = it->second;
+  learnSchema(s, h);
+
+  if (!s.named) {
+    if (s.held.size() < PENDING_PACKETS) s.held.push_back(std::vector<uint8_t>(d, d + len));
+    else ++_stats.dropped;
+    return true;
+  }
+  if (!s.node && !route(s, from.sin_addr.s_addr, ntohs(from.sin_port))) {
+    _stats.unrouted += 1 + s.held.size();
+    s.held.clear();
+    return true;
+  }
+  if (s.periodUs) s.node->st.periodUs = s.periodUs;
+
+  // Packets that came before the name, in arrival order
+  while (!s.held.empty()) {
+    Neutrino::Header hh;
+    const std::vector<uint8_t>& p = s.held.front();
+    if (Neutrino::parseHeader(p.data(), p.size(), hh)) file(*s.node, s.decoder, p.data(), p.size(), hh);
+    s.held.pop_front();
+  }
+  file(*s.node, s.decoder, d, len, h);
+  return true;
+}
+
+void NodeDemux::file(Node& n, const std::shared_ptr<const SchemaDecoder>& dec, const uint8_t* d, size_t len,
+                     const Neutrino::Header& h) {
+  ++n.st.packets;
+  if (h.flags == Neutrino::FLAGS_BATCH_END) {
+    n.writer->endBatch();
+    ++n.st.batches;
+    n.st.collected.lastTUs = 0;
+    return;
+  }
+  if (!Neutrino::carriesSamples(h.flags)) return;
+
+  // With a schema only the times are decoded here; the writer thread
+  // decodes the payload straight into the store's columns
+  const uint8_t* payload = d + Neutrino::HEADER_BYTES;
+  const size_t bytes = len - Neutrino::HEADER_BYTES;
+  size_t count = 0;
+  if (dec) {
+    if (bytes % dec->sampleBytes() == 0) count = std::min(bytes / dec->sampleBytes(), (size_t)StoreWriter::MAX_PACKET_SAMPLES);
+    BlockCodec::ColumnsOut times;
+    memset(&times, 0, sizeof(times));
+    times.t = _times;
+    if (count) dec->decodeColumns(payload, count * dec->sampleBytes(), times);
+  } else {
+    count = Neutrino::decodeSamples(d, len, _records, StoreWriter::MAX_PACKET_SAMPLES);
+    for (size_t i = 0; i < count; ++i) _times[i] = _records[i].tUs;
+  }
+  if (count == 0) {
+    ++n.st.rejected;
+    return;
+  }
+  const bool collected = h.flags == Neutrino::FLAGS_COLLECTED;
+  (collected ? n.st.collected : n.st.live).add(_times, count, n.st.periodUs);
+  if (dec) {
+    if (collected) n.writer->appendCollected(dec, payload, count);
+    else n.writer->appendLive(dec, payload, count);
+  } else {
+    if (collected) n.writer->appendCollected(_records, count);
+    else n.writer->appendLive(_records, count);
+  }
+  if (_hook) {
+    if (dec) dec->decode(payload, count * dec->sampleBytes(), _records, count);
+    _hook(n.index, _records, count, h.flags);
+  }
+}
+
+NodeDemux::NodeStats NodeDemux::nodeStats(size_t index) const {
+  NodeStats st = _nodes[index]->st;
+  st.writer = _nodes[index]->writer->stats();
+  return st;
+}
+
+NodeDemux::Stats NodeDemux::stats() const {
+  Stats st = _stats;
+  st.schemas = _schemas.stats().compiled;
+  st.badSchemas = _schemas.stats().invalid;
+  st.held = 0;
+  for (const auto& kv : _senders) st.held += kv.second.held.size();
+  return st;
+}
@@ -0,0 +1,180 @@
+/*
+  ---------------------------------------------------------------------------
+  NodeDemux – Per-Device Streams on the Shared Telemetry Group (host)
+  ---------------------------------------------------------------------------
+
+  Every REMC unit on the LAN sends to the same group (239.9.9.33:13013).
+  NodeDemux files each datagram under the unit that sent it, keyed by the
+  sender's IPv4 address and the schema's node_name, and gives every unit
+  its own stores, sequence tracking and batch state:
+
+    <store>/nodes/<node_name>_<a.b.c.d>/live/
+    <store>/nodes/<node_name>_<a.b.c.d>/batches/batch_NNNN/
+
+  Each node directory has the layout of a single-device --store root, so
+  QueryApi, capture_tool and capture_store.py open it unchanged.
+
+  The name comes from the schema (16 bytes per packet, cycling), which
+  SchemaCache (SchemaDecoder.h) reassembles and compiles once per hash: a
+  sender's packets are held until its schema is complete, at most
+  PENDING_PACKETS of them, then decoded with that schema's layout and
+  filed in order: the sample payload goes to the node's StoreWriter as is,
+  with the decoder, and is decoded into the store's columns on the writer
+  thread (Records are built here only for the sample hook). A schema that
+  does not compile is decoded as the fixed 42-byte layout under the name
+  "node". A new schema hash from the same address starts over; if the
+  name is unchanged the packets go on to the same node. Bare headers (the
+  batch-end marker) carry no schema and follow the sender's current node.
+  telem_period from the schema sets the spacing the sequence tracking
+  expects (100 µs without it).
+
+  Sequence tracking: the packets carry no counter, so continuity is judged
+  on the sample times, per stream (live, and the collect dump in progress):
+  a step of more than 1.5 periods is a gap worth round(step / period) - 1
+  missing samples; a time not after the previous one is counted backwards
+  (a repeat or reordering).
+
+  Each node's stores are written by its own StoreWriter thread; handle()
+  never touches the disk. Not thread-safe: one thread calls handle() and
+  stats().
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef NODE_DEMUX_H
+#define NODE_DEMUX_H
+
+#include "CaptureStore.h"
+#include "NeutrinoPacket.h"
+#include "SchemaDecoder.h"
+#include "StoreWriter.h"
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class NodeDemux {
+public:
+  static const size_t DEFAULT_MAX_NODES = 32;
+  static const size_t PENDING_PACKETS = 256;   // held per sender until named; the schema cycles in ~30
+  static const uint64_t DEFAULT_PERIOD_US = 100;
+
+  struct Config {
+    std::string storeDir;
+    std::vector<std::string> channels;
+    uint32_t storeFlags;
+    size_t queueBytes;       // per node
+    bool useIoUring;
+    size_t maxNodes;         // more are counted in Stats::unrouted
+  };
+
+  struct Sequence {
+    uint64_t samples;
+    uint64_t gaps;
+    uint64_t missing;        // samples the gaps stand for
+    uint64_t backwards;
+    uint64_t lastTUs;        // 0: stream (re)starts
+
+    void add(const uint64_t* times, size_t n, uint64_t periodUs);
+  };
+
+  struct NodeStats {
+    std::string name;        // schema node_name
+    std::string dir;         // directory under <store>/nodes
+    uint32_t ip;             // network byte order
+    uint16_t port;           // latest source port, host order
+    uint64_t packets;
+    uint64_t rejected;       // sample packets that did not decode
+    uint64_t batches;        // batch-end markers
+    uint64_t schemaChanges;
+    uint64_t periodUs;
+    uint32_t sampleBytes;    // of the schema's layout; 0: fixed 42-byte layout
+    Sequence live;
+    Sequence collected;      // reset at every batch end
+    StoreWriter::Stats writer;
+  };
+
+  struct Stats {
+    uint64_t packets;        // Neutrino packets seen
+    uint64_t held;           // waiting for their sender's name now
+    uint64_t dropped;        // held too long or beyond PENDING_PACKETS
+    uint64_t unrouted;       // beyond maxNodes or too many unnamed senders
+    uint64_t schemas;        // compiled
+    uint64_t badSchemas;     // complete but not compilable, or too long
+  };
+
+  // Samples filed under node `index` (as in stats()), after they were queued for its stores
+  typedef std::function<void(size_t index, const CaptureStore::Record* r, size_t n, uint32_t flags)> SampleHook;
+
+  static Config defaultConfig(const std::string& storeDir, const std::vector<std::string>& channels);
+
+  NodeDemux();
+  ~NodeDemux();
+
+  // Creates <storeDir>/nodes; nodes' stores are opened as they appear
+  bool start(const Config& cfg);
+  // Stops every node's writer (queued packets are written out)
+  void stop();
+
+  void setSampleHook(SampleHook hook) { _hook = hook; }
+
+  // One datagram; false if it is not a Neutrino packet
+  bool handle(const sockaddr_in& from, const uint8_t* d, size_t len);
+
+  size_t nodeCount() const { return _nodes.size(); }
+  NodeStats nodeStats(size_t index) const;
+  Stats stats() const;
+  const std::string& error() const { return _error; }
+
+  // "<name>_<a.b.c.d>" with anything outside [A-Za-z0-9_.-] in the name replaced
+  static std::string dirName(const std::string& name, uint32_t ip);
+
+private:
+  struct Node;
+
+  struct Sender {
+    uint8_t hash[16];
+    bool haveHash;
+    std::shared_ptr<const SchemaDecoder> decoder;   // null until compiled
+    uint64_t periodUs;       // 0 until telem_period is known
+    bool named;
+    std::string name;
+    Node* node;              // nullptr until named
+    Node* previous;          // before a schema change
+    std::deque<std::vector<uint8_t> > held;
+  };
+
+  struct Node {
+    NodeStats st;
+    std::unique_ptr<StoreWriter> writer;
+    size_t index;
+  };
+
+  void learnSchema(Sender& s, const Neutrino::Header& h);
+  bool route(Sender& s, uint32_t ip, uint16_t port);
+  void file(Node& n, const std::shared_ptr<const SchemaDecoder>& dec, const uint8_t* d, size_t len,
+            const Neutrino::Header& h);
+
+  Config _cfg;
+  std::string _nodesDir;
+  std::string _error;
+  SampleHook _hook;
+  bool _running;
+
+  std::unordered_map<uint64_t, Sender> _senders;   // ip << 16 | port
+  std::vector<std::unique_ptr<Node> > _nodes;
+  std::map<std::string, Node*> _byDir;
+  SchemaCache _schemas;
+  Stats _stats;
+  CaptureStore::Record _records[StoreWriter::MAX_PACKET_SAMPLES];
+  uint64_t _times[StoreWriter::MAX_PACKET_SAMPLES];
+};
+
+#endif // NODE_DEMUX_H
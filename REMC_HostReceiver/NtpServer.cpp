@@ -0,0 +1,367 @@
+#include "NtpServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/timex.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static const uint64_t NS_PER_S = 1000000000ull;
+static const uint64_t HOST_CLOCK_CHECK_NS = 16 * NS_PER_S;
+static const int64_t WALL_CLOCK_WINDOW_NS = 86400 * (int64_t)NS_PER_S;   // a transmit time further off is not a clock
+
+static uint64_t realtimeNs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * NS_PER_S + (uint64_t)ts.tv_nsec;
+}
+
+static void putBe32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static void putBe64(uint8_t* p, uint64_t v) {
+  putBe32(p, (uint32_t)(v >> 32));
+  putBe32(p + 4, (uint32_t)v);
+}
+
+static uint32_t getBe32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t getBe64(const uint8_t* p) {
+  return ((uint64_t)getBe32(p) << 32) | getBe32(p + 4);
+}
+
+// Era 0 only (until 2036), like the device
+uint64_t NtpServer::toNtp(uint64_t unixNs) {
+  const uint64_t secs = unixNs / NS_PER_S + NTP_UNIX_EPOCH_DIFF;
+  const uint64_t frac = ((unixNs % NS_PER_S) << 32) / NS_PER_S;
+  return (secs << 32) | frac;
+}
+
+uint64_t NtpServer::fromNtp(uint64_t ntp) {
+  const uint64_t secs = ntp >> 32;
+  if (secs < NTP_UNIX_EPOCH_DIFF) return 0;
+  return (secs - NTP_UNIX_EPOCH_DIFF) * NS_PER_S + (((ntp & 0xFFFFFFFFull) * NS_PER_S) >> 32);
+}
+
+double NtpServer::ClientStats::offsetStddev() const {
+  return offsets > 1 ? sqrt(offsetM2 / offsets) : 0.0;
+}
+
+double NtpServer::Stats::turnaroundPercentileUs(double q) const {
+  if (turnaroundCount == 0) return 0.0;
+  uint64_t rank = (uint64_t)ceil(q * turnaroundCount);
+  rank = std::max<uint64_t>(1, std::min<uint64_t>(rank, turnaroundCount));
+  uint64_t seen = 0;
+  for (size_t i = 0; i + 1 < TURNAROUND_BUCKETS; ++i) {
+    seen += turnaround[i];
+    if (seen >= rank) return (i + 0.5) * TURNAROUND_BUCKET_NS / 1000.0;
+  }
+  return turnaroundMaxNs / 1000.0;
+}
+
+NtpServer::NtpServer()
+  : _fd(-1), _beaconFd(-1), _beaconPoll(0), _port(0), _cfg(defaultConfig()), _precision(-20), _hostSynced(false), _rootDispersion(0),
+    _hostClockCheckedNs(0) {
+  memset(&_stats, 0, sizeof(_stats));
+  memset(&_beaconAddr, 0, sizeof(_beaconAddr));
+}
+
+NtpServer::~NtpServer() {
+  close();
+}
+
+bool NtpServer::open(const Config& cfg) {
+  close();
+  _cfg = cfg;
+  _fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (_fd < 0) {
+    _error = std::string("socket: ") + strerror(errno);
+    return false;
+  }
+  int one = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (setsockopt(_fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) < 0) {
+    _error = std::string("SO_TIMESTAMPNS: ") + strerror(errno);
+    close();
+    return false;
+  }
+  int rcvbuf = 1 << 20;
+  setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(cfg.port);
+  if (inet_pton(AF_INET, cfg.bindIp, &local.sin_addr) != 1) {
+    _error = std::string("bad bind address ") + cfg.bindIp;
+    close();
+    return false;
+  }
+  if (bind(_fd, (sockaddr*)&local, sizeof(local)) < 0) {
+    _error = "bind " + std::string(cfg.bindIp) + ":" + std::to_string(cfg.port) + ": " + strerror(errno);
+    const int e = errno;
+    close();
+    errno = e;
+    return false;
+  }
+  socklen_t len = sizeof(local);
+  getsockname(_fd, (sockaddr*)&local, &len);
+  _port = ntohs(local.sin_port);
+
+  // Precision: log2 of the shortest step between two clock reads
+  uint64_t step = UINT64_MAX;
+  for (int i = 0; i < 1000; ++i) {
+    const uint64_t a = realtimeNs(), b = realtimeNs();
+    if (b > a) step = std::min(step, b - a);
+  }
+  _precision = step == UINT64_MAX ? -20 : (int8_t)ceil(log2(step / 1e9));
+
+  for (size_t i = 0; i < BATCH; ++i) {
+    _iovs[i].iov_base = _buf[i];
+    _iovs[i].iov_len = SLOT_BYTES;
+  }
+  _hostClockCheckedNs = 0;
+  refreshHostClock(realtimeNs());
+  return true;
+}
+
+void NtpServer::close() {
+  if (_fd >= 0) ::close(_fd);
+  if (_beaconFd >= 0) ::close(_beaconFd);
+  _fd = -1;
+  _beaconFd = -1;
+}
+
+bool NtpServer::openBeacon(const char* group, uint16_t port, const char* ifaceIp, uint8_t ttl, double intervalS) {
+  if (_beaconFd >= 0) ::close(_beaconFd);
+  _beaconFd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (_beaconFd < 0) {
+    _error = std::string("socket: ") + strerror(errno);
+    return false;
+  }
+  memset(&_beaconAddr, 0, sizeof(_beaconAddr));
+  _beaconAddr.sin_family = AF_INET;
+  _beaconAddr.sin_port = htons(port);
+  if (inet_pton(AF_INET, group, &_beaconAddr.sin_addr) != 1) {
+    _error = std::string("bad beacon group ") + group;
+    ::close(_beaconFd);
+    _beaconFd = -1;
+    return false;
+  }
+  setsockopt(_beaconFd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  if (ifaceIp) {
+    in_addr iface;
+    if (inet_pton(AF_INET, ifaceIp, &iface) != 1 ||
+        setsockopt(_beaconFd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0) {
+      _error = std::string("beacon interface ") + ifaceIp + ": " + strerror(errno);
+      ::close(_beaconFd);
+      _beaconFd = -1;
+      return false;
+    }
+  }
+  _beaconPoll = (int8_t)std::max(-6.0, std::min(17.0, round(log2(intervalS))));
+  return true;
+}
+
+bool NtpServer::sendBeacon() {
+  if (_beaconFd < 0) return false;
+  uint8_t b[PACKET_SIZE];
+  memset(b, 0, sizeof(b));
+  const uint64_t now = realtimeNs();
+  refreshHostClock(now);
+  b[0] = (uint8_t)((4 << 3) | 5);              // LI 0, version 4, broadcast mode
+  b[1] = _cfg.stratum;
+  b[2] = (uint8_t)_beaconPoll;
+  b[3] = (uint8_t)_precision;
+  putBe32(b + 8, _rootDispersion);
+  memcpy(b + 12, _cfg.refId, 4);
+  putBe64(b + 16, toNtp(now - now % NS_PER_S));
+  putBe64(b + 40, toNtp(realtimeNs()));        // originate and receive stay 0
+  if (sendto(_beaconFd, b, sizeof(b), 0, (const sockaddr*)&_beaconAddr, sizeof(_beaconAddr)) != (ssize_t)sizeof(b)) {
+    _error = std::string("beacon send: ") + strerror(errno);
+    ++_stats.beaconErrors;
+    return false;
+  }
+  ++_stats.beaconsSent;
+  return true;
+}
+
+void NtpServer::refreshHostClock(uint64_t nowNs) {
+  if (_hostClockCheckedNs && nowNs - _hostClockCheckedNs < HOST_CLOCK_CHECK_NS) return;
+  _hostClockCheckedNs = nowNs;
+  timex tx;
+  memset(&tx, 0, sizeof(tx));
+  const int state = adjtimex(&tx);
+  _hostSynced = state >= 0 && state != TIME_ERROR && !(tx.status & STA_UNSYNC);
+  // esterror is µs; NTP short format is 16.16 seconds
+  _rootDispersion = _hostSynced ? (uint32_t)std::min<uint64_t>(((uint64_t)tx.esterror << 16) / 1000000, UINT32_MAX) : 0;
+}
+
+int NtpServer::poll(int timeoutMs) {
+  if (_fd < 0) return -1;
+  pollfd pfd = { _fd, POLLIN, 0 };
+  const int ready = ::poll(&pfd, 1, timeoutMs);
+  if (ready < 0) return errno == EINTR ? 0 : -1;
+  if (ready == 0) return 0;
+
+  int answered = 0;
+  while (true) {
+    for (size_t i = 0; i < BATCH; ++i) {
+      msghdr& h = _msgs[i].msg_hdr;
+      h.msg_name = &_addrs[i];
+      h.msg_namelen = sizeof(_addrs[i]);
+      h.msg_iov = &_iovs[i];
+      h.msg_iovlen = 1;
+      h.msg_control = _control[i];
+      h.msg_controllen = CONTROL_BYTES;
+      h.msg_flags = 0;
+    }
+    const int n = recvmmsg(_fd, _msgs, BATCH, MSG_DONTWAIT, nullptr);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+      _error = std::string("recvmmsg: ") + strerror(errno);
+      return -1;
+    }
+    if (n == 0) break;
+    ++_stats.batches;
+    const uint64_t before = _stats.requests;
+    for (int i = 0; i < n; ++i) answer((size_t)i);
+    answered += (int)(_stats.requests - before);
+    if ((size_t)n < BATCH) break;
+  }
+  return answered;
+}
+
+void NtpServer::answer(size_t i) {
+  const uint8_t* q = _buf[i];
+  const msghdr& h = _msgs[i].msg_hdr;
+  const unsigned version = (q[0] >> 3) & 0x07;
+  if (_msgs[i].msg_len < PACKET_SIZE || (q[0] & 0x07) != 3 || version < 1 || version > 4) {
+    ++_stats.dropped;
+    return;
+  }
+
+  uint64_t t2 = 0;
+  for (cmsghdr* c = CMSG_FIRSTHDR(&h); c; c = CMSG_NXTHDR(const_cast<msghdr*>(&h), c)) {
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+      timespec ts;
+      memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+      t2 = (uint64_t)ts.tv_sec * NS_PER_S + (uint64_t)ts.tv_nsec;
+    }
+  }
+  if (t2 == 0) {
+    t2 = realtimeNs();
+    ++_stats.noKernelStamp;
+  }
+  refreshHostClock(t2);
+
+  uint8_t r[PACKET_SIZE];
+  r[0] = (uint8_t)((version << 3) | 4);        // LI 0, client's version, server mode
+  r[1] = _cfg.stratum;
+  r[2] = q[2];                                 // poll, echoed
+  r[3] = (uint8_t)_precision;
+  putBe32(r + 4, 0);                           // root delay: a reference clock
+  putBe32(r + 8, _rootDispersion);
+  memcpy(r + 12, _cfg.refId, 4);
+  putBe64(r + 16, toNtp(t2 - t2 % NS_PER_S));  // reference: the current second
+  memcpy(r + 24, q + 40, 8);                   // originate = client's transmit
+  putBe64(r + 32, toNtp(t2));
+  const uint64_t t3 = realtimeNs();
+  putBe64(r + 40, toNtp(t3));
+  if (sendto(_fd, r, sizeof(r), 0, (const sockaddr*)&_addrs[i], sizeof(_addrs[i])) != (ssize_t)sizeof(r)) {
+    ++_stats.sendErrors;
+    return;
+  }
+
+  ++_stats.requests;
+  ++_stats.turnaroundCount;
+  const uint64_t turn = t3 > t2 ? t3 - t2 : 0;
+  _stats.turnaroundMaxNs = std::max(_stats.turnaroundMaxNs, turn);
+  ++_stats.turnaround[std::min<uint64_t>(turn / TURNAROUND_BUCKET_NS, TURNAROUND_BUCKETS - 1)];
+  track(_addrs[i].sin_addr.s_addr, getBe64(q + 40), getBe32(q + 4), t2);
+}
+
+void NtpServer::track(uint32_t ip, uint64_t t1Ntp, uint32_t rootDelay, uint64_t t2Ns) {
+  auto it = _clients.find(ip);
+  if (it == _clients.end()) {
+    if (_clients.size() >= _cfg.maxClients) {
+      ++_stats.untracked;
+      return;
+    }
+    ClientStats fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    fresh.offsetMin = fresh.delayMin = INT64_MAX;
+    fresh.offsetMax = fresh.delayMax = INT64_MIN;
+    it = _clients.emplace(ip, fresh).first;
+  }
+  ClientStats& c = it->second;
+  ++c.requests;
+  c.lastSeenNs = t2Ns;
+
+  // Root delay, 16.16 seconds
+  const int64_t delayNs = (int64_t)(((uint64_t)rootDelay * NS_PER_S) >> 16);
+  if (rootDelay) {
+    ++c.delays;
+    c.delaySum += (double)delayNs;
+    c.delayMin = std::min(c.delayMin, delayNs);
+    c.delayMax = std::max(c.delayMax, delayNs);
+  }
+
+  const uint64_t t1Ns = fromNtp(t1Ntp);
+  const int64_t raw = (int64_t)(t1Ns - t2Ns);
+  if (t1Ns == 0 || raw > WALL_CLOCK_WINDOW_NS || raw < -WALL_CLOCK_WINDOW_NS) {
+    ++c.notSynced;
+    return;
+  }
+  const int64_t offset = raw + delayNs / 2;
+  ++c.offsets;
+  const double d = offset - c.offsetMean;
+  c.offsetMean += d / c.offsets;
+  c.offsetM2 += d * (offset - c.offsetMean);
+  c.offsetMin = std::min(c.offsetMin, offset);
+  c.offsetMax = std::max(c.offsetMax, offset);
+}
+
+void NtpServer::clearWindow() {
+  _clients.clear();
+  _stats.turnaroundCount = 0;
+  _stats.turnaroundMaxNs = 0;
+  memset(_stats.turnaround, 0, sizeof(_stats.turnaround));
+}
+
+void NtpServer::printClients(FILE* out) const {
+  std::vector<std::pair<uint32_t, const ClientStats*> > order;
+  for (const auto& kv : _clients) order.push_back(std::make_pair(kv.first, &kv.second));
+  std::sort(order.begin(), order.end(), [](const std::pair<uint32_t, const ClientStats*>& a,
+                                           const std::pair<uint32_t, const ClientStats*>& b) {
+    return a.second->requests > b.second->requests;
+  });
+  for (const auto& e : order) {
+    const ClientStats& c = *e.second;
+    char ip[INET_ADDRSTRLEN];
+    in_addr a;
+    a.s_addr = e.first;
+    inet_ntop(AF_INET, &a, ip, sizeof(ip));
+    fprintf(out, "  %-15s %6llu req", ip, (unsigned long long)c.requests);
+    if (c.offsets)
+      fprintf(out, "  offset %+.1f µs (σ %.1f, %+.1f .. %+.1f)", c.offsetMean / 1e3, c.offsetStddev() / 1e3,
+              c.offsetMin / 1e3, c.offsetMax / 1e3);
+    if (c.delays)
+      fprintf(out, "  rtt %.1f µs (%.1f .. %.1f)", c.delaySum / c.delays / 1e3, c.delayMin / 1e3, c.delayMax / 1e3);
+    if (c.notSynced) fprintf(out, "  %llu not synced", (unsigned long long)c.notSynced);
+    fprintf(out, "\n");
+  }
+}
@@ -0,0 +1,175 @@
+/*
+  ---------------------------------------------------------------------------
+  NtpServer – NTP Responder with Kernel Receive Timestamps (host)
+  ---------------------------------------------------------------------------
+
+  The C++ replacement for basic_ntp_server.py. Answers NTPv3/v4 client
+  requests (mode 3) on one UDP socket with every timestamp a client needs
+  for offset and round-trip delay (RFC 5905):
+
+    originate   the request's transmit timestamp, copied verbatim
+    receive     the kernel's arrival time of the request (SO_TIMESTAMPNS),
+                so time spent waking the server is not charged to the path
+    transmit    CLOCK_REALTIME read immediately before the reply is sent
+
+  Requests are read in batches with recvmmsg() and each reply is stamped
+  and sent on its own, so a burst costs one wakeup and the last reply's
+  transmit time is still exact. Anything that is not a client request of
+  at least 48 bytes is dropped and counted.
+
+  Like the Python server this is a local reference clock: stratum 1, "LOCL"
+  by default, leap indicator 0. Root dispersion carries the kernel's
+  estimated error when the host clock is itself disciplined (adjtimex).
+
+  Per client address it keeps statistics of the client's clock as seen
+  here: offset = T1 - T2 + delay / 2, where T1 is the request's transmit
+  time and delay the client's own root delay from the request (the REMC
+  device puts its last measured round trip there; 0 if absent). Requests
+  whose transmit time is not a wall-clock time (a device that has not
+  synced yet) are counted but kept out of the offset figures. Turnaround
+  (receive to transmit) is kept for the server as a whole. Both cover the
+  period since clearWindow(); the counters in Stats run for the lifetime.
+
+  Optionally it also multicasts time beacons (openBeacon / sendBeacon):
+  NTPv4 broadcast-mode packets (mode 5) whose transmit time is read just
+  before the send, for devices that discipline their clock passively
+  from the NTP group instead of polling (BeaconFilter on the CM7).
+
+  Not thread-safe; one thread calls poll() and sendBeacon(), or stats are
+  read between them.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef NTP_SERVER_H
+#define NTP_SERVER_H
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <string>
+#include <unordered_map>
+
+class NtpServer {
+public:
+  static const size_t PACKET_SIZE = 48;
+  static const uint32_t NTP_UNIX_EPOCH_DIFF = 2208988800u;   // seconds, 1900 to 1970
+
+  struct Config {
+    const char* bindIp;
+    uint16_t port;
+    uint8_t stratum;
+    char refId[4];
+    size_t maxClients;       // addresses tracked; more are counted in Stats::untracked
+  };
+  static Config defaultConfig() { return Config{ "0.0.0.0", 123, 1, { 'L', 'O', 'C', 'L' }, 1024 }; }
+
+  struct ClientStats {
+    uint64_t requests;
+    uint64_t lastSeenNs;     // server time of the latest request
+    uint64_t notSynced;      // transmit time not a wall-clock time
+    // Client clock minus server clock, ns
+    uint64_t offsets;
+    double offsetMean;
+    double offsetM2;         // Welford sum of squares
+    int64_t offsetMin;
+    int64_t offsetMax;
+    // Root delay the client reported (its last round trip), ns
+    uint64_t delays;
+    double delaySum;
+    int64_t delayMin;
+    int64_t delayMax;
+
+    double offsetStddev() const;
+  };
+
+  // Turnaround buckets: 100 ns each up to 100 µs, then one overflow bucket
+  static const size_t TURNAROUND_BUCKETS = 1001;
+  static const uint64_t TURNAROUND_BUCKET_NS = 100;
+
+  struct Stats {
+    uint64_t requests;       // client requests answered
+    uint64_t dropped;        // short or not mode 3
+    uint64_t sendErrors;
+    uint64_t noKernelStamp;  // receive time taken in user space instead
+    uint64_t untracked;      // requests from clients beyond maxClients
+    uint64_t batches;        // recvmmsg calls that returned requests
+    uint64_t beaconsSent;
+    uint64_t beaconErrors;
+    // Receive to transmit, since the last clearWindow()
+    uint64_t turnaroundCount;
+    uint64_t turnaroundMaxNs;
+    uint64_t turnaround[TURNAROUND_BUCKETS];
+
+    double turnaroundPercentileUs(double q) const;
+  };
+
+  NtpServer();
+  ~NtpServer();
+
+  bool open(const Config& cfg);
+  void close();
+
+  // Waits up to timeoutMs for requests and answers all that arrived; returns
+  // the number answered, -1 on a socket error
+  int poll(int timeoutMs);
+
+  uint16_t port() const { return _port; }
+  int8_t precision() const { return _precision; }
+  bool hostSynced() const { return _hostSynced; }
+  const Stats& stats() const { return _stats; }
+  // Keyed by IPv4 address, network byte order
+  const std::unordered_map<uint32_t, ClientStats>& clients() const { return _clients; }
+  // Multicast beacons to group:port, out of the interface with address
+  // ifaceIp (nullptr: the kernel's choice); intervalS only sets the poll
+  // field, the caller paces sendBeacon()
+  bool openBeacon(const char* group, uint16_t port, const char* ifaceIp, uint8_t ttl, double intervalS);
+  bool sendBeacon();
+
+  // Starts a new logging period: client statistics and turnaround
+  void clearWindow();
+
+  // One line per client, busiest first
+  void printClients(FILE* out) const;
+
+  const std::string& error() const { return _error; }
+
+  // NTP 64-bit timestamp <-> Unix ns
+  static uint64_t toNtp(uint64_t unixNs);
+  static uint64_t fromNtp(uint64_t ntp);
+
+private:
+  static const size_t BATCH = 32;
+  static const size_t SLOT_BYTES = 64;      // header only; extension fields and MACs are cut off
+  static const size_t CONTROL_BYTES = 64;
+
+  void answer(size_t i);
+  void track(uint32_t ip, uint64_t t1Ntp, uint32_t rootDelay, uint64_t t2Ns);
+  void refreshHostClock(uint64_t nowNs);
+
+  int _fd;
+  int _beaconFd;
+  sockaddr_in _beaconAddr;
+  int8_t _beaconPoll;                // log2 of the beacon interval, s
+  uint16_t _port;
+  Config _cfg;
+  int8_t _precision;
+  bool _hostSynced;
+  uint32_t _rootDispersion;          // NTP short format
+  uint64_t _hostClockCheckedNs;
+  Stats _stats;
+  std::unordered_map<uint32_t, ClientStats> _clients;
+  std::string _error;
+
+  // recvmmsg buffers
+  mmsghdr _msgs[BATCH];
+  iovec _iovs[BATCH];
+  sockaddr_in _addrs[BATCH];
+  uint8_t _buf[BATCH][SLOT_BYTES];
+  uint8_t _control[BATCH][CONTROL_BYTES];
+};
+
+#endif // NTP_SERVER_H
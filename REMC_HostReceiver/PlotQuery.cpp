@@ -0,0 +1,185 @@
+#include "PlotQuery.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace PlotQuery {
+
+namespace {
+
+using CaptureStore::BlockView;
+using CaptureStore::ChannelRange;
+using CaptureStore::ChunkHeader;
+using CaptureStore::SummaryView;
+
+struct Buckets {
+  uint64_t t0;
+  uint64_t t1;
+  uint64_t width;            // µs per bucket
+  std::vector<Bucket>& out;
+
+  void add(uint64_t t, float v) {
+    Bucket& b = out[(size_t)((t - t0) / width)];
+    b.rows++;
+    if (v < b.min) { b.min = v; b.tMin = t; }
+    if (v > b.max) { b.max = v; b.tMax = t; }
+  }
+
+  void merge(uint64_t t, const ChunkHeader& h, const ChannelRange& r) {
+    Bucket& b = out[(size_t)((t - t0) / width)];
+    b.rows += h.rows;
+    if (r.min < b.min) { b.min = r.min; b.tMin = rowTime(h, r.minRow); }
+    if (r.max > b.max) { b.max = r.max; b.tMax = rowTime(h, r.maxRow); }
+  }
+
+  static uint64_t rowTime(const ChunkHeader& h, uint32_t row) {
+    if (h.rows < 2 || h.tLast <= h.tFirst) return h.tFirst;
+    return h.tFirst + (h.tLast - h.tFirst) * row / (h.rows - 1);
+  }
+};
+
+// First sealed block whose running maximum reaches t (blockCount() - 1 at most)
+uint64_t firstBlock(const CaptureStore::Reader& r, uint64_t t) {
+  uint64_t lo = 0, hi = r.sealedBlocks();
+  while (lo < hi) {
+    const uint64_t mid = (lo + hi) / 2;
+    if (r.blockIndex(mid).tMax < t) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+bool minMaxSnapped(const CaptureStore::Reader& r, size_t channel, uint64_t t0, uint64_t t1, size_t width,
+                   uint64_t snapRatio, std::vector<Bucket>& out, Stats* stats) {
+  if (channel >= r.channelCount() || t1 <= t0 || width == 0) return false;
+  const uint64_t span = t1 - t0;
+  Buckets bk = { t0, t1, std::max<uint64_t>(1, (span + width - 1) / width), out };
+  const size_t n = (size_t)((span + bk.width - 1) / bk.width);
+  out.assign(n, Bucket());
+  for (size_t i = 0; i < n; ++i) {
+    out[i].tStart = t0 + i * bk.width;
+    out[i].min = INFINITY;
+    out[i].max = -INFINITY;
+  }
+  Stats st = { 0, 0, 0 };
+
+  for (uint64_t b = firstBlock(r, t0); b < r.blockCount(); ++b) {
+    if (b < r.sealedBlocks() && r.blockIndex(b).tFirst >= t1) break;
+    SummaryView s;
+    if (!r.summary(b, s)) return false;
+    bool past = false;
+    for (uint32_t k = 0; k < s.chunks && !past; ++k) {
+      const ChunkHeader& h = s.chunk(k);
+      if (h.tFirst >= t1) {
+        past = true;
+        break;
+      }
+      if (h.tLast < t0) continue;
+
+      const bool inside = h.tFirst >= t0 && h.tLast < t1;
+      if (inside && (h.tFirst - t0) / bk.width == (h.tLast - t0) / bk.width) {
+        bk.merge(h.tFirst, h, s.range(k, channel));
+        st.chunks++;
+        continue;
+      }
+      const uint64_t mid = h.tFirst + (h.tLast - h.tFirst) / 2;
+      if ((h.tLast - h.tFirst) * snapRatio <= bk.width) {
+        if (mid >= t0 && mid < t1) {
+          bk.merge(mid, h, s.range(k, channel));
+          st.chunks++;
+          st.snapped++;
+        }
+        continue;
+      }
+
+      // Straddles an edge at a zoom where that matters: read the rows
+      BlockView v;
+      if (!r.block(b, v, BlockCodec::COL_T | BlockCodec::colChannel(channel))) return false;
+      const uint32_t first = k * CaptureStore::CHUNK_ROWS;
+      for (uint32_t i = first; i < first + h.rows; ++i) {
+        if (v.t[i] >= t0 && v.t[i] < t1) bk.add(v.t[i], v.ch[channel][i]);
+      }
+      st.scannedRows += h.rows;
+    }
+    if (past) break;
+  }
+  if (stats) *stats = st;
+  return true;
+}
+
+}  // namespace
+
+bool minMax(const CaptureStore::Reader& r, size_t channel, uint64_t t0, uint64_t t1, size_t width,
+            std::vector<Bucket>& out, Stats* stats) {
+  return minMaxSnapped(r, channel, t0, t1, width, SNAP_RATIO, out, stats);
+}
+
+bool lttb(const CaptureStore::Reader& r, size_t channel, uint64_t t0, uint64_t t1, size_t points,
+          std::vector<Point>& out, Stats* stats) {
+  out.clear();
+  if (points < 3) points = 3;
+  // Candidate buckets only steer the selection, so a chunk no wider than
+  // one of them is snapped rather than decoded
+  std::vector<Bucket> buckets;
+  if (!minMaxSnapped(r, channel, t0, t1, points * 4, 1, buckets, stats)) return false;
+
+  // Candidates: each bucket's min and max, in time order
+  std::vector<Point> c;
+  c.reserve(buckets.size() * 2);
+  for (const Bucket& b : buckets) {
+    if (b.rows == 0 || !std::isfinite(b.min)) continue;
+    const Point lo = { b.tMin, b.min }, hi = { b.tMax, b.max };
+    if (b.tMin == b.tMax) {
+      c.push_back(lo);
+    } else if (b.tMin < b.tMax) {
+      c.push_back(lo);
+      c.push_back(hi);
+    } else {
+      c.push_back(hi);
+      c.push_back(lo);
+    }
+  }
+  if (c.size() <= points) {
+    out = c;
+    return true;
+  }
+
+  // Largest-Triangle-Three-Buckets over the candidates
+  out.reserve(points);
+  out.push_back(c.front());
+  const double every = (double)(c.size() - 2) / (double)(points - 2);
+  size_t a = 0;
+  for (size_t i = 0; i < points - 2; ++i) {
+    const size_t from = (size_t)(i * every) + 1;
+    const size_t to = std::min(c.size() - 1, (size_t)((i + 1) * every) + 1);
+    const size_t nextTo = std::min(c.size(), (size_t)((i + 2) * every) + 1);
+
+    // Average of the next bucket (the last point for the final one)
+    double avgT = 0, avgV = 0;
+    const size_t nFrom = to, nTo = std::max(nextTo, to + 1);
+    for (size_t j = nFrom; j < nTo && j < c.size(); ++j) {
+      avgT += (double)(c[j].t - t0);
+      avgV += c[j].v;
+    }
+    const size_t nCount = std::min(nTo, c.size()) - nFrom;
+    avgT /= (double)std::max<size_t>(1, nCount);
+    avgV /= (double)std::max<size_t>(1, nCount);
+
+    const double at = (double)(c[a].t - t0), av = c[a].v;
+    double best = -1;
+    size_t pick = from;
+    for (size_t j = from; j < to; ++j) {
+      const double area = std::fabs((at - avgT) * (c[j].v - av) - (at - (double)(c[j].t - t0)) * (avgV - av));
+      if (area > best) {
+        best = area;
+        pick = j;
+      }
+    }
+    out.push_back(c[pick]);
+    a = pick;
+  }
+  out.push_back(c.back());
+  return true;
+}
+
+}  // namespace PlotQuery
@@ -0,0 +1,69 @@
+/*
+  ---------------------------------------------------------------------------
+  PlotQuery – Decimated Plot Data from a CaptureStore (host)
+  ---------------------------------------------------------------------------
+
+  Reduces a time range of one channel to what a plot `width` pixels wide
+  can show, without shipping every sample:
+
+    minMax()  per-bucket min and max (and their times) over `width`
+              equal time buckets – the envelope a line plot draws
+    lttb()    `points` representative samples chosen by
+              Largest-Triangle-Three-Buckets over the min/max points of
+              4 × points buckets (MinMaxLTTB)
+
+  Both read the chunk summaries of blocks.sum (CaptureStore.h): a chunk
+  that falls inside one bucket is merged from its summary, so an hour at
+  10 kHz is ~140k chunk merges instead of 36M samples. A chunk that
+  straddles a bucket edge is either snapped whole to the bucket holding
+  its midpoint, when buckets are at least SNAP_RATIO chunks wide (an edge
+  error below 1/SNAP_RATIO of a pixel), or scanned row by row, so zoomed-in
+  views are exact.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef PLOT_QUERY_H
+#define PLOT_QUERY_H
+
+#include "CaptureStore.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace PlotQuery {
+
+static const uint64_t SNAP_RATIO = 16;
+
+struct Bucket {
+  uint64_t tStart;
+  uint64_t rows;             // 0: no samples in the bucket
+  float min;
+  float max;
+  uint64_t tMin;             // time of min / max (interpolated within a summarized chunk)
+  uint64_t tMax;
+};
+
+struct Point {
+  uint64_t t;
+  float v;
+};
+
+struct Stats {
+  uint64_t chunks;           // merged from summaries
+  uint64_t snapped;          // of those, straddling a bucket edge
+  uint64_t scannedRows;      // read row by row
+};
+
+// `width` buckets of ceil((t1 - t0) / width) µs from t0; false if the
+// channel does not exist, the range is empty or a block cannot be read
+bool minMax(const CaptureStore::Reader& r, size_t channel, uint64_t t0, uint64_t t1, size_t width,
+            std::vector<Bucket>& out, Stats* stats = nullptr);
+
+// At most `points` samples in time order, first and last kept
+bool lttb(const CaptureStore::Reader& r, size_t channel, uint64_t t0, uint64_t t1, size_t points,
+          std::vector<Point>& out, Stats* stats = nullptr);
+
+}  // namespace PlotQuery
+
+#endif // PLOT_QUERY_H
@@ -0,0 +1,380 @@
+#include "QueryApi.h"
+#include "PlotQuery.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+HttpServer::Response json(const std::string& body) {
+  return HttpServer::Response{ 200, "application/json", body };
+}
+
+HttpServer::Response fail(int status, const std::string& message) {
+  return HttpServer::Response{ status, "application/json", "{\"error\": \"" + message + "\"}\n" };
+}
+
+void putFloat(std::string& out, float v) {
+  if (!std::isfinite(v)) {
+    out += "null";
+    return;
+  }
+  char tmp[32];
+  snprintf(tmp, sizeof(tmp), "%.9g", v);
+  out += tmp;
+}
+
+void putU64(std::string& out, uint64_t v) {
+  char tmp[24];
+  snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)v);
+  out += tmp;
+}
+
+const std::string* param(const HttpServer::Query& q, const char* name) {
+  const HttpServer::Query::const_iterator it = q.find(name);
+  return it == q.end() || it->second.empty() ? nullptr : &it->second;
+}
+
+// "live", "batches/batch_<digits>" or "captures/capture_<digits>"; nothing that can leave the root
+bool validStoreName(const std::string& name) {
+  if (name == "live") return true;
+  for (const char* prefix : { "batches/batch_", "captures/capture_" }) {
+    const size_t len = strlen(prefix);
+    if (name.compare(0, len, prefix) != 0 || name.size() == len) continue;
+    return std::all_of(name.begin() + len, name.end(), [](char c) { return c >= '0' && c <= '9'; });
+  }
+  return false;
+}
+
+// A directory NodeDemux::dirName() can produce
+bool validNodeName(const std::string& name) {
+  if (name.empty() || name == "." || name == "..") return false;
+  return std::all_of(name.begin(), name.end(), [](char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+           c == '.';
+  });
+}
+
+bool isDir(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+int64_t elapsedUs(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+}  // namespace
+
+QueryApi::QueryApi(const std::string& root) : _root(root) {}
+
+HttpServer::Response QueryApi::handle(const std::string& path, const HttpServer::Query& query) {
+  if (path == "/api/nodes") return nodeList();
+  if (path == "/api/stores") return stores(query);
+  if (path == "/api/info") return info(query);
+  if (path == "/api/minmax") return minMax(query);
+  if (path == "/api/lttb") return lttb(query);
+  if (path == "/api/merged") return merged(query);
+  return fail(404, "unknown path");
+}
+
+std::vector<std::string> QueryApi::nodes() const {
+  std::vector<std::string> names;
+  if (DIR* d = opendir((_root + "/nodes").c_str())) {
+    while (dirent* e = readdir(d)) {
+      if (validNodeName(e->d_name) && isDir(_root + "/nodes/" + e->d_name)) names.push_back(e->d_name);
+    }
+    closedir(d);
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+bool QueryApi::nodeDir(const HttpServer::Query& query, std::string& dir, std::string& error) const {
+  if (const std::string* node = param(query, "node")) {
+    if (!validNodeName(*node)) {
+      error = "bad node name";
+      return false;
+    }
+    dir = "nodes/" + *node;
+    return true;
+  }
+  if (isDir(_root + "/live")) {
+    dir.clear();
+    return true;
+  }
+  const std::vector<std::string> all = nodes();
+  if (all.size() != 1) {
+    error = all.empty() ? "no stores yet" : "several nodes, pass node=";
+    return false;
+  }
+  dir = "nodes/" + all[0];
+  return true;
+}
+
+CaptureStore::Reader* QueryApi::open(const std::string& dir, const std::string& name, std::string& error) {
+  if (!validStoreName(name)) {
+    error = "bad store name";
+    return nullptr;
+  }
+  const std::string key = dir.empty() ? name : dir + "/" + name;
+  std::unique_ptr<CaptureStore::Reader>& r = _readers[key];
+  if (!r) {
+    r.reset(new CaptureStore::Reader());
+    if (!r->open(_root + "/" + key)) {
+      error = "cannot open store " + key;
+      r.reset();
+      _readers.erase(key);
+      return nullptr;
+    }
+  }
+  r->refresh();
+  return r.get();
+}
+
+CaptureStore::Reader* QueryApi::store(const HttpServer::Query& query, std::string& error) {
+  std::string dir;
+  if (!nodeDir(query, dir, error)) return nullptr;
+  const std::string* name = param(query, "store");
+  return open(dir, name ? *name : "live", error);
+}
+
+bool QueryApi::range(const CaptureStore::Reader& r, const HttpServer::Query& query, uint64_t& t0, uint64_t& t1) const {
+  if (r.size() == 0) return false;
+  const std::string* a = param(query, "t0");
+  const std::string* b = param(query, "t1");
+  t0 = a ? strtoull(a->c_str(), nullptr, 10) : r.timeAt(0);
+  t1 = b ? strtoull(b->c_str(), nullptr, 10) : r.timeAt(r.size() - 1) + 1;
+  return t1 > t0;
+}
+
+HttpServer::Response QueryApi::nodeList() const {
+  const std::vector<std::string> names = nodes();
+  std::string out = "{\"nodes\": [";
+  for (size_t i = 0; i < names.size(); ++i) out += (i ? ", \"" : "\"") + names[i] + "\"";
+  return json(out + "]}\n");
+}
+
+HttpServer::Response QueryApi::stores(const HttpServer::Query& query) const {
+  std::string dir, err;
+  if (!nodeDir(query, dir, err)) return fail(404, err);
+  const std::string base = dir.empty() ? _root : _root + "/" + dir;
+  std::vector<std::string> names;
+  names.push_back("live");
+  for (const char* sub : { "batches", "captures" }) {
+    if (DIR* d = opendir((base + "/" + sub).c_str())) {
+      while (dirent* e = readdir(d)) {
+        const std::string name = std::string(sub) + "/" + e->d_name;
+        if (validStoreName(name)) names.push_back(name);
+      }
+      closedir(d);
+    }
+  }
+  std::sort(names.begin() + 1, names.end());
+  std::string out = "{\"stores\": [";
+  for (size_t i = 0; i < names.size(); ++i) out += (i ? ", \"" : "\"") + names[i] + "\"";
+  return json(out + "]}\n");
+}
+
+HttpServer::Response QueryApi::info(const HttpServer::Query& query) {
+  std::string err;
+  CaptureStore::Reader* r = store(query, err);
+  if (!r) return fail(404, err);
+  std::string out = "{\"store\": \"" + (param(query, "store") ? *param(query, "store") : std::string("live")) + "\"";
+  out += ", \"rows\": ";
+  putU64(out, r->size());
+  if (r->size()) {
+    out += ", \"t_first\": ";
+    putU64(out, r->timeAt(0));
+    out += ", \"t_last\": ";
+    putU64(out, r->timeAt(r->size() - 1));
+  }
+  out += std::string(", \"compressed\": ") + (r->compressed() ? "true" : "false") + ", \"channels\": [";
+  for (size_t c = 0; c < r->channelCount(); ++c) out += std::string(c ? ", \"" : "\"") + r->channelName(c) + "\"";
+  return json(out + "]}\n");
+}
+
+HttpServer::Response QueryApi::minMax(const HttpServer::Query& query) {
+  std::string err;
+  CaptureStore::Reader* r = store(query, err);
+  if (!r) return fail(404, err);
+  const std::string* ch = param(query, "channel");
+  const int channel = ch ? r->channelIndex(ch->c_str()) : -1;
+  if (channel < 0) return fail(400, "unknown channel");
+  const std::string* w = param(query, "width");
+  const size_t width = std::min<size_t>(MAX_WIDTH, w ? strtoul(w->c_str(), nullptr, 10) : 800);
+  uint64_t t0, t1;
+  if (!range(*r, query, t0, t1) || width == 0) return fail(400, "empty range");
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<PlotQuery::Bucket> buckets;
+  PlotQuery::Stats st;
+  if (!PlotQuery::minMax(*r, (size_t)channel, t0, t1, width, buckets, &st)) return fail(500, "query failed");
+  const int64_t us = elapsedUs(start);
+
+  std::string out;
+  out.reserve(64 + buckets.size() * 48);
+  out += "{\"t0\": ";
+  putU64(out, t0);
+  out += ", \"t1\": ";
+  putU64(out, t1);
+  out += ", \"bucket_us\": ";
+  putU64(out, buckets.size() > 1 ? buckets[1].tStart - buckets[0].tStart : t1 - t0);
+  out += ", \"elapsed_us\": ";
+  putU64(out, (uint64_t)us);
+  out += ", \"chunks\": ";
+  putU64(out, st.chunks);
+  out += ", \"snapped_chunks\": ";
+  putU64(out, st.snapped);
+  out += ", \"scanned_rows\": ";
+  putU64(out, st.scannedRows);
+  out += ", \"buckets\": [";
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    const PlotQuery::Bucket& b = buckets[i];
+    out += i ? ", [" : "[";
+    putU64(out, b.tStart);
+    out += ", ";
+    putU64(out, b.rows);
+    out += ", ";
+    putFloat(out, b.min);
+    out += ", ";
+    putFloat(out, b.max);
+    out += "]";
+  }
+  return json(out + "]}\n");
+}
+
+HttpServer::Response QueryApi::lttb(const HttpServer::Query& query) {
+  std::string err;
+  CaptureStore::Reader* r = store(query, err);
+  if (!r) return fail(404, err);
+  const std::string* ch = param(query, "channel");
+  const int channel = ch ? r->channelIndex(ch->c_str()) : -1;
+  if (channel < 0) return fail(400, "unknown channel");
+  const std::string* p = param(query, "points");
+  const size_t points = std::min<size_t>(MAX_WIDTH, p ? strtoul(p->c_str(), nullptr, 10) : 800);
+  uint64_t t0, t1;
+  if (!range(*r, query, t0, t1)) return fail(400, "empty range");
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<PlotQuery::Point> pts;
+  if (!PlotQuery::lttb(*r, (size_t)channel, t0, t1, points, pts)) return fail(500, "query failed");
+  const int64_t us = elapsedUs(start);
+
+  std::string out;
+  out.reserve(64 + pts.size() * 32);
+  out += "{\"t0\": ";
+  putU64(out, t0);
+  out += ", \"t1\": ";
+  putU64(out, t1);
+  out += ", \"elapsed_us\": ";
+  putU64(out, (uint64_t)us);
+  out += ", \"points\": [";
+  for (size_t i = 0; i < pts.size(); ++i) {
+    out += i ? ", [" : "[";
+    putU64(out, pts[i].t);
+    out += ", ";
+    putFloat(out, pts[i].v);
+    out += "]";
+  }
+  return json(out + "]}\n");
+}
+
+HttpServer::Response QueryApi::merged(const HttpServer::Query& query) {
+  std::vector<std::string> names;
+  const std::string* list = param(query, "nodes");
+  if (list) {
+    size_t at = 0;
+    while (at <= list->size()) {
+      const size_t comma = std::min(list->find(',', at), list->size());
+      names.push_back(list->substr(at, comma - at));
+      at = comma + 1;
+    }
+  } else {
+    names = nodes();
+  }
+  if (names.empty()) return fail(404, "no nodes");
+  const std::string* st = param(query, "store");
+  const std::string storeName = st ? *st : "live";
+  const std::string* ch = param(query, "channel");
+  if (!ch) return fail(400, "unknown channel");
+
+  // Only nodes that have the store and channel; named ones must
+  std::vector<std::string> used;
+  std::vector<CaptureStore::Reader*> readers;
+  std::vector<int> channels;
+  for (const std::string& n : names) {
+    std::string err;
+    CaptureStore::Reader* r = validNodeName(n) ? open("nodes/" + n, storeName, err) : nullptr;
+    const int c = r ? r->channelIndex(ch->c_str()) : -1;
+    if (!r || c < 0 || r->size() == 0) {
+      if (list) return fail(404, "node " + n + (r ? ": no such channel or no rows" : ": " + err));
+      continue;
+    }
+    used.push_back(n);
+    readers.push_back(r);
+    channels.push_back(c);
+  }
+  if (readers.empty()) return fail(404, "no node has that channel");
+
+  const std::string* w = param(query, "width");
+  const size_t width = std::min<size_t>(MAX_WIDTH, w ? strtoul(w->c_str(), nullptr, 10) : 800);
+  const std::string* a = param(query, "t0");
+  const std::string* b = param(query, "t1");
+  uint64_t t0 = UINT64_MAX, t1 = 0;
+  for (const CaptureStore::Reader* r : readers) {
+    t0 = std::min(t0, r->timeAt(0));
+    t1 = std::max(t1, r->timeAt(r->size() - 1) + 1);
+  }
+  if (a) t0 = strtoull(a->c_str(), nullptr, 10);
+  if (b) t1 = strtoull(b->c_str(), nullptr, 10);
+  if (t1 <= t0 || width == 0) return fail(400, "empty range");
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::vector<PlotQuery::Bucket> > buckets(readers.size());
+  for (size_t i = 0; i < readers.size(); ++i) {
+    if (!PlotQuery::minMax(*readers[i], (size_t)channels[i], t0, t1, width, buckets[i])) {
+      return fail(500, "query failed");
+    }
+  }
+  const int64_t us = elapsedUs(start);
+
+  const std::vector<PlotQuery::Bucket>& grid = buckets[0];
+  std::string out;
+  out.reserve(128 + grid.size() * (16 + readers.size() * 40));
+  out += "{\"t0\": ";
+  putU64(out, t0);
+  out += ", \"t1\": ";
+  putU64(out, t1);
+  out += ", \"bucket_us\": ";
+  putU64(out, grid.size() > 1 ? grid[1].tStart - grid[0].tStart : t1 - t0);
+  out += ", \"elapsed_us\": ";
+  putU64(out, (uint64_t)us);
+  out += ", \"nodes\": [";
+  for (size_t i = 0; i < used.size(); ++i) out += (i ? ", \"" : "\"") + used[i] + "\"";
+  out += "], \"buckets\": [";
+  for (size_t k = 0; k < grid.size(); ++k) {
+    out += k ? ", [" : "[";
+    putU64(out, grid[k].tStart);
+    for (size_t i = 0; i < buckets.size(); ++i) {
+      const PlotQuery::Bucket& bk = buckets[i][k];
+      out += ", [";
+      putU64(out, bk.rows);
+      out += ", ";
+      putFloat(out, bk.min);
+      out += ", ";
+      putFloat(out, bk.max);
+      out += "]";
+    }
+    out += "]";
+  }
+  return json(out + "]}\n");
+}
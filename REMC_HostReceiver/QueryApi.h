@@ -0,0 +1,75 @@
+/*
+  ---------------------------------------------------------------------------
+  QueryApi – JSON Plot Queries over the Receiver's Stores (host)
+  ---------------------------------------------------------------------------
+
+  HttpServer handler for the stores under one remc_receiver --store
+  directory. Each unit has its own stores under nodes/<node> (`live`,
+  `batches/batch_NNNN`, see NodeDemux.h, and the look-back captures
+  `captures/capture_NNNN`, LookbackRing.h); node= picks one and may be left
+  out when there is only one, or when the directory is a single-device
+  capture (stores at the top). Times are µs since epoch; t0/t1 default to
+  the whole store.
+
+    GET /api/nodes
+        {"nodes": ["REMC_192.168.1.50", ...]}
+    GET /api/stores?node=
+        {"stores": ["live", "batches/batch_0001", ..., "captures/capture_0001", ...]}
+    GET /api/info?node=&store=live
+        {"store", "rows", "t_first", "t_last", "compressed", "channels": [...]}
+    GET /api/minmax?node=&store=live&channel=switch_voltage_kv&t0=&t1=&width=800
+        {"t0", "t1", "bucket_us", "elapsed_us", "chunks", "snapped_chunks", "scanned_rows",
+         "buckets": [[t_start, rows, min, max], ...]}   min/max null if empty
+    GET /api/lttb?node=&store=live&channel=switch_voltage_kv&t0=&t1=&points=800
+        {"t0", "t1", "elapsed_us", "points": [[t, value], ...]}
+    GET /api/merged?nodes=a,b&store=live&channel=switch_voltage_kv&t0=&t1=&width=800
+        {"t0", "t1", "bucket_us", "elapsed_us", "nodes": [...],
+         "buckets": [[t_start, [rows, min, max], ...one per node], ...]}
+        the same min/max buckets for every node (all by default) on one
+        time grid, t0/t1 defaulting to the union of their ranges; the
+        devices stamp samples with NTP-disciplined time, so a bucket holds
+        the same moment on every node
+
+  Readers are opened on first use and refreshed on every request.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef QUERY_API_H
+#define QUERY_API_H
+
+#include "CaptureStore.h"
+#include "HttpServer.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class QueryApi {
+public:
+  explicit QueryApi(const std::string& root);
+
+  HttpServer::Response handle(const std::string& path, const HttpServer::Query& query);
+
+  static const size_t MAX_WIDTH = 20000;
+
+private:
+  std::vector<std::string> nodes() const;
+  // Directory of the node a query addresses, relative to the root ("" for the root itself)
+  bool nodeDir(const HttpServer::Query& query, std::string& dir, std::string& error) const;
+  CaptureStore::Reader* open(const std::string& dir, const std::string& store, std::string& error);
+  CaptureStore::Reader* store(const HttpServer::Query& query, std::string& error);
+  bool range(const CaptureStore::Reader& r, const HttpServer::Query& query, uint64_t& t0, uint64_t& t1) const;
+
+  HttpServer::Response nodeList() const;
+  HttpServer::Response stores(const HttpServer::Query& query) const;
+  HttpServer::Response info(const HttpServer::Query& query);
+  HttpServer::Response minMax(const HttpServer::Query& query);
+  HttpServer::Response lttb(const HttpServer::Query& query);
+  HttpServer::Response merged(const HttpServer::Query& query);
+
+  std::string _root;
+  std::map<std::string, std::unique_ptr<CaptureStore::Reader>> _readers;
+};
+
+#endif // QUERY_API_H
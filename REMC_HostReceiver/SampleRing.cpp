@@ -0,0 +1,355 @@
+#include "SampleRing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace SampleRing {
+
+namespace {
+
+uint64_t wallUs() {
+  timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint64_t)tv.tv_sec * 1000000u + (uint64_t)tv.tv_usec;
+}
+
+int futex(std::atomic<uint32_t>* word, int op, uint32_t value, const timespec* timeout) {
+  return (int)syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+}
+
+bool processGone(uint32_t pid) {
+  return kill((pid_t)pid, 0) < 0 && errno == ESRCH;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+Writer::Writer() : _h(nullptr), _slots(nullptr), _mapBytes(0) {}
+
+Writer::~Writer() {
+  close();
+}
+
+bool Writer::create(const std::string& name, const std::vector<std::string>& channels, uint64_t capacity) {
+  close();
+  if (channels.empty() || channels.size() > RING_CHANNELS) {
+    _error = "ring holds 1.." + std::to_string(RING_CHANNELS) + " channels";
+    return false;
+  }
+  if (capacity < 1024 || (capacity & (capacity - 1)) != 0) {
+    _error = "ring capacity must be a power of two >= 1024";
+    return false;
+  }
+
+  // Mark an existing ring closed for its readers before replacing it
+  const int old = shm_open(name.c_str(), O_RDWR, 0);
+  if (old >= 0) {
+    void* p = mmap(nullptr, HEADER_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, old, 0);
+    if (p != MAP_FAILED) {
+      Header* h = static_cast<Header*>(p);
+      if (memcmp(h->magic, RING_MAGIC, sizeof(RING_MAGIC)) == 0) {
+        h->closed.store(1, std::memory_order_release);
+        h->wakeSeq.fetch_add(1);
+        futex(&h->wakeSeq, FUTEX_WAKE, INT_MAX, nullptr);
+      }
+      munmap(p, HEADER_BYTES);
+    }
+    ::close(old);
+    shm_unlink(name.c_str());
+  }
+
+  const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    _error = "shm_open " + name + ": " + strerror(errno);
+    return false;
+  }
+  const size_t bytes = HEADER_BYTES + capacity * sizeof(Slot);
+  if (ftruncate(fd, (off_t)bytes) < 0) {
+    _error = "ftruncate " + name + ": " + strerror(errno);
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    _error = "mmap " + name + ": " + strerror(errno);
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  _h = static_cast<Header*>(p);
+  _slots = reinterpret_cast<Slot*>(static_cast<uint8_t*>(p) + HEADER_BYTES);
+  _mapBytes = bytes;
+  _name = name;
+  memset(static_cast<void*>(_h), 0, HEADER_BYTES);
+  _h->version = RING_VERSION;
+  _h->channelCount = (uint32_t)channels.size();
+  _h->slotBytes = sizeof(Slot);
+  _h->maxReaders = MAX_READERS;
+  _h->capacity = capacity;
+  _h->createdUnixUs = wallUs();
+  _h->writerPid = (uint32_t)getpid();
+  for (size_t c = 0; c < channels.size(); ++c) {
+    strncpy(_h->channelNames[c], channels[c].c_str(), CaptureStore::CHANNEL_NAME_LEN - 1);
+  }
+  // Magic last: a reader that sees it sees a complete header
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(_h->magic, RING_MAGIC, sizeof(RING_MAGIC));
+  return true;
+}
+
+void Writer::close() {
+  if (!_h) return;
+  _h->closed.store(1, std::memory_order_release);
+  _h->wakeSeq.fetch_add(1);
+  futex(&_h->wakeSeq, FUTEX_WAKE, INT_MAX, nullptr);
+  munmap(_h, _mapBytes);
+  // The name stays until the next create(), so late readers still find the last data
+  _h = nullptr;
+  _slots = nullptr;
+}
+
+void Writer::publish(const CaptureStore::Record* r, size_t n, uint8_t flags) {
+  if (!_h) return;
+  const uint64_t cap = _h->capacity;
+  const size_t channels = _h->channelCount;
+  while (n > 0) {
+    const size_t batch = (size_t)std::min<uint64_t>(n, cap / 2);
+    const uint64_t h = _h->head.load(std::memory_order_relaxed);
+
+    // Announce the slots about to be overwritten before touching them
+    _h->claimed.store(h + batch, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < batch; ++i) {
+      Slot& s = _slots[(h + i) & (cap - 1)];
+      s.tUs = r[i].tUs;
+      s.tUsEnd = r[i].tUsEnd;
+      memcpy(s.ch, r[i].ch, channels * sizeof(float));
+      s.status = r[i].status;
+      s.flags = flags;
+    }
+    _h->head.store(h + batch, std::memory_order_release);
+
+    _h->wakeSeq.fetch_add(1);
+    if (_h->waiters.load()) futex(&_h->wakeSeq, FUTEX_WAKE, INT_MAX, nullptr);
+    r += batch;
+    n -= batch;
+  }
+}
+
+std::vector<ReaderInfo> Writer::readers() const {
+  std::vector<ReaderInfo> out;
+  if (!_h) return out;
+  const uint64_t head = _h->head.load(std::memory_order_relaxed);
+  for (const ReaderEntry& e : _h->readers) {
+    const uint32_t pid = e.pid.load(std::memory_order_relaxed);
+    if (pid == 0) continue;
+    const uint64_t cursor = e.cursor.load(std::memory_order_relaxed);
+    out.push_back(ReaderInfo{ pid, head > cursor ? head - cursor : 0, e.overruns.load(std::memory_order_relaxed) });
+  }
+  return out;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+Reader::Reader() : _h(nullptr), _slots(nullptr), _mapBytes(0), _mask(0), _cursor(0), _overruns(0), _entry(nullptr) {}
+
+Reader::~Reader() {
+  close();
+}
+
+bool Reader::open(const std::string& name, bool fromOldest) {
+  close();
+  // Read-write: the reader table and the futex counters live in the header
+  const int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    _error = "shm_open " + name + ": " + strerror(errno) + " (is remc_receiver running?)";
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < HEADER_BYTES) {
+    _error = name + ": not a sample ring";
+    ::close(fd);
+    return false;
+  }
+  void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    _error = "mmap " + name + ": " + strerror(errno);
+    return false;
+  }
+  Header* h = static_cast<Header*>(p);
+  const bool ok = memcmp(h->magic, RING_MAGIC, sizeof(RING_MAGIC)) == 0 && h->version == RING_VERSION &&
+                  h->slotBytes == sizeof(Slot) &&
+                  (size_t)st.st_size >= HEADER_BYTES + h->capacity * sizeof(Slot);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!ok) {
+    _error = name + ": unknown ring layout";
+    munmap(p, (size_t)st.st_size);
+    return false;
+  }
+  _h = h;
+  _slots = reinterpret_cast<const Slot*>(static_cast<const uint8_t*>(p) + HEADER_BYTES);
+  _mapBytes = (size_t)st.st_size;
+  _mask = h->capacity - 1;
+  _overruns = 0;
+  const uint64_t head = h->head.load(std::memory_order_acquire);
+  _cursor = fromOldest && head > h->capacity / 2 ? head - h->capacity / 2 : (fromOldest ? 0 : head);
+
+  // Claim a reader table entry (or reclaim one whose process is gone)
+  const uint32_t me = (uint32_t)getpid();
+  _entry = nullptr;
+  for (int pass = 0; pass < 2 && !_entry; ++pass) {
+    for (ReaderEntry& e : h->readers) {
+      uint32_t pid = e.pid.load(std::memory_order_relaxed);
+      if (pid != 0 && (pass == 0 || !processGone(pid))) continue;
+      if (e.pid.compare_exchange_strong(pid, me)) {
+        _entry = &e;
+        break;
+      }
+    }
+  }
+  if (_entry) {
+    _entry->cursor.store(_cursor, std::memory_order_relaxed);
+    _entry->overruns.store(0, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void Reader::close() {
+  if (!_h) return;
+  if (_entry) _entry->pid.store(0, std::memory_order_release);
+  munmap(_h, _mapBytes);
+  _h = nullptr;
+  _slots = nullptr;
+  _entry = nullptr;
+}
+
+size_t Reader::available() const {
+  if (!_h) return 0;
+  return (size_t)(_h->head.load(std::memory_order_acquire) - _cursor);
+}
+
+size_t Reader::read(Slot* out, size_t max) {
+  if (!_h || max == 0) return 0;
+  const uint64_t cap = _mask + 1;
+  const uint64_t head = _h->head.load(std::memory_order_acquire);
+  if (head - _cursor > cap) {
+    _overruns += head - cap - _cursor;
+    _cursor = head - cap;
+  }
+  const size_t n = (size_t)std::min<uint64_t>(max, head - _cursor);
+  if (n == 0) return 0;
+
+  const size_t first = (size_t)(_cursor & _mask);
+  const size_t part = std::min<size_t>(n, (size_t)(cap - first));
+  memcpy(out, _slots + first, part * sizeof(Slot));
+  if (part < n) memcpy(out + part, _slots, (n - part) * sizeof(Slot));
+
+  // Drop whatever the writer may have started overwriting during the copy
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t claimed = _h->claimed.load(std::memory_order_relaxed);
+  size_t torn = 0;
+  if (claimed > cap && _cursor < claimed - cap) torn = (size_t)std::min<uint64_t>(n, claimed - cap - _cursor);
+  if (torn) {
+    memmove(out, out + torn, (n - torn) * sizeof(Slot));
+    _overruns += torn;
+  }
+  _cursor += n;
+  if (_entry) {
+    _entry->cursor.store(_cursor, std::memory_order_relaxed);
+    _entry->overruns.store(_overruns, std::memory_order_relaxed);
+  }
+  return n - torn;
+}
+
+bool Reader::wait(int timeoutMs) {
+  if (!_h) return false;
+  _h->waiters.fetch_add(1);
+  const uint32_t seq = _h->wakeSeq.load();
+  if (_h->head.load() == _cursor && !_h->closed.load()) {
+    timespec ts = { timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000L };
+    futex(&_h->wakeSeq, FUTEX_WAIT, seq, timeoutMs < 0 ? nullptr : &ts);
+  }
+  _h->waiters.fetch_sub(1);
+  return available() > 0;
+}
+
+}  // namespace SampleRing
+
+// ---------------------------------------------------------------------------
+// C API
+// ---------------------------------------------------------------------------
+
+using SampleRing::Reader;
+
+static thread_local std::string s_openError;
+
+void* remc_ring_open(const char* name, int fromOldest) {
+  Reader* r = new Reader();
+  if (!r->open(name ? name : SampleRing::RING_NAME, fromOldest != 0)) {
+    s_openError = r->error();
+    delete r;
+    return nullptr;
+  }
+  return r;
+}
+
+const char* remc_ring_error() {
+  return s_openError.c_str();
+}
+
+void remc_ring_close(void* reader) {
+  delete static_cast<Reader*>(reader);
+}
+
+size_t remc_ring_read(void* reader, SampleRing::Slot* out, size_t max) {
+  return static_cast<Reader*>(reader)->read(out, max);
+}
+
+size_t remc_ring_available(void* reader) {
+  return static_cast<Reader*>(reader)->available();
+}
+
+int remc_ring_wait(void* reader, int timeoutMs) {
+  return static_cast<Reader*>(reader)->wait(timeoutMs) ? 1 : 0;
+}
+
+uint64_t remc_ring_cursor(void* reader) {
+  return static_cast<Reader*>(reader)->cursor();
+}
+
+uint64_t remc_ring_overruns(void* reader) {
+  return static_cast<Reader*>(reader)->overruns();
+}
+
+int remc_ring_closed(void* reader) {
+  return static_cast<Reader*>(reader)->closed() ? 1 : 0;
+}
+
+uint32_t remc_ring_channel_count(void* reader) {
+  return (uint32_t)static_cast<Reader*>(reader)->channelCount();
+}
+
+const char* remc_ring_channel_name(void* reader, uint32_t c) {
+  Reader* r = static_cast<Reader*>(reader);
+  return c < r->channelCount() ? r->channelName(c) : "";
+}
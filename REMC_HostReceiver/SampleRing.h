@@ -0,0 +1,191 @@
+/*
+  ---------------------------------------------------------------------------
+  SampleRing – Shared-Memory Fan-Out of Decoded Samples (host)
+  ---------------------------------------------------------------------------
+
+  remc_receiver publishes every decoded sample into a POSIX shared-memory
+  ring (shm_open, default RING_NAME). Any number of local processes map it
+  and follow it with their own cursor, so a logger, the timing
+  analyzer or a script gets the live stream without joining the multicast
+  group or parsing Neutrino packets:
+
+    Header     one page: magic, layout, channel names, publish counters,
+               the reader table
+    Slot[]     `capacity` (power of two) 64-byte slots, sample i in slot
+               i & (capacity - 1)
+
+  Single producer, many consumers; the writer never waits for a reader.
+  A reader that falls more than `capacity` samples behind loses the
+  oldest ones: read() skips them and adds them to overruns(). Torn slots
+  are detected rather than prevented: before writing samples [h, h + n)
+  the writer stores `claimed = h + n` and then, after the slot data,
+  `head = h + n` (release). A reader copies slots below `head` and then
+  checks `claimed`; any slot the writer may have started to overwrite
+  during the copy (index < claimed − capacity) is dropped and counted as
+  an overrun, so what read() returns is always whole.
+
+  Readers register in the header's reader table (pid, cursor, overruns)
+  so the receiver can report who is attached and how far behind; slots
+  of processes that died are reclaimed. wait() sleeps on a futex the
+  writer only signals while someone is waiting.
+
+  Python: sample_ring.py binds the C API at the end of this file (build
+  libremc_ring.so) and returns numpy views of the slots.
+
+  One writer per ring name. Reader and Writer are not thread-safe per object.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include "CaptureStore.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace SampleRing {
+
+static const char RING_MAGIC[8] = { 'R', 'E', 'M', 'C', 'R', 'N', 'G', '1' };
+static const uint32_t RING_VERSION = 1;
+static const char* const RING_NAME = "/remc_samples";
+static const uint64_t DEFAULT_CAPACITY = 1u << 18;   // ~26 s at 10 kHz, 16 MiB
+static const size_t RING_CHANNELS = 10;
+static const size_t MAX_READERS = 32;
+static const size_t HEADER_BYTES = 4096;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "ring counters must be lock-free to be shared between processes");
+
+// One sample; numpy dtype in sample_ring.py
+struct Slot {
+  uint64_t tUs;
+  uint64_t tUsEnd;           // 0 when the packet format has no end time
+  float ch[RING_CHANNELS];   // first Header::channelCount used
+  uint8_t status;            // bit i = status byte i != 0 (CaptureStore::Record)
+  uint8_t flags;             // Neutrino packet flags: 0 live, 1 collected
+  uint8_t reserved[6];
+};
+static_assert(sizeof(Slot) == 64, "one slot per cache line");
+
+struct ReaderEntry {
+  std::atomic<uint32_t> pid;             // 0: free
+  uint32_t reserved0;
+  std::atomic<uint64_t> cursor;          // next sample the reader will read
+  std::atomic<uint64_t> overruns;        // samples it lost
+  uint64_t reserved[5];
+};
+static_assert(sizeof(ReaderEntry) == 64, "one reader per cache line");
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t channelCount;
+  uint32_t slotBytes;
+  uint32_t maxReaders;
+  uint64_t capacity;
+  uint64_t createdUnixUs;
+  uint32_t writerPid;
+  std::atomic<uint32_t> closed;          // writer shut down
+  char channelNames[RING_CHANNELS][CaptureStore::CHANNEL_NAME_LEN];
+
+  alignas(64) std::atomic<uint64_t> claimed;   // samples being or been written
+  alignas(64) std::atomic<uint64_t> head;      // samples published
+  std::atomic<uint32_t> wakeSeq;               // futex word, bumped per publish
+  std::atomic<uint32_t> waiters;
+
+  alignas(64) ReaderEntry readers[MAX_READERS];
+};
+static_assert(sizeof(Header) <= HEADER_BYTES, "header must fit its page");
+
+struct ReaderInfo {
+  uint32_t pid;
+  uint64_t lag;              // head - cursor
+  uint64_t overruns;
+};
+
+class Writer {
+public:
+  Writer();
+  ~Writer();
+
+  // Replaces any ring of that name (readers of the old one see closed())
+  bool create(const std::string& name, const std::vector<std::string>& channels,
+              uint64_t capacity = DEFAULT_CAPACITY);
+  void close();
+  bool isOpen() const { return _h != nullptr; }
+
+  void publish(const CaptureStore::Record* r, size_t n, uint8_t flags);
+
+  uint64_t head() const { return _h ? _h->head.load(std::memory_order_relaxed) : 0; }
+  std::vector<ReaderInfo> readers() const;
+  const std::string& error() const { return _error; }
+
+private:
+  std::string _name;
+  Header* _h;
+  Slot* _slots;
+  size_t _mapBytes;
+  std::string _error;
+};
+
+class Reader {
+public:
+  Reader();
+  ~Reader();
+
+  // Starts at the newest sample; fromOldest starts half a ring back (as
+  // old as is safe from the writer)
+  bool open(const std::string& name = RING_NAME, bool fromOldest = false);
+  void close();
+  bool isOpen() const { return _h != nullptr; }
+
+  // Up to `max` samples in order; returns how many. Lost samples (the
+  // reader fell behind or a slot was overwritten mid-copy) are skipped
+  // and counted in overruns()
+  size_t read(Slot* out, size_t max);
+  size_t available() const;
+  // Sleep until samples are available, the writer closes or timeoutMs
+  // passes (< 0: no limit); true if samples are available
+  bool wait(int timeoutMs);
+
+  uint64_t cursor() const { return _cursor; }
+  uint64_t overruns() const { return _overruns; }
+  bool closed() const { return _h && _h->closed.load(std::memory_order_acquire); }
+  size_t channelCount() const { return _h ? _h->channelCount : 0; }
+  const char* channelName(size_t c) const { return _h->channelNames[c]; }
+  const std::string& error() const { return _error; }
+
+private:
+  Header* _h;
+  const Slot* _slots;
+  size_t _mapBytes;
+  uint64_t _mask;
+  uint64_t _cursor;
+  uint64_t _overruns;
+  ReaderEntry* _entry;       // null if the reader table is full
+  std::string _error;
+};
+
+}  // namespace SampleRing
+
+// C API for ctypes (sample_ring.py); handles are SampleRing::Reader*
+extern "C" {
+void* remc_ring_open(const char* name, int fromOldest);   // null on failure, see remc_ring_error()
+const char* remc_ring_error();
+void remc_ring_close(void* reader);
+size_t remc_ring_read(void* reader, SampleRing::Slot* out, size_t max);
+size_t remc_ring_available(void* reader);
+int remc_ring_wait(void* reader, int timeoutMs);
+uint64_t remc_ring_cursor(void* reader);
+uint64_t remc_ring_overruns(void* reader);
+int remc_ring_closed(void* reader);
+uint32_t remc_ring_channel_count(void* reader);
+const char* remc_ring_channel_name(void* reader, uint32_t c);
+}
+
+#endif // SAMPLE_RING_H
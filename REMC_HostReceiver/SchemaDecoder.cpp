@@ -0,0 +1,706 @@
+#include "SchemaDecoder.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCHEMA_DECODER_AVX2 1
+#endif
+
+namespace {
+
+using BlockCodec::ColumnsOut;
+using CaptureStore::DUR_NONE;
+using CaptureStore::MAX_CHANNELS;
+using CaptureStore::Record;
+using CaptureStore::STATUS_GAP;
+
+struct TypeInfo {
+  const char* name;
+  uint8_t size;
+};
+
+const TypeInfo TYPES[] = {
+  { "u8", 1 }, { "i8", 1 }, { "u16", 2 }, { "i16", 2 }, { "u32", 4 },
+  { "i32", 4 }, { "u64", 8 }, { "i64", 8 }, { "f32", 4 }, { "f64", 8 },
+};
+
+template <typename T>
+inline T load(const uint8_t* p) {
+  T v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline float asFloat(const uint8_t* p, uint8_t type) {
+  switch (type) {
+    case SchemaDecoder::T_U8:  return (float)p[0];
+    case SchemaDecoder::T_I8:  return (float)(int8_t)p[0];
+    case SchemaDecoder::T_U16: return (float)load<uint16_t>(p);
+    case SchemaDecoder::T_I16: return (float)load<int16_t>(p);
+    case SchemaDecoder::T_U32: return (float)load<uint32_t>(p);
+    case SchemaDecoder::T_I32: return (float)load<int32_t>(p);
+    case SchemaDecoder::T_U64: return (float)load<uint64_t>(p);
+    case SchemaDecoder::T_I64: return (float)load<int64_t>(p);
+    case SchemaDecoder::T_F32: return load<float>(p);
+    default:                   return (float)load<double>(p);
+  }
+}
+
+inline uint64_t asTime(const uint8_t* p, uint8_t type) {
+  switch (type) {
+    case SchemaDecoder::T_U16: return load<uint16_t>(p);
+    case SchemaDecoder::T_U32: return load<uint32_t>(p);
+    default:                   return load<uint64_t>(p);
+  }
+}
+
+// The firmware's layout: C f32 channels, u64 t_us, S u8 statuses, u64 t_us_end
+template <size_t C, size_t S>
+size_t decodeFirmware(const SchemaDecoder&, const uint8_t* p, size_t n, Record* out) {
+  static const size_t BYTES = C * 4 + 8 + S + 8;
+  for (size_t i = 0; i < n; ++i, p += BYTES) {
+    Record& r = out[i];
+    memcpy(r.ch, p, C * 4);
+    if (C < MAX_CHANNELS) memset(r.ch + C, 0, (MAX_CHANNELS - C) * sizeof(float));
+    memcpy(&r.tUs, p + C * 4, 8);
+    const uint8_t* st = p + C * 4 + 8;
+    uint8_t bits = 0;
+    for (size_t b = 0; b < S; ++b) bits |= (uint8_t)((st[b] != 0) << b);
+    r.status = bits;
+    memcpy(&r.tUsEnd, st + S, 8);
+    if (CaptureStore::isGap(r.ch, C)) r.status |= STATUS_GAP;
+  }
+  return n;
+}
+
+// FIRMWARE[C - 1][S]: one instantiation per channel and status count
+template <size_t C, size_t... S>
+std::vector<SchemaDecoder::DecodeFn> firmwareRow(std::index_sequence<S...>) {
+  return { &decodeFirmware<C, S>... };
+}
+
+template <size_t... C>
+std::vector<std::vector<SchemaDecoder::DecodeFn> > firmwareTable(std::index_sequence<C...>) {
+  return { firmwareRow<C + 1>(std::make_index_sequence<SchemaDecoder::MAX_STATUS + 1>())... };
+}
+
+const std::vector<std::vector<SchemaDecoder::DecodeFn> > FIRMWARE =
+    firmwareTable(std::make_index_sequence<MAX_CHANNELS>());
+
+// Space-separated words of one line
+std::vector<std::string> words(const std::string& line) {
+  std::vector<std::string> out;
+  size_t at = 0;
+  while (at < line.size()) {
+    while (at < line.size() && (line[at] == ' ' || line[at] == '\t' || line[at] == '\r')) ++at;
+    size_t end = at;
+    while (end < line.size() && line[end] != ' ' && line[end] != '\t' && line[end] != '\r') ++end;
+    if (end > at) out.push_back(line.substr(at, end - at));
+    at = end;
+  }
+  return out;
+}
+
+bool parseType(const std::string& name, SchemaDecoder::Type& type) {
+  for (size_t i = 0; i < sizeof(TYPES) / sizeof(TYPES[0]); ++i) {
+    if (name == TYPES[i].name) {
+      type = (SchemaDecoder::Type)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool isStatusType(SchemaDecoder::Type t) {
+  return t == SchemaDecoder::T_U8 || t == SchemaDecoder::T_I8;
+}
+
+bool isCountType(SchemaDecoder::Type t) {
+  return t != SchemaDecoder::T_F32 && t != SchemaDecoder::T_F64;
+}
+
+// cal:<scale bits>:<offset bits>, 8 hex digits each
+bool parseCal(const std::string& word, float& scale, float& offset) {
+  if (word.size() != 4 + 8 + 1 + 8 || word[12] != ':') return false;
+  for (size_t i = 4; i < word.size(); ++i) {
+    if (i != 12 && !isxdigit((unsigned char)word[i])) return false;
+  }
+  const uint32_t s = (uint32_t)strtoul(word.substr(4, 8).c_str(), nullptr, 16);
+  const uint32_t o = (uint32_t)strtoul(word.substr(13, 8).c_str(), nullptr, 16);
+  memcpy(&scale, &s, sizeof(scale));
+  memcpy(&offset, &o, sizeof(offset));
+  return true;
+}
+
+// A calibrated count; U16_MISSING on a u16 channel is no data
+inline float calibrate(const uint8_t* p, uint8_t type, float scale, float offset) {
+  if (type == SchemaDecoder::T_U16 && load<uint16_t>(p) == SchemaDecoder::U16_MISSING) {
+    return std::numeric_limits<float>::quiet_NaN();
+  }
+  return asFloat(p, type) * scale + offset;
+}
+
+// ---- Column kernels: one field across rows [i, n) ----
+
+template <typename T>
+void countColumn(const uint8_t* p, size_t stride, size_t i, size_t n, float* dst, bool cal, float scale,
+                 float offset) {
+  for (p += i * stride; i < n; ++i, p += stride) {
+    const float v = (float)load<T>(p);
+    dst[i] = cal ? v * scale + offset : v;
+  }
+}
+
+void calU16Column(const uint8_t* p, size_t stride, size_t i, size_t n, float* dst, float scale, float offset) {
+  const float missing = std::numeric_limits<float>::quiet_NaN();
+  for (p += i * stride; i < n; ++i, p += stride) {
+    const uint16_t c = load<uint16_t>(p);
+    dst[i] = c == SchemaDecoder::U16_MISSING ? missing : (float)c * scale + offset;
+  }
+}
+
+void channelColumn(uint8_t type, const uint8_t* p, size_t stride, size_t i, size_t n, float* dst, bool cal,
+                   float scale, float offset) {
+  switch (type) {
+    case SchemaDecoder::T_U16:
+      if (cal) calU16Column(p, stride, i, n, dst, scale, offset);
+      else countColumn<uint16_t>(p, stride, i, n, dst, false, 1.0f, 0.0f);
+      break;
+    case SchemaDecoder::T_I16: countColumn<int16_t>(p, stride, i, n, dst, cal, scale, offset); break;
+    case SchemaDecoder::T_U32: countColumn<uint32_t>(p, stride, i, n, dst, cal, scale, offset); break;
+    case SchemaDecoder::T_I32: countColumn<int32_t>(p, stride, i, n, dst, cal, scale, offset); break;
+    case SchemaDecoder::T_U64: countColumn<uint64_t>(p, stride, i, n, dst, cal, scale, offset); break;
+    case SchemaDecoder::T_I64: countColumn<int64_t>(p, stride, i, n, dst, cal, scale, offset); break;
+    case SchemaDecoder::T_F32: countColumn<float>(p, stride, i, n, dst, false, 1.0f, 0.0f); break;
+    default:                   countColumn<double>(p, stride, i, n, dst, false, 1.0f, 0.0f); break;
+  }
+}
+
+void timeColumn(uint8_t type, const uint8_t* p, size_t stride, size_t i, size_t n, uint64_t* dst) {
+  p += i * stride;
+  if (type == SchemaDecoder::T_U64) {
+    for (; i < n; ++i, p += stride) dst[i] = load<uint64_t>(p);
+  } else {
+    for (; i < n; ++i, p += stride) dst[i] = asTime(p, type);
+  }
+}
+
+inline uint16_t duration(uint64_t t, uint64_t end) {
+  const uint64_t d = end - t;
+  return (end < t || d >= DUR_NONE) ? DUR_NONE : (uint16_t)d;
+}
+
+void durColumn(uint8_t tType, size_t tOff, uint8_t eType, size_t eOff, const uint8_t* p, size_t stride, size_t i,
+               size_t n, uint16_t* dst) {
+  p += i * stride;
+  if (tType == SchemaDecoder::T_U64 && eType == SchemaDecoder::T_U64) {
+    for (; i < n; ++i, p += stride) dst[i] = duration(load<uint64_t>(p + tOff), load<uint64_t>(p + eOff));
+  } else {
+    for (; i < n; ++i, p += stride) dst[i] = duration(asTime(p + tOff, tType), asTime(p + eOff, eType));
+  }
+}
+
+void statusColumn(size_t off, uint8_t bit, const uint8_t* p, size_t stride, size_t i, size_t n, uint8_t* dst) {
+  for (p += i * stride + off; i < n; ++i, p += stride) dst[i] |= (uint8_t)((p[0] != 0) << bit);
+}
+
+}  // namespace
+
+SchemaDecoder::SchemaDecoder()
+    : _periodUs(0), _sampleBytes(0), _channels(0), _status(0), _hasEnd(false), _implicitTimes(false),
+      _specialized(false), _fn(&generic), _columnKernel(KERNEL_SCALAR), _columnsFn(&columnsScalar) {}
+
+bool SchemaDecoder::compile(const std::string& text) {
+  _nodeName.clear();
+  _periodUs = 0;
+  _fields.clear();
+  _ops.clear();
+  _sampleBytes = _channels = _status = 0;
+  _hasEnd = _implicitTimes = _specialized = false;
+  _fn = &generic;
+  _columnKernel = KERNEL_SCALAR;
+  _columnsFn = &columnsScalar;
+  _error.clear();
+
+  size_t at = 0;
+  while (at < text.size()) {
+    size_t eol = text.find('\n', at);
+    if (eol == std::string::npos) eol = text.size();
+    const std::vector<std::string> w = words(text.substr(at, eol - at));
+    at = eol + 1;
+    if (w.empty()) continue;
+    if (w[0] == "node_name" && w.size() >= 2) {
+      _nodeName = w[1];
+    } else if (w[0] == "c" && w.size() >= 3 && w[1] == "telem_period") {
+      const uint64_t ns = strtoull(w[2].c_str(), nullptr, 10);
+      _periodUs = ns >= 1000 ? ns / 1000 : 0;
+    } else if (w[0] == "v") {
+      Field f;
+      if (w.size() < 3 || !parseType(w[2], f.type)) {
+        _error = "bad field line: v" + (w.size() > 1 ? " " + w[1] : std::string()) +
+                 (w.size() > 2 ? " " + w[2] : std::string());
+        return false;
+      }
+      f.name = w[1];
+      f.calibrated = false;
+      f.scale = 1.0f;
+      f.calOffset = 0.0f;
+      for (size_t i = 3; i < w.size(); ++i) {
+        if (w[i].compare(0, 2, "u:") == 0) {
+          f.unit = w[i].substr(2);
+        } else if (w[i].compare(0, 4, "cal:") == 0) {
+          if (!parseCal(w[i], f.scale, f.calOffset)) {
+            _error = "bad cal: on " + f.name;
+            return false;
+          }
+          f.calibrated = true;
+        }
+      }
+      f.role = ROLE_IGNORED;
+      f.offset = 0;
+      f.index = 0;
+      if (_fields.size() == MAX_FIELDS) {
+        _error = "more than 64 fields";
+        return false;
+      }
+      _fields.push_back(f);
+    }
+  }
+  if (_fields.empty()) {
+    _error = "no v lines";
+    return false;
+  }
+
+  // Time fields the schema leaves out (see header)
+  bool haveStart = false;
+  for (const Field& f : _fields) haveStart = haveStart || f.name == "t_us";
+  if (!haveStart) {
+    size_t firstStatus = 0;
+    while (firstStatus < _fields.size() && !isStatusType(_fields[firstStatus].type)) ++firstStatus;
+    Field t;
+    t.name = "t_us";
+    t.unit = "us";
+    t.type = T_U64;
+    t.role = ROLE_IGNORED;
+    t.offset = 0;
+    t.index = 0;
+    t.calibrated = false;
+    t.scale = 1.0f;
+    t.calOffset = 0.0f;
+    _fields.insert(_fields.begin() + (long)firstStatus, t);
+    t.name = "t_us_end";
+    _fields.push_back(t);
+    _implicitTimes = true;
+  }
+
+  size_t offset = 0;
+  bool haveEnd = false;
+  for (Field& f : _fields) {
+    f.offset = (uint16_t)offset;
+    offset += TYPES[f.type].size;
+    const bool time = f.name == "t_us" || f.name == "t_us_end";
+    if (time && (f.type == T_U16 || f.type == T_U32 || f.type == T_U64)) {
+      f.role = f.name == "t_us" ? ROLE_T_US : ROLE_T_US_END;
+    } else if (time) {
+      _error = f.name + " must be u16, u32 or u64";
+      return false;
+    } else if (isStatusType(f.type)) {
+      if (_status < MAX_STATUS) {
+        f.role = ROLE_STATUS;
+        f.index = (uint8_t)_status++;
+      }
+    } else if (_channels < MAX_CHANNELS) {
+      f.role = ROLE_CHANNEL;
+      f.index = (uint8_t)_channels++;
+    }
+    if (f.role == ROLE_T_US_END) {
+      if (haveEnd) {
+        _error = "t_us_end twice";
+        return false;
+      }
+      haveEnd = true;
+    }
+    // Calibration applies to counts; f32/f64 channels are sent calibrated
+    if (f.role != ROLE_CHANNEL || !isCountType(f.type)) {
+      f.calibrated = false;
+      f.scale = 1.0f;
+      f.calOffset = 0.0f;
+    }
+    if (f.role != ROLE_IGNORED) {
+      _ops.push_back(Op{ f.offset, (uint8_t)f.type, (uint8_t)f.role, f.index, f.calibrated, f.scale, f.calOffset });
+    }
+  }
+  size_t starts = 0;
+  for (const Field& f : _fields) starts += f.role == ROLE_T_US;
+  if (starts != 1) {
+    _error = "t_us twice";
+    return false;
+  }
+  _sampleBytes = offset;
+  _hasEnd = haveEnd;
+
+  // The firmware's layout gets its specialized decoder
+  const size_t c = _channels, s = _status;
+  bool firmware = c >= 1 && _fields.size() == c + s + 2;
+  for (size_t i = 0; firmware && i < _fields.size(); ++i) {
+    const Field& f = _fields[i];
+    if (i < c) firmware = f.role == ROLE_CHANNEL && f.type == T_F32;
+    else if (i == c) firmware = f.role == ROLE_T_US && f.type == T_U64;
+    else if (i < c + 1 + s) firmware = f.role == ROLE_STATUS && f.type == T_U8;
+    else firmware = f.role == ROLE_T_US_END && f.type == T_U64;
+  }
+  if (firmware) {
+    _fn = FIRMWARE[c - 1][s];
+    _specialized = true;
+  }
+#ifdef SCHEMA_DECODER_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    _columnsFn = &columnsAvx2;
+    _columnKernel = KERNEL_AVX2;
+  }
+#endif
+  return true;
+}
+
+size_t SchemaDecoder::decodeColumnsScalar(const uint8_t* payload, size_t len, const ColumnsOut& out) const {
+  if (_sampleBytes == 0 || len % _sampleBytes != 0) return 0;
+  return columnsScalar(*this, payload, len / _sampleBytes, out);
+}
+
+size_t SchemaDecoder::decodeGeneric(const uint8_t* payload, size_t len, Record* out, size_t max) const {
+  if (_sampleBytes == 0 || len % _sampleBytes != 0) return 0;
+  size_t n = len / _sampleBytes;
+  if (n > max) n = max;
+  return generic(*this, payload, n, out);
+}
+
+size_t SchemaDecoder::generic(const SchemaDecoder& d, const uint8_t* p, size_t n, Record* out) {
+  const Op* ops = d._ops.data();
+  const size_t count = d._ops.size();
+  for (size_t i = 0; i < n; ++i, p += d._sampleBytes) {
+    Record& r = out[i];
+    memset(r.ch, 0, sizeof(r.ch));
+    r.tUsEnd = 0;
+    uint8_t bits = 0;
+    for (size_t k = 0; k < count; ++k) {
+      const Op& op = ops[k];
+      const uint8_t* q = p + op.offset;
+      switch (op.role) {
+        case ROLE_CHANNEL:
+          r.ch[op.index] = op.calibrated ? calibrate(q, op.type, op.scale, op.calOffset) : asFloat(q, op.type);
+          break;
+        case ROLE_T_US:    r.tUs = asTime(q, op.type); break;
+        case ROLE_T_US_END: r.tUsEnd = asTime(q, op.type); break;
+        default:           bits |= (uint8_t)((q[0] != 0) << op.index); break;
+      }
+    }
+    if (CaptureStore::isGap(r.ch, d._channels)) bits |= STATUS_GAP;
+    r.status = bits;
+  }
+  return n;
+}
+
+size_t SchemaDecoder::columnsScalar(const SchemaDecoder& d, const uint8_t* p, size_t n, const ColumnsOut& out) {
+  columnRows(d, p, 0, n, out);
+  markGaps(d, n, out);
+  return n;
+}
+
+void SchemaDecoder::markGaps(const SchemaDecoder& d, size_t n, const ColumnsOut& out) {
+  if (!out.status) return;
+  const float* ch[MAX_CHANNELS];
+  size_t count = 0;
+  for (size_t c = 0; c < d._channels; ++c) {
+    if (out.ch[c]) ch[count++] = out.ch[c];
+  }
+  if (count == 0) return;
+  // Real samples are never NaN, so one test per row on the first channel
+  for (size_t i = 0; i < n; ++i) {
+    if (ch[0][i] == ch[0][i]) continue;
+    size_t c = 1;
+    while (c < count && ch[c][i] != ch[c][i]) ++c;
+    if (c == count) out.status[i] |= STATUS_GAP;
+  }
+}
+
+void SchemaDecoder::columnRows(const SchemaDecoder& d, const uint8_t* p, size_t i, size_t n, const ColumnsOut& out) {
+  const size_t stride = d._sampleBytes;
+  const Op* tOp = nullptr;
+  const Op* eOp = nullptr;
+  if (out.status) memset(out.status + i, 0, n - i);
+  for (const Op& op : d._ops) {
+    switch (op.role) {
+      case ROLE_CHANNEL:
+        if (out.ch[op.index]) {
+          channelColumn(op.type, p + op.offset, stride, i, n, out.ch[op.index], op.calibrated, op.scale, op.calOffset);
+        }
+        break;
+      case ROLE_T_US:
+        tOp = &op;
+        if (out.t) timeColumn(op.type, p + op.offset, stride, i, n, out.t);
+        break;
+      case ROLE_T_US_END:
+        eOp = &op;
+        break;
+      default:
+        if (out.status) statusColumn(op.offset, op.index, p, stride, i, n, out.status);
+        break;
+    }
+  }
+  if (out.dur) {
+    if (eOp) {
+      durColumn(tOp->type, tOp->offset, eOp->type, eOp->offset, p, stride, i, n, out.dur);
+    } else {
+      for (size_t k = i; k < n; ++k) out.dur[k] = DUR_NONE;
+    }
+  }
+  for (size_t c = d._channels; c < MAX_CHANNELS; ++c) {
+    if (out.ch[c]) memset(out.ch[c] + i, 0, (n - i) * sizeof(float));
+  }
+}
+
+#ifdef SCHEMA_DECODER_AVX2
+
+namespace {
+
+#define AVX2 __attribute__((target("avx2")))
+
+// Byte offsets of 8 (4) consecutive samples
+AVX2 inline __m256i laneOffsets8(size_t stride) {
+  return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)stride));
+}
+
+AVX2 inline __m128i laneOffsets4(size_t stride) {
+  return _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32((int)stride));
+}
+
+// Low 16 bits of four u64 lanes into the low 8 bytes
+AVX2 inline __m128i narrow64to16(__m256i v) {
+  const __m256i pick = _mm256_setr_epi8(0, 1, 8, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                        0, 1, 8, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pick), _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+  return _mm256_castsi256_si128(v);
+}
+
+// Low byte of eight u32 lanes into the low 8 bytes
+AVX2 inline __m128i narrow32to8(__m256i v) {
+  const __m256i pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                        0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pick), _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+  return _mm256_castsi256_si128(v);
+}
+
+// duration() on four lanes
+AVX2 inline __m256i duration4(__m256i t, __m256i end) {
+  const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+  const __m256i d = _mm256_sub_epi64(end, t);
+  const __m256i before = _mm256_cmpgt_epi64(_mm256_xor_si256(t, sign), _mm256_xor_si256(end, sign));
+  const __m256i tooLong =
+      _mm256_cmpgt_epi64(_mm256_xor_si256(d, sign), _mm256_set1_epi64x((long long)((DUR_NONE - 1) ^ 0x8000000000000000ull)));
+  return _mm256_blendv_epi8(d, _mm256_set1_epi64x(DUR_NONE), _mm256_or_si256(before, tooLong));
+}
+
+// f32 as is; u16/i16/i32 counts converted and calibrated in the register
+AVX2 bool gatherChannel(uint8_t type, const uint8_t* p, size_t stride, size_t m, float* dst, bool cal, float scale,
+                        float offset) {
+  if (type != SchemaDecoder::T_F32 && type != SchemaDecoder::T_U16 && type != SchemaDecoder::T_I16 &&
+      type != SchemaDecoder::T_I32) {
+    return false;
+  }
+  const __m256i idx = laneOffsets8(stride);
+  const __m256 s = _mm256_set1_ps(scale);
+  const __m256 o = _mm256_set1_ps(offset);
+  const size_t step = 8 * stride;
+  if (type == SchemaDecoder::T_F32) {
+    for (size_t i = 0; i < m; i += 8, p += step) {
+      _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(reinterpret_cast<const float*>(p), idx, 1));
+    }
+    return true;
+  }
+  for (size_t i = 0; i < m; i += 8, p += step) {
+    __m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int*>(p), idx, 1);
+    if (type == SchemaDecoder::T_U16) g = _mm256_and_si256(g, _mm256_set1_epi32(0xFFFF));
+    else if (type == SchemaDecoder::T_I16) g = _mm256_srai_epi32(_mm256_slli_epi32(g, 16), 16);
+    __m256 v = _mm256_cvtepi32_ps(g);
+    // Multiply, then add: no FMA, the same rounding as the scalar loop
+    if (cal) {
+      v = _mm256_add_ps(_mm256_mul_ps(v, s), o);
+      if (type == SchemaDecoder::T_U16) {
+        const __m256i missing = _mm256_cmpeq_epi32(g, _mm256_set1_epi32(SchemaDecoder::U16_MISSING));
+        v = _mm256_blendv_ps(v, _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()), _mm256_castsi256_ps(missing));
+      }
+    }
+    _mm256_storeu_ps(dst + i, v);
+  }
+  return true;
+}
+
+AVX2 void gatherTimes(const uint8_t* p, size_t stride, size_t m, uint64_t* dst) {
+  const __m128i idx = laneOffsets4(stride);
+  const size_t half = 4 * stride;
+  for (size_t i = 0; i < m; i += 8, p += 2 * half) {
+    const __m256i a = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(p), idx, 1);
+    const __m256i b = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(p + half), idx, 1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), a);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 4), b);
+  }
+}
+
+AVX2 void gatherDurations(const uint8_t* p, size_t tOff, size_t eOff, size_t stride, size_t m, uint16_t* dst) {
+  const __m128i idx = laneOffsets4(stride);
+  const size_t half = 4 * stride;
+  for (size_t i = 0; i < m; i += 8, p += 2 * half) {
+    const __m256i ta = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(p + tOff), idx, 1);
+    const __m256i tb = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(p + half + tOff), idx, 1);
+    const __m256i ea = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(p + eOff), idx, 1);
+    const __m256i eb = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(p + half + eOff), idx, 1);
+    const __m128i d = _mm_unpacklo_epi64(narrow64to16(duration4(ta, ea)), narrow64to16(duration4(tb, eb)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), d);
+  }
+}
+
+// All status bytes of 8 samples into 8 bit masks
+AVX2 void gatherStatus(const uint8_t* p, const uint16_t* offsets, size_t count, size_t stride, size_t m,
+                       uint8_t* dst) {
+  const __m256i idx = laneOffsets8(stride);
+  const __m256i low = _mm256_set1_epi32(0xFF);
+  const __m256i zero = _mm256_setzero_si256();
+  for (size_t i = 0; i < m; i += 8, p += 8 * stride) {
+    __m256i bits = zero;
+    for (size_t k = 0; k < count; ++k) {
+      const __m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int*>(p + offsets[k]), idx, 1);
+      const __m256i isZero = _mm256_cmpeq_epi32(_mm256_and_si256(g, low), zero);
+      bits = _mm256_or_si256(bits, _mm256_andnot_si256(isZero, _mm256_set1_epi32(1 << k)));
+    }
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), narrow32to8(bits));
+  }
+}
+
+#undef AVX2
+
+}  // namespace
+
+__attribute__((target("avx2")))
+size_t SchemaDecoder::columnsAvx2(const SchemaDecoder& d, const uint8_t* p, size_t n, const ColumnsOut& out) {
+  // Whole blocks of 8 that leave the last sample out: a 4-byte gather of
+  // a narrower field reads into the next sample, never past the payload
+  const size_t stride = d._sampleBytes;
+  const size_t m = n > 0 ? (n - 1) / 8 * 8 : 0;
+  const Op* tOp = nullptr;
+  const Op* eOp = nullptr;
+  uint16_t statusOffsets[MAX_STATUS];
+  size_t statusCount = 0;
+  for (const Op& op : d._ops) {
+    switch (op.role) {
+      case ROLE_CHANNEL:
+        if (out.ch[op.index] &&
+            !gatherChannel(op.type, p + op.offset, stride, m, out.ch[op.index], op.calibrated, op.scale, op.calOffset)) {
+          channelColumn(op.type, p + op.offset, stride, 0, m, out.ch[op.index], op.calibrated, op.scale, op.calOffset);
+        }
+        break;
+      case ROLE_T_US:
+        tOp = &op;
+        if (!out.t) break;
+        if (op.type == T_U64) gatherTimes(p + op.offset, stride, m, out.t);
+        else timeColumn(op.type, p + op.offset, stride, 0, m, out.t);
+        break;
+      case ROLE_T_US_END:
+        eOp = &op;
+        break;
+      default:
+        statusOffsets[op.index] = op.offset;
+        statusCount = std::max(statusCount, (size_t)op.index + 1);
+        break;
+    }
+  }
+  if (out.status) {
+    if (statusCount) gatherStatus(p, statusOffsets, statusCount, stride, m, out.status);
+    else memset(out.status, 0, m);
+  }
+  if (out.dur) {
+    if (!eOp) {
+      for (size_t i = 0; i < m; ++i) out.dur[i] = DUR_NONE;
+    } else if (tOp->type == T_U64 && eOp->type == T_U64) {
+      gatherDurations(p, tOp->offset, eOp->offset, stride, m, out.dur);
+    } else {
+      durColumn(tOp->type, tOp->offset, eOp->type, eOp->offset, p, stride, 0, m, out.dur);
+    }
+  }
+  for (size_t c = d._channels; c < MAX_CHANNELS; ++c) {
+    if (out.ch[c]) memset(out.ch[c], 0, m * sizeof(float));
+  }
+  columnRows(d, p, m, n, out);
+  markGaps(d, n, out);
+  return n;
+}
+
+#else
+
+size_t SchemaDecoder::columnsAvx2(const SchemaDecoder& d, const uint8_t* p, size_t n, const ColumnsOut& out) {
+  return columnsScalar(d, p, n, out);
+}
+
+#endif
+
+SchemaCache::SchemaCache() : _clock(0) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+SchemaCache::State SchemaCache::add(const Neutrino::Header& h, std::shared_ptr<const SchemaDecoder>& decoder) {
+  if (h.numFrags == 0) return SCHEMA_NONE;
+  ++_stats.packets;
+  const std::string key((const char*)h.schemaHash, sizeof(h.schemaHash));
+  std::map<std::string, Entry>::iterator it = _entries.find(key);
+  if (it == _entries.end()) {
+    if (_entries.size() >= MAX_SCHEMAS) {
+      std::map<std::string, Entry>::iterator oldest = _entries.begin();
+      for (std::map<std::string, Entry>::iterator e = _entries.begin(); e != _entries.end(); ++e) {
+        if (e->second.lastUse < oldest->second.lastUse) oldest = e;
+      }
+      _entries.erase(oldest);
+      ++_stats.evicted;
+    }
+    Entry fresh;
+    fresh.numFrags = h.numFrags;
+    fresh.have = 0;
+    fresh.state = SCHEMA_PARTIAL;
+    if (h.numFrags > MAX_FRAGS) {
+      fresh.state = SCHEMA_INVALID;
+      ++_stats.invalid;
+    } else {
+      fresh.text.assign((size_t)h.numFrags * Neutrino::FRAG_LEN, '\0');
+      fresh.got.assign(h.numFrags, false);
+    }
+    it = _entries.insert(std::make_pair(key, std::move(fresh))).first;
+  }
+  Entry& e = it->second;
+  e.lastUse = ++_clock;
+  if (e.state == SCHEMA_PARTIAL && h.numFrags == e.numFrags && h.fragIdx < e.numFrags && !e.got[h.fragIdx]) {
+    memcpy(&e.text[(size_t)h.fragIdx * Neutrino::FRAG_LEN], h.schemaFrag, Neutrino::FRAG_LEN);
+    e.got[h.fragIdx] = true;
+    if (++e.have == e.numFrags) {
+      // The last fragment is zero-padded
+      const size_t end = e.text.find('\0');
+      if (end != std::string::npos) e.text.resize(end);
+      std::shared_ptr<SchemaDecoder> d(new SchemaDecoder());
+      if (d->compile(e.text)) {
+        e.decoder = d;
+        e.state = SCHEMA_READY;
+        ++_stats.compiled;
+      } else {
+        e.state = SCHEMA_INVALID;
+        ++_stats.invalid;
+      }
+      e.got.clear();
+    }
+  }
+  if (e.state == SCHEMA_READY) decoder = e.decoder;
+  return e.state;
+}
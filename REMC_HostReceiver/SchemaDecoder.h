@@ -0,0 +1,235 @@
+/*
+  ---------------------------------------------------------------------------
+  SchemaDecoder – Sample Decoding Compiled from the Device's Schema (host)
+  ---------------------------------------------------------------------------
+
+  The device sends its schema text 16 bytes per packet (UdpManager
+  buildSchema()), identified by the MD5 in every header:
+
+    node_name REMC
+    c telem_period 100000
+    v switch_voltage f32 u:kV        one "v <name> <type> [u:<unit>]
+    ...                              [cal:<scale>:<offset>]" line per
+                                     sample field, in wire order
+    v t_us u64 u:us
+    v armed_status u8
+    ...
+    v t_us_end u64 u:us
+
+  SchemaCache puts the fragments back together per hash and compiles the
+  text once into a SchemaDecoder: a table of field offsets and types, the
+  sample size, and how each field lands in a CaptureStore::Record:
+
+    t_us, t_us_end       the sample times (unsigned integer types)
+    u8 / i8 fields       status bytes, bit i of Record::status (i < 7)
+    other numeric types  analog channels, Record::ch[] in schema order
+                         (f32 as is, integers as counts, or as
+                         count * scale + offset with a cal: word)
+
+  Gap markers arrive with no data (NaN f32 channels, calibrated u16
+  channels at U16_MISSING = 0xFFFF, which becomes NaN instead of a
+  calibrated value); a row whose channels are all NaN gets
+  CaptureStore::STATUS_GAP (bit 7) in its status, in every decode path.
+  A decimated channel arrives the same way on the samples between its
+  outputs (Sample::held on the device): NaN in that channel only, and no
+  STATUS_GAP since the other channels are data.
+
+  cal: carries the ChannelTable calibration of a channel sent as raw
+  counts (WireType::U16) as the IEEE-754 bits of the two floats, 8 hex
+  digits each, so the host computes the same float the firmware would
+  have sent without printing or parsing decimals.
+
+  Schemas from before the time lines were listed leave them out; the
+  firmware packed u64 t_us after the analog channels and u64 t_us_end
+  after the status bytes, and that is what is assumed when a schema has
+  no t_us line.
+
+  Decoding picks a function at compile time instead of testing fields per
+  sample: the firmware's layout (f32 channels, t_us, u8 statuses,
+  t_us_end) goes to a decoder specialized on the channel and status
+  counts; anything else runs the field table. Either way the payload
+  length must be a whole number of samples of exactly that size, so a
+  layout is never guessed from the length.
+
+  decodeColumns() is the writer thread's path: a whole packet straight
+  into the store's columns (BlockCodec::ColumnsOut, see CaptureStore
+  Writer::reserve()), one field across all samples at a time. With AVX2
+  (checked at run time) each field is gathered 8 samples per instruction
+  from the interleaved payload, and integer counts are converted and
+  calibrated in the same registers; otherwise, and for the types the
+  gathers do not cover (u32, 64-bit channels, u16/u32 times), a scalar
+  loop does the same field by field. Both give bit-identical columns.
+
+  Pure logic, no I/O. Not thread-safe: one SchemaCache per receive thread;
+  a compiled SchemaDecoder is immutable and is shared by every sender
+  with that hash.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef SCHEMA_DECODER_H
+#define SCHEMA_DECODER_H
+
+#include "CaptureStore.h"
+#include "NeutrinoPacket.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class SchemaDecoder {
+public:
+  static const size_t MAX_FIELDS = 64;
+  static const size_t MAX_STATUS = 7;           // bits of Record::status below STATUS_GAP
+  static const uint16_t U16_MISSING = 0xFFFF;   // ChannelTable::U16_MISSING: no data on a cal: channel
+
+  enum Type : uint8_t { T_U8, T_I8, T_U16, T_I16, T_U32, T_I32, T_U64, T_I64, T_F32, T_F64 };
+  enum Role : uint8_t {
+    ROLE_CHANNEL,
+    ROLE_T_US,
+    ROLE_T_US_END,
+    ROLE_STATUS,
+    ROLE_IGNORED                                // beyond MAX_CHANNELS / MAX_STATUS
+  };
+
+  struct Field {
+    std::string name;
+    std::string unit;          // "" without u:
+    Type type;
+    Role role;
+    uint16_t offset;           // within the sample
+    uint8_t index;             // channel or status bit
+    bool calibrated;           // cal: on an integer channel
+    float scale;               // value = count * scale + offset
+    float calOffset;
+  };
+
+  enum ColumnKernel : uint8_t { KERNEL_SCALAR, KERNEL_AVX2 };
+
+  SchemaDecoder();
+
+  // False (see error()) if the text has no usable sample layout
+  bool compile(const std::string& text);
+
+  const std::string& nodeName() const { return _nodeName; }    // "" without node_name
+  uint64_t periodUs() const { return _periodUs; }              // 0 without c telem_period
+  size_t sampleBytes() const { return _sampleBytes; }
+  size_t channels() const { return _channels; }
+  size_t statusCount() const { return _status; }
+  bool hasEnd() const { return _hasEnd; }
+  bool implicitTimes() const { return _implicitTimes; }        // t_us / t_us_end assumed
+  bool specialized() const { return _specialized; }
+  ColumnKernel columnKernel() const { return _columnKernel; }
+  const std::vector<Field>& fields() const { return _fields; }
+  const std::string& error() const { return _error; }
+
+  // Samples of a sample packet's payload into `out` (at most `max`); 0 if
+  // the length is not a whole number of samples. Record::ch[] past
+  // channels() is zeroed; tUsEnd is 0 without a t_us_end field.
+  size_t decode(const uint8_t* payload, size_t len, CaptureStore::Record* out, size_t max) const {
+    if (_sampleBytes == 0 || len % _sampleBytes != 0) return 0;
+    size_t n = len / _sampleBytes;
+    if (n > max) n = max;
+    return _fn(*this, payload, n, out);
+  }
+  // The same through the field table, whatever the layout
+  size_t decodeGeneric(const uint8_t* payload, size_t len, CaptureStore::Record* out, size_t max) const;
+
+  // A payload's samples as columns, row i of every non-null column:
+  // t_us, duration (CaptureStore::DUR_NONE without t_us_end or when it
+  // does not fit), channels (zero past channels()) and status bits. The
+  // caller sizes the columns for len / sampleBytes() rows; 0 if the
+  // length is not a whole number of samples
+  size_t decodeColumns(const uint8_t* payload, size_t len, const BlockCodec::ColumnsOut& out) const {
+    if (_sampleBytes == 0 || len % _sampleBytes != 0) return 0;
+    return _columnsFn(*this, payload, len / _sampleBytes, out);
+  }
+  // The same with the scalar kernel, whatever the CPU
+  size_t decodeColumnsScalar(const uint8_t* payload, size_t len, const BlockCodec::ColumnsOut& out) const;
+
+  typedef size_t (*DecodeFn)(const SchemaDecoder& d, const uint8_t* p, size_t n, CaptureStore::Record* out);
+  typedef size_t (*ColumnsFn)(const SchemaDecoder& d, const uint8_t* p, size_t n, const BlockCodec::ColumnsOut& out);
+
+private:
+  struct Op {
+    uint16_t offset;
+    uint8_t type;
+    uint8_t role;
+    uint8_t index;
+    bool calibrated;
+    float scale;
+    float calOffset;
+  };
+
+  static size_t generic(const SchemaDecoder& d, const uint8_t* p, size_t n, CaptureStore::Record* out);
+  static size_t columnsScalar(const SchemaDecoder& d, const uint8_t* p, size_t n, const BlockCodec::ColumnsOut& out);
+  static size_t columnsAvx2(const SchemaDecoder& d, const uint8_t* p, size_t n, const BlockCodec::ColumnsOut& out);
+  // Rows [i, n) of every requested column
+  static void columnRows(const SchemaDecoder& d, const uint8_t* p, size_t i, size_t n, const BlockCodec::ColumnsOut& out);
+  // STATUS_GAP on rows [0, n) whose requested channels are all NaN
+  static void markGaps(const SchemaDecoder& d, size_t n, const BlockCodec::ColumnsOut& out);
+
+  std::string _nodeName;
+  uint64_t _periodUs;
+  std::vector<Field> _fields;
+  std::vector<Op> _ops;
+  size_t _sampleBytes;
+  size_t _channels;
+  size_t _status;
+  bool _hasEnd;
+  bool _implicitTimes;
+  bool _specialized;
+  DecodeFn _fn;
+  ColumnKernel _columnKernel;
+  ColumnsFn _columnsFn;
+  std::string _error;
+};
+
+class SchemaCache {
+public:
+  static const uint32_t MAX_FRAGS = 64;         // 1 KB of schema text
+  static const size_t MAX_SCHEMAS = 64;         // least recently used dropped beyond
+
+  enum State : uint8_t {
+    SCHEMA_NONE,               // bare header (batch-end marker): no schema
+    SCHEMA_PARTIAL,            // fragments still missing
+    SCHEMA_READY,              // compiled
+    SCHEMA_INVALID             // complete but not compilable, or too long
+  };
+
+  struct Stats {
+    uint64_t packets;
+    uint64_t compiled;
+    uint64_t invalid;
+    uint64_t evicted;
+  };
+
+  SchemaCache();
+
+  // Adds the header's fragment; `decoder` is set once the schema of its
+  // hash is complete and compiled (held by the caller, it outlives eviction)
+  State add(const Neutrino::Header& h, std::shared_ptr<const SchemaDecoder>& decoder);
+
+  size_t size() const { return _entries.size(); }
+  const Stats& stats() const { return _stats; }
+
+private:
+  struct Entry {
+    uint32_t numFrags;
+    uint32_t have;
+    std::string text;
+    std::vector<bool> got;
+    State state;
+    uint64_t lastUse;
+    std::shared_ptr<const SchemaDecoder> decoder;
+  };
+
+  std::map<std::string, Entry> _entries;        // by the 16-byte hash
+  uint64_t _clock;
+  Stats _stats;
+};
+
+#endif // SCHEMA_DECODER_H
@@ -0,0 +1,407 @@
+#include "StoreWriter.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+const double StoreWriter::SYNC_INTERVAL_S = 1.0;
+
+namespace {
+
+const size_t ENTRY_ALIGN = 8;
+const int WRITER_NICE = 5;
+
+double monotonicSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool openOrCreate(CaptureStore::Writer& w, const std::string& dir, const std::vector<std::string>& channels,
+                  uint32_t flags) {
+  struct stat st;
+  if (stat((dir + "/store.meta").c_str(), &st) == 0) return w.open(dir);
+  return w.create(dir, channels, flags);
+}
+
+// Next free batch number under <store>/batches
+unsigned nextBatchNumber(const std::string& batchesDir) {
+  unsigned next = 1;
+  DIR* d = opendir(batchesDir.c_str());
+  if (!d) return next;
+  while (dirent* e = readdir(d)) {
+    unsigned n;
+    if (sscanf(e->d_name, "batch_%u", &n) == 1 && n >= next) next = n + 1;
+  }
+  closedir(d);
+  return next;
+}
+
+}  // namespace
+
+StoreWriter::StoreWriter()
+  : _storeFlags(0), _mask(0), _tail(0), _head(0), _sleeping(false), _wakeFd(-1), _endPending(false), _queuedLayout(nullptr), _claimed(0), _packets(0),
+    _samples(0), _dropped(0), _droppedSamples(0), _maxQueueBytes(0), _stop(false), _batchNumber(1), _written(0),
+    _batches(0), _errors(0) {
+  memset(&_shared, 0, sizeof(_shared));
+}
+
+StoreWriter::~StoreWriter() {
+  stop();
+}
+
+void* StoreWriter::operator new(size_t bytes) {
+  void* p = nullptr;
+  if (posix_memalign(&p, alignof(StoreWriter), bytes) != 0) throw std::bad_alloc();
+  return p;
+}
+
+void StoreWriter::operator delete(void* p) {
+  free(p);
+}
+
+bool StoreWriter::start(const std::string& storeDir, const std::vector<std::string>& channels, uint32_t storeFlags,
+                        size_t queueBytes, bool useIoUring) {
+  stop();
+  _storeDir = storeDir;
+  _batchesDir = storeDir + "/batches";
+  _channels = channels;
+  _storeFlags = storeFlags;
+  mkdir(storeDir.c_str(), 0755);
+  mkdir(_batchesDir.c_str(), 0755);
+  if (!openOrCreate(_live, storeDir + "/live", channels, storeFlags)) {
+    _error = _live.error();
+    return false;
+  }
+  _batchNumber = nextBatchNumber(_batchesDir);
+
+  // Power of two, room for at least a few of the largest packets
+  const size_t minimum = 4 * (sizeof(Entry) + MAX_PACKET_SAMPLES * sizeof(CaptureStore::Record));
+  size_t capacity = 4096;
+  while (capacity < std::max(queueBytes, minimum)) capacity <<= 1;
+  _queue.assign(capacity, 0);
+  _mask = capacity - 1;
+  _tail = 0;
+  _head = 0;
+  _endPending = false;
+  _queuedLayout = nullptr;
+  _packets = _samples = _dropped = _droppedSamples = _maxQueueBytes = 0;
+  _written = _batches = _errors = 0;
+
+  _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (_wakeFd < 0) {
+    _error = std::string("eventfd: ") + strerror(errno);
+    _live.close();
+    return false;
+  }
+  _io.init(useIoUring);
+  _io.setIssueHook(_issueHook);
+  _live.setIo(&_io);
+  _batch.setIo(&_io);
+  publishStats();
+  _stop = false;
+  _thread = std::thread(&StoreWriter::run, this);
+  return true;
+}
+
+void StoreWriter::stop() {
+  if (_thread.joinable()) {
+    if (_endPending) push(BATCH_END, nullptr, 0, 0);
+    _stop = true;
+    const uint64_t one = 1;
+    if (write(_wakeFd, &one, sizeof(one)) < 0) {
+      // the writer also wakes from its poll timeout
+    }
+    _thread.join();
+  }
+  if (_wakeFd >= 0) ::close(_wakeFd);
+  _wakeFd = -1;
+}
+
+// ---------------- producer ----------------
+
+uint8_t* StoreWriter::claim(Kind kind, size_t bytes, size_t count) {
+  const size_t capacity = _queue.size();
+  const size_t need = (sizeof(Entry) + bytes + ENTRY_ALIGN - 1) / ENTRY_ALIGN * ENTRY_ALIGN;
+  uint64_t tail = _tail.load(std::memory_order_relaxed);
+  const uint64_t head = _head.load(std::memory_order_acquire);
+  size_t at = (size_t)(tail & _mask);
+  const size_t toEnd = capacity - at;
+  const size_t total = need + (toEnd < need ? toEnd : 0);
+  if (capacity == 0 || capacity - (tail - head) < total) return nullptr;
+
+  // Entries are contiguous; the rest of the buffer is skipped with a WRAP entry
+  if (toEnd < need) {
+    Entry wrap = { (uint32_t)toEnd, WRAP, 0, 0 };
+    memcpy(&_queue[at], &wrap, sizeof(wrap));
+    tail += toEnd;
+    at = 0;
+  }
+  Entry e = { (uint32_t)need, kind, 0, (uint16_t)count };
+  memcpy(&_queue[at], &e, sizeof(e));
+  _claimed = tail + need;
+  return &_queue[at + sizeof(e)];
+}
+
+void StoreWriter::push() {
+  const uint64_t tail = _claimed;
+  const uint64_t head = _head.load(std::memory_order_relaxed);
+  _tail.store(tail, std::memory_order_seq_cst);
+
+  const uint64_t depth = tail - head;
+  if (depth > _maxQueueBytes.load(std::memory_order_relaxed)) _maxQueueBytes.store(depth, std::memory_order_relaxed);
+  if (_sleeping.load(std::memory_order_seq_cst)) {
+    const uint64_t one = 1;
+    if (write(_wakeFd, &one, sizeof(one)) < 0) {
+      // counter saturated: the writer is awake anyway
+    }
+  }
+}
+
+bool StoreWriter::push(Kind kind, const void* payload, size_t bytes, size_t count) {
+  uint8_t* at = claim(kind, bytes, count);
+  if (!at) return false;
+  if (bytes) memcpy(at, payload, bytes);
+  push();
+  return true;
+}
+
+bool StoreWriter::appendPacket(Kind kind, const CaptureStore::Record* r, size_t n) {
+  if (!_thread.joinable() || n == 0) return false;
+  // A batch end that did not fit goes first, or the dump would run on
+  if (_endPending) _endPending = !push(BATCH_END, nullptr, 0, 0);
+  size_t done = 0;
+  while (!_endPending && done < n) {
+    const size_t m = std::min(n - done, (size_t)MAX_PACKET_SAMPLES);
+    if (!push(kind, r + done, m * sizeof(CaptureStore::Record), m)) break;
+    done += m;
+  }
+  if (done < n) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    _droppedSamples.fetch_add(n - done, std::memory_order_relaxed);
+    return false;
+  }
+  _packets.fetch_add(1, std::memory_order_relaxed);
+  _samples.fetch_add(n, std::memory_order_relaxed);
+  return true;
+}
+
+bool StoreWriter::appendRaw(Kind kind, const std::shared_ptr<const SchemaDecoder>& layout, const uint8_t* payload,
+                            size_t n) {
+  if (!_thread.joinable() || n == 0 || !layout) return false;
+  if (_endPending) _endPending = !push(BATCH_END, nullptr, 0, 0);
+  // The writer thread takes its own reference from the LAYOUT entry; the
+  // address identifies the layout as long as that reference is held
+  if (!_endPending && layout.get() != _queuedLayout) {
+    uint8_t* at = claim(LAYOUT, sizeof(std::shared_ptr<const SchemaDecoder>), 0);
+    if (at) {
+      new (at) std::shared_ptr<const SchemaDecoder>(layout);
+      push();
+      _queuedLayout = layout.get();
+    }
+  }
+  const size_t bytes = layout->sampleBytes();
+  const size_t perEntry = std::min((size_t)MAX_PACKET_SAMPLES, MAX_PACKET_SAMPLES * sizeof(CaptureStore::Record) / bytes);
+  size_t done = 0;
+  while (!_endPending && layout.get() == _queuedLayout && done < n) {
+    const size_t m = std::min(n - done, perEntry);
+    if (!push(kind, payload + done * bytes, m * bytes, m)) break;
+    done += m;
+  }
+  if (done < n) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    _droppedSamples.fetch_add(n - done, std::memory_order_relaxed);
+    return false;
+  }
+  _packets.fetch_add(1, std::memory_order_relaxed);
+  _samples.fetch_add(n, std::memory_order_relaxed);
+  return true;
+}
+
+bool StoreWriter::appendLive(const CaptureStore::Record* r, size_t n) {
+  return appendPacket(LIVE, r, n);
+}
+
+bool StoreWriter::appendCollected(const CaptureStore::Record* r, size_t n) {
+  return appendPacket(COLLECTED, r, n);
+}
+
+bool StoreWriter::appendLive(const std::shared_ptr<const SchemaDecoder>& layout, const uint8_t* payload, size_t n) {
+  return appendRaw(LIVE_RAW, layout, payload, n);
+}
+
+bool StoreWriter::appendCollected(const std::shared_ptr<const SchemaDecoder>& layout, const uint8_t* payload,
+                                  size_t n) {
+  return appendRaw(COLLECTED_RAW, layout, payload, n);
+}
+
+bool StoreWriter::endBatch() {
+  if (!_thread.joinable()) return false;
+  _endPending = !push(BATCH_END, nullptr, 0, 0);
+  return !_endPending;
+}
+
+// ---------------- writer thread ----------------
+
+void StoreWriter::run() {
+  // On a busy host the receive loop should win the CPU; the queue absorbs the difference
+  setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), WRITER_NICE);
+  double lastSync = monotonicSeconds();
+  while (true) {
+    const bool worked = drainQueue();
+    _io.reap(false);
+    const double now = monotonicSeconds();
+    if (now - lastSync >= SYNC_INTERVAL_S) {
+      _live.sync();
+      if (_batch.isOpen()) _batch.sync();
+      lastSync = now;
+    }
+    publishStats();
+    if (worked) continue;
+    if (_stop) break;
+
+    // Sleep until the producer pushes, the next sync, or stop()
+    _sleeping.store(true, std::memory_order_seq_cst);
+    if (_tail.load(std::memory_order_seq_cst) == _head.load(std::memory_order_relaxed) && !_stop) {
+      const int timeoutMs = std::max(1, (int)((lastSync + SYNC_INTERVAL_S - now) * 1000));
+      pollfd p = { _wakeFd, POLLIN, 0 };
+      if (poll(&p, 1, std::min(timeoutMs, 100)) > 0) {
+        uint64_t count;
+        if (read(_wakeFd, &count, sizeof(count)) < 0) {
+          // drained by an earlier read
+        }
+      }
+    }
+    _sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  closeBatch();
+  _live.close();
+  _io.close();
+  _layout.reset();
+  publishStats();
+}
+
+bool StoreWriter::drainQueue() {
+  uint64_t head = _head.load(std::memory_order_relaxed);
+  const uint64_t tail = _tail.load(std::memory_order_acquire);
+  if (head == tail) return false;
+  while (head != tail) {
+    const size_t at = (size_t)(head & _mask);
+    Entry e;
+    memcpy(&e, &_queue[at], sizeof(e));
+    if (e.kind != WRAP) {
+      handle(e, &_queue[at + sizeof(e)]);
+    }
+    head += e.bytes;
+    // Hand the space back entry by entry: a long append (a sealed block, a
+    // slow page fault) should not hold up the rest of the queue's room
+    _head.store(head, std::memory_order_release);
+  }
+  return true;
+}
+
+CaptureStore::Writer* StoreWriter::target(Kind kind) {
+  if (kind == LIVE || kind == LIVE_RAW) return &_live;
+  if (!_batch.isOpen()) {
+    char name[32];
+    snprintf(name, sizeof(name), "/batch_%04u", _batchNumber);
+    if (!_batch.create(_batchesDir + name, _channels, _storeFlags)) {
+      _errors++;
+      fprintf(stderr, "[Writer] %s\n", _batch.error().c_str());
+      return nullptr;
+    }
+  }
+  return &_batch;
+}
+
+void StoreWriter::handle(const Entry& e, const uint8_t* payload) {
+  switch (e.kind) {
+  case LIVE:
+  case COLLECTED: {
+    CaptureStore::Writer* w = target((Kind)e.kind);
+    if (!w) break;
+    if (w->append(reinterpret_cast<const CaptureStore::Record*>(payload), e.count)) {
+      _written += e.count;
+    } else {
+      _errors++;
+      fprintf(stderr, "[Writer] %s\n", w->error().c_str());
+    }
+    break;
+  }
+  case LIVE_RAW:
+  case COLLECTED_RAW: {
+    CaptureStore::Writer* w = target((Kind)e.kind);
+    if (!w) break;
+    // Decoded straight into the mapped columns
+    BlockCodec::ColumnsOut out;
+    if (w->reserve(e.count, out)) {
+      _layout->decodeColumns(payload, (size_t)e.count * _layout->sampleBytes(), out);
+      w->commit(e.count);
+      _written += e.count;
+    } else {
+      _errors++;
+      fprintf(stderr, "[Writer] %s\n", w->error().c_str());
+    }
+    break;
+  }
+  case LAYOUT: {
+    std::shared_ptr<const SchemaDecoder>* layout =
+        reinterpret_cast<std::shared_ptr<const SchemaDecoder>*>(const_cast<uint8_t*>(payload));
+    _layout = std::move(*layout);
+    layout->~shared_ptr();
+    break;
+  }
+  case BATCH_END:
+    closeBatch();
+    break;
+  default:
+    break;
+  }
+}
+
+void StoreWriter::closeBatch() {
+  if (!_batch.isOpen()) return;
+  printf("[Writer] batch_%04u complete: %llu samples\n", _batchNumber, (unsigned long long)_batch.size());
+  fflush(stdout);
+  _batch.close();
+  _batchNumber++;
+  _batches++;
+}
+
+void StoreWriter::publishStats() {
+  std::lock_guard<std::mutex> lock(_statsMutex);
+  _shared.written = _written;
+  _shared.liveRows = _live.isOpen() ? _live.size() : _shared.liveRows;
+  _shared.batches = _batches;
+  _shared.errors = _errors;
+  _shared.ioUring = _io.usingUring();
+  _shared.io = _io.stats();
+}
+
+StoreWriter::Stats StoreWriter::stats() const {
+  Stats s;
+  {
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    s = _shared;
+  }
+  s.packets = _packets.load(std::memory_order_relaxed);
+  s.samples = _samples.load(std::memory_order_relaxed);
+  s.dropped = _dropped.load(std::memory_order_relaxed);
+  s.droppedSamples = _droppedSamples.load(std::memory_order_relaxed);
+  s.queueBytes = _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_relaxed);
+  s.maxQueueBytes = _maxQueueBytes.load(std::memory_order_relaxed);
+  return s;
+}
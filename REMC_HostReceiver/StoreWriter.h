@@ -0,0 +1,172 @@
+/*
+  ---------------------------------------------------------------------------
+  StoreWriter – Writer Stage between the Receive Loop and CaptureStore (host)
+  ---------------------------------------------------------------------------
+
+  Appending to a CaptureStore touches the disk: mapped column pages fault
+  in and get throttled under writeback, sealed blocks are encoded and
+  written, batch stores are created and synced shut. Done on the thread
+  that reads the socket, every disk hiccup during a collect dump is time
+  the socket is not read, and the kernel drops datagrams.
+
+  StoreWriter moves all of it to its own thread. The receive loop hands
+  packets over through a lock-free single-producer/single-consumer byte
+  queue (`queueBytes`, fixed at start()); the calls never block and never
+  allocate. A packet that does not fit is dropped and counted, so the
+  queue is also the bound on memory held for a slow disk.
+
+  A packet goes in either as decoded Records or as its raw sample payload
+  with the SchemaDecoder of its layout. Raw payloads take half the queue
+  (42 bytes a sample instead of a Record's 88), and the writer thread
+  decodes them with decodeColumns() straight into the store's mapped
+  columns (CaptureStore Writer::reserve()), with no Record in between. The
+  layout is queued once when it changes and then held by the writer
+  thread, so the producer's decoder may be dropped at any time.
+
+  The writer thread owns the stores:
+
+    <store>/live/                  live packets, appended across runs
+    <store>/batches/batch_NNNN/    collected packets, one store per dump,
+                                   closed at endBatch()
+
+  and an IoRing (IoRing.h): sealed blocks, summaries and index entries are
+  written through io_uring (pwrite where unavailable) with bounded memory
+  in flight, and every SYNC_INTERVAL_S both stores are fdatasync'ed, so a
+  crash loses at most about that much of what was received.
+
+  Producer calls (append*, endBatch) from one thread; stats() from any.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef STORE_WRITER_H
+#define STORE_WRITER_H
+
+#include "CaptureStore.h"
+#include "IoRing.h"
+#include "SchemaDecoder.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StoreWriter {
+public:
+  static const size_t DEFAULT_QUEUE_BYTES = 16u << 20;   // ~18 s of 10 kHz Records, ~38 s raw
+  static const size_t MAX_PACKET_SAMPLES = 256;
+  static const double SYNC_INTERVAL_S;
+
+  struct Stats {
+    uint64_t packets;        // queued
+    uint64_t samples;
+    uint64_t dropped;        // packets not queued, queue full
+    uint64_t droppedSamples;
+    uint64_t queueBytes;     // waiting for the writer now
+    uint64_t maxQueueBytes;
+    uint64_t written;        // samples appended to a store
+    uint64_t liveRows;
+    uint64_t batches;        // batch stores closed
+    uint64_t errors;         // failed appends and store creations
+    bool ioUring;            // false: synchronous pwrite/fdatasync
+    IoRing::Stats io;
+  };
+
+  StoreWriter();
+  ~StoreWriter();
+
+  // One writer per node (NodeDemux) lives on the heap; keep the queue
+  // indices on their own cache lines there too (new ignores alignas before C++17)
+  static void* operator new(size_t bytes);
+  static void operator delete(void* p);
+
+  // Opens (or creates, with storeFlags) <storeDir>/live here, so a bad
+  // directory fails now; batch stores are created by the writer thread
+  bool start(const std::string& storeDir, const std::vector<std::string>& channels,
+             uint32_t storeFlags = CaptureStore::STORE_COMPRESSED, size_t queueBytes = DEFAULT_QUEUE_BYTES,
+             bool useIoUring = true);
+  // Writes out everything queued, closes the stores
+  void stop();
+  bool running() const { return _thread.joinable(); }
+
+  // Receive loop; false if the packet was dropped
+  bool appendLive(const CaptureStore::Record* r, size_t n);
+  bool appendCollected(const CaptureStore::Record* r, size_t n);
+  // `payload` holds n whole samples of `layout` (as checked by its decode)
+  bool appendLive(const std::shared_ptr<const SchemaDecoder>& layout, const uint8_t* payload, size_t n);
+  bool appendCollected(const std::shared_ptr<const SchemaDecoder>& layout, const uint8_t* payload, size_t n);
+  bool endBatch();
+
+  // Before start(): runs before every write or sync the writer issues
+  void setIssueHook(std::function<void()> hook) { _issueHook = hook; }
+
+  Stats stats() const;
+  const std::string& error() const { return _error; }
+
+private:
+  enum Kind : uint8_t { WRAP, LIVE, COLLECTED, BATCH_END, LAYOUT, LIVE_RAW, COLLECTED_RAW };
+
+  struct Entry {
+    uint32_t bytes;          // header and payload, multiple of 8
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t count;          // records or samples
+  };
+
+  // Room for an entry of `bytes` payload (nullptr if full); push() makes it visible
+  uint8_t* claim(Kind kind, size_t bytes, size_t count);
+  void push();
+  bool push(Kind kind, const void* payload, size_t bytes, size_t count);
+  bool appendPacket(Kind kind, const CaptureStore::Record* r, size_t n);
+  bool appendRaw(Kind kind, const std::shared_ptr<const SchemaDecoder>& layout, const uint8_t* payload, size_t n);
+  void run();
+  bool drainQueue();
+  void handle(const Entry& e, const uint8_t* payload);
+  CaptureStore::Writer* target(Kind kind);
+  void closeBatch();
+  void publishStats();
+
+  std::string _storeDir;
+  std::string _batchesDir;
+  std::vector<std::string> _channels;
+  uint32_t _storeFlags;
+  std::string _error;
+  std::function<void()> _issueHook;
+
+  // Queue: _tail written by the producer, _head by the writer thread
+  std::vector<uint8_t> _queue;
+  uint64_t _mask;
+  alignas(64) std::atomic<uint64_t> _tail;
+  alignas(64) std::atomic<uint64_t> _head;
+  alignas(64) std::atomic<bool> _sleeping;
+  int _wakeFd;
+  bool _endPending;          // producer: endBatch() did not fit yet
+  const SchemaDecoder* _queuedLayout;   // producer: last LAYOUT pushed
+  uint64_t _claimed;         // producer: tail after the claimed entry
+  std::atomic<uint64_t> _packets;
+  std::atomic<uint64_t> _samples;
+  std::atomic<uint64_t> _dropped;
+  std::atomic<uint64_t> _droppedSamples;
+  std::atomic<uint64_t> _maxQueueBytes;
+
+  // Writer thread
+  std::thread _thread;
+  std::atomic<bool> _stop;
+  IoRing _io;
+  CaptureStore::Writer _live;
+  CaptureStore::Writer _batch;
+  std::shared_ptr<const SchemaDecoder> _layout;   // of the raw entries that follow
+  unsigned _batchNumber;
+  uint64_t _written;
+  uint64_t _batches;
+  uint64_t _errors;
+
+  mutable std::mutex _statsMutex;
+  Stats _shared;             // writer-thread fields, as of its last pass
+};
+
+#endif // STORE_WRITER_H
@@ -0,0 +1,332 @@
+#include "TimingAnalyzer.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+const size_t SUB_COUNT = (size_t)1 << TimingAnalyzer::Histogram::SUB_BITS;
+const size_t HALF_COUNT = SUB_COUNT / 2;
+const size_t BUCKETS = SUB_COUNT + (64 - TimingAnalyzer::Histogram::SUB_BITS) * HALF_COUNT;
+
+// 1234567 -> "1,234,567", like the scripts' f"{n:,}"
+std::string grouped(uint64_t n) {
+  std::string s = std::to_string(n);
+  for (int i = (int)s.size() - 3; i > 0; i -= 3) s.insert((size_t)i, ",");
+  return s;
+}
+
+double percentOf(uint64_t n, uint64_t total) {
+  return total ? 100.0 * n / total : 0.0;
+}
+
+bool smaller(const TimingAnalyzer::Event& a, const TimingAnalyzer::Event& b) {
+  return a.valueUs > b.valueUs;   // min-heap on valueUs
+}
+
+}  // namespace
+
+// ---------------- Histogram ----------------
+
+TimingAnalyzer::Histogram::Histogram() : _buckets(BUCKETS, 0) {
+  clear();
+}
+
+void TimingAnalyzer::Histogram::clear() {
+  std::fill(_buckets.begin(), _buckets.end(), 0);
+  _count = 0;
+  _sum = 0;
+  _sumSq = 0;
+  _min = UINT64_MAX;
+  _max = 0;
+}
+
+size_t TimingAnalyzer::Histogram::index(uint64_t v) {
+  if (v < SUB_COUNT) return (size_t)v;
+  // Top SUB_BITS - 1 bits below the leading one select the sub-bucket
+  const unsigned shift = (unsigned)(63 - __builtin_clzll(v)) - (SUB_BITS - 1);
+  return SUB_COUNT + (shift - 1) * HALF_COUNT + (size_t)(v >> shift) - HALF_COUNT;
+}
+
+void TimingAnalyzer::Histogram::range(size_t idx, uint64_t& lo, uint64_t& hi) {
+  if (idx < SUB_COUNT) {
+    lo = hi = idx;
+    return;
+  }
+  const size_t k = idx - SUB_COUNT;
+  const unsigned shift = (unsigned)(k / HALF_COUNT) + 1;
+  lo = (uint64_t)(k % HALF_COUNT + HALF_COUNT) << shift;
+  hi = lo + ((uint64_t)1 << shift) - 1;
+}
+
+void TimingAnalyzer::Histogram::add(uint64_t v) {
+  _buckets[index(v)]++;
+  _count++;
+  const double d = (double)v;
+  _sum += d;
+  _sumSq += d * d;
+  if (v < _min) _min = v;
+  if (v > _max) _max = v;
+}
+
+double TimingAnalyzer::Histogram::stddev() const {
+  if (_count == 0) return 0.0;
+  const double m = _sum / _count;
+  const double var = _sumSq / _count - m * m;
+  return var > 0 ? sqrt(var) : 0.0;
+}
+
+double TimingAnalyzer::Histogram::percentile(double q) const {
+  if (_count == 0) return 0.0;
+  uint64_t rank = (uint64_t)ceil(q * _count);
+  rank = std::max<uint64_t>(1, std::min<uint64_t>(rank, _count));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < _buckets.size(); ++i) {
+    seen += _buckets[i];
+    if (seen >= rank) {
+      uint64_t lo, hi;
+      range(i, lo, hi);
+      const double mid = lo == hi ? (double)lo : (lo + (double)(hi - lo) / 2);
+      return std::max((double)_min, std::min((double)_max, mid));
+    }
+  }
+  return (double)_max;
+}
+
+uint64_t TimingAnalyzer::Histogram::countOutside(double lo, double hi) const {
+  uint64_t n = 0;
+  for (size_t i = 0; i < _buckets.size(); ++i) {
+    if (!_buckets[i]) continue;
+    uint64_t a, b;
+    range(i, a, b);
+    const double v = a == b ? (double)a : (a + (double)(b - a) / 2);
+    if (v < lo || v > hi) n += _buckets[i];
+  }
+  return n;
+}
+
+uint64_t TimingAnalyzer::Histogram::countAtLeast(double v) const {
+  return _count - countOutside(v - 0.5, HUGE_VAL);
+}
+
+void TimingAnalyzer::Histogram::bins(double lo, double width, size_t n, uint64_t* out, uint64_t& below,
+                                     uint64_t& above) const {
+  memset(out, 0, n * sizeof(uint64_t));
+  below = above = 0;
+  for (size_t i = 0; i < _buckets.size(); ++i) {
+    if (!_buckets[i]) continue;
+    uint64_t a, b;
+    range(i, a, b);
+    const double v = a == b ? (double)a : (a + (double)(b - a) / 2);
+    if (v < lo) {
+      below += _buckets[i];
+      continue;
+    }
+    const size_t k = (size_t)((v - lo) / width);
+    if (k >= n) above += _buckets[i];
+    else out[k] += _buckets[i];
+  }
+}
+
+// ---------------- TimingAnalyzer ----------------
+
+TimingAnalyzer::TimingAnalyzer(const Config& cfg) : _cfg(cfg) {
+  _inLo = cfg.expectedUs - cfg.toleranceUs;
+  _inHi = cfg.expectedUs + cfg.toleranceUs;
+  _dev10Us = 0.1 * cfg.expectedUs;
+  _dev50Us = 0.5 * cfg.expectedUs;
+  _gapUs = 2.0 * cfg.expectedUs;
+  clear();
+}
+
+void TimingAnalyzer::clear() {
+  _samples = 0;
+  _lastUs = 0;
+  _intervals.clear();
+  _durations.clear();
+  _inRange = _dev10 = _dev50 = _gaps = _backwards = 0;
+  _invalidDurations = _zeroDurations = 0;
+  _jitters.clear();
+  _gapHeap.clear();
+  _durationHeap.clear();
+  _backwardList.clear();
+}
+
+void TimingAnalyzer::keepLargest(std::vector<Event>& heap, size_t limit, const Event& e) {
+  if (limit == 0) return;
+  if (heap.size() < limit) {
+    heap.push_back(e);
+    std::push_heap(heap.begin(), heap.end(), smaller);
+  } else if (e.valueUs > heap.front().valueUs) {
+    std::pop_heap(heap.begin(), heap.end(), smaller);
+    heap.back() = e;
+    std::push_heap(heap.begin(), heap.end(), smaller);
+  }
+}
+
+void TimingAnalyzer::addInterval(uint64_t row, uint64_t tUs, int64_t d) {
+  if (d < 0) {
+    _backwards++;
+    if (_backwardList.size() < _cfg.listSize) _backwardList.push_back(Event{ row, tUs, d });
+    return;
+  }
+  _intervals.add((uint64_t)d);
+  const double x = (double)d;
+  if (x >= _inLo && x <= _inHi) _inRange++;
+  const double dev = fabs(x - _cfg.expectedUs);
+  if (dev > _dev10Us) {
+    _dev10++;
+    if (dev > _dev50Us) {
+      _dev50++;
+      if (_jitters.size() < _cfg.listSize) _jitters.push_back(Event{ row, tUs, d });
+    }
+  }
+  if (x > _gapUs) {
+    _gaps++;
+    keepLargest(_gapHeap, _cfg.listSize, Event{ row, tUs, d });
+  }
+}
+
+void TimingAnalyzer::addDuration(uint64_t row, uint64_t tUs, int64_t d) {
+  if (d < 0) {
+    _invalidDurations++;
+    return;
+  }
+  _durations.add((uint64_t)d);
+  if (d == 0) _zeroDurations++;
+  if (_durationHeap.size() < _cfg.listSize || d > _durationHeap.front().valueUs) {
+    keepLargest(_durationHeap, _cfg.listSize, Event{ row, tUs, d });
+  }
+}
+
+double TimingAnalyzer::inRangePercent() const {
+  return percentOf(_inRange, _intervals.count());
+}
+
+std::vector<TimingAnalyzer::Event> TimingAnalyzer::largestGaps() const {
+  std::vector<Event> v(_gapHeap);
+  std::sort(v.begin(), v.end(), [](const Event& a, const Event& b) { return a.valueUs > b.valueUs; });
+  return v;
+}
+
+std::vector<TimingAnalyzer::Event> TimingAnalyzer::longestDurations() const {
+  std::vector<Event> v(_durationHeap);
+  std::sort(v.begin(), v.end(), [](const Event& a, const Event& b) { return a.valueUs > b.valueUs; });
+  return v;
+}
+
+// ---------------- reports ----------------
+
+void TimingAnalyzer::printIntervals(FILE* out, bool histogram) const {
+  const Histogram& h = _intervals;
+  const double mean = h.mean(), sd = h.stddev(), expected = _cfg.expectedUs;
+  fprintf(out, "SAMPLE INTERVALS\n");
+  fprintf(out, "  samples            %s (%s intervals, %s backwards)\n", grouped(_samples).c_str(),
+          grouped(h.count()).c_str(), grouped(_backwards).c_str());
+  if (h.count() == 0) return;
+  fprintf(out, "  expected           %.1f µs\n", expected);
+  fprintf(out, "  mean               %.3f µs (%.3f µs from expected)\n", mean, fabs(mean - expected));
+  fprintf(out, "  std dev            %.3f µs, 2σ bounds %.1f - %.1f µs\n", sd, mean - 2 * sd, mean + 2 * sd);
+  fprintf(out, "  min / max          %llu / %llu µs\n", (unsigned long long)h.min(), (unsigned long long)h.max());
+  fprintf(out, "  percentiles        p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  p99.99 %.0f µs\n",
+          h.percentile(0.5), h.percentile(0.9), h.percentile(0.99), h.percentile(0.999), h.percentile(0.9999));
+  fprintf(out, "  within %.0f-%.0f µs   %s (%.2f %%), outside %s (%.2f %%)\n", _inLo, _inHi,
+          grouped(_inRange).c_str(), inRangePercent(), grouped(h.count() - _inRange).c_str(),
+          100.0 - inRangePercent());
+  const uint64_t sigma2 = h.countOutside(mean - 2 * sd, mean + 2 * sd);
+  fprintf(out, "  > 2σ from mean     %s\n", grouped(sigma2).c_str());
+  fprintf(out, "  > 10%% from expected %s (%.2f %%)\n", grouped(_dev10).c_str(), percentOf(_dev10, h.count()));
+  fprintf(out, "  > 50%% from expected %s (%.2f %%)\n", grouped(_dev50).c_str(), percentOf(_dev50, h.count()));
+  fprintf(out, "  gaps > %.0f µs      %s (%.2f %%)\n", _gapUs, grouped(_gaps).c_str(), percentOf(_gaps, h.count()));
+
+  if (histogram) {
+    static const size_t BINS = 21;
+    uint64_t bins[BINS], below, above;
+    const double lo = floor(expected) - 10;
+    h.bins(lo, 1.0, BINS, bins, below, above);
+    uint64_t peak = std::max(below, above);
+    for (size_t i = 0; i < BINS; ++i) peak = std::max(peak, bins[i]);
+    const auto bar = [&](const char* label, uint64_t n) {
+      const int w = peak ? (int)(50.0 * n / peak + 0.5) : 0;
+      fprintf(out, "    %8s %12s %6.2f %% %.*s\n", label, grouped(n).c_str(), percentOf(n, h.count()), w,
+              "##################################################");
+    };
+    fprintf(out, "  histogram (1 µs bins)\n");
+    char label[24];
+    snprintf(label, sizeof(label), "< %.0f", lo);
+    bar(label, below);
+    for (size_t i = 0; i < BINS; ++i) {
+      snprintf(label, sizeof(label), "%.0f", lo + i);
+      bar(label, bins[i]);
+    }
+    snprintf(label, sizeof(label), ">= %.0f", lo + BINS);
+    bar(label, above);
+  }
+  if (!_jitters.empty()) {
+    fprintf(out, "  first large jitters (> 50 %%):\n");
+    for (const Event& e : _jitters) {
+      const double dev = e.valueUs - expected;
+      fprintf(out, "    sample %s: %lld µs (deviation %+.1f µs, %+.1f %%)\n", grouped(e.row).c_str(),
+              (long long)e.valueUs, dev, 100.0 * dev / expected);
+    }
+    if (_dev50 > _jitters.size()) {
+      fprintf(out, "    ... and %s more\n", grouped(_dev50 - _jitters.size()).c_str());
+    }
+  }
+  if (_gaps) {
+    fprintf(out, "  largest gaps:\n");
+    for (const Event& e : largestGaps()) {
+      fprintf(out, "    sample %s: %lld µs (%.1f ms) at t_us %llu\n", grouped(e.row).c_str(), (long long)e.valueUs,
+              e.valueUs / 1000.0, (unsigned long long)e.tUs);
+    }
+  }
+  if (!_backwardList.empty()) {
+    fprintf(out, "  first backward steps:\n");
+    for (const Event& e : _backwardList) {
+      fprintf(out, "    sample %s: %lld µs at t_us %llu\n", grouped(e.row).c_str(), (long long)e.valueUs,
+              (unsigned long long)e.tUs);
+    }
+  }
+}
+
+void TimingAnalyzer::printDurations(FILE* out) const {
+  const Histogram& h = _durations;
+  fprintf(out, "SAMPLE DURATIONS\n");
+  fprintf(out, "  samples            %s with an end time, %s invalid (negative)\n", grouped(h.count()).c_str(),
+          grouped(_invalidDurations).c_str());
+  if (h.count() == 0) return;
+  const double mean = h.mean(), sd = h.stddev();
+  fprintf(out, "  mean / median      %.3f / %.3f µs\n", mean, h.percentile(0.5));
+  fprintf(out, "  std dev            %.3f µs, 3σ upper bound %.3f µs\n", sd, mean + 3 * sd);
+  fprintf(out, "  min / max          %llu / %llu µs\n", (unsigned long long)h.min(), (unsigned long long)h.max());
+  fprintf(out, "  percentiles        p90 %.0f  p99 %.0f  p99.9 %.0f  p99.99 %.0f µs\n", h.percentile(0.9),
+          h.percentile(0.99), h.percentile(0.999), h.percentile(0.9999));
+  const uint64_t at1 = h.countAtLeast(1), at10 = h.countAtLeast(10), at100 = h.countAtLeast(100);
+  fprintf(out, "  >= 1 / 10 / 100 µs %s (%.1f %%) / %s (%.1f %%) / %s (%.1f %%)\n", grouped(at1).c_str(),
+          percentOf(at1, h.count()), grouped(at10).c_str(), percentOf(at10, h.count()), grouped(at100).c_str(),
+          percentOf(at100, h.count()));
+  const uint64_t outliers = h.countOutside(-1.0, mean + 3 * sd);
+  fprintf(out, "  outliers > 3σ      %s (%.1f %%)\n", grouped(outliers).c_str(), percentOf(outliers, h.count()));
+  fprintf(out, "  zero durations     %s (%.1f %%)\n", grouped(_zeroDurations).c_str(),
+          percentOf(_zeroDurations, h.count()));
+  if (outliers) {
+    fprintf(out, "  longest:\n");
+    for (const Event& e : longestDurations()) {
+      if (e.valueUs <= mean + 3 * sd) break;
+      fprintf(out, "    sample %s: %lld µs (%.3f ms)\n", grouped(e.row).c_str(), (long long)e.valueUs,
+              e.valueUs / 1000.0);
+    }
+  }
+}
+
+void TimingAnalyzer::printLine(FILE* out, const char* prefix) const {
+  const Histogram& h = _intervals;
+  fprintf(out, "%s%s samples  interval mean %.3f σ %.3f µs  in range %.2f %%  p99 %.0f max %llu µs  "
+               "gaps %llu  backwards %llu  duration p99 %.0f µs\n",
+          prefix, grouped(_samples).c_str(), h.mean(), h.stddev(), inRangePercent(), h.percentile(0.99),
+          (unsigned long long)(h.count() ? h.max() : 0), (unsigned long long)_gaps,
+          (unsigned long long)_backwards, _durations.percentile(0.99));
+}
@@ -0,0 +1,149 @@
+/*
+  ---------------------------------------------------------------------------
+  TimingAnalyzer – One-Pass Sample Interval and Duration Statistics (host)
+  ---------------------------------------------------------------------------
+
+  The C++ counterpart of timing_analysis/analyze_sample_frequency.py and
+  analyze_sample_duration.py. Samples are fed in order, one at a time, and
+  memory stays constant whatever the length of the capture:
+
+    interval   t_us[i] - t_us[i-1]
+    duration   t_us_end[i] - t_us[i] (samples that have an end time)
+
+  Each goes into a Histogram: log-linear buckets (HDR histogram style),
+  exact for every value below 2^SUB_BITS µs and within 1/1024 above, so
+  the percentiles, the median and the σ-based counts the scripts print
+  (intervals more than 2σ from the mean, durations above mean + 3σ) are
+  computed from the buckets after the pass instead of from an array of
+  every value. Sums for the mean and σ are kept alongside.
+
+  The README's headline number – the share of intervals within
+  expected ± tolerance (98–102 µs) – and the fixed-threshold counts (10 %,
+  50 % deviation, gaps over 2x) are counted while streaming. The lists are
+  bounded: the first `listSize` large jitters, the `listSize` largest gaps
+  and the `listSize` longest durations. An interval that goes backwards
+  (out-of-order rows) is counted and listed but kept out of the statistics.
+
+  Not thread-safe; one analyzer per stream.
+  ---------------------------------------------------------------------------
+*/
+
+#ifndef TIMING_ANALYZER_H
+#define TIMING_ANALYZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <vector>
+
+class TimingAnalyzer {
+public:
+  struct Config {
+    double expectedUs;       // nominal interval
+    double toleranceUs;      // in range: |interval - expected| <= tolerance
+    size_t listSize;         // entries per jitter / gap / duration list
+  };
+  static Config defaultConfig() { return Config{ 100.0, 2.0, 20 }; }
+
+  // Non-negative integer values, µs
+  class Histogram {
+  public:
+    static const unsigned SUB_BITS = 11;
+
+    Histogram();
+    void add(uint64_t v);
+    void clear();
+
+    uint64_t count() const { return _count; }
+    double mean() const { return _count ? _sum / _count : 0.0; }
+    double stddev() const;                 // population, like numpy.std
+    uint64_t min() const { return _min; }
+    uint64_t max() const { return _max; }
+    double percentile(double q) const;     // q in [0, 1]
+    // Values v with v < lo or v > hi
+    uint64_t countOutside(double lo, double hi) const;
+    uint64_t countAtLeast(double v) const;
+    // Count in [lo, hi] per bucket of `width` µs, for the text histogram
+    void bins(double lo, double width, size_t n, uint64_t* out, uint64_t& below, uint64_t& above) const;
+
+  private:
+    static size_t index(uint64_t v);
+    static void range(size_t idx, uint64_t& lo, uint64_t& hi);
+
+    std::vector<uint64_t> _buckets;
+    uint64_t _count;
+    double _sum;
+    double _sumSq;
+    uint64_t _min;
+    uint64_t _max;
+  };
+
+  struct Event {
+    uint64_t row;            // index of the later sample of the pair
+    uint64_t tUs;
+    int64_t valueUs;         // interval or duration
+  };
+
+  explicit TimingAnalyzer(const Config& cfg = defaultConfig());
+
+  // tUsEnd is ignored unless hasEnd
+  inline void add(uint64_t tUs, uint64_t tUsEnd, bool hasEnd);
+  void clear();
+
+  uint64_t samples() const { return _samples; }
+  const Histogram& intervals() const { return _intervals; }
+  const Histogram& durations() const { return _durations; }
+  uint64_t inRange() const { return _inRange; }
+  double inRangePercent() const;
+  uint64_t deviation10() const { return _dev10; }   // |interval - expected| > 10 %
+  uint64_t deviation50() const { return _dev50; }   // > 50 %
+  uint64_t gaps() const { return _gaps; }          // interval > 2x expected
+  uint64_t backwards() const { return _backwards; }
+  uint64_t invalidDurations() const { return _invalidDurations; }
+  uint64_t zeroDurations() const { return _zeroDurations; }
+
+  const std::vector<Event>& firstJitters() const { return _jitters; }
+  std::vector<Event> largestGaps() const;      // largest first
+  std::vector<Event> longestDurations() const;
+  const std::vector<Event>& firstBackwards() const { return _backwardList; }
+
+  // The scripts' report sections; histogram adds 1 µs bins around expected
+  void printIntervals(FILE* out, bool histogram = false) const;
+  void printDurations(FILE* out) const;
+  // One status line (live mode)
+  void printLine(FILE* out, const char* prefix) const;
+
+private:
+  void addInterval(uint64_t row, uint64_t tUs, int64_t d);
+  void addDuration(uint64_t row, uint64_t tUs, int64_t d);
+  static void keepLargest(std::vector<Event>& heap, size_t limit, const Event& e);
+
+  Config _cfg;
+  double _inLo, _inHi;       // in-range bounds
+  double _dev10Us, _dev50Us, _gapUs;
+  uint64_t _samples;
+  uint64_t _lastUs;
+  Histogram _intervals;
+  Histogram _durations;
+  uint64_t _inRange;
+  uint64_t _dev10;
+  uint64_t _dev50;
+  uint64_t _gaps;
+  uint64_t _backwards;
+  uint64_t _invalidDurations;
+  uint64_t _zeroDurations;
+  std::vector<Event> _jitters;
+  std::vector<Event> _gapHeap;        // min-heap on valueUs
+  std::vector<Event> _durationHeap;
+  std::vector<Event> _backwardList;
+};
+
+inline void TimingAnalyzer::add(uint64_t tUs, uint64_t tUsEnd, bool hasEnd) {
+  const uint64_t row = _samples++;
+  if (row > 0) addInterval(row, tUs, (int64_t)(tUs - _lastUs));
+  _lastUs = tUs;
+  if (hasEnd) addDuration(row, tUs, (int64_t)(tUsEnd - tUs));
+}
+
+#endif // TIMING_ANALYZER_H
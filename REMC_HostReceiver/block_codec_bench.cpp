@@ -0,0 +1,244 @@
+/*
+  block_codec_bench – compression ratio and speed of BlockCodec
+
+  Usage:
+    block_codec_bench [blocks]           synthetic idle and shot profiles
+    block_codec_bench --store DIR        the sealed blocks of a recorded store
+
+  Synthetic rows follow the device: 12-bit ADC counts times the
+  ChannelTable scale plus offset as float32, a 100 µs period with a few
+  µs of timer jitter and an occasional dropped packet (33-row gap).
+
+    idle   channels sit at a level with ±2 counts of noise
+    shot   a charge ramp, a discharge with ringing and a recovery, on a
+           ~0.4 s cycle, plus noise
+
+  Each block is encoded and decoded in full (and t_us and one channel on
+  their own) and compared bit for bit. Reports bytes/row and ratio per
+  column, encode MB/s and decode GB/s of raw column bytes produced.
+*/
+
+#include "BlockCodec.h"
+#include "CaptureStore.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static const size_t ROWS = CaptureStore::BLOCK_SAMPLES;
+static const size_t CHANNELS = CaptureStore::DEFAULT_CHANNEL_COUNT;
+
+// ChannelTable.h kAnalogChannels
+static const float SCALE[CHANNELS] = { 0.004449458233f, 1000.0f / 4095.0f, 0.004447667531f, 0.004445948727f,
+                                       100.0f / 4095.0f };
+static const float OFFSET[CHANNELS] = { -8.939881545f, -471.551f, -8.941615805f, -8.936364074f, -5.5f };
+
+// Column-major rows of one block
+struct Block {
+  std::vector<uint64_t> t;
+  std::vector<uint16_t> dur;
+  std::vector<float> ch[CHANNELS];
+  std::vector<uint8_t> status;
+
+  Block() : t(ROWS), dur(ROWS), status(ROWS) {
+    for (std::vector<float>& c : ch) c.resize(ROWS);
+  }
+
+  BlockCodec::ColumnsIn in() const {
+    BlockCodec::ColumnsIn in;
+    memset(&in, 0, sizeof(in));
+    in.t = t.data();
+    in.dur = dur.data();
+    for (size_t c = 0; c < CHANNELS; ++c) in.ch[c] = ch[c].data();
+    in.status = status.data();
+    in.channels = CHANNELS;
+    return in;
+  }
+
+  BlockCodec::ColumnsOut out() {
+    BlockCodec::ColumnsOut out;
+    memset(&out, 0, sizeof(out));
+    out.t = t.data();
+    out.dur = dur.data();
+    for (size_t c = 0; c < CHANNELS; ++c) out.ch[c] = ch[c].data();
+    out.status = status.data();
+    return out;
+  }
+
+  bool operator==(const Block& o) const {
+    if (t != o.t || dur != o.dur || status != o.status) return false;
+    for (size_t c = 0; c < CHANNELS; ++c) {
+      if (memcmp(ch[c].data(), o.ch[c].data(), ROWS * sizeof(float)) != 0) return false;
+    }
+    return true;
+  }
+};
+
+static float adc(size_t c, int counts) {
+  if (counts < 0) counts = 0;
+  if (counts > 4095) counts = 4095;
+  return (float)counts * SCALE[c] + OFFSET[c];
+}
+
+static std::vector<Block> synthetic(bool shot, size_t blocks) {
+  std::mt19937 rng(shot ? 2 : 1);
+  std::uniform_int_distribution<int> noise(-2, 2);
+  std::uniform_int_distribution<int> jitter(-3, 3);
+  std::uniform_int_distribution<int> drop(0, 2999);
+  std::vector<Block> out(blocks);
+  uint64_t nominal = 1760000000000000ull;
+  uint64_t row = 0;
+  for (Block& b : out) {
+    for (size_t i = 0; i < ROWS; ++i, ++row) {
+      if (drop(rng) == 0) nominal += 33 * 100;  // lost packet
+      nominal += 100;
+      b.t[i] = nominal + jitter(rng);
+      b.dur[i] = (uint16_t)(9 + (noise(rng) == 0));
+
+      int level[CHANNELS] = { 2010, 1931, 2011, 2010, 1200 };
+      uint8_t status = 0x01;
+      if (shot) {
+        const double phase = (double)(row % 4000) / 4000.0;  // 0.4 s cycle
+        if (phase < 0.6) {
+          level[0] += (int)(1800 * phase / 0.6);
+          level[2] = level[3] = level[0];
+          status = 0x03;
+        } else if (phase < 0.65) {
+          const double k = (phase - 0.6) / 0.05;
+          const double ring = exp(-6 * k) * cos(60 * k);
+          level[0] += (int)(1800 * ring);
+          level[1] += (int)(2000 * exp(-8 * k) * sin(40 * k));
+          level[2] = level[3] = level[0] - 3;
+          status = 0x07;
+        } else {
+          level[0] += (int)(20 * (1 - (phase - 0.65) / 0.35));
+          level[2] = level[3] = level[0];
+        }
+        level[4] += (int)(row / 40000);
+      }
+      for (size_t c = 0; c < CHANNELS; ++c) b.ch[c][i] = adc(c, level[c] + (c == 4 ? noise(rng) / 2 : noise(rng)));
+      b.status[i] = status;
+    }
+  }
+  return out;
+}
+
+static bool loadStore(const std::string& dir, std::vector<Block>& out) {
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return false;
+  }
+  if (r.channelCount() != CHANNELS) {
+    fprintf(stderr, "%s: expected %zu channels\n", dir.c_str(), CHANNELS);
+    return false;
+  }
+  for (uint64_t b = 0; b < r.sealedBlocks(); ++b) {
+    CaptureStore::BlockView v;
+    if (!r.block(b, v)) {
+      fprintf(stderr, "%s\n", r.error().c_str());
+      return false;
+    }
+    out.emplace_back();
+    Block& o = out.back();
+    memcpy(o.t.data(), v.t, ROWS * sizeof(uint64_t));
+    memcpy(o.dur.data(), v.dur, ROWS * sizeof(uint16_t));
+    for (size_t c = 0; c < CHANNELS; ++c) memcpy(o.ch[c].data(), v.ch[c], ROWS * sizeof(float));
+    memcpy(o.status.data(), v.status, ROWS);
+  }
+  return true;
+}
+
+// Encoded column sizes from a block's header
+static void columnBytes(const uint8_t* enc, uint64_t* sum) {
+  uint32_t n[BlockCodec::MAX_COLUMNS];
+  memcpy(n, enc + 4, 4 * (3 + CHANNELS));
+  for (size_t i = 0; i < 3 + CHANNELS; ++i) sum[i] += n[i];
+}
+
+static int run(const char* name, const std::vector<Block>& blocks) {
+  if (blocks.empty()) {
+    printf("%s: no sealed blocks\n", name);
+    return 0;
+  }
+  const size_t rawRowBytes = 8 + 2 + 4 * CHANNELS + 1;
+  const double rawBytes = (double)blocks.size() * ROWS * rawRowBytes;
+  const size_t cap = BlockCodec::maxEncodedBytes(ROWS, CHANNELS);
+  std::vector<std::vector<uint8_t>> enc(blocks.size());
+  uint64_t colBytes[3 + CHANNELS] = {};
+  uint64_t total = 0;
+
+  Clock::time_point t = Clock::now();
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    enc[b].resize(cap);
+    enc[b].resize(BlockCodec::encode(blocks[b].in(), ROWS, enc[b].data()));
+  }
+  const double encS = secondsSince(t);
+  for (const std::vector<uint8_t>& e : enc) {
+    columnBytes(e.data(), colBytes);
+    total += e.size();
+  }
+
+  // Full decode, then time-only and one-channel decodes, each checked
+  int failures = 0;
+  Block d;
+  BlockCodec::ColumnsOut all = d.out();
+  t = Clock::now();
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if (!BlockCodec::decode(enc[b].data(), enc[b].size(), BlockCodec::COL_ALL, all) || !(d == blocks[b])) failures++;
+  }
+  const double decS = secondsSince(t);
+
+  t = Clock::now();
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if (!BlockCodec::decode(enc[b].data(), enc[b].size(), BlockCodec::COL_T, all) || d.t != blocks[b].t) failures++;
+  }
+  const double tS = secondsSince(t);
+
+  t = Clock::now();
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if (!BlockCodec::decode(enc[b].data(), enc[b].size(), BlockCodec::colChannel(0), all) ||
+        memcmp(d.ch[0].data(), blocks[b].ch[0].data(), ROWS * sizeof(float)) != 0) {
+      failures++;
+    }
+  }
+  const double chS = secondsSince(t);
+
+  const double rows = (double)blocks.size() * ROWS;
+  printf("%s: %zu blocks, %.0f rows\n", name, blocks.size(), rows);
+  const char* cols[3 + CHANNELS] = { "t_us", "dur_us" };
+  for (size_t c = 0; c < CHANNELS; ++c) cols[2 + c] = CaptureStore::DEFAULT_CHANNELS[c];
+  cols[2 + CHANNELS] = "status";
+  const size_t widths[3 + CHANNELS] = { 8, 2, 4, 4, 4, 4, 4, 1 };
+  for (size_t i = 0; i < 3 + CHANNELS; ++i) {
+    printf("  %-22s %6.2f bytes/row  %5.1fx\n", cols[i], colBytes[i] / rows, widths[i] * rows / colBytes[i]);
+  }
+  printf("  %-22s %6.2f bytes/row  %5.1fx  (raw %zu)\n", "total", total / rows, rawBytes / total, rawRowBytes);
+  printf("  encode %7.0f MB/s   decode all %5.2f GB/s   t_us only %5.2f GB/s   one channel %5.2f GB/s\n",
+         rawBytes / encS / 1e6, rawBytes / decS / 1e9, rows * 8 / tS / 1e9, rows * 4 / chS / 1e9);
+  printf("  roundtrip %s (%d failures)\n", failures ? "FAIL" : "OK", failures);
+  return failures;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 2 && !strcmp(argv[1], "--store")) {
+    std::vector<Block> blocks;
+    if (!loadStore(argv[2], blocks)) return 1;
+    return run(argv[2], blocks) ? 1 : 0;
+  }
+  const size_t n = argc > 1 ? (size_t)strtoul(argv[1], nullptr, 10) : 500;
+  int failures = run("idle", synthetic(false, n));
+  failures += run("shot", synthetic(true, n));
+  return failures ? 1 : 0;
+}
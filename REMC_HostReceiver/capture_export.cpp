@@ -0,0 +1,73 @@
+/*
+  capture_export – CSV or binary export of a CaptureStore (CaptureExport.h)
+
+  Usage:
+    capture_export csv|bin <store> [--from T0] [--to T1] [--max-bytes N] [-o FILE]
+
+  Rows with T0 <= t_us < T1 (µs since epoch; default all) go to FILE or
+  stdout. --max-bytes keeps the newest CSV rows that fit, as the Flask
+  /download_csv does with MAX_CSV_BYTES. A summary goes to stderr.
+*/
+
+#include "CaptureExport.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+int main(int argc, char** argv) {
+  if (argc < 3 || (strcmp(argv[1], "csv") != 0 && strcmp(argv[1], "bin") != 0)) {
+    fprintf(stderr, "usage: %s csv|bin <store> [--from T0] [--to T1] [--max-bytes N] [-o FILE]\n", argv[0]);
+    return 2;
+  }
+  const CaptureExport::Format format = argv[1][0] == 'c' ? CaptureExport::Format::CSV : CaptureExport::Format::BINARY;
+  const std::string dir = argv[2];
+  uint64_t t0 = 0, t1 = UINT64_MAX, maxBytes = 0;
+  const char* outPath = nullptr;
+  for (int i = 3; i < argc; ++i) {
+    if (!strcmp(argv[i], "--from") && i + 1 < argc) t0 = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--to") && i + 1 < argc) t1 = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--max-bytes") && i + 1 < argc) maxBytes = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc) outPath = argv[++i];
+    else {
+      fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return 1;
+  }
+  uint64_t first, last;
+  r.timeRange(t0, t1, first, last);
+  if (t1 == UINT64_MAX) last = r.size();
+
+  int fd = STDOUT_FILENO;
+  if (outPath) {
+    fd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      perror(outPath);
+      return 1;
+    }
+  }
+
+  CaptureExport::Exporter exporter(r);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const bool ok = exporter.write(fd, format, first, last, maxBytes);
+  const double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (outPath) close(fd);
+  if (!ok) {
+    fprintf(stderr, "%s\n", exporter.error().c_str());
+    return 1;
+  }
+  fprintf(stderr, "%llu rows, %.1f MB in %.2f s (%.1f M rows/s)\n", (unsigned long long)exporter.stats().rows,
+          exporter.stats().bytes / 1e6, dt, dt > 0 ? exporter.stats().rows / dt / 1e6 : 0.0);
+  return 0;
+}
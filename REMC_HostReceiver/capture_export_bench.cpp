@@ -0,0 +1,119 @@
+/*
+  capture_export_bench – CSV and binary export throughput of CaptureExport
+
+  Usage:
+    capture_export_bench [samples]        synthetic store (default 5M rows, compressed)
+    capture_export_bench --store DIR      an existing store
+
+  Exports the whole store to /dev/null as CSV and as binary, three runs
+  each, and reports the best rows/s and MB/s. A 250k-row slice (one
+  collect dump) is timed on its own. The first CSV rows are printed so
+  they can be compared with a Flask download.
+*/
+
+#include "CaptureExport.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static bool makeStore(const std::string& dir, uint64_t total) {
+  std::string rm = "rm -rf '" + dir + "'";
+  if (system(rm.c_str()) != 0) return false;
+  const std::vector<std::string> channels(CaptureStore::DEFAULT_CHANNELS,
+                                          CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+  CaptureStore::Writer w;
+  if (!w.create(dir, channels, CaptureStore::STORE_COMPRESSED)) {
+    fprintf(stderr, "%s\n", w.error().c_str());
+    return false;
+  }
+  // 12-bit counts times a calibration scale, like the device sends
+  static const float SCALE[5] = { 0.004449458233f, 0.2442002442f, 0.004447667531f, 0.004445948727f, 0.02442002442f };
+  static const float OFFSET[5] = { -8.939881545f, -471.551f, -8.941615805f, -8.936364074f, -5.5f };
+  CaptureStore::Record r;
+  memset(&r, 0, sizeof(r));
+  for (uint64_t i = 0; i < total; ++i) {
+    r.tUs = 1760000000000000ull + i * 100 + (i * 7919) % 5;
+    r.tUsEnd = r.tUs + 9;
+    for (size_t c = 0; c < 5; ++c) {
+      const int counts = 2048 + (int)(1500 * sinf((float)i * 0.001f + c)) + (int)((i * 31 + c) % 5) - 2;
+      r.ch[c] = (float)counts * SCALE[c] + OFFSET[c];
+    }
+    r.status = (uint8_t)((i >> 14) & 0x3F);
+    if (!w.append(r)) {
+      fprintf(stderr, "%s\n", w.error().c_str());
+      return false;
+    }
+  }
+  w.close();
+  return true;
+}
+
+static double run(CaptureExport::Exporter& e, CaptureExport::Format f, uint64_t first, uint64_t last, int fd,
+                  uint64_t& bytes) {
+  double best = 1e30;
+  for (int k = 0; k < 3; ++k) {
+    Clock::time_point t = Clock::now();
+    if (!e.write(fd, f, first, last)) {
+      fprintf(stderr, "%s\n", e.error().c_str());
+      exit(1);
+    }
+    best = std::min(best, secondsSince(t));
+  }
+  bytes = e.stats().bytes;
+  return best;
+}
+
+int main(int argc, char** argv) {
+  std::string dir = "/tmp/capture_export_bench";
+  if (argc > 2 && !strcmp(argv[1], "--store")) {
+    dir = argv[2];
+  } else {
+    const uint64_t total = argc > 1 ? strtoull(argv[1], nullptr, 10) : 5000000ull;
+    if (!makeStore(dir, total)) return 1;
+  }
+
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return 1;
+  }
+  const int devNull = open("/dev/null", O_WRONLY);
+  CaptureExport::Exporter e(r);
+  const uint64_t n = r.size();
+  printf("store %s: %llu rows%s\n", dir.c_str(), (unsigned long long)n, r.compressed() ? ", compressed" : "");
+
+  uint64_t bytes;
+  double dt = run(e, CaptureExport::Format::CSV, 0, n, devNull, bytes);
+  printf("csv      %7.1f M rows/s  %6.0f MB/s  (%.1f bytes/row)\n", n / dt / 1e6, bytes / dt / 1e6, (double)bytes / n);
+  dt = run(e, CaptureExport::Format::BINARY, 0, n, devNull, bytes);
+  printf("binary   %7.1f M rows/s  %6.0f MB/s  (%.1f bytes/row)\n", n / dt / 1e6, bytes / dt / 1e6, (double)bytes / n);
+
+  const uint64_t slice = std::min<uint64_t>(n, 250000);
+  dt = run(e, CaptureExport::Format::CSV, n - slice, n, devNull, bytes);
+  printf("csv 250k rows in %.1f ms\n", dt * 1e3);
+
+  // A few rows for eyeballing against the Flask CSV
+  char line[CaptureExport::MAX_CSV_ROW];
+  fwrite(line, 1, e.csvHeader(line), stdout);
+  for (uint64_t b = 0; b < 1 && b < r.blockCount(); ++b) {
+    CaptureStore::BlockView v;
+    r.block(b, v);
+    for (size_t i = 0; i < 3 && i < v.rows; ++i) fwrite(line, 1, e.csvRow(v, i, line), stdout);
+  }
+  close(devNull);
+  return 0;
+}
@@ -0,0 +1,300 @@
+"""
+Read-only access to a CaptureStore directory (CaptureStore.h) from Python.
+
+Raw column files are memory-mapped and read in place. Sealed blocks of a
+compressed store (StoreHeader flags STORE_COMPRESSED) are decoded from
+blocks.dat with the BlockCodec format (BlockCodec.h) into a small block
+cache; its unsealed rows are copied into the cache rather than read in
+place, because the receiver punches them out once it has sealed them. Standard library only.
+
+    store = CaptureStoreReader('capture/live')
+    first, last = store.time_range(t0_us, t1_us)
+    for row in store.rows(first, last):
+        ...
+
+refresh() picks up rows the receiver appended since the last call.
+"""
+
+import mmap
+import os
+import struct
+from bisect import bisect_left
+from collections import OrderedDict
+
+STORE_MAGIC = b'REMCCAP1'
+STORE_VERSION = 2
+STORE_COMPRESSED = 1
+MAX_CHANNELS = 16
+CHANNEL_NAME_LEN = 32
+
+# StoreHeader: magic, version, channelCount, blockSamples, flags,
+# committed, capacity, outOfOrder, createdUnixUs, channelNames, reserved
+HEADER_FORMAT = f'<8sIIIIQQQQ{MAX_CHANNELS * CHANNEL_NAME_LEN}s64s'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+COMMITTED_OFFSET = 24
+BLOCK_INDEX_FORMAT = '<QQQII'  # tFirst, tMax, offset, bytes, flags
+DUR_NONE = 0xFFFF
+STATUS_GAP = 0x80  # status bit of a gap marker row: no data, channels NaN
+CODEC_VERSION = 1
+FRAME_VALUES = 128
+CACHE_BLOCKS = 4
+
+
+class _Bits:
+    """LSB-first bit reader over a bytes-like object (BlockCodec BitReader)."""
+
+    def __init__(self, data):
+        self.data = bytes(data) + bytes(9)
+        self.pos = 0
+
+    def get(self, n):
+        if n == 0:
+            return 0
+        byte = self.pos >> 3
+        if n > 57:
+            lo = self.get(32)
+            return lo | (self.get(n - 32) << 32)
+        v = (int.from_bytes(self.data[byte:byte + 9], 'little') >> (self.pos & 7)) & ((1 << n) - 1)
+        self.pos += n
+        return v
+
+    def align(self):
+        self.pos = (self.pos + 7) & ~7
+
+
+def _unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def _frames(bits, n):
+    out = []
+    for f in range(0, n, FRAME_VALUES):
+        width = bits.get(8)
+        out.extend(bits.get(width) for _ in range(min(FRAME_VALUES, n - f)))
+        bits.align()
+    return out
+
+
+def _decode_time(data, rows):
+    bits = _Bits(data)
+    cur = bits.get(64)
+    t = [cur]
+    if rows < 2:
+        return t
+    delta = _unzigzag(bits.get(64))
+    cur = (cur + delta) & 0xFFFFFFFFFFFFFFFF
+    t.append(cur)
+    for dd in _frames(bits, rows - 2):
+        delta += _unzigzag(dd)
+        cur = (cur + delta) & 0xFFFFFFFFFFFFFFFF
+        t.append(cur)
+    return t
+
+
+def _decode_dur(data, rows):
+    out, prev = [], 0
+    for d in _frames(_Bits(data), rows):
+        prev = (prev + _unzigzag(d)) & 0xFFFF
+        out.append(prev)
+    return out
+
+
+def _decode_float(data, rows):
+    bits = _Bits(data)
+    prev = bits.get(32)
+    out = [prev]
+    lead = trail = 0
+    for _ in range(rows - 1):
+        if bits.get(1):
+            if bits.get(1):
+                lead = bits.get(5)
+                trail = 32 - lead - (bits.get(5) + 1)
+            prev ^= bits.get(32 - lead - trail) << trail
+        out.append(prev)
+    return list(struct.unpack(f'<{rows}f', struct.pack(f'<{rows}I', *out)))
+
+
+def _decode_status(data, rows):
+    out = bytearray()
+    for value, run in struct.iter_unpack('<BH', data[:len(data) - len(data) % 3]):
+        out += bytes([value]) * run
+    if len(out) != rows:
+        raise ValueError('status column does not match the block row count')
+    return out
+
+
+def decode_block(data):
+    """Decode one BlockCodec block into [t_us, dur_us, channels..., status] lists."""
+    version, channels, rows = struct.unpack_from('<BBH', data, 0)
+    if version != CODEC_VERSION:
+        raise ValueError(f'unknown block codec version {version}')
+    lengths = struct.unpack_from(f'<{3 + channels}I', data, 4)
+    pos = 4 + 4 * len(lengths)
+    cols = []
+    for n in lengths:
+        cols.append(data[pos:pos + n])
+        pos += n
+    return [_decode_time(cols[0], rows), _decode_dur(cols[1], rows)] + \
+           [_decode_float(c, rows) for c in cols[2:2 + channels]] + [_decode_status(cols[-1], rows)]
+
+
+class CaptureStoreReader:
+    def __init__(self, path):
+        self.path = path
+        with open(os.path.join(path, 'store.meta'), 'rb') as f:
+            self._meta = mmap.mmap(f.fileno(), HEADER_SIZE, access=mmap.ACCESS_READ)
+        (magic, version, channel_count, block_samples, flags, _, _, _, created_us,
+         names, _) = struct.unpack_from(HEADER_FORMAT, self._meta, 0)
+        if magic != STORE_MAGIC or version != STORE_VERSION:
+            raise ValueError(f'{path}: not a version {STORE_VERSION} capture store')
+
+        self.block_samples = block_samples
+        self.compressed = bool(flags & STORE_COMPRESSED)
+        self.created_unix_us = created_us
+        self.channels = [names[i * CHANNEL_NAME_LEN:(i + 1) * CHANNEL_NAME_LEN].split(b'\x00', 1)[0].decode()
+                         for i in range(channel_count)]
+        # (file, memoryview format) in CaptureStore::columnFiles() order
+        self._columns = [('t_us.u64', 'Q'), ('dur_us.u16', 'H')] + \
+                        [(f'{name}.f32', 'f') for name in self.channels] + [('status.u8', 'B')]
+        self._maps = [None] * len(self._columns)
+        self._views = [None] * len(self._columns)
+        self._blocks = []  # (offset, bytes) per sealed block
+        self._block_tmax = []
+        self._cache = OrderedDict()  # block -> decoded column lists
+        self._count = 0
+        self.refresh()
+
+    def close(self):
+        for v in self._views:
+            if v is not None:
+                v.release()
+        for m in self._maps:
+            if m is not None:
+                m.close()
+        self._views = [None] * len(self._columns)
+        self._maps = [None] * len(self._columns)
+        self._cache.clear()
+        self._meta.close()
+
+    def refresh(self):
+        """Map rows appended since the last call; returns len(self)."""
+        (committed,) = struct.unpack_from('<Q', self._meta, COMMITTED_OFFSET)
+        if committed > self._count:
+            for i, (name, fmt) in enumerate(self._columns):
+                if self._views[i] is not None and len(self._views[i]) >= committed:
+                    continue
+                if self._views[i] is not None:
+                    self._views[i].release()
+                    self._maps[i].close()
+                with open(os.path.join(self.path, name), 'rb') as f:
+                    size = os.fstat(f.fileno()).st_size
+                    self._maps[i] = mmap.mmap(f.fileno(), size, access=mmap.ACCESS_READ) if size else None
+                width = struct.calcsize(fmt)
+                rows = size // width
+                self._views[i] = memoryview(self._maps[i])[:rows * width].cast(fmt) if size else None
+                committed = min(committed, rows)
+            self._count = committed
+
+        sealed = self._count // self.block_samples
+        if sealed > len(self._blocks):
+            entry = struct.calcsize(BLOCK_INDEX_FORMAT)
+            with open(os.path.join(self.path, 'blocks.idx'), 'rb') as f:
+                f.seek(len(self._blocks) * entry)
+                data = f.read((sealed - len(self._blocks)) * entry)
+            for _, t_max, offset, nbytes, _ in struct.iter_unpack(BLOCK_INDEX_FORMAT, data):
+                self._block_tmax.append(t_max)
+                self._blocks.append((offset, nbytes))
+        return self._count
+
+    def __len__(self):
+        return self._count
+
+    def block(self, b):
+        """Columns of block b, [t_us, dur_us, channels..., status]: decoded lists, raw memoryview slices of an
+        uncompressed store, or lists copied from the columns of a compressed store's unsealed block."""
+        first = b * self.block_samples
+        last = min(first + self.block_samples, self._count)
+        if not self.compressed:
+            return [v[first:last] for v in self._views]
+        cols = self._cache.get(b)
+        if cols is not None and len(cols[0]) >= last - first:
+            self._cache.move_to_end(b)
+            return cols
+        # Open or unencoded at the last refresh(), which can be arbitrarily
+        # old: the receiver may have sealed it and punched its rows since
+        entry = self._blocks[b] if b < len(self._blocks) and self._blocks[b][1] else self._index_entry(b)
+        if entry is None:
+            cols = [v[first:last].tolist() for v in self._views]
+            # Sealed and punched during the copy: the copy may hold zeros
+            entry = self._index_entry(b)
+        if entry is not None:
+            offset, nbytes = entry
+            with open(os.path.join(self.path, 'blocks.dat'), 'rb') as f:
+                f.seek(offset)
+                cols = decode_block(f.read(nbytes))
+        self._cache[b] = cols
+        self._cache.move_to_end(b)
+        if len(self._cache) > CACHE_BLOCKS:
+            self._cache.popitem(last=False)
+        return cols
+
+    def _index_entry(self, b):
+        """(offset, bytes) of block b's blocks.idx entry as it is now, None unless it is encoded."""
+        entry = struct.calcsize(BLOCK_INDEX_FORMAT)
+        with open(os.path.join(self.path, 'blocks.idx'), 'rb') as f:
+            f.seek(b * entry)
+            data = f.read(entry)
+        if len(data) < entry:
+            return None
+        _, _, offset, nbytes, _ = struct.unpack(BLOCK_INDEX_FORMAT, data)
+        return (offset, nbytes) if nbytes else None
+
+    def column(self, name, first=0, last=None):
+        """Rows [first, last) of a column: 't_us', 'dur_us', 'status' or a channel name."""
+        c = (['t_us', 'dur_us'] + self.channels + ['status']).index(name)
+        last = self._count if last is None else min(last, self._count)
+        out = []
+        row = first
+        while row < last:
+            b = row // self.block_samples
+            base = b * self.block_samples
+            values = self.block(b)[c]
+            end = min(last, base + len(values))
+            out.extend(values[row - base:end - base])
+            row = end
+        return out
+
+    def lower_bound(self, t_us):
+        """First row with t_us >= t_us (len(self) if none)."""
+        if not self._count:
+            return 0
+        b = bisect_left(self._block_tmax, t_us)
+        t = self.block(b)[0]
+        return b * self.block_samples + bisect_left(t, t_us)
+
+    def time_range(self, t0_us, t1_us):
+        """Rows [first, last) with t0_us <= t_us < t1_us."""
+        first = self.lower_bound(t0_us)
+        return first, max(first, self.lower_bound(t1_us))
+
+    def row(self, i):
+        """Row i as a dict: sample_timestamp_us, sample_timestamp_us_end, channels (None on gap rows), status."""
+        b = i // self.block_samples
+        cols = self.block(b)
+        k = i - b * self.block_samples
+        t = cols[0][k]
+        dur = cols[1][k]
+        out = {
+            'sample_timestamp_us': t,
+            'sample_timestamp_us_end': None if dur == DUR_NONE else t + dur,
+        }
+        status = cols[-1][k]
+        gap = status & STATUS_GAP
+        for c, name in enumerate(self.channels):
+            out[name] = None if gap else cols[2 + c][k]
+        out['status'] = status
+        return out
+
+    def rows(self, first, last):
+        for i in range(first, min(last, self._count)):
+            yield self.row(i)
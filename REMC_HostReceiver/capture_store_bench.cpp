@@ -0,0 +1,275 @@
+/*
+  capture_store_bench – append and range-scan throughput of CaptureStore
+
+  Usage:
+    capture_store_bench [--raw] [dir] [samples]
+
+  Appends `samples` synthetic 10 kHz rows (default 20M, ~33 min) to a new
+  store in `dir` (default /tmp/capture_store_bench, removed first) in
+  33-row packets as the receiver does, then:
+
+    - lookup: lowerBound() latency for random times
+    - scan:   random 1 s / 10 s / 60 s / 600 s windows, summing one channel
+              and gathering full rows with read()
+    - tail:   a reader following the writer (refresh() + new rows)
+    - stale:  readers that last refreshed while block 2 was open, one of
+              them having read it then, read every row correctly after
+              PUNCH_LAG_BLOCKS + 4 more blocks have been sealed (and block
+              2's raw rows punched)
+
+  The store is compressed (BlockCodec) unless --raw is given. Reports
+  rows/s, MB/s and allocated bytes/sample on disk, and checks every scanned
+  window against the expected row count.
+*/
+
+#include "CaptureStore.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile uint64_t s_sink;   // keeps the scan loops from being optimized away
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static const uint64_t T0_US = 1760000000000000ull;   // 2025-10-09
+static const uint64_t PERIOD_US = 100;
+
+static void makeRecord(uint64_t i, CaptureStore::Record& r) {
+  r.tUs = T0_US + i * PERIOD_US;
+  r.tUsEnd = r.tUs + 9;
+  const float ph = (float)(i % 200) * (2.0f * (float)M_PI / 200.0f);
+  for (size_t c = 0; c < CaptureStore::DEFAULT_CHANNEL_COUNT; ++c) r.ch[c] = 5.0f * sinf(ph + c) + 0.001f * (i % 7);
+  r.status = (uint8_t)((i >> 16) & 0x3F);
+}
+
+// Sum of channel 0 over rows [first, last), one block view at a time
+static double sumChannel0(const CaptureStore::Reader& r, uint64_t first, uint64_t last) {
+  double sum = 0;
+  for (uint64_t row = first; row < last;) {
+    CaptureStore::BlockView v;
+    if (!r.block(row / CaptureStore::BLOCK_SAMPLES, v, BlockCodec::colChannel(0))) break;
+    const uint64_t end = std::min<uint64_t>(last, v.first + v.rows);
+    for (uint64_t i = row; i < end; ++i) sum += v.ch[0][i - v.first];
+    row = end;
+  }
+  return sum;
+}
+
+int main(int argc, char** argv) {
+  uint32_t flags = CaptureStore::STORE_COMPRESSED;
+  int arg = 1;
+  if (arg < argc && !strcmp(argv[arg], "--raw")) {
+    flags = 0;
+    arg++;
+  }
+  const std::string dir = arg < argc ? argv[arg] : "/tmp/capture_store_bench";
+  const uint64_t total = arg + 1 < argc ? strtoull(argv[arg + 1], nullptr, 10) : 20000000ull;
+  const std::vector<std::string> channels(CaptureStore::DEFAULT_CHANNELS,
+                                          CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+  std::string rm = "rm -rf '" + dir + "'";
+  if (system(rm.c_str()) != 0) return 1;
+
+  // ---- append ----
+  CaptureStore::Writer w;
+  if (!w.create(dir, channels, flags)) {
+    fprintf(stderr, "%s\n", w.error().c_str());
+    return 1;
+  }
+  CaptureStore::Record pkt[33];
+  Clock::time_point t = Clock::now();
+  for (uint64_t i = 0; i < total; i += 33) {
+    const size_t n = (size_t)std::min<uint64_t>(33, total - i);
+    for (size_t k = 0; k < n; ++k) makeRecord(i + k, pkt[k]);
+    if (!w.append(pkt, n)) {
+      fprintf(stderr, "%s\n", w.error().c_str());
+      return 1;
+    }
+  }
+  w.flush();
+  double dt = secondsSince(t);
+  printf("append   %llu rows in %.2f s: %.1f M rows/s (%.0fx real time at 10 kHz)\n",
+         (unsigned long long)total, dt, total / dt / 1e6, total / dt / 10000.0);
+  w.close();
+
+  uint64_t bytes = 0;
+  CaptureStore::StoreHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.channelCount = (uint32_t)channels.size();
+  for (size_t c = 0; c < channels.size(); ++c) strncpy(hdr.channelNames[c], channels[c].c_str(), 31);
+  std::vector<std::string> files = CaptureStore::columnFiles(hdr);
+  files.push_back("blocks.dat");
+  for (const std::string& f : files) {
+    struct stat st;
+    if (stat((dir + "/" + f).c_str(), &st) == 0) bytes += (uint64_t)st.st_blocks * 512;
+  }
+  printf("disk     %.1f MB%s, %.1f bytes/sample (raw columns: 31, Flask deque estimate: 320)\n", bytes / 1e6,
+         flags ? " compressed" : "", (double)bytes / total);
+
+  // ---- lookup ----
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return 1;
+  }
+  std::mt19937_64 rng(1);
+  const uint64_t spanUs = total * PERIOD_US;
+  int failures = 0;
+  const int lookups = 1000000;
+  uint64_t sink = 0;
+  t = Clock::now();
+  for (int i = 0; i < lookups; ++i) {
+    const uint64_t q = T0_US + rng() % spanUs;
+    sink += r.lowerBound(q);
+  }
+  dt = secondsSince(t);
+  printf("lookup   %d random lowerBound(): %.0f ns each (%llu sealed blocks)\n",
+         lookups, dt / lookups * 1e9, (unsigned long long)r.sealedBlocks());
+
+  // ---- scan ----
+  const double windowsS[] = { 1, 10, 60, 600 };
+  std::vector<CaptureStore::Record> rows;
+  for (double ws : windowsS) {
+    const uint64_t wUs = (uint64_t)(ws * 1e6);
+    if (wUs >= spanUs) continue;
+    const int reps = ws <= 10 ? 200 : 20;
+    uint64_t scanned = 0;
+    double sum = 0;
+    Clock::time_point ts = Clock::now();
+    for (int k = 0; k < reps; ++k) {
+      const uint64_t a = T0_US + rng() % (spanUs - wUs);
+      uint64_t first, last;
+      r.timeRange(a, a + wUs, first, last);
+      if (last - first != wUs / PERIOD_US) failures++;
+      sum += sumChannel0(r, first, last);
+      scanned += last - first;
+    }
+    const double colS = secondsSince(ts);
+
+    uint64_t gathered = 0;
+    ts = Clock::now();
+    for (int k = 0; k < reps; ++k) {
+      const uint64_t a = T0_US + rng() % (spanUs - wUs);
+      uint64_t first, last;
+      r.timeRange(a, a + wUs, first, last);
+      rows.resize(last - first);
+      gathered += r.read(first, rows.size(), rows.data());
+      if (!rows.empty() && rows.front().tUs < a) failures++;
+    }
+    const double rowS = secondsSince(ts);
+    printf("scan %4.0f s  one column %7.1f M rows/s (%6.0f MB/s)   full rows %6.1f M rows/s (%5.0f MB/s)\n",
+           ws, scanned / colS / 1e6, scanned * 4 / colS / 1e6,
+           gathered / rowS / 1e6, gathered * 31 / rowS / 1e6);
+    sink += (uint64_t)sum;
+  }
+
+  // ---- tail: reader following a writer ----
+  CaptureStore::Writer tw;
+  const std::string tailDir = dir + "_tail";
+  rm = "rm -rf '" + tailDir + "'";
+  if (system(rm.c_str()) != 0) return 1;
+  tw.create(tailDir, channels, flags);
+  CaptureStore::Reader tr;
+  tr.open(tailDir);
+  uint64_t seen = 0, expectT = T0_US;
+  const uint64_t tailRows = std::min<uint64_t>(total, 5000000ull);
+  t = Clock::now();
+  for (uint64_t i = 0; i < tailRows; i += 33) {
+    const size_t n = (size_t)std::min<uint64_t>(33, tailRows - i);
+    for (size_t k = 0; k < n; ++k) makeRecord(i + k, pkt[k]);
+    tw.append(pkt, n);
+    const uint64_t sz = tr.refresh();
+    while (seen < sz) {
+      CaptureStore::BlockView v;
+      if (!tr.block(seen / CaptureStore::BLOCK_SAMPLES, v, BlockCodec::COL_T)) break;
+      const uint64_t end = std::min<uint64_t>(sz, v.first + v.rows);
+      for (; seen < end; ++seen, expectT += PERIOD_US) {
+        if (v.t[seen - v.first] != expectT) failures++;
+      }
+    }
+  }
+  dt = secondsSince(t);
+  printf("tail     %llu rows appended and followed in %.2f s: %.1f M rows/s\n",
+         (unsigned long long)seen, dt, seen / dt / 1e6);
+  tw.close();
+  tr.close();
+  rm = "rm -rf '" + tailDir + "'";
+  if (system(rm.c_str()) != 0) return 1;
+
+  // ---- stale: readers whose last refresh() predates the punch ----
+  // Both refresh while block 2 is open and one reads it then; the writer
+  // then seals PUNCH_LAG_BLOCKS + 4 more blocks, which punches block 2's
+  // raw rows, and both read their snapshot without refreshing
+  CaptureStore::Writer sw;
+  const std::string staleDir = dir + "_stale";
+  rm = "rm -rf '" + staleDir + "'";
+  if (system(rm.c_str()) != 0) return 1;
+  sw.create(staleDir, channels, flags);
+  const uint64_t staleRows = 33 * (2 * CaptureStore::BLOCK_SAMPLES / 33 + 30);   // packet boundary
+  const uint64_t staleTotal = staleRows + (CaptureStore::PUNCH_LAG_BLOCKS + 4) * CaptureStore::BLOCK_SAMPLES;
+  CaptureStore::Reader early, late;
+  for (uint64_t i = 0; i < staleTotal; i += 33) {
+    if (i == staleRows) {
+      early.open(staleDir);
+      late.open(staleDir);
+      CaptureStore::BlockView v;
+      early.block(2, v);
+    }
+    const size_t n = (size_t)std::min<uint64_t>(33, staleTotal - i);
+    for (size_t k = 0; k < n; ++k) makeRecord(i + k, pkt[k]);
+    sw.append(pkt, n);
+  }
+  // The case only means something if block 2's raw t_us now reads as zeros
+  if (flags) {
+    uint64_t rawT = 1;
+    const int fd = open((staleDir + "/t_us.u64").c_str(), O_RDONLY);
+    if (fd < 0 || pread(fd, &rawT, sizeof(rawT), (off_t)(staleRows - 1) * sizeof(rawT)) != (ssize_t)sizeof(rawT)) {
+      rawT = 1;
+    }
+    if (fd >= 0) ::close(fd);
+    printf("stale    block 2 raw rows %s\n", rawT == 0 ? "punched" : "NOT punched");
+    if (rawT != 0) failures++;
+  }
+  rows.resize(33);
+  CaptureStore::Reader* stale[2] = { &early, &late };
+  const char* staleName[2] = { "read before the punch", "first read after it" };
+  for (int k = 0; k < 2; ++k) {
+    CaptureStore::Reader& r = *stale[k];
+    uint64_t wrong = 0;
+    for (uint64_t row = 0; row < r.size(); row += 33) {
+      const size_t n = r.read(row, 33, rows.data());
+      for (size_t m = 0; m < n; ++m) {
+        CaptureStore::Record want;
+        makeRecord(row + m, want);
+        if (rows[m].tUs != want.tUs || rows[m].ch[0] != want.ch[0] || rows[m].status != want.status) wrong++;
+      }
+    }
+    printf("stale    %llu-row snapshot, %u blocks sealed since (%s): %llu rows wrong\n",
+           (unsigned long long)r.size(), CaptureStore::PUNCH_LAG_BLOCKS + 4, staleName[k],
+           (unsigned long long)wrong);
+    if (r.size() != staleRows || wrong) failures++;
+  }
+  early.close();
+  late.close();
+  sw.close();
+  rm = "rm -rf '" + staleDir + "'";
+  if (system(rm.c_str()) != 0) return 1;
+
+  s_sink = sink;
+  printf("%s (%d failures)\n", failures ? "FAIL" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+/*
+  capture_tool – inspect a CaptureStore directory
+
+  Usage:
+    capture_tool info  <store>               rows, time span, blocks, bytes/sample
+    capture_tool range <store> <t0> <t1>     rows with t0 <= t_us < t1 (µs since epoch)
+    capture_tool tail  <store> [N]           last N rows (default 10) as JSON lines
+*/
+
+#include "CaptureStore.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Allocated bytes: punched-out column ranges of compressed stores are holes
+static uint64_t fileBytes(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_blocks * 512 : 0;
+}
+
+static int cmdInfo(const std::string& dir, CaptureStore::Reader& r) {
+  const uint64_t n = r.size();
+  printf("store        %s\n", dir.c_str());
+  printf("rows         %llu\n", (unsigned long long)n);
+  printf("channels    ");
+  for (size_t c = 0; c < r.channelCount(); ++c) printf(" %s", r.channelName(c));
+  printf("\n");
+  printf("blocks       %llu sealed of %u rows%s\n", (unsigned long long)r.sealedBlocks(), CaptureStore::BLOCK_SAMPLES,
+         r.compressed() ? ", compressed" : "");
+  printf("out of order %llu\n", (unsigned long long)r.outOfOrder());
+  if (n > 0) {
+    const uint64_t t0 = r.timeAt(0), t1 = r.timeAt(n - 1);
+    printf("time         %llu .. %llu µs (%.3f s)\n", (unsigned long long)t0, (unsigned long long)t1,
+           (t1 - t0) / 1e6);
+  }
+
+  // Column files hold at least the committed rows (more while being grown)
+  CaptureStore::StoreHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.channelCount = (uint32_t)r.channelCount();
+  for (size_t c = 0; c < r.channelCount(); ++c) {
+    strncpy(hdr.channelNames[c], r.channelName(c), CaptureStore::CHANNEL_NAME_LEN - 1);
+  }
+  uint64_t bytes = fileBytes(dir + "/store.meta") + fileBytes(dir + "/blocks.idx");
+  for (const std::string& f : CaptureStore::columnFiles(hdr)) bytes += fileBytes(dir + "/" + f);
+  const uint64_t encoded = fileBytes(dir + "/blocks.dat");
+  printf("disk         %.1f MB", (bytes + encoded) / 1e6);
+  if (n > 0) printf(" (%.1f bytes/sample)", (double)(bytes + encoded) / n);
+  printf("\n");
+  if (r.compressed()) {
+    printf("encoded      %.1f MB in blocks.dat, %.1f MB raw tail and unpunched blocks\n", encoded / 1e6, bytes / 1e6);
+  }
+  return 0;
+}
+
+static int cmdRange(CaptureStore::Reader& r, uint64_t t0, uint64_t t1) {
+  uint64_t first, last;
+  r.timeRange(t0, t1, first, last);
+  printf("rows %llu..%llu (%llu)\n", (unsigned long long)first, (unsigned long long)last,
+         (unsigned long long)(last - first));
+  return 0;
+}
+
+static int cmdTail(CaptureStore::Reader& r, uint64_t count) {
+  const uint64_t n = r.size();
+  const uint64_t first = n > count ? n - count : 0;
+  std::vector<CaptureStore::Record> rows(n - first);
+  r.read(first, rows.size(), rows.data());
+  for (const CaptureStore::Record& rec : rows) {
+    printf("{\"sample_timestamp_us\": %llu, \"sample_timestamp_us_end\": ", (unsigned long long)rec.tUs);
+    if (rec.tUsEnd) printf("%llu", (unsigned long long)rec.tUsEnd);
+    else printf("null");
+    for (size_t c = 0; c < r.channelCount(); ++c) printf(", \"%s\": %.6g", r.channelName(c), rec.ch[c]);
+    printf(", \"status\": %u}\n", rec.status);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s info|range|tail <store> [args]\n", argv[0]);
+    return 2;
+  }
+  const std::string cmd = argv[1];
+  const std::string dir = argv[2];
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return 1;
+  }
+
+  if (cmd == "info") return cmdInfo(dir, r);
+  if (cmd == "range" && argc >= 5) return cmdRange(r, strtoull(argv[3], nullptr, 10), strtoull(argv[4], nullptr, 10));
+  if (cmd == "tail") return cmdTail(r, argc > 3 ? strtoull(argv[3], nullptr, 10) : 10);
+  fprintf(stderr, "unknown command %s\n", cmd.c_str());
+  return 2;
+}
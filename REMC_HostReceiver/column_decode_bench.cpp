@@ -0,0 +1,349 @@
+/*
+  column_decode_bench – packed sample payloads to store columns, SIMD against scalar
+
+  Usage:
+    column_decode_bench [samples]
+
+  Compiles five layouts with SchemaDecoder and turns `samples` (default
+  20M) samples of each, packed into full datagrams, into column arrays
+  (t_us u64, dur_us u16, one float per channel, status u8 – the columns
+  CaptureStore maps) three ways:
+
+    records    decode() into Records, then Record to columns as
+               CaptureStore Writer::append() does (the path before
+               decodeColumns)
+    scalar     decodeColumnsScalar(): field by field, no Record
+    avx2       decodeColumns() with the AVX2 kernel (if the CPU has it)
+
+  The layouts are the firmware's, raw u16 counts with the ChannelTable
+  calibration (cal:), eight f32 channels, sixteen calibrated i16 counts,
+  and a mixed layout whose f64/u32 fields the gathers leave to the scalar
+  loop. Rates are samples and payload bytes per second; every column row
+  of every way is compared with what was packed, calibrated counts bit for
+  bit with count * scale + offset.
+
+  Then appends 2M firmware-layout samples to an uncompressed CaptureStore
+  in a temporary directory both ways the writer thread can: append() of
+  decoded Records, and reserve() + decodeColumns() + commit() (best of
+  five, alternating).
+
+  Exit status is non-zero if any column differs or a layout does not
+  compile.
+*/
+
+#include "CaptureStore.h"
+#include "SchemaDecoder.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint64_t T0_US = 1760000000000000ull;   // 2025-10-09
+static const size_t MAX_PAYLOAD = 1408;              // 1472 - header (UdpManager MAX_PACKET_SIZE)
+static const size_t MAX_PACKET_SAMPLES = 33;
+static const size_t PACKETS = 1024;
+
+// ChannelTable switch_voltage
+static const float CAL_SCALE = 0.004449458233f;
+static const float CAL_OFFSET = -8.939881545f;
+
+static double nowS() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char* const STATUS_LINES =
+    "v armed_status u8\nv em_status u8\nv msw_a_status u8\nv msw_b_status u8\n"
+    "v manual_mode_status u8\nv hold_mode_status u8\n";
+
+static std::string calWord() {
+  uint32_t s, o;
+  memcpy(&s, &CAL_SCALE, sizeof(s));
+  memcpy(&o, &CAL_OFFSET, sizeof(o));
+  char w[32];
+  snprintf(w, sizeof(w), " cal:%08x:%08x", s, o);
+  return w;
+}
+
+static std::string channelLines(const char* type, size_t n, bool cal) {
+  std::string s;
+  for (size_t i = 0; i < n; ++i) {
+    s += "v ch_" + std::to_string(i) + " " + type + " u:kV" + (cal ? calWord() : std::string()) + "\n";
+  }
+  return s;
+}
+
+struct Layout {
+  const char* name;
+  std::string schema;
+  size_t sampleBytes;        // expected
+};
+
+static std::vector<Layout> layouts() {
+  const std::string head = "node_name REMC \nc telem_period 100000\n";
+  const std::string t = "v t_us u64 u:us\n", end = "v t_us_end u64 u:us\n";
+  std::vector<Layout> out;
+  out.push_back(Layout{ "firmware", head + channelLines("f32", 5, false) + t + STATUS_LINES + end, 42 });
+  out.push_back(Layout{ "u16 cal", head + channelLines("u16", 5, true) + t + STATUS_LINES + end, 32 });
+  out.push_back(Layout{ "8 x f32", head + channelLines("f32", 8, false) + t + STATUS_LINES + end, 54 });
+  out.push_back(Layout{ "16 x i16 cal", head + channelLines("i16", 16, true) + t + STATUS_LINES + end, 54 });
+  out.push_back(Layout{ "mixed", head + "v switch_voltage f64 u:kV\nv switch_current i16 u:counts\n"
+                                        "v t_us u32 u:us\nv armed_status u8\nv em_status i8\n"
+                                        "v output_voltage_a i32 u:counts\n", 20 });
+  return out;
+}
+
+struct Columns {
+  std::vector<uint64_t> t;
+  std::vector<uint16_t> dur;
+  std::vector<float> ch[CaptureStore::MAX_CHANNELS];
+  std::vector<uint8_t> status;
+
+  Columns(size_t rows, size_t channels) : t(rows), dur(rows), status(rows) {
+    for (size_t c = 0; c < channels; ++c) ch[c].assign(rows, 0.0f);
+  }
+  BlockCodec::ColumnsOut at(size_t row) {
+    BlockCodec::ColumnsOut out;
+    memset(&out, 0, sizeof(out));
+    out.t = &t[row];
+    out.dur = &dur[row];
+    for (size_t c = 0; c < CaptureStore::MAX_CHANNELS; ++c) out.ch[c] = ch[c].empty() ? nullptr : &ch[c][row];
+    out.status = &status[row];
+    return out;
+  }
+};
+
+// Sample i by the compiled field table, with the columns it must decode to
+static void pack(const SchemaDecoder& d, uint64_t i, uint8_t* p, Columns& want) {
+  uint64_t tUs = 0, tEnd = 0;
+  bool haveEnd = false;
+  uint8_t status = 0;
+  for (const SchemaDecoder::Field& f : d.fields()) {
+    uint8_t* q = p + f.offset;
+    const uint64_t u = (i * 7 + f.index * 13) % 4000;
+    switch (f.role) {
+      case SchemaDecoder::ROLE_CHANNEL: {
+        float v = 0.0f;
+        switch (f.type) {
+          case SchemaDecoder::T_U16: { const uint16_t x = (uint16_t)u; memcpy(q, &x, 2); v = (float)x; break; }
+          case SchemaDecoder::T_I16: { const int16_t x = (int16_t)(u - 2000); memcpy(q, &x, 2); v = (float)x; break; }
+          case SchemaDecoder::T_I32: { const int32_t x = (int32_t)(u * 1000 - 7); memcpy(q, &x, 4); v = (float)x; break; }
+          case SchemaDecoder::T_F32: { const float x = u * 0.25f + 0.1f; memcpy(q, &x, 4); v = x; break; }
+          default:                   { const double x = u * 0.5 - 3.3; memcpy(q, &x, 8); v = (float)x; break; }
+        }
+        want.ch[f.index][i] = f.calibrated ? v * f.scale + f.calOffset : v;
+        break;
+      }
+      case SchemaDecoder::ROLE_T_US:
+      case SchemaDecoder::ROLE_T_US_END: {
+        const bool isEnd = f.role == SchemaDecoder::ROLE_T_US_END;
+        // Durations of 9 µs, and every 97th end time too late or before the start
+        uint64_t t = T0_US + i * 100 + (isEnd ? (i % 97 == 5 ? 70000 : i % 97 == 6 ? (uint64_t)-3 : 9) : 0);
+        if (f.type == SchemaDecoder::T_U32) {
+          t &= 0xFFFFFFFFu;
+          const uint32_t x = (uint32_t)t;
+          memcpy(q, &x, 4);
+        } else {
+          memcpy(q, &t, 8);
+        }
+        if (isEnd) {
+          tEnd = t;
+          haveEnd = true;
+        } else {
+          tUs = t;
+        }
+        break;
+      }
+      case SchemaDecoder::ROLE_STATUS: {
+        const uint8_t b = ((i >> f.index) & 1) ? (uint8_t)(f.index + 1) : 0;
+        *q = b;
+        if (b) status |= (uint8_t)(1u << f.index);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  want.t[i] = tUs;
+  const uint64_t dur = tEnd - tUs;
+  want.dur[i] = (!haveEnd || tEnd < tUs || dur >= CaptureStore::DUR_NONE) ? CaptureStore::DUR_NONE : (uint16_t)dur;
+  want.status[i] = status;
+}
+
+// Writer::append()'s column-at-a-time copy out of Records
+static void recordsToColumns(const CaptureStore::Record* r, size_t n, size_t channels, const BlockCodec::ColumnsOut& out) {
+  for (size_t i = 0; i < n; ++i) out.t[i] = r[i].tUs;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t d = r[i].tUsEnd - r[i].tUs;
+    out.dur[i] = (r[i].tUsEnd < r[i].tUs || d >= CaptureStore::DUR_NONE) ? CaptureStore::DUR_NONE : (uint16_t)d;
+  }
+  for (size_t c = 0; c < channels; ++c) {
+    float* v = out.ch[c];
+    for (size_t i = 0; i < n; ++i) v[i] = r[i].ch[c];
+  }
+  for (size_t i = 0; i < n; ++i) out.status[i] = r[i].status;
+}
+
+static bool sameColumns(const Columns& a, const Columns& b, size_t rows, size_t channels) {
+  if (memcmp(a.t.data(), b.t.data(), rows * 8) || memcmp(a.dur.data(), b.dur.data(), rows * 2) ||
+      memcmp(a.status.data(), b.status.data(), rows)) {
+    return false;
+  }
+  for (size_t c = 0; c < channels; ++c) {
+    if (memcmp(a.ch[c].data(), b.ch[c].data(), rows * sizeof(float))) return false;
+  }
+  return true;
+}
+
+// Firmware layout into a fresh uncompressed store; samples/s
+static double storeRate(const SchemaDecoder& d, const std::vector<uint8_t>& payloads, size_t perPacket,
+                        uint64_t samples, bool columns, bool& ok) {
+  char dir[] = "/tmp/column_decode_bench.XXXXXX";
+  if (!mkdtemp(dir)) {
+    ok = false;
+    return 0.0;
+  }
+  const std::string storeDir = std::string(dir) + "/store";
+  std::vector<std::string> names;
+  for (size_t c = 0; c < d.channels(); ++c) names.push_back("ch_" + std::to_string(c));
+  CaptureStore::Writer w;
+  if (!w.create(storeDir, names, 0)) {
+    fprintf(stderr, "%s\n", w.error().c_str());
+    ok = false;
+    return 0.0;
+  }
+  const size_t payload = perPacket * d.sampleBytes();
+  CaptureStore::Record rec[MAX_PACKET_SAMPLES];
+  const uint64_t packets = samples / perPacket;
+  const double t0 = nowS();
+  for (uint64_t k = 0; k < packets && ok; ++k) {
+    const uint8_t* p = &payloads[(k % PACKETS) * payload];
+    if (columns) {
+      BlockCodec::ColumnsOut out;
+      ok = w.reserve(perPacket, out);
+      if (ok) d.decodeColumns(p, payload, out);
+      w.commit(perPacket);
+    } else {
+      d.decode(p, payload, rec, MAX_PACKET_SAMPLES);
+      ok = w.append(rec, perPacket);
+    }
+  }
+  const double s = nowS() - t0;
+  ok = ok && w.size() == packets * perPacket;
+  w.close();
+  const std::string rm = std::string("rm -rf ") + dir;
+  if (system(rm.c_str()) != 0) fprintf(stderr, "could not remove %s\n", dir);
+  return packets * perPacket / s;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t samples = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000000;
+  int failures = 0;
+
+  SchemaDecoder probe;
+  probe.compile(layouts()[0].schema);
+  const bool avx2 = probe.columnKernel() == SchemaDecoder::KERNEL_AVX2;
+  printf("%llu samples per layout, packed in full datagrams; AVX2 %s\n\n", (unsigned long long)samples,
+         avx2 ? "available" : "not available");
+  printf("%-13s %5s   %-15s %-15s %-15s %8s %6s\n", "layout", "bytes", "records", "scalar", "avx2", "avx2/sc",
+         "exact");
+  printf("%-13s %5s   %-15s %-15s %-15s\n", "", "", "Ms/s  GB/s", "Ms/s  GB/s", "Ms/s  GB/s");
+
+  for (const Layout& l : layouts()) {
+    SchemaDecoder d;
+    if (!d.compile(l.schema)) {
+      printf("%-13s does not compile: %s\n", l.name, d.error().c_str());
+      failures++;
+      continue;
+    }
+    bool ok = d.sampleBytes() == l.sampleBytes;
+    const size_t perPacket = std::min(MAX_PACKET_SAMPLES, MAX_PAYLOAD / d.sampleBytes());
+    const size_t payload = perPacket * d.sampleBytes();
+    const size_t rows = PACKETS * perPacket;
+
+    // 1024 packets' payloads, decoded over and over into the same columns
+    std::vector<uint8_t> buf(PACKETS * payload);
+    Columns want(rows, d.channels());
+    for (size_t i = 0; i < rows; ++i) pack(d, i, &buf[i * d.sampleBytes()], want);
+
+    double rate[3] = { 0, 0, 0 };
+    CaptureStore::Record rec[MAX_PACKET_SAMPLES];
+    for (int way = 0; way < 3; ++way) {
+      if (way == 2 && !avx2) continue;
+      Columns got(rows, d.channels());
+      const uint64_t rounds = std::max<uint64_t>(1, samples / rows);
+      double best = 1e9;
+      for (int rep = 0; rep < 3; ++rep) {
+        const double t0 = nowS();
+        for (uint64_t r = 0; r < rounds; ++r) {
+          for (size_t k = 0; k < PACKETS; ++k) {
+            const uint8_t* p = &buf[k * payload];
+            const BlockCodec::ColumnsOut out = got.at(k * perPacket);
+            if (way == 0) {
+              const size_t n = d.decode(p, payload, rec, MAX_PACKET_SAMPLES);
+              recordsToColumns(rec, n, d.channels(), out);
+            } else if (way == 1) {
+              d.decodeColumnsScalar(p, payload, out);
+            } else {
+              d.decodeColumns(p, payload, out);
+            }
+          }
+        }
+        best = std::min(best, nowS() - t0);
+      }
+      rate[way] = rounds * rows / best;
+      if (!sameColumns(got, want, rows, d.channels())) ok = false;
+    }
+
+    // Every packet size, so each kernel's tail and block boundaries are hit
+    for (size_t n = 1; n <= perPacket && ok; ++n) {
+      Columns a(n, d.channels()), b(n, d.channels());
+      ok = d.decodeColumnsScalar(&buf[0], n * d.sampleBytes(), a.at(0)) == n &&
+           d.decodeColumns(&buf[0], n * d.sampleBytes(), b.at(0)) == n && sameColumns(a, want, n, d.channels()) &&
+           sameColumns(b, want, n, d.channels());
+    }
+
+    char cell[3][24];
+    for (int way = 0; way < 3; ++way) {
+      if (rate[way] > 0) {
+        snprintf(cell[way], sizeof(cell[way]), "%5.0f %5.2f", rate[way] / 1e6, rate[way] * d.sampleBytes() / 1e9);
+      } else {
+        snprintf(cell[way], sizeof(cell[way]), "    -");
+      }
+    }
+    char speedup[16] = "-";
+    if (rate[2] > 0) snprintf(speedup, sizeof(speedup), "%.2fx", rate[2] / rate[1]);
+    printf("%-13s %5zu   %-15s %-15s %-15s %8s %6s\n", l.name, d.sampleBytes(), cell[0], cell[1], cell[2], speedup,
+           ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+  }
+
+  // Into a real store: the writer thread's two paths
+  SchemaDecoder fw;
+  fw.compile(layouts()[0].schema);
+  const size_t perPacket = MAX_PACKET_SAMPLES;
+  std::vector<uint8_t> buf(PACKETS * perPacket * fw.sampleBytes());
+  Columns scratch(PACKETS * perPacket, fw.channels());
+  for (size_t i = 0; i < PACKETS * perPacket; ++i) pack(fw, i, &buf[i * fw.sampleBytes()], scratch);
+  const uint64_t storeSamples = 2000000;
+  bool storeOk = true;
+  // Alternating, best of five: the first store pays for the page cache
+  double viaRecords = 0.0, viaColumns = 0.0;
+  for (int rep = 0; rep < 5; ++rep) {
+    viaRecords = std::max(viaRecords, storeRate(fw, buf, perPacket, storeSamples, false, storeOk));
+    viaColumns = std::max(viaColumns, storeRate(fw, buf, perPacket, storeSamples, true, storeOk));
+  }
+  printf("\nstore append, %llu firmware samples, uncompressed: Records %.1f Ms/s, columns %.1f Ms/s  %s\n",
+         (unsigned long long)storeSamples, viaRecords / 1e6, viaColumns / 1e6, storeOk ? "ok" : "FAIL");
+  if (!storeOk) failures++;
+
+  printf("\n%s (%d failures)\n", failures ? "FAIL" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,272 @@
+/*
+  live_stream_bench – LiveStream fan-out load test
+
+  Usage:
+    live_stream_bench [clients] [--hz N] [--slow N] [--seconds S] [--queue KB]
+
+  Serves LiveStream through HttpServer on 127.0.0.1 and publishes
+  synthetic 10 kHz data in 33-sample packets, as the receiver's ingest
+  loop does. `clients` (default 200) EventSource-like connections read
+  the stream from one epoll thread; `--slow` of them (default 10% of
+  clients) read only 512 bytes a second, so their queues fill and they
+  drop frames.
+
+  Reports the fan-out thread's CPU, the longest publish() call (what the
+  ingest loop would see), end-to-end latency (receive − ingest_us) and
+  fan-out latency (receive − sent_us) over the fast clients, and frames
+  received and missed per kind of client. Exit status is non-zero if a
+  fast client misses a frame, no slow client drops one, or publish()
+  ever takes longer than 5 ms.
+*/
+
+#include "HttpServer.h"
+#include "LiveStream.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint16_t HTTP_PORT = 18082;
+static const size_t PACKET_SAMPLES = 33;
+
+static uint64_t wallUs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+struct Client {
+  int fd;
+  bool slow;
+  std::string buf;
+  uint64_t frames;
+  uint64_t missed;           // gaps in seq
+  uint64_t lastSeq;
+  double nextRead;           // slow clients
+};
+
+static uint64_t field(const char* frame, const char* name) {
+  const char* p = strstr(frame, name);
+  return p ? strtoull(p + strlen(name), nullptr, 10) : 0;
+}
+
+// Consume whole events from c.buf
+static void parse(Client& c, std::vector<double>& e2eMs, std::vector<double>& fanMs) {
+  const uint64_t now = wallUs();
+  size_t pos = 0, end;
+  while ((end = c.buf.find("\n\n", pos)) != std::string::npos) {
+    const std::string ev = c.buf.substr(pos, end - pos);
+    pos = end + 2;
+    if (ev.find("data: ") == std::string::npos) continue;
+    const uint64_t seq = field(ev.c_str(), "\"seq\": ");
+    if (c.lastSeq && seq > c.lastSeq + 1) c.missed += seq - c.lastSeq - 1;
+    c.lastSeq = seq;
+    c.frames++;
+    if (!c.slow) {
+      e2eMs.push_back((double)(int64_t)(now - field(ev.c_str(), "\"ingest_us\": ")) / 1e3);
+      fanMs.push_back((double)(int64_t)(now - field(ev.c_str(), "\"sent_us\": ")) / 1e3);
+    }
+  }
+  c.buf.erase(0, pos);
+}
+
+static int connectClient() {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a;
+  memset(&a, 0, sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_port = htons(HTTP_PORT);
+  a.sin_addr.s_addr = inet_addr("127.0.0.1");
+  if (connect(fd, (sockaddr*)&a, sizeof(a)) < 0) {
+    close(fd);
+    return -1;
+  }
+  // A slow reader advertises a small window, as a stalled browser tab would
+  const char req[] = "GET /live HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n\r\n";
+  if (send(fd, req, sizeof(req) - 1, 0) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static double percentile(std::vector<double>& v, double p) {
+  if (v.empty()) return 0;
+  const size_t k = std::min(v.size() - 1, (size_t)(p * (double)v.size()));
+  std::nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+int main(int argc, char** argv) {
+  size_t clients = 200;
+  double hz = 20, seconds = 10;
+  long slowArg = -1;
+  size_t queueKb = LiveStream::DEFAULT_QUEUE_BYTES / 1024;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--hz") && i + 1 < argc) hz = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--slow") && i + 1 < argc) slowArg = atol(argv[++i]);
+    else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--queue") && i + 1 < argc) queueKb = (size_t)atol(argv[++i]);
+    else if (argv[i][0] != '-') clients = (size_t)atol(argv[i]);
+    else {
+      fprintf(stderr, "usage: %s [clients] [--hz N] [--slow N] [--seconds S] [--queue KB]\n", argv[0]);
+      return 2;
+    }
+  }
+  const size_t slow = std::min(clients, slowArg < 0 ? clients / 10 : (size_t)slowArg);
+
+  const std::vector<std::string> channels(CaptureStore::DEFAULT_CHANNELS,
+                                          CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+  LiveStream stream;
+  if (!stream.start(channels, hz, queueKb * 1024)) {
+    fprintf(stderr, "%s\n", stream.error().c_str());
+    return 1;
+  }
+  HttpServer http;
+  http.setTakeover([&stream](int fd, const std::string& path, const HttpServer::Query&) {
+    if (path != "/live") return false;
+    stream.attach(fd);
+    return true;
+  });
+  if (!http.start("127.0.0.1", HTTP_PORT, [](const std::string&, const HttpServer::Query&) {
+        return HttpServer::Response{ 404, "text/plain", "not found\n" };
+      })) {
+    fprintf(stderr, "%s\n", http.error().c_str());
+    return 1;
+  }
+
+  const int ep = epoll_create1(0);
+  std::vector<Client> cs;
+  cs.reserve(clients);
+  for (size_t i = 0; i < clients; ++i) {
+    const bool isSlow = i < slow;
+    const int fd = connectClient();
+    if (fd < 0) {
+      perror("connect");
+      return 1;
+    }
+    if (isSlow) {
+      int rcvbuf = 4096;
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    cs.push_back(Client{ fd, isSlow, std::string(), 0, 0, 0, 0 });
+    if (!isSlow) {
+      epoll_event ev;
+      ev.events = EPOLLIN;
+      ev.data.u64 = i;
+      epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+  }
+  printf("%zu clients (%zu slow), %.0f Hz frames, %zu KB queue, %.0f s\n", clients, slow, hz, queueKb, seconds);
+
+  // Ingest: 33-sample packets at 10 kHz
+  std::atomic<bool> done(false);
+  double maxPublishMs = 0;
+  uint64_t published = 0;
+  std::thread ingest([&]() {
+    CaptureStore::Record pkt[PACKET_SAMPLES];
+    memset(pkt, 0, sizeof(pkt));
+    const Clock::time_point t0 = Clock::now();
+    uint64_t k = 0;
+    while (!done) {
+      for (size_t i = 0; i < PACKET_SAMPLES; ++i, ++k) {
+        pkt[i].tUs = wallUs();
+        for (size_t c = 0; c < channels.size(); ++c) pkt[i].ch[c] = (float)sin((double)(k + c * 100) * 1e-3);
+        pkt[i].status = (uint8_t)(k / 10000 % 2);
+      }
+      const Clock::time_point p = Clock::now();
+      stream.publish(pkt, PACKET_SAMPLES);
+      maxPublishMs = std::max(maxPublishMs, secondsSince(p) * 1e3);
+      published += PACKET_SAMPLES;
+      const double due = (double)published / 10000.0;
+      const double ahead = due - secondsSince(t0);
+      if (ahead > 0) std::this_thread::sleep_for(std::chrono::duration<double>(ahead));
+    }
+  });
+
+  std::vector<double> e2eMs, fanMs;
+  e2eMs.reserve((size_t)(clients * hz * seconds));
+  fanMs.reserve(e2eMs.capacity());
+  const LiveStream::Stats before = stream.stats();
+  const Clock::time_point start = Clock::now();
+  epoll_event events[256];
+  char buf[65536];
+  while (secondsSince(start) < seconds) {
+    const int n = epoll_wait(ep, events, 256, 10);
+    for (int i = 0; i < n; ++i) {
+      Client& c = cs[events[i].data.u64];
+      const ssize_t r = recv(c.fd, buf, sizeof(buf), MSG_DONTWAIT);
+      if (r > 0) {
+        c.buf.append(buf, (size_t)r);
+        parse(c, e2eMs, fanMs);
+      }
+    }
+    const double now = secondsSince(start);
+    for (Client& c : cs) {
+      if (!c.slow || now < c.nextRead) continue;
+      const ssize_t r = recv(c.fd, buf, 512, MSG_DONTWAIT);
+      if (r > 0) {
+        c.buf.append(buf, (size_t)r);
+        parse(c, e2eMs, fanMs);
+      }
+      c.nextRead = now + 1.0;
+    }
+  }
+  const double elapsed = secondsSince(start);
+  const LiveStream::Stats after = stream.stats();
+  done = true;
+  ingest.join();
+
+  uint64_t fastFrames = 0, fastMissed = 0, slowFrames = 0, slowMissed = 0;
+  for (const Client& c : cs) {
+    (c.slow ? slowFrames : fastFrames) += c.frames;
+    (c.slow ? slowMissed : fastMissed) += c.missed;
+  }
+  const size_t fast = clients - slow;
+  const uint64_t frames = after.frames - before.frames;
+  printf("frames built     %llu (%.1f/s), %llu samples published\n", (unsigned long long)frames, frames / elapsed,
+         (unsigned long long)published);
+  printf("fan-out CPU      %.1f%% of one core, %.1f MB/s sent\n",
+         (after.cpuSeconds - before.cpuSeconds) / elapsed * 100,
+         (double)(after.sentBytes - before.sentBytes) / elapsed / 1e6);
+  printf("publish()        max %.3f ms\n", maxPublishMs);
+  printf("e2e latency      p50 %.2f ms, p99 %.2f ms, max %.2f ms (ingest -> client)\n", percentile(e2eMs, 0.5),
+         percentile(e2eMs, 0.99), percentile(e2eMs, 1.0));
+  printf("fan-out latency  p50 %.2f ms, p99 %.2f ms, max %.2f ms (frame built -> client)\n",
+         percentile(fanMs, 0.5), percentile(fanMs, 0.99), percentile(fanMs, 1.0));
+  printf("fast clients     %.1f frames each, %llu missed\n", fast ? (double)fastFrames / fast : 0.0,
+         (unsigned long long)fastMissed);
+  printf("slow clients     %.1f frames each, %llu missed, %llu dropped by the server\n",
+         slow ? (double)slowFrames / slow : 0.0, (unsigned long long)slowMissed,
+         (unsigned long long)(after.dropped - before.dropped));
+
+  int failures = 0;
+  if (fastMissed) failures++;
+  if (slow && after.dropped == before.dropped) failures++;
+  if (maxPublishMs > 5.0) failures++;
+  http.stop();
+  stream.stop();
+  for (const Client& c : cs) close(c.fd);
+  close(ep);
+  printf("%s (%d failures)\n", failures ? "FAIL" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,353 @@
+/*
+  lookback_ring_bench – LookbackRing append rate, window extraction, rules
+
+  Usage:
+    lookback_ring_bench [gb] [dir]       (default 1 GB, /tmp/lookback_bench)
+
+  10 kHz samples (five channels, values derived from the sample index)
+  in 33-sample packets, as the receiver appends them:
+
+    append      one ring of `gb` filled once (first touch of every page)
+                and once more (steady state, overwriting), without rules
+                and with four rules that never fire; Ms/s and the multiple
+                of the 10 kHz stream rate
+    extract     from a full ring, windows of 1 s to MAX_WINDOW_S marked
+                20 minutes back and written by the persist thread into
+                compressed and raw stores; rows, ms and Mrows/s
+    trimmed     a window starting before the oldest sample in the ring
+    rules       a 64 MB ring over three 105-s periods of a ramp and a
+                status bit: every threshold crossing and status edge
+                fires, and the ones within a window extend it
+    lapped      a 64 MB ring flooded while windows at its oldest edge are
+                written: the writer overtakes the copy, which must end
+                or restart there (torn / trimmed), never store a
+                half-overwritten row
+
+  Every capture is reopened and checked row by row against the source.
+  Exit status is non-zero on any wrong row, trigger or window count.
+*/
+
+#include "LookbackRing.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint64_t T0_US = 1760000000000000ull;   // 2025-10-09
+static const uint64_t PERIOD_US = 100;
+static const size_t PACKET = 33;
+static const size_t BLOCK = 1u << 16;               // samples generated between timed runs
+static const uint64_t RAMP = 1u << 20;              // ramp / status period, ~105 s
+static const uint64_t ARMED_AT = RAMP / 2 + 10000;  // 1 s after the ramp crosses its middle
+static const uint16_t DUR_US = 37;
+static const uint64_t SMALL_RING = 64ull << 20;
+static const uint64_t LAPPED_WINDOWS = 16;
+
+static double monotonicSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(CaptureStore::Record& r, uint64_t i) {
+  const uint64_t j = i & (RAMP - 1);
+  r.tUs = T0_US + i * PERIOD_US;
+  r.tUsEnd = r.tUs + DUR_US;
+  memset(r.ch, 0, sizeof(r.ch));
+  r.ch[0] = (float)(j >> 10);                         // 0..1023 ramp, crosses 511.5 at RAMP / 2
+  r.ch[1] = (float)(i % 1000) * 0.5f;
+  r.ch[2] = (float)(i >> 20);
+  r.ch[3] = (float)(i & 0xFFFF);
+  r.ch[4] = -(float)(i % 77);
+  r.status = (uint8_t)((j >= ARMED_AT ? 1 : 0) | ((i & 1024) ? 1u << 5 : 0));
+}
+
+static std::vector<std::string> channels() {
+  return std::vector<std::string>(CaptureStore::DEFAULT_CHANNELS,
+                                  CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+}
+
+static std::vector<LookbackRing::Rule> parseRules(const std::vector<std::string>& texts) {
+  std::vector<LookbackRing::Rule> rules;
+  for (const std::string& t : texts) {
+    LookbackRing::Rule r;
+    std::string err;
+    if (!LookbackRing::parseRule(t, channels(), r, err)) {
+      fprintf(stderr, "rule %s: %s\n", t.c_str(), err.c_str());
+      exit(1);
+    }
+    rules.push_back(r);
+  }
+  return rules;
+}
+
+// Appends samples [first, first + n) in packets; returns the seconds spent in append()
+static double append(LookbackRing& ring, uint64_t first, uint64_t n) {
+  static std::vector<CaptureStore::Record> block(BLOCK);
+  double spent = 0.0;
+  for (uint64_t at = 0; at < n; at += BLOCK) {
+    const size_t m = (size_t)std::min<uint64_t>(BLOCK, n - at);
+    for (size_t i = 0; i < m; ++i) fill(block[i], first + at + i);
+    const double t0 = monotonicSeconds();
+    for (size_t p = 0; p < m; p += PACKET) ring.append(&block[p], std::min(PACKET, m - p));
+    spent += monotonicSeconds() - t0;
+  }
+  return spent;
+}
+
+// Waits until window `id` is no longer pending
+static bool waitFor(const LookbackRing& ring, unsigned id, LookbackRing::Window& out) {
+  const double deadline = monotonicSeconds() + 60.0;
+  while (monotonicSeconds() < deadline) {
+    for (const LookbackRing::Window& w : ring.windows()) {
+      if (w.id == id && w.state != LookbackRing::WINDOW_PENDING) {
+        out = w;
+        return true;
+      }
+    }
+    usleep(1000);
+  }
+  return false;
+}
+
+// Until no window that the ring already covers is pending
+static bool waitCovered(const LookbackRing& ring) {
+  const double deadline = monotonicSeconds() + 60.0;
+  while (monotonicSeconds() < deadline) {
+    const uint64_t newest = ring.stats().newestUs;
+    bool pending = false;
+    for (const LookbackRing::Window& w : ring.windows()) {
+      pending = pending || (w.state == LookbackRing::WINDOW_PENDING && w.toUs <= newest);
+    }
+    if (!pending) return true;
+    usleep(1000);
+  }
+  return false;
+}
+
+// Capture rows against the source: contiguous samples, all columns; returns the number wrong
+static uint64_t verify(const LookbackRing::Window& w, uint64_t expectFirst, uint64_t expectRows) {
+  CaptureStore::Reader r;
+  if (!r.open(w.dir)) {
+    fprintf(stderr, "  %s: cannot open\n", w.dir.c_str());
+    return 1;
+  }
+  if (r.size() != w.rows || (expectRows && r.size() != expectRows)) {
+    fprintf(stderr, "  %s: %llu rows, window says %llu, expected %llu\n", w.dir.c_str(), (unsigned long long)r.size(),
+            (unsigned long long)w.rows, (unsigned long long)expectRows);
+    return 1;
+  }
+  std::vector<CaptureStore::Record> got(BLOCK);
+  uint64_t bad = 0, index = 0;
+  for (uint64_t row = 0; row < r.size(); row += BLOCK) {
+    const size_t n = r.read(row, BLOCK, got.data());
+    for (size_t k = 0; k < n; ++k) {
+      const CaptureStore::Record& g = got[k];
+      if (row + k == 0) {
+        index = (g.tUs - T0_US) / PERIOD_US;
+        if (expectFirst != UINT64_MAX && index != expectFirst) bad++;
+        if (g.tUs < w.fromUs && !w.trimmed) bad++;
+      }
+      CaptureStore::Record e;
+      fill(e, index + row + k);
+      bool ok = g.tUs == e.tUs && g.tUsEnd == e.tUsEnd && g.status == e.status && g.tUs <= w.toUs;
+      for (size_t c = 0; c < CaptureStore::DEFAULT_CHANNEL_COUNT; ++c) ok = ok && g.ch[c] == e.ch[c];
+      if (!ok) bad++;
+    }
+  }
+  if (bad) fprintf(stderr, "  %s: %llu wrong rows\n", w.dir.c_str(), (unsigned long long)bad);
+  return bad;
+}
+
+static uint64_t firstIndexAtOrAfter(uint64_t tUs) {
+  return tUs <= T0_US ? 0 : (tUs - T0_US + PERIOD_US - 1) / PERIOD_US;
+}
+
+static uint64_t benchRing(uint64_t bytes, const std::string& dir, bool withRules, uint32_t flags) {
+  const std::vector<std::string> none;
+  const std::vector<std::string> idle = { "switch_voltage_kv>2000", "switch_current_a<-1", "em_status:change",
+                                          "msw_a_status:rise" };
+  LookbackRing ring;
+  if (!ring.start(bytes, channels(), dir, parseRules(withRules ? idle : none), LookbackRing::DEFAULT_PRE_S,
+                  LookbackRing::DEFAULT_POST_S, flags)) {
+    fprintf(stderr, "start: %s\n", ring.error().c_str());
+    return 1;
+  }
+  const uint64_t cap = ring.stats().capacity;
+  const char* label = withRules ? "4 rules" : "no rules";
+
+  const double fillS = append(ring, 0, cap);
+  const double steadyS = append(ring, cap, cap);
+  printf("  %-34s %9.1f Ms/s %9.0fx\n", (std::string("first fill, ") + label).c_str(), cap / fillS / 1e6,
+         cap / fillS / (1e6 / PERIOD_US));
+  printf("  %-34s %9.1f Ms/s %9.0fx\n", (std::string("steady, ") + label).c_str(), cap / steadyS / 1e6,
+         cap / steadyS / (1e6 / PERIOD_US));
+  uint64_t errors = ring.stats().fired;
+  if (errors) fprintf(stderr, "  idle rules fired %llu times\n", (unsigned long long)errors);
+
+  // Windows 20 minutes back (within the ring for >= ~0.4 GB)
+  const uint64_t newestUs = ring.stats().newestUs;
+  const uint64_t centerUs = std::max<uint64_t>(ring.stats().oldestUs + (uint64_t)(LookbackRing::MAX_WINDOW_S * 1e6),
+                                     newestUs > 1200000000ull ? newestUs - 1200000000ull : 0);
+  if (centerUs + (uint64_t)(LookbackRing::MAX_WINDOW_S * 1e6) > newestUs) {
+    fprintf(stderr, "  ring too small for the extraction windows\n");
+    return errors + 1;
+  }
+  printf("  %-34s %9s %9s %10s %9s\n", flags ? "extract, compressed store" : "extract, raw store", "rows", "ms",
+         "Mrows/s", "MB/s");
+  const double lengths[] = { 1.0, 10.0, 60.0, LookbackRing::MAX_WINDOW_S };
+  for (double len : lengths) {
+    const unsigned id = ring.mark(centerUs, len / 2, len / 2, "bench");
+    LookbackRing::Window w;
+    if (!waitFor(ring, id, w) || w.state != LookbackRing::WINDOW_WRITTEN) {
+      fprintf(stderr, "  %.0f s window not written\n", len);
+      errors++;
+      continue;
+    }
+    const uint64_t first = firstIndexAtOrAfter(w.fromUs);
+    const uint64_t rows = (w.toUs - T0_US) / PERIOD_US - first + 1;
+    errors += verify(w, first, rows);
+    const double rowBytes = 8 + 2 + 4 * CaptureStore::DEFAULT_CHANNEL_COUNT + 1;
+    char name[32];
+    snprintf(name, sizeof(name), "%.0f s window", len);
+    printf("    %-30s %9llu %9.1f %10.1f %9.0f\n", name, (unsigned long long)w.rows, w.persistMs,
+           w.rows / w.persistMs / 1e3, w.rows * rowBytes / w.persistMs / 1e3);
+  }
+
+  // Starting before the oldest sample: trimmed to it
+  if (withRules) {
+    const LookbackRing::Stats s = ring.stats();
+    const unsigned id = ring.mark(s.oldestUs + 2000000, 10.0, 1.0, "trim");
+    LookbackRing::Window w;
+    if (!waitFor(ring, id, w) || !w.trimmed || w.torn) {
+      fprintf(stderr, "  window before the ring not trimmed\n");
+      errors++;
+    } else {
+      const uint64_t first = (s.oldestUs - T0_US) / PERIOD_US;
+      errors += verify(w, first, (w.toUs - T0_US) / PERIOD_US - first + 1);
+      printf("  %-34s %9llu rows from the oldest sample\n", "trimmed window", (unsigned long long)w.rows);
+    }
+  }
+  ring.stop();
+  return errors;
+}
+
+static uint64_t benchRules(const std::string& dir) {
+  LookbackRing ring;
+  const std::vector<LookbackRing::Rule> rules =
+      parseRules({ "switch_voltage_kv>511.5", "armed_status:rise", "armed_status:fall" });
+  if (!ring.start(SMALL_RING, channels(), dir, rules)) {
+    fprintf(stderr, "start: %s\n", ring.error().c_str());
+    return 1;
+  }
+  // Three periods and 10 s, a period at a time so no window is overwritten before it is written
+  const uint64_t periods = 3;
+  for (uint64_t p = 0; p < periods; ++p) {
+    append(ring, p * RAMP, RAMP);
+    if (!waitCovered(ring)) return 1;
+  }
+  append(ring, periods * RAMP, 100000);
+  if (!waitCovered(ring)) return 1;
+
+  // Per period: the ramp crossing opens a window, the rise 1 s later extends it;
+  // the fall at every period start after the first opens its own
+  uint64_t errors = 0;
+  const LookbackRing::Stats s = ring.stats();
+  const uint64_t expectFired = periods * 2 + periods, expectWindows = periods + periods;
+  if (s.fired != expectFired || s.marked != expectWindows || s.written != expectWindows || s.failed || s.torn) {
+    fprintf(stderr, "  %llu fired, %llu windows, %llu written (expected %llu, %llu)\n", (unsigned long long)s.fired,
+            (unsigned long long)s.marked, (unsigned long long)s.written, (unsigned long long)expectFired,
+            (unsigned long long)expectWindows);
+    errors++;
+  }
+  const uint64_t preRows = (uint64_t)(LookbackRing::DEFAULT_PRE_S * 1e6) / PERIOD_US;
+  const uint64_t postRows = (uint64_t)(LookbackRing::DEFAULT_POST_S * 1e6) / PERIOD_US;
+  for (const LookbackRing::Window& w : ring.windows()) {
+    const uint64_t at = (w.triggerUs - T0_US) / PERIOD_US;
+    uint64_t last = at + postRows;
+    if (w.reason == "switch_voltage_kv>511.5") {
+      last = at + (ARMED_AT - RAMP / 2) + postRows;
+      if (at % RAMP != RAMP / 2 || w.triggers != 2) errors++;
+    } else if (w.reason == "armed_status:fall") {
+      if (at % RAMP != 0 || w.triggers != 1) errors++;
+    } else {
+      errors++;
+    }
+    errors += verify(w, at - preRows, last - (at - preRows) + 1);
+  }
+  printf("  %-34s %9llu triggers, %llu windows, rows verified\n", "3 ramp periods, 3 rules",
+         (unsigned long long)s.fired, (unsigned long long)s.written);
+  ring.stop();
+  return errors;
+}
+
+static uint64_t benchLapped(const std::string& dir) {
+  LookbackRing ring;
+  if (!ring.start(SMALL_RING, channels(), dir, std::vector<LookbackRing::Rule>())) {
+    fprintf(stderr, "start: %s\n", ring.error().c_str());
+    return 1;
+  }
+  const uint64_t cap = ring.stats().capacity;
+  append(ring, 0, cap);
+
+  // One window at a time over the oldest half of the ring, the writer flooding until it is written
+  uint64_t next = cap;
+  uint64_t errors = 0, torn = 0, trimmed = 0, rows = 0, windows = 0;
+  while (windows < LAPPED_WINDOWS) {
+    const LookbackRing::Stats s = ring.stats();
+    const unsigned id = ring.mark(s.oldestUs, 0.0, (s.newestUs - s.oldestUs) * 0.5e-6, "lapped");
+    LookbackRing::Window w;
+    bool done = false;
+    while (!done) {
+      append(ring, next, cap / 16);
+      next += cap / 16;
+      for (const LookbackRing::Window& x : ring.windows()) {
+        if (x.id == id && x.state != LookbackRing::WINDOW_PENDING) {
+          w = x;
+          done = true;
+        }
+      }
+    }
+    windows++;
+    torn += w.torn;
+    trimmed += w.trimmed;
+    rows += w.rows;
+    if (w.state == LookbackRing::WINDOW_WRITTEN) errors += verify(w, UINT64_MAX, 0);
+  }
+  printf("  %-34s %9llu windows, %llu torn, %llu trimmed, %.1f M rows verified\n", "64 MB ring flooded",
+         (unsigned long long)windows,
+         (unsigned long long)torn, (unsigned long long)trimmed, rows / 1e6);
+  ring.stop();
+  return errors;
+}
+
+int main(int argc, char** argv) {
+  const double gb = argc > 1 ? atof(argv[1]) : 1.0;
+  const std::string dir = argc > 2 ? argv[2] : "/tmp/lookback_bench";
+  const std::string rm = "rm -rf '" + dir + "'";
+  if (system(rm.c_str()) != 0) return 1;
+  const uint64_t bytes = (uint64_t)(gb * 1073741824.0);
+  const uint64_t perSample = 8 + 2 + 4 * CaptureStore::DEFAULT_CHANNEL_COUNT + 1;
+  const uint64_t capacity = bytes / perSample / 64 * 64;
+  printf("look-back ring %.2f GB: %llu samples, %.1f min at 10 kHz\n", gb, (unsigned long long)capacity,
+         capacity * PERIOD_US / 60e6);
+  printf("  %-34s %14s %10s\n", "append, 33-sample packets", "rate", "x 10 kHz");
+
+  uint64_t errors = 0;
+  errors += benchRing(bytes, dir, false, CaptureStore::STORE_COMPRESSED);
+  errors += benchRing(bytes, dir, true, 0);
+  printf("rules and edges\n");
+  errors += benchRules(dir + "/rules");
+  printf("writer overtaking the copy\n");
+  errors += benchLapped(dir + "/lapped");
+
+  if (system(rm.c_str()) != 0) errors++;
+  printf("%s (%llu errors)\n", errors ? "FAIL" : "OK", (unsigned long long)errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/*
+  ntp_server – NTP time for the device, with kernel receive timestamps (NtpServer.h)
+
+  Replaces basic_ntp_server.py. Without --port it binds 123 and, when that
+  is refused (not root), 12300 like the Python server; the device's
+  NTPClient::begin() takes either.
+
+  Every --log S seconds (default 60) it prints the requests served, the
+  turnaround from kernel arrival to reply (p50 / p99 / max) and one line
+  per client with the offset of the client's clock and its reported round
+  trip over that period. --rt runs the loop SCHED_FIFO with its memory
+  locked, for a busy host where the wakeup would otherwise queue behind
+  other work (needs CAP_SYS_NICE).
+
+  --beacon S also multicasts a time beacon every S seconds (0.25 suits the
+  device's BeaconFilter) to --beacon-group, by default the device's NTP
+  group 239.9.9.34:13014, out of the interface with address --beacon-iface
+  (the one facing the device on a multi-homed host). Devices that hear
+  them stop polling and discipline their clock from the beacons.
+
+  Usage:
+    ntp_server [--port N] [--bind IP] [--stratum N] [--refid ABCD] [--log S] [--seconds N] [--rt]
+               [--beacon S] [--beacon-group IP:PORT] [--beacon-iface IP]
+*/
+
+#include "NtpServer.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int) { s_stop = 1; }
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+  NtpServer::Config cfg = NtpServer::defaultConfig();
+  bool portGiven = false, rt = false;
+  double logEvery = 60.0, seconds = 0.0, beaconEvery = 0.0;
+  std::string beaconGroup = "239.9.9.34";
+  uint16_t beaconPort = 13014;
+  const char* beaconIface = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasArg = i + 1 < argc;
+    if (!strcmp(argv[i], "--port") && hasArg) {
+      cfg.port = (uint16_t)atoi(argv[++i]);
+      portGiven = true;
+    } else if (!strcmp(argv[i], "--bind") && hasArg) {
+      cfg.bindIp = argv[++i];
+    } else if (!strcmp(argv[i], "--stratum") && hasArg) {
+      cfg.stratum = (uint8_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--refid") && hasArg) {
+      const char* id = argv[++i];
+      memset(cfg.refId, 0, sizeof(cfg.refId));
+      memcpy(cfg.refId, id, strnlen(id, sizeof(cfg.refId)));
+    } else if (!strcmp(argv[i], "--log") && hasArg) {
+      logEvery = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--seconds") && hasArg) {
+      seconds = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--rt")) {
+      rt = true;
+    } else if (!strcmp(argv[i], "--beacon") && hasArg) {
+      beaconEvery = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--beacon-group") && hasArg) {
+      beaconGroup = argv[++i];
+      const size_t colon = beaconGroup.find(':');
+      if (colon != std::string::npos) {
+        beaconPort = (uint16_t)atoi(beaconGroup.c_str() + colon + 1);
+        beaconGroup.resize(colon);
+      }
+    } else if (!strcmp(argv[i], "--beacon-iface") && hasArg) {
+      beaconIface = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--port N] [--bind IP] [--stratum N] [--refid ABCD] [--log S] [--seconds N] [--rt]\n"
+              "       [--beacon S] [--beacon-group IP:PORT] [--beacon-iface IP]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  NtpServer server;
+  if (!server.open(cfg)) {
+    if (portGiven || errno != EACCES) {
+      fprintf(stderr, "%s\n", server.error().c_str());
+      return 1;
+    }
+    fprintf(stderr, "port %u needs privileges, using 12300\n", (unsigned)cfg.port);
+    cfg.port = 12300;
+    if (!server.open(cfg)) {
+      fprintf(stderr, "%s\n", server.error().c_str());
+      return 1;
+    }
+  }
+  if (beaconEvery > 0 && !server.openBeacon(beaconGroup.c_str(), beaconPort, beaconIface, 1, beaconEvery)) {
+    fprintf(stderr, "%s\n", server.error().c_str());
+    return 1;
+  }
+  if (rt) {
+    sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = 50;
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0) perror("SCHED_FIFO");
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) perror("mlockall");
+  }
+  printf("ntp_server: %s:%u, stratum %u, refid %.4s, precision 2^%d s, host clock %s\n", cfg.bindIp,
+         (unsigned)server.port(), (unsigned)cfg.stratum, cfg.refId, (int)server.precision(),
+         server.hostSynced() ? "synchronized" : "not synchronized (serving it as the reference)");
+  if (beaconEvery > 0) printf("beacons: %s:%u every %.3f s\n", beaconGroup.c_str(), (unsigned)beaconPort, beaconEvery);
+  fflush(stdout);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  const Clock::time_point start = Clock::now();
+  Clock::time_point lastLog = start;
+  Clock::time_point nextBeacon = start;
+  uint64_t lastRequests = 0, lastDropped = 0, lastBeacons = 0;
+  const auto report = [&]() {
+    const NtpServer::Stats& s = server.stats();
+    printf("[%7.0fs] %llu requests (%llu dropped), turnaround p50 %.1f p99 %.1f max %.1f µs", secondsSince(start),
+           (unsigned long long)(s.requests - lastRequests), (unsigned long long)(s.dropped - lastDropped),
+           s.turnaroundPercentileUs(0.5), s.turnaroundPercentileUs(0.99), s.turnaroundMaxNs / 1e3);
+    if (beaconEvery > 0) printf(", %llu beacons", (unsigned long long)(s.beaconsSent - lastBeacons));
+    printf("\n");
+    server.printClients(stdout);
+    fflush(stdout);
+    server.clearWindow();
+    lastRequests = s.requests;
+    lastDropped = s.dropped;
+    lastBeacons = s.beaconsSent;
+  };
+
+  while (!s_stop && (seconds <= 0 || secondsSince(start) < seconds)) {
+    int timeoutMs = 200;
+    if (beaconEvery > 0) {
+      const Clock::time_point now = Clock::now();
+      if (now >= nextBeacon) {
+        // A missed slot is skipped rather than sent late in a burst
+        if (!server.sendBeacon()) fprintf(stderr, "%s\n", server.error().c_str());
+        nextBeacon += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(beaconEvery));
+        if (nextBeacon < now) nextBeacon = now;
+      }
+      const long long untilMs =
+          std::chrono::duration_cast<std::chrono::milliseconds>(nextBeacon - Clock::now()).count();
+      timeoutMs = (int)std::max(0LL, std::min<long long>(timeoutMs, untilMs));
+    }
+    if (server.poll(timeoutMs) < 0) {
+      fprintf(stderr, "%s\n", server.error().c_str());
+      return 1;
+    }
+    if (logEvery > 0 && secondsSince(lastLog) >= logEvery) {
+      report();
+      lastLog = Clock::now();
+    }
+  }
+  if (server.stats().requests != lastRequests || server.stats().dropped != lastDropped) report();
+  const NtpServer::Stats& s = server.stats();
+  printf("total: %llu requests, %llu dropped, %llu send errors, %llu without kernel timestamp, %llu batches",
+         (unsigned long long)s.requests, (unsigned long long)s.dropped, (unsigned long long)s.sendErrors,
+         (unsigned long long)s.noKernelStamp, (unsigned long long)s.batches);
+  if (beaconEvery > 0)
+    printf(", %llu beacons (%llu failed)", (unsigned long long)s.beaconsSent, (unsigned long long)s.beaconErrors);
+  printf("\n");
+  return 0;
+}
@@ -0,0 +1,328 @@
+/*
+  ntp_server_bench – NtpServer accuracy and load over loopback, against basic_ntp_server.py
+
+  Usage:
+    ntp_server_bench [--requests N] [--clients K] [--seconds S] [--no-python]
+
+  A reference client (RFC 5905 on-wire calculation, kernel receive
+  timestamps on its side too) sends N sequential requests (default 2000)
+  to an NtpServer on 127.0.0.1 and computes for each reply
+
+    offset  ((T2 - T1) + (T3 - T4)) / 2
+    delay   (T4 - T1) - (T3 - T2)
+
+  Client and server share the host clock, so the true offset is zero and
+  the measured one is the error a device would see on a symmetric path.
+  Then K clients (default 8) send back to back for S seconds (default 2)
+  for the request rate and the delay under load.
+
+  The same runs go against ../basic_ntp_server.py when python3 is there
+  (--no-python skips it). It leaves the receive and originate fields zero,
+  so its offset is the SNTP estimate T3 - (T1 + T4) / 2 and its delay the
+  whole round trip.
+
+  Exit code 1 if the C++ server's replies lack the originate echo or the
+  receive time, if T3 < T2, or if its per-client statistics do not match
+  what the client sent.
+*/
+
+#include "NtpServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint64_t NS_PER_S = 1000000000ull;
+
+static uint64_t realtimeNs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * NS_PER_S + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t getBe64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+  return v;
+}
+
+static void putBe64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (56 - 8 * i));
+}
+
+struct Probe {
+  std::vector<double> offsetUs;
+  std::vector<double> delayUs;
+  uint64_t timeouts = 0;
+  uint64_t noOriginate = 0;   // originate not our transmit time
+  uint64_t noReceive = 0;     // receive timestamp zero
+  uint64_t reversed = 0;      // T3 < T2
+};
+
+static int clientSocket(uint16_t port) {
+  const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+  timeval tv = { 1, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sockaddr_in to;
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_port = htons(port);
+  to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr*)&to, sizeof(to)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// One request/reply; false on timeout. Root delay carries the previous delay
+// like the device does (16.16 s: on loopback it often rounds to 0).
+static bool exchange(int fd, uint32_t rootDelay, Probe& p) {
+  uint8_t q[NtpServer::PACKET_SIZE];
+  memset(q, 0, sizeof(q));
+  q[0] = 0x23;
+  q[4] = (uint8_t)(rootDelay >> 24);
+  q[5] = (uint8_t)(rootDelay >> 16);
+  q[6] = (uint8_t)(rootDelay >> 8);
+  q[7] = (uint8_t)rootDelay;
+  const uint64_t t1 = realtimeNs();
+  const uint64_t t1Ntp = NtpServer::toNtp(t1);
+  putBe64(q + 40, t1Ntp);
+  if (send(fd, q, sizeof(q), 0) != (ssize_t)sizeof(q)) return false;
+
+  uint8_t r[64];
+  uint8_t control[64];
+  iovec iov = { r, sizeof(r) };
+  msghdr h;
+  memset(&h, 0, sizeof(h));
+  h.msg_iov = &iov;
+  h.msg_iovlen = 1;
+  h.msg_control = control;
+  h.msg_controllen = sizeof(control);
+  const ssize_t n = recvmsg(fd, &h, 0);
+  if (n < (ssize_t)NtpServer::PACKET_SIZE || (r[0] & 0x07) != 4) {
+    ++p.timeouts;
+    return false;
+  }
+  uint64_t t4 = 0;
+  for (cmsghdr* c = CMSG_FIRSTHDR(&h); c; c = CMSG_NXTHDR(&h, c)) {
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+      timespec ts;
+      memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+      t4 = (uint64_t)ts.tv_sec * NS_PER_S + (uint64_t)ts.tv_nsec;
+    }
+  }
+  if (t4 == 0) t4 = realtimeNs();
+
+  const uint64_t origin = getBe64(r + 24);
+  const uint64_t t2Ntp = getBe64(r + 32);
+  const uint64_t t3 = NtpServer::fromNtp(getBe64(r + 40));
+  if (origin != t1Ntp) ++p.noOriginate;
+  double offset, delay;
+  if (t2Ntp == 0) {
+    ++p.noReceive;
+    offset = (double)t3 - (t1 + (double)t4) / 2;
+    delay = (double)(t4 - t1);
+  } else {
+    const uint64_t t2 = NtpServer::fromNtp(t2Ntp);
+    if (t3 < t2) ++p.reversed;
+    offset = (((double)t2 - t1) + ((double)t3 - t4)) / 2;
+    delay = ((double)t4 - t1) - ((double)t3 - t2);
+  }
+  p.offsetUs.push_back(offset / 1e3);
+  p.delayUs.push_back(delay / 1e3);
+  return true;
+}
+
+static Probe sequential(uint16_t port, size_t n) {
+  Probe p;
+  const int fd = clientSocket(port);
+  if (fd < 0) return p;
+  uint32_t rootDelay = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (exchange(fd, rootDelay, p)) rootDelay = (uint32_t)(((uint64_t)std::max(0.0, p.delayUs.back()) << 16) / 1000000);
+    usleep(200);   // a request at a time, not a stream
+  }
+  close(fd);
+  return p;
+}
+
+static Probe load(uint16_t port, size_t clients, double seconds) {
+  std::vector<Probe> each(clients);
+  std::vector<std::thread> threads;
+  const Clock::time_point end = Clock::now() + std::chrono::microseconds((int64_t)(seconds * 1e6));
+  for (size_t k = 0; k < clients; ++k) {
+    threads.emplace_back([&, k]() {
+      const int fd = clientSocket(port);
+      if (fd < 0) return;
+      while (Clock::now() < end) exchange(fd, 0, each[k]);
+      close(fd);
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  Probe all;
+  for (const Probe& p : each) {
+    all.offsetUs.insert(all.offsetUs.end(), p.offsetUs.begin(), p.offsetUs.end());
+    all.delayUs.insert(all.delayUs.end(), p.delayUs.begin(), p.delayUs.end());
+    all.timeouts += p.timeouts;
+    all.noOriginate += p.noOriginate;
+    all.noReceive += p.noReceive;
+    all.reversed += p.reversed;
+  }
+  return all;
+}
+
+static double percentile(std::vector<double> v, double q, bool absolute = false) {
+  if (v.empty()) return 0.0;
+  if (absolute)
+    for (double& x : v) x = fabs(x);
+  std::sort(v.begin(), v.end());
+  size_t rank = (size_t)ceil(q * v.size());
+  return v[std::max<size_t>(rank, 1) - 1];
+}
+
+static void report(const char* name, const Probe& seq, const Probe& busy, double seconds) {
+  printf("%-22s offset p50 %+7.1f  |offset| p99 %7.1f  delay p50 %7.1f p99 %7.1f µs | load %8.0f req/s, delay p99 %8.1f µs\n",
+         name, percentile(seq.offsetUs, 0.5), percentile(seq.offsetUs, 0.99, true), percentile(seq.delayUs, 0.5),
+         percentile(seq.delayUs, 0.99), busy.delayUs.size() / seconds, percentile(busy.delayUs, 0.99));
+  if (seq.timeouts + busy.timeouts)
+    printf("%-22s %llu requests unanswered\n", "", (unsigned long long)(seq.timeouts + busy.timeouts));
+}
+
+static uint16_t freePort() {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in a;
+  memset(&a, 0, sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (sockaddr*)&a, sizeof(a));
+  socklen_t len = sizeof(a);
+  getsockname(fd, (sockaddr*)&a, &len);
+  close(fd);
+  return ntohs(a.sin_port);
+}
+
+int main(int argc, char** argv) {
+  size_t requests = 2000, clients = 8;
+  double seconds = 2.0;
+  bool python = true;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasArg = i + 1 < argc;
+    if (!strcmp(argv[i], "--requests") && hasArg) requests = (size_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--clients") && hasArg) clients = (size_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seconds") && hasArg) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--no-python")) python = false;
+    else {
+      fprintf(stderr, "usage: %s [--requests N] [--clients K] [--seconds S] [--no-python]\n", argv[0]);
+      return 2;
+    }
+  }
+  int failures = 0;
+
+  // ---- C++ server ----
+  NtpServer server;
+  NtpServer::Config cfg = NtpServer::defaultConfig();
+  cfg.bindIp = "127.0.0.1";
+  cfg.port = 0;
+  if (!server.open(cfg)) {
+    fprintf(stderr, "%s\n", server.error().c_str());
+    return 1;
+  }
+  std::atomic<bool> stop(false);
+  std::thread serving([&]() {
+    while (!stop.load()) server.poll(20);
+  });
+  const Probe seq = sequential(server.port(), requests);
+  const Probe busy = load(server.port(), clients, seconds);
+  stop = true;
+  serving.join();
+
+  printf("%zu sequential requests, then %zu clients for %.1f s, over loopback\n\n", requests, clients, seconds);
+  report("ntp_server (C++)", seq, busy, seconds);
+  const NtpServer::Stats& s = server.stats();
+  printf("%-22s turnaround p50 %.1f p99 %.1f max %.1f µs, %.2f requests per wakeup\n", "",
+         s.turnaroundPercentileUs(0.5), s.turnaroundPercentileUs(0.99), s.turnaroundMaxNs / 1e3,
+         s.batches ? (double)s.requests / s.batches : 0.0);
+
+  const uint64_t sent = seq.offsetUs.size() + busy.offsetUs.size();
+  const uint64_t protocol = seq.noOriginate + seq.noReceive + seq.reversed + busy.noOriginate + busy.noReceive +
+                            busy.reversed;
+  if (protocol) {
+    printf("  FAIL: %llu replies without originate echo or receive time, or with T3 < T2\n",
+           (unsigned long long)protocol);
+    ++failures;
+  }
+  if (s.requests != sent || s.noKernelStamp) {
+    printf("  FAIL: server answered %llu (%llu without kernel timestamp), client got %llu\n",
+           (unsigned long long)s.requests, (unsigned long long)s.noKernelStamp, (unsigned long long)sent);
+    ++failures;
+  }
+  const auto it = server.clients().find(htonl(INADDR_LOOPBACK));
+  if (it == server.clients().end() || it->second.requests != s.requests || it->second.offsets != s.requests ||
+      it->second.delays >= seq.delayUs.size()) {
+    printf("  FAIL: per-client statistics do not match the requests sent\n");
+    ++failures;
+  } else {
+    const NtpServer::ClientStats& c = it->second;
+    printf("%-22s server's view of the client: offset %+.1f µs (σ %.1f), reported rtt %.1f µs over %llu requests\n",
+           "", c.offsetMean / 1e3, c.offsetStddev() / 1e3, c.delaySum / c.delays / 1e3,
+           (unsigned long long)c.requests);
+  }
+
+  // ---- basic_ntp_server.py ----
+  if (python && access("../basic_ntp_server.py", R_OK) == 0 && system("python3 -c pass > /dev/null 2>&1") == 0) {
+    const uint16_t port = freePort();
+    const std::string code = "import sys; sys.path.insert(0, '..'); import basic_ntp_server as s; "
+                             "s.BasicNTPServer('127.0.0.1', " + std::to_string(port) + ").start()";
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+      if (!freopen("/dev/null", "w", stdout)) _exit(127);
+      execlp("python3", "python3", "-c", code.c_str(), (char*)nullptr);
+      _exit(127);
+    }
+    // Wait for it to answer
+    Probe warm;
+    for (int k = 0; k < 50 && warm.delayUs.empty(); ++k) {
+      usleep(100000);
+      const int fd = clientSocket(port);
+      timeval tv = { 0, 100000 };
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+      exchange(fd, 0, warm);
+      close(fd);
+    }
+    if (warm.delayUs.empty()) {
+      printf("%-22s did not answer\n", "basic_ntp_server.py");
+    } else {
+      const Probe pseq = sequential(port, requests);
+      const Probe pbusy = load(port, clients, seconds);
+      report("basic_ntp_server.py", pseq, pbusy, seconds);
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+  } else if (python) {
+    printf("%-22s not measured (no python3 or ../basic_ntp_server.py)\n", "basic_ntp_server.py");
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+/*
+  plot_query_bench – latency of PlotQuery across zoom levels
+
+  Usage:
+    plot_query_bench [hours]              synthetic compressed store (default 1 h at 10 kHz)
+    plot_query_bench --store DIR          an existing store
+
+  For windows of the whole store, 10 min, 1 min, 10 s, 1 s and 100 ms
+  (random positions), times minMax() at 1000 px and lttb() at 1000
+  points, and compares every bucket with a brute-force scan of the rows:
+  zoom levels that snap edge chunks report how many buckets differ, the
+  others must match exactly. Finally times the same full-range query
+  through the HTTP API (QueryApi on 127.0.0.1).
+*/
+
+#include "HttpServer.h"
+#include "PlotQuery.h"
+#include "QueryApi.h"
+
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static const uint64_t T0_US = 1760000000000000ull;
+static const size_t WIDTH = 1000;
+static const uint16_t HTTP_PORT = 18081;
+
+static bool makeStore(const std::string& dir, double hours) {
+  std::string rm = "rm -rf '" + dir + "'";
+  if (system(rm.c_str()) != 0) return false;
+  mkdir(dir.c_str(), 0755);
+  const std::vector<std::string> channels(CaptureStore::DEFAULT_CHANNELS,
+                                          CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+  CaptureStore::Writer w;
+  if (!w.create(dir + "/live", channels, CaptureStore::STORE_COMPRESSED)) {
+    fprintf(stderr, "%s\n", w.error().c_str());
+    return false;
+  }
+  // Shots every 10 s on top of 12-bit noise, a lost packet now and then
+  std::mt19937 rng(7);
+  const uint64_t total = (uint64_t)(hours * 3600 * 10000);
+  uint64_t t = T0_US;
+  CaptureStore::Record pkt[33];
+  memset(pkt, 0, sizeof(pkt));
+  for (uint64_t i = 0; i < total; i += 33) {
+    const size_t n = (size_t)std::min<uint64_t>(33, total - i);
+    if (rng() % 3000 == 0) t += 3300;
+    for (size_t k = 0; k < n; ++k) {
+      CaptureStore::Record& r = pkt[k];
+      t += 100;
+      r.tUs = t + rng() % 5;
+      r.tUsEnd = r.tUs + 9;
+      const double phase = (double)((i + k) % 100000) / 100000.0;
+      const double shot = phase < 0.05 ? 1500.0 * phase / 0.05 : (phase < 0.052 ? 1500.0 * cos(3000 * (phase - 0.05)) : 0);
+      for (size_t c = 0; c < 5; ++c) {
+        const int counts = 2010 + (int)(shot * (c == 4 ? 0.01 : 1.0)) + (int)(rng() % 5) - 2;
+        r.ch[c] = (float)counts * 0.0044f - 8.94f;
+      }
+      r.status = phase < 0.052 ? 3 : 1;
+    }
+    if (!w.append(pkt, n)) {
+      fprintf(stderr, "%s\n", w.error().c_str());
+      return false;
+    }
+  }
+  w.close();
+  return true;
+}
+
+// Reference buckets from every row in range
+static void bruteForce(const CaptureStore::Reader& r, size_t ch, uint64_t t0, uint64_t t1, size_t width,
+                       std::vector<PlotQuery::Bucket>& out) {
+  const uint64_t bw = std::max<uint64_t>(1, (t1 - t0 + width - 1) / width);
+  out.assign((size_t)((t1 - t0 + bw - 1) / bw), PlotQuery::Bucket());
+  for (PlotQuery::Bucket& b : out) {
+    b.min = INFINITY;
+    b.max = -INFINITY;
+  }
+  uint64_t first, last;
+  r.timeRange(t0, t1, first, last);
+  // Rows slightly before first can still fall in range when time steps back
+  for (uint64_t row = first; row < last;) {
+    CaptureStore::BlockView v;
+    r.block(row / CaptureStore::BLOCK_SAMPLES, v, BlockCodec::COL_T | BlockCodec::colChannel(ch));
+    const uint64_t end = std::min<uint64_t>(last, v.first + v.rows);
+    for (; row < end; ++row) {
+      const uint64_t t = v.t[row - v.first];
+      if (t < t0 || t >= t1) continue;
+      PlotQuery::Bucket& b = out[(size_t)((t - t0) / bw)];
+      const float x = v.ch[ch][row - v.first];
+      b.rows++;
+      b.min = std::min(b.min, x);
+      b.max = std::max(b.max, x);
+    }
+  }
+}
+
+static double httpGet(const std::string& target, size_t& bytes) {
+  const Clock::time_point t = Clock::now();
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in a;
+  memset(&a, 0, sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_port = htons(HTTP_PORT);
+  a.sin_addr.s_addr = inet_addr("127.0.0.1");
+  bytes = 0;
+  if (connect(fd, (sockaddr*)&a, sizeof(a)) == 0) {
+    const std::string req = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, req.data(), req.size(), 0);
+    char buf[65536];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) bytes += (size_t)n;
+  }
+  close(fd);
+  return secondsSince(t);
+}
+
+int main(int argc, char** argv) {
+  std::string root = "/tmp/plot_query_bench";
+  if (argc > 2 && !strcmp(argv[1], "--store")) {
+    root = argv[2];
+  } else {
+    const double hours = argc > 1 ? atof(argv[1]) : 1.0;
+    const Clock::time_point t = Clock::now();
+    if (!makeStore(root, hours)) return 1;
+    printf("built %.1f h store in %.1f s\n", hours, secondsSince(t));
+  }
+
+  CaptureStore::Reader r;
+  const std::string dir = root + "/live";
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return 1;
+  }
+  if (r.size() == 0) return 1;
+  const uint64_t first = r.timeAt(0), last = r.timeAt(r.size() - 1) + 1;
+  printf("store %s: %llu rows, %.1f min\n", dir.c_str(), (unsigned long long)r.size(), (last - first) / 60e6);
+
+  const double windowsS[] = { 0, 600, 60, 10, 1, 0.1 };
+  std::mt19937_64 rng(3);
+  int failures = 0;
+  printf("%-9s %11s %11s %9s %11s %s\n", "window", "minmax", "lttb", "chunks", "rows read", "vs brute force");
+  for (double ws : windowsS) {
+    const uint64_t span = ws == 0 ? last - first : (uint64_t)(ws * 1e6);
+    if (span > last - first) continue;
+    const int reps = ws == 0 ? 5 : 20;
+    double mmS = 0, lS = 0;
+    PlotQuery::Stats st = { 0, 0, 0 };
+    size_t differ = 0, buckets = 0;
+    bool snapped = false;
+    for (int k = 0; k < reps; ++k) {
+      const uint64_t t0 = ws == 0 ? first : first + rng() % (last - first - span + 1);
+      const uint64_t t1 = t0 + span;
+      std::vector<PlotQuery::Bucket> got, want;
+      Clock::time_point t = Clock::now();
+      PlotQuery::minMax(r, 0, t0, t1, WIDTH, got, &st);
+      mmS += secondsSince(t);
+      std::vector<PlotQuery::Point> pts;
+      t = Clock::now();
+      PlotQuery::lttb(r, 0, t0, t1, WIDTH, pts);
+      lS += secondsSince(t);
+      if (pts.size() > WIDTH) failures++;
+
+      if (k < 2) {
+        bruteForce(r, 0, t0, t1, WIDTH, want);
+        snapped = snapped || st.snapped > 0;
+        for (size_t i = 0; i < want.size() && i < got.size(); ++i) {
+          buckets++;
+          if (got[i].min != want[i].min || got[i].max != want[i].max) differ++;
+        }
+      }
+    }
+    char name[16];
+    if (ws == 0) snprintf(name, sizeof(name), "all");
+    else snprintf(name, sizeof(name), ws >= 60 ? "%.0f min" : (ws >= 1 ? "%.0f s" : "%.0f ms"),
+                  ws >= 60 ? ws / 60 : (ws >= 1 ? ws : ws * 1000));
+    if (!snapped && differ) failures++;
+    printf("%-9s %8.3f ms %8.3f ms %9llu %11llu %s%zu/%zu buckets differ\n", name, mmS / reps * 1e3, lS / reps * 1e3,
+           (unsigned long long)st.chunks, (unsigned long long)st.scannedRows, snapped ? "snapped, " : "exact, ", differ,
+           buckets);
+  }
+
+  // Same full-range query through the HTTP API
+  QueryApi api(root);
+  HttpServer http;
+  if (http.start("127.0.0.1", HTTP_PORT,
+                 [&api](const std::string& p, const HttpServer::Query& q) { return api.handle(p, q); })) {
+    const std::string target = "/api/minmax?store=live&channel=" + std::string(r.channelName(0)) + "&width=1000";
+    size_t bytes = 0;
+    double best = 1e9;
+    for (int k = 0; k < 10; ++k) best = std::min(best, httpGet(target, bytes));
+    printf("http      GET %s: %.3f ms, %zu bytes\n", target.c_str(), best * 1e3, bytes);
+    if (bytes == 0) failures++;
+    http.stop();
+  }
+
+  printf("%s (%d failures)\n", failures ? "FAIL" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,319 @@
+/*
+  remc_receiver – telemetry multicast to CaptureStore
+
+  Joins the telemetry group and appends every sample to columnar stores
+  (CaptureStore.h), one set per unit on the group (NodeDemux.h: by sender
+  address and schema node_name):
+
+    <store>/nodes/<node>/live/                  live stream (flags 0), appended across runs
+    <store>/nodes/<node>/batches/batch_NNNN/    one store per collect dump (flags 1),
+                                                closed at the batch-end marker (flags 2)
+
+  Samples are decoded with the layout compiled from each unit's schema
+  (SchemaDecoder.h). Spectral, fault and trace packets are ignored here. Readers (the Flask
+  app through capture_store.py, capture_tool, the export and query paths)
+  open the same directories while the receiver is running.
+
+  The receive loop never touches the disk: decoded packets go through a
+  lock-free queue to the node's writer thread (StoreWriter.h) that appends them,
+  writes sealed blocks through io_uring and fdatasyncs the stores every
+  second. --queue-mb bounds the memory held per node while the disk is
+  slow (a full queue drops packets and counts them); --no-io-uring writes with
+  plain pwrite on the writer thread.
+
+  New stores are created compressed (BlockCodec.h): sealed blocks go to
+  blocks.dat and their raw rows are punched out. --raw keeps plain column
+  files; an existing store keeps whatever it was created with.
+
+  Plot queries over the same stores (QueryApi.h) are served on
+  http://127.0.0.1:<port>/api/... (default 8081, --http 0 disables),
+  including /api/merged, one channel of every node on a common time grid.
+  The live samples are pushed as Server-Sent Events on /live (LiveStream.h):
+  --push-hz frames a second (default 20, 0 disables). --http-bind opens
+  both to the LAN for a dashboard on another machine.
+
+  Every decoded sample (live and collected) is also published to the
+  shared-memory ring --ring (SampleRing.h, default /remc_samples, "none"
+  disables) for local consumers; --ring-size sets its capacity in samples.
+  The ring and the live push carry one node: --primary (a node_name or a
+  nodes/ directory name), by default the first one heard.
+
+  --lookback-gb N keeps the newest N GB of that node's live samples in
+  memory (LookbackRing.h, ~58 min a GB at 10 kHz) from the first one heard.
+  Windows of it are written to <store>/nodes/<node>/captures/capture_NNNN
+  after the fact: GET /api/capture?pre=&post=&reason= marks the seconds
+  around the newest sample, and every --trigger rule ("switch_current_a>500",
+  "armed_status:rise", repeatable) marks --pre-s before and --post-s after
+  the sample it fires on (defaults 10 and 5). GET /api/captures lists them.
+
+  Usage:
+    remc_receiver [--store DIR] [--iface 192.168.1.10] [--seconds N] [--raw]
+                  [--http PORT] [--http-bind IP] [--push-hz N]
+                  [--ring NAME] [--ring-size N] [--queue-mb N] [--no-io-uring]
+                  [--primary NODE] [--max-nodes N]
+                  [--lookback-gb N] [--trigger RULE]... [--pre-s S] [--post-s S]
+*/
+
+#include "CaptureStore.h"
+#include "HttpServer.h"
+#include "LiveStream.h"
+#include "LookbackRing.h"
+#include "NeutrinoPacket.h"
+#include "NodeDemux.h"
+#include "QueryApi.h"
+#include "SampleRing.h"
+#include "StoreWriter.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+static const char* TELEMETRY_GROUP = "239.9.9.33";
+static const uint16_t TELEMETRY_PORT = 13013;
+static const double STATS_INTERVAL_S = 10.0;
+static const uint16_t DEFAULT_HTTP_PORT = 8081;
+static const double DEFAULT_PUSH_HZ = 20.0;
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int) { s_stop = 1; }
+
+static double monotonicSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static std::vector<std::string> defaultChannels() {
+  return std::vector<std::string>(CaptureStore::DEFAULT_CHANNELS,
+                                  CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+}
+
+int main(int argc, char** argv) {
+  std::string storeDir = "capture";
+  const char* iface = nullptr;
+  double seconds = 0.0;
+  uint32_t storeFlags = CaptureStore::STORE_COMPRESSED;
+  unsigned httpPort = DEFAULT_HTTP_PORT;
+  const char* httpBind = "127.0.0.1";
+  double pushHz = DEFAULT_PUSH_HZ;
+  std::string ringName = SampleRing::RING_NAME;
+  uint64_t ringSize = SampleRing::DEFAULT_CAPACITY;
+  size_t queueBytes = StoreWriter::DEFAULT_QUEUE_BYTES;
+  bool useIoUring = true;
+  std::string primary;
+  size_t maxNodes = NodeDemux::DEFAULT_MAX_NODES;
+  double lookbackGb = 0.0;
+  std::vector<LookbackRing::Rule> rules;
+  double preS = LookbackRing::DEFAULT_PRE_S, postS = LookbackRing::DEFAULT_POST_S;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--store") && i + 1 < argc) storeDir = argv[++i];
+    else if (!strcmp(argv[i], "--iface") && i + 1 < argc) iface = argv[++i];
+    else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--raw")) storeFlags = 0;
+    else if (!strcmp(argv[i], "--http") && i + 1 < argc) httpPort = (unsigned)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--http-bind") && i + 1 < argc) httpBind = argv[++i];
+    else if (!strcmp(argv[i], "--push-hz") && i + 1 < argc) pushHz = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--ring") && i + 1 < argc) ringName = argv[++i];
+    else if (!strcmp(argv[i], "--ring-size") && i + 1 < argc) ringSize = strtoull(argv[++i], nullptr, 0);
+    else if (!strcmp(argv[i], "--queue-mb") && i + 1 < argc) queueBytes = (size_t)(atof(argv[++i]) * 1024 * 1024);
+    else if (!strcmp(argv[i], "--no-io-uring")) useIoUring = false;
+    else if (!strcmp(argv[i], "--primary") && i + 1 < argc) primary = argv[++i];
+    else if (!strcmp(argv[i], "--max-nodes") && i + 1 < argc) maxNodes = (size_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--lookback-gb") && i + 1 < argc) lookbackGb = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--pre-s") && i + 1 < argc) preS = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--post-s") && i + 1 < argc) postS = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--trigger") && i + 1 < argc) {
+      LookbackRing::Rule rule;
+      std::string err;
+      if (!LookbackRing::parseRule(argv[++i], defaultChannels(), rule, err)) {
+        fprintf(stderr, "[Receiver] --trigger %s: %s\n", argv[i], err.c_str());
+        return 2;
+      }
+      rules.push_back(rule);
+    } else {
+      fprintf(stderr, "usage: %s [--store DIR] [--iface IP] [--seconds N] [--raw] [--http PORT] "
+                      "[--http-bind IP] [--push-hz N] [--ring NAME] [--ring-size N] [--queue-mb N] "
+                      "[--no-io-uring] [--primary NODE] [--max-nodes N] [--lookback-gb N] [--trigger RULE]... "
+                      "[--pre-s S] [--post-s S]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  NodeDemux demux;
+  NodeDemux::Config dcfg = NodeDemux::defaultConfig(storeDir, defaultChannels());
+  dcfg.storeFlags = storeFlags;
+  dcfg.queueBytes = queueBytes;
+  dcfg.useIoUring = useIoUring;
+  dcfg.maxNodes = maxNodes;
+  if (!demux.start(dcfg)) {
+    fprintf(stderr, "[Receiver] %s\n", demux.error().c_str());
+    return 1;
+  }
+
+  SampleRing::Writer ring;
+  if (ringName != "none" && !ring.create(ringName, defaultChannels(), ringSize)) {
+    fprintf(stderr, "[Receiver] sample ring disabled: %s\n", ring.error().c_str());
+  }
+
+  QueryApi api(storeDir);
+  LookbackRing lookback;
+  bool lookbackFailed = lookbackGb <= 0;
+  LiveStream stream;
+  const bool streamUp = httpPort && pushHz > 0 && stream.start(defaultChannels(), pushHz);
+  HttpServer http;
+  if (streamUp) {
+    http.setTakeover([&stream](int client, const std::string& path, const HttpServer::Query&) {
+      if (path != "/live") return false;
+      stream.attach(client);
+      return true;
+    });
+  }
+  const bool httpUp = httpPort && http.start(httpBind, (uint16_t)httpPort,
+      [&api, &lookback](const std::string& path, const HttpServer::Query& q) {
+        if (path == "/api/capture" || path == "/api/captures") return lookback.handle(path, q);
+        return api.handle(path, q);
+      });
+  if (httpPort && !httpUp) fprintf(stderr, "[Receiver] HTTP API disabled: %s\n", http.error().c_str());
+
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd < 0) { perror("socket"); return 1; }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  int rcvbuf = 8 * 1024 * 1024;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(TELEMETRY_PORT);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (sockaddr*)&local, sizeof(local)) < 0) { perror("bind"); return 1; }
+
+  ip_mreq mreq;
+  mreq.imr_multiaddr.s_addr = inet_addr(TELEMETRY_GROUP);
+  mreq.imr_interface.s_addr = iface ? inet_addr(iface) : htonl(INADDR_ANY);
+  if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+    perror("IP_ADD_MEMBERSHIP");
+    return 1;
+  }
+  timeval tv = { 0, 200000 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  // Ring, live push and look-back follow the primary node
+  const size_t NO_NODE = (size_t)-1;
+  size_t primaryIndex = NO_NODE;
+  uint64_t samples = 0, collected = 0;
+  demux.setSampleHook([&](size_t index, const CaptureStore::Record* r, size_t n, uint32_t flags) {
+    samples += n;
+    if (flags == Neutrino::FLAGS_COLLECTED) collected += n;
+    if (primaryIndex == NO_NODE) {
+      const NodeDemux::NodeStats ns = demux.nodeStats(index);
+      if (!primary.empty() && primary != ns.name && primary != ns.dir) return;
+      primaryIndex = index;
+      printf("[Receiver] ring and live push follow %s\n", ns.dir.c_str());
+      fflush(stdout);
+    }
+    if (index != primaryIndex) return;
+    ring.publish(r, n, (uint8_t)flags);
+    if (flags != Neutrino::FLAGS_NORMAL) return;
+    if (streamUp) stream.publish(r, n);
+    if (!lookbackFailed && !lookback.running()) {
+      const std::string dir = storeDir + "/nodes/" + demux.nodeStats(index).dir + "/captures";
+      if (lookback.start((uint64_t)(lookbackGb * 1073741824.0), defaultChannels(), dir, rules, preS, postS,
+                         storeFlags)) {
+        printf("[Receiver] look-back ring: %.1f GB, %llu samples, %zu trigger rules -> %s\n",
+               lookback.stats().bytes / 1073741824.0, (unsigned long long)lookback.stats().capacity, rules.size(),
+               dir.c_str());
+      } else {
+        fprintf(stderr, "[Receiver] look-back ring disabled: %s\n", lookback.error().c_str());
+        lookbackFailed = true;
+      }
+      fflush(stdout);
+    }
+    if (lookback.running()) lookback.append(r, n);
+  });
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  printf("[Receiver] %s:%u -> %s/nodes (%s writes)\n", TELEMETRY_GROUP, TELEMETRY_PORT, storeDir.c_str(),
+         useIoUring ? "io_uring" : "pwrite");
+  if (httpUp) printf("[Receiver] plot queries on http://%s:%u/api/\n", httpBind, httpPort);
+  if (httpUp && streamUp) printf("[Receiver] live push at %.0f Hz on http://%s:%u/live\n", pushHz, httpBind, httpPort);
+  if (ring.isOpen()) printf("[Receiver] samples also in shared memory %s\n", ringName.c_str());
+
+  const double start = monotonicSeconds();
+  double lastStats = start;
+  uint64_t packets = 0;
+  uint8_t buf[2048];
+
+  while (!s_stop) {
+    const double now = monotonicSeconds();
+    if (seconds > 0 && now - start >= seconds) break;
+    if (now - lastStats >= STATS_INTERVAL_S) {
+      const NodeDemux::Stats ds = demux.stats();
+      printf("[Receiver] %llu packets, %llu samples (%llu collected), %zu nodes, %llu held for a name, "
+             "%llu dropped, %llu unrouted\n", (unsigned long long)packets, (unsigned long long)samples,
+             (unsigned long long)collected, demux.nodeCount(), (unsigned long long)ds.held,
+             (unsigned long long)ds.dropped, (unsigned long long)ds.unrouted);
+      for (size_t i = 0; i < demux.nodeCount(); ++i) {
+        const NodeDemux::NodeStats ns = demux.nodeStats(i);
+        const StoreWriter::Stats& ws = ns.writer;
+        char layout[32];
+        if (ns.sampleBytes) snprintf(layout, sizeof(layout), "%u-byte samples", ns.sampleBytes);
+        else snprintf(layout, sizeof(layout), "fixed 42-byte layout");
+        printf("[Receiver]   %s: live %llu rows, %llu gaps (%llu samples missing), %llu backwards, "
+               "%llu batches, %llu rejected, %s\n", ns.dir.c_str(), (unsigned long long)ws.liveRows,
+               (unsigned long long)ns.live.gaps, (unsigned long long)ns.live.missing,
+               (unsigned long long)(ns.live.backwards + ns.collected.backwards), (unsigned long long)ns.batches,
+               (unsigned long long)ns.rejected, layout);
+        printf("[Receiver]     writer queue %.1f MB (max %.1f), %llu samples dropped, writes p99 < %.1f ms, "
+               "sync p99 < %.1f ms, %llu I/O errors\n", ws.queueBytes / 1048576.0, ws.maxQueueBytes / 1048576.0,
+               (unsigned long long)ws.droppedSamples, IoRing::percentileUs(ws.io.writeLatencyUs, 0.99) / 1e3,
+               IoRing::percentileUs(ws.io.syncLatencyUs, 0.99) / 1e3, (unsigned long long)ws.io.failed);
+      }
+      if (lookback.running()) {
+        const LookbackRing::Stats ls = lookback.stats();
+        const double heldMin = ls.held > 1 ? (ls.newestUs - ls.oldestUs) / 60e6 : 0.0;
+        printf("[Receiver]   look-back %.1f of %.1f min, %llu triggers, %llu captures written (%llu pending, "
+               "%llu failed, %llu trimmed, %llu torn)\n", heldMin,
+               ls.held > 1 ? heldMin * ls.capacity / ls.held : 0.0, (unsigned long long)ls.fired,
+               (unsigned long long)ls.written, (unsigned long long)(ls.marked - ls.written - ls.failed),
+               (unsigned long long)ls.failed, (unsigned long long)ls.trimmed, (unsigned long long)ls.torn);
+      }
+      for (const SampleRing::ReaderInfo& r : ring.readers()) {
+        printf("[Receiver]   ring reader pid %u: %llu behind, %llu overruns\n", r.pid, (unsigned long long)r.lag,
+               (unsigned long long)r.overruns);
+      }
+      fflush(stdout);
+      lastStats = now;
+    }
+
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    const ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr*)&from, &fromLen);
+    if (n > 0 && demux.handle(from, buf, (size_t)n)) packets++;
+  }
+
+  http.stop();
+  lookback.stop();
+  stream.stop();
+  ring.close();
+  demux.stop();
+  close(fd);
+  uint64_t rejected = 0;
+  for (size_t i = 0; i < demux.nodeCount(); ++i) rejected += demux.nodeStats(i).rejected;
+  printf("[Receiver] stopped: %llu packets, %llu samples from %zu nodes, %llu rejected\n",
+         (unsigned long long)packets, (unsigned long long)samples, demux.nodeCount(), (unsigned long long)rejected);
+  return 0;
+}
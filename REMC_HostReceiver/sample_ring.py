@@ -0,0 +1,133 @@
+"""
+Live decoded samples from remc_receiver's shared-memory ring (SampleRing.h).
+
+Binds libremc_ring.so (built next to this file, see README) with ctypes.
+Samples arrive already decoded, one 64-byte slot each, so following the
+live stream costs no socket and no packet parsing:
+
+    with SampleRingReader() as ring:
+        while True:
+            if ring.wait(1.0):
+                s = ring.read()          # numpy structured array (SLOT_DTYPE)
+                print(len(s), s['ch'][:, 0].max(), ring.overruns)
+
+With numpy, read() returns a view of the reader's buffer that stays
+valid until the next read() (copy it to keep it); without numpy it
+returns a list of Slot structures. Every reader has its own cursor; a
+reader that falls more than the ring's capacity behind skips the lost
+samples and counts them in `overruns`.
+"""
+
+import ctypes
+import os
+
+try:
+    import numpy as np
+except ImportError:  # read() falls back to ctypes structures
+    np = None
+
+RING_NAME = '/remc_samples'
+RING_CHANNELS = 10
+LIBRARY = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'libremc_ring.so')
+
+
+class Slot(ctypes.Structure):
+    _fields_ = [('t_us', ctypes.c_uint64),
+                ('t_us_end', ctypes.c_uint64),
+                ('ch', ctypes.c_float * RING_CHANNELS),
+                ('status', ctypes.c_uint8),
+                ('flags', ctypes.c_uint8),
+                ('reserved', ctypes.c_uint8 * 6)]
+
+
+assert ctypes.sizeof(Slot) == 64
+
+if np is not None:
+    SLOT_DTYPE = np.dtype([('t_us', '<u8'), ('t_us_end', '<u8'), ('ch', '<f4', (RING_CHANNELS,)),
+                           ('status', 'u1'), ('flags', 'u1'), ('reserved', 'u1', (6,))])
+    assert SLOT_DTYPE.itemsize == ctypes.sizeof(Slot)
+
+_lib = None
+
+
+def _library(path=LIBRARY):
+    global _lib
+    if _lib is None:
+        lib = ctypes.CDLL(path)
+        lib.remc_ring_open.restype = ctypes.c_void_p
+        lib.remc_ring_open.argtypes = [ctypes.c_char_p, ctypes.c_int]
+        lib.remc_ring_error.restype = ctypes.c_char_p
+        lib.remc_ring_close.argtypes = [ctypes.c_void_p]
+        lib.remc_ring_read.restype = ctypes.c_size_t
+        lib.remc_ring_read.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+        lib.remc_ring_available.restype = ctypes.c_size_t
+        lib.remc_ring_available.argtypes = [ctypes.c_void_p]
+        lib.remc_ring_wait.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        for name in ('remc_ring_cursor', 'remc_ring_overruns'):
+            getattr(lib, name).restype = ctypes.c_uint64
+            getattr(lib, name).argtypes = [ctypes.c_void_p]
+        lib.remc_ring_closed.argtypes = [ctypes.c_void_p]
+        lib.remc_ring_channel_count.restype = ctypes.c_uint32
+        lib.remc_ring_channel_count.argtypes = [ctypes.c_void_p]
+        lib.remc_ring_channel_name.restype = ctypes.c_char_p
+        lib.remc_ring_channel_name.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        _lib = lib
+    return _lib
+
+
+class SampleRingReader:
+    def __init__(self, name=RING_NAME, from_oldest=False, batch=4096):
+        self._lib = _library()
+        self._h = self._lib.remc_ring_open(name.encode(), 1 if from_oldest else 0)
+        if not self._h:
+            raise OSError(self._lib.remc_ring_error().decode())
+        self.channels = [self._lib.remc_ring_channel_name(self._h, c).decode()
+                         for c in range(self._lib.remc_ring_channel_count(self._h))]
+        self._buf = (Slot * batch)()
+        self._np = np.frombuffer(self._buf, dtype=SLOT_DTYPE) if np is not None else None
+
+    def close(self):
+        if self._h:
+            self._lib.remc_ring_close(self._h)
+            self._h = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def read(self, max_samples=None):
+        """Up to max_samples (default: the batch size) samples in order."""
+        n = len(self._buf) if max_samples is None else min(max_samples, len(self._buf))
+        got = self._lib.remc_ring_read(self._h, self._buf, n)
+        return self._np[:got] if self._np is not None else self._buf[:got]
+
+    def wait(self, timeout_s=None):
+        """Sleep until samples are available or the writer closes; True if samples are available."""
+        return bool(self._lib.remc_ring_wait(self._h, -1 if timeout_s is None else int(timeout_s * 1000)))
+
+    def channel(self, samples, name):
+        """One channel's values of a read() result, by name."""
+        c = self.channels.index(name)
+        return samples['ch'][:, c] if self._np is not None else [s.ch[c] for s in samples]
+
+    @property
+    def available(self):
+        return self._lib.remc_ring_available(self._h)
+
+    @property
+    def cursor(self):
+        return self._lib.remc_ring_cursor(self._h)
+
+    @property
+    def overruns(self):
+        return self._lib.remc_ring_overruns(self._h)
+
+    @property
+    def closed(self):
+        """The writer shut down (or was replaced); reopen to follow a new one."""
+        return bool(self._lib.remc_ring_closed(self._h))
@@ -0,0 +1,241 @@
+/*
+  sample_ring_bench – SampleRing throughput and latency with 1 and 8 readers
+
+  Usage:
+    sample_ring_bench [seconds]          (default 3 s per run)
+
+  Every reader is a separate process (fork) that opens the ring by name,
+  as a consumer would. For 1 and 8 readers:
+
+    flood   the writer publishes 33-sample packets as fast as it can;
+            readers follow with wait()/read(). Reports writer and slowest
+            reader samples/s and the samples readers lost to overruns
+    10 kHz  the receiver's rate in 33-sample packets; reports the latency
+            from publish() to read() (p50 / p99 / max, all readers) and
+            the readers' CPU
+    lapped  flood into a 4096-slot ring while readers pause 1 ms per
+            read, so they are overrun and copy slots being overwritten
+
+  Every sample carries its index and values derived from it; readers
+  check each one, and that the gaps they see equal their overrun count.
+  Exit status is non-zero on any torn or misordered sample.
+*/
+
+#include "SampleRing.h"
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char* const RING = "/remc_samples_bench";
+static const size_t PACKET = 33;
+static const size_t LATENCY_SAMPLES = 4096;
+
+static uint64_t monotonicUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void fill(CaptureStore::Record& r, uint64_t i, uint64_t now) {
+  r.tUs = i;
+  r.tUsEnd = now;
+  for (size_t c = 0; c < CaptureStore::DEFAULT_CHANNEL_COUNT; ++c) r.ch[c] = (float)(i % 4096 + c);
+  r.status = (uint8_t)(i & 63);
+}
+
+struct ReaderResult {
+  uint64_t samples;
+  uint64_t overruns;
+  uint64_t errors;
+  double seconds;
+  double cpuSeconds;
+  uint32_t latencies;
+  uint32_t latencyUs[LATENCY_SAMPLES];
+};
+
+static double cpuSeconds() {
+  rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+}
+
+// Child: follow the ring until the writer closes it, write the result to fd
+enum Mode { FLOOD, PACED, LAPPED };
+static const char* const MODE_NAMES[] = { "flood", "10 kHz", "lapped" };
+
+static void runReader(int fd, Mode mode) {
+  const bool latency = mode == PACED;
+  ReaderResult res;
+  memset(&res, 0, sizeof(res));
+  SampleRing::Reader r;
+  // Parent waits for the ring before forking, so open cannot race the create
+  if (!r.open(RING)) {
+    res.errors = 1;
+    if (write(fd, &res, sizeof(res)) < 0) _exit(1);
+    _exit(1);
+  }
+  std::vector<SampleRing::Slot> buf(4096);
+  const uint64_t start = r.cursor();
+  uint64_t expect = start;
+  const uint64_t t0 = monotonicUs();
+  const double c0 = cpuSeconds();
+  uint64_t n = 0;
+  while (true) {
+    const size_t got = r.read(buf.data(), buf.size());
+    if (got == 0) {
+      if (r.closed() && r.available() == 0) break;
+      r.wait(100);
+      continue;
+    }
+    const uint64_t now = monotonicUs();
+    for (size_t k = 0; k < got; ++k) {
+      const SampleRing::Slot& s = buf[k];
+      if (s.tUs < expect) res.errors++;
+      expect = s.tUs + 1;
+      bool ok = s.status == (uint8_t)(s.tUs & 63);
+      for (size_t c = 0; c < CaptureStore::DEFAULT_CHANNEL_COUNT; ++c) ok = ok && s.ch[c] == (float)(s.tUs % 4096 + c);
+      if (!ok) res.errors++;
+    }
+    if (latency && res.latencies < LATENCY_SAMPLES) res.latencyUs[res.latencies++] = (uint32_t)(now - buf[got - 1].tUsEnd);
+    n += got;
+    if (mode == LAPPED) usleep(1000);
+  }
+  res.samples = n;
+  res.overruns = r.overruns();
+  // Every index not delivered must have been counted as an overrun
+  if (r.cursor() - start != n + r.overruns() || expect > r.cursor()) res.errors++;
+  res.seconds = (double)(monotonicUs() - t0) / 1e6;
+  res.cpuSeconds = cpuSeconds() - c0;
+  if (write(fd, &res, sizeof(res)) < 0) _exit(1);
+  _exit(0);
+}
+
+struct RunResult {
+  double writerRate;         // samples/s
+  double slowestReaderRate;
+  uint64_t overruns;
+  uint64_t errors;
+  double cpuPerReader;       // fraction of one core
+  std::vector<uint32_t> latencyUs;
+};
+
+static bool run(size_t readers, double seconds, Mode mode, RunResult& out) {
+  const bool paced = mode == PACED;
+  const std::vector<std::string> channels(CaptureStore::DEFAULT_CHANNELS,
+                                          CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+  SampleRing::Writer w;
+  if (!w.create(RING, channels, mode == LAPPED ? 4096 : SampleRing::DEFAULT_CAPACITY)) {
+    fprintf(stderr, "%s\n", w.error().c_str());
+    return false;
+  }
+  std::vector<int> fds;
+  std::vector<pid_t> pids;
+  for (size_t i = 0; i < readers; ++i) {
+    int p[2];
+    if (pipe(p) < 0) return false;
+    const pid_t pid = fork();
+    if (pid == 0) {
+      close(p[0]);
+      runReader(p[1], mode);
+    }
+    close(p[1]);
+    fds.push_back(p[0]);
+    pids.push_back(pid);
+  }
+  // Let every reader attach before the clock starts
+  for (int k = 0; k < 200 && w.readers().size() < readers; ++k) usleep(5000);
+
+  CaptureStore::Record pkt[PACKET];
+  memset(pkt, 0, sizeof(pkt));
+  uint64_t i = 0;
+  const uint64_t t0 = monotonicUs(), end = t0 + (uint64_t)(seconds * 1e6);
+  while (true) {
+    const uint64_t now = monotonicUs();
+    if (now >= end) break;
+    if (paced && (double)i / 10000.0 > (double)(now - t0) / 1e6) {
+      usleep(200);
+      continue;
+    }
+    for (size_t k = 0; k < PACKET; ++k) fill(pkt[k], i + k, now);
+    w.publish(pkt, PACKET, 0);
+    i += PACKET;
+  }
+  out.writerRate = (double)i / ((double)(monotonicUs() - t0) / 1e6);
+  w.close();
+
+  out.slowestReaderRate = 1e30;
+  out.overruns = out.errors = 0;
+  out.cpuPerReader = 0;
+  out.latencyUs.clear();
+  for (size_t k = 0; k < readers; ++k) {
+    ReaderResult res;
+    size_t got = 0;
+    while (got < sizeof(res)) {
+      const ssize_t n = read(fds[k], (char*)&res + got, sizeof(res) - got);
+      if (n <= 0) break;
+      got += (size_t)n;
+    }
+    close(fds[k]);
+    waitpid(pids[k], nullptr, 0);
+    if (got != sizeof(res)) {
+      out.errors++;
+      continue;
+    }
+    out.slowestReaderRate = std::min(out.slowestReaderRate, (double)res.samples / std::max(1e-9, res.seconds));
+    out.overruns += res.overruns;
+    out.errors += res.errors;
+    out.cpuPerReader += res.cpuSeconds / std::max(1e-9, res.seconds) / (double)readers;
+    out.latencyUs.insert(out.latencyUs.end(), res.latencyUs, res.latencyUs + res.latencies);
+  }
+  return true;
+}
+
+static std::string rate(double perSecond) {
+  char tmp[32];
+  if (perSecond >= 1e6) snprintf(tmp, sizeof(tmp), "%.1f M/s", perSecond / 1e6);
+  else snprintf(tmp, sizeof(tmp), "%.1f k/s", perSecond / 1e3);
+  return tmp;
+}
+
+static double pct(std::vector<uint32_t>& v, double p) {
+  if (v.empty()) return 0;
+  const size_t k = std::min(v.size() - 1, (size_t)(p * (double)v.size()));
+  std::nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+int main(int argc, char** argv) {
+  const double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+  uint64_t errors = 0;
+  printf("%-8s %-7s %16s %18s %12s %24s %10s %7s\n", "readers", "mode", "writer", "slowest reader", "overruns",
+         "latency p50/p99/max", "reader CPU", "errors");
+  const size_t counts[] = { 1, 8 };
+  for (size_t readers : counts) {
+    for (Mode mode : { FLOOD, PACED, LAPPED }) {
+      RunResult r;
+      if (!run(readers, seconds, mode, r)) return 1;
+      errors += r.errors;
+      char lat[40] = "-";
+      if (mode == PACED) {
+        snprintf(lat, sizeof(lat), "%.0f / %.0f / %.0f us", pct(r.latencyUs, 0.5), pct(r.latencyUs, 0.99),
+                 pct(r.latencyUs, 1.0));
+      }
+      printf("%-8zu %-7s %16s %18s %12llu %24s %9.1f%% %7llu\n", readers, MODE_NAMES[mode],
+             rate(r.writerRate).c_str(), rate(r.slowestReaderRate).c_str(), (unsigned long long)r.overruns, lat,
+             r.cpuPerReader * 100, (unsigned long long)r.errors);
+    }
+  }
+  shm_unlink(RING);
+  printf("%s (%llu errors)\n", errors ? "FAIL" : "OK", (unsigned long long)errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+/*
+  schema_decoder_bench – decode rate and exactness of schema-compiled layouts
+
+  Usage:
+    schema_decoder_bench [samples]
+
+  Compiles five schemas with SchemaDecoder and decodes `samples` (default
+  20M) samples of each, packed into full datagrams, three ways:
+
+    compiled   decode(): the specialized firmware decoder where the layout
+               is the firmware's, the field table otherwise
+    table      decodeGeneric(): always the field table
+    fixed      Neutrino::decodeSamples(), the receiver's fixed 42-byte
+               decoder (only for 42-byte layouts)
+
+  The schemas are the firmware's current one, the same without the time
+  lines (older firmware), raw u16 counts (ChannelTable WireType::U16),
+  eight f32 channels, and a mixed layout with a 32-bit t_us. Every decoded
+  record is compared with what was packed.
+
+  Also counts, for every packet size 1..max samples of each layout, how
+  often the Flask parser's length guess (divisible by 42, 34, 30 or 26
+  bytes, in that order) picks the wrong sample size or none; the compiled
+  decoder is checked on the same packets. And times compiling a schema
+  and reassembling it through SchemaCache.
+
+  Exit status is non-zero if any decoded record differs or a layout does
+  not compile as expected.
+*/
+
+#include "NeutrinoPacket.h"
+#include "SchemaDecoder.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint64_t T0_US = 1760000000000000ull;   // 2025-10-09
+static const size_t MAX_PAYLOAD = 1408;              // 1472 - header (UdpManager MAX_PACKET_SIZE)
+static const size_t MAX_PACKET_SAMPLES = 33;
+
+static double nowS() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char* const STATUS_LINES =
+    "v armed_status u8\nv em_status u8\nv msw_a_status u8\nv msw_b_status u8\n"
+    "v manual_mode_status u8\nv hold_mode_status u8\n";
+
+static std::string channelLines(const char* type, size_t n) {
+  static const char* const NAMES[] = { "switch_voltage", "switch_current", "output_voltage_a", "output_voltage_b",
+                                       "temperature_1", "aux_1", "aux_2", "aux_3" };
+  std::string s;
+  for (size_t i = 0; i < n; ++i) s += std::string("v ") + NAMES[i] + " " + type + " u:kV\n";
+  return s;
+}
+
+struct Layout {
+  const char* name;
+  std::string schema;
+  size_t sampleBytes;        // expected
+  bool specialized;          // expected
+};
+
+static std::vector<Layout> layouts() {
+  const std::string head = "node_name REMC \nc telem_period 100000\nc skew_ns_switch_voltage_current 0\n";
+  std::vector<Layout> out;
+  out.push_back(Layout{ "firmware", head + channelLines("f32", 5) + "v t_us u64 u:us\n" + STATUS_LINES +
+                                        "v t_us_end u64 u:us\n", 42, true });
+  out.push_back(Layout{ "no time lines", head + channelLines("f32", 5) + STATUS_LINES, 42, true });
+  out.push_back(Layout{ "u16 counts", head + channelLines("u16", 5) + "v t_us u64 u:us\n" + STATUS_LINES +
+                                          "v t_us_end u64 u:us\n", 32, false });
+  out.push_back(Layout{ "8 x f32", head + channelLines("f32", 8) + "v t_us u64 u:us\n" + STATUS_LINES +
+                                       "v t_us_end u64 u:us\n", 54, true });
+  out.push_back(Layout{ "mixed", head + "v switch_voltage f64 u:kV\nv switch_current i16 u:counts\n"
+                                        "v t_us u32 u:us\nv armed_status u8\nv em_status i8\n"
+                                        "v output_voltage_a i32 u:counts\n", 20, false });
+  return out;
+}
+
+// Value packed for field f of sample i, and what it decodes to
+static double rawValue(uint64_t i, size_t index) {
+  return (double)((i * 7 + index * 13) % 100) - 20.0;
+}
+
+static void put(uint8_t* q, SchemaDecoder::Type t, double v, uint64_t u) {
+  switch (t) {
+    case SchemaDecoder::T_U8:  { const uint8_t x = (uint8_t)u; memcpy(q, &x, 1); break; }
+    case SchemaDecoder::T_I8:  { const int8_t x = (int8_t)v; memcpy(q, &x, 1); break; }
+    case SchemaDecoder::T_U16: { const uint16_t x = (uint16_t)u; memcpy(q, &x, 2); break; }
+    case SchemaDecoder::T_I16: { const int16_t x = (int16_t)v; memcpy(q, &x, 2); break; }
+    case SchemaDecoder::T_U32: { const uint32_t x = (uint32_t)u; memcpy(q, &x, 4); break; }
+    case SchemaDecoder::T_I32: { const int32_t x = (int32_t)v; memcpy(q, &x, 4); break; }
+    case SchemaDecoder::T_U64: memcpy(q, &u, 8); break;
+    case SchemaDecoder::T_I64: { const int64_t x = (int64_t)v; memcpy(q, &x, 8); break; }
+    case SchemaDecoder::T_F32: { const float x = (float)v; memcpy(q, &x, 4); break; }
+    case SchemaDecoder::T_F64: memcpy(q, &v, 8); break;
+  }
+}
+
+// Pack sample i by the compiled field table; `want` is the record it must decode to
+static void pack(const SchemaDecoder& d, uint64_t i, uint8_t* p, CaptureStore::Record& want) {
+  memset(&want, 0, sizeof(want));
+  for (const SchemaDecoder::Field& f : d.fields()) {
+    uint8_t* q = p + f.offset;
+    switch (f.role) {
+      case SchemaDecoder::ROLE_CHANNEL: {
+        const bool isFloat = f.type == SchemaDecoder::T_F32 || f.type == SchemaDecoder::T_F64;
+        const bool isSigned = f.type == SchemaDecoder::T_I8 || f.type == SchemaDecoder::T_I16 ||
+                              f.type == SchemaDecoder::T_I32 || f.type == SchemaDecoder::T_I64;
+        double v = rawValue(i, f.index);
+        if (isFloat) v = v * 0.25 + 0.1;
+        else if (!isSigned) v += 20.0;
+        put(q, f.type, v, (uint64_t)v);
+        want.ch[f.index] = (float)v;
+        break;
+      }
+      case SchemaDecoder::ROLE_T_US:
+      case SchemaDecoder::ROLE_T_US_END: {
+        uint64_t t = T0_US + i * 100 + (f.role == SchemaDecoder::ROLE_T_US_END ? 9 : 0);
+        if (f.type == SchemaDecoder::T_U32) t &= 0xFFFFFFFFu;
+        put(q, f.type, 0.0, t);
+        (f.role == SchemaDecoder::ROLE_T_US ? want.tUs : want.tUsEnd) = t;
+        break;
+      }
+      case SchemaDecoder::ROLE_STATUS: {
+        const uint8_t b = ((i >> f.index) & 1) ? (uint8_t)(f.index + 1) : 0;
+        put(q, f.type, b, b);
+        if (b) want.status |= (uint8_t)(1u << f.index);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
+// The fixed decoder leaves ch[] past its five channels alone; compare the layout's
+static bool same(const CaptureStore::Record& a, const CaptureStore::Record& b, size_t channels) {
+  return a.tUs == b.tUs && a.tUsEnd == b.tUsEnd && a.status == b.status &&
+         memcmp(a.ch, b.ch, channels * sizeof(float)) == 0;
+}
+
+// Flask parse_neutrino_packet: the first of 42, 34, 30, 26 that divides the payload
+static size_t guessSampleSize(size_t payload) {
+  static const size_t SIZES[] = { 42, 34, 30, 26 };
+  for (size_t s : SIZES) {
+    if (payload % s == 0) return s;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t samples = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000000;
+  int failures = 0;
+
+  printf("%llu samples per layout, packed in full datagrams\n\n", (unsigned long long)samples);
+  printf("%-14s %6s %12s %16s %16s %16s %8s %14s\n", "layout", "bytes", "decoder", "compiled Ms/s", "table Ms/s",
+         "fixed Ms/s", "exact", "length guess");
+
+  for (const Layout& l : layouts()) {
+    SchemaDecoder d;
+    if (!d.compile(l.schema)) {
+      printf("%-14s does not compile: %s\n", l.name, d.error().c_str());
+      failures++;
+      continue;
+    }
+    bool ok = d.sampleBytes() == l.sampleBytes && d.specialized() == l.specialized;
+    const size_t perPacket = std::min(MAX_PACKET_SAMPLES, MAX_PAYLOAD / d.sampleBytes());
+
+    // 1024 packets, decoded over and over
+    const size_t packets = 1024;
+    const size_t payload = perPacket * d.sampleBytes();
+    std::vector<uint8_t> buf(packets * (Neutrino::HEADER_BYTES + payload), 0);
+    std::vector<CaptureStore::Record> want(packets * perPacket);
+    for (size_t k = 0; k < packets; ++k) {
+      uint8_t* p = &buf[k * (Neutrino::HEADER_BYTES + payload)];
+      p[3] = 1;
+      for (size_t j = 0; j < perPacket; ++j) {
+        pack(d, k * perPacket + j, p + Neutrino::HEADER_BYTES + j * d.sampleBytes(), want[k * perPacket + j]);
+      }
+    }
+
+    CaptureStore::Record out[MAX_PACKET_SAMPLES];
+    double rate[3] = { 0, 0, 0 };
+    for (int way = 0; way < 3; ++way) {
+      if (way == 2 && d.sampleBytes() != Neutrino::SAMPLE_BYTES) continue;
+      const uint64_t rounds = std::max<uint64_t>(1, samples / (packets * perPacket));
+      double best = 1e9;
+      for (int rep = 0; rep < 3; ++rep) {
+        volatile uint64_t sink = 0;
+        const double t0 = nowS();
+        for (uint64_t r = 0; r < rounds; ++r) {
+          for (size_t k = 0; k < packets; ++k) {
+            const uint8_t* p = &buf[k * (Neutrino::HEADER_BYTES + payload)];
+            size_t n;
+            if (way == 0) n = d.decode(p + Neutrino::HEADER_BYTES, payload, out, MAX_PACKET_SAMPLES);
+            else if (way == 1) n = d.decodeGeneric(p + Neutrino::HEADER_BYTES, payload, out, MAX_PACKET_SAMPLES);
+            else n = Neutrino::decodeSamples(p, Neutrino::HEADER_BYTES + payload, out, MAX_PACKET_SAMPLES);
+            sink = sink + n + out[n - 1].tUs;
+          }
+        }
+        best = std::min(best, nowS() - t0);
+      }
+      rate[way] = rounds * packets * perPacket / best / 1e6;
+
+      // Every record, this way
+      for (size_t k = 0; k < packets && ok; ++k) {
+        const uint8_t* p = &buf[k * (Neutrino::HEADER_BYTES + payload)];
+        const size_t n = way == 0 ? d.decode(p + Neutrino::HEADER_BYTES, payload, out, MAX_PACKET_SAMPLES)
+                       : way == 1 ? d.decodeGeneric(p + Neutrino::HEADER_BYTES, payload, out, MAX_PACKET_SAMPLES)
+                                  : Neutrino::decodeSamples(p, Neutrino::HEADER_BYTES + payload, out,
+                                                            MAX_PACKET_SAMPLES);
+        if (n != perPacket) ok = false;
+        for (size_t j = 0; j < n && ok; ++j) ok = same(out[j], want[k * perPacket + j], d.channels());
+      }
+    }
+
+    // Every packet size: the length guess against the compiled layout
+    size_t misread = 0;
+    for (size_t n = 1; n <= perPacket; ++n) {
+      if (guessSampleSize(n * d.sampleBytes()) != d.sampleBytes()) misread++;
+      std::vector<uint8_t> pkt(n * d.sampleBytes());
+      CaptureStore::Record w;
+      for (size_t j = 0; j < n; ++j) pack(d, j, &pkt[j * d.sampleBytes()], w);
+      if (d.decode(pkt.data(), pkt.size(), out, MAX_PACKET_SAMPLES) != n) ok = false;
+    }
+
+    char fixed[16] = "-", guess[24];
+    if (rate[2] > 0) snprintf(fixed, sizeof(fixed), "%.0f", rate[2]);
+    snprintf(guess, sizeof(guess), "%zu/%zu wrong", misread, perPacket);
+    printf("%-14s %6zu %12s %16.0f %16.0f %16s %8s %14s\n", l.name, d.sampleBytes(),
+           d.specialized() ? "specialized" : "table", rate[0], rate[1], fixed, ok ? "ok" : "FAIL", guess);
+    if (!ok) failures++;
+  }
+
+  // Compile cost, and reassembly from fragments arriving in cycle order
+  const Layout fw = layouts()[0];
+  const int compiles = 20000;
+  const double c0 = nowS();
+  for (int i = 0; i < compiles; ++i) {
+    SchemaDecoder d;
+    d.compile(fw.schema);
+  }
+  const double compileUs = (nowS() - c0) / compiles * 1e6;
+
+  std::string text = fw.schema;
+  while (text.size() % Neutrino::FRAG_LEN) text += '\0';
+  const uint32_t frags = (uint32_t)(text.size() / Neutrino::FRAG_LEN);
+  Neutrino::Header h;
+  memset(&h, 0, sizeof(h));
+  h.msgId = 1;
+  h.numFrags = h.numAtomicFrags = frags;
+  const int schemas = 2000;
+  std::shared_ptr<const SchemaDecoder> dec;
+  uint64_t ready = 0;
+  const double a0 = nowS();
+  for (int s = 0; s < schemas; ++s) {
+    SchemaCache cache;
+    memcpy(h.schemaHash, &s, sizeof(s));
+    for (uint32_t f = 0; f < frags; ++f) {
+      h.fragIdx = (f + (uint32_t)s) % frags;     // joined mid-cycle
+      memcpy(h.schemaFrag, &text[(size_t)h.fragIdx * Neutrino::FRAG_LEN], Neutrino::FRAG_LEN);
+      if (cache.add(h, dec) == SchemaCache::SCHEMA_READY) ready++;
+    }
+  }
+  const double assembleUs = (nowS() - a0) / schemas * 1e6;
+  const bool cacheOk = ready == (uint64_t)schemas && dec && dec->sampleBytes() == 42;
+  printf("\nschema: %zu bytes, %u fragments; compile %.1f µs, reassemble + compile %.1f µs  %s\n", fw.schema.size(),
+         frags, compileUs, assembleUs, cacheOk ? "ok" : "FAIL");
+  if (!cacheOk) failures++;
+
+  printf("\n%s (%d failures)\n", failures ? "FAIL" : "OK", failures);
+  return failures ? 1 : 0;
+}
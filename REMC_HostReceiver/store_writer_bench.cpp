@@ -0,0 +1,280 @@
+/*
+  store_writer_bench – receive-loop stalls with a slow disk, with and
+  without the StoreWriter stage
+
+  Usage:
+    store_writer_bench [--seconds S] [--stall-ms N] [--stall-every S]
+                       [--dump-hz N] [--queue-mb N] [dir]
+
+  Plays the receiver's ingest loop: 10 kHz live samples in 33-sample
+  packets for S seconds (default 8), plus a collect dump of --dump-hz
+  collected samples (default 100 kHz) from 25% to 75% of the run, then a
+  batch end. The disk is made slow by stalling the first write or sync
+  issued after every --stall-every seconds (default 1) for --stall-ms
+  (default 250), in three setups:
+
+    inline    CaptureStore appends on the ingest thread (the receiver
+              before StoreWriter), pwrite
+    pwrite    StoreWriter, synchronous writes on its thread
+    io_uring  StoreWriter, writes through io_uring
+
+  Reports for the ingest loop how late packets were handled (max and p99
+  behind schedule), the deepest backlog of datagrams waiting in the
+  socket (the default rmem_max holds about SOCKET_BUFFER_PACKETS of
+  them), and for the writer its queue high-water mark, drops and write
+  and sync latency. Every store is reopened and checked sample by
+  sample. Exit status is non-zero if a StoreWriter run lets the backlog
+  reach the socket buffer, drops a packet or loses a sample.
+*/
+
+#include "StoreWriter.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint64_t T0_US = 1760000000000000ull;   // 2025-10-09
+static const uint64_t PERIOD_US = 100;
+static const size_t PACKET = 33;
+// 212992-byte rmem_max over ~2.3 KB of truesize per 1.4 KB datagram
+static const uint64_t SOCKET_BUFFER_PACKETS = 90;
+
+static uint64_t monotonicUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void makeRecord(uint64_t t0, uint64_t i, CaptureStore::Record& r) {
+  r.tUs = t0 + i * PERIOD_US;
+  r.tUsEnd = r.tUs + 9;
+  const float ph = (float)(i % 200) * (2.0f * (float)M_PI / 200.0f);
+  for (size_t c = 0; c < CaptureStore::DEFAULT_CHANNEL_COUNT; ++c) r.ch[c] = 5.0f * sinf(ph + c) + 0.001f * (i % 7);
+  r.status = (uint8_t)((i >> 16) & 0x3F);
+}
+
+// Rows are the samples 0..n-1 of the sequence starting at t0, in order
+static bool verifyStore(const std::string& dir, uint64_t t0, uint64_t n) {
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return n == 0;
+  }
+  if (r.size() != n) {
+    fprintf(stderr, "%s: %llu rows, expected %llu\n", dir.c_str(), (unsigned long long)r.size(),
+            (unsigned long long)n);
+    return false;
+  }
+  std::vector<CaptureStore::Record> rows(CaptureStore::BLOCK_SAMPLES);
+  for (uint64_t first = 0; first < n; first += rows.size()) {
+    const size_t got = r.read(first, rows.size(), rows.data());
+    for (size_t i = 0; i < got; ++i) {
+      CaptureStore::Record want;
+      makeRecord(t0, first + i, want);
+      if (rows[i].tUs != want.tUs || rows[i].ch[0] != want.ch[0] || rows[i].status != want.status) {
+        fprintf(stderr, "%s: row %llu differs\n", dir.c_str(), (unsigned long long)(first + i));
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+enum Setup { INLINE, STAGE_PWRITE, STAGE_URING };
+static const char* const SETUP_NAMES[] = { "inline", "pwrite", "io_uring" };
+
+struct Options {
+  double seconds;
+  double stallMs;
+  double stallEvery;
+  double dumpHz;
+  size_t queueBytes;
+  std::string dir;
+};
+
+struct Result {
+  uint64_t packets;
+  uint64_t maxLateUs;
+  uint64_t p99LateUs;
+  uint64_t maxBacklog;
+  uint64_t stalls;
+  uint64_t maxPushUs;
+  StoreWriter::Stats ws;
+  bool verified;
+};
+
+static bool run(Setup setup, const Options& o, Result& res) {
+  memset(&res, 0, sizeof(res));
+  const std::string rm = "rm -rf '" + o.dir + "'";
+  if (system(rm.c_str()) != 0) return false;
+  const std::vector<std::string> channels(CaptureStore::DEFAULT_CHANNELS,
+                                          CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+
+  // Slow disk: the first op after every stallEvery seconds blocks
+  uint64_t nextStall = monotonicUs() + (uint64_t)(o.stallEvery * 1e6);
+  auto hook = [&]() {
+    const uint64_t now = monotonicUs();
+    if (now < nextStall) return;
+    nextStall = now + (uint64_t)(o.stallEvery * 1e6);
+    res.stalls++;
+    usleep((useconds_t)(o.stallMs * 1000));
+  };
+
+  StoreWriter writer;
+  IoRing io;
+  CaptureStore::Writer live, batch;
+  if (setup == INLINE) {
+    io.init(false);
+    io.setIssueHook(hook);
+    live.setIo(&io);
+    batch.setIo(&io);
+    const std::string batches = o.dir + "/batches";
+    if (system(("mkdir -p '" + batches + "'").c_str()) != 0 ||
+        !live.create(o.dir + "/live", channels, CaptureStore::STORE_COMPRESSED)) {
+      fprintf(stderr, "%s\n", live.error().c_str());
+      return false;
+    }
+  } else {
+    writer.setIssueHook(hook);
+    if (!writer.start(o.dir, channels, CaptureStore::STORE_COMPRESSED, o.queueBytes, setup == STAGE_URING)) {
+      fprintf(stderr, "%s\n", writer.error().c_str());
+      return false;
+    }
+    if (setup == STAGE_URING && !writer.stats().ioUring) fprintf(stderr, "io_uring unavailable, using pwrite\n");
+  }
+
+  // Packet schedule: live throughout, the dump in the middle half
+  const uint64_t livePeriodUs = PACKET * PERIOD_US;
+  const uint64_t dumpPeriodUs = (uint64_t)(PACKET * 1e6 / o.dumpHz);
+  const uint64_t runUs = (uint64_t)(o.seconds * 1e6);
+  const uint64_t dumpStart = runUs / 4, dumpEnd = runUs * 3 / 4;
+  const uint64_t dumpPackets = (dumpEnd - dumpStart) / dumpPeriodUs;
+
+  std::vector<uint64_t> lateUs;
+  lateUs.reserve((size_t)(runUs / livePeriodUs + dumpPackets + 16));
+  CaptureStore::Record pkt[PACKET];
+  uint64_t liveDone = 0, dumpDone = 0, lastFlush = 0;
+  bool batchEnded = false;
+  const uint64_t t0 = monotonicUs();
+  while (true) {
+    const uint64_t liveDue = liveDone * livePeriodUs;
+    const uint64_t dumpDue = dumpDone < dumpPackets ? dumpStart + dumpDone * dumpPeriodUs : UINT64_MAX;
+    const bool dump = dumpDue < liveDue;
+    const uint64_t due = dump ? dumpDue : liveDue;
+    if (due >= runUs) break;
+    uint64_t now = monotonicUs() - t0;
+    if (now < due) {
+      usleep((useconds_t)(due - now));
+      now = monotonicUs() - t0;
+    }
+    lateUs.push_back(now > due ? now - due : 0);
+
+    // Datagrams that have arrived and are not read yet
+    const uint64_t liveArrived = now / livePeriodUs + 1;
+    const uint64_t dumpArrived = now < dumpStart ? 0 : std::min(dumpPackets, (now - dumpStart) / dumpPeriodUs + 1);
+    const uint64_t backlog = (liveArrived > liveDone ? liveArrived - liveDone : 0) +
+                             (dumpArrived > dumpDone ? dumpArrived - dumpDone : 0);
+    res.maxBacklog = std::max(res.maxBacklog, backlog);
+
+    if (!dump && !batchEnded && dumpDone == dumpPackets && dumpPackets && due >= dumpEnd) {
+      if (setup == INLINE) batch.close();
+      else writer.endBatch();
+      batchEnded = true;
+    }
+    const uint64_t first = (dump ? dumpDone : liveDone) * PACKET;
+    for (size_t k = 0; k < PACKET; ++k) makeRecord(dump ? T0_US + 86400000000ull : T0_US, first + k, pkt[k]);
+
+    const uint64_t p0 = monotonicUs();
+    if (setup == INLINE) {
+      if (dump && !batch.isOpen() && !batch.create(o.dir + "/batches/batch_0001", channels,
+                                                   CaptureStore::STORE_COMPRESSED)) {
+        fprintf(stderr, "%s\n", batch.error().c_str());
+        return false;
+      }
+      (dump ? batch : live).append(pkt, PACKET);
+      if (now - lastFlush >= 1000000) {
+        live.flush();
+        if (batch.isOpen()) batch.flush();
+        lastFlush = now;
+      }
+    } else if (dump) {
+      writer.appendCollected(pkt, PACKET);
+    } else {
+      writer.appendLive(pkt, PACKET);
+    }
+    res.maxPushUs = std::max(res.maxPushUs, monotonicUs() - p0);
+    (dump ? dumpDone : liveDone)++;
+    res.packets++;
+  }
+  if (setup == INLINE) {
+    batch.close();
+    live.close();
+    io.close();
+  } else {
+    if (!batchEnded) writer.endBatch();
+    writer.stop();
+    res.ws = writer.stats();
+  }
+
+  std::sort(lateUs.begin(), lateUs.end());
+  res.maxLateUs = lateUs.empty() ? 0 : lateUs.back();
+  res.p99LateUs = lateUs.empty() ? 0 : lateUs[std::min(lateUs.size() - 1, (size_t)(lateUs.size() * 0.99))];
+  const uint64_t dropped = res.ws.droppedSamples;
+  res.verified = dropped == 0 && verifyStore(o.dir + "/live", T0_US, liveDone * PACKET) &&
+                 verifyStore(o.dir + "/batches/batch_0001", T0_US + 86400000000ull, dumpDone * PACKET);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  Options o = { 8.0, 250.0, 1.0, 100000.0, StoreWriter::DEFAULT_QUEUE_BYTES, "/tmp/store_writer_bench" };
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) o.seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--stall-ms") && i + 1 < argc) o.stallMs = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--stall-every") && i + 1 < argc) o.stallEvery = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--dump-hz") && i + 1 < argc) o.dumpHz = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--queue-mb") && i + 1 < argc) o.queueBytes = (size_t)(atof(argv[++i]) * 1048576);
+    else if (argv[i][0] != '-') o.dir = argv[i];
+    else {
+      fprintf(stderr, "usage: %s [--seconds S] [--stall-ms N] [--stall-every S] [--dump-hz N] [--queue-mb N] [dir]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  printf("%.0f s, 10 kHz live + %.0f kHz dump, disk stalls %.0f ms every %.1f s, queue %.0f MB\n\n", o.seconds,
+         o.dumpHz / 1e3, o.stallMs, o.stallEvery, o.queueBytes / 1048576.0);
+  printf("%-9s %8s %13s %8s %12s %10s %8s %19s %14s %6s\n", "setup", "packets", "late max/p99", "backlog",
+         "push max", "queue max", "dropped", "write p50/p99/max", "sync p99/max", "check");
+
+  int failures = 0;
+  for (Setup setup : { INLINE, STAGE_PWRITE, STAGE_URING }) {
+    Result r;
+    if (!run(setup, o, r)) return 1;
+    char late[32], write[40] = "-", sync[32] = "-", queue[16] = "-", dropped[16] = "-";
+    snprintf(late, sizeof(late), "%.1f/%.1f ms", r.maxLateUs / 1e3, r.p99LateUs / 1e3);
+    if (setup != INLINE) {
+      const IoRing::Stats& io = r.ws.io;
+      snprintf(write, sizeof(write), "<%.1f/<%.1f/%.0f ms", IoRing::percentileUs(io.writeLatencyUs, 0.5) / 1e3,
+               IoRing::percentileUs(io.writeLatencyUs, 0.99) / 1e3, io.maxWriteUs / 1e3);
+      snprintf(sync, sizeof(sync), "<%.0f/%.0f ms", IoRing::percentileUs(io.syncLatencyUs, 0.99) / 1e3,
+               io.maxSyncUs / 1e3);
+      snprintf(queue, sizeof(queue), "%.1f MB", r.ws.maxQueueBytes / 1048576.0);
+      snprintf(dropped, sizeof(dropped), "%llu", (unsigned long long)r.ws.dropped);
+    }
+    printf("%-9s %8llu %13s %8llu %9.2f ms %10s %8s %19s %14s %6s\n", SETUP_NAMES[setup],
+           (unsigned long long)r.packets, late, (unsigned long long)r.maxBacklog, r.maxPushUs / 1e3, queue, dropped,
+           write, sync, r.verified ? "ok" : "FAIL");
+    if (setup != INLINE && (!r.verified || r.maxBacklog >= SOCKET_BUFFER_PACKETS || r.ws.dropped)) failures++;
+    if (setup == INLINE && !r.verified) failures++;
+  }
+  const std::string rm = "rm -rf '" + o.dir + "'";
+  if (system(rm.c_str()) != 0) return 1;
+  printf("\n%s (%d failures)\n", failures ? "FAIL" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+/*
+  timing_analyzer – sample interval and duration statistics in one pass (TimingAnalyzer.h)
+
+  Usage:
+    timing_analyzer <file.csv | store> [--expected US] [--tolerance US] [--list N] [--hist]
+    timing_analyzer --live [--ring NAME] [--every S] [--seconds N] [--expected US] [--tolerance US]
+
+  A CSV needs the sample_timestamp_us column and uses
+  sample_timestamp_us_end when present (Flask /download_csv, capture_export
+  csv, the timing_analysis scripts' input). A store is a CaptureStore
+  directory, or a receiver's store directory for its live/ store. Either
+  is read once, front to back, with memory independent of its length.
+
+  --live follows remc_receiver's shared-memory ring (SampleRing.h, default
+  /remc_samples): the live samples (flags 0; collect dumps would interleave
+  older times) go through the analyzer, one line per --every S (default 1)
+  for that window, and the full report for the whole run at Ctrl-C or
+  after --seconds.
+*/
+
+#include "TimingAnalyzer.h"
+#include "CaptureStore.h"
+#include "SampleRing.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int) { s_stop = 1; }
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static bool isFile(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// ---------------- CSV ----------------
+
+// Integer (or, from a float column, decimal) µs; false if the field is empty
+static bool parseMicros(const char* p, const char* end, uint64_t& v) {
+  while (p < end && (*p == ' ' || *p == '"')) ++p;
+  if (p == end || *p == '"') return false;
+  uint64_t n = 0;
+  const char* q = p;
+  while (q < end && *q >= '0' && *q <= '9') n = n * 10 + (uint64_t)(*q++ - '0');
+  if (q == p) return false;
+  if (q < end && (*q == '.' || *q == 'e' || *q == 'E')) {
+    std::string s(p, end);
+    n = (uint64_t)strtod(s.c_str(), nullptr);
+  }
+  v = n;
+  return true;
+}
+
+static bool analyzeCsv(const char* path, TimingAnalyzer& a, uint64_t& bytes) {
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  static const size_t CHUNK = 4u << 20;
+  std::vector<char> buf(CHUNK + 1);
+  size_t have = 0;
+  int colT = -1, colEnd = -1;
+  bool header = true;
+  bytes = 0;
+
+  while (true) {
+    const ssize_t n = read(fd, buf.data() + have, CHUNK - have);
+    if (n < 0) {
+      perror(path);
+      close(fd);
+      return false;
+    }
+    bytes += (uint64_t)n;
+    const size_t total = have + (size_t)n;
+    const bool eof = n == 0;
+    char* p = buf.data();
+    char* const end = p + total;
+    if (eof && total > 0 && end[-1] != '\n') *end = '\n';   // last line without a newline
+    char* const limit = eof && total > 0 && end[-1] != '\n' ? end + 1 : end;
+
+    while (p < limit) {
+      char* nl = (char*)memchr(p, '\n', (size_t)(limit - p));
+      if (!nl) break;
+      char* lineEnd = nl > p && nl[-1] == '\r' ? nl - 1 : nl;
+
+      if (header) {
+        int col = 0;
+        for (char* f = p; f <= lineEnd; ++col) {
+          char* c = (char*)memchr(f, ',', (size_t)(lineEnd - f));
+          char* fe = c ? c : lineEnd;
+          std::string name(f, fe);
+          if (name.size() >= 2 && name.front() == '"' && name.back() == '"') name = name.substr(1, name.size() - 2);
+          if (name == "sample_timestamp_us") colT = col;
+          else if (name == "sample_timestamp_us_end") colEnd = col;
+          f = fe + 1;
+          if (!c) break;
+        }
+        if (colT < 0) {
+          fprintf(stderr, "%s: no sample_timestamp_us column\n", path);
+          close(fd);
+          return false;
+        }
+        header = false;
+      } else if (lineEnd > p) {
+        // Walk the fields up to the last one needed
+        const int lastCol = colT > colEnd ? colT : colEnd;
+        const char* f = p;
+        uint64_t t = 0, tEnd = 0;
+        bool haveT = false, haveEnd = false;
+        for (int col = 0; col <= lastCol && f <= lineEnd; ++col) {
+          const char* c = (const char*)memchr(f, ',', (size_t)(lineEnd - f));
+          const char* fe = c ? c : lineEnd;
+          if (col == colT) haveT = parseMicros(f, fe, t);
+          else if (col == colEnd) haveEnd = parseMicros(f, fe, tEnd);
+          if (!c) break;
+          f = c + 1;
+        }
+        if (haveT) a.add(t, tEnd, haveEnd);
+      }
+      p = nl + 1;
+    }
+    if (eof) break;
+    have = (size_t)(end - p);
+    if (have == CHUNK) {
+      fprintf(stderr, "%s: line longer than %zu bytes\n", path, CHUNK);
+      close(fd);
+      return false;
+    }
+    memmove(buf.data(), p, have);
+  }
+  close(fd);
+  return true;
+}
+
+// ---------------- store ----------------
+
+static bool analyzeStore(std::string dir, TimingAnalyzer& a, uint64_t& bytes) {
+  if (!isFile(dir + "/store.meta") && isFile(dir + "/live/store.meta")) dir += "/live";
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return false;
+  }
+  bytes = 0;
+  CaptureStore::BlockView v;
+  for (uint64_t b = 0; b < r.blockCount(); ++b) {
+    if (!r.block(b, v, BlockCodec::COL_T | BlockCodec::COL_DUR)) {
+      fprintf(stderr, "%s\n", r.error().c_str());
+      return false;
+    }
+    for (uint32_t i = 0; i < v.rows; ++i) {
+      const uint16_t d = v.dur[i];
+      a.add(v.t[i], v.t[i] + d, d != CaptureStore::DUR_NONE);
+    }
+    bytes += v.rows * (sizeof(uint64_t) + sizeof(uint16_t));
+  }
+  return true;
+}
+
+// ---------------- live ----------------
+
+static int runLive(const char* ring, double every, double seconds, const TimingAnalyzer::Config& cfg) {
+  SampleRing::Reader r;
+  if (!r.open(ring)) {
+    fprintf(stderr, "%s: no ring (is remc_receiver running?)\n", ring);
+    return 1;
+  }
+  printf("timing_analyzer: following %s, live samples, report every %.1f s\n", ring, every);
+  fflush(stdout);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  TimingAnalyzer total(cfg), window(cfg);
+  std::vector<SampleRing::Slot> slots(4096);
+  const Clock::time_point start = Clock::now();
+  Clock::time_point lastReport = start;
+  uint64_t lastT = 0;
+  bool haveLast = false;
+
+  while (!s_stop && !r.closed() && (seconds <= 0 || secondsSince(start) < seconds)) {
+    r.wait(100);
+    size_t n;
+    while ((n = r.read(slots.data(), slots.size())) > 0) {
+      for (size_t i = 0; i < n; ++i) {
+        const SampleRing::Slot& s = slots[i];
+        if (s.flags != 0) continue;
+        total.add(s.tUs, s.tUsEnd, s.tUsEnd != 0);
+        // The window keeps the interval across its start
+        if (window.samples() == 0 && haveLast) window.add(lastT, 0, false);
+        window.add(s.tUs, s.tUsEnd, s.tUsEnd != 0);
+        lastT = s.tUs;
+        haveLast = true;
+      }
+    }
+    if (secondsSince(lastReport) >= every) {
+      char prefix[48];
+      snprintf(prefix, sizeof(prefix), "[%6.1fs] ", secondsSince(start));
+      window.printLine(stdout, prefix);
+      if (r.overruns()) printf("           %llu samples overrun (analyzer too slow)\n", (unsigned long long)r.overruns());
+      fflush(stdout);
+      window.clear();
+      lastReport = Clock::now();
+    }
+  }
+  printf("\n");
+  total.printIntervals(stdout);
+  printf("\n");
+  total.printDurations(stdout);
+  printf("\nring overruns: %llu\n", (unsigned long long)r.overruns());
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  TimingAnalyzer::Config cfg = TimingAnalyzer::defaultConfig();
+  const char* input = nullptr;
+  bool live = false, hist = false;
+  const char* ring = SampleRing::RING_NAME;
+  double every = 1.0, seconds = 0.0;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasArg = i + 1 < argc;
+    if (!strcmp(argv[i], "--expected") && hasArg) cfg.expectedUs = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--tolerance") && hasArg) cfg.toleranceUs = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--list") && hasArg) cfg.listSize = (size_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--hist")) hist = true;
+    else if (!strcmp(argv[i], "--live")) live = true;
+    else if (!strcmp(argv[i], "--ring") && hasArg) ring = argv[++i];
+    else if (!strcmp(argv[i], "--every") && hasArg) every = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seconds") && hasArg) seconds = atof(argv[++i]);
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else {
+      fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (live) return runLive(ring, every, seconds, cfg);
+  if (!input) {
+    fprintf(stderr, "usage: %s <file.csv | store> [--expected US] [--tolerance US] [--list N] [--hist]\n"
+                    "       %s --live [--ring NAME] [--every S] [--seconds N] [--expected US] [--tolerance US]\n",
+            argv[0], argv[0]);
+    return 2;
+  }
+
+  TimingAnalyzer a(cfg);
+  uint64_t bytes = 0;
+  const Clock::time_point t0 = Clock::now();
+  const bool ok = isFile(input) ? analyzeCsv(input, a, bytes) : analyzeStore(input, a, bytes);
+  if (!ok) return 1;
+  const double s = secondsSince(t0);
+
+  a.printIntervals(stdout, hist);
+  printf("\n");
+  a.printDurations(stdout);
+  rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  printf("\n%s: %llu samples, %.1f MB in %.2f s (%.1f M samples/s, %.0f MB/s), peak RSS %.1f MB\n", input,
+         (unsigned long long)a.samples(), bytes / 1e6, s, s > 0 ? a.samples() / s / 1e6 : 0.0,
+         s > 0 ? bytes / s / 1e6 : 0.0, ru.ru_maxrss / 1024.0);
+  return 0;
+}
@@ -0,0 +1,323 @@
+/*
+  timing_analyzer_bench – TimingAnalyzer against exact statistics, and throughput
+
+  Usage:
+    timing_analyzer_bench [samples] [--tool PATH] [--keep]
+
+  Builds a compressed store of `samples` rows (default 10M) with a known
+  timing pattern – 100 µs ± a few µs of jitter, 3 % of intervals pulled
+  5–40 µs off, a 1–20 ms gap every 50k samples, an out-of-order step every
+  1M and durations of 8–12 µs with some zero, missing and long ones – and
+  exports it as a Flask-style CSV next to it. Then:
+
+    1. Feeds the store through TimingAnalyzer and compares every count,
+       the mean, σ and the percentiles with values computed exactly from
+       arrays of all intervals and durations; any mismatch fails the run.
+    2. Times `timing_analyzer` (--tool, default ./timing_analyzer) on the
+       store and on the CSV.
+    3. Times ../timing_analysis/analyze_sample_frequency.py and
+       analyze_sample_duration.py on the same CSV when python3 can import
+       pandas; otherwise reports them as not measured.
+
+  Exit code 1 on a mismatch. The store and CSV are removed unless --keep.
+*/
+
+#include "TimingAnalyzer.h"
+#include "CaptureExport.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static int s_failures = 0;
+
+static void check(bool ok, const char* what, double got, double want) {
+  if (!ok) {
+    ++s_failures;
+    printf("  MISMATCH %-28s analyzer %.6g, exact %.6g\n", what, got, want);
+  }
+}
+
+// Deterministic pseudo-random stream
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+static uint32_t next32() {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 7;
+  s_rng ^= s_rng << 17;
+  return (uint32_t)(s_rng >> 16);
+}
+
+struct Truth {
+  std::vector<int64_t> intervals;     // all, including backwards
+  std::vector<int64_t> durations;     // samples with an end time
+};
+
+static bool makeStore(const std::string& dir, uint64_t total, Truth& truth) {
+  std::string rm = "rm -rf '" + dir + "'";
+  if (system(rm.c_str()) != 0) return false;
+  const std::vector<std::string> channels(CaptureStore::DEFAULT_CHANNELS,
+                                          CaptureStore::DEFAULT_CHANNELS + CaptureStore::DEFAULT_CHANNEL_COUNT);
+  CaptureStore::Writer w;
+  if (!w.create(dir, channels, CaptureStore::STORE_COMPRESSED)) {
+    fprintf(stderr, "%s\n", w.error().c_str());
+    return false;
+  }
+  truth.intervals.reserve(total);
+  truth.durations.reserve(total);
+  CaptureStore::Record r;
+  memset(&r, 0, sizeof(r));
+  uint64_t t = 1760000000000000ull;
+  for (uint64_t i = 0; i < total; ++i) {
+    if (i > 0) {
+      const uint32_t u = next32();
+      int64_t d = 100 + (int64_t)(u % 5) - 2;                          // 98-102
+      if (u % 1000 < 30) d += ((u >> 10) & 1 ? 1 : -1) * (int64_t)(5 + (u >> 11) % 36);
+      if (i % 50000 == 0) d = 1000 + (int64_t)((u >> 8) % 19000);      // gap
+      if (i % 1000000 == 500000) d = -(int64_t)(100 + u % 400);       // out of order
+      t += (uint64_t)d;
+      truth.intervals.push_back(d);
+    }
+    r.tUs = t;
+    const uint32_t v = next32();
+    if (v % 100 == 0) {
+      r.tUsEnd = 0;                                                   // no end time
+    } else {
+      int64_t dur = 8 + (int64_t)(v % 5);
+      if (v % 1000 == 1) dur = 0;
+      if (v % 10000 == 2) dur = 100 + (int64_t)((v >> 8) % 3000);
+      r.tUsEnd = t + (uint64_t)dur;
+      truth.durations.push_back(dur);
+    }
+    for (size_t c = 0; c < 5; ++c) r.ch[c] = (float)((v >> c) & 0xFFF) * 0.0044f - 8.9f;
+    if (!w.append(r)) {
+      fprintf(stderr, "%s\n", w.error().c_str());
+      return false;
+    }
+  }
+  w.close();
+  return true;
+}
+
+static bool exportCsv(const std::string& dir, const std::string& csv) {
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    return false;
+  }
+  const int fd = open(csv.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror(csv.c_str());
+    return false;
+  }
+  CaptureExport::Exporter e(r);
+  const bool ok = e.write(fd, CaptureExport::Format::CSV, 0, r.size());
+  if (!ok) fprintf(stderr, "%s\n", e.error().c_str());
+  close(fd);
+  return ok;
+}
+
+// Exact q-quantile with the analyzer's rank convention (nearest rank)
+static double exactPercentile(std::vector<int64_t>& sorted, double q) {
+  if (sorted.empty()) return 0.0;
+  size_t rank = (size_t)ceil(q * sorted.size());
+  if (rank < 1) rank = 1;
+  return (double)sorted[rank - 1];
+}
+
+static bool near(double got, double want, double rel, double abs) {
+  return fabs(got - want) <= std::max(abs, fabs(want) * rel);
+}
+
+static void verify(const std::string& dir, Truth& truth, const TimingAnalyzer::Config& cfg) {
+  CaptureStore::Reader r;
+  if (!r.open(dir)) {
+    fprintf(stderr, "%s\n", r.error().c_str());
+    exit(1);
+  }
+  TimingAnalyzer a(cfg);
+  CaptureStore::BlockView v;
+  const Clock::time_point t0 = Clock::now();
+  for (uint64_t b = 0; b < r.blockCount(); ++b) {
+    if (!r.block(b, v, BlockCodec::COL_T | BlockCodec::COL_DUR)) {
+      fprintf(stderr, "%s\n", r.error().c_str());
+      exit(1);
+    }
+    for (uint32_t i = 0; i < v.rows; ++i) a.add(v.t[i], v.t[i] + v.dur[i], v.dur[i] != CaptureStore::DUR_NONE);
+  }
+  const double dt = secondsSince(t0);
+  printf("in-process store pass: %.2f s (%.1f M samples/s)\n", dt, a.samples() / dt / 1e6);
+
+  // Exact figures, computed the way the scripts do (arrays of every value)
+  std::vector<int64_t> iv;
+  iv.reserve(truth.intervals.size());
+  uint64_t backwards = 0, inRange = 0, dev10 = 0, dev50 = 0, gaps = 0;
+  double sum = 0, sumSq = 0;
+  for (int64_t d : truth.intervals) {
+    if (d < 0) {
+      ++backwards;
+      continue;
+    }
+    iv.push_back(d);
+    sum += d;
+    sumSq += (double)d * d;
+    const double dev = fabs(d - cfg.expectedUs);
+    if (dev <= cfg.toleranceUs) ++inRange;
+    if (dev > cfg.expectedUs * 0.10) ++dev10;
+    if (dev > cfg.expectedUs * 0.50) ++dev50;
+    if (d > cfg.expectedUs * 2) ++gaps;
+  }
+  const double mean = sum / iv.size();
+  const double sd = sqrt(std::max(0.0, sumSq / iv.size() - mean * mean));
+  uint64_t out2s = 0;
+  for (int64_t d : iv)
+    if (fabs(d - mean) > 2 * sd) ++out2s;
+  std::sort(iv.begin(), iv.end());
+
+  const TimingAnalyzer::Histogram& h = a.intervals();
+  check(a.samples() == truth.intervals.size() + 1, "samples", a.samples(), truth.intervals.size() + 1);
+  check(h.count() == iv.size(), "intervals", h.count(), iv.size());
+  check(a.backwards() == backwards, "backwards", a.backwards(), backwards);
+  check(a.inRange() == inRange, "within tolerance", a.inRange(), inRange);
+  check(a.deviation10() == dev10, "> 10 % deviation", a.deviation10(), dev10);
+  check(a.deviation50() == dev50, "> 50 % deviation", a.deviation50(), dev50);
+  check(a.gaps() == gaps, "gaps > 2x", a.gaps(), gaps);
+  check(near(h.mean(), mean, 1e-9, 1e-9), "interval mean", h.mean(), mean);
+  check(near(h.stddev(), sd, 1e-6, 1e-6), "interval std dev", h.stddev(), sd);
+  check(h.min() == (uint64_t)iv.front(), "interval min", h.min(), iv.front());
+  check(h.max() == (uint64_t)iv.back(), "interval max", h.max(), iv.back());
+  // σ bounds go through bucket midpoints; the values near them are exact (< 2048 µs)
+  const uint64_t got2s = h.countOutside(h.mean() - 2 * h.stddev(), h.mean() + 2 * h.stddev());
+  check(got2s == out2s, "> 2 sigma", got2s, out2s);
+  static const double Q[] = { 0.5, 0.9, 0.99, 0.999, 0.9999, 0.99999 };
+  for (double q : Q) {
+    char what[32];
+    snprintf(what, sizeof(what), "interval p%g", q * 100);
+    const double want = exactPercentile(iv, q);
+    check(near(h.percentile(q), want, 1.0 / 1024, 0.5), what, h.percentile(q), want);
+  }
+  // Largest gaps: the exact top of the sorted array
+  const std::vector<TimingAnalyzer::Event> top = a.largestGaps();
+  for (size_t k = 0; k < top.size() && k < iv.size(); ++k)
+    check(top[k].valueUs == iv[iv.size() - 1 - k], "largest gap", top[k].valueUs, iv[iv.size() - 1 - k]);
+
+  std::vector<int64_t>& du = truth.durations;
+  double dsum = 0, dsumSq = 0;
+  uint64_t zeros = 0;
+  for (int64_t d : du) {
+    dsum += d;
+    dsumSq += (double)d * d;
+    if (d == 0) ++zeros;
+  }
+  const double dmean = dsum / du.size();
+  const double dsd = sqrt(std::max(0.0, dsumSq / du.size() - dmean * dmean));
+  uint64_t out3s = 0, atLeast100 = 0;
+  for (int64_t d : du) {
+    if (d > dmean + 3 * dsd) ++out3s;
+    if (d >= 100) ++atLeast100;
+  }
+  std::sort(du.begin(), du.end());
+  const TimingAnalyzer::Histogram& hd = a.durations();
+  check(hd.count() == du.size(), "durations", hd.count(), du.size());
+  check(a.zeroDurations() == zeros, "zero durations", a.zeroDurations(), zeros);
+  check(a.invalidDurations() == 0, "invalid durations", a.invalidDurations(), 0);
+  check(near(hd.mean(), dmean, 1e-9, 1e-9), "duration mean", hd.mean(), dmean);
+  check(near(hd.stddev(), dsd, 1e-6, 1e-6), "duration std dev", hd.stddev(), dsd);
+  const uint64_t got3s = hd.countOutside(-HUGE_VAL, hd.mean() + 3 * hd.stddev());
+  check(got3s == out3s, "duration > 3 sigma", got3s, out3s);
+  check(hd.countAtLeast(100) == atLeast100, "duration >= 100", hd.countAtLeast(100), atLeast100);
+  for (double q : Q) {
+    char what[32];
+    snprintf(what, sizeof(what), "duration p%g", q * 100);
+    const double want = exactPercentile(du, q);
+    check(near(hd.percentile(q), want, 1.0 / 1024, 0.5), what, hd.percentile(q), want);
+  }
+  const std::vector<TimingAnalyzer::Event> longest = a.longestDurations();
+  for (size_t k = 0; k < longest.size(); ++k)
+    check(longest[k].valueUs == du[du.size() - 1 - k], "longest duration", longest[k].valueUs, du[du.size() - 1 - k]);
+
+  printf("exact comparison: %llu intervals, %llu durations, %s\n", (unsigned long long)iv.size(),
+         (unsigned long long)du.size(), s_failures ? "MISMATCHES" : "all counts and percentiles match");
+  printf("  within 98-102 µs %.2f %%, p99 %.0f µs, p99.99 %.0f µs, %llu gaps, %llu backwards\n",
+         a.inRangePercent(), h.percentile(0.99), h.percentile(0.9999), (unsigned long long)a.gaps(),
+         (unsigned long long)a.backwards());
+}
+
+// Runs a command with output discarded; returns its wall time or < 0
+static double timeCommand(const std::string& cmd) {
+  const Clock::time_point t0 = Clock::now();
+  const int rc = system((cmd + " > /dev/null 2>&1").c_str());
+  const double dt = secondsSince(t0);
+  return rc == 0 ? dt : -1.0;
+}
+
+static void row(const char* what, double seconds, uint64_t samples) {
+  if (seconds < 0) printf("  %-40s failed\n", what);
+  else printf("  %-40s %7.2f s  %7.2f M samples/s\n", what, seconds, samples / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+  uint64_t total = 10000000ull;
+  std::string tool = "./timing_analyzer";
+  bool keep = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--tool") && i + 1 < argc) tool = argv[++i];
+    else if (!strcmp(argv[i], "--keep")) keep = true;
+    else total = strtoull(argv[i], nullptr, 10);
+  }
+  if (total < 2) total = 2;
+  const std::string dir = "/tmp/timing_analyzer_bench";
+  const std::string csv = "/tmp/timing_analyzer_bench.csv";
+  const TimingAnalyzer::Config cfg = TimingAnalyzer::defaultConfig();
+
+  Truth truth;
+  Clock::time_point t0 = Clock::now();
+  if (!makeStore(dir, total, truth)) return 1;
+  printf("store %s: %llu samples in %.1f s\n", dir.c_str(), (unsigned long long)total, secondsSince(t0));
+  t0 = Clock::now();
+  if (!exportCsv(dir, csv)) return 1;
+  printf("csv %s in %.1f s\n", csv.c_str(), secondsSince(t0));
+
+  verify(dir, truth, cfg);
+  truth = Truth();
+
+  printf("\nwhole-file runs (best of 2):\n");
+  double best = 1e30;
+  for (int k = 0; k < 2; ++k) best = std::min(best, timeCommand(tool + " " + dir));
+  row("timing_analyzer <store>", best, total);
+  best = 1e30;
+  for (int k = 0; k < 2; ++k) best = std::min(best, timeCommand(tool + " " + csv));
+  row("timing_analyzer <csv>", best, total);
+
+  if (system("python3 -c 'import pandas' > /dev/null 2>&1") == 0) {
+    row("analyze_sample_frequency.py <csv>",
+        timeCommand("python3 ../timing_analysis/analyze_sample_frequency.py " + csv), total);
+    row("analyze_sample_duration.py <csv>",
+        timeCommand("python3 ../timing_analysis/analyze_sample_duration.py " + csv), total);
+  } else {
+    printf("  %-40s not measured (python3 cannot import pandas)\n", "timing_analysis/*.py <csv>");
+  }
+
+  if (!keep) {
+    std::string rm = "rm -rf '" + dir + "' '" + csv + "'";
+    if (system(rm.c_str()) != 0) fprintf(stderr, "could not remove %s\n", dir.c_str());
+  }
+  if (s_failures) {
+    printf("\n%d mismatches\n", s_failures);
+    return 1;
+  }
+  return 0;
+}
@@ -2,6 +2,10 @@
 """
 Basic NTP Server - No frills, just works
 Listens on UDP port 123 and responds with current system time
+
+Only the transmit timestamp is filled. REMC_HostReceiver/ntp_server also
+fills originate and receive (kernel timestamps), which the device uses to
+measure the round trip; prefer it when it is built.
 """
 
 import socket
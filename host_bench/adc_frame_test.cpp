@@ -0,0 +1,131 @@
+/*
+  adc_frame_test – CM4 dual-ADC frame assembly (AdcFrame.h) on the host
+
+  Feeds adc_assemble_dual_frame() known ADC12_COMMON->CDR words and checks
+  where each half lands in Sample::raw[] order:
+
+    - every rank, master (low 16 bits) and slave (high 16 bits) half, with
+      a distinct value per half: each channel gets its own rank/half and the
+      slave filler is dropped
+    - the layout documented in AdcFrame.h: swI/swV share rank 1, outA/outB
+      rank 2, t1 rides on ADC1 rank 3
+    - the sequence covers each channel exactly once, and the filler channel
+      differs from the master's channel in its rank
+    - full 16-bit values survive (no masking to 12 bits), random words
+      match a straight per-rank reference
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -IREMC_GIGAR1_Core1 \
+        host_bench/adc_frame_test.cpp -o adc_frame_test
+*/
+
+#include "AdcFrame.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+static int s_failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) s_failures++;
+}
+
+static const char* shortName(uint8_t slot) {
+  static const char* names[ANALOG_CHANNEL_COUNT] = { "swV", "swI", "outA", "outB", "t1" };
+  return slot < ANALOG_CHANNEL_COUNT ? names[slot] : "filler";
+}
+
+// Value tagging rank r, half h (0 = master, 1 = slave)
+static uint16_t tag(uint8_t r, uint8_t h) {
+  return (uint16_t)(0x0A00u + 0x10u * r + h);
+}
+
+int main() {
+  char line[128];
+
+  printf("ranks\n");
+  {
+    uint32_t cdr[ADC_DUAL_RANKS];
+    for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+      cdr[r] = ((uint32_t)tag(r, 1) << 16) | tag(r, 0);
+    }
+    uint16_t out[ANALOG_CHANNEL_COUNT];
+    memset(out, 0, sizeof(out));
+    adc_assemble_dual_frame(cdr, out);
+
+    for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+      for (uint8_t h = 0; h < 2; ++h) {
+        const uint8_t slot = h ? kAdcDualSlaveSlot[r] : kAdcDualMasterSlot[r];
+        const bool ok = slot == ADC_SLOT_DISCARD || out[slot] == tag(r, h);
+        snprintf(line, sizeof(line), "rank %u %s -> %s", r + 1, h ? "slave " : "master", shortName(slot));
+        check(ok, line);
+      }
+    }
+
+    // AdcFrame.h's rank table, written out rather than read from the arrays
+    const uint16_t want[ANALOG_CHANNEL_COUNT] = {
+      tag(0, 1),   // swV  ADC2 rank 1
+      tag(0, 0),   // swI  ADC1 rank 1
+      tag(1, 0),   // outA ADC1 rank 2
+      tag(1, 1),   // outB ADC2 rank 2
+      tag(2, 0),   // t1   ADC1 rank 3
+    };
+    check(memcmp(out, want, sizeof(want)) == 0, "raw[] order matches the AdcFrame.h rank table");
+  }
+
+  printf("sequence\n");
+  {
+    uint8_t seen[ANALOG_CHANNEL_COUNT + 1] = {};
+    for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+      seen[kAdcDualMasterSlot[r]]++;
+      seen[kAdcDualSlaveSlot[r]]++;
+    }
+    bool once = true;
+    for (uint8_t i = 0; i < ANALOG_CHANNEL_COUNT; ++i) once &= seen[i] == 1;
+    check(once, "each channel converted exactly once");
+    check(seen[ADC_SLOT_DISCARD] == 2 * ADC_DUAL_RANKS - ANALOG_CHANNEL_COUNT, "one filler conversion");
+
+    bool fillerOk = true;
+    for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+      if (kAdcDualSlaveSlot[r] != ADC_SLOT_DISCARD) continue;
+      fillerOk &= kAnalogChannels[ADC_DUAL_FILLER_CHANNEL].adcChannel !=
+                  kAnalogChannels[kAdcDualMasterSlot[r]].adcChannel;
+    }
+    check(fillerOk, "filler channel differs from the master's in its rank");
+
+    bool paired = true;
+    for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+      const uint8_t m = kAdcDualMasterSlot[r], s = kAdcDualSlaveSlot[r];
+      if (m == CH_SWITCH_CURRENT) paired &= s == CH_SWITCH_VOLTAGE;
+      if (m == CH_OUTPUT_VOLTAGE_A) paired &= s == CH_OUTPUT_VOLTAGE_B;
+    }
+    check(paired, "V/I and output A/B pairs convert in the same rank");
+  }
+
+  printf("values\n");
+  {
+    uint32_t cdr[ADC_DUAL_RANKS];
+    uint16_t out[ANALOG_CHANNEL_COUNT];
+    for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) cdr[r] = 0xFFFF0000u | (0x8000u >> r);
+    adc_assemble_dual_frame(cdr, out);
+    check(out[CH_SWITCH_VOLTAGE] == 0xFFFF && out[CH_SWITCH_CURRENT] == 0x8000 &&
+          out[CH_TEMP_1] == 0x2000, "16-bit halves pass through unmasked");
+
+    std::mt19937 rng(53);
+    bool same = true;
+    for (int i = 0; i < 100000 && same; ++i) {
+      for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) cdr[r] = rng();
+      adc_assemble_dual_frame(cdr, out);
+      for (uint8_t r = 0; r < ADC_DUAL_RANKS; ++r) {
+        if (out[kAdcDualMasterSlot[r]] != (cdr[r] & 0xFFFFu)) same = false;
+        if (kAdcDualSlaveSlot[r] != ADC_SLOT_DISCARD && out[kAdcDualSlaveSlot[r]] != (cdr[r] >> 16)) same = false;
+      }
+    }
+    check(same, "100000 random frames match the per-rank reference");
+  }
+
+  printf("%s\n", s_failures ? "FAILED" : "all checks passed");
+  return s_failures ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+/*
+  beacon_filter_sim – host test for the CM7 BeaconFilter
+
+  Runs BeaconFilter.h against a simulated device clock and network and
+  compares the result with the unicast NTP sync it replaces:
+
+    - the device crystal runs fast by ~25 ppm, wanders, and in one scenario
+      drifts further with a temperature ramp
+    - the host multicasts a beacon every 250 ms; each one reaches the loop
+      after the wire and stack latency (exponential jitter, rare multi-ms
+      spikes, some loss) plus the wait for the next loop iteration
+      (CM7_WAKE_TICK_US) and, under load, a collect dump in progress
+    - the device adds half the shortest unicast round trip it has seen to
+      each beacon's transmit time, like TimeMapper::pollBeacons()
+    - the baseline syncs by unicast NTP every 10 s and holds rate 1 in
+      between, like TimeMapper::update() without beacons
+
+  The mapping under test mirrors TimeMapper: beacon filter when locked,
+  otherwise the unicast anchor, with an immediate unicast sync when the
+  filter starts over. The error of each mapping is sampled every 10 ms.
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -IREMC_GIGAR1_Core0 \
+        host_bench/beacon_filter_sim.cpp REMC_GIGAR1_Core0/BeaconFilter.cpp \
+        -o beacon_filter_sim
+*/
+
+#include "BeaconFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const double RUN_S = 600.0;
+static const double GRID_US = 10000.0;        // clock model and error sampling step
+static const double BEACON_US = 250000.0;
+static const double NTP_EVERY_US = 10e6;
+static const double LOOP_TICK_US = 1000.0;    // CM7_WAKE_TICK_US
+static const double TURNAROUND_US = 20.0;
+static const double SETTLE_S = 60.0;          // filter history filled; stats from here
+static const double RECOVER_S = 20.0;         // after a host step, excluded from stats
+static const uint64_t HOST_EPOCH_US = 1760000000000000ull;
+static const uint64_t HW_EPOCH_US = 12345678ull;
+
+struct Scenario {
+  const char* name;
+  double jitterUs;      // mean of the exponential part of one network leg
+  double busyFrac;      // beacons that wait out a collect dump too ...
+  double busyUs;        // ... of up to this long
+  double spikeFrac;     // legs delayed 2..30 ms
+  double lossFrac;
+  double stepAtS;       // host clock steps +50 ms here (0 = never)
+  double rampPpm;       // extra skew reached linearly over the run
+};
+
+class Model {
+public:
+  Model(const Scenario& sc, uint64_t seed) : _sc(sc), _rng(seed) {
+    const size_t n = (size_t)(RUN_S * 1e6 / GRID_US) + 2;
+    _hw.resize(n);
+    _rate.resize(n);
+    double hw = (double)HW_EPOCH_US, wander = 0.0;
+    std::normal_distribution<double> walk(0.0, 0.002);   // ppm per grid step
+    for (size_t i = 0; i < n; ++i) {
+      wander = std::max(-1.0, std::min(1.0, wander + walk(_rng)));
+      const double ppm = 25.0 + wander + sc.rampPpm * (double)i / (double)n;
+      _rate[i] = 1.0 + ppm * 1e-6;
+      _hw[i] = hw;
+      hw += GRID_US * _rate[i];
+    }
+  }
+
+  // Device HardwareTimer at true time t (µs since start)
+  double hwAt(double t) const {
+    const size_t i = std::min(_hw.size() - 1, (size_t)(t / GRID_US));
+    return _hw[i] + (t - (double)i * GRID_US) * _rate[i];
+  }
+  // Host clock at true time t
+  double hostAt(double t) const {
+    const double step = (_sc.stepAtS > 0 && t >= _sc.stepAtS * 1e6) ? 50000.0 : 0.0;
+    return (double)HOST_EPOCH_US + t + step;
+  }
+
+  double leg() {
+    double d = 40.0 + std::exponential_distribution<double>(1.0 / _sc.jitterUs)(_rng);
+    if (uni() < _sc.spikeFrac) d += 2000.0 + 28000.0 * uni();
+    return d;
+  }
+  double loopLag() {
+    double d = LOOP_TICK_US * uni();
+    if (uni() < _sc.busyFrac) d += _sc.busyUs * uni();
+    return d;
+  }
+  double uni() { return std::uniform_real_distribution<double>(0.0, 1.0)(_rng); }
+
+private:
+  const Scenario& _sc;
+  std::mt19937_64 _rng;
+  std::vector<double> _hw, _rate;
+};
+
+// Unicast NTP as NTPClient does it: anchor at transmit + rtt/2, rate 1 after
+struct UnicastAnchor {
+  double hw = 0.0, host = 0.0, rttUs = 0.0;
+
+  void sync(Model& m, double t) {
+    const double out = m.leg(), back = m.leg();
+    const double t3 = m.hostAt(t + out + TURNAROUND_US);
+    rttUs = out + back;
+    host = t3 + rttUs / 2.0;
+    hw = m.hwAt(t + out + TURNAROUND_US + back);
+  }
+  double toHost(double hwUs) const { return host + (hwUs - hw); }
+};
+
+static double percentile(std::vector<double> v, double q) {
+  if (v.empty()) return 0.0;
+  const size_t k = std::min(v.size() - 1, (size_t)(q * (double)v.size()));
+  std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+  return v[k];
+}
+
+static void record(std::vector<double>& e, double err, double t, double stepAt, double& lastBadS) {
+  if (t < SETTLE_S * 1e6) return;
+  if (stepAt > 0 && t >= stepAt * 1e6) {
+    if (std::fabs(err) > 1000.0) lastBadS = t / 1e6;
+    if (t < (stepAt + RECOVER_S) * 1e6) return;
+  }
+  e.push_back(std::fabs(err));
+}
+
+static bool runScenario(const Scenario& sc, uint64_t seed) {
+  Model m(sc, seed);
+  BeaconFilter filter;
+  UnicastAnchor baseline, fallback;
+  baseline.sync(m, 0.0);
+  fallback = baseline;
+  // Half the shortest round trip seen, as TimeMapper keeps from NTPClient::lastRttUs()
+  double halfRtt = baseline.rttUs / 2.0;
+
+  std::vector<double> eBase, eBeacon;
+  double lastBadBase = 0.0, lastBadBeacon = 0.0;
+  double nextBeacon = BEACON_US, nextNtp = NTP_EVERY_US;
+  // Beacons in flight, by the true time the loop reads them
+  std::vector<std::pair<double, double>> inFlight;   // (seen at, host transmit)
+
+  for (double t = 0.0; t < RUN_S * 1e6; t += GRID_US) {
+    while (nextBeacon <= t) {
+      if (m.uni() >= sc.lossFrac) {
+        const double seen = nextBeacon + m.leg() + m.loopLag();
+        inFlight.push_back(std::make_pair(seen, m.hostAt(nextBeacon)));
+      }
+      nextBeacon += BEACON_US;
+    }
+    std::sort(inFlight.begin(), inFlight.end());
+    size_t used = 0;
+    for (; used < inFlight.size() && inFlight[used].first <= t; ++used) {
+      const double hw = m.hwAt(inFlight[used].first);
+      const double host = inFlight[used].second + halfRtt;
+      if (filter.add((uint64_t)llround(hw), (uint64_t)llround(host)) == BeaconFilter::FILTER_RESET) {
+        fallback.sync(m, inFlight[used].first);
+        halfRtt = std::min(halfRtt, fallback.rttUs / 2.0);
+      }
+    }
+    inFlight.erase(inFlight.begin(), inFlight.begin() + (long)used);
+
+    while (nextNtp <= t) {
+      baseline.sync(m, nextNtp);
+      // TimeMapper skips the unicast sync while beacons hold the lock
+      if (!filter.locked()) {
+        fallback.sync(m, nextNtp);
+        halfRtt = std::min(halfRtt, fallback.rttUs / 2.0);
+      }
+      nextNtp += NTP_EVERY_US;
+    }
+
+    const double hw = m.hwAt(t), truth = m.hostAt(t);
+    record(eBase, baseline.toHost(hw) - truth, t, sc.stepAtS, lastBadBase);
+    const double mapped = filter.locked() ? (double)filter.toHost((uint64_t)llround(hw)) : fallback.toHost(hw);
+    record(eBeacon, mapped - truth, t, sc.stepAtS, lastBadBeacon);
+  }
+
+  const double bp50 = percentile(eBase, 0.5), bp99 = percentile(eBase, 0.99);
+  const double fp50 = percentile(eBeacon, 0.5), fp99 = percentile(eBeacon, 0.99);
+  const double bmax = eBase.empty() ? 0 : *std::max_element(eBase.begin(), eBase.end());
+  const double fmax = eBeacon.empty() ? 0 : *std::max_element(eBeacon.begin(), eBeacon.end());
+  const BeaconFilter::Stats& st = filter.stats();
+
+  bool ok = fp99 < bp99 && fp99 < 250.0 && fmax < 1000.0;
+  double recoverS = 0.0;
+  if (sc.stepAtS > 0) {
+    recoverS = lastBadBeacon > 0 ? lastBadBeacon - sc.stepAtS : 0.0;
+    if (recoverS > 12.0 || st.resets != 1) ok = false;
+  } else if (st.resets != 0) {
+    ok = false;
+  }
+
+  printf("  %-14s %-4s |error| µs  p50 %6.1f  p99 %6.1f  max %7.1f   (unicast %6.1f / %6.1f / %7.1f)\n",
+         sc.name, ok ? "ok" : "FAIL", fp50, fp99, fmax, bp50, bp99, bmax);
+  printf("  %-14s      crystal %+.2f ppm, %u beacons, %u windows, %u outliers, %u resets",
+         "", -filter.skewPpm(), st.beacons, st.windows, st.outliers, st.resets);
+  if (sc.stepAtS > 0) {
+    printf(", step recovered in %.1f s (unicast %.1f s)", recoverS,
+           lastBadBase > 0 ? lastBadBase - sc.stepAtS : 0.0);
+  }
+  printf("\n");
+  return ok;
+}
+
+int main() {
+  printf("beacon filter: window %u beacons, %u windows, step %u µs after %u beacons; beacon every %.0f ms\n",
+         (unsigned)BEACON_WINDOW_BEACONS, (unsigned)BEACON_HISTORY_WINDOWS, (unsigned)BEACON_STEP_US,
+         (unsigned)BEACON_STEP_BEACONS, BEACON_US / 1e3);
+
+  const Scenario scenarios[] = {
+    //  name           jitter busy  busyUs  spike  loss   step  ramp
+    { "quiet",           10.0, 0.00,    0.0, 0.00, 0.00,   0.0, 0.0 },
+    { "loaded",          60.0, 0.10, 8000.0, 0.00, 0.01,   0.0, 0.0 },
+    { "lossy-spikes",    30.0, 0.02, 4000.0, 0.02, 0.05,   0.0, 0.0 },
+    { "temp-ramp",       30.0, 0.02, 4000.0, 0.01, 0.01,   0.0, 6.0 },
+    { "host-step",       30.0, 0.02, 4000.0, 0.01, 0.01, 305.0, 0.0 },
+  };
+
+  int failures = 0;
+  uint64_t seed = 71;
+  for (const Scenario& sc : scenarios) {
+    if (!runScenario(sc, seed++)) failures++;
+  }
+  printf("%s\n", failures ? "FAILED" : "all scenarios passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,285 @@
+/*
+  decimator_bench – host check and benchmark for the CM7 Decimator
+
+  Runs the portable Decimator.cpp (REMC_USE_CMSIS_DSP off) on the host:
+
+    response   CIC and FIR stages against their theoretical magnitude
+               response: unity DC gain, the CIC sinc^N droop at several
+               tone frequencies, FIR passband flatness and stopband
+               attenuation, measured on the decimated output
+    bits       CicDecimator::configure() lowers the order until
+               R^N * 2^bits fits in 32 bits, and a full-scale input at
+               that order comes back unchanged (12- and 16-bit channels)
+    pipeline   Decimator::processBlock() with the default configuration:
+               temperature is filtered, a 1 kHz tone on it is gone, DC
+               passes, only the samples an output lands on carry it (the
+               rest are marked in Sample::held), the other channels are
+               untouched
+    speed      ns per input sample for the CIC and FIR stages, and per
+               Sample through processBlock() with the default configuration
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -IREMC_GIGAR1_Core0 \
+        host_bench/decimator_bench.cpp REMC_GIGAR1_Core0/Decimator.cpp -o decimator_bench
+*/
+
+#include "Decimator.h"
+#include "SharedRing.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static int s_failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) s_failures++;
+}
+
+static double nowNs() {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double toDb(double g) { return 20.0 * log10(g > 1e-12 ? g : 1e-12); }
+
+// Amplitude of the component at `f` (cycles/sample) in y, by projection
+// (the window holds many whole cycles, so leakage is negligible)
+static double toneAmplitude(const std::vector<double>& y, double f) {
+  double c = 0, s = 0, mean = 0;
+  for (double v : y) mean += v;
+  mean /= (double)y.size();
+  for (size_t i = 0; i < y.size(); ++i) {
+    c += (y[i] - mean) * cos(2.0 * M_PI * f * (double)i);
+    s += (y[i] - mean) * sin(2.0 * M_PI * f * (double)i);
+  }
+  return 2.0 * sqrt(c * c + s * s) / (double)y.size();
+}
+
+// Where a tone at f lands after keeping every R-th sample
+static double aliasOf(double f, uint32_t r) {
+  double fo = fmod(f * r, 1.0);
+  return fo > 0.5 ? 1.0 - fo : fo;
+}
+
+static double cicTheory(double f, uint32_t r, uint32_t n) {
+  if (f == 0.0) return 1.0;
+  return pow(fabs(sin(M_PI * f * r) / (r * sin(M_PI * f))), (double)n);
+}
+
+static const double MID = 2048.0, AMP = 1500.0;
+static const size_t SETTLE = 64;       // outputs dropped while the filter fills
+
+// Decimated output of a CIC fed an integer tone at f
+static std::vector<double> runCic(CicDecimator& cic, double f, size_t outputs) {
+  std::vector<double> y;
+  y.reserve(outputs);
+  float out;
+  for (size_t i = 0; y.size() < outputs + SETTLE; ++i) {
+    const double x = MID + AMP * sin(2.0 * M_PI * f * (double)i);
+    if (cic.push((uint32_t)lround(x), out)) y.push_back(out);
+  }
+  y.erase(y.begin(), y.begin() + SETTLE);
+  return y;
+}
+
+static std::vector<double> runFir(FirDecimator& fir, double f, size_t outputs) {
+  std::vector<double> y;
+  y.reserve(outputs);
+  float out;
+  for (size_t i = 0; y.size() < outputs + SETTLE; ++i) {
+    if (fir.push((float)(MID + AMP * sin(2.0 * M_PI * f * (double)i)), out)) y.push_back(out);
+  }
+  y.erase(y.begin(), y.begin() + SETTLE);
+  return y;
+}
+
+static void benchResponse() {
+  printf("response\n");
+  const uint32_t R = DECIM_TEMP_1_CIC_FACTOR, N = DECIM_TEMP_1_CIC_ORDER;
+  CicDecimator cic;
+
+  // DC: the integer path is exact, the 1 / R^N scaling rounds in float
+  cic.configure(R, N, 12);
+  float out = 0;
+  bool dcOk = true;
+  for (int i = 0; i < 50 * (int)R; ++i) {
+    if (cic.push(4095, out) && i > 10 * (int)R) dcOk &= fabsf(out - 4095.0f) < 1e-3f;
+  }
+  check(dcOk, "CIC DC gain 1 (4095 in, 4095 out)");
+
+  printf("    %-8s %-9s %10s %10s\n", "CIC", "f/fs", "theory dB", "meas dB");
+  const double freqs[] = { 0.0131, 0.0372, 0.0617, 0.1290, 0.2730 };
+  double worst = 0;
+  for (double f : freqs) {
+    cic.configure(R, N, 12);
+    const std::vector<double> y = runCic(cic, f, 20000);
+    const double meas = toneAmplitude(y, aliasOf(f, R)) / AMP, want = cicTheory(f, R, N);
+    printf("    %-8s %-9.4f %10.2f %10.2f\n", "", f, toDb(want), toDb(meas));
+    // Quantized input: compare in amplitude, a fraction of a count
+    worst = std::max(worst, fabs(meas - want) * AMP);
+  }
+  char line[96];
+  snprintf(line, sizeof(line), "CIC R=%u N=%u follows sinc^N (worst %.3f counts)", R, N, worst);
+  check(worst < 0.05, line);
+
+  const uint32_t FR = DECIM_TEMP_1_FIR_FACTOR;
+  FirDecimator fir;
+  fir.configure(FR, DECIM_TEMP_1_FIR_TAPS);
+  dcOk = true;
+  for (int i = 0; i < 100 * (int)FR; ++i) {
+    if (fir.push(3000.0f, out) && i > 10 * (int)FR) dcOk &= fabsf(out - 3000.0f) < 1e-3f;
+  }
+  check(dcOk, "FIR DC gain 1");
+
+  // New Nyquist is 0.5 / FR; the cutoff sits at 90% of it
+  printf("    %-8s %-9s %10s\n", "FIR", "f/fs", "meas dB");
+  double passWorst = 0, stopWorst = -200;
+  const double pass[] = { 0.0037, 0.0113, 0.0191 };
+  const double stop[] = { 0.1013, 0.1571, 0.2330, 0.3710, 0.4630 };
+  for (double f : pass) {
+    fir.configure(FR, DECIM_TEMP_1_FIR_TAPS);
+    const double g = toneAmplitude(runFir(fir, f, 8000), aliasOf(f, FR)) / AMP;
+    printf("    %-8s %-9.4f %10.2f  pass\n", "", f, toDb(g));
+    passWorst = std::max(passWorst, fabs(toDb(g)));
+  }
+  for (double f : stop) {
+    fir.configure(FR, DECIM_TEMP_1_FIR_TAPS);
+    const double g = toneAmplitude(runFir(fir, f, 8000), aliasOf(f, FR)) / AMP;
+    printf("    %-8s %-9.4f %10.2f  stop\n", "", f, toDb(g));
+    stopWorst = std::max(stopWorst, toDb(g));
+  }
+  // A 48-tap Blackman rolls off early: ~0.7 dB at 0.4 x the new Nyquist
+  snprintf(line, sizeof(line), "FIR passband within 1 dB below 0.4 x new Nyquist (%.2f dB)", passWorst);
+  check(passWorst < 1.0, line);
+  snprintf(line, sizeof(line), "FIR stopband below -60 dB from 2 x new Nyquist (%.1f dB)", stopWorst);
+  check(stopWorst < -60.0, line);
+}
+
+static void benchBits() {
+  printf("bits\n");
+  struct Case { uint16_t r; uint8_t n; uint8_t bits; uint8_t order; };
+  // R^N * 2^bits <= 2^32
+  const Case cases[] = {
+    { 10, 3, 12, 3 },    // 2^22
+    { 64, 4, 12, 3 },    // 64^4 * 2^12 = 2^36 -> 64^3 * 2^12 = 2^30
+    { 64, 3, 16, 2 },    // 64^3 * 2^16 = 2^34 -> 64^2 * 2^16 = 2^28
+    { 256, 2, 16, 2 },   // 2^32 exactly
+    { 256, 3, 12, 2 },   // 2^36 -> 2^28
+  };
+  bool ordersOk = true, exact = true;
+  for (const Case& c : cases) {
+    CicDecimator cic;
+    cic.configure(c.r, c.n, c.bits);
+    ordersOk &= cic.getOrder() == c.order;
+    const uint32_t full = (1u << c.bits) - 1;
+    float out = 0;
+    for (uint32_t i = 0; i < 20u * c.r; ++i) {
+      if (cic.push(full, out) && i >= 10u * c.r) exact &= fabs((double)out - full) <= 1e-6 * full;
+    }
+    printf("    R=%-4u N=%u %2u-bit -> order %u, full scale %u -> %.1f\n", c.r, c.n, c.bits, cic.getOrder(),
+           full, out);
+  }
+  check(ordersOk, "order lowered until R^N * 2^bits fits in 32 bits");
+  check(exact, "full-scale input unwraps at that order");
+}
+
+static void benchPipeline() {
+  printf("pipeline\n");
+  Decimator::init();
+  const uint32_t total = Decimator::getTotalFactor(CH_TEMP_1);
+  const size_t BLOCK = 37, BLOCKS = 2000;
+  std::vector<Sample> block(BLOCK);
+  uint64_t n = 0;
+  bool othersOk = true, heldOk = true;
+  uint64_t carried = 0;
+  double lo = 1e9, hi = -1e9;
+  for (size_t b = 0; b < BLOCKS; ++b) {
+    for (size_t i = 0; i < BLOCK; ++i, ++n) {
+      Sample& s = block[i];
+      memset(&s, 0, sizeof(s));
+      for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) s.raw[ch] = (uint16_t)((n * 7 + ch * 331) & 0x0FFF);
+      // 1 kHz at 10 kHz: 500 counts of tone on 1000 counts of DC
+      s.raw[CH_TEMP_1] = (uint16_t)lround(1000.0 + 500.0 * sin(2.0 * M_PI * 0.1 * (double)n));
+    }
+    Decimator::processBlock(block.data(), BLOCK);
+    for (size_t i = 0; i < BLOCK; ++i) {
+      const uint64_t k = n - BLOCK + i;
+      for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+        if (ch != CH_TEMP_1) othersOk &= block[i].raw[ch] == (uint16_t)((k * 7 + ch * 331) & 0x0FFF);
+      }
+      // Outputs land on every total-th input, counted from the first
+      const bool output = (k + 1) % total == 0;
+      heldOk &= block[i].held == (output ? 0 : 1u << CH_TEMP_1);
+      if (!output) continue;
+      carried++;
+      if (k > 20000) {
+        lo = std::min(lo, (double)block[i].raw[CH_TEMP_1]);
+        hi = std::max(hi, (double)block[i].raw[CH_TEMP_1]);
+      }
+    }
+  }
+  printf("    temperature total factor %u, %u outputs from %llu samples, settled output %.0f..%.0f\n", total,
+         Decimator::getOutputCount(CH_TEMP_1), (unsigned long long)n, lo, hi);
+  check(total == DECIM_TEMP_1_CIC_FACTOR * DECIM_TEMP_1_FIR_FACTOR, "temperature decimated by CIC x FIR factor");
+  check(Decimator::getOutputCount(CH_TEMP_1) == n / total, "one output per total factor inputs");
+  check(heldOk && carried == n / total, "temperature only on output samples, held bit on the rest");
+  check(lo >= 999.0 && hi <= 1001.0, "1 kHz tone removed, DC kept (within a count)");
+  check(othersOk, "full-rate channels pass through untouched");
+}
+
+static void benchSpeed() {
+  printf("speed\n");
+  const size_t N = 20000000;
+  std::vector<uint16_t> x(4096);
+  for (size_t i = 0; i < x.size(); ++i) x[i] = (uint16_t)((i * 2654435761u) >> 20);
+
+  CicDecimator cic;
+  cic.configure(DECIM_TEMP_1_CIC_FACTOR, DECIM_TEMP_1_CIC_ORDER, 12);
+  float out, sink = 0;
+  double t0 = nowNs();
+  for (size_t i = 0; i < N; ++i) {
+    if (cic.push(x[i & 4095], out)) sink += out;
+  }
+  const double cicNs = (nowNs() - t0) / N;
+
+  FirDecimator fir;
+  fir.configure(DECIM_TEMP_1_FIR_FACTOR, DECIM_TEMP_1_FIR_TAPS);
+  t0 = nowNs();
+  for (size_t i = 0; i < N; ++i) {
+    if (fir.push((float)x[i & 4095], out)) sink += out;
+  }
+  const double firNs = (nowNs() - t0) / N;
+
+  Decimator::init();
+  const size_t BLOCK = 64;
+  std::vector<Sample> block(BLOCK);
+  for (size_t i = 0; i < BLOCK; ++i) {
+    memset(&block[i], 0, sizeof(Sample));
+    for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) block[i].raw[ch] = x[(i * 5 + ch) & 4095];
+  }
+  const size_t rounds = N / BLOCK;
+  t0 = nowNs();
+  for (size_t r = 0; r < rounds; ++r) Decimator::processBlock(block.data(), BLOCK);
+  const double pipeNs = (nowNs() - t0) / (rounds * BLOCK);
+
+  printf("    CIC R=%u N=%u       %6.2f ns/input\n", DECIM_TEMP_1_CIC_FACTOR, DECIM_TEMP_1_CIC_ORDER, cicNs);
+  printf("    FIR R=%u %u taps    %6.2f ns/input\n", DECIM_TEMP_1_FIR_FACTOR, DECIM_TEMP_1_FIR_TAPS, firNs);
+  printf("    processBlock       %6.2f ns/sample (default config: temperature filtered)\n", pipeNs);
+  printf("    at 10 kHz: %.3f%% of one core\n", pipeNs * 10000.0 / 1e7);
+  if (sink == 12345.0f) printf(" \n");
+}
+
+int main(int argc, char** argv) {
+  const char* mode = argc > 1 ? argv[1] : "all";
+  const bool all = strcmp(mode, "all") == 0;
+  if (all || strcmp(mode, "response") == 0) benchResponse();
+  if (all || strcmp(mode, "bits") == 0) benchBits();
+  if (all || strcmp(mode, "pipeline") == 0) benchPipeline();
+  if (all || strcmp(mode, "speed") == 0) benchSpeed();
+  printf("%s\n", s_failures ? "FAILED" : "all checks passed");
+  return s_failures ? 1 : 0;
+}
@@ -0,0 +1,536 @@
+/*
+  device_emulator – a REMC device on the network, without the hardware
+
+  Runs the firmware's own CM7 pipeline (SampleCollector, UdpManager,
+  Decimator, SpectrumMonitor, TraceRecorder, MD5) against the Arduino shims
+  in host_bench/shim/, fed by a synthetic Core 1, and puts what it sends on
+  a real socket. Header, schema fragments, schema hash, the 42-byte sample
+  layout, collect dumps and batch-end markers are therefore byte for byte
+  what UdpManager builds on the GIGA R1 – only the source of the samples
+  and the clock differ. It is the traffic source for the host receiver
+  benchmarks.
+
+  The hardware seams are replaced here:
+
+    SharedRing_Consume()     synthetic frames for the current iteration
+                             (--wave fire | ramp | noise)
+    EthernetUDP (telemetry)  sendto() to --dest (default 239.9.9.33:13013)
+    EthernetUDP (commands)   a socket joined to 239.9.9.32:13012; every
+                             datagram goes through UdpManager::update()
+                             like on the device
+    StateManager             arm/fire/disarm/manual/hold flags for the
+                             status bytes; 0x02 fires a pulse
+    TimeMapper::sampleToNTP  Unix µs at start + sample clock, which starts
+                             10 s before a 32-bit tick rollover
+
+  The firmware only sends samples as collect dumps (0x04). A live stream
+  (FLAGS_NORMAL, 33 samples per datagram, each iteration flushed) is added
+  through UdpManager::addSample() unless --no-live, since that is what the
+  host receiver records continuously.
+
+  Usage:
+    device_emulator [--rate HZ] [--max] [--seconds N] [--wave fire|ramp|noise]
+                    [--fire-every S] [--collect START:STOP] [--gap-every S]
+                    [--dest IP[:PORT]] [--iface IP] [--source IP] [--no-live]
+                    [--seed N] [--verbose]
+        --rate        sample rate, 10000 (default) to 1000000
+        --max         no pacing: iterations back to back on a virtual clock,
+                      as fast as the host can send (line rate)
+        --fire-every  a fire pulse every S seconds (default 2, 0 = only on 0x02)
+        --collect     self-issue a 0x04 collect with this window after every
+                      fire, as the host app does (e.g. -1000:4000)
+        --gap-every   drop 20 ms of frames every S seconds (gap markers and
+                      FLAGS_FAULT events)
+        --source      send from this address: several emulators with
+                      127.0.0.x sources are separate units to the receiver
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -Ihost_bench/shim -IREMC_GIGAR1_Core0 \
+        host_bench/device_emulator.cpp host_bench/shim/host_arduino.cpp \
+        REMC_GIGAR1_Core0/SampleCollector.cpp REMC_GIGAR1_Core0/UdpManager.cpp \
+        REMC_GIGAR1_Core0/Decimator.cpp REMC_GIGAR1_Core0/SpectrumMonitor.cpp \
+        REMC_GIGAR1_Core0/AcquisitionWatchdog.cpp REMC_GIGAR1_Core0/TraceRecorder.cpp \
+        REMC_GIGAR1_Core0/MD5.cpp -o device_emulator
+*/
+
+#include "trace_file.h"
+
+#include <Arduino.h>
+#include <EthernetUdp.h>
+#include <TimeLib.h>
+#include "SharedRing.h"
+#include "SampleCollector.h"
+#include "UdpManager.h"
+#include "StateManager.h"
+#include "TimeMapper.h"
+#include "HardwareTimer.h"
+#include "TraceRecorder.h"
+#include "AcquisitionWatchdog.h"
+#include "Config.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* COMMAND_GROUP = "239.9.9.32";
+static const double GAP_MS = 20.0;
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int) { s_stop = 1; }
+
+// ====================== Firmware seams ======================
+
+static SharedRing s_ring;
+SharedRing& g_ring = s_ring;
+
+static const std::vector<Sample>* s_pending = nullptr;
+static size_t s_pendingPos = 0;
+static SharedRingHealth s_health = {};
+
+void SharedRing_Init() {
+  ring_init(s_ring);
+}
+
+size_t SharedRing_Consume(Sample* out, int32_t max_samples) {
+  if (!s_pending || !out) return 0;
+  size_t n = s_pending->size() - s_pendingPos;
+  if (max_samples >= 0 && (size_t)max_samples < n) n = (size_t)max_samples;
+  memcpy(out, s_pending->data() + s_pendingPos, n * sizeof(Sample));
+  s_pendingPos += n;
+  return n;
+}
+
+size_t SharedRing_Available() {
+  return s_pending ? s_pending->size() - s_pendingPos : 0;
+}
+
+void SharedRing_GetHealth(SharedRingHealth& out) {
+  out = s_health;
+}
+
+uint64_t HardwareTimer::getMicros64() {
+  return HostClock::micros64();
+}
+
+// Sample clock → Unix µs; set once the clocks are started
+static uint64_t s_hwStartUs = 0;
+static uint64_t s_unixStartUs = 0;
+
+uint64_t TimeMapper::sampleToNTP(uint32_t t_us, uint32_t rollover_count) {
+  return s_unixStartUs + ((((uint64_t)rollover_count << 32) | t_us) - s_hwStartUs);
+}
+
+static bool s_fireRequested = false;
+
+namespace StateManager {
+static bool s_armed = false;
+static bool s_emManual = false;
+static bool s_firing = false;      // set by the main loop during a pulse
+static bool s_manual = false;
+static bool s_hold = false;
+void requestArm() { s_armed = true; }
+void requestDisarm() { s_armed = false; s_emManual = false; }
+void triggerSoftwareActuate() { if (s_armed || s_manual) s_fireRequested = true; }
+void manualActuatorControl(ActuatorMoveState) {}
+void manualEMEnable() { if (s_manual) s_emManual = true; }
+void manualEMDisable() { s_emManual = false; }
+void enableManualMode() { s_manual = true; }
+void disableManualMode() { s_manual = false; s_emManual = false; }
+void enableHoldAfterFireMode() { s_hold = true; }
+void disableHoldAfterFireMode() { s_hold = false; }
+bool isHoldAfterFireModeActive() { return s_hold; }
+bool isReady() { return s_armed && !s_manual; }
+bool isEmActActive() { return s_firing || s_emManual; }
+bool isManualModeActive() { return s_manual; }
+}
+
+// ====================== Synthetic Core 1 ======================
+
+enum Wave { WAVE_FIRE, WAVE_RAMP, WAVE_NOISE };
+
+// Raw counts for 0 kV / 0 kA / 25 °C (ChannelTable.h scale and offset)
+static uint16_t rawFor(uint8_t ch, float value) {
+  const float raw = (value - kAnalogChannels[ch].offset) / kAnalogChannels[ch].scale;
+  return (uint16_t)(raw < 0 ? 0 : raw > ADC_MAX_VALUE ? ADC_MAX_VALUE : raw + 0.5f);
+}
+
+class SignalSource {
+public:
+  SignalSource(Wave wave, uint64_t seed)
+    : _wave(wave), _rng(seed ? seed : 0x9E3779B97F4A7C15ull), _lastFire(-1e9) {
+    for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) _zero[ch] = rawFor(ch, 0.0f);
+    _zero[CH_TEMP_1] = rawFor(CH_TEMP_1, 25.0f);
+  }
+
+  void fire(double t) { _lastFire = t; }
+  bool firing(double t) const { return t - _lastFire < 0.05; }
+
+  void fill(Sample& s, uint64_t index, double t) {
+    for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+      int v;
+      switch (_wave) {
+      case WAVE_RAMP:
+        // Sawtooth, one count per sample, channels a quarter turn apart
+        v = (int)((index + ch * 1024u) & 0xFFF);
+        break;
+      case WAVE_NOISE:
+        v = (int)(next() & 0xFFF);
+        break;
+      default:
+        v = firePulse(ch, t) + (int)(next() % 9) - 4;
+        break;
+      }
+      s.raw[ch] = (uint16_t)(v < 0 ? 0 : v > 4095 ? 4095 : v);
+    }
+  }
+
+private:
+  // Charge ramp on the switch, then at the fire a damped current ring and
+  // an output pulse (B inverted); the temperature creeps up with each shot
+  int firePulse(uint8_t ch, double t) const {
+    const double dt = t - _lastFire;
+    const double decay = dt >= 0 ? exp(-dt / 0.002) : 0.0;
+    switch (ch) {
+    case CH_SWITCH_VOLTAGE: {
+      const double charge = std::min(1.0, std::max(0.0, (dt - 0.2) / 1.5));
+      return _zero[ch] + (int)(1350 * charge * (1.0 - decay));
+    }
+    case CH_SWITCH_CURRENT:
+      return _zero[ch] + (int)(1500 * decay * sin(2 * M_PI * 1000.0 * dt));
+    case CH_OUTPUT_VOLTAGE_A:
+      return _zero[ch] + (int)(800 * decay);
+    case CH_OUTPUT_VOLTAGE_B:
+      return _zero[ch] - (int)(800 * decay);
+    default:
+      return _zero[ch] + (int)(40 * exp(-std::max(0.0, dt) / 30.0));
+    }
+  }
+
+  uint64_t next() {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 7;
+    _rng ^= _rng << 17;
+    return _rng;
+  }
+
+  Wave _wave;
+  uint64_t _rng;
+  double _lastFire;
+  int _zero[ANALOG_CHANNEL_COUNT];
+};
+
+// ====================== Network ======================
+
+struct NetStats {
+  uint64_t packets[32];      // by header flags
+  uint64_t samples;          // in flag 0/1 packets
+  uint64_t bytes;
+  uint64_t sendErrors;
+  uint64_t commands;
+};
+static NetStats s_net;
+static int s_sendFd = -1;
+static sockaddr_in s_dest;
+static const size_t WIRE_SAMPLE_BYTES = ChannelTable::analogWireBytes() + 8 + 6 + 8;
+
+static void onSend(uint16_t, const uint8_t* data, size_t len) {
+  if (len < NEUTRINO_HEADER_BYTES) return;
+  const uint32_t flags = neutrinoFlags(data);
+  if (sendto(s_sendFd, data, len, 0, (const sockaddr*)&s_dest, sizeof(s_dest)) < 0) {
+    s_net.sendErrors++;
+    return;
+  }
+  s_net.packets[flags < 32 ? flags : 31]++;
+  if (flags <= 1) s_net.samples += (len - NEUTRINO_HEADER_BYTES) / WIRE_SAMPLE_BYTES;
+  s_net.bytes += len;
+}
+
+static bool openSockets(const char* dest, const char* iface, const char* source, int& cmdFd) {
+  std::string host(dest);
+  uint16_t port = Config::TELEMETRY_PORT;
+  const size_t colon = host.find(':');
+  if (colon != std::string::npos) {
+    port = (uint16_t)atoi(host.c_str() + colon + 1);
+    host.resize(colon);
+  }
+  memset(&s_dest, 0, sizeof(s_dest));
+  s_dest.sin_family = AF_INET;
+  s_dest.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &s_dest.sin_addr) != 1) {
+    fprintf(stderr, "bad --dest %s\n", dest);
+    return false;
+  }
+
+  s_sendFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (s_sendFd < 0) { perror("socket"); return false; }
+  in_addr ifAddr;
+  ifAddr.s_addr = iface ? inet_addr(iface) : htonl(INADDR_ANY);
+  setsockopt(s_sendFd, IPPROTO_IP, IP_MULTICAST_IF, &ifAddr, sizeof(ifAddr));
+  unsigned char ttl = 1, loop = 1;   // a receiver on this host sees the stream too
+  setsockopt(s_sendFd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  setsockopt(s_sendFd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  int sndbuf = 4 * 1024 * 1024;
+  setsockopt(s_sendFd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+  if (source) {
+    sockaddr_in src;
+    memset(&src, 0, sizeof(src));
+    src.sin_family = AF_INET;
+    if (inet_pton(AF_INET, source, &src.sin_addr) != 1) {
+      fprintf(stderr, "bad --source %s\n", source);
+      return false;
+    }
+    if (bind(s_sendFd, (sockaddr*)&src, sizeof(src)) < 0) { perror("bind --source"); return false; }
+  }
+
+  cmdFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (cmdFd < 0) { perror("socket"); return false; }
+  int one = 1;
+  setsockopt(cmdFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(Config::COMMAND_PORT);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(cmdFd, (sockaddr*)&local, sizeof(local)) < 0) { perror("bind command port"); return false; }
+  ip_mreq mreq;
+  mreq.imr_multiaddr.s_addr = inet_addr(COMMAND_GROUP);
+  mreq.imr_interface.s_addr = ifAddr.s_addr;
+  if (setsockopt(cmdFd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+    perror("IP_ADD_MEMBERSHIP");
+    return false;
+  }
+  fcntl(cmdFd, F_SETFL, fcntl(cmdFd, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+// UdpManager::update() handles one command per loop iteration, as on the device
+static void runCommand(const uint8_t* dgram, size_t len) {
+  HostNet::inject(Config::COMMAND_PORT, dgram, len);
+  UdpManager::update();
+  s_net.commands++;
+}
+
+static void selfCommand(int32_t start, int32_t stop) {
+  uint8_t dgram[NEUTRINO_HEADER_BYTES + 9];
+  memset(dgram, 0, sizeof(dgram));
+  dgram[NEUTRINO_HEADER_BYTES] = 0x04;
+  memcpy(dgram + NEUTRINO_HEADER_BYTES + 1, &start, 4);
+  memcpy(dgram + NEUTRINO_HEADER_BYTES + 5, &stop, 4);
+  runCommand(dgram, sizeof(dgram));
+}
+
+// ====================== Main loop ======================
+
+static uint64_t unixMicros() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv) {
+  double rateHz = Config::ANALOG_SAMPLE_FREQUENCY_HZ;
+  bool unpaced = false;
+  double seconds = 0.0;
+  Wave wave = WAVE_FIRE;
+  double fireEvery = 2.0;
+  bool collect = false;
+  int32_t collectStart = 0, collectStop = 0;
+  double gapEvery = 0.0;
+  const char* dest = "239.9.9.33";
+  const char* iface = nullptr;
+  const char* sourceIp = nullptr;
+  bool live = true;
+  uint64_t seed = 1;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool hasArg = i + 1 < argc;
+    if (!strcmp(argv[i], "--rate") && hasArg) rateHz = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--max")) unpaced = true;
+    else if (!strcmp(argv[i], "--seconds") && hasArg) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--wave") && hasArg) {
+      const char* w = argv[++i];
+      if (!strcmp(w, "fire")) wave = WAVE_FIRE;
+      else if (!strcmp(w, "ramp")) wave = WAVE_RAMP;
+      else if (!strcmp(w, "noise")) wave = WAVE_NOISE;
+      else { fprintf(stderr, "unknown wave %s\n", w); return 2; }
+    }
+    else if (!strcmp(argv[i], "--fire-every") && hasArg) fireEvery = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--collect") && hasArg) {
+      if (sscanf(argv[++i], "%d:%d", &collectStart, &collectStop) != 2 || collectStop <= collectStart) {
+        fprintf(stderr, "bad --collect %s (START:STOP)\n", argv[i]);
+        return 2;
+      }
+      collect = true;
+    }
+    else if (!strcmp(argv[i], "--gap-every") && hasArg) gapEvery = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--dest") && hasArg) dest = argv[++i];
+    else if (!strcmp(argv[i], "--iface") && hasArg) iface = argv[++i];
+    else if (!strcmp(argv[i], "--source") && hasArg) sourceIp = argv[++i];
+    else if (!strcmp(argv[i], "--no-live")) live = false;
+    else if (!strcmp(argv[i], "--seed") && hasArg) seed = strtoull(argv[++i], nullptr, 0);
+    else if (!strcmp(argv[i], "--verbose")) verbose = true;
+    else {
+      fprintf(stderr, "usage: %s [--rate HZ] [--max] [--seconds N] [--wave fire|ramp|noise]\n"
+                      "          [--fire-every S] [--collect START:STOP] [--gap-every S]\n"
+                      "          [--dest IP[:PORT]] [--iface IP] [--source IP] [--no-live] [--seed N] [--verbose]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (rateHz < Config::ANALOG_SAMPLE_FREQUENCY_HZ || rateHz > 1e6) {
+    // Below 10 kHz the collector would mark every other slot as a gap; above
+    // 1 MHz the µs timestamps repeat
+    fprintf(stderr, "--rate must be %u..1000000\n", Config::ANALOG_SAMPLE_FREQUENCY_HZ);
+    return 2;
+  }
+
+  int cmdFd = -1;
+  if (!openSockets(dest, iface, sourceIp, cmdFd)) return 1;
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  // Sample clock starts 10 s before a 32-bit rollover
+  s_hwStartUs = 0x100000000ull - 10000000ull;
+  s_unixStartUs = unixMicros();
+  HostClock::setMicros(s_hwStartUs);
+  const time_t epoch = (time_t)(s_unixStartUs / 1000000u);
+  struct tm utc;
+  gmtime_r(&epoch, &utc);
+  setTime(utc.tm_hour, utc.tm_min, utc.tm_sec, utc.tm_mday, utc.tm_mon + 1, utc.tm_year + 1900);
+
+  Serial.setEcho(verbose);
+  HostNet::setSendHook(onSend);
+  SampleCollector::init();
+  UdpManager::init();
+  TraceRecorder::init();
+  AcquisitionWatchdog::init(millis(), 0, 0);
+  memset(&s_net, 0, sizeof(s_net));
+
+  printf("device_emulator: %.0f Hz %s, %s wave, fire every %.1f s%s, %s live stream -> %s\n",
+         rateHz, unpaced ? "unpaced" : "paced",
+         wave == WAVE_FIRE ? "fire" : wave == WAVE_RAMP ? "ramp" : "noise", fireEvery,
+         collect ? " + collect" : "", live ? "with" : "no", dest);
+  fflush(stdout);
+
+  SignalSource source(wave, seed);
+  std::vector<Sample> frames;
+  const double periodUs = 1e6 / rateHz;
+  const uint64_t iterationUs = 1000;   // one CM7 loop() per ms of samples
+  uint64_t index = 0;                  // next sample index
+  uint64_t virtualUs = 0;              // since start
+  double nextFire = fireEvery > 0 ? 0.5 : -1.0;
+  double nextGap = gapEvery > 0 ? gapEvery : -1.0;
+  double gapFrom = -1.0, gapUntil = -1.0;
+  uint32_t heartbeat = 0;
+
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point wallStart = Clock::now();
+  Clock::time_point lastReport = wallStart;
+  NetStats reported = s_net;
+
+  while (!s_stop) {
+    virtualUs += iterationUs;
+    if (!unpaced) std::this_thread::sleep_until(wallStart + std::chrono::microseconds(virtualUs));
+    const double t = virtualUs * 1e-6;
+    if (seconds > 0 && t > seconds) break;
+    HostClock::setMicros(s_hwStartUs + virtualUs);
+
+    if (nextGap > 0 && t >= nextGap) {
+      gapFrom = t;
+      gapUntil = t + GAP_MS / 1000.0;
+      nextGap += gapEvery;
+    }
+    bool fired = false;
+    if ((nextFire >= 0 && t >= nextFire) || s_fireRequested) {
+      source.fire(t);
+      fired = true;
+      s_fireRequested = false;
+      if (nextFire >= 0 && t >= nextFire) nextFire += fireEvery;
+    }
+    StateManager::s_firing = source.firing(t);
+
+    // Everything Core 1 produced up to now
+    frames.clear();
+    for (; (double)index * periodUs < (double)virtualUs; ++index) {
+      heartbeat++;
+      const double ts = index * periodUs * 1e-6;
+      if (ts >= gapFrom && ts < gapUntil) continue;
+      const uint64_t tUs = s_hwStartUs + (uint64_t)(index * periodUs);
+      Sample s;
+      memset(&s, 0, sizeof(s));
+      s.t_us = (uint32_t)tUs;
+      s.rollover_count = (uint32_t)(tUs >> 32);
+      const uint64_t eUs = tUs + 9;
+      s.t_us_end = (uint32_t)eUs;
+      s.rollover_count_end = (uint32_t)(eUs >> 32);
+      source.fill(s, index, ts);
+      frames.push_back(s);
+    }
+
+    // CM7 loop(): collector (collect dumps, spectral, gap events), commands, trace
+    s_health.heartbeat = heartbeat;
+    TraceRecorder::loopBegin((uint32_t)(virtualUs / iterationUs));
+    s_pending = &frames;
+    s_pendingPos = 0;
+    do {
+      SampleCollector::update();
+    } while (s_pendingPos < frames.size());
+    s_pending = nullptr;
+
+    if (live) {
+      for (const Sample& s : frames) UdpManager::addSample(s);
+      UdpManager::flushSamples();
+    }
+
+    if (fired && collect) selfCommand(collectStart, collectStop);
+    uint8_t dgram[128];
+    ssize_t n;
+    while ((n = recv(cmdFd, dgram, sizeof(dgram), 0)) > 0) runCommand(dgram, (size_t)n);
+    TraceRecorder::flush();
+
+    const Clock::time_point wallNow = Clock::now();
+    if (wallNow - lastReport >= std::chrono::seconds(1)) {
+      const double dt = std::chrono::duration<double>(wallNow - lastReport).count();
+      printf("[Emu] t=%.1fs  %.0f pkt/s  %.1f Mbit/s  live %llu  collected %llu  batch ends %llu  "
+             "spectral %llu  fault %llu  commands %llu  send errors %llu\n",
+             t, (s_net.packets[0] + s_net.packets[1] - reported.packets[0] - reported.packets[1]) / dt,
+             (s_net.bytes - reported.bytes) * 8e-6 / dt,
+             (unsigned long long)s_net.packets[0], (unsigned long long)s_net.packets[1],
+             (unsigned long long)s_net.packets[2], (unsigned long long)s_net.packets[4],
+             (unsigned long long)s_net.packets[8], (unsigned long long)s_net.commands,
+             (unsigned long long)s_net.sendErrors);
+      fflush(stdout);
+      lastReport = wallNow;
+      reported = s_net;
+    }
+  }
+
+  const double wallS = std::chrono::duration<double>(Clock::now() - wallStart).count();
+  printf("device_emulator: %.1f s emulated in %.1f s, %llu samples generated\n",
+         virtualUs * 1e-6, wallS, (unsigned long long)index);
+  printf("  sent        %llu live, %llu collected, %llu batch ends, %llu spectral, %llu fault, "
+         "%llu trace packets; %llu samples, %.1f MB (%.1f Mbit/s)\n",
+         (unsigned long long)s_net.packets[0], (unsigned long long)s_net.packets[1],
+         (unsigned long long)s_net.packets[2], (unsigned long long)s_net.packets[4],
+         (unsigned long long)s_net.packets[8], (unsigned long long)s_net.packets[16],
+         (unsigned long long)s_net.samples, s_net.bytes / 1e6, s_net.bytes * 8e-6 / wallS);
+  printf("  commands    %llu, send errors %llu, collector gaps %u samples\n",
+         (unsigned long long)s_net.commands, (unsigned long long)s_net.sendErrors,
+         SampleCollector::getGapSamples());
+  close(cmdFd);
+  close(s_sendFd);
+  return s_net.sendErrors ? 1 : 0;
+}
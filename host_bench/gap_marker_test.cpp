@@ -0,0 +1,411 @@
+/*
+  gap_marker_test – a gap from the collector through to the host export
+
+  Runs the CM7 SampleCollector and UdpManager on the Arduino shims, feeds
+  them a 10 kHz stream with 5 ms of samples missing, collects a window
+  across the gap and takes the FLAGS_COLLECTED packets through the host
+  receiver's decode paths into a CaptureStore and out with CaptureExport:
+
+    - the gap markers reach the wire with no data (NaN in every f32
+      channel), never as calibrated garbage counts
+    - SchemaDecoder (records, AVX2 and scalar columns) and the NeutrinoPacket
+      fallback all set CaptureStore::STATUS_GAP on exactly those rows
+    - the CSV export leaves their channel fields empty, the binary export
+      keeps the status bit and NaN channels, and every other row carries
+      a value in the channel's range, except the decimated temperature
+      channel, which is NaN (Sample::held) on all but one row in 100
+    - a calibrated u16 channel at U16_MISSING decodes as NaN + STATUS_GAP
+
+  Build (from the repo root):
+    g++ -std=gnu++17 -O2 -Wall -Wextra -Ihost_bench/shim -IREMC_GIGAR1_Core0 -IREMC_HostReceiver \
+        host_bench/gap_marker_test.cpp host_bench/shim/host_arduino.cpp \
+        REMC_GIGAR1_Core0/SampleCollector.cpp REMC_GIGAR1_Core0/UdpManager.cpp \
+        REMC_GIGAR1_Core0/Decimator.cpp REMC_GIGAR1_Core0/SpectrumMonitor.cpp \
+        REMC_GIGAR1_Core0/AcquisitionWatchdog.cpp REMC_GIGAR1_Core0/TraceRecorder.cpp \
+        REMC_GIGAR1_Core0/MD5.cpp REMC_HostReceiver/SchemaDecoder.cpp \
+        REMC_HostReceiver/CaptureExport.cpp REMC_HostReceiver/CaptureStore.cpp \
+        REMC_HostReceiver/BlockCodec.cpp REMC_HostReceiver/IoRing.cpp -o gap_marker_test
+*/
+
+#include "CaptureExport.h"
+#include "CaptureStore.h"
+#include "NeutrinoPacket.h"
+#include "SchemaDecoder.h"
+
+#include <Arduino.h>
+#include <EthernetUdp.h>
+#include "SharedRing.h"
+#include "SampleCollector.h"
+#include "UdpManager.h"
+#include "Decimator.h"
+#include "StateManager.h"
+#include "TimeMapper.h"
+#include "HardwareTimer.h"
+#include "AcquisitionWatchdog.h"
+#include "Config.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const uint64_t PERIOD_US = 100;
+static const uint64_t BEFORE = 3000;        // samples before the gap
+static const uint64_t MISSING = 50;         // 5 ms lost upstream
+static const uint64_t AFTER = 1000;
+static const int WINDOW = 2000;             // collected: the newest 2000 indices, gap inside
+static const uint64_t START_US = 0x100000000ull - 200000ull;   // crosses a tick rollover
+static const uint64_t UNIX_START_US = 1760000000000000ull;
+
+static int s_failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) s_failures++;
+}
+
+// ====================== Firmware seams ======================
+
+static SharedRing s_ring;
+SharedRing& g_ring = s_ring;
+
+static std::vector<Sample> s_pending;
+static size_t s_pendingPos = 0;
+
+void SharedRing_Init() { ring_init(s_ring); }
+
+size_t SharedRing_Consume(Sample* out, int32_t max_samples) {
+  size_t n = s_pending.size() - s_pendingPos;
+  if (max_samples >= 0 && (size_t)max_samples < n) n = (size_t)max_samples;
+  memcpy(out, s_pending.data() + s_pendingPos, n * sizeof(Sample));
+  s_pendingPos += n;
+  return n;
+}
+
+size_t SharedRing_Available() { return s_pending.size() - s_pendingPos; }
+
+void SharedRing_GetHealth(SharedRingHealth& out) { memset(&out, 0, sizeof(out)); }
+
+uint64_t HardwareTimer::getMicros64() { return HostClock::micros64(); }
+
+uint64_t TimeMapper::sampleToNTP(uint32_t t_us, uint32_t rollover_count) {
+  return UNIX_START_US + ((((uint64_t)rollover_count << 32) | t_us) - START_US);
+}
+
+namespace StateManager {
+void requestArm() {}
+void requestDisarm() {}
+void triggerSoftwareActuate() {}
+void manualActuatorControl(ActuatorMoveState) {}
+void manualEMEnable() {}
+void manualEMDisable() {}
+void enableManualMode() {}
+void disableManualMode() {}
+void enableHoldAfterFireMode() {}
+void disableHoldAfterFireMode() {}
+bool isHoldAfterFireModeActive() { return false; }
+bool isReady() { return true; }
+bool isEmActActive() { return false; }
+bool isManualModeActive() { return false; }
+}
+
+static std::vector<std::vector<uint8_t> > s_sent;
+
+static void onSend(uint16_t, const uint8_t* data, size_t len) {
+  s_sent.emplace_back(data, data + len);
+}
+
+// Mid-scale ramp on every channel: always a finite, in-range value
+static Sample makeSample(uint64_t index) {
+  const uint64_t t = START_US + index * PERIOD_US;
+  Sample s;
+  memset(&s, 0, sizeof(s));
+  s.t_us = (uint32_t)t;
+  s.rollover_count = (uint32_t)(t >> 32);
+  s.t_us_end = (uint32_t)(t + 9);
+  s.rollover_count_end = (uint32_t)((t + 9) >> 32);
+  for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) s.raw[ch] = (uint16_t)(1000 + (index + ch * 97) % 2000);
+  return s;
+}
+
+static void runCollector(uint64_t from, uint64_t to) {
+  for (uint64_t i = from; i < to; i += 10) {
+    s_pending.clear();
+    s_pendingPos = 0;
+    for (uint64_t k = i; k < to && k < i + 10; ++k) s_pending.push_back(makeSample(k));
+    HostClock::setMicros(START_US + (i + 10) * PERIOD_US);
+    SampleCollector::update();
+  }
+  s_pending.clear();
+  s_pendingPos = 0;
+}
+
+// ====================== Host side ======================
+
+static bool physical(size_t ch, float v) {
+  // ChannelTable range of a 12-bit count, with a little slack
+  const float lo = kAnalogChannels[ch].offset;
+  const float hi = ADC_MAX_VALUE * kAnalogChannels[ch].scale + kAnalogChannels[ch].offset;
+  return std::isfinite(v) && v >= lo - 1e-3f && v <= hi + 1e-3f;
+}
+
+static std::string readFile(const std::string& path) {
+  std::string out;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return out;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return out;
+}
+
+// A cal: u16 channel through every SchemaDecoder path
+static void checkU16Missing() {
+  const float scale = 0.5f, offset = -10.0f;
+  uint32_t s, o;
+  memcpy(&s, &scale, 4);
+  memcpy(&o, &offset, 4);
+  char cal[32];
+  snprintf(cal, sizeof(cal), "cal:%08x:%08x", s, o);
+  const std::string text = std::string("node_name T\nv a u16 u:V ") + cal + "\nv b u16 u:V " + cal +
+                           "\nv t_us u64 u:us\nv armed_status u8\nv t_us_end u64 u:us\n";
+  SchemaDecoder d;
+  if (!d.compile(text)) {
+    check(false, "u16 schema compiles");
+    return;
+  }
+  const size_t N = 17, B = d.sampleBytes();
+  std::vector<uint8_t> payload(N * B);
+  for (size_t i = 0; i < N; ++i) {
+    uint8_t* p = &payload[i * B];
+    const bool gap = i % 5 == 3;
+    const uint16_t a = gap ? SchemaDecoder::U16_MISSING : (uint16_t)(100 + i);
+    const uint16_t b = gap ? SchemaDecoder::U16_MISSING : (uint16_t)4095;
+    const uint64_t t = 1000 + i * 100, e = t + 9;
+    memcpy(p, &a, 2);
+    memcpy(p + 2, &b, 2);
+    memcpy(p + 4, &t, 8);
+    p[12] = 1;
+    memcpy(p + 13, &e, 8);
+  }
+  std::vector<CaptureStore::Record> recs(N);
+  bool ok = d.decode(payload.data(), payload.size(), recs.data(), N) == N;
+  for (size_t i = 0; i < N && ok; ++i) {
+    const bool gap = i % 5 == 3;
+    ok = gap ? (std::isnan(recs[i].ch[0]) && std::isnan(recs[i].ch[1]) && recs[i].status == (1 | CaptureStore::STATUS_GAP))
+             : (recs[i].ch[0] == (100 + i) * scale + offset && recs[i].status == 1);
+  }
+  check(ok, "u16 U16_MISSING -> NaN + STATUS_GAP (records)");
+
+  for (int scalar = 0; scalar < 2; ++scalar) {
+    std::vector<float> a(N), b(N);
+    std::vector<uint8_t> st(N);
+    BlockCodec::ColumnsOut out;
+    memset(&out, 0, sizeof(out));
+    out.ch[0] = a.data();
+    out.ch[1] = b.data();
+    out.status = st.data();
+    const size_t n = scalar ? d.decodeColumnsScalar(payload.data(), payload.size(), out)
+                            : d.decodeColumns(payload.data(), payload.size(), out);
+    bool cok = n == N;
+    for (size_t i = 0; i < N && cok; ++i) {
+      cok = st[i] == recs[i].status && (std::isnan(a[i]) ? std::isnan(recs[i].ch[0]) : a[i] == recs[i].ch[0]) &&
+            (std::isnan(b[i]) ? std::isnan(recs[i].ch[1]) : b[i] == recs[i].ch[1]);
+    }
+    check(cok, scalar ? "u16 U16_MISSING (scalar columns)"
+                      : (d.columnKernel() == SchemaDecoder::KERNEL_AVX2 ? "u16 U16_MISSING (AVX2 columns)"
+                                                                       : "u16 U16_MISSING (columns)"));
+  }
+}
+
+int main() {
+  printf("gap_marker_test: %llu samples, %llu missing, collect -%d:0\n", (unsigned long long)(BEFORE + AFTER),
+         (unsigned long long)MISSING, WINDOW);
+
+  // ---- Device: stream with a hole, then a collect across it ----
+  HostClock::setMicros(START_US);
+  HostNet::setSendHook(onSend);
+  SampleCollector::init();
+  UdpManager::init();
+  AcquisitionWatchdog::init(millis(), 0, 0);
+
+  runCollector(0, BEFORE);
+  runCollector(BEFORE + MISSING, BEFORE + MISSING + AFTER);
+  check(SampleCollector::getGapSamples() == MISSING, "collector marks exactly the missing samples");
+
+  s_sent.clear();
+  SampleCollector::startGathering(-WINDOW, 0);
+  SampleCollector::sendAllSamples();   // update() only extracts when new frames arrive
+
+  // ---- Host: schema, then every decode path ----
+  SchemaCache cache;
+  std::shared_ptr<const SchemaDecoder> decoder;
+  std::vector<std::vector<uint8_t> > payloads;
+  for (const std::vector<uint8_t>& pkt : s_sent) {
+    Neutrino::Header h;
+    if (!Neutrino::parseHeader(pkt.data(), pkt.size(), h)) continue;
+    cache.add(h, decoder);
+    if (h.flags == Neutrino::FLAGS_COLLECTED) {
+      payloads.emplace_back(pkt.begin() + Neutrino::HEADER_BYTES, pkt.end());
+    }
+  }
+  for (size_t pass = 0; pass < 4 && !decoder; ++pass) {
+    for (const std::vector<uint8_t>& pkt : s_sent) {
+      Neutrino::Header h;
+      if (Neutrino::parseHeader(pkt.data(), pkt.size(), h)) cache.add(h, decoder);
+    }
+  }
+  check(decoder != nullptr, "schema assembled from the collect dump");
+  if (!decoder) return 1;
+
+  const char* dirTemplate = "/tmp/gap_marker_test.XXXXXX";
+  char dir[64];
+  snprintf(dir, sizeof(dir), "%s", dirTemplate);
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  const std::string storeDir = std::string(dir) + "/store";
+  std::vector<std::string> names;
+  for (size_t c = 0; c < ANALOG_CHANNEL_COUNT; ++c) names.push_back(kAnalogChannels[c].name);
+  CaptureStore::Writer w;
+  if (!w.create(storeDir, names, CaptureStore::STORE_COMPRESSED)) {
+    fprintf(stderr, "create: %s\n", w.error().c_str());
+    return 1;
+  }
+
+  std::vector<CaptureStore::Record> all;
+  bool pathsAgree = true;
+  for (const std::vector<uint8_t>& pl : payloads) {
+    const size_t n = pl.size() / decoder->sampleBytes();
+    std::vector<CaptureStore::Record> recs(n), fallback(n);
+    pathsAgree &= decoder->decode(pl.data(), pl.size(), recs.data(), n) == n;
+    std::vector<uint8_t> pkt(Neutrino::HEADER_BYTES, 0);
+    pkt.insert(pkt.end(), pl.begin(), pl.end());
+    pathsAgree &= Neutrino::decodeSamples(pkt.data(), pkt.size(), fallback.data(), n) == n;
+
+    // Store columns straight from the payload, as StoreWriter does
+    BlockCodec::ColumnsOut out;
+    if (!w.reserve(n, out) || decoder->decodeColumns(pl.data(), pl.size(), out) != n) {
+      fprintf(stderr, "store: %s\n", w.error().c_str());
+      return 1;
+    }
+    std::vector<uint8_t> scalarStatus(n);
+    BlockCodec::ColumnsOut so;
+    memset(&so, 0, sizeof(so));
+    std::vector<std::vector<float> > sch(ANALOG_CHANNEL_COUNT, std::vector<float>(n));
+    for (size_t c = 0; c < ANALOG_CHANNEL_COUNT; ++c) so.ch[c] = sch[c].data();
+    so.status = scalarStatus.data();
+    decoder->decodeColumnsScalar(pl.data(), pl.size(), so);
+    for (size_t i = 0; i < n; ++i) {
+      pathsAgree &= fallback[i].status == recs[i].status && out.status[i] == recs[i].status &&
+                    scalarStatus[i] == recs[i].status;
+    }
+    w.commit(n);
+    all.insert(all.end(), recs.begin(), recs.end());
+  }
+  w.close();
+  check(pathsAgree, "records, fallback, AVX2 and scalar columns agree on status");
+
+  const uint32_t decimation = Decimator::getTotalFactor(CH_TEMP_1);
+  size_t gaps = 0, firstGap = all.size(), badValues = 0, nanData = 0, decimated = 0;
+  for (size_t i = 0; i < all.size(); ++i) {
+    const bool gap = (all[i].status & CaptureStore::STATUS_GAP) != 0;
+    if (gap) {
+      if (firstGap == all.size()) firstGap = i;
+      gaps++;
+      for (size_t c = 0; c < ANALOG_CHANNEL_COUNT; ++c) nanData += std::isnan(all[i].ch[c]) ? 0 : 1;
+    } else {
+      for (size_t c = 0; c < ANALOG_CHANNEL_COUNT; ++c) {
+        if (c == CH_TEMP_1 && std::isnan(all[i].ch[c])) continue;
+        badValues += physical(c, all[i].ch[c]) ? 0 : 1;
+        decimated += c == CH_TEMP_1;
+      }
+    }
+  }
+  printf("  decoded %zu rows, %zu flagged as gap from row %zu\n", all.size(), gaps, firstGap);
+  check(all.size() == (size_t)WINDOW, "every collected index arrives");
+  check(gaps == MISSING, "STATUS_GAP on exactly the missing samples");
+  bool contiguous = firstGap + gaps <= all.size();
+  for (size_t i = 0; contiguous && i < gaps; ++i) {
+    contiguous = (all[firstGap + i].status & CaptureStore::STATUS_GAP) &&
+                 all[firstGap + i].tUs == all[firstGap - 1].tUs + (i + 1) * PERIOD_US;
+  }
+  check(contiguous, "gap rows are contiguous and keep their slot times");
+  check(nanData == 0, "gap rows carry no values (NaN)");
+  check(badValues == 0, "every other row is a value in the channel's range");
+  printf("  temperature (decimated by %u) on %zu of %zu data rows\n", decimation, decimated, all.size() - gaps);
+  const size_t outputs = (all.size() - gaps) / decimation;
+  check(decimation > 1 && (decimated == outputs || decimated == outputs + 1),
+        "decimated channel: one value per output, NaN between");
+
+  // ---- Export ----
+  CaptureStore::Reader r;
+  if (!r.open(storeDir)) {
+    fprintf(stderr, "open: %s\n", r.error().c_str());
+    return 1;
+  }
+  const std::string csvPath = std::string(dir) + "/rows.csv", binPath = std::string(dir) + "/rows.bin";
+  for (int b = 0; b < 2; ++b) {
+    const int fd = open(b ? binPath.c_str() : csvPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CaptureExport::Exporter e(r);
+    if (fd < 0 || !e.write(fd, b ? CaptureExport::Format::BINARY : CaptureExport::Format::CSV, 0, r.size())) {
+      fprintf(stderr, "export: %s\n", e.error().c_str());
+      return 1;
+    }
+    close(fd);
+  }
+
+  const std::string csv = readFile(csvPath);
+  size_t lines = 0, emptyRows = 0, nanText = 0;
+  for (size_t at = 0; at < csv.size();) {
+    size_t end = csv.find("\r\n", at);
+    if (end == std::string::npos) end = csv.size();
+    const std::string line = csv.substr(at, end - at);
+    if (lines++ > 0) {
+      const std::string tail = std::string(ANALOG_CHANNEL_COUNT, ',');
+      if (line.size() > tail.size() && line.compare(line.size() - tail.size(), tail.size(), tail) == 0) emptyRows++;
+      if (line.find("nan") != std::string::npos) nanText++;
+    }
+    at = end + 2;
+  }
+  printf("  csv: %zu rows, %zu with empty channels\n", lines - 1, emptyRows);
+  check(lines - 1 == (size_t)WINDOW && emptyRows == MISSING && nanText == 0, "CSV: gap rows have empty channel fields");
+
+  const std::string bin = readFile(binPath);
+  CaptureExport::BinaryHeader bh;
+  bool binOk = bin.size() >= sizeof(bh);
+  size_t binGaps = 0;
+  if (binOk) {
+    memcpy(&bh, bin.data(), sizeof(bh));
+    binOk = bh.rows == (uint64_t)WINDOW && bin.size() == sizeof(bh) + bh.rows * bh.rowBytes;
+    for (uint64_t i = 0; binOk && i < bh.rows; ++i) {
+      const char* row = bin.data() + sizeof(bh) + i * bh.rowBytes;
+      const uint8_t status = (uint8_t)row[16 + 4 * bh.channelCount];
+      float v0;
+      memcpy(&v0, row + 16, 4);
+      if (status & CaptureStore::STATUS_GAP) {
+        binGaps++;
+        binOk = std::isnan(v0);
+      } else {
+        binOk = physical(0, v0);
+      }
+    }
+  }
+  check(binOk && binGaps == MISSING, "binary: gap rows keep STATUS_GAP and NaN channels");
+
+  checkU16Missing();
+
+  const std::string cleanup = std::string("rm -rf ") + dir;
+  if (system(cleanup.c_str()) != 0) fprintf(stderr, "could not remove %s\n", dir);
+
+  printf("%s\n", s_failures ? "FAILED" : "all checks passed");
+  return s_failures ? 1 : 0;
+}
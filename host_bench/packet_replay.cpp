@@ -0,0 +1,405 @@
+/*
+  packet_replay – put recorded telemetry back on the wire, paced
+
+  Reads the UDP datagrams of a real run – a pcap (tcpdump/Wireshark; classic
+  format, Ethernet, Linux cooked or raw IP) or a packet file from
+  `trace_capture --all` (trace_file.h) – and multicasts them again, by
+  default to 239.9.9.33:13013 with multicast loopback on, so a receiver on
+  this host sees the original traffic shape: the steady live stream, and the bursts of a
+  collect dump (extractRequestedSamples flushes every 46 samples, i.e. a
+  33- and a 13-sample datagram back to back, thousands in a row).
+
+  Packet i is due at start + (t_i - t_0) / speed. The wait is a hybrid:
+  clock_nanosleep(TIMER_ABSTIME) until --spin µs before the deadline, then a
+  busy loop on CLOCK_MONOTONIC – the sleep alone overshoots by the timer
+  slack and scheduler latency (50–100 µs), the busy loop alone burns a
+  core for the whole replay. Everything already due goes out in one
+  sendmmsg(), so a burst stays a burst. --max drops the pacing entirely.
+
+  Rewritten on the way out:
+    destination              --dest IP[:PORT]; --iface picks the interface
+                             (127.0.0.1 keeps it on lo; the receiver then
+                             needs --iface 127.0.0.1 too)
+    header timestampNs       the actual send time (CLOCK_REALTIME)
+    sample t_us / t_us_end   shifted by one constant so the first packet
+                             lands at the start of the replay and each
+                             --loop pass follows the previous one (a live
+                             store only appends forward in time); above 1x
+                             the sample times run ahead of the wall clock.
+                             --keep-times leaves payloads untouched
+
+  Usage:
+    packet_replay <capture.pcap|capture.pkt> [--speed X | --max] [--loop N]
+                  [--dest IP[:PORT]] [--iface IP] [--port P] [--spin US]
+                  [--keep-times]
+        --speed 1   original timing (default), N = N times faster
+        --port P    pcap: only UDP datagrams to port P (default 13013)
+
+  Reports packets and samples by header flag, the intended and achieved
+  packet rate and throughput, and the pacing error (send time minus due
+  time) as mean/p50/p99/max, with the number of packets more than 1 ms late.
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra host_bench/packet_replay.cpp -o packet_replay
+*/
+
+#include "trace_file.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint16_t TELEMETRY_PORT = 13013;
+static const size_t WIRE_SAMPLE_BYTES = 42;       // 5 x f32, u64 t_us, 6 status, u64 t_us_end
+static const size_t SAMPLE_T_US_OFFSET = 20;
+static const size_t SAMPLE_T_END_OFFSET = 34;
+static const size_t BATCH = 64;                   // datagrams per sendmmsg()
+static const int64_t LATE_NS = 1000000;
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int) { s_stop = 1; }
+
+struct Packet {
+  uint64_t tNs;              // capture time
+  std::vector<uint8_t> data; // whole datagram
+};
+
+static uint64_t clockNs(clockid_t id) {
+  timespec ts;
+  clock_gettime(id, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint16_t be16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+static uint32_t rd32(const uint8_t* p, bool swap) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return swap ? __builtin_bswap32(v) : v;
+}
+
+// ====================== Input ======================
+
+static bool loadPacketFile(FILE* f, std::vector<Packet>& out) {
+  Packet p;
+  while (traceReadPacket(f, p.data, p.tNs)) {
+    if (p.data.size() >= NEUTRINO_HEADER_BYTES) out.push_back(p);
+  }
+  return true;
+}
+
+// Classic pcap: 24-byte file header, 16-byte record headers
+static bool loadPcap(FILE* f, uint16_t port, std::vector<Packet>& out, uint64_t& skipped) {
+  uint8_t fh[24];
+  if (fread(fh, 1, sizeof(fh), f) != sizeof(fh)) return false;
+  const uint32_t magic = rd32(fh, false);
+  bool swap, nanos;
+  if (magic == 0xA1B2C3D4u || magic == 0xA1B23C4Du) swap = false;
+  else if (magic == 0xD4C3B2A1u || magic == 0x4D3CB2A1u) swap = true;
+  else return false;
+  nanos = magic == 0xA1B23C4Du || magic == 0x4D3CB2A1u;
+  const uint32_t linkType = rd32(fh + 20, swap) & 0xFFFF;
+
+  std::vector<uint8_t> rec;
+  uint8_t rh[16];
+  while (fread(rh, 1, sizeof(rh), f) == sizeof(rh)) {
+    const uint64_t sec = rd32(rh, swap);
+    const uint64_t frac = rd32(rh + 4, swap);
+    const uint32_t capLen = rd32(rh + 8, swap);
+    if (capLen > 262144) return false;
+    rec.resize(capLen);
+    if (fread(rec.data(), 1, capLen, f) != capLen) break;
+
+    // Link layer → IPv4
+    size_t off;
+    uint16_t etherType = 0x0800;
+    switch (linkType) {
+    case 1:      // Ethernet, optionally 802.1Q tagged
+      if (capLen < 14) { skipped++; continue; }
+      etherType = be16(&rec[12]);
+      off = 14;
+      if (etherType == 0x8100 && capLen >= 18) { etherType = be16(&rec[16]); off = 18; }
+      break;
+    case 113:    // Linux cooked (SLL)
+      if (capLen < 16) { skipped++; continue; }
+      etherType = be16(&rec[14]);
+      off = 16;
+      break;
+    case 276:    // Linux cooked v2 (SLL2)
+      if (capLen < 20) { skipped++; continue; }
+      etherType = be16(&rec[0]);
+      off = 20;
+      break;
+    case 101:    // raw IP
+    case 228:
+      off = 0;
+      break;
+    default:
+      fprintf(stderr, "pcap link type %u not supported\n", linkType);
+      return false;
+    }
+    if (etherType != 0x0800 || capLen < off + 20 || (rec[off] >> 4) != 4) { skipped++; continue; }
+    const size_t ihl = (rec[off] & 0x0F) * 4u;
+    const bool fragment = (be16(&rec[off + 6]) & 0x3FFF) != 0;
+    if (rec[off + 9] != IPPROTO_UDP || fragment || capLen < off + ihl + 8) { skipped++; continue; }
+    const uint8_t* udp = &rec[off + ihl];
+    const size_t udpLen = be16(udp + 4);
+    if (be16(udp + 2) != port || udpLen < 8 + NEUTRINO_HEADER_BYTES || off + ihl + udpLen > capLen) {
+      skipped++;
+      continue;
+    }
+    Packet p;
+    p.tNs = sec * 1000000000ull + (nanos ? frac : frac * 1000u);
+    p.data.assign(udp + 8, udp + udpLen);
+    out.push_back(std::move(p));
+  }
+  return true;
+}
+
+// ====================== Rewriting ======================
+
+static void putBe64(uint8_t* p, uint64_t v) {
+  for (int i = 7; i >= 0; --i, v >>= 8) p[i] = (uint8_t)v;
+}
+
+static void shiftSampleTimes(std::vector<uint8_t>& d, int64_t deltaUs) {
+  const size_t n = (d.size() - NEUTRINO_HEADER_BYTES) / WIRE_SAMPLE_BYTES;
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t* s = &d[NEUTRINO_HEADER_BYTES + i * WIRE_SAMPLE_BYTES];
+    const size_t offsets[2] = { SAMPLE_T_US_OFFSET, SAMPLE_T_END_OFFSET };
+    for (size_t o : offsets) {
+      uint64_t t;
+      memcpy(&t, s + o, 8);
+      t += (uint64_t)deltaUs;
+      memcpy(s + o, &t, 8);
+    }
+  }
+}
+
+// Earliest and latest sample t_us in the capture; false if it has none
+static bool sampleRange(const std::vector<Packet>& packets, uint64_t& firstUs, uint64_t& lastUs) {
+  firstUs = UINT64_MAX;
+  lastUs = 0;
+  for (const Packet& p : packets) {
+    if (neutrinoFlags(p.data.data()) > 1) continue;
+    const size_t n = (p.data.size() - NEUTRINO_HEADER_BYTES) / WIRE_SAMPLE_BYTES;
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t t;
+      memcpy(&t, &p.data[NEUTRINO_HEADER_BYTES + i * WIRE_SAMPLE_BYTES + SAMPLE_T_US_OFFSET], 8);
+      firstUs = std::min(firstUs, t);
+      lastUs = std::max(lastUs, t);
+    }
+  }
+  return lastUs >= firstUs;
+}
+
+// ====================== Replay ======================
+
+static void waitUntil(uint64_t dueNs, uint64_t spinNs) {
+  if (dueNs > spinNs) {
+    const uint64_t sleepTo = dueNs - spinNs;
+    if (clockNs(CLOCK_MONOTONIC) < sleepTo) {
+      timespec ts = { (time_t)(sleepTo / 1000000000ull), (long)(sleepTo % 1000000000ull) };
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR && !s_stop) {}
+    }
+  }
+  while (clockNs(CLOCK_MONOTONIC) < dueNs) {
+    // spin the last stretch
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <capture.pcap|capture.pkt> [--speed X | --max] [--loop N]\n"
+                    "          [--dest IP[:PORT]] [--iface IP] [--port P] [--spin US] [--keep-times]\n", argv[0]);
+    return 2;
+  }
+  const char* path = argv[1];
+  double speed = 1.0;
+  bool unpaced = false;
+  unsigned loops = 1;
+  const char* dest = "239.9.9.33";
+  const char* iface = nullptr;
+  uint16_t port = TELEMETRY_PORT;
+  double spinUs = 200.0;
+  bool keepTimes = false;
+  for (int i = 2; i < argc; ++i) {
+    const bool hasArg = i + 1 < argc;
+    if (!strcmp(argv[i], "--speed") && hasArg) speed = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--max")) unpaced = true;
+    else if (!strcmp(argv[i], "--loop") && hasArg) loops = (unsigned)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--dest") && hasArg) dest = argv[++i];
+    else if (!strcmp(argv[i], "--iface") && hasArg) iface = argv[++i];
+    else if (!strcmp(argv[i], "--port") && hasArg) port = (uint16_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--spin") && hasArg) spinUs = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--keep-times")) keepTimes = true;
+    else { fprintf(stderr, "unknown option %s\n", argv[i]); return 2; }
+  }
+  if (speed <= 0 || loops == 0) { fprintf(stderr, "--speed and --loop must be positive\n"); return 2; }
+
+  // ---- load ----
+  FILE* f = fopen(path, "rb");
+  if (!f) { perror(path); return 1; }
+  std::vector<Packet> packets;
+  uint64_t skipped = 0;
+  bool ok;
+  if (packetReadHeader(f)) {
+    ok = loadPacketFile(f, packets);
+  } else {
+    rewind(f);
+    ok = loadPcap(f, port, packets, skipped);
+  }
+  fclose(f);
+  if (!ok) { fprintf(stderr, "%s: not a pcap or packet file\n", path); return 1; }
+  if (packets.empty()) { fprintf(stderr, "%s: no telemetry datagrams\n", path); return 1; }
+  std::stable_sort(packets.begin(), packets.end(),
+                   [](const Packet& a, const Packet& b) { return a.tNs < b.tNs; });
+
+  // ---- socket ----
+  std::string host(dest);
+  uint16_t destPort = TELEMETRY_PORT;
+  const size_t colon = host.find(':');
+  if (colon != std::string::npos) {
+    destPort = (uint16_t)atoi(host.c_str() + colon + 1);
+    host.resize(colon);
+  }
+  sockaddr_in dst;
+  memset(&dst, 0, sizeof(dst));
+  dst.sin_family = AF_INET;
+  dst.sin_port = htons(destPort);
+  if (inet_pton(AF_INET, host.c_str(), &dst.sin_addr) != 1) { fprintf(stderr, "bad --dest %s\n", dest); return 2; }
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd < 0) { perror("socket"); return 1; }
+  in_addr ifAddr;
+  ifAddr.s_addr = iface ? inet_addr(iface) : htonl(INADDR_ANY);
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &ifAddr, sizeof(ifAddr));
+  unsigned char ttl = 1, loop = 1;
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  int sndbuf = 4 * 1024 * 1024;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+  const uint64_t spanNs = packets.back().tNs - packets.front().tNs;
+  uint64_t totalBytes = 0;
+  for (const Packet& p : packets) totalBytes += p.data.size();
+  char pace[32];
+  if (unpaced) snprintf(pace, sizeof(pace), "max rate");
+  else snprintf(pace, sizeof(pace), "%gx", speed);
+  printf("packet_replay: %s, %zu datagrams over %.3f s (%llu skipped) -> %s:%u, %s, %u pass%s\n",
+         path, packets.size(), spanNs * 1e-9, (unsigned long long)skipped, host.c_str(), destPort, pace,
+         loops, loops == 1 ? "" : "es");
+  fflush(stdout);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  // ---- replay ----
+  const uint64_t spinNs = (uint64_t)(spinUs * 1000.0);
+  const uint64_t loopNs = (uint64_t)((spanNs + 1000000ull) / speed);   // 1 ms between passes
+  uint64_t firstUs = 0, lastUs = 0;
+  const bool haveSamples = sampleRange(packets, firstUs, lastUs);
+  std::vector<int64_t> errors;
+  errors.reserve(packets.size() * loops);
+  uint64_t sent = 0, sentBytes = 0, sendErrors = 0, byFlag[32] = {0}, samples = 0;
+
+  std::vector<std::vector<uint8_t>> bufs(BATCH);
+  std::vector<mmsghdr> msgs(BATCH);
+  std::vector<iovec> iov(BATCH);
+
+  const uint64_t startNs = clockNs(CLOCK_MONOTONIC);
+  const uint64_t startRealNs = clockNs(CLOCK_REALTIME);
+  for (unsigned pass = 0; pass < loops && !s_stop; ++pass) {
+    const uint64_t passNs = startNs + pass * loopNs;
+    // Each pass continues where the previous one's samples ended, at any speed
+    const uint64_t passUs = pass * (lastUs - firstUs + 1000u);
+    const int64_t deltaUs = haveSamples ? (int64_t)(startRealNs / 1000u + passUs) - (int64_t)firstUs : 0;
+
+    size_t i = 0;
+    while (i < packets.size() && !s_stop) {
+      const uint64_t dueNs = passNs + (uint64_t)((packets[i].tNs - packets.front().tNs) / speed);
+      if (!unpaced) waitUntil(dueNs, spinNs);
+      const uint64_t nowNs = clockNs(CLOCK_MONOTONIC);
+      const uint64_t nowRealNs = clockNs(CLOCK_REALTIME);
+
+      // Everything due by now goes out together
+      size_t n = 0;
+      for (; n < BATCH && i + n < packets.size(); ++n) {
+        const Packet& p = packets[i + n];
+        const uint64_t due = passNs + (uint64_t)((p.tNs - packets.front().tNs) / speed);
+        if (n > 0 && !unpaced && due > nowNs) break;
+        std::vector<uint8_t>& b = bufs[n];
+        b = p.data;
+        const uint32_t flags = neutrinoFlags(b.data());
+        if (!keepTimes) {
+          putBe64(&b[56], nowRealNs);
+          if (flags <= 1) shiftSampleTimes(b, deltaUs);
+        }
+        if (!unpaced) errors.push_back((int64_t)(nowNs - due));
+        byFlag[flags < 32 ? flags : 31]++;
+        if (flags <= 1) samples += (b.size() - NEUTRINO_HEADER_BYTES) / WIRE_SAMPLE_BYTES;
+        iov[n].iov_base = b.data();
+        iov[n].iov_len = b.size();
+        memset(&msgs[n], 0, sizeof(mmsghdr));
+        msgs[n].msg_hdr.msg_name = &dst;
+        msgs[n].msg_hdr.msg_namelen = sizeof(dst);
+        msgs[n].msg_hdr.msg_iov = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+      }
+      size_t done = 0;
+      while (done < n) {
+        const int r = sendmmsg(fd, &msgs[done], (unsigned)(n - done), 0);
+        if (r <= 0) {
+          if (r < 0 && errno == EINTR) continue;
+          sendErrors += n - done;
+          break;
+        }
+        for (int k = 0; k < r; ++k) sentBytes += iov[done + k].iov_len;
+        done += (size_t)r;
+        sent += (size_t)r;
+      }
+      i += n;
+    }
+  }
+  const double wallS = (clockNs(CLOCK_MONOTONIC) - startNs) * 1e-9;
+  close(fd);
+
+  // ---- report ----
+  const double intendedS = unpaced ? 0.0 : (double)(loops - 1) * loopNs * 1e-9 + spanNs / speed * 1e-9;
+  uint64_t other = 0;
+  for (size_t k = 3; k < 32; ++k) other += byFlag[k];
+  printf("  sent        %llu datagrams (%llu live, %llu collected, %llu batch ends, %llu other), "
+         "%llu samples, %.1f MB\n",
+         (unsigned long long)sent, (unsigned long long)byFlag[0], (unsigned long long)byFlag[1],
+         (unsigned long long)byFlag[2], (unsigned long long)other,
+         (unsigned long long)samples, sentBytes / 1e6);
+  if (intendedS > 0) {
+    printf("  rate        %.0f pkt/s achieved vs %.0f intended, %.1f Mbit/s, %.3f s wall vs %.3f s\n",
+           sent / wallS, (double)packets.size() * loops / intendedS, sentBytes * 8e-6 / wallS, wallS, intendedS);
+  } else {
+    printf("  rate        %.0f pkt/s, %.1f Mbit/s, %.3f s wall\n", sent / wallS, sentBytes * 8e-6 / wallS, wallS);
+  }
+  if (!errors.empty()) {
+    std::vector<int64_t> sorted(errors);
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for (int64_t e : sorted) mean += e;
+    mean /= sorted.size();
+    const size_t late = sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), LATE_NS);
+    printf("  pacing      error mean %.1f µs  p50 %.1f µs  p99 %.1f µs  max %.1f µs, %zu late > 1 ms (spin %.0f µs)\n",
+           mean / 1000.0, sorted[sorted.size() / 2] / 1000.0, sorted[(size_t)(sorted.size() * 0.99)] / 1000.0,
+           sorted.back() / 1000.0, late, spinUs);
+  }
+  if (sendErrors) printf("  send errors %llu\n", (unsigned long long)sendErrors);
+  return sendErrors ? 1 : 0;
+}
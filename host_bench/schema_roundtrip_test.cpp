@@ -0,0 +1,301 @@
+/*
+  schema_roundtrip_test – ChannelTable packing against the schema it describes
+
+  Runs the CM7 UdpManager on the Arduino shims, sends Samples with known
+  raw counts, timestamps and status bits, and decodes the datagrams with
+  the host receiver's SchemaDecoder compiled from the schema text that
+  buildSchema() put in the packet headers:
+
+    - the schema lists every field in wire order with the ChannelTable
+      name, type, unit and cal: of each channel, then t_us, the status
+      bytes and t_us_end; each field's offset is the sum of the wire sizes
+      before it and the sample size is the datagram's
+    - every field's bytes in the payload are what ChannelTable packs for
+      that Sample, and records, AVX2 and scalar columns decode the same
+      values: the channel's physical value (f32, or u16 counts with cal:),
+      the NTP start/end times and the status bits
+    - a gap marker (SAMPLE_FLAG_GAP) decodes as NaN + STATUS_GAP
+    - a channel held by the Decimator (Sample::held) decodes as NaN in
+      that channel only, without STATUS_GAP
+
+  Build (from the repo root):
+    g++ -std=gnu++17 -O2 -Wall -Wextra -Ihost_bench/shim -IREMC_GIGAR1_Core0 -IREMC_HostReceiver \
+        host_bench/schema_roundtrip_test.cpp host_bench/shim/host_arduino.cpp \
+        REMC_GIGAR1_Core0/SampleCollector.cpp REMC_GIGAR1_Core0/UdpManager.cpp \
+        REMC_GIGAR1_Core0/Decimator.cpp REMC_GIGAR1_Core0/SpectrumMonitor.cpp \
+        REMC_GIGAR1_Core0/AcquisitionWatchdog.cpp REMC_GIGAR1_Core0/TraceRecorder.cpp \
+        REMC_GIGAR1_Core0/MD5.cpp REMC_HostReceiver/SchemaDecoder.cpp \
+        REMC_HostReceiver/CaptureStore.cpp REMC_HostReceiver/BlockCodec.cpp \
+        REMC_HostReceiver/IoRing.cpp -o schema_roundtrip_test
+*/
+
+#include "CaptureStore.h"
+#include "NeutrinoPacket.h"
+#include "SchemaDecoder.h"
+
+#include <Arduino.h>
+#include <EthernetUdp.h>
+#include "SharedRing.h"
+#include "UdpManager.h"
+#include "StateManager.h"
+#include "TimeMapper.h"
+#include "HardwareTimer.h"
+#include "Config.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const uint64_t PERIOD_US = 100;
+static const uint64_t START_US = 0x100000000ull - 2000ull;   // crosses a tick rollover
+static const uint64_t UNIX_START_US = 1760000000000000ull;
+static const size_t PACKETS = 80;                             // enough headers for every schema fragment
+
+// STATUS_NAMES order in UdpManager.cpp
+static const char* const STATUS_FIELDS[] = {
+  "armed_status", "em_status", "msw_a_status",
+  "msw_b_status", "manual_mode_status", "hold_mode_status"
+};
+static const size_t NUM_STATUS = sizeof(STATUS_FIELDS) / sizeof(STATUS_FIELDS[0]);
+
+static int s_failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) s_failures++;
+}
+
+// ====================== Firmware seams ======================
+
+static SharedRing s_ring;
+SharedRing& g_ring = s_ring;
+
+void SharedRing_Init() { ring_init(s_ring); }
+size_t SharedRing_Consume(Sample*, int32_t) { return 0; }
+size_t SharedRing_Available() { return 0; }
+void SharedRing_GetHealth(SharedRingHealth& out) { memset(&out, 0, sizeof(out)); }
+
+uint64_t HardwareTimer::getMicros64() { return HostClock::micros64(); }
+
+uint64_t TimeMapper::sampleToNTP(uint32_t t_us, uint32_t rollover_count) {
+  return UNIX_START_US + ((((uint64_t)rollover_count << 32) | t_us) - START_US);
+}
+
+// Status bytes 0, 1, 4 and 5 follow s_state; the shim's digitalRead()
+// returns HIGH, so the two MSW bytes are always 1
+static uint8_t s_state = 0;
+
+namespace StateManager {
+void requestArm() {}
+void requestDisarm() {}
+void triggerSoftwareActuate() {}
+void manualActuatorControl(ActuatorMoveState) {}
+void manualEMEnable() {}
+void manualEMDisable() {}
+void enableManualMode() {}
+void disableManualMode() {}
+void enableHoldAfterFireMode() {}
+void disableHoldAfterFireMode() {}
+bool isHoldAfterFireModeActive() { return s_state & 0x20; }
+bool isReady() { return s_state & 0x01; }
+bool isEmActActive() { return s_state & 0x02; }
+bool isManualModeActive() { return s_state & 0x10; }
+}
+
+static std::vector<std::vector<uint8_t> > s_sent;
+
+static void onSend(uint16_t, const uint8_t* data, size_t len) {
+  s_sent.emplace_back(data, data + len);
+}
+
+// ====================== Test data ======================
+
+struct Sent {
+  Sample s;
+  uint8_t status;      // Record::status the host should see
+};
+
+static Sample makeSample(uint64_t index) {
+  const uint64_t t = START_US + index * PERIOD_US;
+  Sample s;
+  memset(&s, 0, sizeof(s));
+  s.t_us = (uint32_t)t;
+  s.rollover_count = (uint32_t)(t >> 32);
+  s.t_us_end = (uint32_t)(t + 9);
+  s.rollover_count_end = (uint32_t)((t + 9) >> 32);
+  // Both ends of the ADC range and a distinct count per channel in between
+  for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+    const uint16_t top = (uint16_t)((1u << kAnalogChannels[ch].bits) - 1);
+    s.raw[ch] = index % 7 == 0 ? 0 : index % 7 == 1 ? top : (uint16_t)((index * 131 + ch * 577) % (top + 1u));
+  }
+  return s;
+}
+
+static std::string fieldLine(const SchemaDecoder::Field& f) {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%s @%u", f.name.c_str(), (unsigned)f.offset);
+  return buf;
+}
+
+int main() {
+  printf("schema_roundtrip_test: %zu packets, %zu analog channels\n", PACKETS, (size_t)ANALOG_CHANNEL_COUNT);
+
+  // ---- Device: one packet per UdpManager flush ----
+  HostClock::setMicros(START_US);
+  HostNet::setSendHook(onSend);
+  UdpManager::init();
+  s_sent.clear();
+
+  std::vector<Sent> sent;
+  uint64_t index = 0;
+  for (size_t p = 0; p < PACKETS; ++p) {
+    const size_t n = 1 + p % 3;
+    for (size_t k = 0; k < n; ++k, ++index) {
+      Sent e;
+      e.s = makeSample(index);
+      if (index == 17) e.s.flags = SAMPLE_FLAG_GAP;
+      if (index % 5 == 2) e.s.held = (uint8_t)(1u << CH_TEMP_1);
+      if (index == 23) e.s.held = (uint8_t)((1u << ANALOG_CHANNEL_COUNT) - 2);
+      s_state = (uint8_t)(index * 7);
+      UdpManager::addSample(e.s);
+      e.status = (uint8_t)((s_state & 0x01) | (s_state & 0x02) | 0x04 | 0x08 | (s_state & 0x10) | (s_state & 0x20));
+      if (e.s.flags & SAMPLE_FLAG_GAP) e.status |= CaptureStore::STATUS_GAP;
+      sent.push_back(e);
+    }
+    UdpManager::flushSamples();
+  }
+
+  // ---- Host: schema from the headers ----
+  SchemaCache cache;
+  std::shared_ptr<const SchemaDecoder> decoder;
+  std::vector<std::vector<uint8_t> > payloads;
+  for (const std::vector<uint8_t>& pkt : s_sent) {
+    Neutrino::Header h;
+    if (!Neutrino::parseHeader(pkt.data(), pkt.size(), h)) continue;
+    cache.add(h, decoder);
+    if (h.flags == 0) payloads.emplace_back(pkt.begin() + Neutrino::HEADER_BYTES, pkt.end());
+  }
+  check(payloads.size() == PACKETS, "one sample datagram per flush");
+  check(decoder != nullptr, "schema assembled from the packet headers");
+  if (!decoder) return 1;
+  const SchemaDecoder& d = *decoder;
+
+  printf("layout\n");
+  check(d.nodeName() == REMC_NODE_NAME && d.periodUs() == PERIOD_US, "node_name and telem_period");
+  check(!d.implicitTimes() && d.hasEnd(), "t_us and t_us_end listed, not assumed");
+  check(d.channels() == ANALOG_CHANNEL_COUNT && d.statusCount() == NUM_STATUS, "channel and status counts");
+
+  const std::vector<SchemaDecoder::Field>& fields = d.fields();
+  bool countOk = fields.size() == ANALOG_CHANNEL_COUNT + 2 + NUM_STATUS;
+  check(countOk, "one field per channel, timestamp and status byte");
+  if (!countOk) return 1;
+
+  size_t offset = 0, fi = 0;
+  for (size_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch, ++fi) {
+    const ChannelDef& c = kAnalogChannels[ch];
+    const SchemaDecoder::Field& f = fields[fi];
+    const bool u16 = c.wire == WireType::U16;
+    bool ok = f.name == c.name && f.unit == c.unit && f.role == SchemaDecoder::ROLE_CHANNEL && f.index == ch &&
+              f.offset == offset && f.type == (u16 ? SchemaDecoder::T_U16 : SchemaDecoder::T_F32) &&
+              f.calibrated == u16;
+    if (u16) ok &= f.scale == c.scale && f.calOffset == c.offset;
+    check(ok, (fieldLine(f) + (u16 ? " u16 cal:" : " f32")).c_str());
+    offset += ChannelTable::wireSize(c.wire);
+  }
+  {
+    const SchemaDecoder::Field& f = fields[fi++];
+    check(f.name == "t_us" && f.role == SchemaDecoder::ROLE_T_US && f.type == SchemaDecoder::T_U64 &&
+          f.offset == offset && f.unit == "us", (fieldLine(f) + " u64").c_str());
+    offset += 8;
+  }
+  for (size_t s = 0; s < NUM_STATUS; ++s, ++fi) {
+    const SchemaDecoder::Field& f = fields[fi];
+    check(f.name == STATUS_FIELDS[s] && f.role == SchemaDecoder::ROLE_STATUS && f.type == SchemaDecoder::T_U8 &&
+          f.index == s && f.offset == offset, (fieldLine(f) + " u8").c_str());
+    offset += 1;
+  }
+  {
+    const SchemaDecoder::Field& f = fields[fi++];
+    check(f.name == "t_us_end" && f.role == SchemaDecoder::ROLE_T_US_END && f.type == SchemaDecoder::T_U64 &&
+          f.offset == offset && f.unit == "us", (fieldLine(f) + " u64").c_str());
+    offset += 8;
+  }
+  check(d.sampleBytes() == offset && offset == ChannelTable::analogWireBytes() + 8 + NUM_STATUS + 8,
+        "sample size is the sum of the fields");
+
+  printf("values\n");
+  size_t rows = 0, badBytes = 0, badRecords = 0, badColumns = 0;
+  for (const std::vector<uint8_t>& pl : payloads) {
+    const size_t n = pl.size() / d.sampleBytes();
+    if (n * d.sampleBytes() != pl.size() || rows + n > sent.size()) {
+      badBytes++;
+      break;
+    }
+
+    // Bytes at each field's offset: what ChannelTable packs for the Sample
+    for (size_t i = 0; i < n; ++i) {
+      const Sent& e = sent[rows + i];
+      const uint8_t* p = pl.data() + i * d.sampleBytes();
+      uint8_t want[64];
+      uint8_t* w = (e.s.flags & SAMPLE_FLAG_GAP) ? ChannelTable::packMissing(want)
+                                                 : ChannelTable::packAnalog(want, e.s.raw, e.s.held);
+      badBytes += memcmp(p, want, (size_t)(w - want)) != 0;
+      uint64_t tUs, tUsEnd;
+      memcpy(&tUs, p + fields[ANALOG_CHANNEL_COUNT].offset, 8);
+      memcpy(&tUsEnd, p + fields[fields.size() - 1].offset, 8);
+      badBytes += tUs != TimeMapper::sampleToNTP(e.s.t_us, e.s.rollover_count);
+      badBytes += tUsEnd != TimeMapper::sampleToNTP(e.s.t_us_end, e.s.rollover_count_end);
+    }
+
+    // Decoded values: the channel's physical value, computed here
+    std::vector<CaptureStore::Record> recs(n);
+    if (d.decode(pl.data(), pl.size(), recs.data(), n) != n) badRecords++;
+    for (size_t i = 0; i < n; ++i) {
+      const Sent& e = sent[rows + i];
+      const CaptureStore::Record& r = recs[i];
+      bool ok = r.status == e.status && r.tUs == TimeMapper::sampleToNTP(e.s.t_us, e.s.rollover_count) &&
+                r.tUsEnd == TimeMapper::sampleToNTP(e.s.t_us_end, e.s.rollover_count_end);
+      for (size_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+        const float v = e.s.raw[ch] * kAnalogChannels[ch].scale + kAnalogChannels[ch].offset;
+        const bool none = (e.s.flags & SAMPLE_FLAG_GAP) || (e.s.held & (1u << ch));
+        ok &= none ? std::isnan(r.ch[ch]) : r.ch[ch] == v;
+      }
+      badRecords += !ok;
+    }
+
+    for (int scalar = 0; scalar < 2; ++scalar) {
+      std::vector<std::vector<float> > cols(ANALOG_CHANNEL_COUNT, std::vector<float>(n));
+      std::vector<uint8_t> st(n);
+      std::vector<uint64_t> t(n);
+      std::vector<uint16_t> dur(n);
+      BlockCodec::ColumnsOut out;
+      memset(&out, 0, sizeof(out));
+      for (size_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) out.ch[ch] = cols[ch].data();
+      out.status = st.data();
+      out.t = t.data();
+      out.dur = dur.data();
+      const size_t got = scalar ? d.decodeColumnsScalar(pl.data(), pl.size(), out)
+                                : d.decodeColumns(pl.data(), pl.size(), out);
+      if (got != n) badColumns++;
+      for (size_t i = 0; i < n && got == n; ++i) {
+        bool ok = st[i] == recs[i].status && t[i] == recs[i].tUs && dur[i] == recs[i].tUsEnd - recs[i].tUs;
+        for (size_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+          ok &= std::isnan(recs[i].ch[ch]) ? std::isnan(cols[ch][i]) : cols[ch][i] == recs[i].ch[ch];
+        }
+        badColumns += !ok;
+      }
+    }
+    rows += n;
+  }
+  printf("  %zu samples decoded\n", rows);
+  check(rows == sent.size() && badBytes == 0, "field bytes are ChannelTable's packing of the Sample");
+  check(badRecords == 0, "records: physical values, NTP times, status bits");
+  check(badColumns == 0, d.columnKernel() == SchemaDecoder::KERNEL_AVX2 ? "AVX2 and scalar columns match the records"
+                                                                        : "columns match the records");
+
+  printf("%s\n", s_failures ? "FAILED" : "all checks passed");
+  return s_failures ? 1 : 0;
+}
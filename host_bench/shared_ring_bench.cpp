@@ -0,0 +1,345 @@
+/*
+  shared_ring_bench – host benchmark for the CM4 -> CM7 SharedRing
+
+  Runs the exact RingFrame.h producer/consumer code on the host:
+
+    push     producer cost per frame: the former 28-byte power-of-two
+             ring, packed frames published one at a time, the
+             SharedRing_Add() default (published every
+             SHARED_RING_PUBLISH_EVERY frames) and blocks of 16
+    stress   producer and consumer threads; random block sizes on a small
+             odd-sized ring so every run wraps many times; checks the
+             consumer sees every frame exactly once, in order
+    doorbell bursty producer thread publishing like SharedRing_Add();
+             consumer sleeps on a std::condition_variable standing in
+             for WFE, woken by the RING_SEV() doorbell or a (long) tick.
+             Checks the Doorbell.h hysteresis never loses a wakeup
+    stall    10 kHz producer with the consumer stalled for 50..500 ms;
+             reports overruns and checks the reconstructed 64-bit
+             timestamps (including a rollover of the 32-bit tick)
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -IREMC_GIGAR1_Core0 \
+        host_bench/shared_ring_bench.cpp -o shared_ring_bench -pthread
+*/
+
+// Doorbell SEV -> condition_variable (see benchDoorbell)
+static void host_ring_sev();
+#define RING_SEV() host_ring_sev()
+
+#include "SharedRing.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+static SharedRing s_ring;
+
+static std::mutex s_evMutex;
+static std::condition_variable s_evCv;
+static bool s_event = false;
+static std::chrono::steady_clock::time_point s_evTime;
+
+static void host_ring_sev() {
+  {
+    std::lock_guard<std::mutex> lock(s_evMutex);
+    s_event = true;
+    s_evTime = std::chrono::steady_clock::now();
+  }
+  s_evCv.notify_one();
+}
+
+// ---------------- former layout, for comparison ----------------
+namespace legacy {
+const uint32_t CAP = 1024;
+struct Ring {
+  uint32_t capacity, head, tail, overruns;
+  Sample samples[CAP];
+};
+Ring ring;
+
+inline void push(const Sample& s) {
+  const uint32_t mask = ring.capacity - 1u;
+  uint32_t head = ring.head;
+  uint32_t tail = ring.tail;
+  if ((head - tail) >= ring.capacity) {
+    ring.tail = tail + 1;
+    ring.overruns++;
+  }
+  ring.samples[head & mask] = s;
+  RING_DMB();
+  ring.head = head + 1;
+}
+}
+
+static Sample makeSample(uint64_t t_us, uint32_t n) {
+  Sample s;
+  s.t_us = (uint32_t)t_us;
+  s.rollover_count = (uint32_t)(t_us >> 32);
+  const uint64_t end = t_us + 7;
+  s.t_us_end = (uint32_t)end;
+  s.rollover_count_end = (uint32_t)(end >> 32);
+  for (uint8_t c = 0; c < ANALOG_CHANNEL_COUNT; ++c) s.raw[c] = (uint16_t)((n + c) & 0x0FFF);
+  return s;
+}
+
+static double nowNs() {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int benchPush(uint32_t frames) {
+  std::vector<Sample> src(4096);
+  for (uint32_t i = 0; i < src.size(); ++i) src[i] = makeSample(1000000ull + 100ull * i, i);
+
+  legacy::ring.capacity = legacy::CAP;
+  double t0 = nowNs();
+  for (uint32_t i = 0; i < frames; ++i) legacy::push(src[i & 4095]);
+  double legacyNs = (nowNs() - t0) / frames;
+
+  RingProducer p = { 0, 0, 0, 0 };
+  ring_init(s_ring);
+  t0 = nowNs();
+  for (uint32_t i = 0; i < frames; ++i) ring_push(s_ring, p, src[i & 4095]);
+  double packedNs = (nowNs() - t0) / frames;
+
+  // SharedRing_Add(): stage, publish every SHARED_RING_PUBLISH_EVERY
+  ring_init(s_ring);
+  p.pending = 0;
+  t0 = nowNs();
+  for (uint32_t i = 0; i < frames; ++i) {
+    ring_stage(s_ring, p, src[i & 4095]);
+    if (p.pending >= SHARED_RING_PUBLISH_EVERY) ring_publish(s_ring, p);
+  }
+  ring_publish(s_ring, p);
+  double defaultNs = (nowNs() - t0) / frames;
+
+  const uint32_t BLOCK = 16;
+  ring_init(s_ring);
+  p.pending = 0;
+  t0 = nowNs();
+  for (uint32_t i = 0; i + BLOCK <= frames; i += BLOCK) {
+    ring_push_block(s_ring, p, &src[i & 4095], BLOCK);
+  }
+  double blockNs = (nowNs() - t0) / frames;
+
+  printf("push: %u frames\n", frames);
+  printf("  legacy  %2zu B/frame  cap %5u  %6.2f ns/frame\n",
+         sizeof(Sample), legacy::CAP, legacyNs);
+  printf("  packed  %2zu B/frame  cap %5u  %6.2f ns/frame (publish per frame)\n",
+         sizeof(RingFrame), (unsigned)s_ring.capacity, packedNs);
+  printf("  default %2zu B/frame  cap %5u  %6.2f ns/frame (SharedRing_Add, publish every %u)\n",
+         sizeof(RingFrame), (unsigned)s_ring.capacity, defaultNs, (unsigned)SHARED_RING_PUBLISH_EVERY);
+  printf("  block%-2u %2zu B/frame  cap %5u  %6.2f ns/frame\n",
+         BLOCK, sizeof(RingFrame), (unsigned)s_ring.capacity, blockNs);
+  return 0;
+}
+
+// Simulated timeline: producer every 100 µs, consumer every 1 ms except
+// for one stall. Ticks start just below 2^32 so the run crosses a rollover.
+static bool runStall(uint32_t stallMs, uint32_t& overruns, uint32_t& gaps) {
+  const uint32_t MAX_FETCH = 1024;
+  const uint64_t T0 = 0xFFFFFFFFull - 500000ull;  // rollover 0.5 s in
+  const uint32_t TOTAL_MS = 2000;
+  const uint32_t STALL_AT_MS = 700;
+
+  static Sample out[MAX_FETCH];
+  ring_init(s_ring);
+  RingProducer p = { 0, 0, 0, 0 };
+  RingEpoch epoch = { false, 0, 0 };
+
+  uint64_t last = 0;
+  bool haveLast = false;
+  bool ok = true;
+  gaps = 0;
+
+  for (uint32_t ms = 0; ms < TOTAL_MS; ++ms) {
+    for (uint32_t k = 0; k < 10; ++k) {
+      const uint64_t t = T0 + (uint64_t)ms * 1000u + k * 100u;
+      ring_push(s_ring, p, makeSample(t, ms * 10 + k));
+    }
+    if (ms >= STALL_AT_MS && ms < STALL_AT_MS + stallMs) continue;
+
+    size_t n;
+    while ((n = ring_consume(s_ring, epoch, out, MAX_FETCH)) > 0) {
+      for (size_t i = 0; i < n; ++i) {
+        const uint64_t t = ((uint64_t)out[i].rollover_count << 32) | out[i].t_us;
+        const uint64_t te = ((uint64_t)out[i].rollover_count_end << 32) | out[i].t_us_end;
+        if (te != t + 7) ok = false;
+        if (haveLast) {
+          if (t <= last) ok = false;
+          else if (t != last + 100) gaps++;
+        } else if (t != T0) {
+          ok = false;
+        }
+        last = t;
+        haveLast = true;
+      }
+    }
+  }
+  if (last != T0 + (uint64_t)(TOTAL_MS - 1) * 1000u + 900u) ok = false;
+  overruns = s_ring.overruns;
+  return ok;
+}
+
+static int benchStall() {
+  printf("stall: capacity %u frames = %.1f ms at 10 kHz (former ring: %.1f ms)\n",
+         (unsigned)SHARED_RING_CAPACITY, (double)SHARED_RING_CAPACITY * 0.1, legacy::CAP * 0.1);
+
+  const uint32_t stalls[] = { 50, 100, 200, 300, 400, 500 };
+  int failures = 0;
+  for (uint32_t s : stalls) {
+    uint32_t overruns = 0, gaps = 0;
+    bool ok = runStall(s, overruns, gaps);
+    printf("  stall %3u ms  overruns %5u  gaps %u  timestamps %s\n",
+           s, overruns, gaps, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+  }
+  return failures ? 1 : 0;
+}
+
+// Two threads, odd capacity, random block sizes. The producer never
+// overruns (it waits for space), so the consumer must see every frame
+// exactly once and in order, with raw[] matching the tick.
+static int benchStress(uint32_t frames) {
+  const uint32_t CAP = 61;       // odd: exercises the mirror indices
+  const uint32_t MAX_BLOCK = 24;
+
+  ring_init(s_ring);
+  s_ring.capacity = CAP;
+
+  std::thread producer([frames]() {
+    std::mt19937 rng(12345);
+    RingProducer p = { 0, 0, 0, 0 };
+    Sample block[MAX_BLOCK];
+    uint32_t n = 0;
+    while (n < frames) {
+      uint32_t len = 1 + rng() % MAX_BLOCK;
+      if (len > frames - n) len = frames - n;
+      while (CAP - ring_available(s_ring) < len) std::this_thread::yield();
+      for (uint32_t i = 0; i < len; ++i) {
+        block[i] = makeSample(0xFFFF0000ull + 100ull * (n + i), n + i);
+      }
+      if (rng() & 1) {
+        ring_push_block(s_ring, p, block, len);
+      } else {
+        for (uint32_t i = 0; i < len; ++i) ring_stage(s_ring, p, block[i]);
+        ring_publish(s_ring, p);
+      }
+      n += len;
+    }
+  });
+
+  RingEpoch epoch = { false, 0, 0 };
+  Sample out[MAX_BLOCK * 2];
+  uint32_t seen = 0, bad = 0;
+  std::mt19937 rng(777);
+  while (seen < frames) {
+    size_t n = ring_consume(s_ring, epoch, out, (int32_t)(1 + rng() % (2 * MAX_BLOCK)));
+    for (size_t i = 0; i < n; ++i) {
+      const Sample want = makeSample(0xFFFF0000ull + 100ull * seen, seen);
+      if (out[i].t_us != want.t_us || out[i].rollover_count != want.rollover_count ||
+          memcmp(out[i].raw, want.raw, sizeof(want.raw)) != 0) {
+        bad++;
+      }
+      seen++;
+    }
+    if (n == 0) std::this_thread::yield();
+  }
+  producer.join();
+
+  printf("stress: %u frames through a %u-frame ring, %u wraps, overruns %u, mismatches %u\n",
+         frames, CAP, frames / CAP, (unsigned)s_ring.overruns, bad);
+  return (bad || s_ring.overruns) ? 1 : 0;
+}
+
+// Bursty producer, sleeping consumer. The tick is long (50 ms) compared
+// with the time the producer needs to reach the threshold, so a tick wake
+// with the fill at or above the threshold means a lost doorbell.
+static int benchDoorbell(uint32_t frames) {
+  const uint32_t HIGH = DOORBELL_HIGH_FRAMES;
+  const uint32_t LOW = DOORBELL_LOW_FRAMES;
+  const auto TICK = std::chrono::milliseconds(50);
+
+  ring_init(s_ring);
+  s_event = false;
+
+  std::thread producer([frames]() {
+    std::mt19937 rng(4242);
+    RingProducer p = { 0, 0, 0, 0 };
+    uint32_t n = 0;
+    while (n < frames) {
+      uint32_t burst = 1 + rng() % 40;
+      // Published as SharedRing_Add() does (every SHARED_RING_PUBLISH_EVERY)
+      for (uint32_t i = 0; i < burst && n < frames; ++i, ++n) {
+        ring_stage(s_ring, p, makeSample(100ull * n, n));
+        if (p.pending >= SHARED_RING_PUBLISH_EVERY) ring_publish(s_ring, p);
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200 + rng() % 1800));
+    }
+    ring_publish(s_ring, p);
+  });
+
+  Doorbell::Consumer db;
+  Doorbell::init(db, HIGH, LOW);
+  RingEpoch epoch = { false, 0, 0 };
+  static Sample out[1024];
+  uint32_t seen = 0, bad = 0;
+  uint32_t sleeps = 0, doorbellWakes = 0, tickWakes = 0, lost = 0, maxFill = 0;
+  double maxLatencyUs = 0.0, sumLatencyUs = 0.0;
+
+  while (seen < frames) {
+    size_t n = ring_consume(s_ring, epoch, out, 1024);
+    for (size_t i = 0; i < n; ++i, ++seen) {
+      if (out[i].t_us != (uint32_t)(100ull * seen)) bad++;
+    }
+    if (Doorbell::next(db, ring_available(s_ring)) != Doorbell::SLEEP) continue;
+    if (!ring_arm_notify(s_ring, db.cfg.highFrames)) continue;
+
+    // "WFE"
+    sleeps++;
+    std::unique_lock<std::mutex> lock(s_evMutex);
+    bool rang = s_evCv.wait_for(lock, TICK, [] { return s_event; });
+    const auto woke = std::chrono::steady_clock::now();
+    if (rang) {
+      doorbellWakes++;
+      const double us = std::chrono::duration<double, std::micro>(woke - s_evTime).count();
+      sumLatencyUs += us;
+      if (us > maxLatencyUs) maxLatencyUs = us;
+    } else {
+      tickWakes++;
+    }
+    s_event = false;
+    lock.unlock();
+    ring_disarm_notify(s_ring);
+
+    const uint32_t fill = ring_available(s_ring);
+    if (fill > maxFill) maxFill = fill;
+    if (!rang && fill >= HIGH) lost++;
+  }
+  producer.join();
+
+  printf("doorbell: %u frames, high %u low %u, sleeps %u, doorbell wakes %u (sev %u), tick wakes %u\n",
+         frames, HIGH, LOW, sleeps, doorbellWakes, (unsigned)s_ring.notifies, tickWakes);
+  printf("  wake latency avg %.1f us max %.1f us, max fill at wake %u, lost wakeups %u, mismatches %u\n",
+         doorbellWakes ? sumLatencyUs / doorbellWakes : 0.0, maxLatencyUs, maxFill, lost, bad);
+  return (lost || bad) ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  const char* mode = argc > 1 ? argv[1] : "all";
+  uint32_t frames = argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 20000000u;
+
+  int rc = 0;
+  if (!strcmp(mode, "push") || !strcmp(mode, "all")) rc |= benchPush(frames);
+  if (!strcmp(mode, "stall") || !strcmp(mode, "all")) rc |= benchStall();
+  if (!strcmp(mode, "stress") || !strcmp(mode, "all")) rc |= benchStress(frames < 2000000u ? frames : 2000000u);
+  if (!strcmp(mode, "doorbell") || !strcmp(mode, "all")) rc |= benchDoorbell(frames < 100000u ? frames : 100000u);
+  return rc;
+}
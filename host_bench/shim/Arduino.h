@@ -0,0 +1,100 @@
+/*
+  Host shim for the Arduino core – just enough of the API for the portable
+  CM7 modules (SampleCollector, UdpManager, TraceRecorder, ...) to build on
+  a PC for host_bench/trace_replay. Implementations are in host_arduino.cpp.
+
+  millis()/micros() follow a clock set by the host program (HostClock), so
+  a replay is deterministic. Serial output goes through HostSerial, which
+  can echo it and hands every completed line to an optional hook.
+*/
+
+#ifndef HOST_SHIM_ARDUINO_H
+#define HOST_SHIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <type_traits>
+
+typedef uint8_t byte;
+
+#define HEX 16
+#define DEC 10
+#define LOW  0
+#define HIGH 1
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+enum HostDigitalPin : uint8_t { D0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, D14, D15, D16, D17, D18, D19, D20, D21, D22, D23, D24, D25, D26, D27, D28, D29, D30, D31, D32, D33, D34, D35, D36, D37, D38, D39, D40, D41, D42, D43, D44, D45, D46, D47, D48, D49, D50, D51, D52, D53, D54, D55, D56, D57, D58, D59, D60, D61, D62, D63, D64, D65, D66, D67, D68, D69, D70, D71, D72, D73, D74, D75 };
+enum HostAnalogPin : uint8_t { A0 = 100, A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11 };
+
+template <class T, class L>
+static inline auto min(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+  return (b < a) ? b : a;
+}
+template <class T, class L>
+static inline auto max(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+  return (a < b) ? b : a;
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void pinMode(uint8_t pin, uint8_t mode);
+
+// Host-controlled time base for millis()/micros()
+namespace HostClock {
+  void setMicros(uint64_t us);
+  uint64_t micros64();
+}
+
+class IPAddress;
+
+class HostSerial {
+public:
+  typedef void (*LineHook)(const char* line);
+
+  void begin(unsigned long) {}
+  explicit operator bool() const { return true; }
+  void flush() { fflush(stdout); }
+
+  void setEcho(bool echo) { _echo = echo; }
+  void setLineHook(LineHook hook) { _hook = hook; }
+
+  size_t print(const char* s);
+  size_t print(const __FlashStringHelper* s) { return print(reinterpret_cast<const char*>(s)); }
+  size_t print(char c);
+  size_t print(double v, int digits = 2);
+  size_t print(const IPAddress& ip);
+  template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+  size_t print(T v, int base = DEC) {
+    char buf[24];
+    if (base == HEX) snprintf(buf, sizeof(buf), "%llX", (unsigned long long)v);
+    else if (std::is_signed<T>::value) snprintf(buf, sizeof(buf), "%lld", (long long)v);
+    else snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+    return print((const char*)buf);
+  }
+
+  size_t println() { return print('\n'); }
+  template <typename T>
+  size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T>
+  size_t println(const T& v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+
+private:
+  bool _echo = false;
+  LineHook _hook = nullptr;
+  char _line[512];
+  size_t _lineLen = 0;
+};
+
+extern HostSerial Serial;
+
+#endif // HOST_SHIM_ARDUINO_H
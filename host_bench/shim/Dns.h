@@ -0,0 +1,2 @@
+// Host shim: DNSClient is not used by the modules built on the host
+#pragma once
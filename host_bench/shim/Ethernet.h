@@ -0,0 +1,29 @@
+/*
+  Host shim for the Ethernet library: IPAddress and Ethernet.begin().
+  See EthernetUdp.h for the datagram side.
+*/
+
+#ifndef HOST_SHIM_ETHERNET_H
+#define HOST_SHIM_ETHERNET_H
+
+#include "Arduino.h"
+#include "EthernetUdp.h"
+
+class IPAddress {
+public:
+  IPAddress() : _b{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _b{a, b, c, d} {}
+  uint8_t operator[](int i) const { return _b[i]; }
+  bool operator==(const IPAddress& o) const { return memcmp(_b, o._b, 4) == 0; }
+private:
+  uint8_t _b[4];
+};
+
+class EthernetClass {
+public:
+  void begin(uint8_t*, IPAddress, IPAddress, IPAddress, IPAddress) {}
+};
+
+extern EthernetClass Ethernet;
+
+#endif // HOST_SHIM_ETHERNET_H
@@ -0,0 +1,45 @@
+/*
+  Host shim for EthernetUDP. No sockets: sent datagrams go to HostNet's
+  send hook, and parsePacket() pops datagrams queued with HostNet::inject()
+  for the socket's local port.
+*/
+
+#ifndef HOST_SHIM_ETHERNET_UDP_H
+#define HOST_SHIM_ETHERNET_UDP_H
+
+#include "Arduino.h"
+#include <vector>
+
+class IPAddress;
+
+namespace HostNet {
+  typedef void (*SendHook)(uint16_t port, const uint8_t* data, size_t len);
+  void setSendHook(SendHook hook);
+  void inject(uint16_t port, const uint8_t* data, size_t len);
+}
+
+class EthernetUDP {
+public:
+  uint8_t begin(uint16_t port) { _localPort = port; return 1; }
+  uint8_t beginMulticast(const IPAddress&, uint16_t port) { _localPort = port; return 1; }
+  void stop() {}
+
+  int beginPacket(const IPAddress&, uint16_t port) { _destPort = port; _tx.clear(); return 1; }
+  size_t write(const uint8_t* data, size_t len) { _tx.insert(_tx.end(), data, data + len); return len; }
+  size_t write(uint8_t b) { _tx.push_back(b); return 1; }
+  int endPacket();
+
+  int parsePacket();
+  int available() { return (int)(_rx.size() - _rxPos); }
+  int read(uint8_t* buf, size_t len);
+  int read() { return _rxPos < _rx.size() ? _rx[_rxPos++] : -1; }
+
+private:
+  uint16_t _localPort = 0;
+  uint16_t _destPort = 0;
+  std::vector<uint8_t> _tx;
+  std::vector<uint8_t> _rx;
+  size_t _rxPos = 0;
+};
+
+#endif // HOST_SHIM_ETHERNET_UDP_H
@@ -0,0 +1,19 @@
+/*
+  Host shim for the GIGA SDRAM library: plain heap allocations.
+*/
+
+#ifndef HOST_SHIM_SDRAM_H
+#define HOST_SHIM_SDRAM_H
+
+#include <stdlib.h>
+
+class SDRAMClass {
+public:
+  int begin() { return 1; }
+  void* malloc(size_t size) { return ::malloc(size); }
+  void free(void* ptr) { ::free(ptr); }
+};
+
+extern SDRAMClass SDRAM;
+
+#endif // HOST_SHIM_SDRAM_H
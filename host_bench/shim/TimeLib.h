@@ -0,0 +1,13 @@
+/*
+  Host shim for TimeLib: setTime()/now() on top of the HostClock millis().
+*/
+
+#ifndef HOST_SHIM_TIMELIB_H
+#define HOST_SHIM_TIMELIB_H
+
+#include <time.h>
+
+void setTime(int hr, int min, int sec, int day, int month, int yr);
+time_t now();
+
+#endif // HOST_SHIM_TIMELIB_H
@@ -0,0 +1,115 @@
+// Host implementations behind the Arduino / Ethernet / TimeLib / SDRAM shims
+#include "Arduino.h"
+#include "Ethernet.h"
+#include "EthernetUdp.h"
+#include "TimeLib.h"
+#include "SDRAM.h"
+#include "stm32h7xx.h"
+
+#include <deque>
+#include <map>
+
+HostSerial Serial;
+EthernetClass Ethernet;
+SDRAMClass SDRAM;
+GPIO_TypeDef host_gpio_e = { 0xFFFFFFFFu };
+GPIO_TypeDef host_gpio_g = { 0xFFFFFFFFu };
+
+// ---------------- Clock ----------------
+static uint64_t s_clockUs = 0;
+
+void HostClock::setMicros(uint64_t us) { s_clockUs = us; }
+uint64_t HostClock::micros64() { return s_clockUs; }
+
+unsigned long millis() { return (unsigned long)(s_clockUs / 1000u); }
+unsigned long micros() { return (unsigned long)s_clockUs; }
+void delay(unsigned long ms) { s_clockUs += (uint64_t)ms * 1000u; }
+void delayMicroseconds(unsigned int us) { s_clockUs += us; }
+int digitalRead(uint8_t) { return HIGH; }
+void digitalWrite(uint8_t, uint8_t) {}
+void pinMode(uint8_t, uint8_t) {}
+
+// ---------------- TimeLib ----------------
+static time_t s_timeBase = 0;        // epoch seconds at s_timeBaseMs
+static unsigned long s_timeBaseMs = 0;
+
+void setTime(int hr, int min, int sec, int day, int month, int yr) {
+  struct tm t;
+  memset(&t, 0, sizeof(t));
+  t.tm_hour = hr;
+  t.tm_min = min;
+  t.tm_sec = sec;
+  t.tm_mday = day;
+  t.tm_mon = month - 1;
+  t.tm_year = yr - 1900;
+  s_timeBase = timegm(&t);
+  s_timeBaseMs = millis();
+}
+
+time_t now() {
+  return s_timeBase + (time_t)((millis() - s_timeBaseMs) / 1000u);
+}
+
+// ---------------- Serial ----------------
+size_t HostSerial::print(const char* s) {
+  size_t n = 0;
+  for (; s[n]; ++n) print(s[n]);
+  return n;
+}
+
+size_t HostSerial::print(char c) {
+  if (_echo) fputc(c, stdout);
+  if (c == '\n') {
+    _line[_lineLen] = '\0';
+    if (_hook) _hook(_line);
+    _lineLen = 0;
+  } else if (_lineLen < sizeof(_line) - 1) {
+    _line[_lineLen++] = c;
+  }
+  return 1;
+}
+
+size_t HostSerial::print(double v, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return print((const char*)buf);
+}
+
+size_t HostSerial::print(const IPAddress& ip) {
+  char buf[20];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  return print((const char*)buf);
+}
+
+// ---------------- UDP ----------------
+static HostNet::SendHook s_sendHook = nullptr;
+static std::map<uint16_t, std::deque<std::vector<uint8_t>>> s_inbound;
+
+void HostNet::setSendHook(SendHook hook) { s_sendHook = hook; }
+
+void HostNet::inject(uint16_t port, const uint8_t* data, size_t len) {
+  s_inbound[port].emplace_back(data, data + len);
+}
+
+int EthernetUDP::endPacket() {
+  if (s_sendHook) s_sendHook(_destPort, _tx.data(), _tx.size());
+  _tx.clear();
+  return 1;
+}
+
+int EthernetUDP::parsePacket() {
+  std::deque<std::vector<uint8_t>>& q = s_inbound[_localPort];
+  if (q.empty()) return 0;
+  _rx.swap(q.front());
+  q.pop_front();
+  _rxPos = 0;
+  return (int)_rx.size();
+}
+
+int EthernetUDP::read(uint8_t* buf, size_t len) {
+  size_t n = _rx.size() - _rxPos;
+  if (n > len) n = len;
+  memcpy(buf, _rx.data() + _rxPos, n);
+  _rxPos += n;
+  return (int)n;
+}
@@ -0,0 +1,20 @@
+/*
+  Host shim for the STM32H7 device header: only the GPIO ports PinConfig.h
+  reads. All inputs read as high (switches released).
+*/
+
+#ifndef HOST_SHIM_STM32H7XX_H
+#define HOST_SHIM_STM32H7XX_H
+
+#include <stdint.h>
+
+typedef struct {
+  volatile uint32_t IDR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef host_gpio_e;
+extern GPIO_TypeDef host_gpio_g;
+#define GPIOE (&host_gpio_e)
+#define GPIOG (&host_gpio_g)
+
+#endif // HOST_SHIM_STM32H7XX_H
@@ -0,0 +1,3 @@
+// Host shim: the HAL is not used by the modules built on the host
+#pragma once
+#include "stm32h7xx.h"
@@ -0,0 +1,401 @@
+/*
+  spectrum_monitor_bench – host check and benchmark for the CM7 SpectrumMonitor
+
+  Runs the portable SpectrumMonitor.cpp (REMC_USE_CMSIS_DSP off, the
+  radix-2 real FFT) on the host and compares every summary with a
+  double-precision reference: the same mean removal, periodic Hann window
+  and one-sided normalization, but a direct O(N^2) DFT.
+
+    tones      known signals – one bin-centred tone, an off-bin tone,
+               ripple + switching tones with noise, DC only, white noise:
+               peak bins and order, peak and band powers, mean and RMS
+    golden     analyze() of integer-generated blocks against Summary bytes
+               recorded from this build: any change in the tables, the FFT
+               or the rounding fails it, on the host or on the M7. Also
+               checks that every table entry rounds from double to float
+               far from a rounding boundary, so libm differences of an ulp
+               of double cannot change the tables
+    stream     processBlock() with the monitor enabled: one summary per
+               monitored channel every SPECTRUM_INTERVAL_BLOCKS blocks,
+               each identical to analyze() on the same block
+    speed      time per SPECTRUM_FFT_SIZE-point analyze() (one channel
+               block) and the resulting CM7 load at 10 kHz
+
+  The CMSIS-DSP path (arm_rfft_fast_f32) is not built here; it rounds
+  differently and is only expected to agree with the reference to the
+  same tolerance.
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -Ihost_bench/shim -IREMC_GIGAR1_Core0 \
+        host_bench/spectrum_monitor_bench.cpp REMC_GIGAR1_Core0/SpectrumMonitor.cpp -o spectrum_monitor_bench
+*/
+
+#include "SpectrumMonitor.h"
+#include "SharedRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using SpectrumMonitor::Summary;
+
+static const size_t N = SPECTRUM_FFT_SIZE;
+static const size_t M = N / 2;
+static const double FS = SPECTRUM_SAMPLE_RATE_HZ;
+
+static int s_failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("  %-62s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) s_failures++;
+}
+
+static double nowNs() {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------- double-precision reference ----------------
+struct Reference {
+  double mean;
+  double rms;
+  double power[M + 1];
+  double band[SpectrumMonitor::NUM_BANDS];
+};
+
+static void referenceOf(const std::vector<float>& x, Reference& r) {
+  double mean = 0;
+  for (float v : x) mean += v;
+  mean /= (double)N;
+  std::vector<double> w(N), y(N);
+  double sumSq = 0;
+  for (size_t n = 0; n < N; ++n) {
+    w[n] = 0.5 - 0.5 * cos(2.0 * M_PI * (double)n / (double)N);
+    sumSq += w[n] * w[n];
+    y[n] = ((double)x[n] - mean) * w[n];
+  }
+  const double norm = 2.0 / ((double)N * sumSq);
+  double total = 0;
+  for (size_t k = 0; k <= M; ++k) {
+    double re = 0, im = 0;
+    for (size_t n = 0; n < N; ++n) {
+      const double a = 2.0 * M_PI * (double)((k * n) % N) / (double)N;
+      re += y[n] * cos(a);
+      im -= y[n] * sin(a);
+    }
+    r.power[k] = (re * re + im * im) * norm * (k == 0 || k == M ? 0.5 : 1.0);
+    if (k > 0) total += r.power[k];
+  }
+  r.mean = mean;
+  r.rms = sqrt(total);
+  const double binHz = FS / (double)N;
+  for (uint8_t b = 0; b < SpectrumMonitor::NUM_BANDS; ++b) {
+    size_t lo = (size_t)ceil(SpectrumMonitor::BAND_EDGES_HZ[b] / binHz);
+    size_t hi = (size_t)ceil(SpectrumMonitor::BAND_EDGES_HZ[b + 1] / binHz);
+    lo = std::max<size_t>(lo, 1);
+    hi = std::min<size_t>(hi, M + 1);
+    r.band[b] = 0;
+    for (size_t k = lo; k < hi; ++k) r.band[b] += r.power[k];
+  }
+}
+
+// Largest relative error of a summary against the reference, all powers
+// scaled by the block's total AC power
+static double compare(const Summary& s, const Reference& r, bool& peaksOk) {
+  const double total = std::max(r.rms * r.rms, 1e-30);
+  double worst = fabs(s.rmsCounts - r.rms) / std::max(r.rms, 1e-15);
+  worst = std::max(worst, fabs(s.meanCounts - r.mean) / std::max(fabs(r.mean), 1.0));
+  for (uint8_t b = 0; b < SpectrumMonitor::NUM_BANDS; ++b) {
+    worst = std::max(worst, fabs(s.bandPower[b] - r.band[b]) / total);
+  }
+  peaksOk = true;
+  for (uint8_t p = 0; p < s.numPeaks; ++p) {
+    const uint16_t k = s.peaks[p].bin;
+    worst = std::max(worst, fabs(s.peaks[p].power - r.power[k]) / total);
+    // A reported peak is a local maximum of the reference too, unless the
+    // neighbours are equal to rounding
+    const double eps = 1e-5 * total;
+    peaksOk &= k > 0 && k < M && r.power[k] + eps >= r.power[k - 1] && r.power[k] + eps >= r.power[k + 1];
+    if (p > 0) peaksOk &= s.peaks[p].power <= s.peaks[p - 1].power;
+  }
+  return worst;
+}
+
+// ---------------- signals ----------------
+static double binFreq(double bin) { return bin * FS / (double)N; }
+
+static std::vector<float> tones(double dc, const std::vector<std::pair<double, double> >& t, double noise,
+                                uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::vector<float> x(N);
+  for (size_t n = 0; n < N; ++n) {
+    double v = dc;
+    for (const auto& tone : t) v += tone.second * sin(2.0 * M_PI * tone.first * (double)n / FS + 0.3);
+    if (noise > 0) v += noise * gauss(rng);
+    // Raw counts, as Sample::raw[] holds them
+    x[n] = (float)std::min(4095.0, std::max(0.0, std::round(v)));
+  }
+  return x;
+}
+
+static Summary analyzeCopy(const std::vector<float>& x) {
+  std::vector<float> block(x);
+  Summary s;
+  memset(&s, 0, sizeof(s));
+  SpectrumMonitor::analyze(block.data(), s);
+  return s;
+}
+
+static void printSummary(const Summary& s) {
+  printf("    mean %.2f rms %.3f  peaks", s.meanCounts, s.rmsCounts);
+  for (uint8_t p = 0; p < s.numPeaks; ++p) printf(" %u:%.4g", s.peaks[p].bin, s.peaks[p].power);
+  printf("  bands");
+  for (uint8_t b = 0; b < SpectrumMonitor::NUM_BANDS; ++b) printf(" %.4g", s.bandPower[b]);
+  printf("\n");
+}
+
+static const double TOL = 1e-4;   // of the block's total power
+
+static void benchTones() {
+  printf("tones (%zu points, %.3f Hz bins)\n", N, FS / (double)N);
+  char line[128];
+
+  struct Case {
+    const char* name;
+    std::vector<float> x;
+    std::vector<uint16_t> bins;      // expected peak bins, strongest first
+  };
+  const double b40 = binFreq(40), b6 = binFreq(6), b102 = binFreq(102), b307 = binFreq(307);
+  std::vector<Case> cases;
+  cases.push_back({ "bin-centred tone, bin 40", tones(2048, { { b40, 800 } }, 0, 1), { 40 } });
+  cases.push_back({ "off-bin tone, 123.4 Hz", tones(2048, { { 123.4, 800 } }, 0, 2), { 13 } });
+  cases.push_back({ "ripple + switching tones + noise",
+                    tones(2000, { { b6, 300 }, { b102, 120 }, { b307, 40 } }, 3.0, 3), { 6, 102, 307 } });
+  cases.push_back({ "DC only", tones(1234, {}, 0, 4), {} });
+  cases.push_back({ "white noise", tones(2048, {}, 200.0, 5), {} });
+
+  double worstAll = 0;
+  for (const Case& c : cases) {
+    const Summary s = analyzeCopy(c.x);
+    Reference r;
+    referenceOf(c.x, r);
+    bool peaksOk;
+    const double worst = compare(s, r, peaksOk);
+    worstAll = std::max(worstAll, r.rms > 0 ? worst : 0.0);
+    printf("  %s\n", c.name);
+    printSummary(s);
+
+    bool binsOk = s.numPeaks >= c.bins.size();
+    for (size_t i = 0; binsOk && i < c.bins.size(); ++i) binsOk = s.peaks[i].bin == c.bins[i];
+    if (!c.bins.empty()) {
+      snprintf(line, sizeof(line), "%s: peaks at the tone bins, strongest first", c.name);
+      check(binsOk, line);
+    }
+    if (r.rms > 0) {
+      snprintf(line, sizeof(line), "%s: matches the reference DFT (%.1e)", c.name, worst);
+      check(worst < TOL && peaksOk, line);
+    } else {
+      snprintf(line, sizeof(line), "%s: mean kept, no AC power (rms %.2g)", c.name, s.rmsCounts);
+      check(fabs(s.meanCounts - r.mean) < 1e-3 && s.rmsCounts < 1e-3, line);
+    }
+  }
+
+  // Parseval: a tone of amplitude A has mean-square A^2/2, all in its band
+  const Summary s = analyzeCopy(tones(2048, { { b40, 800 } }, 0, 1));
+  const double want = 800.0 * 800.0 / 2.0;
+  snprintf(line, sizeof(line), "tone power A^2/2 in its band (%.1f of %.1f)", s.bandPower[1], want);
+  check(fabs(s.bandPower[1] - want) / want < 1e-3 && fabs(s.rmsCounts * s.rmsCounts - want) / want < 1e-3, line);
+  printf("  worst relative error against the reference: %.2e\n", worstAll);
+}
+
+// ---------------- golden ----------------
+// Integer-only signal, so every platform feeds analyze() the same block:
+// a 156.25 Hz triangle, a 1 kHz square wave and 4-bit LCG noise
+static std::vector<float> integerSignal(uint32_t seed, int triangle, int square) {
+  std::vector<float> x(N);
+  uint32_t lcg = seed;
+  for (size_t n = 0; n < N; ++n) {
+    lcg = lcg * 1664525u + 1013904223u;
+    const int phase = (int)(n % 64);
+    const int tri = phase < 32 ? phase : 64 - phase;
+    const int sq = (n / 5) % 2 ? square : -square;
+    x[n] = (float)(2048 + triangle * tri + sq + (int)(lcg >> 28));
+  }
+  return x;
+}
+
+// Summary fields in order, little-endian, without the struct's padding
+// (t_us and rollover_count are the caller's)
+static const size_t SUMMARY_BYTES = 1 + 1 + 2 + 3 * 4 + SpectrumMonitor::MAX_PEAKS * 6 + SpectrumMonitor::NUM_BANDS * 4;
+
+static std::vector<uint8_t> summaryBytes(const Summary& s) {
+  std::vector<uint8_t> out;
+  auto put = [&out](const void* p, size_t n) {
+    out.insert(out.end(), (const uint8_t*)p, (const uint8_t*)p + n);
+  };
+  put(&s.channel, 1);
+  put(&s.numPeaks, 1);
+  put(&s.fftSize, 2);
+  put(&s.binHz, 4);
+  put(&s.meanCounts, 4);
+  put(&s.rmsCounts, 4);
+  for (uint8_t p = 0; p < SpectrumMonitor::MAX_PEAKS; ++p) {
+    put(&s.peaks[p].bin, 2);
+    put(&s.peaks[p].power, 4);
+  }
+  for (uint8_t b = 0; b < SpectrumMonitor::NUM_BANDS; ++b) put(&s.bandPower[b], 4);
+  return out;
+}
+
+// Distance of `exact` from the nearest float rounding boundary, in units of
+// `scale`: an error smaller than that cannot change the rounded float
+static long double roundingMargin(long double exact, long double scale) {
+  const float f = (float)exact;
+  if ((long double)f == exact) return 1.0L;
+  const float g = nextafterf(f, exact > f ? INFINITY : -INFINITY);
+  const long double mid = ((long double)f + (long double)g) / 2;
+  return fabsl(exact - mid) / scale;
+}
+
+static void benchGolden() {
+  printf("golden\n");
+  char line[160];
+
+  // SpectrumMonitor.cpp's tables, with cosl/sinl standing in for the exact
+  // values. A libm's cos/sin error is relative to the result; the window's
+  // is that error times 0.5, i.e. absolute
+  long double worst = 1.0L;
+  for (size_t n = 0; n < N; ++n) {
+    const long double a = 2.0 * M_PI * (double)n / (double)N;
+    worst = std::min(worst, roundingMargin(0.5L - 0.5L * cosl(a), 1.0L));
+    if (n < M) {
+      worst = std::min(worst, roundingMargin(cosl(a), fabsl(cosl(a))));
+      worst = std::min(worst, roundingMargin(sinl(a), std::max(fabsl(sinl(a)), 1e-30L)));
+    }
+  }
+  // Any libm within 2^-44 of the exact double result rounds every entry the same
+  snprintf(line, sizeof(line), "table entries clear of float rounding boundaries (%.1Le)", worst);
+  check(worst > 0x1p-44L, line);
+
+  struct Golden {
+    const char* name;
+    uint32_t seed;
+    int triangle, square;
+    uint8_t bytes[SUMMARY_BYTES];
+  };
+  static const Golden cases[] = {
+    { "triangle + square + noise", 1, 20, 40, {
+        0x00, 0x04, 0x00, 0x04, 0x00, 0x40, 0x1c, 0x41, 0xd4, 0x77, 0x14, 0x45, 0x00, 0x38,
+        0x3d, 0x43, 0x10, 0x00, 0x1a, 0x6b, 0xaf, 0x46, 0x66, 0x00, 0xb6, 0x44, 0x36, 0x44,
+        0x30, 0x00, 0x44, 0x01, 0x8d, 0x43, 0x33, 0x01, 0x8c, 0x4e, 0xfa, 0x42, 0x7e, 0xfa,
+        0x15, 0x3f, 0xf7, 0x29, 0x05, 0x47, 0xa2, 0x18, 0xb3, 0x44, 0x6c, 0xf0, 0x6b, 0x43 } },
+    { "square + noise", 2, 0, 300, {
+        0x00, 0x04, 0x00, 0x04, 0x00, 0x40, 0x1c, 0x41, 0xe4, 0x69, 0x00, 0x45, 0x2b, 0x21,
+        0x96, 0x43, 0x66, 0x00, 0xea, 0x6c, 0x1f, 0x47, 0x33, 0x01, 0x9a, 0xc1, 0xda, 0x45,
+        0x25, 0x01, 0xc1, 0x9c, 0x9b, 0x3e, 0x6e, 0x00, 0xde, 0x58, 0x81, 0x3e, 0x96, 0x90,
+        0x2d, 0x3f, 0xa7, 0xf8, 0xe3, 0x3f, 0x79, 0x55, 0x93, 0x47, 0x02, 0x37, 0x40, 0x46 } },
+    { "noise only", 3, 0, 0, {
+        0x00, 0x04, 0x00, 0x04, 0x00, 0x40, 0x1c, 0x41, 0x58, 0x75, 0x00, 0x45, 0x16, 0x6a,
+        0x94, 0x40, 0x6b, 0x00, 0x72, 0x9d, 0x76, 0x3e, 0x51, 0x01, 0x3b, 0xe0, 0x6d, 0x3e,
+        0x9c, 0x01, 0x0f, 0x50, 0x51, 0x3e, 0xbd, 0x00, 0xf4, 0x08, 0x51, 0x3e, 0x34, 0x7a,
+        0x06, 0x3e, 0xbe, 0xc6, 0x00, 0x40, 0xf3, 0xd9, 0xd8, 0x40, 0xa1, 0x67, 0x49, 0x41 } },
+  };
+  for (const Golden& g : cases) {
+    const std::vector<uint8_t> got = summaryBytes(analyzeCopy(integerSignal(g.seed, g.triangle, g.square)));
+    const bool same = got.size() == sizeof(g.bytes) && memcmp(got.data(), g.bytes, sizeof(g.bytes)) == 0;
+    snprintf(line, sizeof(line), "%s: Summary bytes match the recorded ones", g.name);
+    check(same, line);
+    if (!same) {
+      printf("    got");
+      for (uint8_t b : got) printf(" 0x%02x,", b);
+      printf("\n");
+    }
+  }
+}
+
+static void benchStream() {
+  printf("stream\n");
+  SpectrumMonitor::init();
+  SpectrumMonitor::enable();
+
+  const size_t BLOCKS = 2 * SPECTRUM_INTERVAL_BLOCKS + 1;
+  const size_t total = BLOCKS * N;
+  const uint8_t chans[SpectrumMonitor::NUM_CHANNELS] = { CH_SWITCH_VOLTAGE, CH_OUTPUT_VOLTAGE_A,
+                                                         CH_OUTPUT_VOLTAGE_B };
+  std::vector<Sample> samples(total);
+  std::mt19937 rng(9);
+  for (size_t i = 0; i < total; ++i) {
+    Sample& s = samples[i];
+    memset(&s, 0, sizeof(s));
+    s.t_us = (uint32_t)(i * 100);
+    for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+      const double f = binFreq(10.0 + 37.0 * ch);
+      s.raw[ch] = (uint16_t)lround(2048.0 + 500.0 * sin(2.0 * M_PI * f * (double)i / FS) + (double)(rng() % 7));
+    }
+  }
+
+  std::vector<Summary> got;
+  for (size_t i = 0; i < total;) {
+    const size_t n = std::min<size_t>(1 + rng() % 97, total - i);
+    SpectrumMonitor::processBlock(&samples[i], n);
+    i += n;
+    Summary s;
+    while (SpectrumMonitor::popSummary(s)) got.push_back(s);
+  }
+  SpectrumMonitor::disable();
+
+  const size_t analyzed = (BLOCKS + SPECTRUM_INTERVAL_BLOCKS - 1) / SPECTRUM_INTERVAL_BLOCKS;
+  printf("  %zu blocks of %zu, %zu summaries\n", BLOCKS, N, got.size());
+  check(got.size() == analyzed * SpectrumMonitor::NUM_CHANNELS, "one summary per channel every interval");
+
+  bool same = got.size() == analyzed * SpectrumMonitor::NUM_CHANNELS;
+  for (size_t g = 0; same && g < got.size(); ++g) {
+    const size_t block = (g / SpectrumMonitor::NUM_CHANNELS) * SPECTRUM_INTERVAL_BLOCKS;
+    const uint8_t ch = chans[g % SpectrumMonitor::NUM_CHANNELS];
+    std::vector<float> x(N);
+    for (size_t n = 0; n < N; ++n) x[n] = (float)samples[block * N + n].raw[ch];
+    Summary want = analyzeCopy(x);
+    want.channel = ch;
+    want.t_us = samples[block * N + N - 1].t_us;
+    same = memcmp(&want, &got[g], sizeof(want)) == 0 && got[g].peaks[0].bin == 10 + 37 * ch;
+  }
+  check(same, "each summary is analyze() of its block, bit for bit");
+}
+
+static void benchSpeed() {
+  printf("speed\n");
+  const std::vector<float> x = tones(2048, { { binFreq(6), 300 }, { binFreq(102), 120 } }, 3.0, 7);
+  std::vector<float> block(N);
+  Summary s;
+  const int ROUNDS = 20000;
+  double best = 1e30;
+  for (int pass = 0; pass < 3; ++pass) {
+    const double t0 = nowNs();
+    for (int r = 0; r < ROUNDS; ++r) {
+      memcpy(block.data(), x.data(), N * sizeof(float));
+      SpectrumMonitor::analyze(block.data(), s);
+    }
+    best = std::min(best, (nowNs() - t0) / ROUNDS);
+  }
+  const double perSecond = SpectrumMonitor::NUM_CHANNELS * FS / ((double)N * SPECTRUM_INTERVAL_BLOCKS);
+  printf("  analyze(): %.2f us per %zu-point block (best of 3 x %d)\n", best / 1000.0, N, ROUNDS);
+  printf("  %u channels, 1 block in %u: %.1f blocks/s, %.4f%% of one host core\n",
+         (unsigned)SpectrumMonitor::NUM_CHANNELS, (unsigned)SPECTRUM_INTERVAL_BLOCKS, perSecond,
+         perSecond * best / 1e7);
+}
+
+int main(int argc, char** argv) {
+  const char* mode = argc > 1 ? argv[1] : "all";
+  const bool all = strcmp(mode, "all") == 0;
+  if (all || strcmp(mode, "tones") == 0) benchTones();
+  if (all || strcmp(mode, "golden") == 0) benchGolden();
+  if (all || strcmp(mode, "stream") == 0) benchStream();
+  if (all || strcmp(mode, "speed") == 0) benchSpeed();
+  printf("%s\n", s_failures ? "FAILED" : "all checks passed");
+  return s_failures ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+/*
+  trace_capture – record the CM7 trace stream to a file
+
+  Joins the telemetry multicast group, keeps only FLAGS_TRACE datagrams
+  (TraceRecorder.h) and writes them to a trace file (trace_file.h) for
+  trace_replay. With --control it also sends the trace enable (0x32) /
+  disable (0x33) commands to the command group itself.
+
+  With --all it keeps every telemetry datagram instead, whole, in a packet
+  file (trace_file.h) for packet_replay.
+
+  Usage:
+    trace_capture <out.trc> [--iface 192.168.1.10] [--seconds N] [--control]
+    trace_capture <out.pkt> --all [--iface 192.168.1.10] [--seconds N]
+
+  Stops after N seconds (default: until Ctrl-C) and reports packets, bytes
+  and trace packets lost (gaps in the trace sequence number).
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -IREMC_GIGAR1_Core0 \
+        host_bench/trace_capture.cpp -o trace_capture
+*/
+
+#include "trace_file.h"
+#include "TraceRecorder.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+static const char* TELEMETRY_GROUP = "239.9.9.33";
+static const uint16_t TELEMETRY_PORT = 13013;
+static const char* COMMAND_GROUP = "239.9.9.32";
+static const uint16_t COMMAND_PORT = 13012;
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int) { s_stop = 1; }
+
+static uint64_t realtimeNs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sendCommand(const char* iface, uint8_t cmd) {
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd < 0) return;
+  in_addr ifAddr;
+  ifAddr.s_addr = iface ? inet_addr(iface) : htonl(INADDR_ANY);
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &ifAddr, sizeof(ifAddr));
+  unsigned char ttl = 2;
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+  uint8_t packet[NEUTRINO_HEADER_BYTES + 1];
+  memset(packet, 0, sizeof(packet));
+  packet[NEUTRINO_HEADER_BYTES] = cmd;
+  sockaddr_in dst;
+  memset(&dst, 0, sizeof(dst));
+  dst.sin_family = AF_INET;
+  dst.sin_port = htons(COMMAND_PORT);
+  dst.sin_addr.s_addr = inet_addr(COMMAND_GROUP);
+  sendto(fd, packet, sizeof(packet), 0, (sockaddr*)&dst, sizeof(dst));
+  close(fd);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <out.trc> [--iface IP] [--seconds N] [--control]\n"
+                    "       %s <out.pkt> --all [--iface IP] [--seconds N]\n", argv[0], argv[0]);
+    return 2;
+  }
+  const char* outPath = argv[1];
+  const char* iface = nullptr;
+  double seconds = 0.0;
+  bool control = false;
+  bool all = false;
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--iface") && i + 1 < argc) iface = argv[++i];
+    else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--control")) control = true;
+    else if (!strcmp(argv[i], "--all")) all = true;
+    else { fprintf(stderr, "unknown option %s\n", argv[i]); return 2; }
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd < 0) { perror("socket"); return 1; }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  int rcvbuf = 8 * 1024 * 1024;  // ~25 s of trace at 10 kHz
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(TELEMETRY_PORT);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (sockaddr*)&local, sizeof(local)) < 0) { perror("bind"); return 1; }
+
+  ip_mreq mreq;
+  mreq.imr_multiaddr.s_addr = inet_addr(TELEMETRY_GROUP);
+  mreq.imr_interface.s_addr = iface ? inet_addr(iface) : htonl(INADDR_ANY);
+  if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+    perror("IP_ADD_MEMBERSHIP");
+    return 1;
+  }
+  timeval tv = { 0, 200000 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  FILE* out = fopen(outPath, "wb");
+  if (!out || !(all ? packetWriteHeader(out) : traceWriteHeader(out))) { perror(outPath); return 1; }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  if (control) sendCommand(iface, 0x32);
+
+  const uint64_t startNs = realtimeNs();
+  uint64_t packets = 0, bytes = 0, lost = 0;
+  uint32_t nextSeq = 0;
+  bool haveSeq = false;
+  uint8_t buf[2048];
+
+  printf("trace_capture: %s:%u -> %s\n", TELEMETRY_GROUP, TELEMETRY_PORT, outPath);
+  while (!s_stop) {
+    if (seconds > 0 && (realtimeNs() - startNs) >= (uint64_t)(seconds * 1e9)) {
+      if (!control) break;
+      // Ask for the STOP record, then drain briefly
+      sendCommand(iface, 0x33);
+      control = false;
+      seconds += 0.5;
+      continue;
+    }
+    const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (all) {
+      if (n < (ssize_t)NEUTRINO_HEADER_BYTES) continue;
+      if (!traceWritePacket(out, buf, (uint32_t)n, realtimeNs())) { perror("write"); break; }
+      packets++;
+      bytes += n;
+      continue;
+    }
+    if (n < (ssize_t)(NEUTRINO_HEADER_BYTES + TraceRecorder::PACKET_HEADER_BYTES)) continue;
+    if (neutrinoFlags(buf) != TRACE_FLAGS) continue;
+
+    const uint8_t* payload = buf + NEUTRINO_HEADER_BYTES;
+    const uint32_t len = (uint32_t)(n - NEUTRINO_HEADER_BYTES);
+    uint32_t seq;
+    memcpy(&seq, payload, 4);
+    if (haveSeq && seq != nextSeq) {
+      if (seq > nextSeq) lost += seq - nextSeq;
+      else printf("  trace restarted (seq %u)\n", seq);
+    }
+    nextSeq = seq + 1;
+    haveSeq = true;
+
+    if (!traceWritePacket(out, payload, len, realtimeNs())) { perror("write"); break; }
+    packets++;
+    bytes += len;
+  }
+  if (control) sendCommand(iface, 0x33);
+
+  fclose(out);
+  close(fd);
+  printf("trace_capture: %llu packets, %.1f KB, %llu lost\n",
+         (unsigned long long)packets, bytes / 1024.0, (unsigned long long)lost);
+  return 0;
+}
@@ -0,0 +1,69 @@
+/*
+  trace_file – on-disk format shared by trace_capture and trace_replay
+
+    8 bytes  magic "REMCTRC1"
+    then per captured FLAGS_TRACE datagram:
+      u32 len        payload bytes that follow
+      u64 rx_ns      host receive time (CLOCK_REALTIME), 0 for synthetic
+      payload        the TraceRecorder payload (Neutrino header stripped)
+
+  All fields little-endian. Payload/record layout: TraceRecorder.h.
+
+  A packet file (trace_capture --all, read by packet_replay) uses the same
+  records with magic "REMCPKT1" and the whole datagram, Neutrino header
+  included, as payload.
+*/
+
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const char TRACE_FILE_MAGIC[8] = { 'R', 'E', 'M', 'C', 'T', 'R', 'C', '1' };
+static const char PACKET_FILE_MAGIC[8] = { 'R', 'E', 'M', 'C', 'P', 'K', 'T', '1' };
+static const uint32_t TRACE_FLAGS = 16;     // Neutrino header flag (UdpManager FLAGS_TRACE)
+static const size_t NEUTRINO_HEADER_BYTES = 64;
+
+static inline bool traceWriteHeader(FILE* f) {
+  return fwrite(TRACE_FILE_MAGIC, 1, sizeof(TRACE_FILE_MAGIC), f) == sizeof(TRACE_FILE_MAGIC);
+}
+
+static inline bool traceWritePacket(FILE* f, const uint8_t* payload, uint32_t len, uint64_t rxNs) {
+  return fwrite(&len, 4, 1, f) == 1 && fwrite(&rxNs, 8, 1, f) == 1 &&
+         fwrite(payload, 1, len, f) == len;
+}
+
+static inline bool traceReadHeader(FILE* f) {
+  char magic[sizeof(TRACE_FILE_MAGIC)];
+  return fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+         memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+static inline bool packetWriteHeader(FILE* f) {
+  return fwrite(PACKET_FILE_MAGIC, 1, sizeof(PACKET_FILE_MAGIC), f) == sizeof(PACKET_FILE_MAGIC);
+}
+
+static inline bool packetReadHeader(FILE* f) {
+  char magic[sizeof(PACKET_FILE_MAGIC)];
+  return fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+         memcmp(magic, PACKET_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+// false at end of file or on a truncated packet
+static inline bool traceReadPacket(FILE* f, std::vector<uint8_t>& payload, uint64_t& rxNs) {
+  uint32_t len = 0;
+  if (fread(&len, 4, 1, f) != 1 || fread(&rxNs, 8, 1, f) != 1) return false;
+  payload.resize(len);
+  return fread(payload.data(), 1, len, f) == len;
+}
+
+// Neutrino header flags word (big-endian, offset 4)
+static inline uint32_t neutrinoFlags(const uint8_t* packet) {
+  return ((uint32_t)packet[4] << 24) | ((uint32_t)packet[5] << 16) |
+         ((uint32_t)packet[6] << 8) | (uint32_t)packet[7];
+}
+
+#endif // TRACE_FILE_H
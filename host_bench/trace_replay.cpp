@@ -0,0 +1,444 @@
+/*
+  trace_replay – feed a CM7 trace into the host build of SampleCollector
+
+  Links the firmware's SampleCollector, UdpManager, Decimator,
+  SpectrumMonitor, AcquisitionWatchdog and TraceRecorder sources against
+  the Arduino shims in host_bench/shim/. The hardware seams are replaced
+  here:
+
+    SharedRing_Consume()     returns the Sample frames recorded for the
+                             current loop iteration, byte for byte
+    EthernetUDP (commands)   recorded command datagrams are injected into
+                             UdpManager::update() in the same iteration
+    HardwareTimer / millis() follow the recorded CM7 timestamps
+    TimeMapper::sampleToNTP  identity on the 64-bit sample time
+    StateManager             mode flags only, no actuator FSM
+
+  Every datagram UdpManager sends is counted by header flag and folded into
+  a digest, so two builds of SampleCollector can be compared on the same
+  production trace; update() wall time per iteration is reported for
+  performance bisection. Serial lines with warnings, gaps and range
+  adjustments are counted (--verbose echoes all Serial output).
+
+  Usage:
+    trace_replay <trace.trc> [--speed X] [--verbose]
+        --speed 0  as fast as possible (default)
+        --speed 1  original timing, N = N times faster
+    trace_replay --synth <out.trc> [seconds]
+        write a synthetic trace through the real TraceRecorder (10 kHz,
+        collect commands, a Core1 gap and a CM7 stall) for trying the tools
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -Ihost_bench/shim -IREMC_GIGAR1_Core0 \
+        host_bench/trace_replay.cpp host_bench/shim/host_arduino.cpp \
+        REMC_GIGAR1_Core0/SampleCollector.cpp REMC_GIGAR1_Core0/UdpManager.cpp \
+        REMC_GIGAR1_Core0/Decimator.cpp REMC_GIGAR1_Core0/SpectrumMonitor.cpp \
+        REMC_GIGAR1_Core0/AcquisitionWatchdog.cpp REMC_GIGAR1_Core0/TraceRecorder.cpp \
+        REMC_GIGAR1_Core0/MD5.cpp -o trace_replay
+*/
+
+#include "trace_file.h"
+
+#include <Arduino.h>
+#include <EthernetUdp.h>
+#include "SharedRing.h"
+#include "SampleCollector.h"
+#include "UdpManager.h"
+#include "StateManager.h"
+#include "TimeMapper.h"
+#include "HardwareTimer.h"
+#include "TraceRecorder.h"
+#include "AcquisitionWatchdog.h"
+#include "Config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// ====================== Firmware seams ======================
+
+static SharedRing s_ring;
+SharedRing& g_ring = s_ring;
+
+// Frames the current iteration hands to SharedRing_Consume()
+static const std::vector<Sample>* s_pending = nullptr;
+static size_t s_pendingPos = 0;
+static SharedRingHealth s_health = {};
+
+void SharedRing_Init() {
+  ring_init(s_ring);
+}
+
+size_t SharedRing_Consume(Sample* out, int32_t max_samples) {
+  if (!s_pending || !out) return 0;
+  size_t n = s_pending->size() - s_pendingPos;
+  if (max_samples >= 0 && (size_t)max_samples < n) n = (size_t)max_samples;
+  memcpy(out, s_pending->data() + s_pendingPos, n * sizeof(Sample));
+  s_pendingPos += n;
+  return n;
+}
+
+size_t SharedRing_Available() {
+  return s_pending ? s_pending->size() - s_pendingPos : 0;
+}
+
+void SharedRing_GetHealth(SharedRingHealth& out) {
+  out = s_health;
+}
+
+uint64_t HardwareTimer::getMicros64() {
+  return HostClock::micros64();
+}
+
+uint64_t TimeMapper::sampleToNTP(uint32_t t_us, uint32_t rollover_count) {
+  return ((uint64_t)rollover_count << 32) | t_us;
+}
+
+namespace StateManager {
+static bool s_manual = false;
+static bool s_hold = false;
+void requestArm() {}
+void requestDisarm() {}
+void triggerSoftwareActuate() {}
+void manualActuatorControl(ActuatorMoveState) {}
+void manualEMEnable() {}
+void manualEMDisable() {}
+void enableManualMode() { s_manual = true; }
+void disableManualMode() { s_manual = false; }
+void enableHoldAfterFireMode() { s_hold = true; }
+void disableHoldAfterFireMode() { s_hold = false; }
+bool isHoldAfterFireModeActive() { return s_hold; }
+bool isReady() { return false; }
+bool isEmActActive() { return false; }
+bool isManualModeActive() { return s_manual; }
+}
+
+// ====================== Output capture ======================
+
+static const size_t WIRE_SAMPLE_BYTES = ChannelTable::analogWireBytes() + 8 + 6 + 8;
+
+struct OutputStats {
+  uint64_t packets[32];      // by flags value (0..16)
+  uint64_t samplesSent;
+  uint64_t digest;           // FNV-1a over every datagram
+};
+static OutputStats s_out;
+static FILE* s_synthFile = nullptr;
+
+static void onSend(uint16_t, const uint8_t* data, size_t len) {
+  if (len < NEUTRINO_HEADER_BYTES) return;
+  const uint32_t flags = neutrinoFlags(data);
+
+  if (s_synthFile) {
+    if (flags == TRACE_FLAGS) {
+      traceWritePacket(s_synthFile, data + NEUTRINO_HEADER_BYTES,
+                       (uint32_t)(len - NEUTRINO_HEADER_BYTES), 0);
+    }
+    return;
+  }
+
+  s_out.packets[flags < 32 ? flags : 31]++;
+  if (flags <= 1) s_out.samplesSent += (len - NEUTRINO_HEADER_BYTES) / WIRE_SAMPLE_BYTES;
+  for (size_t i = 0; i < len; ++i) {
+    s_out.digest ^= data[i];
+    s_out.digest *= 1099511628211ull;
+  }
+}
+
+struct SerialStats {
+  uint32_t warnings;
+  uint32_t errors;
+  uint32_t gaps;
+  uint32_t adjusted;
+  uint32_t extractions;
+};
+static SerialStats s_serial;
+
+static void onSerialLine(const char* line) {
+  if (strstr(line, "WARNING")) s_serial.warnings++;
+  if (strstr(line, "ERROR")) s_serial.errors++;
+  if (strstr(line, "GAP:")) s_serial.gaps++;
+  if (strstr(line, "ADJUSTED")) s_serial.adjusted++;
+  if (strstr(line, "Extracted and sent")) s_serial.extractions++;
+}
+
+// ====================== Trace parsing ======================
+
+struct Iteration {
+  uint32_t number;
+  uint64_t cm7_us;
+  SharedRingHealth health;
+  std::vector<Sample> samples;
+  std::vector<std::vector<uint8_t>> commands;
+};
+
+static uint16_t get16(const uint8_t* p) { uint16_t v; memcpy(&v, p, 2); return v; }
+static uint32_t get32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static uint64_t get64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+static bool loadTrace(const char* path, std::vector<Iteration>& its, uint32_t& lostPackets) {
+  FILE* f = fopen(path, "rb");
+  if (!f) { perror(path); return false; }
+  if (!traceReadHeader(f)) {
+    fprintf(stderr, "%s: not a trace file\n", path);
+    fclose(f);
+    return false;
+  }
+
+  std::vector<uint8_t> p;
+  uint64_t rxNs;
+  uint32_t nextSeq = 0;
+  bool haveSeq = false;
+  bool ok = true;
+  lostPackets = 0;
+
+  while (ok && traceReadPacket(f, p, rxNs)) {
+    if (p.size() < TraceRecorder::PACKET_HEADER_BYTES) continue;
+    const uint32_t seq = get32(&p[0]);
+    const uint16_t records = get16(&p[4]);
+    const uint16_t version = get16(&p[6]);
+    if (version != TraceRecorder::TRACE_VERSION) {
+      fprintf(stderr, "trace version %u, replay built for %u\n", version, TraceRecorder::TRACE_VERSION);
+      ok = false;
+      break;
+    }
+    if (haveSeq && seq > nextSeq) lostPackets += seq - nextSeq;
+    nextSeq = seq + 1;
+    haveSeq = true;
+
+    size_t off = TraceRecorder::PACKET_HEADER_BYTES;
+    for (uint16_t r = 0; r < records && off + TraceRecorder::RECORD_HEADER_BYTES <= p.size(); ++r) {
+      const uint8_t type = p[off];
+      const uint16_t bodyLen = get16(&p[off + 2]);
+      const uint8_t* b = &p[off + TraceRecorder::RECORD_HEADER_BYTES];
+      off += TraceRecorder::RECORD_HEADER_BYTES + bodyLen;
+      if (off > p.size()) break;
+
+      switch (type) {
+        case TraceRecorder::TRACE_START:
+          if (get16(b) != sizeof(Sample) || b[2] != ANALOG_CHANNEL_COUNT) {
+            fprintf(stderr, "trace Sample layout (%u bytes, %u channels) differs from this build (%zu, %u)\n",
+                    get16(b), b[2], sizeof(Sample), (unsigned)ANALOG_CHANNEL_COUNT);
+            ok = false;
+          }
+          break;
+        case TraceRecorder::TRACE_LOOP: {
+          Iteration it;
+          it.number = get32(b);
+          it.cm7_us = get64(b + 4);
+          memset(&it.health, 0, sizeof(it.health));
+          it.health.overruns = get32(b + 16);
+          it.health.heartbeat = get32(b + 20);
+          its.push_back(std::move(it));
+          break;
+        }
+        case TraceRecorder::TRACE_SAMPLES: {
+          if (its.empty()) break;
+          const uint16_t n = get16(b);
+          const Sample* s = reinterpret_cast<const Sample*>(b + 4);
+          std::vector<Sample>& dst = its.back().samples;
+          const size_t at = dst.size();
+          dst.resize(at + n);
+          memcpy(&dst[at], s, n * sizeof(Sample));
+          break;
+        }
+        case TraceRecorder::TRACE_COMMAND:
+          if (!its.empty()) its.back().commands.emplace_back(b, b + bodyLen);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+// ====================== Replay ======================
+
+static int replay(const char* path, double speed, bool verbose) {
+  std::vector<Iteration> its;
+  uint32_t lost = 0;
+  if (!loadTrace(path, its, lost)) return 1;
+  if (its.empty()) {
+    fprintf(stderr, "%s: no loop iterations recorded\n", path);
+    return 1;
+  }
+
+  Serial.setEcho(verbose);
+  Serial.setLineHook(onSerialLine);
+  HostNet::setSendHook(onSend);
+  HostClock::setMicros(its.front().cm7_us);
+
+  SampleCollector::init();
+  UdpManager::init();
+  AcquisitionWatchdog::init(millis(), 0, 0);
+  memset(&s_out, 0, sizeof(s_out));
+  s_out.digest = 1469598103934665603ull;
+
+  std::vector<double> updateNs;
+  updateNs.reserve(its.size());
+  uint64_t samples = 0, commands = 0, unconsumed = 0;
+
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point wallStart = Clock::now();
+  const uint64_t traceStart = its.front().cm7_us;
+
+  for (const Iteration& it : its) {
+    if (speed > 0) {
+      const double offsetUs = (double)(it.cm7_us - traceStart) / speed;
+      std::this_thread::sleep_until(wallStart + std::chrono::microseconds((int64_t)offsetUs));
+    }
+    HostClock::setMicros(it.cm7_us);
+    s_health = it.health;
+    s_pending = &it.samples;
+    s_pendingPos = 0;
+
+    const Clock::time_point t0 = Clock::now();
+    SampleCollector::update();
+    updateNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+
+    samples += s_pendingPos;
+    unconsumed += it.samples.size() - s_pendingPos;
+    s_pending = nullptr;
+
+    // UdpManager::update() handles one command per loop iteration
+    for (const std::vector<uint8_t>& c : it.commands) {
+      std::vector<uint8_t> dgram(NEUTRINO_HEADER_BYTES, 0);
+      dgram.insert(dgram.end(), c.begin(), c.end());
+      HostNet::inject(Config::COMMAND_PORT, dgram.data(), dgram.size());
+      UdpManager::update();
+      commands++;
+    }
+  }
+  const double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - wallStart).count();
+
+  std::vector<double> sorted(updateNs);
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0;
+  for (double v : updateNs) total += v;
+  const double traceMs = (its.back().cm7_us - traceStart) / 1000.0;
+
+  printf("trace_replay: %s\n", path);
+  printf("  trace       %zu iterations (loop #%u..#%u), %.1f ms, %llu samples, %llu commands, %u packets lost\n",
+         its.size(), its.front().number, its.back().number, traceMs,
+         (unsigned long long)samples, (unsigned long long)commands, lost);
+  printf("  replay      %.1f ms wall (speed %s)\n", wallMs, speed > 0 ? "paced" : "max");
+  printf("  update()    mean %.0f ns  p50 %.0f ns  p99 %.0f ns  max %.0f ns  (%.1f ns/sample)\n",
+         total / updateNs.size(), sorted[sorted.size() / 2],
+         sorted[(size_t)(sorted.size() * 0.99)], sorted.back(),
+         samples ? total / samples : 0.0);
+  printf("  output      %llu sample packets (%llu samples), %llu collected, %llu batch ends, "
+         "%llu spectral, %llu fault\n",
+         (unsigned long long)s_out.packets[0] + s_out.packets[1], (unsigned long long)s_out.samplesSent,
+         (unsigned long long)s_out.packets[1], (unsigned long long)s_out.packets[2],
+         (unsigned long long)s_out.packets[4], (unsigned long long)s_out.packets[8]);
+  printf("  collector   %u extractions, %u warnings, %u errors, %u gaps (%u samples), %u range adjustments\n",
+         s_serial.extractions, s_serial.warnings, s_serial.errors, s_serial.gaps,
+         SampleCollector::getGapSamples(), s_serial.adjusted);
+  printf("  digest      %016llx\n", (unsigned long long)s_out.digest);
+  if (unconsumed) {
+    printf("  WARNING: %llu recorded samples were not consumed (MAX_FETCH differs from the traced build?)\n",
+           (unsigned long long)unconsumed);
+  }
+  return 0;
+}
+
+// ====================== Synthetic trace ======================
+
+static int synth(const char* path, double seconds) {
+  s_synthFile = fopen(path, "wb");
+  if (!s_synthFile || !traceWriteHeader(s_synthFile)) { perror(path); return 1; }
+
+  HostNet::setSendHook(onSend);
+  UdpManager::init();
+  TraceRecorder::init();
+
+  // Sample clock starts 1 s before a 32-bit rollover
+  const uint64_t t0 = 0xFFFFFFFFull - 1000000ull;
+  const uint32_t periodUs = 1000000UL / Config::ANALOG_SAMPLE_FREQUENCY_HZ;
+  const uint32_t totalMs = (uint32_t)(seconds * 1000.0);
+  const uint32_t gapAtMs = 600, gapMs = 25;       // Core1 delivers nothing
+  const uint32_t stallAtMs = 800, stallMs = 40;   // CM7 does not consume
+
+  HostClock::setMicros(t0);
+  TraceRecorder::enable();
+
+  uint64_t nextSample = 0;   // sample index (time = t0 + index * period)
+  uint32_t iteration = 0;
+  uint32_t heartbeat = 0;
+  std::vector<Sample> batch;
+
+  for (uint32_t ms = 1; ms <= totalMs; ++ms) {
+    iteration += 3;  // idle iterations in between are not recorded
+    const uint64_t nowUs = t0 + (uint64_t)ms * 1000u;
+    HostClock::setMicros(nowUs);
+    if (ms >= stallAtMs && ms < stallAtMs + stallMs) continue;
+
+    // Everything produced up to now
+    batch.clear();
+    for (; t0 + nextSample * periodUs < nowUs; ++nextSample) {
+      heartbeat++;
+      const uint64_t tUs = t0 + nextSample * periodUs;
+      const uint32_t atMs = (uint32_t)(nextSample * periodUs / 1000u);
+      if (atMs >= gapAtMs && atMs < gapAtMs + gapMs) continue;
+      Sample s;
+      memset(&s, 0, sizeof(s));
+      s.t_us = (uint32_t)tUs;
+      s.rollover_count = (uint32_t)(tUs >> 32);
+      const uint64_t eUs = tUs + 9;
+      s.t_us_end = (uint32_t)eUs;
+      s.rollover_count_end = (uint32_t)(eUs >> 32);
+      const double ph = 2.0 * M_PI * 50.0 * (double)(nextSample * periodUs) * 1e-6;
+      for (uint8_t ch = 0; ch < ANALOG_CHANNEL_COUNT; ++ch) {
+        s.raw[ch] = (uint16_t)(2048 + 1000 * sin(ph + ch) + (nextSample * 7 + ch * 13) % 17);
+      }
+      batch.push_back(s);
+    }
+
+    s_health.heartbeat = heartbeat;
+    TraceRecorder::loopBegin(iteration);
+    // SampleCollector consumes at most MAX_FETCH (1024) per iteration
+    TraceRecorder::recordSamples(batch.data(), batch.size());
+
+    if (ms == 200 || ms == 1200) {
+      uint8_t cmd[9] = { 0x04 };
+      const int32_t start = ms == 200 ? -1000 : -5000;
+      const int32_t stop = ms == 200 ? 1000 : 0;
+      memcpy(cmd + 1, &start, 4);
+      memcpy(cmd + 5, &stop, 4);
+      TraceRecorder::recordCommand(cmd, sizeof(cmd));
+    }
+    TraceRecorder::flush();
+  }
+  TraceRecorder::disable();
+  fclose(s_synthFile);
+  s_synthFile = nullptr;
+  printf("trace_replay: wrote synthetic trace %s (%.1f s, gap %u ms @ %u ms, CM7 stall %u ms @ %u ms)\n",
+         path, seconds, gapMs, gapAtMs, stallMs, stallAtMs);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && !strcmp(argv[1], "--synth")) {
+    return synth(argv[2], argc > 3 ? atof(argv[3]) : 2.0);
+  }
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace.trc> [--speed X] [--verbose]\n"
+                    "       %s --synth <out.trc> [seconds]\n", argv[0], argv[0]);
+    return 2;
+  }
+  double speed = 0.0;
+  bool verbose = false;
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--speed") && i + 1 < argc) speed = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--verbose")) verbose = true;
+    else { fprintf(stderr, "unknown option %s\n", argv[i]); return 2; }
+  }
+  return replay(argv[1], speed, verbose);
+}
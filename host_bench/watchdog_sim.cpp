@@ -0,0 +1,225 @@
+/*
+  watchdog_sim – host test for the CM7 AcquisitionWatchdog
+
+  Drives AcquisitionWatchdog.h with a fake Core1 on a host SharedRing, in
+  simulated 1 ms steps at 10 kHz:
+
+    - the fake producer bumps the ring heartbeat every tick and pushes a
+      frame unless its ADC is "stalled"; a "core" stall stops both
+    - recovery actions reach the fake Core1 after an RPC latency and
+      clear the stall only if the scenario says that action works
+    - the consumer drains the ring every step and sizes timestamp gaps with
+      AcquisitionWatchdog::missingSamples(), like SampleCollector
+
+  Each scenario checks the exact sequence of watchdog actions and that the
+  gap marked in the index space equals the frames the producer skipped.
+
+  Build (from the repo root):
+    g++ -std=gnu++14 -O2 -Wall -Wextra -IREMC_GIGAR1_Core0 \
+        host_bench/watchdog_sim.cpp REMC_GIGAR1_Core0/AcquisitionWatchdog.cpp \
+        -o watchdog_sim
+*/
+
+#include "SharedRing.h"
+#include "AcquisitionWatchdog.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace AcquisitionWatchdog;
+
+static const uint32_t TICKS_PER_MS = 10;
+static const uint32_t PERIOD_US = 100;
+static const uint32_t RPC_LATENCY_MS = 2;
+
+static SharedRing s_ring;
+
+enum StallKind : uint8_t { STALL_NONE = 0, STALL_ADC, STALL_CORE };
+
+struct Scenario {
+  const char* name;
+  uint32_t bootMs;              // producer silent until bootMs (or a restart)
+  uint32_t stallAtMs;           // 0 = no stall
+  uint32_t stallMs;             // stall ends by itself after this (0 = never)
+  StallKind kind;
+  uint32_t resetsToFix;         // ADC resets needed before the ADC works (0 = never)
+  uint32_t restartsToFix;       // restarts needed (0 = never)
+  uint32_t runMs;
+  std::vector<Action> expected; // actions in order (ACTION_NONE filtered out)
+};
+
+struct FakeCore1 {
+  bool booted;
+  StallKind stall;
+  uint32_t adcResets;
+  uint32_t restarts;
+  uint32_t pendingAtMs;         // when the in-flight RPC request lands
+  Action pending;
+};
+
+static Sample makeSample(uint64_t t_us) {
+  Sample s;
+  memset(&s, 0, sizeof(s));
+  s.t_us = (uint32_t)t_us;
+  s.rollover_count = (uint32_t)(t_us >> 32);
+  const uint64_t e = t_us + 12;
+  s.t_us_end = (uint32_t)e;
+  s.rollover_count_end = (uint32_t)(e >> 32);
+  return s;
+}
+
+static bool runScenario(const Scenario& sc) {
+  ring_init(s_ring);
+  RingProducer prod = { 0, 0, 0, 0 };
+  RingEpoch epoch = { false, 0, 0 };
+
+  Config cfg = { ACQ_WATCHDOG_BOOT_MS, ACQ_WATCHDOG_STALL_MS, ACQ_WATCHDOG_RETRY_MS,
+                 ACQ_WATCHDOG_MAX_ADC_RESETS, ACQ_WATCHDOG_MAX_RESTARTS };
+  init(cfg, 0, s_ring.head, s_ring.heartbeat);
+
+  FakeCore1 core = { false, STALL_NONE, 0, 0, 0, ACTION_NONE };
+  std::vector<Action> actions;
+  std::vector<Sample> out(SHARED_RING_CAPACITY);
+
+  uint64_t skipped = 0;        // ticks without a frame (after the first frame)
+  uint64_t marked = 0;         // consumer-side gap samples
+  uint64_t consumed = 0;
+  bool produced = false;
+  bool haveLast = false;
+  uint64_t lastUs = 0;
+  // Start just below a 32-bit rollover so gaps straddle it
+  const uint64_t t0 = 0xFFFFFFFFull - 150000ull;
+
+  for (uint32_t ms = 0; ms < sc.runMs; ++ms) {
+    // ---- scenario stall schedule ----
+    if (sc.stallAtMs && ms == sc.stallAtMs) core.stall = sc.kind;
+    if (sc.stallAtMs && sc.stallMs && ms == sc.stallAtMs + sc.stallMs) core.stall = STALL_NONE;
+
+    // ---- RPC request lands on the fake Core1 ----
+    if (core.pending != ACTION_NONE && ms >= core.pendingAtMs) {
+      if (core.pending == ACTION_ADC_RESET) {
+        core.adcResets++;
+        if (core.stall == STALL_ADC && sc.resetsToFix && core.adcResets >= sc.resetsToFix) core.stall = STALL_NONE;
+      } else {
+        core.restarts++;
+        core.booted = true;
+        if (sc.restartsToFix && core.restarts >= sc.restartsToFix) core.stall = STALL_NONE;
+      }
+      core.pending = ACTION_NONE;
+    }
+
+    // ---- producer: 10 ticks ----
+    if (ms >= sc.bootMs) core.booted = true;
+    for (uint32_t k = 0; k < TICKS_PER_MS; ++k) {
+      if (!core.booted || core.stall == STALL_CORE) continue;
+      ring_heartbeat(s_ring);
+      if (core.stall == STALL_ADC) {
+        s_ring.adc_timeouts++;
+        if (produced) skipped++;
+        continue;
+      }
+      const uint64_t t = t0 + ((uint64_t)ms * TICKS_PER_MS + k) * PERIOD_US;
+      ring_push(s_ring, prod, makeSample(t));
+      produced = true;
+    }
+    if (core.stall == STALL_CORE && produced) skipped += TICKS_PER_MS;
+
+    // ---- consumer (SampleCollector) ----
+    const size_t n = ring_consume(s_ring, epoch, out.data(), -1);
+    for (size_t i = 0; i < n; ++i) {
+      const uint64_t us = ((uint64_t)out[i].rollover_count << 32) | out[i].t_us;
+      if (haveLast) marked += missingSamples(lastUs, us, PERIOD_US);
+      lastUs = us;
+      haveLast = true;
+    }
+    consumed += n;
+
+    // ---- watchdog (serviceWatchdog) ----
+    const Action a = update(ms, s_ring.head, s_ring.heartbeat);
+    if (a != ACTION_NONE) {
+      actions.push_back(a);
+      if (a == ACTION_ADC_RESET || a == ACTION_CORE1_RESTART) {
+        core.pending = a;
+        core.pendingAtMs = ms + RPC_LATENCY_MS;
+      }
+    }
+  }
+
+  // Skipped ticks after the last frame are not a gap (yet)
+  bool ok = actions == sc.expected;
+  const bool endsStalled = core.stall != STALL_NONE;
+  if (!endsStalled && marked != skipped) ok = false;
+
+  printf("  %-20s %-4s actions:", sc.name, ok ? "ok" : "FAIL");
+  for (Action a : actions) printf(" %s", actionName(a));
+  printf("\n  %-20s      consumed %llu  skipped %llu  gap-marked %llu  incidents %u  last stall %u ms  state %s\n",
+         "", (unsigned long long)consumed, (unsigned long long)skipped, (unsigned long long)marked,
+         getStatus().incidents, getStatus().lastStallMs, stateName(getStatus().state));
+  if (!ok && actions != sc.expected) {
+    printf("  %-20s      expected:", "");
+    for (Action a : sc.expected) printf(" %s", actionName(a));
+    printf("\n");
+  }
+  return ok;
+}
+
+static bool checkMissingSamples() {
+  struct Case { uint64_t prev, next; uint32_t want; };
+  const Case cases[] = {
+    { 1000, 1100, 0 },   // nominal
+    { 1000, 1149, 0 },   // jitter
+    { 1000, 1150, 1 },   // 1.5 periods rounds to one missing sample
+    { 1000, 1200, 1 },
+    { 1000, 1300, 2 },
+    { 1000, 1000, 0 },   // duplicate
+    { 1000, 900, 0 },    // backwards
+    { 0xFFFFFF00ull, 0xFFFFFF00ull + 10100ull, 100 },  // across a 32-bit rollover
+  };
+  bool ok = true;
+  for (const Case& c : cases) {
+    const uint32_t got = missingSamples(c.prev, c.next, PERIOD_US);
+    if (got != c.want) {
+      printf("  missingSamples(%llu, %llu) = %u, want %u\n",
+             (unsigned long long)c.prev, (unsigned long long)c.next, got, c.want);
+      ok = false;
+    }
+  }
+  printf("  %-20s %s\n", "missingSamples", ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  printf("watchdog: stall %u ms, retry %u ms, %u ADC resets, %u restarts, boot %u ms\n",
+         (unsigned)ACQ_WATCHDOG_STALL_MS, (unsigned)ACQ_WATCHDOG_RETRY_MS,
+         (unsigned)ACQ_WATCHDOG_MAX_ADC_RESETS, (unsigned)ACQ_WATCHDOG_MAX_RESTARTS,
+         (unsigned)ACQ_WATCHDOG_BOOT_MS);
+
+  const Scenario scenarios[] = {
+    { "healthy", 0, 0, 0, STALL_NONE, 0, 0, 2000, {} },
+    { "hiccup-10ms", 0, 500, 10, STALL_ADC, 0, 0, 1000, {} },
+    { "slow-boot", 1500, 0, 0, STALL_NONE, 0, 0, 2000, {} },
+    { "no-boot", 5000, 0, 0, STALL_NONE, 0, 1, 6000,
+      { ACTION_REPORT_FAULT, ACTION_CORE1_RESTART, ACTION_REPORT_RECOVERED } },
+    { "adc-stall-reset", 0, 500, 0, STALL_ADC, 1, 0, 1500,
+      { ACTION_REPORT_FAULT, ACTION_ADC_RESET, ACTION_REPORT_RECOVERED } },
+    { "adc-stall-restart", 0, 500, 0, STALL_ADC, 0, 1, 1500,
+      { ACTION_REPORT_FAULT, ACTION_ADC_RESET, ACTION_ADC_RESET, ACTION_ADC_RESET,
+        ACTION_CORE1_RESTART, ACTION_REPORT_RECOVERED } },
+    { "core1-stall-restart", 0, 500, 0, STALL_CORE, 0, 2, 1500,
+      { ACTION_REPORT_FAULT, ACTION_CORE1_RESTART, ACTION_CORE1_RESTART, ACTION_REPORT_RECOVERED } },
+    { "core1-stall-dead", 0, 500, 0, STALL_CORE, 0, 0, 1500,
+      { ACTION_REPORT_FAULT, ACTION_CORE1_RESTART, ACTION_CORE1_RESTART, ACTION_REPORT_FAILED } },
+    { "self-clearing-30ms", 0, 500, 30, STALL_ADC, 0, 0, 1500,
+      { ACTION_REPORT_FAULT, ACTION_ADC_RESET, ACTION_REPORT_RECOVERED } },
+  };
+
+  int failures = 0;
+  if (!checkMissingSamples()) failures++;
+  for (const Scenario& sc : scenarios) {
+    if (!runScenario(sc)) failures++;
+  }
+  printf("%s\n", failures ? "FAILED" : "all scenarios passed");
+  return failures ? 1 : 0;
+}